@@ -34,6 +34,9 @@ static byte_t z_block [LEVEL_MAX] [BLOCK_SIZE];  // zone block buffer
 
 static file_pos f_pos;
 
+static zone_nr z_run;                // first zone of pending contiguous run
+static int n_run;                    // number of zones in pending run
+
 static byte_t d_dir [BLOCK_SIZE];    // root directory buffer
 
 
@@ -55,6 +58,7 @@ static int strcmp (const char * s, const char * d);
 static void load_super ();
 static void load_inode ();
 static void load_zone (int level, zone_nr * z_start, zone_nr * z_end);
+static void load_run ();
 static void load_file ();
 
 
@@ -76,7 +80,7 @@ void load_prog ()
 	// Avoid reuse of an old copy of /bootopts in memory
 	// if we're rebooting with no /bootopts
 	int __far *optseg = _MK_FP(OPTSEG, 0);
-	*optseg = i_boot = i_now = 0;
+	*optseg = i_boot = i_now = n_run = 0;
 
 	load_super();
 	load_file ();
@@ -166,8 +170,12 @@ static void load_zone (int level, zone_nr * z_start, zone_nr * z_end)
 	for (zone_nr * z = z_start; z < z_end; z++) {
 		if (level == 0) {
 			if (i_now) {
-				long lin_addr = loadaddr + f_pos;
-				disk_read ((*z) << 1, 2, (byte_t *) (unsigned) lin_addr, (unsigned) (lin_addr >> 4) & 0xf000);
+				// Collect contiguous zones, disk_read splits at tracks and 64K
+				if (*z != z_run + n_run) {
+					load_run ();
+					z_run = *z;
+				}
+				n_run++;
 			} else {
 				if (!f_pos) disk_read ((*z) << 1, 2, d_dir /*+ f_pos*/, seg_data ());
 			}
@@ -183,6 +191,19 @@ static void load_zone (int level, zone_nr * z_start, zone_nr * z_end)
 
 //------------------------------------------------------------------------------
 
+// Read the pending run of zones, which ends at f_pos
+
+static void load_run ()
+{
+	if (n_run) {
+		long lin_addr = loadaddr + f_pos - ((long) n_run << 10);
+		disk_read (z_run << 1, n_run << 1, (byte_t *) (unsigned) lin_addr, (unsigned) (lin_addr >> 4) & 0xf000);
+		n_run = 0;
+	}
+}
+
+//------------------------------------------------------------------------------
+
 static void load_file ()
 {
 	load_inode ();
@@ -196,11 +217,11 @@ static void load_file ()
 
 	// Direct zones
 	load_zone (0, &(i_data->i_zone [ZONE_IND_L0]), &(i_data->i_zone [ZONE_IND_L1]));
-	if (f_pos >= i_data->i_size) return;
 
 	// Indirect zones
-	load_zone (1, &(i_data->i_zone [ZONE_IND_L1]), &(i_data->i_zone [ZONE_IND_L2]));
-	if (f_pos >= i_data->i_size) return;
+	if (f_pos < i_data->i_size)
+		load_zone (1, &(i_data->i_zone [ZONE_IND_L1]), &(i_data->i_zone [ZONE_IND_L2]));
+	load_run ();
 
 	// Double-indirect zones
 	//load_zone (2, &(i_data->i_zone [ZONE_IND_L2]), &(i_data->i_zone [ZONE_IND_END]));
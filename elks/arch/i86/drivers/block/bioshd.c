@@ -46,6 +46,7 @@
 #include <linuxmt/config.h>
 #include <linuxmt/debug.h>
 #include <linuxmt/timer.h>
+#include <linuxmt/mem.h>
 
 #include <arch/hdreg.h>
 #include <arch/io.h>
@@ -61,6 +62,7 @@
 #define FULL_TRACK      0       /* =1 to read full tracks when track caching */
 //#define IODELAY       5       /* times 10ms, emulated delay for floppy on QEMU */
 #define MAX_ERRS        5       /* maximum sector read/write error retries */
+#define NR_TRACK_CACHE  4       /* number of tracks in track cache */
 
 #define MAJOR_NR        BIOSHD_MAJOR
 #include "blk.h"
@@ -80,7 +82,6 @@ static int hd_count = 0;                /* number of hard disks */
 
 static int access_count[NUM_DRIVES];    /* device open count */
 static struct drive_infot drive_info[NUM_DRIVES];   /* operating drive info */
-static struct drive_infot *cache_drive;
 struct drive_infot *last_drive;         /* set to last drivep-> used in read/write */
 extern struct drive_infot fd_types[];   /* BIOS floppy formats */
 
@@ -90,6 +91,11 @@ static int bioshd_open(struct inode *, struct file *);
 static void bioshd_release(struct inode *, struct file *);
 static int bioshd_ioctl(struct inode *, struct file *, unsigned int, unsigned int);
 static void bioshd_geninit(void);
+#ifdef CONFIG_TRACK_CACHE
+static void INITPROC track_cache_init(void);
+static void track_cache_invalidate(struct drive_infot *drivep, sector_t start,
+        sector_t end);
+#endif
 
 static struct gendisk bioshd_gendisk = {
     MAJOR_NR,                   /* Major number */
@@ -104,11 +110,6 @@ static struct gendisk bioshd_gendisk = {
     NULL                        /* next */
 };
 
-static void set_cache_invalid(void)
-{
-    cache_drive = NULL;
-}
-
 #ifdef CONFIG_BLK_DEV_BFD
 static int read_sector(int drive, int cylinder, int sector)
 {
@@ -118,7 +119,6 @@ static int read_sector(int drive, int cylinder, int sector)
     drive = bios_drive_map[DRIVE_FD0+drive];
 #endif
 
-    set_cache_invalid();
     do {
         set_irq();
         bios_set_ddpt(36);      /* set to large value to avoid BIOS issues*/
@@ -342,6 +342,9 @@ static void bioshd_release(struct inode *inode, struct file *filp)
         fsync_dev(dev);
         invalidate_inodes(dev);
         invalidate_buffers(dev);
+#ifdef CONFIG_TRACK_CACHE
+        track_cache_invalidate(&drive_info[target], 0, -1UL);
+#endif
     }
 }
 
@@ -421,10 +424,18 @@ void INITPROC bioshd_init(void)
 
     if (!(fd_count + hd_count)) return;
 
+#ifdef CONFIG_TRACK_CACHE
+    if (fd_count)
+        track_cache_init();
+#endif
+
     bios_copy_ddpt();       /* make a RAM copy of the disk drive parameter table*/
 
     if (!register_blkdev(MAJOR_NR, DEVICE_NAME, &bioshd_fops)) {
         blk_dev[MAJOR_NR].request_fn = DEVICE_REQUEST;
+#ifdef CONFIG_ASYNCIO
+        blk_dev[MAJOR_NR].max_merge = DMASEGSZ;     /* merged requests bounce via DMASEG */
+#endif
 
         if (gendisk_head == NULL) {
             bioshd_gendisk.next = gendisk_head;
@@ -488,6 +499,20 @@ static int bioshd_ioctl(struct inode *inode, struct file *file, unsigned int cmd
     drivep = &drive_info[dev];
     err = -EINVAL;
     switch (cmd) {
+#ifdef CONFIG_TRACK_CACHE
+    case IOCTL_BLK_GET_CACHE_STATS:
+        {
+            struct blk_cache_stats *st = (struct blk_cache_stats *)arg;
+
+            err = verify_area(VERIFY_WRITE, (void *)st, sizeof(struct blk_cache_stats));
+            if (!err) {
+                put_user((unsigned)kstat.track_tries, &st->tries);
+                put_user((unsigned)kstat.track_hits, &st->hits);
+                put_user(NR_TRACK_CACHE, &st->entries);
+            }
+        }
+        break;
+#endif
     case HDIO_GETGEO:
         err = verify_area(VERIFY_WRITE, (void *)loc, sizeof(struct hd_geometry));
         if (!err) {
@@ -566,7 +591,6 @@ static int do_readwrite(struct drive_infot *drivep, sector_t start, char *buf,
             offset = 0;
             if (cmd == WRITE)           /* copy xms buffer down before write*/
                 xms_fmemcpyw(0, DMASEG, buf, seg, this_pass*(drivep->sector_size >> 1));
-            set_cache_invalid();
         } else {
             segment = (seg_t)seg;
             offset = (unsigned) buf;
@@ -578,7 +602,7 @@ static int do_readwrite(struct drive_infot *drivep, sector_t start, char *buf,
         error = bios_disk_rw(cmd == WRITE? BIOSHD_WRITE: BIOSHD_READ, this_pass,
                                 drive, cylinder, head, sector, segment, offset);
         if (error) {
-            printk("bioshd(%x): cmd %d retry #%d CHS %d/%d/%d count %d\n",
+            printk(KERN_DEBUG "bioshd(%x): cmd %d retry #%d CHS %d/%d/%d count %d\n",
                 drive, cmd, MAX_ERRS - errs + 1, cylinder, head, sector, this_pass);
             bios_disk_reset(drive);
         }
@@ -590,22 +614,85 @@ static int do_readwrite(struct drive_infot *drivep, sector_t start, char *buf,
     if (usedmaseg) {
         if (cmd == READ)            /* copy DMASEG up to xms*/
             xms_fmemcpyw(buf, seg, 0, DMASEG, this_pass*(drivep->sector_size >> 1));
-        set_cache_invalid();
     }
     return this_pass;
 }
 
 #ifdef CONFIG_TRACK_CACHE               /* use track-sized sector cache*/
-static sector_t cache_startsector;
-static sector_t cache_endsector;
+/*
+ * Multi-track read cache. A track is read into DMASEG and then copied into
+ * one of NR_TRACK_CACHE slots in main or XMS memory, replacing the least
+ * recently used slot. Since the cache no longer lives in DMASEG, other
+ * DMASEG users don't invalidate it; only writes and media changes do.
+ */
+struct track_cache {
+    struct drive_infot *drivep;         /* NULL if slot empty */
+    sector_t startsector;
+    sector_t endsector;
+    ramdesc_t seg;                      /* track data, 0 if slot unallocated */
+    unsigned int lru;                   /* last access stamp */
+};
 
-/* read from start sector to end of track into DMASEG track buffer, no retries*/
-static void do_readtrack(struct drive_infot *drivep, sector_t start)
+static struct track_cache track_cache[NR_TRACK_CACHE];
+static unsigned int cache_clock;
+
+/* allocate cache slots, from XMS if enabled else main memory */
+static void INITPROC track_cache_init(void)
 {
+    struct track_cache *tc;
+    segment_s *seg;
+
+    for (tc = track_cache; tc < &track_cache[NR_TRACK_CACHE]; tc++) {
+#ifdef CONFIG_FS_XMS_BUFFER
+        if (xms_enabled) {
+            tc->seg = xms_alloc(DMASEGSZ);
+            continue;
+        }
+#endif
+        if (!(seg = seg_alloc(DMASEGSZ >> 4, SEG_FLAG_EXTBUF)))
+            break;
+        tc->seg = seg->base;
+    }
+    printk("bioshd: %d track cache entries\n", (int)(tc - track_cache));
+}
+
+/* invalidate cached tracks on drive overlapping start..end, or whole drive/all */
+static void track_cache_invalidate(struct drive_infot *drivep, sector_t start,
+        sector_t end)
+{
+    struct track_cache *tc;
+
+    for (tc = track_cache; tc < &track_cache[NR_TRACK_CACHE]; tc++) {
+        if (!drivep || (tc->drivep == drivep &&
+                start <= tc->endsector && end >= tc->startsector))
+            tc->drivep = NULL;
+    }
+}
+
+/* read from start sector to end of track into a cache slot, no retries*/
+static struct track_cache *do_readtrack(struct drive_infot *drivep, sector_t start)
+{
+    struct track_cache *tc, *victim;
     unsigned int cylinder, head, sector, num_sectors;
     int drive = drivep - drive_info;
     int error, errs = 0;
 
+    /* find empty or least recently used slot */
+    victim = NULL;
+    for (tc = track_cache; tc < &track_cache[NR_TRACK_CACHE]; tc++) {
+        if (!tc->seg)
+            continue;
+        if (!tc->drivep) {
+            victim = tc;
+            break;
+        }
+        if (!victim || cache_clock - tc->lru > cache_clock - victim->lru)
+            victim = tc;
+    }
+    if (!victim)
+        return NULL;
+    victim->drivep = NULL;
+
     drive = bios_drive_map[drive];
     get_chst(drivep, &start, &cylinder, &head, &sector, &num_sectors, 1);
 
@@ -620,63 +707,147 @@ static void do_readtrack(struct drive_infot *drivep, sector_t start)
         error = bios_disk_rw(BIOSHD_READ, num_sectors, drive,
                                  cylinder, head, sector, DMASEG, 0);
         if (error) {
-            printk("bioshd(%x): track read retry #%d CHS %d/%d/%d count %d\n",
+            printk(KERN_DEBUG "bioshd(%x): track read retry #%d CHS %d/%d/%d count %d\n",
                 drive, errs + 1, cylinder, head, sector, num_sectors);
             bios_disk_reset(drive);
         }
     } while (error && ++errs < 1); /* no track retries, for testing only*/
     last_drive = drivep;
 
-    if (error) {
-        set_cache_invalid();
-        return;
-    }
+    if (error)
+        return NULL;
+
+    xms_fmemcpyw(0, victim->seg, 0, DMASEG, num_sectors * (drivep->sector_size >> 1));
+    victim->drivep = drivep;
+    victim->startsector = start;
+    victim->endsector = start + num_sectors - 1;
+    debug_bios("bioshd(%x): track read lba %ld to %ld count %d slot %d\n",
+        drive, victim->startsector, victim->endsector, num_sectors,
+        (int)(victim - track_cache));
+    return victim;
+}
+
+/* find the cache slot holding one sector */
+static struct track_cache *cache_lookup(struct drive_infot *drivep, sector_t start)
+{
+    struct track_cache *tc;
 
-    cache_drive = drivep;
-    cache_startsector = start;
-    cache_endsector = start + num_sectors - 1;
-    debug_bios("bioshd(%x): track read lba %ld to %ld count %d\n",
-        drive, cache_startsector, cache_endsector, num_sectors);
+    for (tc = track_cache; tc < &track_cache[NR_TRACK_CACHE]; tc++) {
+        if (tc->drivep == drivep && start >= tc->startsector && start <= tc->endsector)
+            return tc;
+    }
+    return NULL;
 }
 
-/* check whether cache is valid for one sector*/
-static int cache_valid(struct drive_infot *drivep, sector_t start, char *buf,
-        ramdesc_t seg)
+/* copy one sector from a cache slot */
+static void cache_copy(struct track_cache *tc, struct drive_infot *drivep,
+        sector_t start, char *buf, ramdesc_t seg)
 {
     unsigned int offset;
 
-    if (drivep != cache_drive || start < cache_startsector || start > cache_endsector)
-        return 0;
-
-    offset = (int)(start - cache_startsector) * drivep->sector_size;
+    offset = (int)(start - tc->startsector) * drivep->sector_size;
     debug_bios("bioshd(%x): cache hit lba %ld\n",
         bios_drive_map[drivep-drive_info], start);
-    xms_fmemcpyw(buf, seg, (void *)offset, DMASEG, drivep->sector_size >> 1);
-    return 1;
+    xms_fmemcpyw(buf, seg, (void *)offset, tc->seg, drivep->sector_size >> 1);
+    tc->lru = ++cache_clock;
 }
 
-static int cache_tries;
-static int cache_hits;
-
 /* read from cache, return # sectors read*/
 static int do_cache_read(struct drive_infot *drivep, sector_t start, char *buf,
-        ramdesc_t seg, int cmd)
+        ramdesc_t seg, int cmd, unsigned int count)
 {
+    struct track_cache *tc;
+
     if (cmd == READ) {
-        cache_tries++;
-        if (cache_valid(drivep, start, buf, seg)) { /* try cache first*/
-            cache_hits++;
+        kstat.track_tries++;
+        if ((tc = cache_lookup(drivep, start)) != NULL) {   /* try cache first*/
+            kstat.track_hits++;
+            cache_copy(tc, drivep, start, buf, seg);
             return 1;
         }
-        do_readtrack(drivep, start);                /* read whole track*/
-        if (cache_valid(drivep, start, buf, seg))   /* try cache again*/
+        if ((tc = do_readtrack(drivep, start)) != NULL &&   /* read whole track*/
+                start >= tc->startsector && start <= tc->endsector) {
+            cache_copy(tc, drivep, start, buf, seg);
             return 1;
-    }
-    set_cache_invalid();
+        }
+    } else
+        track_cache_invalidate(drivep, start, start + count - 1);
     return 0;
 }
 #endif
 
+#ifdef CONFIG_ASYNCIO
+/* linear address of a request buffer, for finding physically adjacent buffers */
+static addr_t rq_linear(struct request *req)
+{
+#pragma GCC diagnostic ignored "-Wshift-count-overflow"
+    if (req->rq_seg >> 16)              /* XMS buffer, already linear */
+        return (addr_t)req->rq_seg + (unsigned int)req->rq_buffer;
+    return ((addr_t)req->rq_seg << 4) + (unsigned int)req->rq_buffer;
+}
+
+/*
+ * Copy between DMASEG and the buffers of a merged request. Runs of buffers
+ * that are adjacent in memory, as freshly allocated XMS or EXT buffers often
+ * are, are moved with a single copy (one block move for INT 15 XMS).
+ */
+static void merged_copy(struct request *req, int cmd)
+{
+    struct request *run, *last;
+    unsigned int offset = 0;
+    unsigned int n;
+
+    for (run = req; run; run = last->rq_merge) {
+        n = 1;
+        for (last = run; last->rq_merge &&
+                rq_linear(last->rq_merge) == rq_linear(last) + BLOCK_SIZE;
+                last = last->rq_merge)
+            n++;
+        if (cmd == WRITE)
+            xms_fmemcpyw((char *)offset, DMASEG, run->rq_buffer, run->rq_seg,
+                n * (BLOCK_SIZE/2));
+        else
+            xms_fmemcpyw(run->rq_buffer, run->rq_seg, (char *)offset, DMASEG,
+                n * (BLOCK_SIZE/2));
+        offset += n * BLOCK_SIZE;
+    }
+}
+
+/*
+ * Transfer a merged multi-buffer request through DMASEG, so that adjacent
+ * sectors in non-contiguous L2 buffers are read or written using as few
+ * BIOS calls as the track geometry allows. Returns 0 on error.
+ */
+static int do_merged_readwrite(struct drive_infot *drivep, sector_t start,
+        struct request *req)
+{
+    unsigned int offset, count, num_sectors;
+
+    if (req->rq_cmd == WRITE) {         /* gather buffers into DMASEG */
+        merged_copy(req, WRITE);
+#ifdef CONFIG_TRACK_CACHE
+        track_cache_invalidate(drivep, start, start + req->rq_nr_sectors - 1);
+#endif
+    }
+
+    count = req->rq_nr_sectors;
+    offset = 0;
+    while (count > 0) {
+        num_sectors = do_readwrite(drivep, start, (char *)offset, DMASEG,
+            req->rq_cmd, count);
+        if (num_sectors == 0)
+            return 0;
+        count -= num_sectors;
+        start += num_sectors;
+        offset += num_sectors * drivep->sector_size;
+    }
+
+    if (req->rq_cmd == READ)            /* scatter DMASEG into buffers */
+        merged_copy(req, READ);
+    return 1;
+}
+#endif
+
 static void do_bioshd_request(void)
 {
     struct drive_infot *drivep;
@@ -722,13 +893,20 @@ next_block:
         }
         start += hd[minor].start_sect;
 
+#ifdef CONFIG_ASYNCIO
+        if (req->rq_merge) {
+            end_request(do_merged_readwrite(drivep, start, req));
+            continue;
+        }
+#endif
         buf = req->rq_buffer;
         while (count > 0) {
             int num_sectors = 0;
 #ifdef CONFIG_TRACK_CACHE
             if (drivep - drive_info >= DRIVE_FD0) {
                 /* first try reading track cache*/
-                num_sectors = do_cache_read(drivep, start, buf, req->rq_seg, req->rq_cmd);
+                num_sectors = do_cache_read(drivep, start, buf, req->rq_seg, req->rq_cmd,
+                    count);
             }
             if (!num_sectors)
 #endif
@@ -745,8 +923,8 @@ next_block:
             start += num_sectors;
             buf += num_sectors * drivep->sector_size;
         }
-        debug_bios("cache: hits %u total %u %lu%%\n", cache_hits, cache_tries,
-            (long)cache_hits * 100L / cache_tries);
+        debug_bios("cache: hits %lu total %lu %lu%%\n", kstat.track_hits, kstat.track_tries,
+            kstat.track_hits * 100L / kstat.track_tries);
 
         /* satisfied that request */
         end_request(1);
@@ -19,6 +19,9 @@ struct request {
     ramdesc_t rq_seg;           /* L1 or L2 ext/xms buffer segment */
     struct buffer_head *rq_bh;  /* system buffer head for notifications and locking */
     struct request *rq_next;    /* next request, used when async I/O */
+#ifdef CONFIG_ASYNCIO
+    struct request *rq_merge;   /* next buffer (segment) of a merged request */
+#endif
     int rq_errors;              /* only used by direct floppy driver */
 };
 
@@ -39,6 +42,9 @@ struct request {
 struct blk_dev_struct {
     void (*request_fn) ();
     struct request *current_request;
+#ifdef CONFIG_ASYNCIO
+    unsigned int max_merge;     /* max bytes in a merged request, 0 = no merging */
+#endif
 };
 
 extern struct blk_dev_struct blk_dev[MAX_BLKDEV];
@@ -120,10 +126,16 @@ static void end_request(int uptodate)
             req->rq_dev, req->rq_sector);
     }
 
-#ifdef MULTI_BH
-    int count = BLOCK_SIZE / get_sector_size(req->rq_dev);
-    req->rq_nr_sectors -= count;
-    req->rq_sector += count;
+#ifdef CONFIG_ASYNCIO
+    /* complete every buffer merged into this request */
+    struct request *mreq, *next;
+    for (mreq = req->rq_merge; mreq; mreq = next) {
+        next = mreq->rq_merge;
+        bh = mreq->rq_bh;
+        mark_buffer_uptodate(bh, uptodate);
+        unlock_buffer(bh);
+        mreq->rq_status = RQ_INACTIVE;
+    }
 #endif
 
     bh = req->rq_bh;
@@ -298,6 +298,17 @@ static unsigned char seek_track;
 static unsigned char current_track = NO_TRACK;
 static unsigned char command;
 static unsigned char fdc_version;
+static unsigned int rq_done;            /* sectors of CURRENT already transferred */
+static unsigned int nr_sectors;         /* sectors in current FDC command */
+static char *dma_offset;                /* DMASEG offset of merged or buffered transfer */
+static char use_dmaseg;                 /* transfer staged through DMASEG */
+static char use_bounce;                 /* transfer staged through tmp_floppy_area */
+
+#ifdef CONFIG_ASYNCIO
+#define rq_merged(req)  ((req)->rq_merge != NULL)
+#else
+#define rq_merged(req)  0
+#endif
 static struct inode *open_inode;        /* to reset inode->i_size after probe */
 
 static void DFPROC floppy_ready(void);
@@ -439,9 +450,50 @@ static void floppy_off(int nr)
 void request_done(int uptodate)
 {
     del_timer(&fd_timeout);
+    rq_done = 0;
     end_request(uptodate);
 }
 
+/*
+ * Sectors in the track buffer for the current head. If the sector count
+ * is odd, head 0 also holds head 1 sector 1 so that it ends on a full block.
+ */
+static unsigned int DFPROC track_sectors(void)
+{
+    return floppy->sect + ((floppy->sect & 1) && !head);
+}
+
+static int DFPROC track_buffered(void)
+{
+    return ((seek_track << 1) + head) == buffer_track && current_drive == buffer_drive;
+}
+
+/*
+ * Copy the nr_sectors of the current FDC command between DMASEG and the
+ * request buffers. A merged request has one buffer per block, chained
+ * through rq_merge.
+ */
+static void DFPROC dma_copy(char *dmaoff, int todma)
+{
+    struct request *req;
+    unsigned int s, n, i;
+    char *buf;
+
+    for (s = rq_done, n = nr_sectors; n; n--, s++, dmaoff += 512) {
+        req = CURRENT;
+#ifdef CONFIG_ASYNCIO
+        for (i = s / (BLOCK_SIZE/512); i; i--)
+            req = req->rq_merge;
+#endif
+        i = s & (BLOCK_SIZE/512 - 1);
+        buf = req->rq_buffer + (i << 9);
+        if (todma)
+            xms_fmemcpyw(dmaoff, DMASEG, buf, req->rq_seg, 512/2);
+        else
+            xms_fmemcpyw(buf, req->rq_seg, dmaoff, DMASEG, 512/2);
+    }
+}
+
 /* The IBM PC can perform DMA operations by using the DMA chip.  To use it,
  * the DMA (Direct Memory Access) chip is loaded with the 20-bit memory address
  * to be read from or written to, the byte count minus 1, and a read or write
@@ -461,32 +513,48 @@ static void DFPROC setup_DMA(void)
     struct request *req = CURRENT;
     unsigned int count, physaddr;
     unsigned long dma_addr;
+    char *buf;
     int use_xms;
 
-#pragma GCC diagnostic ignored "-Wshift-count-overflow"
-    use_xms = req->rq_seg >> 16; /* will be nonzero only if XMS configured & XMS buffer */
-    physaddr = (req->rq_seg << 4) + (unsigned int)req->rq_buffer;
-
-    /* FIXME req->rq_nr_sectors will be 0 for TLVC only */
-    count = req->rq_nr_sectors? (unsigned)req->rq_nr_sectors << 9: BLOCK_SIZE;
-    if (use_xms || (physaddr + count) < physaddr)
-        dma_addr = LAST_DMA_ADDR + 1;   /* force use of bounce buffer */
-    else
-        dma_addr = _MK_LINADDR(req->rq_seg, req->rq_buffer);
-
     DEBUG("setupDMA ");
 
+    count = nr_sectors << 9;
+    use_dmaseg = use_bounce = 0;
     if (read_track) {   /* mark buffer-track bad, in case all this fails.. */
         buffer_drive = buffer_track = -1;
-        count = floppy->sect << 9;      /* sects/trk (one side) times 512 */
-        if (floppy->sect & 1 && !head)
-            count += 512; /* add one if head=0 && sector count is odd */
+        count = track_sectors() << 9;
         dma_addr = _MK_LINADDR(DMASEG, 0);
-    } else if (dma_addr >= LAST_DMA_ADDR) {
-        dma_addr = _MK_LINADDR(kernel_ds, tmp_floppy_area); /* use bounce buffer */
-        if (command == FD_WRITE) {
-            xms_fmemcpyw(tmp_floppy_area, kernel_ds, CURRENT->rq_buffer,
-                CURRENT->rq_seg, BLOCK_SIZE/2);
+        use_dmaseg = 1;
+        dma_offset = (char *)(sector << 9);
+    } else if (rq_merged(req) || (command == FD_WRITE && track_buffered())) {
+        /*
+         * Merged requests are transferred through DMASEG, at their offset
+         * in the track buffer so that writes keep a buffered track current.
+         */
+        use_dmaseg = 1;
+        dma_offset = (char *)(sector << 9);
+        if (sector + nr_sectors > (DMASEGSZ >> 9))
+            dma_offset = 0;
+        if (!track_buffered() || dma_offset != (char *)(sector << 9))
+            buffer_drive = buffer_track = -1;
+        if (command == FD_WRITE)
+            dma_copy(dma_offset, 1);
+        dma_addr = _MK_LINADDR(DMASEG, dma_offset);
+    } else {
+        buf = req->rq_buffer + (rq_done << 9);
+#pragma GCC diagnostic ignored "-Wshift-count-overflow"
+        use_xms = req->rq_seg >> 16; /* will be nonzero only if XMS configured & XMS buffer */
+        physaddr = (req->rq_seg << 4) + (unsigned int)buf;
+
+        if (use_xms || (physaddr + count) < physaddr)
+            dma_addr = LAST_DMA_ADDR + 1;   /* force use of bounce buffer */
+        else
+            dma_addr = _MK_LINADDR(req->rq_seg, buf);
+        if (dma_addr >= LAST_DMA_ADDR) {
+            dma_addr = _MK_LINADDR(kernel_ds, tmp_floppy_area); /* use bounce buffer */
+            use_bounce = 1;
+            if (command == FD_WRITE)
+                xms_fmemcpyw(tmp_floppy_area, kernel_ds, buf, req->rq_seg, count >> 1);
         }
     }
     DEBUG("%d/%lx;", count, dma_addr);
@@ -650,7 +718,6 @@ static void DFPROC tell_sector(int nr)
  */
 static void rw_interrupt(void)
 {
-    unsigned char *buffer_area;
     int nr, bad;
 
     nr = result();
@@ -723,22 +790,21 @@ static void rw_interrupt(void)
         /* This encoding is ugly, should use block-start, block-end instead */
         buffer_track = (seek_track << 1) + head;
         buffer_drive = current_drive;
-        buffer_area = (unsigned char *)(sector << 9);
-        DEBUG("rd:%04x:%08lx->%04x:%04x;", DMASEG, buffer_area,
-                (unsigned long)CURRENT->rq_seg, CURRENT->rq_buffer);
-        xms_fmemcpyw(CURRENT->rq_buffer, CURRENT->rq_seg, buffer_area,
-            DMASEG, BLOCK_SIZE/2);
-    } else if (command == FD_READ 
-#ifndef CONFIG_FS_XMS_BUFFER
-           && _MK_LINADDR(CURRENT->rq_seg, CURRENT->rq_buffer) >= LAST_DMA_ADDR
-#endif
-                                    ) {
-        /* if the dest buffer is out of reach for DMA (always the case if using
-         * XMS buffers) we need to read/write via the bounce buffer */
-        xms_fmemcpyw(CURRENT->rq_buffer, CURRENT->rq_seg, tmp_floppy_area,
-            kernel_ds, BLOCK_SIZE/2);
-        printk("fd: illegal buffer usage, rq_buffer %04x:%04x\n",
-            CURRENT->rq_seg, CURRENT->rq_buffer);
+    }
+    if (command == FD_READ) {
+        if (use_dmaseg) {
+            DEBUG("rd:%04x:%04x;", DMASEG, dma_offset);
+            dma_copy(dma_offset, 0);
+        } else if (use_bounce) {
+            /* the dest buffer is out of reach for DMA, always the case with XMS */
+            xms_fmemcpyw(CURRENT->rq_buffer + (rq_done << 9), CURRENT->rq_seg,
+                tmp_floppy_area, kernel_ds, nr_sectors << 8);
+        }
+    }
+    rq_done += nr_sectors;
+    if (rq_done < CURRENT->rq_nr_sectors) {
+        redo_fd_request();      /* continue request on next track */
+        return;
     }
     request_done(1);
     //printk("RQOK;");
@@ -1176,12 +1242,18 @@ static void DFPROC redo_fd_request(void)
         request_done(0);
         goto repeat;
     }
+    start += rq_done;
     sector = start % floppy->sect;
     tmp = start / floppy->sect;
     head = tmp % floppy->head;
     track = tmp / floppy->head;
     seek_track = track << floppy->stretch;
     command = (req->rq_cmd == READ)? FD_READ: FD_WRITE;
+
+    /* transfer up to the end of the track, the rest of a merged request follows */
+    nr_sectors = track_sectors() - sector;
+    if (nr_sectors > req->rq_nr_sectors - rq_done)
+        nr_sectors = req->rq_nr_sectors - rq_done;
     DEBUG("df%d: %s sector %d CHS %d/%d/%d max %d stretch %d seek %d\n",
         DEVICE_NR(req->rq_dev), req->rq_cmd==READ? "read": "write",
         start, track, head, sector, floppy->sect, floppy->stretch, seek_track);
@@ -1193,21 +1265,19 @@ static void DFPROC redo_fd_request(void)
 
     DEBUG("prep %d|%d,%d|%d-", buffer_track, seek_track, buffer_drive, current_drive);
 
-    if ((((seek_track << 1) + head) == buffer_track) && (current_drive == buffer_drive)) {
-        /* Requested block is in the buffer. If reading, go get it.
-         * If the sector count is odd, we buffer sectors+1 when head=0 to get an even
-         * number of sectors (full blocks). When head=1 we read the entire track
-         * and ignore the first sector.
+    if (command == FD_READ && track_buffered()) {
+        /* Requested sectors are in the buffer. If the sector count is odd,
+         * we buffer sectors+1 when head=0 to get an even number of sectors
+         * (full blocks). When head=1 we read the entire track and ignore
+         * the first sector.
          */
         DEBUG("bufrd chs %d/%d/%d\n", seek_track, head, sector);
-        char *buf_ptr = (char *) (sector << 9);
-        if (command == FD_READ) {       /* requested data is in buffer */
-            xms_fmemcpyw(req->rq_buffer, req->rq_seg, buf_ptr, DMASEG, BLOCK_SIZE/2);
+        dma_copy((char *)(sector << 9), 0);
+        rq_done += nr_sectors;
+        if (rq_done >= req->rq_nr_sectors)
             request_done(1);
-            goto repeat;
-        } else if (command == FD_WRITE) /* update track buffer */
-            xms_fmemcpyw(buf_ptr, DMASEG, req->rq_buffer, req->rq_seg, BLOCK_SIZE/2);
-    } 
+        goto repeat;
+    }
 
     if (seek_track != current_track)
         seek = 1;
@@ -1215,9 +1285,24 @@ static void DFPROC redo_fd_request(void)
     floppy_on(current_drive);
 }
 
+/*
+ * Called by add_request to start I/O after the first request is queued.
+ * The request is completed by the floppy interrupt and timer callbacks.
+ * With async I/O we return at once and the caller sleeps in wait_on_buffer
+ * until end_request unlocks the buffer, letting other tasks run meanwhile.
+ * Otherwise wait_on_buffer doesn't sleep, so wait here for the queue to empty.
+ */
 void do_fd_request(void)
 {
     redo_fd_request();
+#ifndef CONFIG_ASYNCIO
+    clr_irq();
+    while (CURRENT) {
+        idle_halt_sti();
+        clr_irq();
+    }
+    set_irq();
+#endif
 }
 
 static int fd_ioctl(struct inode *inode, struct file *filp, unsigned int cmd,
@@ -1460,5 +1545,8 @@ void INITPROC floppy_init(void)
         return;
     }
     blk_dev[MAJOR_NR].request_fn = DEVICE_REQUEST;
+#ifdef CONFIG_ASYNCIO
+    blk_dev[MAJOR_NR].max_merge = DMASEGSZ;     /* merged requests staged in DMASEG */
+#endif
     config_types();
 }
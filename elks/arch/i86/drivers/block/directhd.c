@@ -1,5 +1,6 @@
 /*
  * NOTE: experimental direct hd driver - NOT WORKING
+ * Interrupt driven on IRQ 14 for first IDE channel only.
  *
  * directhd driver for ELKS kernel
  * Copyright (C) 1998 Blaz Antonic
@@ -9,13 +10,18 @@
 #include <linuxmt/major.h>
 #include <linuxmt/genhd.h>
 #include <linuxmt/fs.h>
+#include <linuxmt/errno.h>
 #include <linuxmt/string.h>
 #include <linuxmt/mm.h>
 #include <linuxmt/directhd.h>
 #include <linuxmt/debug.h>
 
+#include <linuxmt/memory.h>
+
 #include <arch/hdreg.h>
 #include <arch/io.h>
+#include <arch/irq.h>
+#include <arch/ports.h>
 #include <arch/segment.h>
 
 /* maybe we should have word-wide input here instead of byte-wide ? */
@@ -24,9 +30,17 @@
 
 #define WAITING(port) (STATUS(port) & 0x80) == 0x80
 
-/* use asm insw/outsw instead of C version */
-/* asm versions should work on 8088/86, but only with CONFIG_PC_XT */
-/* #define USE_ASM */
+/* PIO data transfer to or from a far buffer, see directhd-asm.S */
+void hd_insw(unsigned int port, char *buf, seg_t seg, unsigned int count);
+void hd_outsw(unsigned int port, char *buf, seg_t seg, unsigned int count);
+extern int hd_fastio;		/* use REP INSW/OUTSW, 80186 or NEC V20 and up */
+
+/* max sectors per interrupt in READ/WRITE MULTIPLE mode */
+#define HD_MAX_MULT	16
+
+/* max bytes in a merged request, transferred sector by sector from
+ * the chained buffers so no bounce buffer size applies */
+#define HD_MAX_MERGE	(8 * BLOCK_SIZE)
 
 /* uncomment this to include debugging code .. this increases size of driver */
 #define USE_DEBUG_CODE
@@ -57,14 +71,12 @@ static int io_ports[2] = { HD1_PORT, HD2_PORT };
 
 static int directhd_initialized = 0;
 
-static struct drive_infot {
-    int cylinders;
-    int sectors;
-    int heads;
-} drive_info[4] = { 0, };	/* preset to 0 */
+static struct drive_infot drive_info[4];	/* preset to 0 */
+static unsigned char hd_mult[4];	/* sectors per interrupt, >1 if multiple mode set */
 
 static struct hd_struct hd[4 << 6];
 static void directhd_geninit();
+static void hd_interrupt(int irq, struct pt_regs *regs);
 
 static struct gendisk directhd_gendisk = {
     MAJOR_NR,			/* major number */
@@ -96,101 +108,6 @@ void directhd_geninit(void)
     return;
 }
 
-#ifndef USE_ASM
-
-void insw(unsigned int port,unsigned int *buffer,int count)
-{
-    int i;
-
-    for (i = 0; i < count / 2; i++)
-	buffer[i] = inw(port);
-    return;
-}
-
-#else
-
-/* this _should_ work on an 8088/86 now, but I haven't tested it yet */
-
-void insw(unsigned int port,unsigned int *buffer,int count)
-{
-#asm
-	push	bp
-	mov	bp, sp
-	push	cx
-	push	di
-	push	dx
-	mov	dx, [bp + 04]
-	mov	di, [bp + 06]
-	mov	cx, [bp + 08]
-	shr	cx, 1
-	cld
-#ifndef CONFIG_PC_XT
-	repz
-	insw
-#else
-			/* this should work on an 8088 */
-dhd_insw_loop:
-	in	ax, dx
-	stosw
-	loop	dhd_insw_loop
-#endif
-	pop	dx
-	pop	di
-	pop	cx
-	pop	bp
-#endasm
-}
-
-#endif
-
-#ifndef USE_ASM
-
-void outsw(unsigned int port,unsigned int *buffer,int count)
-{
-    int i;
-
-    for (i = 0; i < count / 2; i++)
-	outw(port, buffer[i]);
-    return;
-}
-
-#else
-
-/* the assembler version. Again, this should work,
- * but I haven't had a chance to test it yet.
- */
-
-void outsw(unsigned int port,unsigned int *buffer,int count)
-{
-#asm
-	push	bp
-	mov	bp, sp
-	push	cx
-	push	si
-	push	dx
-	mov	dx, [bp + 04]
-	mov	si, [bp + 06]
-	mov	cx, [bp + 08]
-	shr	cx, 1
-	cld
-#ifndef CONFIG_PC_XT
-	repz
-	outsw
-#else
-dhd_outsw_loop:		/* this should work on an 8088 */
-	lodsw
-	out	dx, ax
-	loop	dhd_outsw_loop
-#endif
-	pop	dx
-	pop	si
-	pop	cx
-	pop	bp
-#endasm
-}
-
-#endif
-
 #if 0				/* not used */
 
 void swap_order(unsigned char *buffer,int count)
@@ -251,6 +168,8 @@ int directhd_init(void)
      * (this explains why your computer was locking up after mentioning the
      * serial port, doesn't it? :-) -- Alastair Bridgewater */
     /* this should work now, IMO - Blaz Antonic */
+    hd_fastio = (SETUP_CPU_TYPE >= 2);	/* REP INSW/OUTSW on NEC V20 and 80186 up */
+
     for (drive = 0; drive < 2; drive++) {
 	/* send drive_ID command to drive */
 	out_hd(drive, 0, 0, 0, 0, DIRECTHD_DRIVE_ID);
@@ -280,7 +199,7 @@ int directhd_init(void)
 
 	/* get drive info */
 
-	insw(port, buffer, 512);
+	hd_insw(port, (char *)buffer, kernel_ds, 256);
 #if 0
 	swap_order(buffer, 512);
 #endif
@@ -328,6 +247,17 @@ int directhd_init(void)
 	    drive_info[drive].heads = buffer[0x6e / 2];
 	    drive_info[drive].sectors = buffer[0x70 / 2];
 
+	    /* use READ/WRITE MULTIPLE with the largest supported block size */
+	    hd_mult[drive] = 1;
+	    for (j = HD_MAX_MULT; j > (buffer[47] & 0xff); j >>= 1)
+		continue;
+	    if (j > 1) {
+		out_hd(drive, j, 0, 0, 0, WIN_SETMULT);
+		while (WAITING(port));
+		if (!(STATUS(port) & ERR_STAT))
+		    hd_mult[drive] = j;
+	    }
+
 	    hdcount++;
 	}
     }
@@ -344,7 +274,16 @@ int directhd_init(void)
 	return -1;
     }
 
+    if (request_irq(HD1_AT_IRQ, hd_interrupt, INT_GENERIC)) {
+	printk("athd: IRQ %d busy\n", HD1_AT_IRQ);
+	return -1;
+    }
+    outb_p(drive_info[0].heads > 8 ? 0x08 : 0x00, HD_CMD);	/* enable drive interrupts */
+
     blk_dev[MAJOR_NR].request_fn = DEVICE_REQUEST;
+#ifdef CONFIG_ASYNCIO
+    blk_dev[MAJOR_NR].max_merge = HD_MAX_MERGE;
+#endif
     if (gendisk_head == NULL) {
 	directhd_gendisk.next = gendisk_head;
 	gendisk_head = &directhd_gendisk;
@@ -360,10 +299,10 @@ int directhd_init(void)
     for (i = 0; i < 4; i++)
 	/* sanity check */
 	if (drive_info[i].heads != 0) {
-	    printk("athd: /dev/dhd%c: %d heads, %d cylinders, %d sectors\n",
+	    printk("athd: /dev/dhd%c: %d heads, %d cylinders, %d sectors, %d multiple\n",
 		   (i + 'a'),
 		   drive_info[i].heads,
-		   drive_info[i].cylinders, drive_info[i].sectors);
+		   drive_info[i].cylinders, drive_info[i].sectors, hd_mult[i]);
 	}
 
     directhd_initialized = 1;
@@ -441,26 +380,134 @@ static void directhd_release(struct inode *inode, struct file *filp)
     return;
 }
 
-void do_directhd_request(void)
+/*
+ * Interrupt driven request processing. do_directhd_request starts the
+ * first queued request and returns; each sector is then transferred from
+ * the controller interrupt, which ends the request and starts the next one.
+ * With CONFIG_ASYNCIO the caller sleeps in wait_on_buffer meanwhile.
+ */
+static int hd_active;		/* command in progress, interrupt expected */
+static int hd_drive;		/* drive of current request */
+static int hd_port;		/* I/O port of current request */
+static sector_t hd_start;	/* next absolute sector */
+static unsigned int hd_count;	/* sectors left in request */
+static unsigned int hd_pass;	/* sectors left in current command */
+static struct request *hd_rq;	/* request buffer being transferred, may be merged */
+static char *hd_buff;		/* next sector in hd_rq buffer */
+#ifdef CONFIG_FS_XMS_BUFFER
+static unsigned int hd_secbuf[256];	/* sector bounce buffer for XMS buffers */
+#endif
+
+static void hd_start_request(void);
+
+static void hd_end(int uptodate)
+{
+    hd_active = 0;
+    end_request(uptodate);
+    hd_start_request();
+}
+
+static int hd_error(char *msg)
+{
+    printk("athd: %s status: 0x%x error: 0x%x\n", msg, STATUS(hd_port),
+	   ERROR(hd_port));
+    hd_end(0);
+    return 1;
+}
+
+/* wait for DRQ to write a block, returns nonzero on error */
+static int hd_wait_drq(void)
+{
+    unsigned int status;
+
+    while ((status = STATUS(hd_port)) & BUSY_STAT)
+	;
+    if (status & ERR_STAT)
+	return hd_error("write");
+    while (!(STATUS(hd_port) & DRQ_STAT))
+	;
+    return 0;
+}
+
+/*
+ * Transfer the next DRQ block of sectors directly to or from the request
+ * buffers, which may be far L2 buffers. Only XMS buffers use a bounce copy.
+ * Returns the number of sectors transferred.
+ */
+static unsigned int hd_transfer(int cmd)
+{
+    unsigned int n, i;
+
+    n = hd_mult[hd_drive];
+    if (n > hd_pass)
+	n = hd_pass;
+    for (i = n; i; i--) {
+#ifdef CONFIG_FS_XMS_BUFFER
+	if (hd_rq->rq_seg >> 16) {
+	    if (cmd == READ) {
+		hd_insw(hd_port, (char *)hd_secbuf, kernel_ds, 256);
+		xms_fmemcpyw(hd_buff, hd_rq->rq_seg, hd_secbuf, kernel_ds, 256);
+	    } else {
+		xms_fmemcpyw(hd_secbuf, kernel_ds, hd_buff, hd_rq->rq_seg, 256);
+		hd_outsw(hd_port, (char *)hd_secbuf, kernel_ds, 256);
+	    }
+	} else
+#endif
+	if (cmd == READ)
+	    hd_insw(hd_port, hd_buff, (seg_t)hd_rq->rq_seg, 256);
+	else
+	    hd_outsw(hd_port, hd_buff, (seg_t)hd_rq->rq_seg, 256);
+
+	hd_buff += 512;
+#ifdef CONFIG_ASYNCIO
+	if (hd_buff == hd_rq->rq_buffer + BLOCK_SIZE && hd_rq->rq_merge) {
+	    hd_rq = hd_rq->rq_merge;	/* next buffer of merged request */
+	    hd_buff = hd_rq->rq_buffer;
+	}
+#endif
+    }
+    return n;
+}
+
+/* issue a read or write of the sectors left on the current track */
+static void hd_command(void)
 {
-    sector_t count;		/* # of sectors to read/write */
-    int this_pass;		/* # of sectors read/written */
-    sector_t start;		/* first sector */
-    char *buff;			/* max_sect * sector_size, 63 * 512 bytes; it seems that all requests are only 1024 bytes */
-    short sector;		/* 1 .. 63 ? */
-    short cylinder;		/* 0 .. 1024 and maybe more */
-    short head;			/* 0 .. 16 */
-    unsigned int tmp;
+    struct drive_infot *di = &drive_info[hd_drive];
+    unsigned int sector, head, cylinder, tmp, cmd;
+
+    sector = (hd_start % di->sectors) + 1;
+    tmp = hd_start / di->sectors;
+    head = tmp % di->heads;
+    cylinder = tmp / di->heads;
+    hd_pass = di->sectors - sector + 1;
+    if (hd_count < hd_pass)
+	hd_pass = hd_count;
+
+#ifdef USE_DEBUG_CODE
+    printk("athd: drive: %d cylinder: %d head: %d sector: %d count: %d\n",
+	   hd_drive, cylinder, head, sector, hd_pass);
+#endif
+
+    while (WAITING(hd_port));
+    hd_active = 1;
+    if (CURRENT->rq_cmd == READ) {
+	cmd = (hd_mult[hd_drive] > 1)? WIN_MULTREAD: DIRECTHD_READ;
+	out_hd(hd_drive, hd_pass, sector, head, cylinder, cmd);
+	return;
+    }
+    /* first block is written here, the others on each interrupt */
+    cmd = (hd_mult[hd_drive] > 1)? WIN_MULTWRITE: DIRECTHD_WRITE;
+    out_hd(hd_drive, hd_pass, sector, head, cylinder, cmd);
+    if (!hd_wait_drq())
+	hd_transfer(WRITE);
+}
+
+static void hd_start_request(void)
+{
+    struct request *req;
     int minor;
-    int drive;			/* 0 .. 3 */
-    unsigned char i;		/* 0 .. (sectors per track - 1) .. 62 or less */
-    unsigned char j;		/* 0 .. 255 */
-    int port;
-
-    while (1) {			/* process HD requests */
-	struct request *req = CURRENT;
-	if (!req)
-	    return;
+
+    while ((req = CURRENT) != NULL) {
 	CHECK_REQUEST(req);
 
 	if (directhd_initialized != 1) {
@@ -469,151 +516,84 @@ void do_directhd_request(void)
 	}
 
 	minor = MINOR(req->rq_dev);
-	drive = minor >> 6;
+	hd_drive = minor >> 6;
 
 	/* check if drive exists */
-	if (drive > 3 || drive < 0 || drive_info[drive].heads == 0) {
+	if (hd_drive > 3 || drive_info[hd_drive].heads == 0) {
 	    printk("Non-existent drive\n");
 	    end_request(0);
 	    continue;
 	}
 
-	count = req->rq_nr_sectors;
-	start = req->rq_sector;
-	buff = req->rq_buffer;
-
-	/* safety check should be here */
-
-	if (hd[minor].start_sect == -1 || hd[minor].nr_sects < start) {
+	if (hd[minor].start_sect == -1 || hd[minor].nr_sects < req->rq_sector) {
 	    printk("Bad partition start\n");
 	    end_request(0);
 	    continue;
 	}
 
-	start += hd[minor].start_sect;
-
-	while (count > 0) {
-	    sector = (start % drive_info[drive].sectors) + 1;
-	    tmp = start / drive_info[drive].sectors;
-	    head = tmp % drive_info[drive].heads;
-	    cylinder = tmp / drive_info[drive].heads;
-
-#if 0
-	    this_pass = count;	/* this is redundant */
-#endif
-	    if (count <= (drive_info[drive].sectors - sector + 1))
-		this_pass = count;
-	    else
-		this_pass = drive_info[drive].sectors - sector + 1;
-
-#ifdef USE_DEBUG_CODE
-	    printk
-		("athd: drive: %d cylinder: %d head: %d sector: %d start: %d\n",
-		 drive, cylinder, head, sector, start);
-#endif
-
-	    port = io_ports[drive / 2];
-
-	    if (req->rq_cmd == READ) {
-#ifdef USE_DEBUG_CODE
-		printk("athd: drive: %d this_pass: %d sector: %d head: %d\n", drive, this_pass, sector, head);
-		printk("athd: cyl: %d start: %ld tmp: %d count: %ld di[d].s: %d di[0].s: %d\n", cylinder, start, tmp, count, drive_info[drive].sectors, drive_info[0].sectors);
-#endif
-		/* read to buffer */
-		while (WAITING(port));
-		/* send drive parameters */
-		out_hd(drive, this_pass, sector, head, cylinder,
-		       DIRECTHD_READ);
-
-		/* wait */
-		while (WAITING(port)) {
-#ifdef USE_DEBUG_CODE
-		    //printk("athd: statusa: 0x%x\n", STATUS(port));
-#endif
-		}
-		if ((STATUS(port) & 1) == 1) {
-
-		    /* something went wrong */
-		    printk("athd: status: 0x%x error: 0x%x\n", STATUS(port),
-			   ERROR(port));
-
-		    break;
-#if 0
- 		    end_request(0);
-#endif
-		}
-
-		tmp = 0x00;
-		while ((tmp & 0x08) != 0x08) {
-		    if ((tmp & 1) == 1) {
-
-			printk("athd: status: 0x%x error: 0x%x\n",
-			       STATUS(port), ERROR(port));
-
-			break;
-			end_request(0);
-		    } else {
-			tmp = STATUS(port);
-#ifdef USE_DEBUG_CODE
-			//printk("athd: statusb: 0x%x\n", tmp);
-#endif
-		    }
-		}
-
-
-		/* read this_pass * 512 bytes, which is 63 * 512 b max. */
-		insw(port, buff, this_pass * 512);
-	    }
-	    if (req->rq_cmd == WRITE) {
-		/* write from buffer */
-		while (WAITING(port));
-		/* send drive parameters */
-		out_hd(drive, this_pass, sector, head, cylinder,
-		       DIRECTHD_WRITE);
-
-		/* wait */
-		while (WAITING(port)) {
-#ifdef USE_DEBUG_CODE
-		    //printk("athd: statusa: 0x%x\n", STATUS(port));
-#endif
-		}
-		if ((STATUS(port) & 1) == 1) {
-
-		    /* something went wrong */
-		    printk("athd: status: 0x%x error: 0x%x\n", STATUS(port),
-			   ERROR(port));
-
-		    break;
-#if 0
-		    end_request(0);
-#endif
-		}
+	hd_port = io_ports[hd_drive / 2];
+	hd_start = req->rq_sector + hd[minor].start_sect;
+	hd_count = req->rq_nr_sectors;
+	hd_rq = req;
+	hd_buff = req->rq_buffer;
+	hd_command();
+	return;
+    }
+}
 
-		tmp = 0x00;
-		while ((tmp & 0x08) != 0x08) {
-		    if ((tmp & 1) == 1) {
+static void hd_interrupt(int irq, struct pt_regs *regs)
+{
+    unsigned int status, n;
 
-			printk("athd: status: 0x%x error: 0x%x\n",
-			       STATUS(port), ERROR(port));
+    if (!hd_active) {
+	STATUS(HD1_PORT);	/* acknowledge unexpected interrupt */
+	return;
+    }
+    status = STATUS(hd_port);	/* also acknowledges interrupt */
+    if (status & (ERR_STAT | WRERR_STAT)) {
+	hd_error(CURRENT->rq_cmd == READ? "read": "write");
+	return;
+    }
 
-			break;
-			end_request(0);
-		    } else {
-			tmp = STATUS(port);
-#ifdef USE_DEBUG_CODE
-			//printk("athd: statusb: 0x%x\n", tmp);
-#endif
-		    }
-		}
+    if (CURRENT->rq_cmd == READ) {
+	if (!(status & DRQ_STAT)) {
+	    hd_error("read");
+	    return;
+	}
+	n = hd_transfer(READ);
+    } else {
+	/* interrupt after each block written */
+	n = hd_mult[hd_drive];
+	if (n > hd_pass)
+	    n = hd_pass;
+    }
 
-		outsw(port, buff, this_pass * 512);
-	    }
+    hd_start += n;
+    hd_count -= n;
+    hd_pass -= n;
+    if (hd_pass) {
+	if (CURRENT->rq_cmd == WRITE && !hd_wait_drq())
+	    hd_transfer(WRITE);
+	return;
+    }
+    if (hd_count)
+	hd_command();		/* continue on next track */
+    else
+	hd_end(1);
+}
 
-	    count -= this_pass;
-	    start += this_pass;
-	    buff += this_pass * 512;
-	}
-	end_request(1);
+/* called by add_request to start I/O after first request added */
+void do_directhd_request(void)
+{
+    if (!hd_active)
+	hd_start_request();
+#ifndef CONFIG_ASYNCIO
+    /* wait_on_buffer doesn't sleep, so wait here until all I/O is done */
+    clr_irq();
+    while (CURRENT) {
+	idle_halt_sti();
+	clr_irq();
     }
-    return;
+    set_irq();
+#endif
 }
@@ -23,6 +23,7 @@
 #include <linuxmt/kernel.h>
 #include <linuxmt/major.h>
 #include <linuxmt/init.h>
+#include <linuxmt/sched.h>
 #include <linuxmt/string.h>
 #include <linuxmt/memory.h>
 #include <linuxmt/devnum.h>
@@ -36,13 +37,16 @@ void INITPROC device_init(void)
 {
     register struct gendisk *p;
 
-    chr_dev_init();
-    blk_dev_init();
+    INITCALL(chr_dev_init());
+    INITCALL(blk_dev_init());
 
     set_irq();
 
-    for (p = gendisk_head; p; p = p->next)
+    for (p = gendisk_head; p; p = p->next) {
+        jiff_t start = jiffies;
         setup_dev(p);
+        init_profile(p->major_name, start);
+    }
 
 #if defined(CONFIG_BLK_DEV_BFD) || defined(CONFIG_BLK_DEV_BHD) || defined(CONFIG_BLK_DEV_FD)
     /*
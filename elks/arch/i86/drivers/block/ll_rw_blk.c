@@ -21,6 +21,7 @@
 #include <linuxmt/mm.h>
 #include <linuxmt/ioctl.h>
 #include <linuxmt/debug.h>
+#include <linuxmt/mem.h>
 
 #include <arch/system.h>
 #include <arch/io.h>
@@ -135,6 +136,35 @@ static struct request *get_request_wait(int n, kdev_t dev)
 #endif
 }
 
+#ifdef CONFIG_ASYNCIO
+/*
+ * Try to merge req onto the end of a queued request for the same device
+ * and command whose sectors immediately precede it. The merged buffers are
+ * chained through rq_merge and transferred by the driver as one request.
+ * The head request may already be in progress, so it is never merged into.
+ */
+static int merge_request(struct request *tmp, struct request *req, unsigned int max)
+{
+    struct request *last;
+    unsigned int sector_size = BLOCK_SIZE / req->rq_nr_sectors;
+
+    while ((tmp = tmp->rq_next) != NULL) {
+        if (tmp->rq_dev == req->rq_dev && tmp->rq_cmd == req->rq_cmd &&
+            tmp->rq_sector + tmp->rq_nr_sectors == req->rq_sector &&
+            (tmp->rq_nr_sectors + req->rq_nr_sectors) * sector_size <= max) {
+            for (last = tmp; last->rq_merge; last = last->rq_merge)
+                continue;
+            last->rq_merge = req;
+            tmp->rq_nr_sectors += req->rq_nr_sectors;
+            debug_blk("merge: sector %lu now %u sectors\n", tmp->rq_sector,
+                tmp->rq_nr_sectors);
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
+
 /*
  * add-request adds a request to the linked list.
  * It disables interrupts so that it can muck with the
@@ -153,6 +183,10 @@ static void add_request(struct blk_dev_struct *dev, struct request *req)
     }
     else {
 #ifdef CONFIG_ASYNCIO
+        if (dev->max_merge && merge_request(tmp, req, dev->max_merge)) {
+            set_irq();
+            return;
+        }
         for (; tmp->rq_next; tmp = tmp->rq_next) {
             if ((IN_ORDER(tmp, req) ||
                 !IN_ORDER(tmp, tmp->rq_next)) && IN_ORDER(req, tmp->rq_next))
@@ -184,9 +218,11 @@ static void make_request(unsigned short major, int rw, struct buffer_head *bh)
     max_req = NR_REQUEST;       /* reads take precedence */
     switch (rw) {
     case READ:
+        kstat.blk_reads[major]++;
         break;
 
     case WRITE:
+        kstat.blk_writes[major]++;
 #if NR_REQUEST != 1             /* protect max_req from being 0 below */
         /* We don't allow the write-requests to fill up the
          * queue completely:  we want some room for reads,
@@ -222,6 +258,9 @@ static void make_request(unsigned short major, int rw, struct buffer_head *bh)
     req->rq_bh = bh;
     req->rq_errors = 0;
     req->rq_next = NULL;
+#ifdef CONFIG_ASYNCIO
+    req->rq_merge = NULL;
+#endif
     add_request(&blk_dev[major], req);
 }
 
@@ -239,19 +278,22 @@ void ll_rw_blk(int rw, struct buffer_head *bh)
     make_request(major, rw, bh);
 }
 
-#ifdef MULTI_BH
+#ifdef CONFIG_FS_READAHEAD
+#ifdef CONFIG_ASYNCIO
 /*
  * "plug" the device if there are no outstanding requests: this will
  * force the transfer to start only after we have put all the requests
- * on the list.
+ * on the list. Synchronous drivers complete each request from within
+ * add_request, so plugging is only possible with async I/O.
  */
 static void plug_device(struct blk_dev_struct *dev, struct request *plug)
 {
     flag_t flags;
 
     plug->rq_status = RQ_INACTIVE;
-    plug->cmd = -1;
-    plug->next = NULL;
+    plug->rq_dev = 0;           /* sorts before all requests in add_request */
+    plug->rq_sector = 0;
+    plug->rq_next = NULL;
     save_flags(flags);
     clr_irq();
     if (!dev->current_request)
@@ -262,29 +304,34 @@ static void plug_device(struct blk_dev_struct *dev, struct request *plug)
 /*
  * remove the plug and let it rip..
  */
-static void unplug_device(struct blk_dev_struct *dev)
+static void unplug_device(struct blk_dev_struct *dev, struct request *plug)
 {
-    register struct request *req;
-    unsigned int flags;
+    flag_t flags;
 
     save_flags(flags);
     clr_irq();
-    req = dev->current_request;
-    if (req && req->rq_status == RQ_INACTIVE && req->cmd == -1) {
-        dev->current_request = req->next;
-        (dev->request_fn) ();
+    if (dev->current_request == plug) {
+        dev->current_request = plug->rq_next;
+        if (dev->current_request)
+            (dev->request_fn) ();
     }
     restore_flags(flags);
 }
+#else
+#define plug_device(dev,plug)
+#define unplug_device(dev,plug)
+#endif
 
 /* This function can be used to request a number of buffers from a block
  * device. Currently the only restriction is that all buffers must belong
  * to the same device.
  */
-void ll_rw_block(int rw, int nr, register struct buffer_head **bh)
+void ll_rw_block(int rw, int nr, struct buffer_head **bh)
 {
     struct blk_dev_struct *dev;
+#ifdef CONFIG_ASYNCIO
     struct request plug;
+#endif
     unsigned int major;
     int i;
 
@@ -295,11 +342,11 @@ void ll_rw_block(int rw, int nr, register struct buffer_head **bh)
             return;
     }
     dev = NULL;
-    if ((major = MAJOR(buffer_dev(bh[0])) < MAX_BLKDEV)
+    if ((major = MAJOR(buffer_dev(bh[0]))) < MAX_BLKDEV)
         dev = blk_dev + major;
     if (!dev || !dev->request_fn) {
-        printk("ll_rw_block: Trying to read nonexistent block-device %s (%lu)\n",
-             kdevname(buffer_dev(bh[0])), buffer_blocknr(bh[0]));
+        printk("ll_rw_block: nonexistent block device %D (%lu)\n",
+             buffer_dev(bh[0]), buffer_blocknr(bh[0]));
         goto sorry;
     }
 
@@ -312,7 +359,8 @@ void ll_rw_block(int rw, int nr, register struct buffer_head **bh)
     for (i = 0; i < nr; i++)
         if (bh[i])
             make_request(major, rw, bh[i]);
-    unplug_device(dev);
+    if (nr > 1)
+        unplug_device(dev, &plug);
     return;
 
   sorry:
@@ -322,7 +370,7 @@ void ll_rw_block(int rw, int nr, register struct buffer_head **bh)
             mark_buffer_uptodate(bh[i], 0);
         }
 }
-#endif /* MULTI_BH */
+#endif /* CONFIG_FS_READAHEAD */
 
 void INITPROC blk_dev_init(void)
 {
@@ -22,6 +22,7 @@
 #include <linuxmt/errno.h>
 #include <linuxmt/mm.h>
 #include <linuxmt/fs.h>
+#include <linuxmt/memory.h>
 #include <linuxmt/debug.h>
 
 #define MAJOR_NR    RAM_MAJOR
@@ -34,12 +35,19 @@
 
 /* if sector size not 512, must implement IOCTL_BLK_GET_SECTOR_SIZE */
 #define RD_SECTOR_SIZE	512
+#define RD_SEG_SHIFT	7	/* 128 sectors per full ALLOC_SIZE segment*/
+#define RD_SEG_SECTORS	(1 << RD_SEG_SHIFT)
 typedef __u16 rd_sector_t;	/* sector number*/
 
 static struct {			/* ramdrive information*/
     int start;			/* starting memory segment*/
     int valid;			/* ramdisk data valid flag*/
     rd_sector_t size;		/* ramdisk size in 512 byte sectors*/
+    unsigned char index[MAX_SEGMENTS];	/* rd_segment[] of each 64k of ramdisk*/
+#ifdef CONFIG_FS_XMS_BUFFER
+    ramdesc_t xms;		/* XMS linear address or 0 if main memory*/
+    rd_sector_t xms_size;	/* XMS sectors allocated, kept for reuse as never freed*/
+#endif
 } drive_info[MAX_DRIVES] = {
 #if CONFIG_RAMDISK_SEGMENT
     {0, 1, CONFIG_RAMDISK_SECTORS}
@@ -69,6 +77,25 @@ static struct {			/* memory segments, max size ALLOC_SIZE paras (64k)*/
 static int rd_initialised = 0;
 static int access_count[MAX_DRIVES];
 
+/* precompute segment index of each 64k of ramdisk for O(1) sector lookup*/
+static void rd_build_index(int target)
+{
+    int i, n = 0;
+
+    for (i = drive_info[target].start; i != -1 && n < MAX_SEGMENTS; i = rd_segment[i].next)
+	drive_info[target].index[n++] = i;
+}
+
+/* memory descriptor of the 64k area holding sector*/
+static ramdesc_t rd_seg(int target, rd_sector_t sector)
+{
+#ifdef CONFIG_FS_XMS_BUFFER
+    if (drive_info[target].xms)
+	return drive_info[target].xms + ((long_t)(sector >> RD_SEG_SHIFT) << 16);
+#endif
+    return rd_segment[drive_info[target].index[sector >> RD_SEG_SHIFT]].seg;
+}
+
 static int rd_open(struct inode *inode, struct file *filp)
 {
     int target = DEVICE_NR(inode->i_rdev);
@@ -112,6 +139,10 @@ static int dealloc(int target)
     int i, j;
 
     i = drive_info[target].start;
+#ifdef CONFIG_FS_XMS_BUFFER
+    if (drive_info[target].xms)
+	i = -1;			/* XMS memory is kept for the next RDCREATE*/
+#endif
     debug("RD: dealloc target %d, index %d, size %d sectors\n",
 	   target, i, drive_info[target].size);
     while (i != -1 && rd_segment[i].sectors != 0) {
@@ -150,6 +181,30 @@ static int rd_ioctl(register struct inode *inode, struct file *file,
 	    return -EBUSY;
 
 	drive_info[target].size = 0;
+#ifdef CONFIG_FS_XMS_BUFFER
+	if (xms_enabled) {
+	    if (arg == 0 || arg > 32767)
+		return -EINVAL;
+	    if (drive_info[target].xms_size < arg * 2) {
+		drive_info[target].xms = xms_alloc((long_t)arg * 1024);
+		drive_info[target].xms_size = arg * 2;
+	    }
+	    drive_info[target].size = arg * 2;
+#ifndef CONFIG_FS_XMS_INT15	/* no INT 15 memset*/
+	    for (i = 0; i < drive_info[target].size; i += j) {
+		j = drive_info[target].size - i;
+		if (j > RD_SEG_SECTORS / 2)
+		    j = RD_SEG_SECTORS / 2;	/* clear 32k at a time*/
+		xms_fmemset((char *)((i & (RD_SEG_SECTORS - 1)) * RD_SECTOR_SIZE),
+		    rd_seg(target, i), 0, j * RD_SECTOR_SIZE);
+	    }
+#endif
+	    drive_info[target].valid = 1;
+	    debug("RD: ramdisk %d created in XMS at %lx sectors %d\n",
+		target, drive_info[target].xms, drive_info[target].size);
+	    return 0;
+	}
+#endif
 	k = -1;
 	for (i = 0; i <= (arg - 1) / ((ALLOC_SIZE / 1024) * PARA); i++) {
 		j = find_free_seg();	/* find free place in queue */
@@ -194,6 +249,7 @@ static int rd_ioctl(register struct inode *inode, struct file *file,
 		    rd_segment[k].next = j;	/* set link to next index */
 		k = j;
 	}
+	rd_build_index(target);
 	drive_info[target].valid = 1;
 	debug("RD: ramdisk %d created sectors %d index %d bytes %ld\n",
 		target, drive_info[target].size, drive_info[target].start,
@@ -216,9 +272,9 @@ static void do_rd_request(void)
 {
     rd_sector_t start;		/* requested start sector*/
     rd_sector_t offset;		/* sector offset in memory segment*/
-    int index;
+    ramdesc_t seg;
     int target;
-    int count;
+    int count, n;
     byte_t *buf;
 
     while (1) {
@@ -245,26 +301,24 @@ static void do_rd_request(void)
 	    continue;
 	}
 
-        for (count = 0; count < req->rq_nr_sectors; count++) {
-            /* find appropriate memory segment and sector offset*/
-            offset = start;
-            index = drive_info[target].start;
-            debug("index %d, ", index);
-            while (offset > rd_segment[index].sectors) {
-                offset -= rd_segment[index].sectors;
-                index = rd_segment[index].next;
-            }
-            debug("entry %d, seg %x, offset %d\n", index, rd_segment[index].seg, offset);
+        /* copy runs of sectors within one 64k segment at a time*/
+        for (count = req->rq_nr_sectors; count > 0; count -= n) {
+            offset = start & (RD_SEG_SECTORS - 1);
+            n = RD_SEG_SECTORS - offset;
+            if (n > count)
+                n = count;
+            seg = rd_seg(target, start);
+            debug("seg %lx, offset %d, count %d\n", (long)seg, offset, n);
 
             if (req->rq_cmd == WRITE) {
-                xms_fmemcpyw((char *) (offset * RD_SECTOR_SIZE), rd_segment[index].seg,
-                    buf, req->rq_seg, RD_SECTOR_SIZE/2);
+                xms_fmemcpyw((char *) (offset * RD_SECTOR_SIZE), seg,
+                    buf, req->rq_seg, n * (RD_SECTOR_SIZE/2));
             } else {
                 xms_fmemcpyw(buf, req->rq_seg, (byte_t *) (offset * RD_SECTOR_SIZE),
-                    rd_segment[index].seg, RD_SECTOR_SIZE/2);
+                    seg, n * (RD_SECTOR_SIZE/2));
             }
-            start++;
-            buf += RD_SECTOR_SIZE;;
+            start += n;
+            buf += n * RD_SECTOR_SIZE;
         }
         end_request(1);
     }
@@ -304,6 +358,7 @@ void INITPROC rd_init(void)
 	    rd_segment[i].next = -1;
 	}
 #endif
+	rd_build_index(0);
 #if DEBUG
 	for (int i=0; i < MAX_SEGMENTS; i++)
 		printk("%d: seg %x next %d sectors %d\n",
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <linuxmt/types.h>
 
 /**
  * Inits the SPI hardware (peripheral or bitbang via GPIO).
@@ -40,3 +41,19 @@ uint8_t spi_receive(void);
  * bytes: count of bytes to send.
  */
 void spi_send_ffs(uint16_t bytes);
+
+/**
+ * Read a block of bytes into a far buffer while sending all ones.
+ * 
+ * buf, seg: destination buffer offset and segment.
+ * count: count of bytes to read.
+ */
+void spi_receive_block(char *buf, seg_t seg, uint16_t count);
+
+/**
+ * Transmit a block of bytes from a far buffer. Discards the slave's output data.
+ * 
+ * buf, seg: source buffer offset and segment.
+ * count: count of bytes to send.
+ */
+void spi_transmit_block(char *buf, seg_t seg, uint16_t count);
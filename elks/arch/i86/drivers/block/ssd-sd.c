@@ -42,9 +42,12 @@ enum SdCommandIndices {
     CMD_GO_IDLE = 0,            /* GO_IDLE_STATE */
     CMD_SEND_IF_COND = 8,       /* SEND_IF_COND */
     CMD_SEND_CSD = 9,           /* SEND_CSD */
+    CMD_STOP_TRANSMISSION = 12, /* STOP_TRANSMISSION */
     CMD_SET_BLOCKLEN = 16,      /* SET_BLOCKLEN */
     CMD_READ_SINGLE_BLOCK = 17, /* READ_SINGLE_BLOCK */
+    CMD_READ_MULTIPLE_BLOCK = 18, /* READ_MULTIPLE_BLOCK */
     CMD_WRITE_BLOCK = 24,       /* WRITE_BLOCK */
+    CMD_WRITE_MULTIPLE_BLOCK = 25, /* WRITE_MULTIPLE_BLOCK */
     CMD_APP_CMD = 55,           /* APP_CMD */
     CMD_READ_OCR = 58,          /* READ_OCR */
     ACMD_SEND_OP_COND = 41,     /* SEND_OP_COND */
@@ -137,6 +140,11 @@ static uint8_t sd_send_cmd(uint8_t command, uint32_t arg)
         spi_transmit(0xff);
     }
 
+    /* Skip the stuff byte following STOP_TRANSMISSION */
+    if (command == CMD_STOP_TRANSMISSION) {
+        spi_receive();
+    }
+
     /* Give the card a some time to process the command */
     for (i = 0; ((ret = spi_receive()) & 0x80) && (i < 0x10); i++);
 
@@ -455,20 +463,70 @@ fail:
     return ret;
 }
 
+/**
+ * Receives one data block from the SD card after a read command.
+ * 
+ * buf, seg: buffer to be written with the SD card's contents.
+ * Must be 512 bytes long. FIXME won't work with XMS buffers.
+ * 
+ * returns: 0 on success, negative value on failure.
+ */
+static int sd_read_data(char *buf, ramdesc_t seg) {
+    int ret;
+
+    ret = sd_wait_for_token(0xfe);
+    if (ret < 0) {
+        return ret;
+    }
+
+    spi_receive_block(buf, (seg_t)seg, SD_FIXED_SECTOR_SIZE);
+
+    /* Skip trailing CRC */
+    spi_send_ffs(2);
+
+    return 0;
+}
+
+/**
+ * Sends one data block to the SD card after a write command.
+ * 
+ * buf, seg: buffer containing data to be written on the SD card.
+ * Must be 512 bytes long. FIXME won't work with XMS buffers.
+ * token: data block start token, 0xfe or 0xfc for multiple blocks.
+ * 
+ * returns: 0 on success, negative value on failure.
+ */
+static int sd_write_data(char *buf, ramdesc_t seg, uint8_t token) {
+    /* Send data block header */
+    spi_transmit(0xff);
+    spi_transmit(token);
+
+    /* Send the entire sector data */
+    spi_transmit_block(buf, (seg_t)seg, SD_FIXED_SECTOR_SIZE);
+
+    /* Send a dummy CRC */
+    spi_transmit(0);
+    spi_transmit(0);
+
+    /* Check data response */
+    if ((spi_receive() & 0x1F) != 0x05) {
+        return -EIO;
+    }
+
+    /* wait for the SD card to be ready */
+    return sd_wait_ready(10000);
+}
+
 /**
  * Reads an entire sector off the SD card.
  * 
- * *buffer: __far pointer of the buffer to be written with the
- * SD card's contents. Must be 512 bytes long.
+ * buf, seg: buffer to be written with the SD card's contents.
  * sector: sector number.
  * 
  * returns: 0 on success, negative value on failure.
  */
 static int sd_read(char *buf, ramdesc_t seg, sector_t sector) {
-    /* init far pointer to segment:offset. FIXME won't work with XMS buffers*/
-    unsigned char __far *buffer = _MK_FP((seg_t)seg, (unsigned)buf);
     int ret;
-    uint16_t count = SD_FIXED_SECTOR_SIZE;
 
     if (_sd_type != SDHC) {
         /* SDv1 and SDv2 use address instead of sectors */
@@ -481,17 +539,7 @@ static int sd_read(char *buf, ramdesc_t seg, sector_t sector) {
         goto fail;
     }
 
-    ret = sd_wait_for_token(0xfe);
-    if (ret < 0) {
-        goto fail;
-    }
-
-    do {
-        *buffer++ = spi_receive();
-    } while (--count);
-
-    /* Skip trailing CRC */
-    spi_send_ffs(2);
+    ret = sd_read_data(buf, seg);
 
 fail:
     sd_release_spi();
@@ -502,17 +550,13 @@ fail:
 /**
  * Writes an entire sector off the SD card.
  * 
- * *buffer: __far pointer of the buffer containing data to be
- * written on the SD card. Must be 512 bytes long.
+ * buf, seg: buffer containing data to be written on the SD card.
  * sector: sector number.
  * 
  * returns: 0 on success, negative value on failure.
  */
 static int sd_write(char *buf, ramdesc_t seg, sector_t sector) {
-    /* init far pointer to segment:offset. FIXME won't work with XMS buffers*/
-    unsigned char __far *buffer = _MK_FP((seg_t)seg, (unsigned)buf);
     int ret;
-    uint16_t count = SD_FIXED_SECTOR_SIZE;
 
     if (_sd_type != SDHC) {
         /* SDv1 and SDv2 use address instead of sectors */
@@ -525,27 +569,7 @@ static int sd_write(char *buf, ramdesc_t seg, sector_t sector) {
         goto fail;
     }
 
-    /* Send data block header */
-    spi_transmit(0xff);
-    spi_transmit(0xfe);
-
-    /* Send the entire sector data */
-    do {
-        spi_transmit(*buffer++);
-    } while (--count);
-
-    /* Send a dummy CRC */
-    spi_transmit(0);
-    spi_transmit(0);
-
-    /* Check data response */
-    if ((spi_receive() & 0x1F) != 0x05) {
-        ret = -EIO;
-        goto fail;
-    }
-
-    /* wait for the SD card to be ready */
-    ret = sd_wait_ready(10000);
+    ret = sd_write_data(buf, seg, 0xfe);
 
 fail:
     sd_release_spi();
@@ -619,3 +643,62 @@ int ssddev_read(sector_t start, char *buf, ramdesc_t seg)
         return 0;
     return 1;
 }
+
+/**
+ * SSD API: Starts a multi-sector transfer using READ_MULTIPLE_BLOCK
+ * or WRITE_MULTIPLE_BLOCK.
+ * 
+ * returns: 0 on success, -EIO on failure.
+ */
+int ssddev_multi_start(int cmd, sector_t start)
+{
+    if (_sd_type != SDHC) {
+        /* SDv1 and SDv2 use address instead of sectors */
+        start *= SD_FIXED_SECTOR_SIZE;
+    }
+
+    if (sd_send_cmd(cmd == WRITE? CMD_WRITE_MULTIPLE_BLOCK: CMD_READ_MULTIPLE_BLOCK,
+            start) != 0) {
+        sd_release_spi();
+        return -EIO;
+    }
+    return 0;
+}
+
+/**
+ * SSD API: Transfers the next sector of a multi-sector transfer.
+ * 
+ * returns: 0 on success, negative value on failure.
+ */
+int ssddev_multi_xfer(int cmd, char *buf, ramdesc_t seg)
+{
+    if (cmd == WRITE)
+        return sd_write_data(buf, seg, 0xfc);
+    return sd_read_data(buf, seg);
+}
+
+/**
+ * SSD API: Ends a multi-sector transfer, sending the stop token
+ * on writes or STOP_TRANSMISSION on reads.
+ * 
+ * returns: 0 on success, negative value on failure.
+ */
+int ssddev_multi_stop(int cmd)
+{
+    int ret;
+
+    if (cmd == WRITE) {
+        spi_transmit(0xfd);
+        spi_receive();          /* card asserts busy after one byte */
+        ret = sd_wait_ready(10000);
+    } else {
+        if (sd_send_cmd(CMD_STOP_TRANSMISSION, 0) & 0x80) {
+            ret = -EIO;
+        } else {
+            ret = sd_wait_ready(10000);
+        }
+    }
+    sd_release_spi();
+
+    return ret;
+}
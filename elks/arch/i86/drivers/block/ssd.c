@@ -16,6 +16,7 @@
 #include "ssd.h"
 
 #define IODELAY     (5*HZ/100)  /* async time delay 5/100 sec = 50msec */
+#define SSD_MAX_MERGE   (8*BLOCK_SIZE)  /* max bytes in a multi-sector transfer */
 
 jiff_t ssd_timeout;
 
@@ -41,6 +42,9 @@ void INITPROC ssd_init(void)
 {
     if (register_blkdev(MAJOR_NR, DEVICE_NAME, &ssd_fops) == 0) {
         blk_dev[MAJOR_NR].request_fn = DEVICE_REQUEST;
+#if defined(CONFIG_ASYNCIO) && defined(SSDDEV_MULTI)
+        blk_dev[MAJOR_NR].max_merge = SSD_MAX_MERGE;
+#endif
         NUM_SECTS = ssddev_init();
     }
     if (NUM_SECTS)
@@ -70,6 +74,36 @@ static void ssd_release(struct inode *inode, struct file *filp)
     }
 }
 
+#ifdef SSDDEV_MULTI
+/*
+ * Transfer all sectors of a request with a single multi-sector command,
+ * walking the buffers of a merged request. Returns # sectors transferred.
+ */
+static int ssd_multi(struct request *req)
+{
+    struct request *rq = req;
+    char *buf = req->rq_buffer;
+    int count;
+
+    if (ssddev_multi_start(req->rq_cmd, req->rq_sector))
+        return 0;
+    for (count = 0; count < req->rq_nr_sectors; count++) {
+        if (ssddev_multi_xfer(req->rq_cmd, buf, rq->rq_seg))
+            break;
+        buf += SD_FIXED_SECTOR_SIZE;
+#ifdef CONFIG_ASYNCIO
+        if (buf == rq->rq_buffer + BLOCK_SIZE && rq->rq_merge) {
+            rq = rq->rq_merge;      /* next buffer of merged request */
+            buf = rq->rq_buffer;
+        }
+#endif
+    }
+    if (ssddev_multi_stop(req->rq_cmd))
+        count = 0;
+    return count;
+}
+#endif
+
 /* called by timer interrupt if async operation */
 void ssd_io_complete(void)
 {
@@ -105,6 +139,13 @@ void ssd_io_complete(void)
             end_request(0);
             continue;
         }
+#ifdef SSDDEV_MULTI
+        if (req->rq_nr_sectors > 1) {
+            debug_blk("SSD: %s %d sectors at %lu\n",
+                req->rq_cmd == WRITE? "writing": "reading", req->rq_nr_sectors, start);
+            count = ssd_multi(req);
+        } else
+#endif
         for (count = 0; count < req->rq_nr_sectors; count++) {
             if (req->rq_cmd == WRITE) {
                 debug_blk("SSD: writing sector %lu\n", start);
@@ -10,6 +10,17 @@ int ssddev_ioctl(struct inode *inode, struct file *file,
 int ssddev_write(sector_t start, char *buf, ramdesc_t seg);
 int ssddev_read(sector_t start, char *buf, ramdesc_t seg);
 
+#ifdef CONFIG_BLK_DEV_SSD_SD8018X
+/*
+ * Optional multi-sector API: start a READ or WRITE transfer at sector start,
+ * transfer each consecutive sector in turn, then stop. All return 0 on success.
+ */
+#define SSDDEV_MULTI
+int ssddev_multi_start(int cmd, sector_t start);
+int ssddev_multi_xfer(int cmd, char *buf, ramdesc_t seg);
+int ssddev_multi_stop(int cmd);
+#endif
+
 extern char ssd_initialized;
 
 #endif /* !_SSD_H */
@@ -19,6 +19,7 @@
 #include <linuxmt/chqueue.h>
 #include <linuxmt/ntty.h>
 #include <linuxmt/kd.h>
+#include <arch/system.h>
 #include "console.h"
 #include "console-bios.h"
 
@@ -68,6 +69,7 @@ static Console *glock;          /* Which console owns the graphics hardware */
 static int Width, MaxCol, Height, MaxRow;
 static int NumConsoles = MAX_CONSOLES;
 static int kraw;
+static int WriteString;         /* BIOS has INT 10h AH=13h write string */
 static int Current_VCminor = 0;
 
 #ifdef CONFIG_EMUL_ANSI
@@ -112,6 +114,41 @@ static void VideoWrite(register Console * C, char c)
     bios_writecharattr (c, a, p);
 }
 
+#define RUN_MAX         80      /* max characters per VideoWriteRun call */
+
+/*
+ * Write a run of printable characters on the current line with a single
+ * write string BIOS call, returns the number written. The string is written
+ * at the console position without moving the BIOS cursor, which is set once
+ * at the end of Console_write. Stops at control characters, which are left
+ * to std_char, as is a pending line wrap.
+ */
+static int VideoWriteRun(register Console * C, unsigned char *s, int n)
+{
+    int i;
+
+    if (!WriteString || C->XN)
+        return 0;
+    if (n > Width - C->cx)
+        n = Width - C->cx;
+    if (n > RUN_MAX)
+        n = RUN_MAX;
+    for (i = 0; i < n && s[i] >= ' '; i++)
+        continue;
+    if (i) {
+        bios_writestring(C->cx, C->cy, C->attr, C->pageno, s, i);
+        C->cx += i;
+        if (C->cx > MaxCol) {
+#ifndef CONFIG_EMUL_VT52
+            C->XN = 1;
+#endif
+            C->cx = MaxCol;
+        }
+    }
+    return i;
+}
+#define CONSOLE_WRITERUN        /* console.c: Console_write uses VideoWriteRun */
+
 static void scroll(register Console * C, int n, int x, int y, int xx, int yy)
 {
     int a;
@@ -185,6 +222,10 @@ void INITPROC console_init(void)
     if (peekb(0x49, 0x40) == 7)  /* BIOS data segment */
         NumConsoles = 1;
 
+    /* write string is missing from the original PC and XT BIOS */
+    if (sys_caps & CAP_PC_AT)
+        WriteString = 1;
+
     C = Con;
     Visible = C;
 
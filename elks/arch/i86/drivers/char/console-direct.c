@@ -20,6 +20,7 @@
 #include <linuxmt/ntty.h>
 #include <linuxmt/kd.h>
 #include <arch/io.h>
+#include <arch/segment.h>
 #include "console.h"
 
 /* Assumes ASCII values. */
@@ -52,6 +53,7 @@ struct console {
     unsigned char XN;           /* delayed newline on column 80 */
     unsigned int vseg;          /* video segment for page */
     int basepage;               /* start of video ram */
+    unsigned int vorg;          /* screen start in page, moved by hardware scroll */
 #ifdef CONFIG_EMUL_ANSI
     int savex, savey;           /* saved cursor position */
     unsigned char *parmptr;     /* ptr to params */
@@ -68,6 +70,7 @@ static Console *glock;          /* Which console owns the graphics hardware */
 static unsigned short CCBase;   /* 6845 CRTC base I/O address */
 static int Width, MaxCol, Height, MaxRow;
 static int NumConsoles = MAX_CONSOLES;
+static unsigned int PageWords;  /* video ram words per console */
 static unsigned char isMDA, isCGA;
 
 int Current_VCminor = 0;
@@ -86,13 +89,15 @@ static void std_char(register Console *, int);
 
 static void SetDisplayPage(register Console * C)
 {
-    outw((C->basepage & 0xff00) | 0x0c, CCBase);
-    outw((C->basepage << 8) | 0x0d, CCBase);
+    unsigned int start = C->basepage + C->vorg;
+
+    outw((start & 0xff00) | 0x0c, CCBase);
+    outw((start << 8) | 0x0d, CCBase);
 }
 
 static void PositionCursor(register Console * C)
 {
-    unsigned int Pos = C->cx + Width * C->cy + C->basepage;
+    unsigned int Pos = C->cx + Width * C->cy + C->basepage + C->vorg;
 
     outb(14, CCBase);
     outb(Pos >> 8, CCBase + 1);
@@ -117,16 +122,51 @@ static void DisplayCursor(int onoff)
 
 static void VideoWrite(register Console * C, int c)
 {
-    pokew((C->cx + C->cy * Width) << 1, (seg_t) C->vseg,
+    pokew((C->cx + C->cy * Width + C->vorg) << 1, (seg_t) C->vseg,
           (C->attr << 8) | (c & 255));
 }
 
+#define RUN_MAX         80      /* max characters per VideoWriteRun copy */
+
+/*
+ * Write a run of printable characters on the current line with a single
+ * far copy, returns the number written. Stops at control characters,
+ * which are left to std_char, as is a pending line wrap.
+ */
+static int VideoWriteRun(register Console * C, unsigned char *s, int n)
+{
+    static word_t cells[RUN_MAX];
+    int i;
+
+    if (C->XN)
+        return 0;
+    if (n > Width - C->cx)
+        n = Width - C->cx;
+    if (n > RUN_MAX)
+        n = RUN_MAX;
+    for (i = 0; i < n && s[i] >= ' '; i++)
+        cells[i] = (C->attr << 8) | s[i];
+    if (i) {
+        fmemcpyw((void *)((C->cx + C->cy * Width + C->vorg) << 1), C->vseg,
+                 cells, kernel_ds, i);
+        C->cx += i;
+        if (C->cx > MaxCol) {
+#ifndef CONFIG_EMUL_VT52
+            C->XN = 1;
+#endif
+            C->cx = MaxCol;
+        }
+    }
+    return i;
+}
+#define CONSOLE_WRITERUN        /* console.c: Console_write uses VideoWriteRun */
+
 static void ClearRange(register Console * C, int x, int y, int x2, int y2)
 {
     register int vp;
 
     x2 = x2 - x + 1;
-    vp = (x + y * Width) << 1;
+    vp = (x + y * Width + C->vorg) << 1;
     do {
         for (x = 0; x < x2; x++) {
             pokew(vp, (seg_t) C->vseg, (C->attr << 8) | ' ');
@@ -136,11 +176,30 @@ static void ClearRange(register Console * C, int x, int y, int x2, int y2)
     } while (++y <= y2);
 }
 
+/*
+ * Full screen scrolls move the CRTC start address down one line while the
+ * screen fits in the console's video ram, and only copy the screen back
+ * to the start of its page when the end is reached.
+ */
 static void ScrollUp(register Console * C, int y)
 {
     register int vp;
 
-    vp = y * (Width << 1);
+    if (y == 0 && (C->vorg || Width * (Height + 1) <= PageWords)) {
+        if (C->vorg + Width * (Height + 1) <= PageWords)
+            C->vorg += Width;
+        else {
+            fmemcpyw(0, C->vseg, (void *)((C->vorg + Width) << 1), C->vseg,
+                     MaxRow * Width);
+            C->vorg = 0;
+        }
+        if (C == Visible)
+            SetDisplayPage(C);
+        ClearRange(C, 0, MaxRow, MaxCol, MaxRow);
+        return;
+    }
+
+    vp = (y * Width + C->vorg) << 1;
     if ((unsigned int)y < MaxRow)
         fmemcpyw((void *)vp, C->vseg,
                  (void *)(vp + (Width << 1)), C->vseg, (MaxRow - y) * Width);
@@ -153,7 +212,7 @@ static void ScrollDown(register Console * C, int y)
     register int vp;
     int yy = MaxRow;
 
-    vp = yy * (Width << 1);
+    vp = (yy * Width + C->vorg) << 1;
     while (--yy >= y) {
         fmemcpyw((void *)vp, C->vseg, (void *)(vp - (Width << 1)), C->vseg, Width);
         vp -= Width << 1;
@@ -211,6 +270,12 @@ void INITPROC console_init(void)
         isCGA = peekw(0xA8+2, 0x40) == 0;
     }
 
+    /* share all text video ram between consoles for hardware scrolling */
+    PageWords = (isMDA? 4096U: (isCGA? 16384U: 32768U)) / 2 / NumConsoles;
+    PageWords &= ~7;            /* keep page start paragraph aligned */
+    if (PageWords < PageSizeW)
+        PageWords = PageSizeW;
+
     C = Con;
     Visible = C;
 
@@ -221,7 +286,8 @@ void INITPROC console_init(void)
             C->cy = peekb(0x51, 0x40);
         }
         C->fsm = std_char;
-        C->basepage = i * PageSizeW;
+        C->basepage = i * PageWords;
+        C->vorg = 0;
         C->vseg = VideoSeg + (C->basepage >> 3);
         C->attr = A_DEFAULT;
 
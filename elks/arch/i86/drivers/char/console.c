@@ -29,6 +29,24 @@ void Console_conin(unsigned char Key)
         chq_addch(&ttyp->inq, Key);
 }
 
+/* Add key to the current console without waking its reader, 0 if no room */
+int Console_conin_nowakeup(unsigned char Key)
+{
+    register struct tty *ttyp = &ttys[Current_VCminor];
+
+    if (tty_intcheck(ttyp, Key))
+        return 1;
+    if (ttyp->inq.len >= ttyp->inq.size)
+        return 0;
+    chq_addch_nowakeup(&ttyp->inq, Key);
+    return 1;
+}
+
+void Console_conin_wakeup(void)
+{
+    wake_up(&ttys[Current_VCminor].inq.wait);
+}
+
 #if defined (CONFIG_EMUL_VT52) || defined (CONFIG_EMUL_ANSI)
 static void Console_gotoxy(register Console * C, int x, int y)
 {
@@ -151,11 +169,25 @@ static void AnsiCmd(register Console * C, int c)
         else if (n == 2)        /* all */
             ClearRange(C, 0, C->cy, MaxCol, C->cy);
         break;
-    case 'L':                   /* insert line */
-        ScrollDown(C, C->cy);
+    case 'L':                   /* insert n lines */
+        n = parm1(C->params);
+        while (n-- > 0)
+            ScrollDown(C, C->cy);
         break;
-    case 'M':                   /* remove line */
-        ScrollUp(C, C->cy);
+    case 'M':                   /* remove n lines */
+        n = parm1(C->params);
+        while (n-- > 0)
+            ScrollUp(C, C->cy);
+        break;
+    case 'S':                   /* scroll up n lines */
+        n = parm1(C->params);
+        while (n-- > 0)
+            ScrollUp(C, 0);
+        break;
+    case 'T':                   /* scroll down n lines */
+        n = parm1(C->params);
+        while (n-- > 0)
+            ScrollDown(C, 0);
         break;
     case 'm':                   /* ansi color */
       {
@@ -449,6 +481,17 @@ static int Console_write(register struct tty *tty)
     int cnt = 0;
 
     while ((tty->outq.len > 0) && !glock) {
+#ifdef CONSOLE_WRITERUN
+        int n = tty_outrun(tty);
+
+        /* copy runs of printable characters as a block */
+        if (n && C->fsm == std_char &&
+            (n = VideoWriteRun(C, tty->outq.base + tty->outq.tail, n)) > 0) {
+            chq_skip(&tty->outq, n);
+            cnt += n;
+            continue;
+        }
+#endif
         WriteChar(C, tty_outproc(tty));
         cnt++;
     }
@@ -1,6 +1,8 @@
 /* console routine forward definitions*/
 
 void Console_conin(unsigned char Key);
+int Console_conin_nowakeup(unsigned char Key);
+void Console_conin_wakeup(void);
 void Console_conout(dev_t dev, int Ch);
 extern struct tty ttys[];
 
@@ -7,6 +7,9 @@
 #include <linuxmt/major.h>
 #include <linuxmt/errno.h>
 #include <linuxmt/fs.h>
+#include <linuxmt/fcntl.h>
+#include <linuxmt/mm.h>
+#include <linuxmt/ioctl.h>
 #include <linuxmt/netstat.h>
 #include <linuxmt/string.h>
 
@@ -30,8 +33,10 @@ static struct file_operations *get_ops(dev_t dev)
 
 static int eth_open(struct inode *inode, struct file *file)
 {
-    struct file_operations *ops = get_ops(inode->i_rdev);
+    struct file_operations *ops;
 
+    wait_deferred_probes();
+    ops = get_ops(inode->i_rdev);
     if (!ops)
         return -ENODEV;
     return ops->open(inode, file);
@@ -64,12 +69,46 @@ static size_t eth_read(struct inode *inode, struct file *file, char *data, size_
     return ops->read(inode, file, data, len);
 }
 
+/*
+ * Send several frames with one system call, returning the number sent.
+ * Only the first frame follows O_NONBLOCK, the rest wait for the NIC,
+ * which frees a transmit buffer within a frame time.
+ */
+static int eth_writev(struct inode *inode, struct file *file,
+    struct file_operations *ops, struct eth_writev *uwv)
+{
+    struct eth_writev wv;
+    struct iovec iov[UIO_MAXIOV];
+    struct file wfile;
+    int i, err;
+
+    if ((err = verified_memcpy_fromfs(&wv, uwv, sizeof(wv))) != 0)
+        return err;
+    if (wv.count < 0 || wv.count > UIO_MAXIOV)
+        return -EINVAL;
+    if ((err = verified_memcpy_fromfs(iov, wv.iov, wv.count * sizeof(struct iovec))) != 0)
+        return err;
+
+    wfile = *file;
+    for (i = 0; i < wv.count; i++) {
+        if ((err = verify_area(VERIFY_READ, iov[i].iov_base, iov[i].iov_len)) != 0)
+            break;
+        err = ops->write(inode, &wfile, iov[i].iov_base, iov[i].iov_len);
+        if (err < 0)
+            break;
+        wfile.f_flags &= ~O_NONBLOCK;
+    }
+    return i? i: err;
+}
+
 static int eth_ioctl(struct inode *inode, struct file *file, int cmd, char *arg)
 {
     struct file_operations *ops = get_ops(inode->i_rdev);
 
     if (!ops)
         return -ENODEV;
+    if (cmd == IOCTL_ETH_WRITEV)
+        return eth_writev(inode, file, ops, (struct eth_writev *)arg);
     return ops->ioctl(inode, file, cmd, arg);
 }
 
@@ -96,7 +135,13 @@ static struct file_operations eth_fops = {
 void INITPROC eth_init(void)
 {
     register_chrdev(ETH_MAJOR, "eth", &eth_fops);
+    if (!boot_defer)
+        eth_probe();
+}
 
+/* probe the NICs, from eth_init or later from a kernel task if deferred */
+void INITPROC eth_probe(void)
+{
 #ifdef CONFIG_ETH_NE2K
     eths[ETH_NE2K].ops = &ne2k_fops;
     ne2k_drv_init();
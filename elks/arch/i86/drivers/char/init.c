@@ -1,6 +1,7 @@
 #include <linuxmt/config.h>
 #include <linuxmt/types.h>
 #include <linuxmt/init.h>
+#include <linuxmt/sched.h>
 
 void INITPROC chr_dev_init(void)
 {
@@ -25,7 +26,7 @@ void INITPROC chr_dev_init(void)
 #endif
 
 #ifdef CONFIG_ETH
-    eth_init();
+    INITCALL(eth_init());
 #endif
 
 #ifdef CONFIG_PSEUDO_TTY    
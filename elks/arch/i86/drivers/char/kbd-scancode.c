@@ -34,6 +34,7 @@
 #include <linuxmt/signal.h>
 #include <linuxmt/ntty.h>
 #include <arch/io.h>
+#include <arch/irq.h>
 #include <arch/ports.h>
 #include <arch/system.h>
 #include "console.h"
@@ -86,6 +87,21 @@ static enum {
 } kb_cmd_state;
 static struct timer_list kb_cmd_timer;
 
+/*
+ * Keys are converted by keyboard_irq into a typeahead ring and moved to the
+ * console input queue by the keyboard bottom half, with one wakeup per
+ * batch. Keys that don't fit in the input queue stay in the ring and are
+ * retried each tick until the reader makes room. A console switch is
+ * queued at its place in the ring so keys still go to the right console.
+ */
+#define KBD_RING	256	/* typeahead ring, indices wrap as unsigned char */
+
+static unsigned char kbd_ring[KBD_RING];
+static unsigned char kbd_head, kbd_tail;
+static unsigned char kbd_vc_pos;	/* ring position of pending console switch */
+static int kbd_vc = -1;			/* pending console switch, -1 if none */
+static struct timer_list kbd_retry_timer;
+
 /*
  * Table for mapping scancodes >= 0x1C into scan code class.
  * scancodes < 0x1C are all simple scan codes (SSC).
@@ -139,8 +155,61 @@ static unsigned char *scan_tabs[] = {
     xtkb_scan_ctrl_alt,	/*mode = 3*/
 };
 
+static void kbd_putc(unsigned char c)
+{
+    if ((unsigned char)(kbd_head + 1) != kbd_tail)
+	kbd_ring[kbd_head++] = c;
+    mark_bh(KBD_BH);
+}
+
+static void kbd_set_vc(int n)
+{
+    kbd_vc_pos = kbd_head;
+    kbd_vc = n;
+    mark_bh(KBD_BH);
+}
+
+static void kbd_retry(int data)
+{
+    mark_bh(KBD_BH);
+}
+
+/* Move typeahead to the console, run with interrupts enabled */
+static void kbd_bh(void)
+{
+    int n = 0;
+
+    for (;;) {
+	if (kbd_vc >= 0 && kbd_tail == kbd_vc_pos) {
+	    if (n)
+		Console_conin_wakeup();
+	    n = 0;
+	    Console_set_vc(kbd_vc);
+	    kbd_vc = -1;
+	}
+	if (kbd_tail == kbd_head)
+	    break;
+	if (!Console_conin_nowakeup(kbd_ring[kbd_tail])) {
+	    if (kbd_vc < 0)
+		break;
+	    /* input queue full, drop keys typed before the switch */
+	}
+	kbd_tail++;
+	n++;
+    }
+    if (n)
+	Console_conin_wakeup();
+    if (kbd_tail != kbd_head && !kbd_retry_timer.tl_pprev) {
+	kbd_retry_timer.tl_expires = jiffies + 1;
+	kbd_retry_timer.tl_function = kbd_retry;
+	add_timer(&kbd_retry_timer);
+    }
+}
+
 void kbd_init(void)
 {
+    init_bh(KBD_BH, kbd_bh);
+
     /* Set off the initial keyboard interrupt handler */
 
     if (request_irq(KBD_IRQ, keyboard_irq, INT_GENERIC))
@@ -186,7 +255,7 @@ static void keyboard_irq(int irq, struct pt_regs *regs)
     code = kb_read();
 
     if (kraw) {
-	Console_conin(code & 255);
+	kbd_putc(code & 255);
 	return;
     }
 
@@ -276,12 +345,12 @@ static void keyboard_irq(int irq, struct pt_regs *regs)
     
 	/* AltF1-F3 are console switch*/
 	if ((ModeState & ALT) && code <= SCAN_F1+2) {
-	    Console_set_vc(code - SCAN_F1);
+	    kbd_set_vc(code - SCAN_F1);
 	    return;
 	}
 
-	Console_conin(ESC);		/* F1 = ESC a, F2 = ESC b, etc*/
-	Console_conin(mode);
+	kbd_putc(ESC);		/* F1 = ESC a, F2 = ESC b, etc*/
+	kbd_putc(mode);
 	return;
 
     /* --------------Handle extended scancodes-------------- */
@@ -289,13 +358,13 @@ static void keyboard_irq(int irq, struct pt_regs *regs)
 	if (E0key) {		/* Is extended scancode? */
 	    mode &= 0x3F;
 	    if (mode) {
-		Console_conin(ESC);
+		kbd_putc(ESC);
 #ifdef CONFIG_EMUL_ANSI
-		Console_conin('[');
+		kbd_putc('[');
 #endif
 	    }
 	    /* Up=0x37 -> ESC [ A, Down=0x38 -> ESC [ B, etc*/
-	    Console_conin(mode + 10);
+	    kbd_putc(mode + 10);
 	    return;
 	}
 	/* fall through*/
@@ -355,13 +424,13 @@ static void keyboard_irq(int irq, struct pt_regs *regs)
 	if ((ModeState & (CTRL|ALT)) == ALT) {
 	    /* Alt-1 - Alt-3 are also console switch (for systems w/no fnkeys)*/
 	    if (key >= '1' && key <= '3') {
-		Console_set_vc(key - '1');
+		kbd_set_vc(key - '1');
 		return;
 	    }
             /* map Alt-a - Alt-z to ESC A - Z */
             if (key >= 'a' && key <= 'z') {
-                Console_conin(ESC);
-                Console_conin(key-'a'+'A');
+                kbd_putc(ESC);
+                kbd_putc(key-'a'+'A');
                 return;
             }
 	    key |= 0x80;	/* ALT-.. (assume codepage is OEM 437) */
@@ -389,15 +458,15 @@ static void keyboard_irq(int irq, struct pt_regs *regs)
 	//default: if (key > 127) printk("Unknown key (0%o 0x%x)\n", key, key);
 	}
 	if (code) {
-	    Console_conin(ESC);
-	    Console_conin('[');
-	    Console_conin(code);
+	    kbd_putc(ESC);
+	    kbd_putc('[');
+	    kbd_putc(code);
 	    if (mode)
-		Console_conin(mode);
+		kbd_putc(mode);
 	    return;
 	}
 #endif
-	Console_conin(key);
+	kbd_putc(key);
     }
 }
 
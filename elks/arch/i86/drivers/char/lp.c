@@ -15,9 +15,15 @@
 #include <linuxmt/major.h>
 #include <linuxmt/sched.h>
 #include <linuxmt/types.h>
+#include <linuxmt/chqueue.h>
+#include <linuxmt/heap.h>
+#include <linuxmt/timer.h>
+#include <linuxmt/fcntl.h>
 #include <linuxmt/debug.h>
 
 #include <arch/io.h>
+#include <arch/irq.h>
+#include <arch/ports.h>
 
 struct lp_info {
     char *io;
@@ -77,111 +83,193 @@ static int lp_reset(int target)
 }
 #endif
 
-static int lp_char_polled(int c, unsigned int target)
-{
-    int wait;
-    register struct lp_info *lpp;
+/*
+ * Output is queued and sent in the background. While open, a port is
+ * given its IRQ if it is free, and the printer's acknowledge interrupt
+ * sends the next character. Otherwise, and whenever an interrupt is
+ * lost, a timer sends what the printer will take each tick, so writers
+ * only wait while the queue is full.
+ */
+struct lp_out {
+    struct ch_queue q;
+    struct timer_list timer;
+    struct lp_info *lpp;
+    unsigned char ctl;		/* control port value between strobes */
+    unsigned char flags;
+};
 
-#ifdef BIOS_PORTS
-    lpp = &ports[target];
-#else
-    lpp = &ports[port_order[target]];
+static struct lp_out lp_out[LP_PORTS];
+
+static int lp_irq_of(struct lp_info *lpp)
+{
+#ifdef LPT1_IRQ
+    if ((unsigned int)lpp->io == LPT1_PORT || (unsigned int)lpp->io == 0x3BC)
+	return LPT1_IRQ;
+    if ((unsigned int)lpp->io == LPT2_PORT)
+	return LPT2_IRQ;
 #endif
+    return 0;
+}
 
-    {
-	int status;
+/* Return 1 if the printer can take a character, 0 if busy, -1 on a problem */
+static int lp_ready(struct lp_out *lpo, int target)
+{
+    register struct lp_info *lpp = lpo->lpp;
+    int status, wait = LP_CHAR_WAIT;
+
+    /* note that LP_ERROR and LP_SELECTED are inverted signals */
+    status = LP_STATUS(lpp);
+    if ((status & LP_OUTOFPAPER) || !(status & LP_ERROR)) {
+	if (!(lpo->flags & LP_REPORTED)) {
+	    printk("lp%d: %s\n", target, (status & LP_OUTOFPAPER)? "out of paper": "printer error");
+	    lpo->flags |= LP_REPORTED;
+	}
+	return -1;
+    }
+    lpo->flags &= ~LP_REPORTED;
 
-	/* safety checks */
+    /* a printer is busy for a few us after each strobe */
+    while ((status & (LP_NOTBUSY | LP_SELECTED)) != (LP_NOTBUSY | LP_SELECTED)) {
+	if (!--wait)
+	    return 0;
 	status = LP_STATUS(lpp);
+    }
+    return 1;
+}
 
-	/* safety checks, note that LP_ERROR and LP_SELECTED
-	 * are inverted signals */
+static void lp_strobe(struct lp_out *lpo, int c)
+{
+    register struct lp_info *lpp = lpo->lpp;
+    int wait = 0;
 
-	if (status & LP_OUTOFPAPER) { /* printer out of paper */
-	    printk("lp%d: out of paper\n", target);
-	    return 0;
-	}
+    /* send character to port */
+    outb_p((unsigned char) c, lpp->io);
 
-#if UNUSED
+    /* 5 us delay */
+    while (wait++ != LP_STROBE_WAIT)
+	/* Do nothing */ ;
 
-	if (!(status & LP_SELECTED)) { /* printer offline */
-	    printk("lp%d: printer offline\n", target);
-	    return 0;
-	}
+    /* strobe high */
+    LP_CONTROL(lpo->ctl | LP_STROBE, lpp);
 
-#else
+    /* strobe low */
+    LP_CONTROL(lpo->ctl, lpp);
 
-	wait = LP_CHAR_WAIT + 1;
-
-	while (!((status = LP_STATUS(lpp)) & LP_SELECTED))
-	    /* while not ready do busy loop */
-	    {
-		if (!--wait) {
-		    printk("lp%d: timed out\n", target);
-		    return 0;
-		}
+    /* 5 us delay */
+    while (wait--)
+	/* Do nothing */ ;
+}
 
-#if NEED_RESCHED
-		if (need_resched)
-		    schedule();
-#endif
+static void lp_timer(int target);
 
-	    }
-#endif
+/*
+ * Send up to max queued characters while the printer is ready, and keep
+ * the timer running while any remain. Called from write, the interrupt
+ * handler and the timer; only one of them sends at a time.
+ */
+static void lp_output(int target, int max)
+{
+    register struct lp_out *lpo = &lp_out[target];
+    int status = 1;
+    flag_t flags;
+
+    save_flags(flags);
+    clr_irq();
+    if (lpo->flags & LP_SENDING) {
+	restore_flags(flags);
+	return;
+    }
+    lpo->flags |= LP_SENDING;
+    restore_flags(flags);
 
-	if (!(status & LP_ERROR)) { /* printer error */
-	    printk("lp%d: printer error\n", target);
-	    return 0;
-	}
+    while (max-- && lpo->q.len) {
+	if ((status = lp_ready(lpo, target)) <= 0)
+	    break;
+	lp_strobe(lpo, chq_getch(&lpo->q));
     }
+    lpo->flags &= ~LP_SENDING;
+    if (lpo->q.len < lpo->q.size)
+	wake_up(&lpo->q.wait);
+
+    save_flags(flags);
+    clr_irq();
+    if (lpo->q.len && !lpo->timer.tl_pprev) {
+	lpo->timer.tl_expires = jiffies + ((status < 0)? LP_RETRY:
+	    (lpo->ctl & LP_INTR)? LP_WATCHDOG: 1);
+	lpo->timer.tl_data = target;
+	lpo->timer.tl_function = lp_timer;
+	add_timer(&lpo->timer);
+    }
+    restore_flags(flags);
+}
 
-    /* send character to port */
-    outb_p((unsigned char) c, lpp->io);
+static void lp_timer(int target)
+{
+    lp_output(target, LP_TICK_CHARS);
+}
 
-    {
-	wait = 0;
-	/* 5 us delay */
-	while (wait++ != LP_STROBE_WAIT)
-	    /* Do nothing */ ;
+static void lp_irq(int irq, struct pt_regs *regs)
+{
+    int target;
 
-	/* strobe high */
-	LP_CONTROL(LP_SELECT | LP_INIT | LP_STROBE, lpp);
+    for (target = 0; target < LP_PORTS; target++) {
+	if ((lp_out[target].ctl & LP_INTR) && lp_irq_of(lp_out[target].lpp) == irq)
+	    lp_output(target, 1);
+    }
+}
 
-	/* strobe low */
-	LP_CONTROL(LP_SELECT | LP_INIT, lpp);
+/* Wait until the queue has room or is empty, returns 0 or -EINTR */
+static int lp_wait(register struct lp_out *lpo, int empty)
+{
+    int res = 0;
 
-	/* 5 us delay */
-	while (wait--)
-	    /* Do nothing */ ;
+    prepare_to_wait_interruptible(&lpo->q.wait);
+    if (empty? lpo->q.len: lpo->q.len == lpo->q.size) {
+	do_wait();
+	if (current->signal)
+	    res = -EINTR;
     }
-
-    return 1;
+    finish_wait(&lpo->q.wait);
+    return res;
 }
 
 static size_t lp_write(struct inode *inode, struct file *file, char *buf, size_t count)
 {
-    size_t chrsp = 0;
+    unsigned short int target = MINOR(inode->i_rdev);
+    register struct lp_out *lpo = &lp_out[target];
+    size_t written = 0;
+    int err;
 
 #ifdef USE_LP_RESET
 
     /* initialize printer */
-    lp_reset(MINOR(inode->i_rdev));
+    lp_reset(target);
 
 #endif
 
-    while (chrsp < count) {
-	if (!lp_char_polled(get_user_char((void *)(buf++)), MINOR(inode->i_rdev)))
-	    break;
-	chrsp++;
+    while (written < count) {
+	if (lpo->q.len == lpo->q.size) {
+	    if (file->f_flags & O_NONBLOCK)
+		err = -EAGAIN;
+	    else
+		err = lp_wait(lpo, 0);
+	    if (err)
+		return written? written: err;
+	    continue;
+	}
+	written += chq_addbuf(&lpo->q, buf + written, count - written);
+	lp_output(target, (lpo->ctl & LP_INTR)? 1: LP_TICK_CHARS);
     }
-    return chrsp;
+    return written;
 }
 
 static int lp_open(struct inode *inode, struct file *file)
 {
     register struct lp_info *lpp;
+    struct lp_out *lpo;
     short status;
     unsigned short int target;
+    int irq;
 
     target = MINOR(inode->i_rdev);
 
@@ -203,6 +291,18 @@ static int lp_open(struct inode *inode, struct file *file)
 	return -EBUSY;
     }
 
+    lpo = &lp_out[target];
+    if (!(lpo->q.base = heap_alloc(LP_BUFSIZE, HEAP_TAG_TTY)))
+	return -ENOMEM;
+    chq_init(&lpo->q, lpo->q.base, LP_BUFSIZE);
+    lpo->lpp = lpp;
+    lpo->flags = 0;
+    lpo->ctl = LP_SELECT | LP_INIT;
+    irq = lp_irq_of(lpp);
+    if (irq && !request_irq(irq, lp_irq, INT_GENERIC))
+	lpo->ctl |= LP_INTR;
+    LP_CONTROL(lpo->ctl, lpp);
+
 /*
  * nonexistent port can't be busy
  */
@@ -216,6 +316,20 @@ static int lp_open(struct inode *inode, struct file *file)
 static void lp_release(struct inode *inode, struct file *file)
 {
     unsigned short int target = MINOR(inode->i_rdev);
+    register struct lp_out *lpo = &lp_out[target];
+
+    /* finish queued output unless interrupted */
+    while (lpo->q.len && !lp_wait(lpo, 1))
+	continue;
+    del_timer(&lpo->timer);
+    if (lpo->ctl & LP_INTR) {
+	lpo->ctl &= ~LP_INTR;
+	LP_CONTROL(lpo->ctl, lpo->lpp);
+	free_irq(lp_irq_of(lpo->lpp));
+    }
+    heap_free(lpo->q.base);
+    lpo->q.base = NULL;
+    lpo->q.len = 0;
 
 #ifdef BIOS_PORTS
     ports[target].flags = LP_EXIST;	/* not busy */
@@ -281,7 +395,7 @@ void INITPROC lp_init(void)
 	/* returns 0 if port wasn't detected by BIOS at bootup */
 	if (!lp->io)
 	    break;		/* there can be no more ports */
-	printk("lp%d at 0x%x, using polling driver\n", i, lp->io);
+	printk("lp%d at 0x%x, irq %d\n", i, lp->io, lp_irq_of(lp));
 	lp->flags = LP_EXIST;
 	lp++;
     }
@@ -292,7 +406,7 @@ void INITPROC lp_init(void)
     /* probe for ports */
     for (i = 0; i < LP_PORTS; i++) {
 	if (!lp_probe(lp)) {
-	    printk("lp%d at 0x%x, using polling driver\n", i, lp->io);
+	    printk("lp%d at 0x%x, irq %d\n", count, lp->io, lp_irq_of(lp));
 	    port_order[count] = i;
 	    count++;
 	}
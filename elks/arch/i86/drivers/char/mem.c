@@ -1,6 +1,6 @@
 /*
  * ELKS implmentation of memory devices
- * /dev/null, /dev/port, /dev/zero, /dev/kmem
+ * /dev/null, /dev/port, /dev/zero, /dev/kmem, /dev/sctrace, /dev/kmsg
  *
  * Heavily inspired by linux/drivers/char/mem.c
  */
@@ -19,12 +19,16 @@
 #include <linuxmt/fs.h>
 #include <linuxmt/errno.h>
 #include <linuxmt/mm.h>
+#include <linuxmt/memory.h>
 #include <linuxmt/sched.h>
 #include <linuxmt/debug.h>
 #include <linuxmt/mem.h>
 #include <linuxmt/heap.h>
+#include <linuxmt/string.h>
 #include <linuxmt/timer.h>
 #include <linuxmt/init.h>
+#include <linuxmt/trace.h>
+#include <linuxmt/ntty.h>
 
 #include <arch/io.h>
 #include <arch/segment.h>
@@ -35,6 +39,8 @@
 #define DEV_PORT_MINOR		4
 #define DEV_ZERO_MINOR		5
 #define DEV_FULL_MINOR		6       /* unused */
+#define DEV_SCTRACE_MINOR	7
+#define DEV_KMSG_MINOR		8
 
 /*
  * generally useful code...
@@ -221,6 +227,154 @@ size_t kmem_write(struct inode *inode, register struct file *filp, char *data, s
     return len;
 }
 
+static struct heap_stats hstat;
+
+static void heap_stat(heap_s *h)
+{
+    int type = h->tag & HEAP_TAG_TYPE;
+
+    hstat.count[type]++;
+    hstat.size[type] += h->size;
+    if (h->tag == HEAP_TAG_FREE && h->size > hstat.largest_free)
+	hstat.largest_free = h->size;
+}
+
+#define COPYBENCH_JIFFIES	(HZ/4)	/* run time of each copy benchmark */
+
+/* Return KB/s of repeated size byte copies between kbuf and ubuf or seg */
+static unsigned long copy_bench(int op, char *kbuf, char *ubuf, seg_t seg, size_t size)
+{
+    unsigned long bytes = 0;
+    jiff_t start, now;
+
+    start = jiffies;
+    while (jiffies == start)	/* begin on a tick */
+	continue;
+    start = jiffies;
+    do {
+	switch (op) {
+	case 0:
+	    fmemcpyb(0, seg, kbuf, kernel_ds, size);
+	    break;
+	case 1:
+	    fmemcpyb((char *)1, seg, kbuf, kernel_ds, size);
+	    break;
+	case 2:
+	    memcpy_tofs(ubuf, kbuf, size);
+	    break;
+	default:
+	    memcpy_fromfs(kbuf, ubuf, size);
+	    break;
+	}
+	bytes += size;
+    } while ((now = jiffies) - start < COPYBENCH_JIFFIES);
+    return (bytes * HZ / (now - start)) >> 10;
+}
+
+static int kmem_copybench(char *arg)
+{
+    struct copy_bench cb;
+    segment_s *seg;
+    char *kbuf;
+    int err;
+
+    if (!suser())
+	return -EPERM;
+    if ((err = verified_memcpy_fromfs(&cb, arg, sizeof(struct copy_bench))) != 0)
+	return err;
+    if (!cb.size || cb.size > COPYBENCH_MAX)
+	return -EINVAL;
+    if ((err = verify_area(VERIFY_WRITE, cb.buf, cb.size)) != 0)
+	return err;
+    if (!(seg = seg_alloc((cb.size + 1 + 15) >> 4, SEG_FLAG_EXTBUF)))
+	return -ENOMEM;
+    if (!(kbuf = heap_alloc(cb.size, HEAP_TAG_BUFHEAD))) {
+	seg_free(seg);
+	return -ENOMEM;
+    }
+    cb.fmemcpy = copy_bench(0, kbuf, cb.buf, seg->base, cb.size);
+    cb.fmemcpy_odd = copy_bench(1, kbuf, cb.buf, seg->base, cb.size);
+    cb.tofs = copy_bench(2, kbuf, cb.buf, seg->base, cb.size);
+    cb.fromfs = copy_bench(3, kbuf, cb.buf, seg->base, cb.size);
+    heap_free(kbuf);
+    seg_free(seg);
+    return verified_memcpy_tofs(arg, &cb, sizeof(struct copy_bench));
+}
+
+/* Copy the command line of a process from its stack into cmd */
+static void proc_cmdline(struct task_struct *t, char *cmd)
+{
+    seg_t ss = t->t_regs.ss;
+    word_t argc, argv, p = t->t_begstack;
+    char *end = cmd + PROC_CMDLEN - 1;
+    char c;
+
+    argc = peekw(p, ss);
+    while (argc-- > 0 && cmd < end) {
+	p += 2;
+	argv = peekw(p, ss);
+	while (cmd < end && (c = peekb(argv++, ss)) != 0)
+	    *cmd++ = c;
+	if (cmd < end)
+	    *cmd++ = ' ';
+    }
+    *cmd = '\0';
+}
+
+/*
+ * Return a snapshot of the task table. The kernel isn't preempted, so no
+ * task can change state other than from interrupts while this runs.
+ */
+static int kmem_getprocs(char *arg)
+{
+    struct proc_list pl;
+    struct proc_snap ps;
+    struct task_struct *t;
+    segment_s *cseg, *dseg;
+    int n = 0, err;
+
+    if ((err = verified_memcpy_fromfs(&pl, arg, sizeof(struct proc_list))) != 0)
+	return err;
+    if ((err = verify_area(VERIFY_WRITE, pl.procs, pl.max * sizeof(struct proc_snap))) != 0)
+	return err;
+    for_each_task(t) {
+	if (t->state == TASK_UNUSED || t == &task[0])
+	    continue;
+	if (n >= pl.max)
+	    break;
+	memset(&ps, 0, sizeof(ps));
+	ps.pid = t->pid;
+	ps.pgrp = t->pgrp;
+	ps.ppid = t->ppid;
+	ps.uid = t->uid;
+	ps.state = t->state;
+	ps.prio = t->prio;
+	ps.nice = t->nice;
+	ps.tty = t->tty? t->tty->minor: -1;
+#ifdef CONFIG_CPU_USAGE
+	ps.cpu = t->average;
+#endif
+	cseg = t->mm.seg_code;
+	dseg = t->mm.seg_data;
+	if (cseg) {
+	    ps.cseg = cseg->base;
+	    ps.csize = cseg->size;
+	}
+	if (dseg) {
+	    ps.dseg = dseg->base;
+	    ps.dsize = dseg->size;
+	    ps.heap = (word_t)(t->t_endbrk - t->t_enddata);
+	    ps.stack_free = (word_t)(t->t_regs.sp - t->t_endbrk);
+	    if (dseg->flags & SEG_FLAG_SWAPPED)
+		ps.flags |= PROC_SWAPPED;
+	    else if (t->state != TASK_ZOMBIE && t->state != TASK_EXITING)
+		proc_cmdline(t, ps.cmd);
+	}
+	memcpy_tofs(&pl.procs[n++], &ps, sizeof(ps));
+    }
+    return n;
+}
+
 int kmem_ioctl(struct inode *inode, struct file *file, int cmd, char *arg)
 {
     unsigned short retword;
@@ -240,12 +394,72 @@ int kmem_ioctl(struct inode *inode, struct file *file, int cmd, char *arg)
         retword = (unsigned)((long)kernel_init >> 16);
         break;
     case MEM_GETUSAGE:
-	mm_get_usage (&(mu.free_memory), &(mu.used_memory));
+	mm_get_usage (&mu);
 	memcpy_tofs(arg, &mu, sizeof(struct mem_usage));
 	return 0;
     case MEM_GETHEAP:
 	retword = (unsigned short) &_heap_all;
 	break;
+    case MEM_GETHEAPSTAT:
+	memset(&hstat, 0, sizeof(hstat));
+	heap_iterate(heap_stat);
+	memcpy_tofs(arg, &hstat, sizeof(struct heap_stats));
+	return 0;
+    case MEM_GETKSTAT:
+	return verified_memcpy_tofs(arg, &kstat, sizeof(struct kernel_stats));
+#ifdef CONFIG_PROFILE
+    case MEM_PROFSTART: {
+	struct prof_ctl pc;
+	int err;
+
+	if (!suser())
+	    return -EPERM;
+	if ((err = verified_memcpy_fromfs(&pc, arg, sizeof(struct prof_ctl))) != 0)
+	    return err;
+	return profile_start(&pc);
+	}
+    case MEM_PROFSTOP:
+	if (!suser())
+	    return -EPERM;
+	profile_stop();
+	return 0;
+    case MEM_GETPROF: {
+	struct prof_stats ps;
+
+	profile_get_stats(&ps);
+	return verified_memcpy_tofs(arg, &ps, sizeof(struct prof_stats));
+	}
+#endif
+#ifdef CONFIG_FS_DCACHE
+    case MEM_GETDCACHE: {
+	struct dcache_stats ds;
+
+	dcache_get_stats(&ds);
+	memcpy_tofs(arg, &ds, sizeof(struct dcache_stats));
+	return 0;
+	}
+#endif
+#ifdef CONFIG_SEG_COMPACT
+    case MEM_COMPACT:
+	if (!suser())
+	    return -EPERM;
+	retword = seg_compact() >> 6;	/* largest free segment in KB */
+	break;
+#endif
+    case MEM_COPYBENCH:
+	return kmem_copybench(arg);
+    case MEM_GETPROCS:
+	return kmem_getprocs(arg);
+#ifdef CONFIG_SYSCALL_COUNTS
+    case MEM_GETSYSCNT: {
+	int err;
+
+	if ((err = verified_memcpy_tofs(arg, syscall_counts,
+		nr_syscalls * sizeof(unsigned long))) != 0)
+	    return err;
+	return nr_syscalls;
+	}
+#endif
     case MEM_GETUPTIME:
 #ifdef CONFIG_CPU_USAGE
 	retword = (unsigned short) &uptime;
@@ -304,6 +518,32 @@ static struct file_operations kmem_fops = {
     NULL			/* release */
 };
 
+#ifdef CONFIG_SYSCALL_TRACE
+static struct file_operations sctrace_fops = {
+    NULL,			/* lseek */
+    sctrace_read,		/* read */
+    NULL,			/* write */
+    NULL,			/* readdir */
+    NULL,			/* select */
+    sctrace_ioctl,		/* ioctl */
+    NULL,			/* open */
+    sctrace_release		/* release */
+};
+#endif
+
+#ifdef CONFIG_KLOG
+static struct file_operations kmsg_fops = {
+    NULL,			/* lseek */
+    klog_read,			/* read */
+    NULL,			/* write */
+    NULL,			/* readdir */
+    NULL,			/* select */
+    klog_ioctl,			/* ioctl */
+    NULL,			/* open */
+    NULL			/* release */
+};
+#endif
+
 #if UNUSED
 static struct file_operations full_fops = {
     memory_lseek,		/* lseek */
@@ -334,13 +574,25 @@ int memory_open(register struct inode *inode, struct file *filp)
 #endif
 	&zero_fops,	/* DEV_ZERO_MINOR */
 #if UNUSED
-	&full_fops	/* DEV_FULL_MINOR */
+	&full_fops,	/* DEV_FULL_MINOR */
+#else
+	NULL,
+#endif
+#ifdef CONFIG_SYSCALL_TRACE
+	&sctrace_fops,	/* DEV_SCTRACE_MINOR */
+#else
+	NULL,
+#endif
+#ifdef CONFIG_KLOG
+	&kmsg_fops,	/* DEV_KMSG_MINOR */
+#else
+	NULL,
 #endif
     };
     unsigned int minor;
 
     minor = MINOR(inode->i_rdev);
-    if (minor > 5 || !mdev_fops[minor])
+    if (minor >= sizeof(mdev_fops)/sizeof(mdev_fops[0]) || !mdev_fops[minor])
 	return -ENXIO;
     filp->f_op = mdev_fops[minor];
     return 0;
@@ -5,9 +5,12 @@
  *
  * ELKS driver for user space device drivers (UDDs)
  *
- * FIXME This driver is experimental and does NOT currently work.
- * FIXME It uses character device MAJOR_NR to index blk_dev[], must be fixed.
- * FIXME Also requires device parameter to request_fn() routine.
+ * Block devices are served in batches by the driver task, which claims
+ * all queued requests with one META_CLAIM ioctl and completes them with
+ * one META_DONE, see udd.h. Requests are only queued with async I/O.
+ *
+ * FIXME This driver is experimental and character devices do NOT work.
+ * FIXME Only one driver until device parameter passed to request_fn() routine.
  */
 
 #include <linuxmt/config.h>
@@ -19,6 +22,9 @@
 #include <linuxmt/fs.h>
 #include <linuxmt/errno.h>
 #include <linuxmt/mm.h>
+#include <linuxmt/memory.h>
+#include <linuxmt/string.h>
+#include <linuxmt/sched.h>
 #include <linuxmt/udd.h>
 #include <linuxmt/debug.h>
 
@@ -28,8 +34,6 @@
 
 struct ud_driver drivers[MAX_UDD];
 
-struct ud_request requests[MAX_UDR];
-
 static int udd_major = -1;	/* FIXME required until device passed to request_fn*/
 
 static struct ud_driver *get_driver(int major)
@@ -43,92 +47,153 @@ static struct ud_driver *get_driver(int major)
     return NULL;
 }
 
-struct ud_request *new_request(void)
-{
-    register struct ud_request *r = requests;
+/*
+ * Block requests are passed to the driver task in batches, see udd.h.
+ * They stay on the device queue until the task has completed them, so
+ * the request function only has to wake it.
+ */
 
-    do {
-	if (r->udr_status == 0) {
-	    r->udr_status = 1;
-	    return r;
+/* Remove req from the device queue and complete it */
+static void meta_end_request(struct request *req, int uptodate)
+{
+    struct request **rp;
+    struct buffer_head *bh = req->rq_bh;
+    flag_t flags;
+
+    save_flags(flags);
+    clr_irq();
+    for (rp = &blk_dev[udd_major].current_request; *rp; rp = &(*rp)->rq_next) {
+	if (*rp == req) {
+	    *rp = req->rq_next;
+	    break;
 	}
-    } while (++r < &requests[MAX_UDR]);
-    panic("Out of requests\n");
-    return NULL;
+    }
+    restore_flags(flags);
+
+    if (!uptodate)
+	printk("udd: I/O %s error dev %D sector %lu\n",
+	    (req->rq_cmd == WRITE)? "write": "read", req->rq_dev, req->rq_sector);
+    mark_buffer_uptodate(bh, uptodate);
+    unlock_buffer(bh);
+    req->rq_status = RQ_INACTIVE;
+#ifdef CONFIG_ASYNCIO
+    wake_up(&wait_for_request);
+#endif
 }
 
-int post_request(struct ud_driver *driver, struct ud_request *request)
+static int is_claimed(struct ud_driver *driver, struct request *req)
 {
-    if (driver->udd_req != NULL) {
-	printk("Waiting to post a request\n");
-	sleep_on(&driver->udd_rwait);
-    }
-    if (driver->udd_req != NULL) {
-	printk("Signalled, exiting\n");
-	return 1;
-    }
-    driver->udd_req = request;
+    int slot;
+
+    for (slot = 0; slot < UDD_BATCH; slot++)
+	if (driver->udd_claimed[slot] == req)
+	    return 1;
     return 0;
 }
 
+/* Return the first queued block request not yet claimed, or NULL */
+static struct request *next_unclaimed(struct ud_driver *driver, struct request *req)
+{
+    for (; req; req = req->rq_next) {
+	if (req->rq_status == RQ_ACTIVE && !(driver && is_claimed(driver, req)))	/* skip plug */
+	    break;
+    }
+    return req;
+}
 
 static void do_meta_request(void)
 {
     //int major = MAJOR(device);
     int major = udd_major; /* FIXME required until device passed to request_fn*/
     struct ud_driver *driver = get_driver(major);
-    struct ud_request *udr;
-    char *buff;
+    struct request *req;
 
-    printk("do_meta_request %d %x\n", major, blk_dev[major].current_request);
-    if (NULL == driver) {
-	end_request(0);
+    if (driver && driver->udd_task) {
+	wake_up(&driver->udd_wait);
 	return;
     }
-    while (1) {
-	struct request *req = blk_dev[major].current_request;
+    /* no driver task to complete them */
+    while ((req = next_unclaimed(driver, blk_dev[major].current_request)) != NULL)
+	meta_end_request(req, 0);
+}
+
+/*
+ * Wait for block requests and claim up to UDD_BATCH of them. The data of
+ * each write is copied straight from its buffer, which may be in L2, to
+ * the task's data area.
+ */
+static int meta_claim(struct ud_driver *driver, struct ud_batch *arg)
+{
+    struct request *req;
+    struct ud_blkreq br;
+    unsigned int n, slot;
+    int err;
+
+    if ((err = verfy_area(arg, sizeof(struct ud_batch))) != 0)
+	return err;
+    for (;;) {
+	prepare_to_wait_interruptible(&driver->udd_wait);
+	req = next_unclaimed(driver, blk_dev[driver->udd_major].current_request);
 	if (!req)
-	    return;
-	udr = new_request();
-	udr->udr_type = UDR_BLK + req->rq_cmd;
-	udr->udr_ptr = req->rq_sector;
-	udr->udr_minor = MINOR(req->rq_dev);
-	post_request(driver, udr);
-
-	/* Should really check here whether we have a request */
-	if (req->rq_cmd == WRITE) {
-#if UNUSED  /* FIXME Can't do this, copies to the wrong task */
-	    verified_memcpy_tofs(driver->udd_data, buff, BLOCK_SIZE);
-	    fmemcpyw(driver->udd_data, driver->udd_task->mm.dseg,
-	    		buff, kernel_ds, 1024/2);
-#endif
-	}
+	    do_wait();
+	finish_wait(&driver->udd_wait);
+	if (req)
+	    break;
+	if (current->signal)
+	    return -EINTR;
+    }
 
-	/* Wake up the driver so it can deal with the request */
-	wake_up(&driver->udd_wait);
-	printk("request init: wake driver, sleeping\n");
-	sleep_on(&udr->udr_wait);
-	printk("request continue\n");
-
-	/* REQUEST HAS BEEN RETURNED BY USER PROGRAM */
-	/* request must be dealt with and ended */
-	if (udr->udr_status == 1) {
-	    end_request(0);
-	    udr->udr_status = 0;
+    n = 0;
+    for (slot = 0; slot < UDD_BATCH && req; slot++) {
+	if (driver->udd_claimed[slot])
 	    continue;
-	}
-	udr->udr_status = 0;
-	buff = req->rq_buffer;
-	if (req->rq_cmd == READ) {
-#if UNUSED  /* FIXME Can't do this, copies to the wrong task */
-	    verified_memcpy_fromfs(buff, driver->udd_data, BLOCK_SIZE);
-	    fmemcpyw(buff, kernel_ds,
-	    		driver->udd_data, driver->udd_task->mm.dseg, 1024/2);
-#endif
-	}
-	end_request(1);
-	wake_up(&udr->udr_wait);
+	driver->udd_claimed[slot] = req;
+	br.udbr_id = slot;
+	br.udbr_cmd = req->rq_cmd;
+	br.udbr_minor = MINOR(req->rq_dev);
+	br.udbr_sector = req->rq_sector;
+	br.udbr_nr_sectors = req->rq_nr_sectors;
+	br.udbr_data = driver->udd_data + slot * BLOCK_SIZE;
+	br.udbr_status = 0;
+	if (req->rq_cmd == WRITE)
+	    xms_fmemcpyw(br.udbr_data, current->t_regs.ds, req->rq_buffer, req->rq_seg,
+		BLOCK_SIZE/2);
+	memcpy_tofs(&arg->udb_req[n++], &br, sizeof(br));
+	req = next_unclaimed(driver, req->rq_next);
     }
+    if (!n)
+	return -EBUSY;		/* previous batch not returned */
+    put_user(n, &arg->udb_count);
+    return n;
+}
+
+/*
+ * Complete a claimed batch. The data of each good read is copied straight
+ * from the task's data area to its buffer.
+ */
+static int meta_done(struct ud_driver *driver, struct ud_batch *arg)
+{
+    struct request *req;
+    struct ud_blkreq br;
+    unsigned int n, i;
+    int err;
+
+    if ((err = verfy_area(arg, sizeof(struct ud_batch))) != 0)
+	return err;
+    n = get_user(&arg->udb_count);
+    if (n > UDD_BATCH)
+	return -EINVAL;
+    for (i = 0; i < n; i++) {
+	memcpy_fromfs(&br, &arg->udb_req[i], sizeof(br));
+	if (br.udbr_id >= UDD_BATCH || !(req = driver->udd_claimed[br.udbr_id]))
+	    return -EINVAL;
+	driver->udd_claimed[br.udbr_id] = NULL;
+	if (br.udbr_status && req->rq_cmd == READ)
+	    xms_fmemcpyw(req->rq_buffer, req->rq_seg,
+		driver->udd_data + br.udbr_id * BLOCK_SIZE, current->t_regs.ds, BLOCK_SIZE/2);
+	meta_end_request(req, br.udbr_status);
+    }
+    return 0;
 }
 
 void ubd_ioctl(void)
@@ -257,7 +322,7 @@ static int meta_ioctl(struct inode *inode, struct file *filp, int cmd, char *arg
 		goto reg_err;
 	    }
 	} else if (driver->udd_type == UDD_BLK_DEV) {
-	    if ((i = verfy_area(driver->udd_data, 1024)) != 0) {
+	    if ((i = verfy_area(driver->udd_data, UDD_BATCH * BLOCK_SIZE)) != 0) {
 		driver->udd_type = UDD_NONE;
 		return i;
 	    }
@@ -269,6 +334,7 @@ static int meta_ioctl(struct inode *inode, struct file *filp, int cmd, char *arg
 	    blk_dev[driver->udd_major].request_fn = do_meta_request;
 	}
 	printk("device\n");
+	memset(driver->udd_claimed, 0, sizeof(driver->udd_claimed));
 	udd_major = driver->udd_major;	/* FIXME until device passed to request_fn*/
 	driver->udd_task = current;
 	return minor;
@@ -310,6 +376,10 @@ reg_err:
 	wake_up(&driver->udd_req->udr_wait);
 	interruptible_sleep_on(&driver->udd_req->udr_wait);
 	break;
+    case META_CLAIM:
+	return meta_claim(driver, (struct ud_batch *)arg);
+    case META_DONE:
+	return meta_done(driver, (struct ud_batch *)arg);
     default:
 	printk("Bad ioctl\n");
 	return -EINVAL;
@@ -325,9 +395,25 @@ static int meta_open(struct inode *inode, struct file *filp)
 
 static int meta_release(struct inode *inode, struct file *filp)
 {
+    int slot, minor = MINOR(inode->i_rdev);
+    struct ud_driver *driver;
+
     printk("meta_release\n");
 
-    /* Wake up any processes waiting for this driver */
+    /* Fail any block requests left with the driver task */
+    if (minor > 0 && minor <= MAX_UDD) {
+	driver = &drivers[minor - 1];
+	if (driver->udd_task == current && driver->udd_type == UDD_BLK_DEV) {
+	    driver->udd_task = NULL;
+	    for (slot = 0; slot < UDD_BATCH; slot++) {
+		if (driver->udd_claimed[slot]) {
+		    meta_end_request(driver->udd_claimed[slot], 0);
+		    driver->udd_claimed[slot] = NULL;
+		}
+	    }
+	    do_meta_request();
+	}
+    }
     return 0;
 }
 
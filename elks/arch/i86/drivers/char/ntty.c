@@ -262,6 +262,34 @@ int tty_outproc(register struct tty *tty)
     return ch;
 }
 
+/*
+ * Return the number of characters at the output queue tail that need no
+ * output processing and can be copied as a block instead of through
+ * tty_outproc. Stops at the buffer wrap and any character to be expanded.
+ */
+int tty_outrun(register struct tty *tty)
+{
+    int t_oflag = (int)tty->termios.c_oflag;
+    unsigned char *p;
+    int n, i;
+
+    if (tty->ostate)
+        return 0;
+    n = tty->outq.size - tty->outq.tail;
+    if (n > tty->outq.len)
+        n = tty->outq.len;
+    if (!(t_oflag & OPOST))
+        return n;
+
+    p = tty->outq.base + tty->outq.tail;
+    for (i = 0; i < n; i++, p++) {
+        if ((*p == '\n' && (t_oflag & ONLCR)) ||
+            (*p == '\t' && (t_oflag & TABDLY) == XTABS))
+            break;
+    }
+    return i;
+}
+
 static void tty_echo(register struct tty *tty, unsigned char ch)
 {
     if ((tty->termios.c_lflag & ECHO)
@@ -303,8 +331,7 @@ size_t tty_write(struct inode *inode, struct file *file, char *data, size_t len)
                 i = s;
             break;
         }
-        chq_addch_nowakeup(&tty->outq, get_user_char(data++));
-        i++;
+        i += chq_addbuf(&tty->outq, data + i, len - i);
     }
     tty->ops->write(tty);
     wake_up(&tty->outq.wait);
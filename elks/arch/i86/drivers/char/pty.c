@@ -10,6 +10,7 @@
 #include <linuxmt/fcntl.h>
 #include <linuxmt/errno.h>
 #include <linuxmt/mm.h>
+#include <linuxmt/ioctl.h>
 #include <linuxmt/termios.h>
 #include <linuxmt/chqueue.h>
 #include <linuxmt/ntty.h>
@@ -18,6 +19,9 @@
 
 #ifdef CONFIG_PSEUDO_TTY
 
+/* slave queue sizes per pty pair, set by master IOCTL_PTY_SETQ */
+static struct pty_qsize pty_qsize[NR_PTYS];
+
 /* /dev/ptyp0 master (PTY) open */
 int pty_open(struct inode *inode, struct file *file)
 {
@@ -40,8 +44,45 @@ void pty_release(struct inode *inode, struct file *file)
     register struct tty *otty;
 
     debug("pty release\n");
-    if ((otty = determine_tty(inode->i_rdev)))
+    if ((otty = determine_tty(inode->i_rdev))) {
 	kill_pg(otty->pgrp, SIGHUP, 1);
+	pty_qsize[otty->minor - PTY_MINOR_OFFSET].inq = 0;
+	pty_qsize[otty->minor - PTY_MINOR_OFFSET].outq = 0;
+    }
+}
+
+static int pty_qsize_ok(unsigned int size)
+{
+    return size == 0 || (size >= PTYQ_MIN && size <= PTYQ_MAX);
+}
+
+/* /dev/ptyp0 master ioctl, queue sizes take effect on next slave open */
+int pty_ioctl(struct inode *inode, struct file *file, int cmd, char *arg)
+{
+    register struct tty *tty = determine_tty(inode->i_rdev);
+    struct pty_qsize *qs;
+    struct pty_qsize q;
+
+    if (tty == NULL) return -EBADF;
+    qs = &pty_qsize[tty->minor - PTY_MINOR_OFFSET];
+
+    switch (cmd) {
+    case IOCTL_PTY_SETQ:
+	if (verified_memcpy_fromfs(&q, arg, sizeof(q)))
+	    return -EFAULT;
+	if (!pty_qsize_ok(q.inq) || !pty_qsize_ok(q.outq))
+	    return -EINVAL;
+	if (tty->usecount)
+	    return -EBUSY;
+	*qs = q;
+	return 0;
+
+    case IOCTL_PTY_GETQ:
+	q.inq = qs->inq? qs->inq: PTYINQ_SIZE;
+	q.outq = qs->outq? qs->outq: PTYOUTQ_SIZE;
+	return verified_memcpy_tofs(arg, &q, sizeof(q));
+    }
+    return -EINVAL;
 }
 
 /* /dev/ptyp0 master select */
@@ -79,7 +120,7 @@ int pty_select (struct inode *inode, struct file *file, int sel_type)
 size_t pty_read (struct inode *inode, struct file *file, char *data, size_t len)
 {
 	size_t count = 0;
-	int err;
+	int err, n;
 
 	struct tty *tty = determine_tty (inode->i_rdev); /* get slave TTY*/
 	if (tty == NULL) return -EBADF;
@@ -95,6 +136,14 @@ size_t pty_read (struct inode *inode, struct file *file, char *data, size_t len)
 			break;
 		}
 
+		/* copy runs needing no output processing as a block*/
+		n = tty_outrun (tty);
+		if (n) {
+			n = chq_getbuf (&tty->outq, data, n < len - count? n: len - count);
+			data += n;
+			count += n;
+			continue;
+		}
 		put_user_char (tty_outproc (tty), (void *)(data++));
 		count++;
 	}
@@ -121,6 +170,13 @@ size_t pty_write (struct inode *inode, struct file *file, char *data, size_t len
 			break;
 		}
 
+		/* copy as a block when no signal characters are checked*/
+		if (!(tty->termios.c_lflag & ISIG) || !tty->pgrp) {
+			ret = chq_addbuf (&tty->inq, data, len - count);
+			data += ret;
+			count += ret;
+			continue;
+		}
 		ret = get_user_char ((void *)(data++));
 		if (!tty_intcheck(tty, ret))
 			chq_addch_nowakeup (&tty->inq, ret);
@@ -135,9 +191,12 @@ size_t pty_write (struct inode *inode, struct file *file, char *data, size_t len
 /* /dev/ttyp0 slave (TTY) open */
 static int ttyp_open(struct tty *tty)
 {
+	struct pty_qsize *qs = &pty_qsize[tty->minor - PTY_MINOR_OFFSET];
+
 	if (tty->usecount++)
 		return 0;
-	return tty_allocq(tty, PTYINQ_SIZE, PTYOUTQ_SIZE);
+	return tty_allocq(tty, qs->inq? qs->inq: PTYINQ_SIZE,
+		qs->outq? qs->outq: PTYOUTQ_SIZE);
 }
 
 /* /dev/ttyp0 slave (TTY) close */
@@ -165,7 +224,7 @@ static struct file_operations pty_fops = {
     pty_write,
     NULL,
     pty_select,			/* Select - needs doing */
-    NULL,			/* ioctl */
+    pty_ioctl,
     pty_open,
     pty_release
 };
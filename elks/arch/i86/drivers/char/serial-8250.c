@@ -33,6 +33,8 @@ struct serial_info {
 /* flags*/
 #define SERF_TYPE       15
 #define SERF_EXIST      16
+#define SERF_TXINT      32      /* interrupt driven transmit */
+#define SERF_TXFIFO     64      /* transmit FIFO enabled */
 #define ST_8250         0
 #define ST_16450        1
 #define ST_16550        2
@@ -42,6 +44,8 @@ struct serial_info {
 
 #define CONSOLE_PORT 0
 
+#define TX_FIFO_SIZE    16      /* bytes written per THRE interrupt with FIFO */
+
 /* I/O delay settings*/
 #define INB             inb     // use inb_p for 1us delay
 #define OUTB            outb    // use outb_p for 1us delay
@@ -187,99 +191,60 @@ static void update_port(register struct serial_info *port)
     }
 }
 
-/* serial write - busy loops until transmit buffer available */
-static int rs_write(struct tty *tty)
+/*
+ * Move characters from the output queue to the UART while the transmit
+ * holding register or FIFO is empty, and stop THRE interrupts once the
+ * queue is drained. Called with interrupts disabled.
+ */
+static int rs_xmit(register struct serial_info *sp)
 {
-    register struct serial_info *port = &ports[tty->minor - RS_MINOR_OFFSET];
+    struct tty *tty = sp->tty;
+    char *io = sp->io;
+    int n = (sp->flags & SERF_TXFIFO)? TX_FIFO_SIZE: 1;
     int i = 0;
 
-    while (tty->outq.len > 0) {
-        /* Wait until transmitter hold buffer empty */
-        while (!(INB(port->io + UART_LSR) & UART_LSR_THRE))
-                ;
-        outb((char)tty_outproc(tty), port->io + UART_TX);
-        i++;
+    if (INB(io + UART_LSR) & UART_LSR_THRE) {
+        while (tty->outq.len > 0 && i < n) {
+            OUTB((char)tty_outproc(tty), io + UART_TX);
+            i++;
+        }
     }
+    if (tty->outq.len == 0)
+        OUTB(UART_IER_RDI, io + UART_IER);
     return i;
 }
 
-#if defined(CONFIG_FAST_IRQ4) || defined(CONFIG_FAST_IRQ3)
-/* called from timer interrupt - check ring buffer and wakeup waiting processes*/
-void rs_pump(void)
-{
-    struct serial_info *sp;
-    struct ch_queue *q;
-
-#ifdef CONFIG_FAST_IRQ4
-    sp = &ports[0];
-    q = &sp->tty->inq;
-
-    if (sp->tty->usecount && q->len)
-        wake_up(&q->wait);
-#endif
-#ifdef CONFIG_FAST_IRQ3
-    sp = &ports[1];
-    q = &sp->tty->inq;
-
-    if (sp->tty->usecount && q->len)
-        wake_up(&q->wait);
-#endif
-}
-#endif
-
-#ifdef CONFIG_FAST_IRQ4
 /*
- * Fast serial driver for slower machines. Should work up to 38400 baud.
- * No ISIG (tty signal interrupt) handling for shells, used for fast SLIP transfer.
- *
- * Specially-coded fast C interrupt handler, called from asm irq_com[12] after saving
- * scratch registers AX,BX,CX,DX & DS and setting DS to kernel data segment.
- * NOTE: no parameters can be passed, nor any code written which
- * emits code using SP or BP addressing, as SS is not set and not guaranteed to equal DS.
- * Use 'ia16-elfk-objdump -D -r -Mi8086 serial.o' to look at code generated.
+ * Serial write - start interrupt driven transmit. Busy loop until transmit
+ * buffer available when the port has no interrupt handler installed.
  */
-extern void _irq_com1(int irq, struct pt_regs *regs);
-void fast_com1_irq(void)
+static int rs_write(struct tty *tty)
 {
-    struct serial_info *sp = &ports[0];
-    char *io = sp->io;
-    struct ch_queue *q = &sp->tty->inq;
-    unsigned char c;
-
-    c = INB(io + UART_RX);              /* Read received data */
-    if (q->len < q->size) {
-        q->base[q->head] = c;
-        if (++q->head >= q->size)
-            q->head = 0;
-        q->len++;
+    register struct serial_info *port = &ports[tty->minor - RS_MINOR_OFFSET];
+    int i = 0;
+
+    if (port->flags & SERF_TXINT) {
+        clr_irq();
+        if (tty->outq.len > 0) {
+            OUTB(UART_IER_RDI | UART_IER_THRI, port->io + UART_IER);
+            i = rs_xmit(port);
+        }
+        set_irq();
+        return i;
     }
-}
-#endif
 
-#ifdef CONFIG_FAST_IRQ3
-extern void _irq_com2(int irq, struct pt_regs *regs);
-void fast_com2_irq(void)
-{
-    struct serial_info *sp = &ports[1];
-    char *io = sp->io;
-    struct ch_queue *q = &sp->tty->inq;
-    unsigned char c;
-
-    c = INB(io + UART_RX);              /* Read received data */
-    if (q->len < q->size) {
-        q->base[q->head] = c;
-        if (++q->head >= q->size)
-            q->head = 0;
-        q->len++;
+    while (tty->outq.len > 0) {
+        /* Wait until transmitter hold buffer empty */
+        while (!(INB(port->io + UART_LSR) & UART_LSR_THRE))
+                ;
+        outb((char)tty_outproc(tty), port->io + UART_TX);
+        i++;
     }
+    return i;
 }
-#endif
-
-
-#if !defined(CONFIG_FAST_IRQ4) || !defined(CONFIG_FAST_IRQ3)
 
 /*
- * Slower serial interrupt routine, called from _irq_com with passed irq #
+ * Serial interrupt routine, called from _irqit with passed irq #
  * Reads all FIFO data available per interrupt and can provide serial stats
  */
 void rs_irq(int irq, struct pt_regs *regs)
@@ -289,8 +254,12 @@ void rs_irq(int irq, struct pt_regs *regs)
     struct ch_queue *q = &sp->tty->inq;
 
     int status = INB(io + UART_LSR);                    /* check for data overrun*/
-    if ((status & UART_LSR_DR) == 0)                    /* QEMU may interrupt w/no data*/
-        return;
+
+    /* refill transmitter, THRE interrupts are only enabled with SERF_TXINT*/
+    if ((status & UART_LSR_THRE) && (sp->flags & SERF_TXINT)) {
+        if (rs_xmit(sp))
+            wake_up(&sp->tty->outq.wait);
+    }
 
 #if UNUSED      // turn on for serial stats
     if (status & UART_LSR_OE)
@@ -299,19 +268,71 @@ void rs_irq(int irq, struct pt_regs *regs)
         printk("serial: frame/parity error\n");
 #endif
 
-    /* read uart/fifo until empty*/
-    do {
-        unsigned char c = INB(io + UART_RX);            /* Read received data */
-        if (!tty_intcheck(sp->tty, c))
-            chq_addch_nowakeup(q, c);
-    } while (INB(io + UART_LSR) & UART_LSR_DR); /* while data available (for FIFOs)*/
+    /* read uart/fifo until empty, QEMU may interrupt w/no data*/
+    if (status & UART_LSR_DR) {
+        do {
+            unsigned char c = INB(io + UART_RX);        /* Read received data */
+            if (!tty_intcheck(sp->tty, c))
+                chq_addch_nowakeup(q, c);
+        } while (INB(io + UART_LSR) & UART_LSR_DR);     /* while data available (for FIFOs)*/
+    }
 
     if (q->len)         /* don't wakeup unless chars else EINTR result*/
         wake_up(&q->wait);
 }
 
-#endif  // !defined(CONFIG_FAST_IRQ4) || !defined(CONFIG_FAST_IRQ3)
+#ifdef CONFIG_FAST_IRQ
+/* called from timer interrupt - check ring buffers and wakeup waiting processes*/
+void rs_pump(void)
+{
+    register struct serial_info *sp = ports;
 
+    do {
+        if (sp->tty && sp->tty->usecount && sp->tty->inq.len)
+            wake_up(&sp->tty->inq.wait);
+    } while (++sp < &ports[NR_SERIAL]);
+}
+
+/*
+ * Fast serial driver for slower machines, used for fast SLIP transfer.
+ * Empties the whole receive FIFO per interrupt into the port's input queue
+ * without switching stacks. Anything needing more than that is passed on
+ * to rs_irq by returning non-zero: the input queue reaching RS_FAST_WAKEUP
+ * (rs_irq reads the rest of the FIFO and wakes the reader before the next
+ * tick), ISIG processing, and pending transmit or line status interrupts.
+ *
+ * Specially-coded fast C interrupt handler, called from asm _irq_rsfast after saving
+ * scratch registers AX,BX,CX,DX & DS and setting DS to kernel data segment.
+ * NOTE: no parameters can be passed, nor any code written which
+ * emits code using SP or BP addressing, as SS is not set and not guaranteed to equal DS.
+ * Use 'ia16-elfk-objdump -D -r -Mi8086 serial.o' to look at code generated.
+ */
+extern void _irq_rsfast(void);
+unsigned char rs_fast_irqno;            /* set by _irq_rsfast*/
+
+int fast_rs_irq(void)
+{
+    struct serial_info *sp = &ports[(int)irq_to_port[rs_fast_irqno]];
+    char *io = sp->io;
+    struct ch_queue *q = &sp->tty->inq;
+
+    if (sp->tty->termios.c_lflag & ISIG)        /* signal chars need tty_intcheck*/
+        return 1;
+
+    while (INB(io + UART_LSR) & UART_LSR_DR) {
+        unsigned char c = INB(io + UART_RX);    /* Read received data */
+        if (q->len < q->size) {
+            q->base[q->head] = c;
+            if (++q->head >= q->size)
+                q->head = 0;
+            if (++q->len == RS_FAST_WAKEUP)
+                return 1;
+        }
+    }
+
+    return !(INB(io + UART_IIR) & UART_IIR_NO_INT);
+}
+#endif
 
 static void rs_release(struct tty *tty)
 {
@@ -319,7 +340,11 @@ static void rs_release(struct tty *tty)
 
     debug_tty("SERIAL close %P\n");
     if (--tty->usecount == 0) {
+        /* finish output still queued for interrupt driven transmit*/
+        while (tty->outq.len > 0 && (port->flags & SERF_TXINT))
+            continue;
         OUTB(0, port->io + UART_IER);   /* Disable all interrupts */
+        port->flags &= ~(SERF_TXINT | SERF_TXFIFO);
         free_irq(port->irq);
         tty_freeq(tty);
     }
@@ -339,27 +364,21 @@ static int rs_open(struct tty *tty)
     if (tty->usecount++)
         return 0;
 
-    switch(port->irq) {
-#ifdef CONFIG_FAST_IRQ4
-    case 4:
-        err = request_irq(port->irq, (irq_handler) _irq_com1, INT_SPECIFIC);
-        break;
-#endif
-#ifdef CONFIG_FAST_IRQ3
-    case 3:
-        err = request_irq(port->irq, (irq_handler) _irq_com2, INT_SPECIFIC);
-        break;
+#ifdef CONFIG_FAST_IRQ
+    err = request_irq_entry(port->irq, rs_irq, _irq_rsfast);
+#else
+    err = request_irq(port->irq, rs_irq, INT_GENERIC);
 #endif
-    default:
-        err = request_irq(port->irq, rs_irq, INT_GENERIC);
-        break;
-    }
+    if (!err)
+        port->flags |= SERF_TXINT;
     if (err) goto errout;
     irq_to_port[port->irq] = port - ports;      /* Map irq to this tty # */
 
     err = tty_allocq(tty, RSINQ_SIZE, RSOUTQ_SIZE);
     if (err) {
+        free_irq(port->irq);
 errout:
+        port->flags &= ~SERF_TXINT;
         --tty->usecount;
         return err;
     }
@@ -369,8 +388,10 @@ errout:
 
     /* enable FIFO and flush input*/
 #ifdef CONFIG_HW_SERIAL_FIFO
-    if ((port->flags & SERF_TYPE) > ST_16550)
+    if ((port->flags & SERF_TYPE) > ST_16550) {
         OUTB(UART_FCR_ENABLE_FIFO14, port->io + UART_FCR);
+        port->flags |= SERF_TXFIFO;
+    }
 #else
     /* flush input*/
     flush_input(port);
@@ -15,6 +15,8 @@
 #include <linuxmt/major.h>
 #include <linuxmt/fcntl.h>
 #include <linuxmt/mm.h>
+#include <linuxmt/memory.h>
+#include <linuxmt/string.h>
 #include <linuxmt/tcpdev.h>
 #include <linuxmt/debug.h>
 
@@ -22,91 +24,239 @@
 
 #ifdef CONFIG_INET
 
-unsigned char tdin_buf[TCPDEV_INBUFFERSIZE];    /* for reading tcpdev*/
-unsigned char tdout_buf[TCPDEV_OUTBUFFERSIZE];  /* for writing tcpdev*/
+/*
+ * Commands to ktcp and replies from ktcp pass through a ring of TDB_SLOTS
+ * slots in each direction, so that several sockets can have an operation
+ * outstanding at once. Slot headers are kept near, while write and read
+ * payloads live in a far segment allocated on first open, keeping kernel
+ * data small. The out ring is FIFO and read by ktcp one command at a time;
+ * in slots hold a reply until the socket it is addressed to collects it,
+ * oldest first, as a large read is answered in several chunks.
+ */
+struct tdslot {
+    struct socket *sock;                /* owning socket, NULL if free */
+    unsigned int hlen;                  /* header length */
+    unsigned int dlen;                  /* payload length in far segment */
+    unsigned char seq;                  /* reply arrival order */
+    unsigned char hdr[TDB_HDR_MAX];
+};
+
+static struct tdslot tdout[TDB_SLOTS];  /* commands queued for ktcp */
+static struct tdslot tdin[TDB_SLOTS];   /* replies waiting for their socket */
+static unsigned char tdout_head, tdout_count;
+static unsigned char tdin_seq;
 
-sem_t bufin_sem, bufout_sem;    /* Buffer semaphores */
+static segment_s *tdseg;                /* far payload area */
 
-static unsigned int tdin_tail, tdout_tail;
+/* far payload offsets: TDB_SLOTS write areas followed by TDB_SLOTS read areas */
+#define TDOUT_DATA(n)   ((char *)((n) * TDB_WRITE_MAX))
+#define TDIN_DATA(n)    ((char *)(TDB_SLOTS * TDB_WRITE_MAX + (n) * TCPDEV_MAXCHUNK))
+#define TDSEG_PARAS     ((TDB_SLOTS * (TDB_WRITE_MAX + TCPDEV_MAXCHUNK) + 15) >> 4)
 
-static struct wait_queue tcpdevq;
+static struct wait_queue tcpdevq;       /* ktcp waiting for a command */
+static struct wait_queue tdslotq;       /* waiting for a free slot */
 
 char tcpdev_inuse;
 
-char *get_tdout_buf(void)
+/*
+ * Queue a command for ktcp: hlen bytes of kernel header followed by
+ * dlen bytes copied directly from user space into the far payload area,
+ * gathered from the iov array starting skip bytes into iov[0].
+ * Sleeps while the out ring is full.
+ */
+int tcpdev_inetwritev(void *cmd, unsigned int hlen, struct iovec *iov,
+                      unsigned int skip, unsigned int dlen)
+{
+    register struct tdslot *slot;
+    char *dst;
+    unsigned int len;
+    int n;
+
+    debug("TCPDEV(%P) inetwrite %u+%u\n", hlen, dlen);
+    if (hlen > TDB_HDR_MAX || dlen > TDB_WRITE_MAX) {
+        debug_net("TCPDEV(%P) inetwrite len too large %u\n", hlen + dlen);
+        return -EINVAL;
+    }
+
+    while (tdout_count == TDB_SLOTS) {
+        if (!tcpdev_inuse)
+            return -ENETDOWN;
+        sleep_on(&tdslotq);
+    }
+
+    n = tdout_head + tdout_count;
+    if (n >= TDB_SLOTS)
+        n -= TDB_SLOTS;
+    slot = &tdout[n];
+    slot->hlen = hlen;
+    slot->dlen = dlen;
+    memcpy(slot->hdr, cmd, hlen);
+    for (dst = TDOUT_DATA(n); dlen; iov++, skip = 0) {
+        len = iov->iov_len - skip;
+        if (len > dlen)
+            len = dlen;
+        fmemcpyb(dst, tdseg->base, (char *)iov->iov_base + skip, current->t_regs.ds, len);
+        dst += len;
+        dlen -= len;
+    }
+    tdout_count++;
+
+    wake_up(&tcpdevq);
+    return 0;
+}
+
+int tcpdev_inetwrite(void *cmd, unsigned int hlen, char *udata, unsigned int dlen)
+{
+    struct iovec iov;
+
+    iov.iov_base = udata;
+    iov.iov_len = dlen;
+    return tcpdev_inetwritev(cmd, hlen, &iov, 0, dlen);
+}
+
+/* Return the oldest reply ktcp has delivered for sock, or NULL if none yet */
+struct tdb_return_data *tcpdev_find_reply(struct socket *sock)
+{
+    register struct tdslot *slot;
+    struct tdslot *best = NULL;
+
+    for (slot = tdin; slot < &tdin[TDB_SLOTS]; slot++) {
+        if (slot->sock == sock &&
+            (!best || (signed char)(slot->seq - best->seq) < 0))
+            best = slot;
+    }
+    return best? (struct tdb_return_data *)best->hdr: NULL;
+}
+
+/* Copy the payload of a reply from the far segment to user space */
+void tcpdev_reply_data(struct tdb_return_data *ret, char *ubuf, size_t len)
 {
-    down(&bufout_sem);
-    return (char *)tdout_buf;
+    int n = structof(ret, struct tdslot, hdr) - tdin;
+
+    if (len > tdin[n].dlen)
+        len = tdin[n].dlen;
+    fmemcpyb(ubuf, current->t_regs.ds, TDIN_DATA(n), tdseg->base, len);
+}
+
+/* Release the slot of a reply after the socket has consumed it */
+void tcpdev_clear_data_avail(struct tdb_return_data *ret)
+{
+    structof(ret, struct tdslot, hdr)->sock = NULL;
+    wake_up(&tdslotq);
+}
+
+/* Drop any queued reply for a socket being released */
+void tcpdev_drop_replies(struct socket *sock)
+{
+    register struct tdb_return_data *ret;
+
+    while ((ret = tcpdev_find_reply(sock)) != NULL)
+        tcpdev_clear_data_avail(ret);
 }
 
 static size_t tcpdev_read(struct inode *inode, struct file *filp, char *data,
                        unsigned int len)
 {
+    register struct tdslot *slot;
+    int n;
+
     debug("TCPDEV(%P) read %u\n", len);
 
-    while (tdout_tail == 0) {
+    while (tdout_count == 0) {
         if (filp->f_flags & O_NONBLOCK)
             return -EAGAIN;
         interruptible_sleep_on(&tcpdevq);
         if (current->signal) {
-            debug_net("TCPDEV(%P) read RESTARTSYS tdtail %d\n", tdout_tail);
+            debug_net("TCPDEV(%P) read RESTARTSYS\n");
             return -ERESTARTSYS;
         }
     }
 
     /*
-     *  If the userspace tcpip stack requests less data than what is in the
-     *  buffer it will lose data, so the tcpip stack should read BIG.
+     *  If the userspace tcpip stack requests less data than the command
+     *  it will lose data, so the tcpip stack should read BIG.
      */
-    if (len < tdout_tail)
+    slot = &tdout[n = tdout_head];
+    if (len < slot->hlen + slot->dlen) {
         debug_net("TCPDEV(%P) read len too small %u\n", len);
-    else len = tdout_tail;
-    memcpy_tofs(data, tdout_buf, len);
-    tdout_tail = 0;
-    up(&bufout_sem);
-
-    debug("TCPDEV(%P) read retval %u bufout_sem %d\n", len, bufout_sem);
-    //if (bufout_sem > 0)
-        //panic("bufout_sem tragedy");
-    return len;
-}
-
-int tcpdev_inetwrite(void *data, unsigned int len)
-{
-    debug("TCPDEV(%P) inetwrite %u\n", len);
-    if (len > TCPDEV_OUTBUFFERSIZE) {
-        debug_net("TCPDEV(%P) inetwrite len too large %u\n", len);
-        return -EINVAL;
+        if (len < slot->hlen)
+            slot->hlen = len;
+        slot->dlen = len - slot->hlen;
     }
+    memcpy_tofs(data, slot->hdr, slot->hlen);
+    if (slot->dlen)
+        fmemcpyb(data + slot->hlen, current->t_regs.ds, TDOUT_DATA(n), tdseg->base,
+            slot->dlen);
+    len = slot->hlen + slot->dlen;
 
-    /* Data already in tdout_buf buffer */
-    tdout_tail = len;
-    wake_up(&tcpdevq);
-    return 0;
-}
+    if (++tdout_head == TDB_SLOTS)
+        tdout_head = 0;
+    tdout_count--;
+    wake_up(&tdslotq);
 
-void tcpdev_clear_data_avail(void)
-{
-    up(&bufin_sem);
+    debug("TCPDEV(%P) read retval %u queued %d\n", len, tdout_count);
+    return len;
 }
 
 static size_t tcpdev_write(struct inode *inode, struct file *filp,
                         char *data, size_t len)
 {
+    register struct tdslot *slot;
+    struct tdb_return_data *ret;
+    struct tdb_accept_ret hdr;
+    unsigned int hlen;
+
     debug("TCPDEV(%P) write %u\n", len);
-    if (len > TCPDEV_INBUFFERSIZE) {
-        debug_net("TCPDEV(%P) write len too large %u\n", len);
+    if (len < sizeof(struct tdb_return_data) || len > TCPDEV_INBUFFERSIZE) {
+        debug_net("TCPDEV(%P) write bad len %u\n", len);
         return -EINVAL;
     }
-    if (len > 0) {
-        down(&bufin_sem);
 
-        tdin_tail = (unsigned) len;
-        memcpy_fromfs(tdin_buf, data, len);
+    ret = (struct tdb_return_data *)&hdr;
+    memcpy_fromfs(ret, data, sizeof(struct tdb_return_data));
+
+    /* state change notifications are handled at once and need no slot */
+    if (ret->type != TDT_RETURN && ret->type != TDT_ACCEPT && ret->type != TDT_BIND &&
+        ret->type != TDT_RECVFROM) {
+        inet_process_tcpdev((char *)ret, len);
+        return len;
+    }
+
+    /* replies wait in a slot until collected by their socket */
+    for (;;) {
+        for (slot = tdin; slot < &tdin[TDB_SLOTS]; slot++)
+            if (!slot->sock)
+                goto found;
+        interruptible_sleep_on(&tdslotq);
+        if (current->signal)
+            return -EINTR;
+    }
 
-        /* Call the af_inet code to handle the data */
-        inet_process_tcpdev((char *)tdin_buf, len);
+found:
+    if (ret->type == TDT_RETURN || ret->type == TDT_RECVFROM) {
+        hlen = (ret->type == TDT_RETURN)? sizeof(struct tdb_return_data):
+            sizeof(struct tdb_recvfrom_ret);
+        if (len < hlen)
+            return -EINVAL;
+        slot->hlen = hlen;
+        slot->dlen = len - hlen;
+        if (slot->dlen > TCPDEV_MAXCHUNK)
+            slot->dlen = TCPDEV_MAXCHUNK;
+        memcpy_fromfs(slot->hdr, data, hlen);
+        if (slot->dlen)
+            fmemcpyb(TDIN_DATA(slot - tdin), tdseg->base,
+                data + hlen, current->t_regs.ds, slot->dlen);
+    } else {
+        slot->hlen = len > TDB_HDR_MAX ? TDB_HDR_MAX : len;
+        slot->dlen = 0;
+        memcpy_fromfs(slot->hdr, data, slot->hlen);
     }
+    slot->seq = tdin_seq++;
+    slot->sock = ret->sock;
+
+    /* Call the af_inet code to handle the data */
+    inet_process_tcpdev((char *)slot->hdr, len);
+
     debug("TCPDEV(%P) write retval %u\n", len);
     return len;
 }
@@ -118,14 +268,14 @@ static int tcpdev_select(struct inode *inode, struct file *filp, int sel_type)
     switch (sel_type) {
     case SEL_OUT:
         debug("TCPDEV(%P) select SEL_OUT\n");
-        if (bufin_sem == 0)
+        if (tcpdev_find_reply(NULL))    /* free reply slot */
             ret = 1;
         else
-            select_wait(&tcpdevq);
+            select_wait(&tdslotq);
         break;
     case SEL_IN:
         debug("TCPDEV(%P) select SEL_IN\n");
-        if (tdout_tail != 0)
+        if (tdout_count != 0)
             ret = 1;
         else
             select_wait(&tcpdevq);
@@ -148,7 +298,12 @@ static int tcpdev_open(struct inode *inode, struct file *file)
         debug_net("TCPDEV open retval -EBUSY\n");
         return -EBUSY;
     }
-    tdin_tail = tdout_tail = 0;
+    if (!tdseg && !(tdseg = seg_alloc(TDSEG_PARAS, SEG_FLAG_EXTBUF|SEG_FLAG_HIGH))) {
+        debug_net("TCPDEV open retval -ENOMEM\n");
+        return -ENOMEM;
+    }
+    tdout_head = tdout_count = 0;
+    memset(tdin, 0, sizeof(tdin));
     tcpdev_inuse = 1;
     return 0;
 }
@@ -157,6 +312,7 @@ static void tcpdev_release(struct inode *inode, struct file *file)
 {
     debug_net("TCPDEV(%P) release inuse %d\n", tcpdev_inuse);
     tcpdev_inuse = 0;
+    wake_up(&tdslotq);
 }
 
 /*@-type@*/
@@ -177,7 +333,6 @@ static struct file_operations tcpdev_fops = {
 void INITPROC tcpdev_init(void)
 {
     register_chrdev(TCPDEV_MAJOR, "tcpdev", &tcpdev_fops);
-    bufin_sem = bufout_sem = 0;
     tcpdev_inuse = 0;
 }
 
@@ -28,6 +28,7 @@
 #include <linuxmt/netstat.h>
 #include <netinet/in.h>
 #include "eth-msgs.h"
+#include "eth-ring.h"
 
 /* Offsets from base I/O address. */
 #define EL3_DATA 0x00
@@ -102,8 +103,10 @@ static int el3_ioctl(struct inode *, struct file *, unsigned int, unsigned int);
 static int el3_select(struct inode *, struct file *, int);
 static void el3_down();
 static void update_stats();
+static void el3_rx_drain(void);
 void el3_sendpk(int, char *, int);
-void el3_insw(int, char *, int);
+void el3_insw(int, char *, int, seg_t);
+extern int el3_fastio;		/* use REP INSW/OUTSW, 80186 or NEC V20 and up */
 
 extern void el3_mdelay(int);
 extern struct eth eths[];
@@ -121,6 +124,7 @@ static word_t el3_id_port;
 static unsigned char found;
 
 static struct netif_stat netif_stat;
+static struct eth_ring rxring;
 static char model_name[] = "3c509";
 static char dev_name[] = "3c0";
 
@@ -145,6 +149,7 @@ void INITPROC el3_drv_init(void) {
 	ioaddr = net_port;		// temporary
 
 	verbose = (net_flags&ETHF_VERBOSE);
+	el3_fastio = (SETUP_CPU_TYPE >= 2);	/* REP INSW/OUTSW on NEC V20 and 80186 up */
 	if (el3_isa_probe() == 0) {
 		found++;
 		eths[ETH_EL3].stats = &netif_stat;
@@ -371,6 +376,13 @@ static void el3_int(int irq, struct pt_regs *regs)
 					printk("eth: RX discard wait (%x)\n", err);
 					el3_mdelay(1);
 				}
+			} else if (rxring.seg) {
+				el3_rx_drain();
+				/* Leave any packets the ring has no room for in the FIFO
+				 * until the reader catches up */
+				if (!(inw(ioaddr + RX_STATUS) & 0x8000))
+					active_imask &= ~RxComplete;
+				wake_up(&rxwait);
 			} else {
 				wake_up(&rxwait);
 				active_imask &= ~RxComplete;	// Disable RxComplete for now
@@ -522,15 +534,68 @@ static void el3_release(struct inode *inode, struct file *file)
 		outw(0x0f00, ioaddr + WN0_IRQ);
 
 		free_irq(net_irq);
+		eth_ring_close(&rxring);
+	}
+}
+
+
+/*
+ * Move complete packets from the FIFO into the receive ring, until either
+ * is empty. Called from the interrupt handler, or with interrupts blocked.
+ * An erroneous packet stops the loop, it is discarded by the interrupt handler.
+ */
+static void el3_rx_drain(void)
+{
+	char *buf;
+	short rx_status, pkt_len;
+
+	while (!((rx_status = inw(ioaddr + RX_STATUS)) & 0xC000)
+			&& (buf = eth_ring_reserve(&rxring)) != NULL) {
+		pkt_len = rx_status & 0x7ff;
+		el3_insw(ioaddr + RX_FIFO, buf, (pkt_len + 1) >> 1, rxring.seg->base);
+		outw(RxDiscard, ioaddr + EL3_CMD); /* Pop top Rx packet. */
+		eth_ring_commit(&rxring, pkt_len);
+		while (inw(ioaddr + EL3_STATUS) & 0x1000)	/* wait for the pop to complete */
+			;
 	}
 }
 
+/*
+ * Read packets already moved to the receive ring by the interrupt handler
+ */
+static size_t el3_ring_read(struct file *filp, char *data, size_t len)
+{
+	size_t res;
+
+	while (!rxring.count) {
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		prepare_to_wait_interruptible(&rxwait);
+		if (!rxring.count)
+			do_wait();
+		finish_wait(&rxwait);
+		if (current->signal)
+			return -EINTR;
+	}
+	res = eth_ring_read(&rxring, data, len);
+
+	if (!(active_imask & RxComplete)) {	/* FIFO was left with packets */
+		outw(SetIntrEnb | 0x0, ioaddr + EL3_CMD);	// Block interrupts
+		el3_rx_drain();
+		active_imask |= RxComplete;
+		outw(SetIntrEnb | active_imask, ioaddr + EL3_CMD);
+	}
+	return res;
+}
 
 static size_t el3_read(struct inode *inode, struct file *filp, char *data, size_t len)
 {
 	short rx_status;
 	size_t res;
 
+	if (rxring.seg)
+		return el3_ring_read(filp, data, len);
+
 	while(1) {
 		
 		rx_status = inw(ioaddr + RX_STATUS);
@@ -565,7 +630,7 @@ static size_t el3_read(struct inode *inode, struct file *filp, char *data, size_
 			res = -EIO;
 		} else {
 			short pkt_len = rx_status & 0x7ff;
-			el3_insw(ioaddr + RX_FIFO, data, (pkt_len + 1) >> 1); //Word size
+			el3_insw(ioaddr + RX_FIFO, data, (pkt_len + 1) >> 1, current->t_regs.ds); //Word size
 
 			outw(RxDiscard, ioaddr + EL3_CMD); /* Pop top Rx packet. */
 			res = pkt_len;
@@ -626,6 +691,8 @@ static int el3_open(struct inode *inode, struct file *file)
 		printk(EMSG_IRQERR, model_name, net_irq, err);
 		return err;
 	}
+	/* without a receive ring, packets are read from the FIFO by read() */
+	eth_ring_open(&rxring);
 	EL3WINDOW(0);
 	/* Activating the board - done in _init, repeat doesn't harm */
 	outw(ENABLE_ADAPTER, ioaddr + WN0_CONF_CTRL);
@@ -757,6 +824,12 @@ static int el3_ioctl(struct inode *inode, struct file *file, unsigned int cmd, u
 			/* Return the entire netif_struct */
 			err = verified_memcpy_tofs((char *)arg, &netif_stat, sizeof(netif_stat));
 			break;
+
+		case IOCTL_ETH_RXBATCH:
+			if (!rxring.seg)
+				err = -EINVAL;
+			else rxring.batch = (arg != 0);
+			break;
 		
 		default:
 			err = -EINVAL;
@@ -791,7 +864,7 @@ int el3_select(struct inode *inode, struct file *filp, int sel_type)
 		case SEL_IN:
 
 			// Don't use RxComplete for this test, it has been masked out!
-			if (inw(ioaddr+RX_STATUS) & 0x8000) {
+			if (rxring.seg? !rxring.count: inw(ioaddr+RX_STATUS) & 0x8000) {
 				//printk("s%x", inw(ioaddr+RX_STATUS));
 				select_wait(&rxwait);
 				break;
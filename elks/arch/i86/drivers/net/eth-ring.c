@@ -0,0 +1,114 @@
+/*
+ * Ethernet receive ring, filled by the NIC interrupt handlers
+ * and emptied by read() on /dev/eth, see eth-ring.h.
+ *
+ * The ring is only changed by the interrupt handler of its NIC
+ * and by the reading process with interrupts disabled, so no
+ * further locking is needed. Frames are copied out before their
+ * space is released, with interrupts enabled.
+ */
+
+#include <arch/irq.h>
+#include <linuxmt/errno.h>
+#include <linuxmt/sched.h>
+#include <linuxmt/limits.h>
+#include <linuxmt/mm.h>
+#include <linuxmt/memory.h>
+#include "eth-ring.h"
+
+/*
+ * Allocate the ring when the device is first opened.
+ * Drivers fall back to reading the NIC directly if this fails.
+ */
+int eth_ring_open(struct eth_ring *r)
+{
+	r->head = r->tail = r->used = 0;
+	r->count = r->batch = 0;
+	if (!r->seg && !(r->seg = seg_alloc(ETH_RING_SIZE >> 4, SEG_FLAG_EXTBUF|SEG_FLAG_HIGH)))
+		return -ENOMEM;
+	return 0;
+}
+
+void eth_ring_close(struct eth_ring *r)
+{
+	if (r->seg) {
+		seg_put(r->seg);
+		r->seg = NULL;
+	}
+	r->count = 0;
+}
+
+/*
+ * Return the far offset in r->seg at which the interrupt handler can store
+ * a frame of up to MAX_PACKET_ETH bytes, or NULL if the ring is full.
+ * Must be followed by eth_ring_commit if a frame was stored.
+ */
+char *eth_ring_reserve(struct eth_ring *r)
+{
+	unsigned int room;
+
+	if (!r->count)		/* empty, restart at the front */
+		r->head = r->tail = r->used = 0;
+	room = ETH_RING_SIZE - r->head;
+	if (room < ETH_RING_FRAME) {
+		if (r->used + room + ETH_RING_FRAME > ETH_RING_SIZE)
+			return NULL;
+		if (room >= 2)
+			pokew(r->head, r->seg->base, 0);	/* wrap mark */
+		r->used += room;
+		r->head = 0;
+	} else if (r->used + ETH_RING_FRAME > ETH_RING_SIZE)
+		return NULL;
+	return (char *)(r->head + 2);
+}
+
+void eth_ring_commit(struct eth_ring *r, size_t len)
+{
+	unsigned int n = (2 + len + 1) & ~1;
+
+	pokew(r->head, r->seg->base, len);
+	r->head += n;
+	r->used += n;
+	r->count++;
+}
+
+/*
+ * Copy queued frames to the user buffer. Normally a single frame is returned,
+ * truncated to len. In batch mode as many frames as fit are returned in the
+ * ring format: a length word followed by the frame, padded to an even size.
+ * Returns the number of bytes copied, 0 if no frame is queued.
+ */
+size_t eth_ring_read(struct eth_ring *r, char *data, size_t len)
+{
+	size_t total = 0;
+	unsigned int flen, rec, n;
+
+	while (r->count) {
+		if (ETH_RING_SIZE - r->tail < 2 || !(flen = peekw(r->tail, r->seg->base))) {
+			clr_irq();
+			r->used -= ETH_RING_SIZE - r->tail;
+			r->tail = 0;
+			set_irq();
+			continue;
+		}
+		rec = (2 + flen + 1) & ~1;
+		if (r->batch) {
+			if (total + 2 + flen > len && total)
+				break;
+			n = (rec > len - total)? len - total: rec;
+			fmemcpyb(data + total, current->t_regs.ds, (char *)r->tail, r->seg->base, n);
+			total += n;
+		} else {
+			total = (flen > len)? len: flen;
+			fmemcpyb(data, current->t_regs.ds, (char *)r->tail + 2, r->seg->base, total);
+		}
+		clr_irq();
+		r->tail += rec;
+		r->used -= rec;
+		r->count--;
+		set_irq();
+		if (!r->batch)
+			break;
+	}
+	return total;
+}
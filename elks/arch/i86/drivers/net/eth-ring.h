@@ -0,0 +1,32 @@
+#ifndef ETH_RING_H
+#define ETH_RING_H
+
+/*
+ * Receive ring shared by the ethernet drivers
+ *
+ * The interrupt handler moves frames off the NIC into a far segment as
+ * they arrive, so the NIC buffer doesn't overflow while ktcp is busy.
+ * Each frame is stored as a length word followed by the frame data,
+ * padded to an even length. A frame never wraps; when the room left at
+ * the end is too small for a maximal frame, a zero length word marks the
+ * wrap point and the next frame starts at offset 0.
+ */
+
+#define ETH_RING_FRAME	(2 + MAX_PACKET_ETH)	/* room reserved per frame */
+
+struct eth_ring {
+	segment_s *seg;		/* frame storage, NULL if not allocated */
+	unsigned int head;	/* where the next frame is stored */
+	unsigned int tail;	/* oldest frame not yet read */
+	unsigned int used;	/* bytes in use including skipped ring end */
+	unsigned char count;	/* frames queued */
+	unsigned char batch;	/* read returns as many frames as fit */
+};
+
+int    eth_ring_open(struct eth_ring *r);
+void   eth_ring_close(struct eth_ring *r);
+char  *eth_ring_reserve(struct eth_ring *r);
+void   eth_ring_commit(struct eth_ring *r, size_t len);
+size_t eth_ring_read(struct eth_ring *r, char *data, size_t len);
+
+#endif /* !ETH_RING_H */
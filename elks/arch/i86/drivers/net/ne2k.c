@@ -10,6 +10,7 @@
  */
 
 #include <arch/io.h>
+#include <arch/irq.h>
 #include <linuxmt/errno.h>
 #include <linuxmt/major.h>
 #include <linuxmt/ioctl.h>
@@ -22,6 +23,7 @@
 #include <linuxmt/debug.h>
 #include <linuxmt/netstat.h>
 #include "eth-msgs.h"
+#include "eth-ring.h"
 
 // Shared declarations between low and high parts
 
@@ -43,14 +45,80 @@ static unsigned int verbose;
 static struct wait_queue rxwait;
 static struct wait_queue txwait;
 static struct netif_stat netif_stat;
+static struct eth_ring rxring;
+
+/*
+ * Transmit buffers in NIC memory. With two, a frame is loaded while
+ * the previous one is on the wire, and started by the TX interrupt.
+ */
+static unsigned char tx_bufs;	/* number of transmit buffers, 1 or 2 */
+static unsigned char tx_cur;	/* buffer on the wire or last sent */
+static word_t tx_wait_len;	/* frame loaded in the other buffer, 0 if none */
+
+#define TX_PAGE(n)	(NE2K_TX_FIRST + (n) * NE2K_TX_PAGES)
 static byte_t model_name[] = "ne2k";
 static byte_t dev_name[] = "ne0";
 
 extern int ne2k_next_pk;
 extern word_t ne2k_flags;
 extern word_t ne2k_has_data;
+extern word_t ne2k_rx_seg;
+extern byte_t ne2k_rx_first;
 extern struct eth eths[];
 
+/*
+ * Move received packets from the NIC buffer into the receive ring,
+ * until either is empty. Called from the interrupt handler,
+ * or with the NIC interrupt disabled.
+ */
+
+static void ne2k_rx_drain(void)
+{
+	char *buf;
+	size_t size;
+	word_t nhdr[2];
+
+	while (ne2k_has_data && (buf = eth_ring_reserve(&rxring)) != NULL) {
+		size = ne2k_pack_get(buf, MAX_PACKET_ETH, nhdr);
+		if ((nhdr[0]&~0x7f21) || (nhdr[0] == 0)) {
+			/* Garbage from the NIC, purge its buffer - see ne2k_read */
+			netif_stat.rq_errors++;
+			if (verbose) printk(EMSG_DMGPKT, dev_name, nhdr[0], nhdr[1]);
+			ne2k_rx_init();
+			break;
+		}
+		eth_ring_commit(&rxring, size);
+	}
+}
+
+/*
+ * Read packets already moved to the receive ring by the interrupt handler
+ */
+
+static size_t ne2k_ring_read(struct file *filp, char *data, size_t len)
+{
+	size_t res;
+
+	while (!rxring.count) {
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		prepare_to_wait_interruptible(&rxwait);
+		if (!rxring.count)
+			do_wait();
+		finish_wait(&rxwait);
+		if (current->signal)
+			return -EINTR;
+	}
+	res = eth_ring_read(&rxring, data, len);
+
+	if (ne2k_has_data) {	/* NIC has packets left over from a full ring */
+		disable_irq(net_irq);
+		ne2k_rx_drain();
+		enable_irq(net_irq);
+	}
+	return res;
+}
+
 /*
  * Read a complete packet from the NIC buffer
  */
@@ -60,6 +128,9 @@ static size_t ne2k_read(struct inode *inode, struct file *filp, char *data, size
 	size_t res;
 	word_t nhdr[2];	/* buffer header from the NIC, for debugging */
 
+	if (rxring.seg)
+		return ne2k_ring_read(filp, data, len);
+
 	while (1) {
 		size_t size;  // actual packet size
 
@@ -99,7 +170,7 @@ static size_t ne2k_read(struct inode *inode, struct file *filp, char *data, size
 			 */
 
 			netif_stat.rq_errors++;
-			printk("$%04x.%02x$", ne2k_getpage(), ne2k_next_pk&0xff);
+			printk(KERN_DEBUG "$%04x.%02x$", ne2k_getpage(), ne2k_next_pk&0xff);
 			if (verbose) printk(EMSG_DMGPKT, dev_name, nhdr[0], nhdr[1]);
 
 #if 0
@@ -122,6 +193,38 @@ static size_t ne2k_read(struct inode *inode, struct file *filp, char *data, size
 	return res;
 }
 
+/*
+ * Start the frame waiting in the other transmit buffer if the previous one is
+ * done. Called with interrupts disabled or from the interrupt handler.
+ */
+
+static void ne2k_tx_kick(void)
+{
+	if (tx_wait_len && ne2k_tx_stat() == NE2K_STAT_TX) {
+		tx_cur ^= 1;
+		ne2k_tx_start(TX_PAGE(tx_cur), tx_wait_len);
+		tx_wait_len = 0;
+	}
+}
+
+/*
+ * Return 1 if no transmit is in progress, 2 if a transmit is in progress
+ * but the other buffer is free, 0 if both buffers are in use.
+ */
+
+static int ne2k_tx_free(void)
+{
+	int idle;
+
+	clr_irq();
+	ne2k_tx_kick();
+	idle = (ne2k_tx_stat() == NE2K_STAT_TX);
+	set_irq();
+	if (idle)
+		return 1;
+	return (tx_bufs == 2 && !tx_wait_len)? 2: 0;
+}
+
 /*
  * Pass packet to driver for send
  */
@@ -129,12 +232,13 @@ static size_t ne2k_read(struct inode *inode, struct file *filp, char *data, size
 static size_t ne2k_write(struct inode *inode, struct file *file, char *data, size_t len)
 {
 	size_t res;
+	int free, n;
 
 	while (1) {
 		prepare_to_wait_interruptible(&txwait);
 
 		// tx_stat() checks the command reg, not the tx_status_reg!
-		if (ne2k_tx_stat() != NE2K_STAT_TX) {
+		if (!(free = ne2k_tx_free())) {
 
 			if (file->f_flags & O_NONBLOCK) {
 				res = -EAGAIN;
@@ -145,12 +249,27 @@ static size_t ne2k_write(struct inode *inode, struct file *file, char *data, siz
 				res = -EINTR;
 				break;
 			}
+			if (!(free = ne2k_tx_free()))
+				continue;
 		}
 
 		if (len > MAX_PACKET_ETH) len = MAX_PACKET_ETH;
 
 		if (len < 64) len = 64;  /* issue #133 */
-		ne2k_pack_put(data, len);
+		if (free == 1) {
+			ne2k_pack_put(data, len, TX_PAGE(tx_cur));
+			ne2k_tx_start(TX_PAGE(tx_cur), len);
+		} else {
+			n = tx_cur ^ 1;
+			ne2k_pack_put(data, len, TX_PAGE(n));
+			clr_irq();
+			if (ne2k_tx_stat() == NE2K_STAT_TX) {	/* finished while loading */
+				tx_cur = n;
+				ne2k_tx_start(TX_PAGE(n), len);
+			} else
+				tx_wait_len = len;	/* started by the TX interrupt */
+			set_irq();
+		}
 
 		res = len;
 		break;
@@ -170,7 +289,7 @@ int ne2k_select(struct inode *inode, struct file *filp, int sel_type)
 
 	switch (sel_type) {
 		case SEL_OUT:
-			if (ne2k_tx_stat() != NE2K_STAT_TX) {
+			if (!ne2k_tx_free()) {
 				select_wait(&txwait);
 				break;
 			}
@@ -179,7 +298,7 @@ int ne2k_select(struct inode *inode, struct file *filp, int sel_type)
 
 		case SEL_IN:
 			//if (ne2k_rx_stat() != NE2K_STAT_RX) {
-			if (!ne2k_has_data) {
+			if (rxring.seg? !rxring.count: !ne2k_has_data) {
 				select_wait(&rxwait);
 				break;
 			}
@@ -194,10 +313,18 @@ int ne2k_select(struct inode *inode, struct file *filp, int sel_type)
 
 
 /*
- * Interrupt handler
+ * Interrupt handler. The NIC's interrupts are masked and its work is
+ * left to ne2k_bh, so other devices aren't held off while packets are
+ * copied from the NIC.
  */
 
 static void ne2k_int(int irq, struct pt_regs *regs)
+{
+	outb(0, net_port + EN0_IMR);
+	mark_bh(NET_BH);
+}
+
+static void ne2k_bh(void)
 {
 	word_t stat, page;
 
@@ -207,7 +334,7 @@ static void ne2k_int(int irq, struct pt_regs *regs)
 		if (!stat) break; 	/* If zero, we're done! */
 #if 0	/* debug */
 		page = ne2k_getpage();
-		printk("$%04x.%02x$", page,ne2k_next_pk&0xff);
+		printk(KERN_DEBUG "$%04x.%02x$", page,ne2k_next_pk&0xff);
 #endif
         	if (stat & NE2K_STAT_OF) {
 			netif_stat.oflow_errors++;
@@ -217,21 +344,26 @@ static void ne2k_int(int irq, struct pt_regs *regs)
 			debug_eth("/CB%04x/ ", page);
 			//printk("%04x/ ", page);
 
-			if (ne2k_has_data)
+			if (ne2k_has_data) {
+				if (rxring.seg) ne2k_rx_drain();
 				wake_up(&rxwait);
+			}
+			ne2k_tx_kick();		/* the NIC stop may have ended a transmit */
 			break; 
 		}
 
 		if (stat & NE2K_STAT_RX) {
+			outb(NE2K_STAT_RX, net_port + EN0_ISR); // Clear intr bit
 			ne2k_has_data = 1; 	// data available
+			if (rxring.seg) ne2k_rx_drain();
 			wake_up(&rxwait);
-			outb(NE2K_STAT_RX, net_port + EN0_ISR); // Clear intr bit
 		}
 
 		if (stat & NE2K_STAT_TX) {
 			outb(NE2K_STAT_TX, net_port + EN0_ISR); // Clear intr bit
 			inb(net_port + EN0_TSR);
 			//ne2k_get_tx_stat();	// clear the TX bit in the ISR 
+			ne2k_tx_kick();
 			wake_up(&txwait);
 		}
 		debug_eth("%02X/%d/", stat, ne2k_has_data);
@@ -258,6 +390,8 @@ static void ne2k_int(int irq, struct pt_regs *regs)
 			netif_stat.tx_errors++;
 			k = ne2k_get_tx_stat();	// read tx status reg to keep the NIC happy
 			if (verbose) printk(EMSG_TXERR, dev_name, k);
+			ne2k_tx_kick();		/* aborted transmit, send the next one */
+			wake_up(&txwait);
 		}
 
 		/* RXErrors occur almost exclusively when using an 8 bit interface.
@@ -280,6 +414,10 @@ static void ne2k_int(int irq, struct pt_regs *regs)
 	}
 	//printk(".%02x", ne2k_int_stat());
 	stat = page;		/* to keep compiler happy */
+
+	/* unmask again, unless closed meanwhile; RXE only with an 8 bit interface */
+	if (usecount)
+		outb((ne2k_flags & ETHF_8BIT_BUS)? 0x1f: 0x1b, net_port + EN0_IMR);
 }
 
 /*
@@ -312,6 +450,12 @@ static int ne2k_ioctl(struct inode *inode, struct file *file, unsigned int cmd,
 			err = verified_memcpy_tofs((char *)arg, &netif_stat, sizeof(netif_stat));
 			break;
 
+		case IOCTL_ETH_RXBATCH:
+			if (!rxring.seg)
+				err = -EINVAL;
+			else rxring.batch = (arg != 0);
+			break;
+
 		default:
 			err = -EINVAL;
 
@@ -329,11 +473,18 @@ static int ne2k_open(struct inode *inode, struct file *file)
 		return -ENODEV;
 
 	if (usecount++ == 0) {	// Don't initialize if already open
-		int err = request_irq(net_irq, ne2k_int, INT_GENERIC);
+		int err;
+
+		init_bh(NET_BH, ne2k_bh);
+		err = request_irq(net_irq, ne2k_int, INT_GENERIC);
 		if (err) {
 			printk(EMSG_IRQERR, dev_name, net_irq, err);
 			return err;
 		}
+		/* without a receive ring, packets are read from the NIC by read() */
+		ne2k_rx_seg = eth_ring_open(&rxring)? 0: rxring.seg->base;
+		tx_cur = 0;
+		tx_wait_len = 0;
 		ne2k_reset();
 		ne2k_init();
 		ne2k_start();
@@ -350,6 +501,8 @@ static void ne2k_release(struct inode *inode, struct file *file)
 	if (--usecount == 0) {
 		ne2k_stop();
 		free_irq(net_irq);
+		ne2k_rx_seg = 0;
+		eth_ring_close(&rxring);
 	}
 }
 
@@ -511,6 +664,9 @@ void INITPROC ne2k_drv_init(void)
 			ne2k_flags |= net_flags&0xf;		/* asm code uses this */
 			printk(" (%dk buffer)", 4<<(net_flags&0x3));
 		}
+		/* two transmit buffers unless a 4k NIC buffer is forced */
+		tx_bufs = ((ne2k_flags & (ETHF_4K_BUF|ETHF_8K_BUF|ETHF_16K_BUF)) == ETHF_4K_BUF)? 1: 2;
+		ne2k_rx_first = TX_PAGE(tx_bufs);
 		printk(", flags 0x%02x\n", net_flags);
 
 #if DEBUG_ETH
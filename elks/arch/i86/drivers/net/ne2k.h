@@ -13,6 +13,10 @@
 #define NE2K_STAT_CNT   0x0020  /* Tally counter overflow */
 #define NE2K_STAT_RDC   0x0040  /* Remote DMA complete */
 
+/* Transmit buffers at the start of NIC memory, ahead of the receive ring */
+#define NE2K_TX_FIRST	0x40	/* first page of transmit buffer 0 */
+#define NE2K_TX_PAGES	6	/* pages per transmit buffer, one full frame */
+
 /* 8390 Page 0 register offsets (from net_port) */
 #define EN0_STARTPG	0x01U	/* Starting page of ring bfr WR */
 #define EN0_STOPPG	0x02U	/* Ending page +1 of ring bfr WR */
@@ -44,7 +48,8 @@ extern word_t ne2k_rx_stat();
 extern word_t ne2k_tx_stat();
 
 extern word_t ne2k_pack_get(char *, word_t, word_t *);
-extern word_t ne2k_pack_put(char *, word_t);
+extern word_t ne2k_pack_put(char *, word_t, word_t);
+extern void   ne2k_tx_start(word_t, word_t);
 
 extern word_t ne2k_test();
 
@@ -9,6 +9,7 @@
  */
 
 #include <arch/io.h>
+#include <arch/irq.h>
 #include <arch/ports.h>
 #include <arch/segment.h>
 #include <linuxmt/memory.h>
@@ -23,6 +24,7 @@
 #include <linuxmt/debug.h>
 #include <linuxmt/netstat.h>
 #include "eth-msgs.h"
+#include "eth-ring.h"
 
 /* runtime configuration set in /bootopts or defaults in ports.h */
 #define net_irq		(netif_parms[ETH_WD].irq)
@@ -150,11 +152,13 @@ static unsigned int verbose;
 
 static unsigned char current_rx_page;
 static struct netif_stat netif_stat;
+static struct eth_ring rxring;
 
 static word_t wd_rx_stat(void);
+static unsigned char wd_rx_page(void);
 static word_t wd_tx_stat(void);
 static void wd_int(int irq, struct pt_regs * regs);
-static void fmemcpy(void *, seg_t, void *, seg_t, size_t, int);
+static void fmemcpy(void *, seg_t, void *, seg_t, size_t);
 
 extern struct eth eths[];
 
@@ -343,10 +347,10 @@ static void wd_clr_oflow(int keep)
 }
 
 /*
- * Get packet
+ * Get packet, copying it to data in segment seg
  */
 
-static size_t wd_pack_get(char *data, size_t len)
+static size_t wd_pack_get(char *data, seg_t seg, size_t len)
 {
 	const e8390_pkt_hdr __far *rxhdr;
 	word_t hdr_start;
@@ -395,14 +399,14 @@ static size_t wd_pack_get(char *data, size_t len)
 		if (res > len) res = len;
 		if (current_rx_page > this_frame || current_rx_page == WD_FIRST_RX_PG) {
 			/* no wrap around */
-			fmemcpy(data, current->t_regs.ds,
-				(char *)hdr_start + sizeof(e8390_pkt_hdr), net_ram, res, is_8bit);
+			fmemcpy(data, seg,
+				(char *)hdr_start + sizeof(e8390_pkt_hdr), net_ram, res);
 		} else {	/* handle wrap-around */
 			size_t len1 = ((stop_page - this_frame) << 8) - sizeof(e8390_pkt_hdr);
-			fmemcpy(data, current->t_regs.ds,
-				(char *)hdr_start + sizeof(e8390_pkt_hdr), net_ram, len1, is_8bit);
-			fmemcpy(data+len1, current->t_regs.ds,
-				(char *)(WD_FIRST_RX_PG << 8), net_ram, res-len1, is_8bit);
+			fmemcpy(data, seg,
+				(char *)hdr_start + sizeof(e8390_pkt_hdr), net_ram, len1);
+			fmemcpy(data+len1, seg,
+				(char *)(WD_FIRST_RX_PG << 8), net_ram, res-len1);
  		}
 	} while (0);
 
@@ -416,11 +420,63 @@ static size_t wd_pack_get(char *data, size_t len)
 	return res;
 }
 
+/*
+ * Move received packets from the NIC into the receive ring, until either
+ * is empty. Called from the interrupt handler, or with the NIC interrupt disabled.
+ */
+
+static void wd_rx_drain(void)
+{
+	char *buf;
+	size_t res;
+	unsigned char rxing_page = wd_rx_page();
+
+	/* frames up to the last read rx page are complete, only re-read it when caught up */
+	while ((current_rx_page != rxing_page || current_rx_page != (rxing_page = wd_rx_page()))
+			&& (buf = eth_ring_reserve(&rxring)) != NULL) {
+		res = wd_pack_get(buf, rxring.seg->base, MAX_PACKET_ETH);
+		if ((int)res < 0)
+			break;
+		eth_ring_commit(&rxring, res);
+	}
+}
+
+/*
+ * Read packets already moved to the receive ring by the interrupt handler
+ */
+
+static size_t wd_ring_read(struct file * filp, char * data, size_t len)
+{
+	size_t res;
+
+	while (!rxring.count) {
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		prepare_to_wait_interruptible(&rxwait);
+		if (!rxring.count)
+			do_wait();
+		finish_wait(&rxwait);
+		if (current->signal)
+			return -EINTR;
+	}
+	res = eth_ring_read(&rxring, data, len);
+
+	if (wd_rx_stat() == WD_STAT_RX) {	/* NIC has packets left over from a full ring */
+		disable_irq(net_irq);
+		wd_rx_drain();
+		enable_irq(net_irq);
+	}
+	return res;
+}
+
 static size_t wd_read(struct inode * inode, struct file * filp,
 	char * data, size_t len)
 {
 	size_t res = 0;
 
+	if (rxring.seg)
+		return wd_ring_read(filp, data, len);
+
 	do {
 		prepare_to_wait_interruptible(&rxwait);
 		if (wd_rx_stat() != WD_STAT_RX) {
@@ -434,7 +490,7 @@ static size_t wd_read(struct inode * inode, struct file * filp,
 				break;
 			}
 		}
-		res = wd_pack_get(data, len);	/* returns packet data size read */
+		res = wd_pack_get(data, current->t_regs.ds, len);	/* returns packet data size read */
 	} while (0);
 
 	finish_wait(&rxwait);
@@ -453,7 +509,7 @@ static size_t wd_pack_put(char *data, size_t len)
 		if (len < 64U) len = 64U;  /* issue #133 */
 
 		fmemcpy((byte_t *)((WD_FIRST_TX_PG - WD_START_PG) << 8U),
-			net_ram, data, current->t_regs.ds, len, is_8bit);
+			net_ram, data, current->t_regs.ds, len);
 		outb(E8390_NODMA | E8390_PAGE0, WD_8390_PORT + E8390_CMD);
 
 #if REMOVE
@@ -501,19 +557,24 @@ static size_t wd_write(struct inode * inode, struct file * file,
  * Test for readiness
  */
 
-static word_t wd_rx_stat(void)
+/* Get the rx page (incoming packet pointer). */
+static unsigned char wd_rx_page(void)
 {
 	unsigned char rxing_page;
 
 	clr_irq();	// FIXME: don't need this, just block
 			// our own interrupts
-	/* Get the rx page (incoming packet pointer). */
 	outb(E8390_NODMA | E8390_PAGE1, WD_8390_PORT + E8390_CMD);
 	rxing_page = inb(WD_8390_PORT + EN1_CURPAG);
 	outb(E8390_NODMA | E8390_PAGE0, WD_8390_PORT + E8390_CMD);
 	set_irq();
 
-	return (current_rx_page == rxing_page) ? 0U : WD_STAT_RX;
+	return rxing_page;
+}
+
+static word_t wd_rx_stat(void)
+{
+	return (current_rx_page == wd_rx_page()) ? 0U : WD_STAT_RX;
 }
 
 static word_t wd_tx_stat(void)
@@ -535,7 +596,7 @@ static int wd_select(struct inode * inode, struct file * filp, int sel_type)
 			res = 1;
 			break;
 		case SEL_IN:
-			if (wd_rx_stat() != WD_STAT_RX) {
+			if (rxring.seg? !rxring.count: wd_rx_stat() != WD_STAT_RX) {
 				select_wait(&rxwait);
 				break;
 			}
@@ -582,6 +643,12 @@ static int wd_ioctl(struct inode * inode, struct file * file,
 		err = verified_memcpy_tofs((char *)arg, &netif_stat, sizeof(netif_stat));
 		break;
 
+	case IOCTL_ETH_RXBATCH:
+		if (!rxring.seg)
+			err = -EINVAL;
+		else rxring.batch = (arg != 0);
+		break;
+
 	default:
 		err = -EINVAL;
 	}
@@ -608,6 +675,8 @@ static int wd_open(struct inode * inode, struct file * file)
 			printk(EMSG_IRQERR, dev_name, net_irq, err);
 			break;
 		}
+		/* without a receive ring, packets are read from the NIC by read() */
+		eth_ring_open(&rxring);
 		wd_init_8390(0);
 		wd_start();
 	} while (0);
@@ -624,6 +693,7 @@ static void wd_release(struct inode * inode, struct file * file)
 		wd_stop();
 		wd_reset();
 		free_irq(net_irq);
+		eth_ring_close(&rxring);
 	}
 }
 
@@ -674,8 +744,9 @@ static void wd_int(int irq, struct pt_regs * regs)
 			continue; /* Everything has been reset, skip rest of the loop */
 		}
 		if (stat & ENISR_RX) {
-			wake_up(&rxwait);
 			outb(ENISR_RX, WD_8390_PORT + EN0_ISR);
+			if (rxring.seg) wd_rx_drain();
+			wake_up(&rxwait);
 		}
 		if (stat & ENISR_TX) {
 			wake_up(&txwait);
@@ -732,12 +803,15 @@ void INITPROC wd_drv_init(void)
 }
 
 /* Using this wrapper saves 44 bytes of RAM */
-/* Using word transfers when possible improves transfer time ~10%
- * on large packets (measured @ 1200 bytes) */
-static void fmemcpy(void *dst_off, seg_t dst_seg, void *src_off, seg_t src_seg, size_t count, int type) {
-
-	if (type == is_8bit)
-		fmemcpyb(dst_off, dst_seg, src_off, src_seg, count);
-	else
-		fmemcpyw(dst_off, dst_seg, src_off, src_seg, (count+1)>>1);
+/* Using word transfers improves transfer time ~10% on large packets
+ * (measured @ 1200 bytes). They are used on 8 bit boards too, where
+ * the bus splits each word into two byte cycles, saving the per byte
+ * instruction overhead. An odd last byte is copied alone so the
+ * destination is never overrun. */
+static void fmemcpy(void *dst_off, seg_t dst_seg, void *src_off, seg_t src_seg, size_t count) {
+
+	fmemcpyw(dst_off, dst_seg, src_off, src_seg, count >> 1);
+	if (count & 1)
+		fmemcpyb((char *)dst_off + count - 1, dst_seg,
+			(char *)src_off + count - 1, src_seg, 1);
 }
@@ -2,7 +2,7 @@
 #include <linuxmt/sched.h>
 
 extern int TASK_KRNL_SP, TASK_USER_DS, TASK_USER_AX, TASK_USER_SS;
-extern int TASK_USER_BX, TASK_USER_SI, TASK_USER_DI;
+extern int TASK_USER_BX, TASK_USER_SI, TASK_USER_DI, TASK_SIGNAL;
 
 void asm_offsets(void)
 {
@@ -13,5 +13,6 @@ void asm_offsets(void)
     TASK_USER_BX = offsetof(struct task_struct, t_regs.bx);
     TASK_USER_SI = offsetof(struct task_struct, t_regs.si);
     TASK_USER_DI = offsetof(struct task_struct, t_regs.di);
+    TASK_SIGNAL  = offsetof(struct task_struct, signal);
 }
 
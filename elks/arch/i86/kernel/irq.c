@@ -22,6 +22,7 @@
 #include <linuxmt/timer.h>
 #include <linuxmt/types.h>
 #include <linuxmt/heap.h>
+#include <linuxmt/mem.h>
 
 #include <arch/ports.h>
 #include <arch/segment.h>
@@ -30,6 +31,19 @@
 static irq_handler irq_action [16];
 static void *irq_trampoline [16];
 
+/* Further handlers of IRQs requested with INT_SHARED, called in turn */
+struct irq_chain {
+    irq_handler handler;
+    struct irq_chain *next;
+};
+
+static struct irq_chain *irq_chain [16];
+static unsigned int irq_shared;         /* bit set for each shared IRQ */
+
+/* Bottom halves, run on return from interrupt, see do_bottom_halves */
+static bh_handler bh_base [NR_BH];
+unsigned int bh_active;                 /* bit set for each marked bottom half */
+
 // TODO: simplify the whole by replacing IRQ by INT number
 // Would also allow to handle any of the 0..255 interrupts
 // including the 0..7 processor exceptions & traps
@@ -47,9 +61,65 @@ typedef struct int_handler int_handler_s;
 void do_IRQ(int i,void *regs)
 {
     irq_handler ih = irq_action [i];
+
+    if ((unsigned)i < KSTAT_IRQS)
+        kstat.irqs[i]++;
     if (!ih)
         printk("Unexpected interrupt: %u\n", i);
-    else (*ih)(i, regs);
+    else {
+        struct irq_chain *c;
+
+        (*ih)(i, regs);
+        for (c = irq_chain [i]; c; c = c->next)
+            (*c->handler)(i, regs);
+    }
+}
+
+/*
+ * Bottom halves let an interrupt handler only acknowledge its hardware
+ * and leave the rest of its work for later. A bottom half marked by
+ * mark_bh runs from _irqit after the interrupt controller has been
+ * sent EOI, with interrupts enabled, before any task switch. Bottom
+ * halves never run nested in an interrupt handler or in each other.
+ */
+void init_bh(int nr, bh_handler routine)
+{
+    bh_base [nr] = routine;
+}
+
+void mark_bh(int nr)
+{
+    flag_t flags;
+
+    save_flags(flags);
+    clr_irq();
+    bh_active |= 1 << nr;
+    restore_flags(flags);
+}
+
+/* called by _irqit with interrupts enabled when bh_active is set */
+void do_bottom_halves(void)
+{
+    static int running;
+    unsigned int active, mask;
+    bh_handler *bh;
+
+    if (running)
+        return;
+    running = 1;
+    for (;;) {
+        clr_irq();
+        active = bh_active;
+        bh_active = 0;
+        set_irq();
+        if (!active)
+            break;
+        for (bh = bh_base, mask = 1; bh < &bh_base [NR_BH]; bh++, mask <<= 1) {
+            if ((active & mask) && *bh)
+                (*bh)();
+        }
+    }
+    running = 0;
 }
 
 // Add a dynamically allocated handler
@@ -75,14 +145,18 @@ static int int_handler_add (int irq, int vect, int_proc proc, int_handler_s *h)
     return 0;
 }
 
-int request_irq(int irq, irq_handler handler, int hflag)
+/*
+ * Install handler for irq, entered through proc from the interrupt vector.
+ * A specific proc may either return from the interrupt itself, or jump
+ * to _irqit with the stack as it was on entry to have handler called.
+ */
+int request_irq_entry(int irq, irq_handler handler, int_proc proc)
 {
     int_handler_s *h;
-    int_proc proc;
     flag_t flags;
 
     irq = remap_irq(irq);
-    if (irq < 0 || !handler) return -EINVAL;
+    if (irq < 0 || !handler || !proc) return -EINVAL;
 
     if (irq_action [irq]) return -EBUSY;
     h = handler_alloc();
@@ -94,11 +168,6 @@ int request_irq(int irq, irq_handler handler, int hflag)
     irq_action [irq] = handler;
     irq_trampoline [irq] = h;
 
-    if (hflag == INT_SPECIFIC)
-        proc = (int_proc) handler;
-    else
-        proc = _irqit;
-
     // TODO: IRQ number has no meaning for an INT handler
     // see above simplification TODO
     int_handler_add (irq, irq_vector (irq), proc, h);
@@ -109,8 +178,55 @@ int request_irq(int irq, irq_handler handler, int hflag)
     return 0;
 }
 
+/*
+ * Add handler to an IRQ shared by several devices. Every handler of a
+ * shared IRQ is called on each interrupt and must check its own device.
+ */
+static int request_shared_irq(int irq, irq_handler handler)
+{
+    struct irq_chain *c;
+    flag_t flags;
+    int i, err;
+
+    i = remap_irq(irq);
+    if (i < 0 || !handler) return -EINVAL;
+
+    if (!irq_action [i]) {
+        err = request_irq_entry(irq, handler, _irqit);
+        if (!err) irq_shared |= 1 << i;
+        return err;
+    }
+    if (!(irq_shared & (1 << i))) return -EBUSY;
+
+    c = (struct irq_chain *) heap_alloc (sizeof (struct irq_chain), HEAP_TAG_INTHAND);
+    if (!c) return -ENOMEM;
+    c->handler = handler;
+
+    save_flags(flags);
+    clr_irq();
+    c->next = irq_chain [i];
+    irq_chain [i] = c;
+    restore_flags(flags);
+    return 0;
+}
+
+int request_irq(int irq, irq_handler handler, int hflag)
+{
+    int_proc proc;
+
+    if (hflag == INT_SHARED)
+        return request_shared_irq(irq, handler);
+    if (hflag == INT_SPECIFIC)
+        proc = (int_proc) handler;
+    else
+        proc = _irqit;
+
+    return request_irq_entry(irq, handler, proc);
+}
+
 int free_irq(int irq)
 {
+    struct irq_chain *c, *next;
     flag_t flags;
 
     irq = remap_irq(irq);
@@ -126,9 +242,50 @@ int free_irq(int irq)
     disable_irq(irq);
     int_vector_set(irq_vector(irq), 0, 0);  /* reset vector to 0:0 */
     irq_action[irq] = NULL;
+    irq_shared &= ~(1 << irq);
+    c = irq_chain[irq];
+    irq_chain[irq] = NULL;
     restore_flags(flags);
 
     heap_free(irq_trampoline[irq]);
+    for (; c; c = next) {
+        next = c->next;
+        heap_free(c);
+    }
+    return 0;
+}
+
+/* Remove one handler of a shared IRQ, freeing the IRQ with the last one */
+int free_shared_irq(int irq, irq_handler handler)
+{
+    struct irq_chain *c, **pc;
+    flag_t flags;
+    int i;
+
+    i = remap_irq(irq);
+    if (i < 0 || !(irq_shared & (1 << i))) return -EINVAL;
+
+    save_flags(flags);
+    clr_irq();
+    if (irq_action[i] == handler) {
+        if (!(c = irq_chain[i])) {
+            restore_flags(flags);
+            return free_irq(irq);
+        }
+        irq_action[i] = c->handler;     /* first chained handler takes over */
+        irq_chain[i] = c->next;
+    } else {
+        for (pc = &irq_chain[i]; (c = *pc) != NULL; pc = &c->next)
+            if (c->handler == handler) break;
+        if (!c) {
+            restore_flags(flags);
+            return -EINVAL;
+        }
+        *pc = c->next;
+    }
+    restore_flags(flags);
+
+    heap_free(c);
     return 0;
 }
 
@@ -37,6 +37,10 @@ awk '/^#/{next;}
 
    str = "\t.word sys_" $1;
    line[callno] = sprintf("%-25s // %3d", str, callno);
+
+   for (i = 4; i <= NF; i++)
+      if ( $i == "fast" && callno < 256 )
+         fast[callno] = 1;
 }
 END{
    for (maxstd=maxno; depends_on[maxstd]!=""; maxstd--)
@@ -80,14 +84,33 @@ END{
          printf "#endif\n"
       }
    }
+
+   print "\nsys_call_table_end:\n"
+   print ".set sys_call_len, (sys_call_table_end - sys_call_table)/2\n"
+
+   # bit n%8 of byte n/8 set for each call n marked fast
+   print "\t.global sys_call_fast"
+   print "sys_call_fast:"
+   for (b = 0; b < 32; b++)
+   {
+      v = 0;
+      for (i = 7; i >= 0; i--)
+         v = v * 2 + ((b * 8 + i) in fast);
+      printf "\t.byte 0x%02x%20s // %3d-%3d\n", v, "", b * 8, b * 8 + 7;
+   }
 }
 '
 
 cat <<'.eof'
 
-sys_call_table_end:
-
-.set sys_call_len, (sys_call_table_end - sys_call_table)/2
+#ifdef CONFIG_SYSCALL_COUNTS
+	.global nr_syscalls
+	.global syscall_counts
+nr_syscalls:
+	.word sys_call_len
+syscall_counts:				// 32-bit call count per syscall
+	.skip sys_call_len*4,0
+#endif
 
 //	Dispatch a syscall (called from syscall_int)
 //	Entry: ax=function code, stack contains parameters
@@ -98,9 +121,16 @@ sys_call_table_end:
 
 syscall:
 	cmp  $sys_call_len,%ax
-	ja   _no_syscall
+	jae  _no_syscall
 	// look up address and jump to function
 	mov  %ax,%bx
+#ifdef CONFIG_SYSCALL_COUNTS
+	shl  $1,%bx
+	shl  $1,%bx               // multiply by 4
+	addw $1,syscall_counts(%bx)
+	adcw $0,syscall_counts+2(%bx)
+	mov  %ax,%bx
+#endif
         add  %ax,%bx              // multiply by 2
         jmp    *sys_call_table(%bx)
 
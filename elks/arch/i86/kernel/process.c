@@ -79,7 +79,7 @@ void stack_check(void)
  *  so we fork onto our kernel stack.
  */
 
-void kfork_proc(void (*addr)())
+struct task_struct *kfork_proc(void (*addr)())
 {
     register struct task_struct *t;
 
@@ -89,6 +89,7 @@ void kfork_proc(void (*addr)())
     t->t_regs.ds = t->t_regs.es = t->t_regs.ss = kernel_ds;
     if (addr)
         arch_build_stack(t, addr);
+    return t;
 }
 
 /*
@@ -66,7 +66,8 @@ int do_signal(void)
 	    debug_sig("SIGNAL setup return stack for handler %x:%x\n",
 		      _FP_SEG(sah), _FP_OFF(sah));
 	    arch_setup_sighandler_stack(currentp, sah, signr);
-	    *sd = SIGDISP_DFL;
+	    if (*sd == SIGDISP_CUSTOM)			/* One shot handler */
+		*sd = SIGDISP_DFL;
 	    debug_sig("SIGNAL reset pending signals\n");
 	    clr_irq();		/* stop race between reset signal and return to user */
 	    currentp->signal &= ~mask;
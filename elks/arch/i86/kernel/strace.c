@@ -4,11 +4,134 @@
 #include <linuxmt/trace.h>
 #include <linuxmt/mm.h>
 #include <linuxmt/string.h>
+#include <linuxmt/timer.h>
+#include <linuxmt/mem.h>
+#include <linuxmt/fs.h>
+#include <linuxmt/fcntl.h>
+#include <linuxmt/errno.h>
+#include <linuxmt/limits.h>
+
+#include <arch/irq.h>
+#include <arch/param.h>
 
 /*
  * Kernel tracing functions for consistency checking and debugging support
  */
 
+#ifdef CONFIG_SYSCALL_TRACE
+/*
+ * System call latency trace. Each traced syscall leaves an entry in a
+ * ring of SCTRACE_ENTRIES, overwriting the oldest when the reader falls
+ * behind. The syscalls of the reading process itself are not traced.
+ */
+static struct sctrace_ent sctrace_ring[SCTRACE_ENTRIES];
+static unsigned int sctrace_head;       /* entries written */
+static unsigned int sctrace_tail;       /* entries read */
+static unsigned int sctrace_lost;
+static pid_t sctrace_pid;               /* reader, 0 when tracing is off */
+static struct wait_queue sctrace_wait;
+
+static void sctrace_begin(void)
+{
+    __ptask currentp = current;
+    flag_t flags;
+
+    if (!sctrace_pid || currentp->pid == sctrace_pid) {
+        currentp->sc_jiffies = 0;
+        return;
+    }
+    save_flags(flags);
+    clr_irq();
+    currentp->sc_jiffies = jiffies;
+    currentp->sc_count = timer_get_count();
+    restore_flags(flags);
+}
+
+static void sctrace_end(int retval)
+{
+    __ptask currentp = current;
+    struct sctrace_ent *e;
+    jiff_t now;
+    unsigned int count;
+    flag_t flags;
+
+    if (!currentp->sc_jiffies || !sctrace_pid)
+        return;
+    save_flags(flags);
+    clr_irq();
+    now = jiffies;
+    count = timer_get_count();
+    e = &sctrace_ring[sctrace_head & (SCTRACE_ENTRIES - 1)];
+    e->callno = currentp->t_regs.orig_ax;
+    e->pid = currentp->pid;
+    e->jiffies = currentp->sc_jiffies;
+    e->count = currentp->sc_count;
+    e->retval = retval;
+    e->duration = (now - currentp->sc_jiffies) * timer_tick_counts() + count - currentp->sc_count;
+    if (++sctrace_head - sctrace_tail > SCTRACE_ENTRIES) {
+        sctrace_tail = sctrace_head - SCTRACE_ENTRIES;
+        sctrace_lost++;
+    }
+    restore_flags(flags);
+    wake_up(&sctrace_wait);
+}
+
+size_t sctrace_read(struct inode *inode, struct file *filp, char *data, size_t len)
+{
+    struct sctrace_ent e;
+    size_t n = 0;
+    flag_t flags;
+
+    while (sctrace_head == sctrace_tail) {
+        if (filp->f_flags & O_NONBLOCK)
+            return -EAGAIN;
+        prepare_to_wait_interruptible(&sctrace_wait);
+        if (sctrace_head == sctrace_tail)
+            do_wait();
+        finish_wait(&sctrace_wait);
+        if (current->signal)
+            return -EINTR;
+    }
+    while (len - n >= sizeof(e) && sctrace_head != sctrace_tail) {
+        save_flags(flags);
+        clr_irq();
+        e = sctrace_ring[sctrace_tail++ & (SCTRACE_ENTRIES - 1)];
+        restore_flags(flags);
+        memcpy_tofs(data + n, &e, sizeof(e));
+        n += sizeof(e);
+    }
+    return n;
+}
+
+int sctrace_ioctl(struct inode *inode, struct file *filp, int cmd, char *arg)
+{
+    struct sctrace_ctl ctl;
+    int err;
+
+    if (cmd != MEM_SCTRACE)
+        return -EINVAL;
+    if (!suser())
+        return -EPERM;
+    if ((err = verified_memcpy_fromfs(&ctl, arg, sizeof(ctl))) != 0)
+        return err;
+    if (ctl.enable) {
+        sctrace_head = sctrace_tail = sctrace_lost = 0;
+        sctrace_pid = current->pid;
+    } else
+        sctrace_pid = 0;
+    ctl.lost = sctrace_lost;
+    ctl.ticks_per_jiffy = timer_tick_counts();
+    ctl.usecs_per_jiffy = 1000000L / HZ;
+    return verified_memcpy_tofs(arg, &ctl, sizeof(ctl));
+}
+
+void sctrace_release(struct inode *inode, struct file *filp)
+{
+    if (sctrace_pid == current->pid)
+        sctrace_pid = 0;
+}
+#endif /* CONFIG_SYSCALL_TRACE */
+
 #ifdef CONFIG_TRACE
 
 /* The table describing the system calls has been moved to a separate
@@ -133,11 +256,18 @@ static void check_kstack(int n)
 }
 #endif
 
+#endif /* CONFIG_TRACE */
+
+#if defined(CONFIG_TRACE) || defined(CONFIG_SYSCALL_TRACE)
 /*
  * Called before syscall entry
  */
 void trace_begin(void)
 {
+#ifdef CONFIG_SYSCALL_TRACE
+    sctrace_begin();
+#endif
+#ifdef CONFIG_TRACE
 #if defined(CONFIG_STRACE) || defined(CHECK_KSTACK)
     if (tracing & (TRACE_STRACE|TRACE_KSTACK))
         memset(current->t_kstack, 0x55, KSTACK_BYTES-32);
@@ -146,6 +276,7 @@ void trace_begin(void)
     if (tracing & TRACE_STRACE)
         strace();
 #endif
+#endif /* CONFIG_TRACE */
 }
 
 /*
@@ -155,9 +286,16 @@ void trace_begin(void)
  */
 void trace_end(unsigned int retval)
 {
+#ifdef CONFIG_TRACE
     __ptask currentp = current;
     int n;
     static int max;
+#endif
+
+#ifdef CONFIG_SYSCALL_TRACE
+    sctrace_end(retval);
+#endif
+#ifdef CONFIG_TRACE
 
     /* Check for kernel stack overflow */
     if (currentp->kstack_magic != KSTACK_MAGIC) {
@@ -183,6 +321,6 @@ void trace_end(unsigned int retval)
     }
     if (tracing & TRACE_KSTACK)
         check_kstack(n);
-}
-
 #endif /* CONFIG_TRACE */
+}
+#endif
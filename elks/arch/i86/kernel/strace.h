@@ -157,6 +157,7 @@ struct sc_info elks_table1[] = {
     ENTRY(0,                packinfo(0, P_NONE,   P_NONE,    P_NONE   )),
     ENTRY(0,                packinfo(0, P_NONE,   P_NONE,    P_NONE   )),
     ENTRY("uname",          packinfo(1, P_PDATA,  P_NONE,    P_NONE   )),   // 74
+    ENTRY("spawnfork",      packinfo(0, P_NONE,   P_NONE,    P_NONE   )),   // 75
 };
 
 #define START_TABLE2  198
@@ -10,9 +10,12 @@
 
 #include <arch/segment.h>
 #include <arch/io.h>
+#include <arch/irq.h>
+#include <arch/system.h>
 
 
 byte_t sys_caps;		/* system capabilities bits */
+byte_t memcpy_dwords;	/* use 32-bit string moves in fmemcpy, 386+ only */
 unsigned int heapsize;	/* max size of kernel near heap */
 
 void INITPROC setup_arch(seg_t *start, seg_t *end)
@@ -73,8 +76,14 @@ void INITPROC setup_arch(seg_t *start, seg_t *end)
 	byte_t arch_cpu = SETUP_CPU_TYPE;
 	if (arch_cpu > 5)		/* IBM PC/AT capabilities */
 		sys_caps = CAP_ALL;
+	if (arch_cpu == 0xFF)		/* 386 or later */
+		memcpy_dwords = 1;
 	debug("arch %d sys_caps %02x\n", arch_cpu, sys_caps);
 #endif
+
+#if defined(CONFIG_APM) && defined(CONFIG_ARCH_IBMPC)
+	apm_init();
+#endif
 }
 
 /*
@@ -92,28 +101,86 @@ void hard_reset_now(void)
 #endif
 }
 
+#if defined(CONFIG_APM) && defined(CONFIG_ARCH_IBMPC)
 /*
- *	Use Advanced Power Management to power off system
+ *	Advanced Power Management BIOS calls
  *	For details on how this code works, see
  *	http://wiki.osdev.org/APM
  */
+#define APM_SIGNATURE	0x504D		/* 'PM' */
+#define APM_IDLE_SLOWS	0x0004		/* CPU Idle slows the clock, call CPU Busy */
+
+static byte_t apm_connected;		/* real mode interface connected */
+static byte_t apm_idle_ok;		/* CPU Idle call works */
+static byte_t apm_idle_slows;
+
+/* call APM function ax, return nonzero on error */
+static int apm_call(unsigned int ax, unsigned int *bx, unsigned int *cx)
+{
+    unsigned int b = *bx, c = *cx;
+
+    asm volatile ("int $0x15\n\t"
+		  "sbb %%ax,%%ax\n\t"		/* -1 on carry */
+		  : "+a" (ax), "+b" (b), "+c" (c)
+		  :
+		  : "dx", "si", "di", "memory", "cc");
+    *bx = b;
+    *cx = c;
+    return ax;
+}
+
+/* connect the real mode interface for CPU idle calls */
+void INITPROC apm_init(void)
+{
+    unsigned int bx = 0, cx = 0;
+
+    if (apm_call(0x5300, &bx, &cx) || bx != APM_SIGNATURE)
+	return;
+    apm_idle_slows = (cx & APM_IDLE_SLOWS) != 0;
+    bx = 0;
+    if (apm_call(0x5301, &bx, &cx))
+	return;
+    apm_connected = apm_idle_ok = 1;
+}
+#endif
+
+/*
+ * Wait for the next interrupt with interrupts enabled, through the APM
+ * CPU Idle call if the BIOS has one, as it may also slow the clock.
+ */
+void idle_cpu(void)
+{
+#if defined(CONFIG_APM) && defined(CONFIG_ARCH_IBMPC)
+    unsigned int bx = 0, cx = 0;
+
+    if (apm_idle_ok) {
+	if (!apm_call(0x5305, &bx, &cx)) {
+	    if (apm_idle_slows)
+		apm_call(0x5306, &bx, &cx);
+	    return;
+	}
+	apm_idle_ok = 0;		/* not supported, use HLT from now on */
+    }
+#endif
+    idle_halt();
+}
+
+/*
+ *	Use Advanced Power Management to power off system
+ */
 void apm_shutdown_now(void)
 {
 #if defined(CONFIG_APM) && defined(CONFIG_ARCH_IBMPC)
-    asm("movw $0x5301,%ax\n\t"
-	"xorw %bx,%bx\n\t"
-	"int $0x15\n\t"
-	"jc apm_error\n\t"
-	"movw $0x5308,%ax\n\t"
-	"movw $1,%bx\n\t"
-	"movw $1,%cx\n\t"
-	"int $0x15\n\t"
-	"jc apm_error\n\t"
-	"movw $0x5307,%ax\n\t"
-	"movw $1,%bx\n\t"
-	"movw $3,%cx\n\t"
-	"int $0x15\n\t"
-	"apm_error:\n\t"
-	);
+    unsigned int bx = 0, cx = 0;
+
+    if (!apm_connected && apm_call(0x5301, &bx, &cx))
+	return;
+    bx = 1;
+    cx = 1;
+    if (apm_call(0x5308, &bx, &cx))	/* enable power management */
+	return;
+    bx = 1;
+    cx = 3;
+    apm_call(0x5307, &bx, &cx);		/* all devices off */
 #endif
 }
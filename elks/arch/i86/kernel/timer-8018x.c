@@ -48,6 +48,19 @@ void enable_timer_tick(void)
     outw(0xe009, PCB_T1CON);
 }
 
+#if defined(CONFIG_SYSCALL_TRACE) || defined(CONFIG_TIME_USEC)
+/* Return the milliseconds counted by Timer1 since the last jiffy */
+unsigned int timer_get_count(void)
+{
+    return inw(PCB_T1CNT);
+}
+
+unsigned int timer_tick_counts(void)
+{
+    return TIMER1_INTERVAL;
+}
+#endif
+
 void disable_timer_tick(void)
 {
     /* Disable Timer2, release inhibit to change EN bit */
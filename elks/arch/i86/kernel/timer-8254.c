@@ -4,7 +4,6 @@
  * This file contains code used for the 8253/8254 PIT only.
  */
 
-#include <linuxmt/config.h>
 #include <linuxmt/config.h>
 #include <linuxmt/mm.h>
 #include <linuxmt/memory.h>
@@ -32,6 +31,7 @@
 
 #define TIMER_MODE0 0x30   /* timer 0, binary count, mode 0, lsb/msb */
 #define TIMER_MODE2 0x34   /* timer 0, binary count, mode 2, lsb/msb */
+#define TIMER_LATCH 0x00   /* timer 0, latch count for reading */
 
 #ifdef CONFIG_ARCH_IBMPC
 #define TIMER_LO_BYTE (__u8)(((5+(11931818L/(HZ)))/10)%256)
@@ -45,6 +45,8 @@
 #define TIMER_HI_BYTE_8M (__u8)(((5+(19968000L/(HZ)))/10)/256)
 #endif
 
+static unsigned int tick_count;	/* timer counts per jiffy */
+
 void enable_timer_tick(void)
 {
     /* set the clock frequency */
@@ -53,6 +55,7 @@ void enable_timer_tick(void)
 #ifdef CONFIG_ARCH_IBMPC
     outb (TIMER_LO_BYTE, TIMER_DATA_PORT);	/* LSB */
     outb (TIMER_HI_BYTE, TIMER_DATA_PORT);	/* MSB */
+    tick_count = TIMER_LO_BYTE | (TIMER_HI_BYTE << 8);
 #endif
 
 #ifdef CONFIG_ARCH_PC98
@@ -60,14 +63,82 @@ void enable_timer_tick(void)
 	printk("Timer clock frequncy for 8MHz system is set.\n");
 	outb (TIMER_LO_BYTE_8M, TIMER_DATA_PORT);   /* LSB */
 	outb (TIMER_HI_BYTE_8M, TIMER_DATA_PORT);   /* MSB */
+	tick_count = TIMER_LO_BYTE_8M | (TIMER_HI_BYTE_8M << 8);
     } else {
 	printk("Timer clock frequncy for 5MHz system is set.\n");
 	outb (TIMER_LO_BYTE_5M, TIMER_DATA_PORT);   /* LSB */
 	outb (TIMER_HI_BYTE_5M, TIMER_DATA_PORT);   /* MSB */
+	tick_count = TIMER_LO_BYTE_5M | (TIMER_HI_BYTE_5M << 8);
     }
 #endif
 }
 
+#ifdef CONFIG_TIMER_TICKLESS
+/* Longest period in jiffies the 16-bit counter can be programmed for */
+unsigned int timer_max_ticks(void)
+{
+    return 0xFFFFU / tick_count;
+}
+
+/*
+ * Restart the timer with one interrupt every n jiffies.
+ * Called with interrupts disabled.
+ */
+void timer_set_ticks(unsigned int n)
+{
+    unsigned int count = n * tick_count;
+
+    outb (TIMER_MODE2, TIMER_CMDS_PORT);
+    outb ((__u8)count, TIMER_DATA_PORT);	/* LSB */
+    outb ((__u8)(count >> 8), TIMER_DATA_PORT);	/* MSB */
+}
+
+/*
+ * Return the jiffies elapsed, rounded to nearest, in the current period
+ * of n jiffies. A timer interrupt still pending at the controller counts
+ * as n - 1, the interrupt itself accounts for the last one.
+ * Called with interrupts disabled.
+ */
+unsigned int timer_ticks_elapsed(unsigned int n)
+{
+    unsigned int count;
+
+    outb (0x0A, PIC1_CMD);			/* OCW3: read IRR */
+    if (inb (PIC1_CMD) & (1 << TIMER_IRQ))
+	return n - 1;
+    outb (TIMER_LATCH, TIMER_CMDS_PORT);
+    count = inb (TIMER_DATA_PORT);
+    count |= inb (TIMER_DATA_PORT) << 8;
+    return (n * tick_count - count + (tick_count >> 1)) / tick_count;
+}
+#endif
+
+#if defined(CONFIG_SYSCALL_TRACE) || defined(CONFIG_TIME_USEC)
+/*
+ * Return the timer counts elapsed since the last jiffy. A timer interrupt
+ * still pending at the controller adds a whole jiffy, as jiffies has not
+ * been incremented yet. Called with interrupts disabled.
+ */
+unsigned int timer_get_count(void)
+{
+    unsigned int count;
+
+    outb (TIMER_LATCH, TIMER_CMDS_PORT);
+    count = inb (TIMER_DATA_PORT);
+    count |= inb (TIMER_DATA_PORT) << 8;
+    count = tick_count - count;
+    outb (0x0A, PIC1_CMD);			/* OCW3: read IRR */
+    if ((inb (PIC1_CMD) & (1 << TIMER_IRQ)) && count < (tick_count >> 1))
+	count += tick_count;
+    return count;
+}
+
+unsigned int timer_tick_counts(void)
+{
+    return tick_count;
+}
+#endif
+
 void disable_timer_tick(void)
 {
 #if NOTNEEDED   /* not needed on IBM PC as IRQ 0 vector untouched */
@@ -25,14 +25,24 @@ extern void rs_pump(void);
 #ifdef CONFIG_CPU_USAGE
 jiff_t uptime;
 
-static void calc_cpu_usage(void)
+/*
+ * Charge n jiffies to the current task, averaging the usage of all
+ * tasks at the end of each sample period. With the tick stopped, the
+ * jiffies slept by the idle task arrive at once and may end several.
+ */
+static void calc_cpu_usage(unsigned int n)
 {
-    static int count = SAMP_FREQ;
+    static unsigned int count = SAMP_FREQ;
     struct task_struct *p;
+    unsigned int k;
 
-    current->ticks++;
-    uptime++;
-    if (--count <= 0) {
+    uptime += n;
+    while (n) {
+        k = (n < count)? n: count;
+        current->ticks += k;
+        n -= k;
+        if ((count -= k) != 0)
+            break;
         count = SAMP_FREQ;
         //unsigned int total = 0;
         for_each_task(p) {
@@ -52,7 +62,6 @@ static void calc_cpu_usage(void)
             }
         }
         //printk("total %d ticks\n", total);
-        return;
     }
 }
 #endif
@@ -62,15 +71,69 @@ extern jiff_t ssd_timeout;
 extern void ssd_io_complete();
 #endif
 
+#ifdef CONFIG_TIMER_TICKLESS
+static unsigned int idle_ticks;     /* length of long timer period, 0 when ticking */
+
+/* account for n jiffies skipped while the tick was stopped */
+static void skip_ticks(unsigned int n)
+{
+    jiffies += n;
+#ifdef CONFIG_CPU_USAGE
+    calc_cpu_usage(n);          /* idle time, current is the idle task */
+#endif
+}
+
+/*
+ * Called by the idle task. If nothing is runnable, stop the periodic tick
+ * by programming the timer for the next timer expiry, sleep until any
+ * interrupt, then catch up on the jiffies skipped.
+ */
+void tickless_idle(void)
+{
+    unsigned int n;
+
+    clr_irq();
+    n = idle_sleep_ticks(timer_max_ticks());
+    if (n == 0) {               /* something to run */
+        set_irq();
+        return;
+    }
+    if (n > 1) {
+        idle_ticks = n;
+        timer_set_ticks(n);
+    }
+    idle_halt_sti();
+
+    clr_irq();
+    if (idle_ticks) {           /* woken before the timer interrupt */
+        skip_ticks(timer_ticks_elapsed(idle_ticks));
+        idle_ticks = 0;
+        timer_set_ticks(1);
+    }
+    set_irq();
+}
+#endif
+
 void timer_tick(int irq, struct pt_regs *regs)
 {
+#ifdef CONFIG_TIMER_TICKLESS
+    if (idle_ticks) {           /* end of long period, back to normal ticks */
+        skip_ticks(idle_ticks - 1);
+        idle_ticks = 0;
+        timer_set_ticks(1);
+    }
+#endif
     do_timer();
 
 #ifdef CONFIG_CPU_USAGE
-    calc_cpu_usage();
+    calc_cpu_usage(1);
+#endif
+
+#ifdef CONFIG_PROFILE
+    profile_tick(regs);
 #endif
 
-#if defined(CONFIG_CHAR_DEV_RS) && (defined(CONFIG_FAST_IRQ4) || defined(CONFIG_FAST_IRQ3))
+#if defined(CONFIG_CHAR_DEV_RS) && defined(CONFIG_FAST_IRQ)
     rs_pump();          /* check if received serial chars and call wake_up*/
 #endif
 
@@ -95,3 +95,28 @@ unsigned int find_first_zero_bit(int *addr, unsigned int len)
 	bit = len;
     return bit;
 }
+
+/* Find first zero bit at or after bit offset, returns len if none */
+unsigned int find_next_zero_bit(int *addr, unsigned int len, unsigned int offset)
+{
+    unsigned int bit;
+    unsigned int mask;
+
+    if (offset >= len)
+	return len;
+    addr += offset >> 4;
+    bit = offset & ~15;
+    if (offset & 15) {
+	mask = 1 << (offset & 15);
+	bit = offset;
+	do {
+	    if (!(*addr & mask))
+		return (bit < len)? bit: len;
+	    bit++;
+	} while (mask <<= 1);
+	addr++;
+	if (bit >= len)
+	    return len;
+    }
+    return bit + find_first_zero_bit(addr, len - bit);
+}
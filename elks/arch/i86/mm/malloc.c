@@ -8,6 +8,9 @@
 #include <linuxmt/errno.h>
 #include <linuxmt/debug.h>
 #include <linuxmt/heap.h>
+#include <linuxmt/mem.h>
+#include <linuxmt/memory.h>
+#include <linuxmt/init.h>
 
 #include <arch/segment.h>
 
@@ -16,6 +19,12 @@
 
 #define SEG_MIN_SIZE 1
 
+// Free segments are kept in bins by size class,
+// bin n holding sizes from 2^(n-1)K up to 2^nK,
+// with the last bin holding all larger ones
+
+#define NR_SEG_BINS 8
+
 // Segment descriptor
 
 // Allocated in local memory for speed
@@ -23,10 +32,61 @@
 // whenever that mode comes back one day
 
 static list_s _seg_all;
-static list_s _seg_free;
+static list_s _seg_free [NR_SEG_BINS];
+
+// Allocation policy, set by /bootopts segfit=
+// best fit (default) or first fit in the smallest suitable bin
+
+int seg_best_fit = 1;
+
+// Upper memory blocks, added by /bootopts umb=, are free segments
+// above the end of main memory. Allocations flagged SEG_FLAG_HIGH
+// try them first, all others only when main memory has no fit,
+// keeping them for the small segments that fit there
+
+static seg_t seg_main_end;
+static int seg_have_umb;
+
+#ifdef CONFIG_SEG_SWAP
+static segment_s * swap_victim (void);
+static int swap_out (segment_s * seg);
+static void swap_release (segment_s * seg);
+#endif
+
+
+// Get size class of a segment size in paragraphs
+
+static int seg_bin (segext_t size)
+{
+	int bin = 0;
+
+	size >>= 6;		// 1K units
+	while (size && bin < NR_SEG_BINS - 1) {
+		size >>= 1;
+		bin++;
+	}
+	return bin;
+}
+
+
+// Add free segment to its bin:
+//   - tail if merged to previous or next free segment
+//   - head if still alone to increase 'exact hit'
+//     chance on next allocation of same size
+
+static void seg_free_add (segment_s * seg, int tail)
+{
+	list_s * bin = &_seg_free [seg_bin (seg->size)];
+
+	if (tail)
+		list_insert_before (bin, &(seg->free));
+	else
+		list_insert_after (bin, &(seg->free));
+}
 
 
 // Split segment if enough large
+// The upper segment is not added to a free bin
 
 static segment_s * seg_split (segment_s * s1, segext_t size0)
 {
@@ -48,7 +108,6 @@ static segment_s * seg_split (segment_s * s1, segext_t size0)
 		s2->pid = 0;
 
 		list_insert_after (&s1->all, &s2->all);
-		list_insert_after (&s1->free, &s2->free);
 
 		s1->size = size0;
 
@@ -61,47 +120,84 @@ static segment_s * seg_split (segment_s * s1, segext_t size0)
 
 // Get free segment
 
-static segment_s * seg_free_get (segext_t size0, word_t type)
+static segment_s * seg_free_get (segext_t size0, word_t type, int where)
 {
 	// First get the smallest suitable free segment
+	// Bins are size ordered, so the first bin with a fit has the best one
 
 	segment_s * best_seg  = 0;
-	segext_t best_size = 0xFFFF;
-	list_s * n = _seg_free.next;
+	segment_s * s2;
+	segext_t best_size = 0;
 	segext_t size00 = size0, incr = 0;
-
-	while (n != &_seg_free) {
-		segment_s * seg = structof (n, segment_s, free);
-		segext_t size1 = seg->size;
-
-		if (type & SEG_FLAG_ALIGN1K)
-			size00 = size0 + ((~seg->base + 1) & ((1024 >> 4) - 1));
-		if ((seg->flags == SEG_FLAG_FREE) && (size1 >= size00) && (size1 < best_size)) {
-			best_seg  = seg;
-			best_size = size1;
-			incr = size00 - size0;
-			if (size1 == size00) break;
+	int bin;
+
+	for (bin = seg_bin (size0); bin < NR_SEG_BINS && !best_seg; bin++) {
+		list_s * n = _seg_free [bin].next;
+
+		while (n != &_seg_free [bin]) {
+			segment_s * seg = structof (n, segment_s, free);
+			segext_t size1 = seg->size;
+			segext_t need = size0;
+
+			// where > 0 upper memory only, < 0 main memory only
+			if (where && ((seg->base >= seg_main_end) != (where > 0))) {
+				n = seg->free.next;
+				continue;
+			}
+			if (type & SEG_FLAG_ALIGN1K)
+				need = size0 + ((~seg->base + 1) & ((1024 >> 4) - 1));
+			if ((size1 >= need) && (!best_seg || size1 < best_size)) {
+				best_seg  = seg;
+				best_size = size1;
+				size00 = need;
+				incr = need - size0;
+				if (size1 == need || !seg_best_fit) break;
+			}
+
+			n = seg->free.next;
 		}
-
-		n = seg->free.next;
 	}
 
 	// Then allocate that free segment
 
 	if (best_seg) {
-		seg_split (best_seg, size00);				// split off upper segment
-		if (incr)
-			best_seg = seg_split (best_seg, incr);	// split off lower segment
+		list_remove (&(best_seg->free));
+		s2 = seg_split (best_seg, size00);		// split off upper segment
+		if (s2 && s2 != best_seg)
+			seg_free_add (s2, 0);
+		if (incr) {
+			s2 = seg_split (best_seg, incr);	// split off lower segment
+			if (!s2) {
+				seg_free (best_seg);
+				return 0;
+			}
+			seg_free_add (best_seg, 0);
+			best_seg = s2;
+		}
 
-		best_seg->flags = SEG_FLAG_USED | type;
+		best_seg->flags = SEG_FLAG_USED | (type & 0xFF);
 		best_seg->ref_count = 1;
-		list_remove (&(best_seg->free));
 	}
 
 	return best_seg;
 }
 
 
+// Get free segment, from the preferred memory first if there are UMBs
+
+static segment_s * seg_free_get_pref (segext_t size, word_t type)
+{
+	segment_s * seg;
+
+	if (seg_have_umb) {
+		seg = seg_free_get (size, type, (type & SEG_FLAG_HIGH)? 1: -1);
+		if (seg)
+			return seg;
+	}
+	return seg_free_get (size, type, 0);
+}
+
+
 // Merge two contiguous segments
 
 static void seg_merge (segment_s * s1, segment_s * s2)
@@ -113,13 +209,46 @@ static void seg_merge (segment_s * s1, segment_s * s2)
 }
 
 
+// Get free segment, making room when there is none large enough
+
+static segment_s * seg_free_get_retry (segext_t size, word_t type)
+{
+	segment_s * seg = seg_free_get_pref (size, type);
+#ifdef CONFIG_EXEC_TEXTCACHE
+	// Release cached code segments of exited programs until it fits
+	while (!seg && textcache_shrink ())
+		seg = seg_free_get_pref (size, type);
+#endif
+#ifdef CONFIG_SEG_COMPACT
+	// Slide data segments together to make a larger hole
+	if (!seg && seg_compact () >= size)
+		seg = seg_free_get_pref (size, type);
+#endif
+#ifdef CONFIG_SEG_SWAP
+	// Swap out data of the longest sleeping tasks until it fits
+	while (!seg) {
+		segment_s * victim = swap_victim ();
+
+		if (!victim || !swap_out (victim))
+			break;
+		seg = seg_free_get_pref (size, type);
+#ifdef CONFIG_SEG_COMPACT
+		if (!seg && seg_compact () >= size)
+			seg = seg_free_get_pref (size, type);
+#endif
+	}
+#endif
+	return seg;
+}
+
+
 // Allocate segment
 
 segment_s * seg_alloc (segext_t size, word_t type)
 {
 	segment_s * seg = 0;
 	//lock_wait (&_seg_lock);
-	seg = seg_free_get (size, type);
+	seg = seg_free_get_retry (size, type);
 	if (seg && (type & SEG_FLAG_ALIGN1K))
 		seg->base += ((~seg->base + 1) & ((1024 >> 4) - 1));
 	//unlock_event (&_seg_lock);
@@ -133,12 +262,19 @@ void seg_free (segment_s * seg)
 {
 	//lock_wait (&_seg_lock);
 
-	// Free segment will be inserted to free list:
-	//   - tail if merged to previous or next free segment
-	//   - head if still alone to increase 'exact hit'
-	//     chance on next allocation of same size
-
-	list_s * i = &_seg_free;
+	int tail = 0;
+#ifdef CONFIG_ROMFS_FS
+	if ((seg->flags & SEG_FLAG_TYPE) == SEG_FLAG_ROM) {
+		heap_free (seg);
+		return;
+	}
+#endif
+#ifdef CONFIG_SEG_SWAP
+	if (seg->flags & SEG_FLAG_SWAPPED) {
+		swap_release (seg);
+		return;
+	}
+#endif
 	seg->flags = SEG_FLAG_FREE;
 	seg->pid = 0;
 
@@ -149,7 +285,7 @@ void seg_free (segment_s * seg)
 		if ((prev->flags == SEG_FLAG_FREE) && (prev->base + prev->size == seg->base)) {
 			list_remove (&(prev->free));
 			seg_merge (prev, seg);
-			i = _seg_free.prev;
+			tail = 1;
 			seg = prev;
 		}
 	}
@@ -162,13 +298,13 @@ void seg_free (segment_s * seg)
 		if ((next->flags == SEG_FLAG_FREE) && (seg->base + seg->size == next->base)) {
 			list_remove (&(next->free));
 			seg_merge (seg, next);
-			i = _seg_free.prev;
+			tail = 1;
 		}
 	}
 
-	// Insert to free list head or tail
+	// Insert to free bin head or tail
 
-	list_insert_after (i, &(seg->free));
+	seg_free_add (seg, tail);
 
 	//unlock_event (&_seg_lock);
 }
@@ -198,7 +334,7 @@ void seg_put (segment_s * seg)
 
 segment_s * seg_dup (segment_s * src)
 {
-	segment_s * dst = seg_free_get (src->size, src->flags);
+	segment_s * dst = seg_free_get_retry (src->size, src->flags);
 	if (dst)
 		fmemcpyw(0, dst->base, 0, src->base, src->size << 3);
 
@@ -206,12 +342,309 @@ segment_s * seg_dup (segment_s * src)
 }
 
 
+#ifdef CONFIG_ROMFS_FS
+
+// Describe memory outside of main memory as a segment
+// Typically the text of a program executed in place from ROM
+// Not on the segment lists, only the descriptor is freed
+// Returned unreferenced, the caller takes it with seg_get
+
+segment_s * seg_rom (seg_t base, segext_t size)
+{
+	segment_s * seg = (segment_s *) heap_alloc (sizeof (segment_s), HEAP_TAG_SEG);
+	if (seg) {
+		seg->base = base;
+		seg->size = size;
+		seg->flags = SEG_FLAG_USED | SEG_FLAG_ROM;
+		seg->ref_count = 0;
+		seg->pid = 0;
+	}
+	return seg;
+}
+
+#endif
+
+
+#if defined(CONFIG_SEG_COMPACT) || defined(CONFIG_SEG_SWAP)
+
+// A segment can be moved if it is a data segment only referenced
+// by the tasks using it as their data segment, none of which is
+// the current task or inside a kernel call with DS switched away.
+// Code segments are not moved, as user stacks may hold far return
+// addresses into them that cannot be reliably found and patched.
+// For swapping all the tasks must also be asleep.
+
+static int seg_movable (segment_s * seg, int asleep)
+{
+	struct task_struct * t;
+	int refs = 0;
+
+	if ((seg->flags & (SEG_FLAG_TYPE | SEG_FLAG_FIXED)) != SEG_FLAG_DSEG)
+		return 0;
+
+	for_each_task (t) {
+		if (t->state == TASK_UNUSED || t->mm.seg_data != seg)
+			continue;
+		if (t == current || t->state == TASK_EXITING
+			|| t->t_regs.ds != seg->base || t->t_regs.ss != seg->base)
+			return 0;
+		if (asleep && t->state != TASK_INTERRUPTIBLE && t->state != TASK_STOPPED)
+			return 0;
+		refs++;
+	}
+
+	return refs && refs == seg->ref_count;
+}
+
+
+// Point the saved segment registers of the tasks using seg to base
+
+static void seg_patch_tasks (segment_s * seg, seg_t base)
+{
+	struct task_struct * t;
+
+	for_each_task (t) {
+		if (t->state != TASK_UNUSED && t->mm.seg_data == seg) {
+			if (t->t_regs.es == t->t_regs.ds)
+				t->t_regs.es = base;
+			t->t_regs.ds = t->t_regs.ss = base;
+		}
+	}
+}
+
+#endif
+
+#ifdef CONFIG_SEG_COMPACT
+
+
+// Move a segment down into the free segment just below it,
+// leaving the free space above it, and patch the tasks using it
+
+static void seg_move_down (segment_s * seg, segment_s * hole)
+{
+	// forward copy is safe for an overlapping move down
+	list_remove (&(hole->free));
+	fmemcpyw (0, hole->base, 0, seg->base, seg->size << 3);
+	seg_patch_tasks (seg, hole->base);
+
+	seg->base = hole->base;
+	hole->base = seg->base + seg->size;
+	list_remove (&(hole->all));
+	list_insert_after (&(seg->all), &(hole->all));
+	seg_free (hole);	// merge with the next free one if any
+}
+
+
+// Compact main memory by sliding movable segments down over
+// the free segments below them, so free space collects into
+// larger segments. Return the largest free segment size.
+
+segext_t seg_compact (void)
+{
+	segext_t largest = 0;
+	list_s * n;
+
+	for (n = _seg_all.next; n != &_seg_all; n = n->next) {
+		segment_s * seg = structof (n, segment_s, all);
+		segment_s * hole;
+
+		if (seg->flags == SEG_FLAG_FREE) {
+			if (seg->size > largest)
+				largest = seg->size;
+			continue;
+		}
+		if (seg->all.prev == &_seg_all || seg->size >= 0x2000)
+			continue;
+		hole = structof (seg->all.prev, segment_s, all);
+		if ((hole->flags == SEG_FLAG_FREE) && (hole->base + hole->size == seg->base)
+			&& seg_movable (seg, 0))
+			seg_move_down (seg, hole);
+	}
+
+	return largest;
+}
+
+#endif
+
+#ifdef CONFIG_SEG_SWAP
+
+// Swapping of sleeping tasks' data segments to an XMS swap area.
+// A swapped out segment leaves the segment list but keeps its
+// descriptor, with base holding its first 1K block in the area.
+// The tasks keep their old DS, patched when swapped back in.
+
+int xms_swap_kb = CONFIG_SEG_SWAP_KB;	// set by /bootopts xmsswap=
+
+static ramdesc_t swap_base;
+static unsigned int swap_blocks;
+static unsigned char swap_map [MAX_SWAP_KB / 8];
+
+#define swap_size(seg)	(((seg)->size + 63) >> 6)	// in 1K blocks
+#define swap_addr(blk)	(swap_base + ((long_t)(blk) << 10))
+
+
+// Set or clear a run of blocks in the swap map
+
+static void swap_mark (unsigned int blk, unsigned int n, int set)
+{
+	for (; n; n--, blk++) {
+		if (set)
+			swap_map [blk >> 3] |= 1 << (blk & 7);
+		else
+			swap_map [blk >> 3] &= ~(1 << (blk & 7));
+	}
+}
+
+
+// Find and mark the first run of n free blocks, return -1 if none
+
+static int swap_alloc (unsigned int n)
+{
+	unsigned int blk, run = 0;
+
+	for (blk = 0; blk < swap_blocks; blk++) {
+		if (swap_map [blk >> 3] & (1 << (blk & 7)))
+			run = 0;
+		else if (++run == n) {
+			blk -= n - 1;
+			swap_mark (blk, n, 1);
+			return blk;
+		}
+	}
+	return -1;
+}
+
+
+// Release a swapped out segment with no more references
+
+static void swap_release (segment_s * seg)
+{
+	swap_mark (seg->base, swap_size (seg), 0);
+	heap_free (seg);
+}
+
+
+// Pick the swappable segment whose tasks have been asleep the longest
+
+static segment_s * swap_victim (void)
+{
+	segment_s * victim = 0;
+	jiff_t oldest = 0;
+	list_s * n;
+
+	if (!swap_blocks)
+		return 0;
+
+	for (n = _seg_all.next; n != &_seg_all; n = n->next) {
+		segment_s * seg = structof (n, segment_s, all);
+		struct task_struct * t;
+		jiff_t latest = 0;
+
+		if (seg->flags == SEG_FLAG_FREE || !seg_movable (seg, 1))
+			continue;
+		for_each_task (t) {
+			if (t->state != TASK_UNUSED && t->mm.seg_data == seg
+				&& t->sleep_time > latest)
+				latest = t->sleep_time;
+		}
+		if (!victim || latest < oldest) {
+			victim = seg;
+			oldest = latest;
+		}
+	}
+	return victim;
+}
+
+
+// Write a segment to the swap area and free its memory
+
+static int swap_out (segment_s * seg)
+{
+	segment_s * hole;
+	int blk;
+
+	blk = swap_alloc (swap_size (seg));
+	if (blk < 0)
+		return 0;
+	hole = (segment_s *) heap_alloc (sizeof (segment_s), HEAP_TAG_SEG);
+	if (!hole) {
+		swap_mark (blk, swap_size (seg), 0);
+		return 0;
+	}
+
+	xms_fmemcpyw (0, swap_addr (blk), 0, seg->base, seg->size << 3);
+
+	hole->base = seg->base;
+	hole->size = seg->size;
+	hole->ref_count = 0;
+	list_insert_after (&(seg->all), &(hole->all));
+	list_remove (&(seg->all));
+	seg_free (hole);
+
+	seg->base = blk;
+	seg->flags |= SEG_FLAG_SWAPPED;
+	debug ("swap: out %d blocks at %d\n", swap_size (seg), blk);
+	return 1;
+}
+
+
+// Bring a swapped out segment back into main memory
+// Called by schedule() before switching to a task using it
+// Return 0 if there is no memory for it yet
+
+int seg_swap_in (segment_s * seg)
+{
+	segment_s * dst;
+	word_t type = seg->flags & ~SEG_FLAG_SWAPPED;
+
+	dst = seg_free_get_retry (seg->size, type);
+	if (!dst)
+		return 0;
+
+	xms_fmemcpyw (0, dst->base, 0, swap_addr (seg->base), seg->size << 3);
+	swap_mark (seg->base, swap_size (seg), 0);
+	seg_patch_tasks (seg, dst->base);
+
+	// the descriptor in use takes the place of the new one
+	seg->base = dst->base;
+	seg->flags = type;
+	list_insert_after (&(dst->all), &(seg->all));
+	list_remove (&(dst->all));
+	heap_free (dst);
+	debug ("swap: in at %x\n", seg->base);
+	return 1;
+}
+
+
+// Set up the swap area in XMS
+
+void INITPROC swap_init (void)
+{
+	if (xms_swap_kb <= 0)
+		return;
+	if (!xms_enabled)
+		xms_enabled = xms_init ();
+	if (!xms_enabled)
+		return;
+	if (xms_swap_kb > MAX_SWAP_KB)
+		xms_swap_kb = MAX_SWAP_KB;
+	swap_blocks = xms_swap_kb;
+	swap_base = xms_alloc ((long_t) swap_blocks << 10);
+	printk ("swap: %uK in xms\n", swap_blocks);
+}
+
+#endif
+
+
 // Get memory information (free and used) in KB
+// and fragmentation (largest free segment and free segment count)
 
-void mm_get_usage (unsigned int * pfree, unsigned int * pused)
+void mm_get_usage (struct mem_usage * mu)
 {
 	unsigned int free = 0;
 	unsigned int used = 0;
+	segext_t largest = 0;
+	unsigned int blocks = 0;
 
 	list_s * n = _seg_all.next;
 
@@ -221,9 +654,12 @@ void mm_get_usage (unsigned int * pfree, unsigned int * pused)
 		/*if (used) printk ("seg %X: size %u used %u count %u\n",
 			seg->base, seg->size, seg->flags, seg->ref_count);*/
 
-		if (seg->flags == SEG_FLAG_FREE)
+		if (seg->flags == SEG_FLAG_FREE) {
 			free += seg->size;
-		else
+			blocks++;
+			if (seg->size > largest)
+				largest = seg->size;
+		} else
 			used += seg->size;
 
 		n = seg->all.next;
@@ -232,8 +668,10 @@ void mm_get_usage (unsigned int * pfree, unsigned int * pused)
 	// Convert paragraphs to kilobytes
 	// Floor, not ceiling, so average return
 
-	*pfree = ((free + 31) >> 6);
-	*pused = ((used + 31) >> 6);
+	mu->free_memory = ((free + 31) >> 6);
+	mu->used_memory = ((used + 31) >> 6);
+	mu->largest_free = largest >> 6;
+	mu->free_blocks = blocks;
 }
 
 
@@ -331,7 +769,9 @@ void INITPROC seg_add(seg_t start, seg_t end)
 		seg->pid = 0;
 
 		list_insert_before (&_seg_all, &(seg->all));  // add tail
-		list_insert_before (&_seg_free, &(seg->free));  // add tail
+		seg_free_add (seg, 1);
+		if (start >= seg_main_end)
+			seg_have_umb = 1;
 	}
 }
 
@@ -339,8 +779,12 @@ void INITPROC seg_add(seg_t start, seg_t end)
 
 void INITPROC mm_init(seg_t start, seg_t end)
 {
+	int bin;
+
 	list_init (&_seg_all);
-	list_init (&_seg_free);
+	for (bin = 0; bin < NR_SEG_BINS; bin++)
+		list_init (&_seg_free [bin]);
 
+	seg_main_end = end;
 	seg_add(start, end);
 }
@@ -0,0 +1,128 @@
+/*
+ *	Shared memory segments.
+ *
+ *	A segment is created by the first task attaching its key and
+ *	holds one reference for each task attached to it. Attachments
+ *	are inherited by fork and kept across exec, like the memory of
+ *	fmemalloc. The segment is freed and its key forgotten when the
+ *	last task detaches or exits.
+ */
+
+#include <linuxmt/types.h>
+#include <linuxmt/sched.h>
+#include <linuxmt/mm.h>
+#include <linuxmt/shm.h>
+#include <linuxmt/errno.h>
+#include <linuxmt/memory.h>
+
+#if MAX_TASKS > 16
+#error shm tasks mask too small for MAX_TASKS
+#endif
+
+struct shm {
+	int key;
+	segment_s *seg;		/* zero when the entry is unused */
+	word_t tasks;		/* mask of the task slots attached */
+};
+
+static struct shm shm_table[NR_SHM];
+
+#define task_bit(t)	(1 << ((t) - task))
+
+static void shm_detach(struct shm *shm, word_t bit)
+{
+	shm->tasks &= ~bit;
+	seg_put(shm->seg);
+	if (!shm->tasks)
+		shm->seg = 0;
+}
+
+// attach segment of key, creating it with paras if IPC_CREAT, return segment
+int sys_shmat(int key, unsigned int paras, int flags, unsigned short *pseg)
+{
+	struct shm *shm, *unused = 0;
+	segment_s *seg;
+	word_t bit = task_bit(current);
+	int err;
+
+	err = verify_area(VERIFY_WRITE, pseg, sizeof(*pseg));
+	if (err)
+		return err;
+
+	for (shm = shm_table; shm < &shm_table[NR_SHM]; shm++) {
+		if (!shm->seg) {
+			if (!unused)
+				unused = shm;
+		} else if (key != IPC_PRIVATE && shm->key == key)
+			break;
+	}
+
+	if (shm < &shm_table[NR_SHM]) {
+		if ((flags & (IPC_CREAT|IPC_EXCL)) == (IPC_CREAT|IPC_EXCL))
+			return -EEXIST;
+		if (paras > shm->seg->size)
+			return -EINVAL;
+		if (!(shm->tasks & bit)) {
+			shm->tasks |= bit;
+			seg_get(shm->seg);
+		}
+	} else {
+		if (!(flags & IPC_CREAT))
+			return -ENOENT;
+		if (!paras)
+			return -EINVAL;
+		if (!unused)
+			return -ENOSPC;
+		seg = seg_alloc((segext_t)paras, SEG_FLAG_SHM);
+		if (!seg)
+			return -ENOMEM;
+		fmemsetw(0, seg->base, 0, paras << 3);
+		shm = unused;
+		shm->key = key;
+		shm->seg = seg;			/* reference of the creator */
+		shm->tasks = bit;
+	}
+
+	put_user(shm->seg->base, pseg);
+	return 0;
+}
+
+// detach segment at base
+int sys_shmdt(seg_t base)
+{
+	struct shm *shm;
+	word_t bit = task_bit(current);
+
+	for (shm = shm_table; shm < &shm_table[NR_SHM]; shm++) {
+		if (shm->seg && shm->seg->base == base && (shm->tasks & bit)) {
+			shm_detach(shm, bit);
+			return 0;
+		}
+	}
+	return -EINVAL;
+}
+
+// attach the child of fork to the segments of its parent
+void shm_fork(struct task_struct *parent, struct task_struct *child)
+{
+	struct shm *shm;
+
+	for (shm = shm_table; shm < &shm_table[NR_SHM]; shm++) {
+		if (shm->seg && (shm->tasks & task_bit(parent))) {
+			shm->tasks |= task_bit(child);
+			seg_get(shm->seg);
+		}
+	}
+}
+
+// detach an exiting task from all of its segments
+void shm_exit(struct task_struct *t)
+{
+	struct shm *shm;
+	word_t bit = task_bit(t);
+
+	for (shm = shm_table; shm < &shm_table[NR_SHM]; shm++) {
+		if (shm->seg && (shm->tasks & bit))
+			shm_detach(shm, bit);
+	}
+}
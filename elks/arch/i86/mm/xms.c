@@ -11,11 +11,17 @@
 
 #include <linuxmt/string.h>
 #include <arch/segment.h>
+#include <arch/system.h>
 
 /* linear address to start XMS buffer allocations from */
 #define XMS_START_ADDR    0x00100000L	/* 1M */
 //#define XMS_START_ADDR  0x00FA0000L	/* 15.6M (Compaq with only 1M ram) */
 
+/* high memory area, the first 64K-16 of XMS, addressable from FFFF:0010 with A20 on */
+#define HMA_SEG           0xFFFF
+#define HMA_START         0x0010
+#define HMA_SIZE          0x10000L
+
 #ifdef CONFIG_FS_XMS_BUFFER
 
 /* these used in CONFIG_FS_XMS_INT15 only */
@@ -35,7 +41,7 @@ extern void int15_fmemcpyw(void *dst_off, addr_t dst_seg, void *src_off, addr_t
  *     in linear32_fmemcypw.
  */
 
-static int xms_enabled;
+int xms_enabled;
 static long_t xms_alloc_ptr = XMS_START_ADDR;
 
 /* try to enable unreal mode and A20 gate. Return 1 if successful */
@@ -69,6 +75,36 @@ int xms_init(void)
 	return xms_enabled;
 }
 
+/*
+ * Allocate size bytes from the HMA, returning NULL when not available: on
+ * XT-class systems, when XMS allocations already use the first 64K, or with INT 15
+ * block moves, after which many BIOSes leave the A20 gate off.
+ * Allocations are made at init time only and are never freed.
+ */
+void __far * INITPROC hma_alloc(size_t size)
+{
+#ifdef CONFIG_FS_XMS_INT15
+	return NULL;
+#else
+	static word_t hma_next = HMA_START;
+	void __far *p;
+
+	if (!(sys_caps & CAP_PC_AT) || size > (word_t)-hma_next)
+		return NULL;
+	if (hma_next == HMA_START) {
+		if (xms_alloc_ptr != XMS_START_ADDR)
+			return NULL;
+		if (!verify_a20() && (!enable_a20_gate() || !verify_a20()))
+			return NULL;
+		xms_alloc_ptr += HMA_SIZE;	/* XMS allocations start above HMA */
+		printk("hma: enabled, ");
+	}
+	p = _MK_FP(HMA_SEG, hma_next);
+	hma_next += size;
+	return p;
+#endif
+}
+
 /* allocate from XMS memory - very simple for now, no free */
 ramdesc_t xms_alloc(long_t size)
 {
@@ -174,34 +210,40 @@ struct gdt_table {
 	byte_t	base_31_24;
 };
 
-static struct gdt_table gdt_table[8];
+/*
+ * Only the source and destination bases change between moves. The BIOS fills in
+ * the GDT pointer and its own code and stack descriptors, so the table is set up
+ * once here rather than cleared on every call.
+ */
+static struct gdt_table gdt_table[8] = {
+	[2] = {				/* source descriptor */
+		.limit_15_0 = 0xffff,
+		.access_byte = 0x93,	/* present, ring 0, data, expand-up, writable, accessed */
+		//.flags_limit_19_16 = 0,	/* byte-granular, 16-bit, limit=64K */
+	},
+	[3] = {				/* dest descriptor */
+		.limit_15_0 = 0xffff,
+		.access_byte = 0x93,
+	},
+};
 
 /* move words between XMS and main memory using BIOS INT 15h AH=87h block move */
 void int15_fmemcpyw(void *dst_off, addr_t dst_seg, void *src_off, addr_t src_seg,
 		size_t count)
 {
 	struct gdt_table *gp;
-	memset(gdt_table, 0, sizeof(gdt_table));
 
 	src_seg += (word_t)src_off;
 	dst_seg += (word_t)dst_off;
 
 	gp = &gdt_table[2];		/* source descriptor*/
-	gp->limit_15_0 = 0xffff;
 	gp->base_15_0 = (word_t)src_seg;
 	gp->base_23_16 = src_seg >> 16;
-	gp->access_byte = 0x93;		/* present, rignt 0, data, expand-up, writable, accessed */
-	//gp->flags_limit_19_16 = 0;	/* byte-granular, 16-bit, limit=64K */
-	//gp->flags_limit_19_16 = 0xCF;	/* page-granular, 32-bit, limit=4GB */
 	gp->base_31_24 = src_seg >> 24;
 
 	gp = &gdt_table[3];		/* dest descriptor*/
-	gp->limit_15_0 = 0xffff;
 	gp->base_15_0 = (word_t)dst_seg;
 	gp->base_23_16 = dst_seg >> 16;
-	gp->access_byte = 0x93;		/* present, rignt 0, data, expand-up, writable, accessed */
-	//gp->flags_limit_19_16 = 0;	/* byte-granular, 16-bit, limit=64K */
-	//gp->flags_limit_19_16 = 0xCF;	/* page-granular, 32-bit, limit=4GB */
 	gp->base_31_24 = dst_seg >> 24;
 	block_move(gdt_table, count);
 }
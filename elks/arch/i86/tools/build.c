@@ -40,6 +40,7 @@
 #include <linuxmt/boot.h>
 
 #include "a.out.h"
+#include "lz.h"
 
 #define MINIX_HEADER 0x20
 #define SUPL_HEADER  0x40
@@ -61,6 +62,9 @@ static int GCC_HEADER = sizeof(struct exec);
 
 #define STRINGIFY(x) #x
 
+/* LZ match window for build -z, setup.S decodes with 32K offsets at most */
+#define LZ_SYS_WINDOW 0x8000
+
 typedef union {
     uint32_t l;
     uint16_t s[2];
@@ -101,7 +105,7 @@ void die(const char *str)
 
 void usage(void)
 {
-    die("Usage: build bootsect setup system [rootdev] [> image]");
+    die("Usage: build [-z] bootsect setup system [rootdev] [> image]");
 }
 
 int main(int argc, char **argv)
@@ -117,9 +121,19 @@ int main(int argc, char **argv)
     unsigned char major_root, minor_root;
     struct stat sb;
     unsigned char setup_sectors;
+    unsigned char boot_flags;
+    int compress = 0;
+    unsigned char *sys, *lz = NULL;
+    int32_t lz_size = 0;
 
 #define ROOTDEV_ARG 4
 
+    if (argc > 1 && !strcmp(argv[1], "-z")) {
+	compress = 1;
+	argc--;
+	argv++;
+    }
+
     if ((argc < ROOTDEV_ARG) || (argc > ROOTDEV_ARG + 1))
 	usage();
     if (argc > ROOTDEV_ARG) {
@@ -173,6 +187,7 @@ int main(int argc, char **argv)
 	    die("Boot block hasn't got boot flag (0xAA55)");
     buf[root_dev] = (char) minor_root;		/* WRITE root_dev*/
     buf[root_dev+1] = (char) major_root;
+    boot_flags = buf[elks_flags];
     i = write(1, buf, 512);
     if (i != 512)
 	die("Write call failed");
@@ -268,28 +283,49 @@ int main(int argc, char **argv)
 	exit(1);
     }
 #endif
-    while (sz > 0) {
-	int32_t l, n;
-
-	l = sz;
-	if (l > sizeof(buf))
-	    l = sizeof(buf);
-	if ((n = read(id, buf, l)) != l) {
-	    if (n == -1)
-		perror(argv[1]);
-	    else
-		fprintf(stderr, "Unexpected EOF\n");
-	    die("Can't read 'system'");
-	}
-	if (write(1, buf, l) != l)
-	    die("Write failed");
-	sz -= l;
+    /* read system padded to paragraphs, to compress or write it */
+    if (!(sys = calloc(sys_size, 16)))
+	die("Out of memory");
+    if ((c = read(id, sys, sz)) != sz) {
+	if (c == -1)
+	    perror(argv[3]);
+	else
+	    fprintf(stderr, "Unexpected EOF\n");
+	die("Can't read 'system'");
     }
     close(id);
+    if (compress) {
+	lz_size = lz_pack_window(sys, sys_size * 16, LZ_SYS_WINDOW, -1, &lz);
+	if (lz_size) {
+	    fprintf(stderr, "System compressed to %d (%xh paras)\n", lz_size,
+		(lz_size + 15) / 16);
+	    sz = (lz_size + 15) / 16 * 16;
+	    if (!(lz = realloc(lz, sz)))
+		die("Out of memory");
+	    memset(lz + lz_size, 0, sz - lz_size);
+	} else
+	    fprintf(stderr, "System not compressed, LZ is not smaller\n");
+    }
+    if (write(1, lz_size? lz: sys, sz) != sz)
+	die("Write failed");
     if (lseek(1, setup_sects, 0) == setup_sects) {
 	if (write(1, &setup_sectors, 1) != 1)		/* WRITE setup_sectors*/
 	    die("Write of setup sectors failed");
     }
+    if (lz_size) {
+	if (lseek(1, sys_usize, 0) == sys_usize) {
+	    buf[0] = (sys_size & 0xff);			/* WRITE sys_usize*/
+	    buf[1] = ((sys_size >> 8) & 0xff);
+	    if (write(1, buf, 2) != 2)
+		die("Write failed");
+	}
+	boot_flags |= EF_LZ_SYS;
+	if (lseek(1, elks_flags, 0) == elks_flags) {
+	    if (write(1, &boot_flags, 1) != 1)		/* WRITE elks_flags*/
+		die("Write failed");
+	}
+	sys_size = sz / 16;
+    }
     if (lseek(1, syssize, 0) == syssize) {
 	buf[0] = (sys_size & 0xff);			/* WRITE sys_size*/
 	buf[1] = ((sys_size >> 8) & 0xff);
@@ -44,6 +44,13 @@ size_t block_read(struct inode *inode, struct file *filp, char *buf, size_t coun
 	chars = BLOCK_SIZE - (((size_t)(filp->f_pos)) & (BLOCK_SIZE - 1));
 	if (chars > count) chars = count;
 	if (bh) {
+#ifdef CONFIG_FS_READAHEAD
+	    /* on a cache miss during a sequential read, fetch the window */
+	    if (!EBH(bh)->b_uptodate &&
+		    (block_t)(filp->f_pos >> BLOCK_SIZE_BITS) == filp->f_ranext)
+		block_readahead(inode, filp->f_ranext,
+		    (block_t)((inode->i_size - 1) >> BLOCK_SIZE_BITS));
+#endif
 	    if (!readbuf(bh)) {
 		if (!read) read = -EIO;
 		break;
@@ -57,10 +64,11 @@ size_t block_read(struct inode *inode, struct file *filp, char *buf, size_t coun
 	filp->f_pos += chars;
 	read += chars;
 	count -= chars;
-    }
-#ifdef FIXME
-    if (!IS_RDONLY(inode)) inode->i_atime = current_time();
+#ifdef CONFIG_FS_READAHEAD
+	filp->f_ranext = (block_t)(filp->f_pos >> BLOCK_SIZE_BITS);
 #endif
+    }
+    if (read) update_atime(inode);
     return read;
 #else
     return -EINVAL;
@@ -111,7 +119,7 @@ size_t block_write(struct inode *inode, struct file *filp, char *buf, size_t cou
 	xms_fmemcpyb(buffer_data(bh) + offset, buffer_seg(bh), buf,
 		current->t_regs.ds, chars);
 	mark_buffer_uptodate(bh, 1);
-	mark_buffer_dirty(bh);
+	mark_buffer_dirty_inode(bh, inode);
 	brelse(bh);
 	buf += chars;
 	filp->f_pos += chars;
@@ -10,6 +10,8 @@
 #include <linuxmt/errno.h>
 #include <linuxmt/trace.h>
 #include <linuxmt/debug.h>
+#include <linuxmt/mem.h>
+#include <linuxmt/stat.h>
 
 #include <arch/system.h>
 #include <arch/segment.h>
@@ -26,6 +28,10 @@
    to/from kernel data segment. */
 int nr_map_bufs = NR_MAPBUFS;                   /* override with /bootopts cache= */
 #define MAX_NR_MAPBUFS  20
+#if defined(CONFIG_FS_EXTERNAL_BUFFER) || defined(CONFIG_FS_XMS_BUFFER)
+int max_map_bufs;                               /* override with /bootopts cachemax= */
+#define L1_ADAPT        32      /* maps between L1 pool size checks */
+#endif
 
 #ifdef CONFIG_FS_EXTERNAL_BUFFER
 int nr_ext_bufs = CONFIG_FS_NR_EXT_BUFFERS;     /* override with /bootopts buf= */
@@ -33,6 +39,15 @@ int nr_ext_bufs = CONFIG_FS_NR_EXT_BUFFERS;     /* override with /bootopts buf=
 #ifdef CONFIG_FS_XMS_BUFFER
 int nr_xms_bufs = CONFIG_FS_NR_XMS_BUFFERS;     /* override with /bootopts xmsbuf= */
 #endif
+#ifdef CONFIG_FS_READAHEAD
+int nr_readahead = NR_READAHEAD;                /* override with /bootopts readahead= */
+#endif
+#ifdef CONFIG_FS_FLUSHER
+int flush_age = FLUSH_AGE;                      /* override with /bootopts flushage= */
+int flush_hiwater;                              /* override with /bootopts flushmax= */
+static int nr_dirty_bh;                         /* number of dirty buffers */
+static struct wait_queue flushwait;             /* flusher sleeps here */
+#endif
 
 /* Buffer heads: local heap allocated */
 static struct buffer_head *buffer_heads;
@@ -48,8 +63,10 @@ ext_buffer_head *EBH(struct buffer_head *bh)
 }
 
 /* functions for buffer_head points called outside of buffer.c */
+#ifndef CONFIG_FS_FLUSHER
 void mark_buffer_dirty(struct buffer_head *bh)     { EBH(bh)->b_dirty = 1; }
 void mark_buffer_clean(struct buffer_head *bh)     { EBH(bh)->b_dirty = 0; }
+#endif
 unsigned char buffer_count(struct buffer_head *bh) { return EBH(bh)->b_count; }
 block32_t buffer_blocknr(struct buffer_head *bh)   { return EBH(bh)->b_blocknr; }
 kdev_t buffer_dev(struct buffer_head *bh)          { return EBH(bh)->b_dev; }
@@ -64,6 +81,19 @@ static struct buffer_head *bh_lru;      /* least recently used - reused/flushed
 static struct buffer_head *bh_llru;     /* most recently used - for finding a buffer */
 static struct buffer_head *bh_next;
 
+#ifdef CONFIG_FS_BUFFER_HASH
+/*
+ * Buffer lookup hash table, indexed by (dev, blocknr). The chain links are
+ * kept in the near buffer_head so a lookup only dereferences the far part
+ * of buffer heads whose hash bucket matches. The table size is a power of
+ * two set from nr_bh at buffer_init time.
+ */
+static struct buffer_head **bh_hash;
+static unsigned int bh_hash_mask;
+
+#define bufhash(dev,block)  (((unsigned int)(block) ^ (dev)) & bh_hash_mask)
+#endif
+
 /*
  * External L2 buffers are allocated within main or xms memory segments.
  * If CONFIG_FS_XMS_BUFFER is set and unreal mode and A20 gate can be enabled,
@@ -77,11 +107,11 @@ static struct buffer_head *bh_next;
  */
 #if defined(CONFIG_FS_EXTERNAL_BUFFER) || defined(CONFIG_FS_XMS_BUFFER)
 static struct buffer_head *L1map[MAX_NR_MAPBUFS]; /* L1 indexed pointer to L2 buffer */
+static char *L1data[MAX_NR_MAPBUFS];              /* L1 buffer areas, grown at runtime */
 static struct wait_queue L1wait;                  /* Wait for a free L1 buffer area */
 static int lastL1map;
+static unsigned long L1maps, L1remaps;            /* map stats at last pool size check */
 #endif
-static int xms_enabled;
-static int map_count, remap_count, unmap_count;
 
 static int nr_free_bh, nr_bh;
 #ifdef CHECK_FREECNTS
@@ -98,6 +128,59 @@ static int nr_free_bh, nr_bh;
 
 #define buf_num(bh)     ((bh) - buffer_heads)   /* buffer number, for debugging */
 
+#ifdef CONFIG_FS_FLUSHER
+/* dirty/clean transitions are counted and timestamped for the flusher */
+void mark_buffer_dirty(struct buffer_head *bh)
+{
+    ext_buffer_head *ebh = EBH(bh);
+
+    if (!ebh->b_dirty) {
+        ebh->b_dirty = 1;
+        ebh->b_dirtytime = (unsigned int)jiffies;
+        if (++nr_dirty_bh > flush_hiwater)
+            wake_up(&flushwait);
+    }
+}
+
+void mark_buffer_clean(struct buffer_head *bh)
+{
+    ext_buffer_head *ebh = EBH(bh);
+
+    if (ebh->b_dirty) {
+        ebh->b_dirty = 0;
+        nr_dirty_bh--;
+    }
+}
+#endif
+
+#ifdef CONFIG_FS_BUFFER_HASH
+static void insert_into_hash(struct buffer_head *bh)
+{
+    ext_buffer_head *ebh = EBH(bh);
+    struct buffer_head **bhp = &bh_hash[bufhash(ebh->b_dev, ebh->b_blocknr)];
+
+    bh->b_next_hash = *bhp;
+    *bhp = bh;
+}
+
+static void remove_from_hash(struct buffer_head *bh)
+{
+    ext_buffer_head *ebh = EBH(bh);
+    struct buffer_head **bhp = &bh_hash[bufhash(ebh->b_dev, ebh->b_blocknr)];
+
+    for (; *bhp; bhp = &(*bhp)->b_next_hash) {
+        if (*bhp == bh) {
+            *bhp = bh->b_next_hash;
+            break;
+        }
+    }
+    bh->b_next_hash = NULL;
+}
+#else
+#define insert_into_hash(bh)
+#define remove_from_hash(bh)
+#endif
+
 static void put_last_lru(struct buffer_head *bh)
 {
     ext_buffer_head *ebh = EBH(bh);
@@ -178,14 +261,18 @@ static void list_buffer_status(void)
         if (isinuse) inuse++;
     } while ((bh = ebh->b_prev_lru) != NULL);
     printk("\nTotal L2 buffers inuse %d/%d (%d free)", inuse, nr_bh, nr_free_bh);
-    printk(", %dk L1 (map %u, unmap %u remap %u)\n",
-        nr_map_bufs, map_count, unmap_count, remap_count);
+    printk(", %dk L1 (map %lu, unmap %lu remap %lu)\n",
+        nr_map_bufs, kstat.buffer_maps, kstat.buffer_unmaps, kstat.buffer_remaps);
 }
 #endif
 
 int INITPROC buffer_init(void)
 {
     if (nr_map_bufs > MAX_NR_MAPBUFS) nr_map_bufs = MAX_NR_MAPBUFS;
+#if defined(CONFIG_FS_EXTERNAL_BUFFER) || defined(CONFIG_FS_XMS_BUFFER)
+    if (max_map_bufs <= 0) max_map_bufs = nr_map_bufs << 1;
+    if (max_map_bufs > MAX_NR_MAPBUFS) max_map_bufs = MAX_NR_MAPBUFS;
+#endif
 
     /* XMS buffers override EXT buffers override internal buffers*/
 #if defined(CONFIG_FS_EXTERNAL_BUFFER) || defined(CONFIG_FS_XMS_BUFFER)
@@ -198,7 +285,7 @@ int INITPROC buffer_init(void)
         bufs_to_alloc = nr_xms_bufs;
 #endif
 #ifdef CONFIG_FAR_BUFHEADS
-    if (bufs_to_alloc > 2975) bufs_to_alloc = 2975; /* max 64K far bufheads @22 bytes*/
+    if (bufs_to_alloc > 2730) bufs_to_alloc = 2730; /* max 64K far bufheads @24 bytes*/
 #else
     if (bufs_to_alloc > 256) bufs_to_alloc = 256; /* protect against high XMS value*/
 #endif
@@ -210,22 +297,43 @@ int INITPROC buffer_init(void)
 #endif
 
     nr_bh = nr_free_bh = bufs_to_alloc;
+#ifdef CONFIG_FS_FLUSHER
+    if (flush_hiwater <= 0 || flush_hiwater > nr_bh)
+        flush_hiwater = nr_bh >> 1;
+    if (flush_age > 600) flush_age = 600;       /* b_dirtytime wraps after 655 secs */
+#endif
 #if defined(CHECK_FREECNTS) && DEBUG_EVENT
     debug_setcallback(1, list_buffer_status);   /* ^O will generate buffer list */
 #endif
 
     if (!(L1buf = heap_alloc(nr_map_bufs * BLOCK_SIZE, HEAP_TAG_BUFHEAD|HEAP_TAG_CLEAR)))
         return 1;
+#if defined(CONFIG_FS_EXTERNAL_BUFFER) || defined(CONFIG_FS_XMS_BUFFER)
+    for (int i = 0; i < nr_map_bufs; i++)
+        L1data[i] = L1buf + (i << BLOCK_SIZE_BITS);
+#endif
 
     buffer_heads = heap_alloc(bufs_to_alloc * sizeof(struct buffer_head),
         HEAP_TAG_BUFHEAD|HEAP_TAG_CLEAR);
     if (!buffer_heads) return 1;
+#ifdef CONFIG_FS_BUFFER_HASH
+    unsigned int nr_hash = 8;
+    while (nr_hash < (nr_bh >> 1))
+        nr_hash <<= 1;
+    bh_hash_mask = nr_hash - 1;
+    bh_hash = heap_alloc(nr_hash * sizeof(struct buffer_head *),
+        HEAP_TAG_BUFHEAD|HEAP_TAG_CLEAR);
+    if (!bh_hash) return 1;
+#endif
 #ifdef CONFIG_FAR_BUFHEADS
     size_t size = bufs_to_alloc * sizeof(ext_buffer_head);
-    segment_s *seg = seg_alloc((size + 15) >> 4, SEG_FLAG_EXTBUF);
-    if (!seg) return 1;
-    fmemsetw(0, seg->base, 0, size >> 1);
-    ext_buffer_heads = _MK_FP(seg->base, 0);
+    /* HMA if possible, upper then main memory otherwise */
+    if (!(ext_buffer_heads = hma_alloc(size))) {
+        segment_s *seg = seg_alloc((size + 15) >> 4, SEG_FLAG_EXTBUF|SEG_FLAG_HIGH);
+        if (!seg) return 1;
+        ext_buffer_heads = _MK_FP(seg->base, 0);
+    }
+    fmemsetw((void *)_FP_OFF(ext_buffer_heads), _FP_SEG(ext_buffer_heads), 0, size >> 1);
 #endif
     bh_next = bh_lru = bh_llru = buffer_heads;
 
@@ -313,7 +421,7 @@ void invalidate_buffers(kdev_t dev)
         }
         debug_blk("invalidating blk %ld\n", ebh->b_blocknr);
         ebh->b_uptodate = 0;
-        ebh->b_dirty = 0;
+        mark_buffer_clean(bh);
         brelseL1(bh, 0);        /* release buffer from L1 if present */
         unlock_buffer(bh);
     } while ((bh = ebh->b_prev_lru) != NULL);
@@ -362,6 +470,114 @@ static void sync_buffers(kdev_t dev, int wait)
     debug_blk("SYNC_BUFFERS END %d wrote %d\n", wait, count);
 }
 
+/* mark a buffer of file data dirty, so fsync of the file finds it */
+void mark_buffer_dirty_inode(struct buffer_head *bh, struct inode *inode)
+{
+    EBH(bh)->b_inode = inode;
+    mark_buffer_dirty(bh);
+}
+
+#define FSYNC_BATCH     16      /* buffers written before waiting on them */
+
+/*
+ * Write out a file and wait for it: its inode, the dirty buffers of its
+ * data, and the dirty metadata buffers of its device (bitmaps, indirect
+ * blocks, directories and the FAT), so the file can be found after a crash.
+ * Unlike fsync_dev, the data buffers of other files are left to the flusher.
+ */
+int fsync_inode(struct inode *inode)
+{
+    struct buffer_head *bh;
+    ext_buffer_head *ebh;
+    struct buffer_head *bhlist[FSYNC_BATCH];
+    kdev_t dev = inode->i_dev;
+    int i, n, err = 0;
+
+    write_inode(inode);
+    do {
+        n = 0;
+        bh = bh_lru;
+        do {
+            ebh = EBH(bh);
+
+            if (ebh->b_dev != dev || !ebh->b_dirty ||
+                (ebh->b_inode && ebh->b_inode != inode))
+                continue;
+            wait_on_buffer(bh);
+            if (!ebh->b_dirty)
+                continue;
+            ebh->b_count++;
+            ll_rw_blk(WRITE, bh);
+            bhlist[n++] = bh;
+        } while (n < FSYNC_BATCH && (bh = ebh->b_next_lru) != NULL);
+
+        for (i = 0; i < n; i++) {
+            bh = bhlist[i];
+            wait_on_buffer(bh);
+            ebh = EBH(bh);
+            if (!ebh->b_uptodate)
+                err = -EIO;
+            ebh->b_count--;
+        }
+    } while (n == FSYNC_BATCH);
+    return err;
+}
+
+#ifdef CONFIG_FS_FLUSHER
+/*
+ * Write out dirty buffers older than flush_age seconds, oldest used first.
+ * If the number of dirty buffers is above flush_hiwater, also write out
+ * younger buffers until half of the high-water mark is reached.
+ */
+static void write_behind(void)
+{
+    struct buffer_head *bh = bh_lru;
+    ext_buffer_head *ebh;
+    unsigned int now = (unsigned int)jiffies;
+    unsigned int age = flush_age * HZ;
+    int count = 0;
+
+    do {
+        ebh = EBH(bh);
+
+        if (!ebh->b_dirty || ebh->b_locked)
+            continue;
+        if (nr_dirty_bh <= (flush_hiwater >> 1) &&
+            (!flush_age || now - ebh->b_dirtytime < age))
+            continue;
+        debug_blk("flush: dev %p write buf %d block %ld\n",
+            ebh->b_dev, buf_num(bh), ebh->b_blocknr);
+        ebh->b_count++;
+        ll_rw_blk(WRITE, bh);
+        ebh->b_count--;
+        count++;
+    } while ((bh = ebh->b_next_lru) != NULL);
+    if (count) debug_blk("flush: wrote %d, %d dirty\n", count, nr_dirty_bh);
+}
+
+void wake_flusher(void)
+{
+    wake_up(&flushwait);
+}
+
+/* buffer write-behind flusher, runs forever as a kernel task */
+void flusher_task(void)
+{
+    for (;;) {
+        current->signal = 0;            /* kernel task, signals would spin */
+        prepare_to_wait_interruptible(&flushwait);
+        current->timeout = jiffies + FLUSH_INTERVAL * HZ;
+        if (nr_dirty_bh <= flush_hiwater)
+            do_wait();
+        finish_wait(&flushwait);
+        current->timeout = 0;
+        put_deferred_inodes();          /* free large unlinked files */
+        if (nr_dirty_bh)
+            write_behind();
+    }
+}
+#endif
+
 static struct buffer_head *get_free_buffer(void)
 {
     struct buffer_head *bh = bh_lru;
@@ -389,6 +605,8 @@ static struct buffer_head *get_free_buffer(void)
     if (ebh->b_mapcount) panic("get_free_buffer"); /* mapped buffer reallocated */
 #endif
     put_last_lru(bh);
+    remove_from_hash(bh);               /* old (dev, block) identity no longer valid */
+    ebh->b_inode = NULL;
     ebh->b_uptodate = 0;
     ebh->b_count = 1;
     SET_COUNT(ebh);
@@ -426,8 +644,10 @@ void bforget(struct buffer_head *bh)
     ext_buffer_head *ebh = EBH(bh);
 
     wait_on_buffer(bh);
-    ebh->b_dirty = 0;
+    mark_buffer_clean(bh);
     DCR_COUNT(ebh);
+    remove_from_hash(bh);
+    ebh->b_inode = NULL;
     ebh->b_dev = NODEV;
     wake_up(&bufwait);
 }
@@ -435,6 +655,17 @@ void bforget(struct buffer_head *bh)
 
 static struct buffer_head *find_buffer(kdev_t dev, block32_t block)
 {
+#ifdef CONFIG_FS_BUFFER_HASH
+    struct buffer_head *bh = bh_hash[bufhash(dev, block)];
+    ext_buffer_head *ebh;
+
+    for (; bh; bh = bh->b_next_hash) {
+        ebh = EBH(bh);
+
+        if (ebh->b_blocknr == block && ebh->b_dev == dev) break;
+    }
+    return bh;
+#else
     struct buffer_head *bh = bh_llru;
     ext_buffer_head *ebh;
 
@@ -444,6 +675,7 @@ static struct buffer_head *find_buffer(kdev_t dev, block32_t block)
         if (ebh->b_blocknr == block && ebh->b_dev == dev) break;
     } while ((bh = ebh->b_prev_lru) != NULL);
     return bh;
+#endif
 }
 
 struct buffer_head *get_hash_table(kdev_t dev, block_t block)
@@ -504,6 +736,7 @@ struct buffer_head *getblk32(kdev_t dev, block32_t block)
     ebh = EBH(bh);
     ebh->b_dev = dev;
     ebh->b_blocknr = block;
+    insert_into_hash(bh);
     goto return_it;
 
   found_it:
@@ -531,13 +764,15 @@ struct buffer_head *readbuf(struct buffer_head *bh)
     ext_buffer_head *ebh = EBH(bh);
 
     if (!ebh->b_uptodate) {
+        kstat.buffer_misses++;
         ll_rw_blk(READ, bh);
         wait_on_buffer(bh);
         if (!ebh->b_uptodate) {
             brelse(bh);
             bh = NULL;
         }
-    }
+    } else
+        kstat.buffer_hits++;
     return bh;
 }
 
@@ -558,42 +793,106 @@ struct buffer_head *bread32(kdev_t dev, block32_t block)
     return readbuf(getblk32(dev, block));
 }
 
-#ifdef BLOAT_FS
-/* NOTHING is using breada at this point, so I can pull it out... Chad */
-struct buffer_head *breada(kdev_t dev, block_t block, int bufsize,
-                           unsigned int pos, unsigned int filesize)
-{
-    struct buffer_head *bh, *bha;
-    int i, j;
-
-    if (pos >= filesize)
-        return NULL;
-
-    if (block < 0)
-        return NULL;
-    bh = getblk(dev, block);
-
-    if (bh->b_uptodate)
-        return bh;
-
-    bha = getblk(dev, block + 1);
-    if (bha->b_uptodate) {
-        brelse(bha);
-        bha = NULL;
-    } else {
-        /* Request the read for these buffers, and then release them */
-        ll_rw_blk(READ, bha);
-        brelse(bha);
+#ifdef CONFIG_FS_READAHEAD
+/* read-ahead window in blocks, leaving buffers for others */
+static int readahead_window(void)
+{
+    int count = nr_readahead;
+
+    if (count > MAX_READAHEAD) count = MAX_READAHEAD;
+    if (count > (nr_bh >> 2)) count = nr_bh >> 2;
+    return count;
+}
+
+/* add bh to the list to read ahead if not already cached, return new count */
+static int readahead_add(struct buffer_head *bh, struct buffer_head **bhlist, int n)
+{
+    ext_buffer_head *ebh = EBH(bh);
+
+    if (ebh->b_uptodate || ebh->b_locked || ebh->b_dirty) {
+        brelse(bh);
+        return n;
+    }
+    bhlist[n] = bh;
+    return n + 1;
+}
+
+/* submit the reads together and release the buffers without waiting */
+static void readahead_submit(struct buffer_head **bhlist, int n)
+{
+    int i;
+
+    if (n) {
+        debug_blk("readahead: dev %D %d blocks\n", buffer_dev(bhlist[0]), n);
+        ll_rw_block(READ, n, bhlist);
+        for (i = 0; i < n; i++) {
+            ext_buffer_head *ebh = EBH(bhlist[i]);
+            DCR_COUNT(ebh);
+        }
     }
-    /* Wait for this buffer, and then continue on */
-    wait_on_buffer(bh);
-    if (bh->b_uptodate)
-        return bh;
-    brelse(bh);
-    return NULL;
+}
+
+/*
+ * Read ahead the blocks of a file starting at file block 'block', up to and
+ * including file block 'last'. All blocks not already cached are submitted
+ * together through ll_rw_block, so the driver can service the window in a
+ * single pass. The buffers are released without waiting for the I/O.
+ */
+void block_readahead(struct inode *inode, block_t block, block_t last)
+{
+    struct buffer_head *bh;
+    struct buffer_head *bhlist[MAX_READAHEAD];
+    int count = readahead_window();
+    int n = 0;
+
+    for (; count > 0 && block <= last; block++, count--) {
+        if (inode->i_op->getblk)
+            bh = inode->i_op->getblk(inode, block, 0);
+        else
+            bh = getblk(inode->i_rdev, block);
+        if (!bh)                        /* file hole */
+            continue;
+        n = readahead_add(bh, bhlist, n);
+    }
+    readahead_submit(bhlist, n);
+}
+
+/*
+ * Read ahead device blocks 'block' up to and including 'last', for
+ * filesystems that know them to be contiguous file data, like the
+ * blocks of a FAT cluster. Nothing is done if 'block' is cached.
+ */
+void block_readahead32(kdev_t dev, block32_t block, block32_t last)
+{
+    struct buffer_head *bh;
+    struct buffer_head *bhlist[MAX_READAHEAD];
+    int count = readahead_window();
+    int n = 0;
+
+    if ((bh = find_buffer(dev, block)) != NULL && EBH(bh)->b_uptodate)
+        return;
+    for (; count > 0 && block <= last; block++, count--)
+        n = readahead_add(getblk32(dev, block), bhlist, n);
+    readahead_submit(bhlist, n);
 }
 #endif
 
+/*
+ * Read ahead a list of distinct, not necessarily contiguous device blocks,
+ * such as the inode table blocks of the entries of a directory block.
+ * The blocks not already cached are submitted in a single ll_rw_block.
+ */
+void block_readahead_list(kdev_t dev, block_t *blocks, int nblocks)
+{
+    struct buffer_head *bhlist[MAX_READAHEAD];
+    int count = readahead_window();
+    int i, n = 0;
+
+    for (i = 0; i < nblocks && i < count; i++)
+        n = readahead_add(getblk(dev, blocks[i]), bhlist, n);
+    readahead_submit(bhlist, n);
+}
+
 void mark_buffer_uptodate(struct buffer_head *bh, int on)
 {
     ext_buffer_head *ebh = EBH(bh);
@@ -625,10 +924,29 @@ void sync_dev(kdev_t dev)
 
 int sys_sync(void)
 {
+#ifdef CONFIG_FS_FLUSHER
+    put_deferred_inodes();
+#endif
     fsync_dev(0);
     return 0;
 }
 
+int sys_fsync(unsigned int fd)
+{
+    struct file *filp;
+    struct inode *inode;
+
+    if (fd >= NR_OPEN || !(filp = current->files.fd[fd]) || !(inode = filp->f_inode))
+        return -EBADF;
+    if (S_ISBLK(inode->i_mode)) {
+        fsync_dev(inode->i_rdev);
+        return 0;
+    }
+    if (!S_ISREG(inode->i_mode) && !S_ISDIR(inode->i_mode))
+        return -EINVAL;
+    return fsync_inode(inode);
+}
+
 /* clear a buffer area to zeros, used to avoid slow map to L1 if possible */
 void zero_buffer(struct buffer_head *bh, size_t offset, int count)
 {
@@ -652,6 +970,49 @@ void zero_buffer(struct buffer_head *bh, size_t offset, int count)
 }
 
 #if defined(CONFIG_FS_EXTERNAL_BUFFER) || defined(CONFIG_FS_XMS_BUFFER)
+/*
+ * Copy count bytes at offset in a buffer to the kernel data segment, from
+ * L1 if the buffer is mapped, otherwise straight from L2. Used by code that
+ * only looks at a few bytes, saving an L1 map and later copy back.
+ */
+void buffer_get(struct buffer_head *bh, size_t offset, void *dst, size_t count)
+{
+    wait_on_buffer(bh);
+    if (bh->b_data)
+        memcpy(dst, bh->b_data + offset, count);
+    else
+        xms_fmemcpyb(dst, kernel_ds, (char *)offset, EBH(bh)->b_L2seg, count);
+}
+
+/*
+ * Add an L1 buffer area from the kernel heap, when all areas are in use or
+ * the last L1_ADAPT maps found less than half their buffers already mapped.
+ * Returns the new L1 index or -1.
+ */
+static int grow_L1(int busy)
+{
+    char *p;
+
+    if (nr_map_bufs >= max_map_bufs)
+        return -1;
+    if (!busy) {
+        unsigned long maps = kstat.buffer_maps - L1maps;
+
+        if (maps < L1_ADAPT)
+            return -1;
+        busy = (kstat.buffer_remaps - L1remaps < maps);
+        L1maps = kstat.buffer_maps;
+        L1remaps = kstat.buffer_remaps;
+        if (!busy)
+            return -1;
+    }
+    if (!(p = heap_alloc(BLOCK_SIZE, HEAP_TAG_BUFHEAD)))
+        return -1;
+    debug_map("L1 grow: %dk\n", nr_map_bufs + 1);
+    L1data[nr_map_bufs] = p;
+    return nr_map_bufs++;
+}
+
 /* map_buffer copies a buffer into L1 buffer space. It will freeze forever
  * before failing, so it can return void.  This is mostly 8086 dependant,
  * although the interface is not.
@@ -675,7 +1036,7 @@ void map_buffer(struct buffer_head *bh)
             debug_map("REMAP: L%02d block %ld\n", i+1, ebh->b_blocknr);
         }
 #endif
-        remap_count++;
+        kstat.buffer_remaps++;
         goto end_map_buffer;
     }
 
@@ -700,11 +1061,21 @@ void map_buffer(struct buffer_head *bh)
 #endif
         /* don't remap if I/O in progress to prevent bh/req buffer unpairing */
         if (!ebmap->b_mapcount && !ebmap->b_locked) {
+            int n = grow_L1(0);         /* rather than evict if L1 is thrashing */
+            if (n >= 0) {
+                i = n;
+                break;
+            }
             debug_map("UNMAP: L%02d block %ld\n", i+1, ebmap->b_blocknr);
             brelseL1_index(i, 1);       /* Unmap/copy L1 to L2 */
             break;
         }
         if (i == lastL1map) {
+            int n = grow_L1(1);
+            if (n >= 0) {
+                i = n;
+                break;
+            }
             /* no free L1 buffers, must wait for L1 unmap_buffer*/
             debug_map("MAPWAIT: block %ld\n", ebh->b_blocknr);
             sleep_on(&L1wait);
@@ -714,10 +1085,10 @@ void map_buffer(struct buffer_head *bh)
     /* Map/copy L2 to L1 */
     lastL1map = i;
     L1map[i] = bh;
-    bh->b_data = L1buf + (i << BLOCK_SIZE_BITS);
+    bh->b_data = L1data[i];
     if (ebh->b_uptodate)
         xms_fmemcpyw(bh->b_data, kernel_ds, 0, ebh->b_L2seg, BLOCK_SIZE/2);
-    map_count++;
+    kstat.buffer_maps++;
     debug_map("MAP:   L%02d block %ld\n", i+1, ebh->b_blocknr);
   end_map_buffer:
     ebh->b_mapcount++;
@@ -765,7 +1136,7 @@ void brelseL1_index(int i, int copyout)
         return;
     if (copyout && ebh->b_uptodate && bh->b_data) {
         xms_fmemcpyw(0, ebh->b_L2seg, bh->b_data, kernel_ds, BLOCK_SIZE/2);
-        unmap_count++;
+        kstat.buffer_unmaps++;
     }
     bh->b_data = 0;
     L1map[i] = 0;
@@ -0,0 +1,154 @@
+/*
+ * elks/fs/dcache.c
+ *
+ * Directory entry lookup cache.
+ *
+ * Caches the result of looking up a name in a directory, keyed on
+ * (device, directory inode, name), so that repeated path resolution
+ * doesn't rescan the directory blocks. Entries with a zero inode number
+ * are negative and record that the name does not exist.
+ *
+ * Names are passed in user space as with the filesystem lookup routines.
+ * Names longer than DCACHE_NAMELEN are not cached. The filesystem must
+ * call dcache_remove whenever it adds or removes a directory entry.
+ */
+
+#include <linuxmt/types.h>
+#include <linuxmt/kernel.h>
+#include <linuxmt/fs.h>
+#include <linuxmt/mm.h>
+#include <linuxmt/mem.h>
+#include <linuxmt/limits.h>
+#include <linuxmt/debug.h>
+
+struct dcache_entry {
+    kdev_t          d_dev;          /* device, 0 means unused */
+    ino_t           d_dir;          /* directory inode */
+    ino_t           d_ino;          /* inode of entry, 0 for negative entry */
+    unsigned int    d_lru;          /* last use stamp for replacement */
+    unsigned char   d_hash;         /* hash of name */
+    unsigned char   d_len;          /* length of name */
+    char            d_name[DCACHE_NAMELEN];
+};
+
+static struct dcache_entry dcache[NR_DCACHE];
+static unsigned int dcache_stamp;
+unsigned int dcache_gen;            /* incremented on each removal */
+static unsigned long dcache_hits, dcache_misses;
+
+/* hash name in user space, returns 0 if name not cacheable */
+static int dcache_hash(const char *name, size_t len, unsigned char *hash)
+{
+    unsigned int h = len;
+
+    if (!len || len > DCACHE_NAMELEN)
+        return 0;
+    do {
+        h = (h << 3) ^ (h >> 5) ^ get_user_char(name++);
+    } while (--len);
+    *hash = (unsigned char)h;
+    return 1;
+}
+
+static struct dcache_entry *dcache_find(struct inode *dir, const char *name,
+    size_t len, unsigned char hash)
+{
+    struct dcache_entry *d;
+
+    for (d = dcache; d < &dcache[NR_DCACHE]; d++) {
+        if (d->d_hash == hash && d->d_len == len && d->d_dir == dir->i_ino &&
+            d->d_dev == dir->i_dev && !fs_memcmp(name, d->d_name, len))
+            return d;
+    }
+    return NULL;
+}
+
+/*
+ * Look up name in dir. Returns 1 and sets *ino on a hit (*ino is 0
+ * if the name is known not to exist), or 0 on a miss.
+ */
+int dcache_lookup(struct inode *dir, const char *name, size_t len, ino_t *ino)
+{
+    struct dcache_entry *d;
+    unsigned char hash;
+
+    if (!dcache_hash(name, len, &hash))
+        return 0;
+    if (!(d = dcache_find(dir, name, len, hash))) {
+        dcache_misses++;
+        return 0;
+    }
+    dcache_hits++;
+    d->d_lru = ++dcache_stamp;
+    *ino = d->d_ino;
+    return 1;
+}
+
+/*
+ * Enter the result of a directory search, ino 0 for not found. The search
+ * may have slept, so the entry is only added if dcache_gen still equals
+ * gen, the value it had before the search started.
+ */
+void dcache_add(struct inode *dir, const char *name, size_t len, ino_t ino,
+    unsigned int gen)
+{
+    struct dcache_entry *d, *victim;
+    unsigned char hash;
+
+    if (gen != dcache_gen || !dcache_hash(name, len, &hash))
+        return;
+    if (!(victim = dcache_find(dir, name, len, hash))) {
+        victim = dcache;
+        for (d = dcache; d < &dcache[NR_DCACHE]; d++) {
+            if (!d->d_dev) {
+                victim = d;
+                break;
+            }
+            if ((int)(d->d_lru - victim->d_lru) < 0)
+                victim = d;
+        }
+        victim->d_dev = dir->i_dev;
+        victim->d_dir = dir->i_ino;
+        victim->d_hash = hash;
+        victim->d_len = len;
+        memcpy_fromfs(victim->d_name, (void *)name, len);
+    }
+    victim->d_ino = ino;
+    victim->d_lru = ++dcache_stamp;
+}
+
+/* Forget name in dir, called when a directory entry is added or removed */
+void dcache_remove(struct inode *dir, const char *name, size_t len)
+{
+    struct dcache_entry *d;
+    unsigned char hash;
+
+    dcache_gen++;
+    if (dcache_hash(name, len, &hash) && (d = dcache_find(dir, name, len, hash)))
+        d->d_dev = 0;
+}
+
+/* Forget all names in directory, or all names on device if dir is 0 */
+void dcache_inval(kdev_t dev, ino_t dir)
+{
+    struct dcache_entry *d;
+
+    dcache_gen++;
+    for (d = dcache; d < &dcache[NR_DCACHE]; d++) {
+        if (d->d_dev == dev && (!dir || d->d_dir == dir))
+            d->d_dev = 0;
+    }
+}
+
+void dcache_get_stats(struct dcache_stats *stats)
+{
+    struct dcache_entry *d;
+
+    stats->hits = dcache_hits;
+    stats->misses = dcache_misses;
+    stats->entries = 0;
+    for (d = dcache; d < &dcache[NR_DCACHE]; d++) {
+        if (d->d_dev)
+            stats->entries++;
+    }
+}
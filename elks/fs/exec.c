@@ -43,9 +43,14 @@
 #include <linuxmt/init.h>
 #include <linuxmt/debug.h>
 #include <linuxmt/memory.h>
+#include <linuxmt/heap.h>
+#include <linuxmt/limits.h>
 
 #include <arch/segment.h>
 
+/* data segments up to this many paragraphs (16K) prefer upper memory blocks */
+#define HIGH_DSEG_PARAS 0x400
+
 #ifndef __GNUC__
 /* FIXME: evaluates some operands twice */
 #   define add_overflow(a, b, res) \
@@ -63,31 +68,204 @@
 	__w >> 3; })
 #endif
 
+#ifdef CONFIG_EXEC_TEXTCACHE
+/*
+ * Sticky text cache. Code segments of programs with the sticky bit set
+ * (or of all programs when textcache=2) are kept after the last user exits,
+ * so a program run repeatedly doesn't have its text read and relocated again.
+ * Entries are keyed on device, inode and modification time, and are released
+ * LRU first when seg_alloc runs short of memory.
+ */
+struct text_cache {
+    segment_s      *seg;            /* cached code segment, NULL if unused */
+    kdev_t          dev;
+    ino_t           ino;
+    __u32           mtime;
+    unsigned int    lru;            /* last use stamp for replacement */
+};
+
+static struct text_cache text_cache[NR_TEXTCACHE];
+static unsigned int textcache_stamp;
+int textcache_mode = 1;             /* 0=off, 1=sticky programs, 2=all programs */
+
+static void textcache_free(struct text_cache *tc)
+{
+    segment_s *seg = tc->seg;
+
+    tc->seg = NULL;
+    seg_put(seg);
+}
+
+static segment_s *textcache_find(struct inode *inode)
+{
+    struct text_cache *tc;
+
+    for (tc = text_cache; tc < &text_cache[NR_TEXTCACHE]; tc++) {
+        if (tc->seg && tc->ino == inode->i_ino && tc->dev == inode->i_dev) {
+            if (tc->mtime != inode->i_mtime) {  /* program was rewritten */
+                textcache_free(tc);
+                return NULL;
+            }
+            tc->lru = ++textcache_stamp;
+            debug("EXEC: text cache hit\n");
+            return tc->seg;
+        }
+    }
+    return NULL;
+}
+
+static void textcache_add(struct inode *inode, segment_s *seg)
+{
+    struct text_cache *tc, *victim;
+
+    if (!textcache_mode || (textcache_mode == 1 && !(inode->i_mode & S_ISVTX)))
+        return;
+    victim = text_cache;
+    for (tc = text_cache; tc < &text_cache[NR_TEXTCACHE]; tc++) {
+        if (!tc->seg) {
+            victim = tc;
+            break;
+        }
+        if ((int)(tc->lru - victim->lru) < 0)
+            victim = tc;
+    }
+    if (victim->seg)
+        textcache_free(victim);
+    victim->seg = seg_get(seg);
+    victim->dev = inode->i_dev;
+    victim->ino = inode->i_ino;
+    victim->mtime = inode->i_mtime;
+    victim->lru = ++textcache_stamp;
+}
+
+/* Release least recently used segment not in use, returns 0 if none */
+int textcache_shrink(void)
+{
+    struct text_cache *tc, *victim = NULL;
+
+    for (tc = text_cache; tc < &text_cache[NR_TEXTCACHE]; tc++) {
+        if (tc->seg && tc->seg->ref_count == 1 &&
+            (!victim || (int)(tc->lru - victim->lru) < 0))
+            victim = tc;
+    }
+    if (!victim)
+        return 0;
+    textcache_free(victim);
+    return 1;
+}
+
+void textcache_inval(kdev_t dev)
+{
+    struct text_cache *tc;
+
+    for (tc = text_cache; tc < &text_cache[NR_TEXTCACHE]; tc++) {
+        if (tc->seg && tc->dev == dev)
+            textcache_free(tc);
+    }
+}
+#else
+#define textcache_find(inode)       NULL
+#define textcache_add(inode,seg)
+#endif
+
+#ifdef CONFIG_EXEC_COMPRESS
+/*
+ * Read a compressed segment and decompress it in place at seg:buf.
+ * Exomizer streams are decoded backwards with the stream below the output.
+ * Their first DECOMP_SAFETY bytes are read into a kernel buffer, so the
+ * decompressed output needs no slack at its end nor a final move.
+ * LZ streams are decoded forwards and are read to end DECOMP_SAFETY bytes
+ * above the output, which the caller must have room for.
+ */
+static int read_compressed(struct inode *inode, struct file *filp, seg_t seg,
+    char *buf, size_t orig_size, size_t compr_size, int flags)
+{
+    unsigned char head[DECOMP_SAFETY];
+    char *in;
+    int retval;
+
+    if (flags & ESH_COMPR_LZ) {
+	in = buf + orig_size + DECOMP_SAFETY - compr_size;
+	if (compr_size > orig_size
+	    || (size_t)buf + orig_size + DECOMP_SAFETY < (size_t)buf + orig_size)
+	    return -ENOEXEC;
+	current->t_regs.ds = seg;
+	retval = filp->f_op->read(inode, filp, in, compr_size);
+	if (retval != (int)compr_size)
+	    goto error;
+	if (lz_decompress(buf, in, buf + orig_size, seg) != buf + orig_size)
+	    return -ENOEXEC;
+	return 0;
+    }
+
+    if (compr_size <= DECOMP_SAFETY)
+	return -ENOEXEC;
+    current->t_regs.ds = kernel_ds;
+    retval = filp->f_op->read(inode, filp, (char *)head, DECOMP_SAFETY);
+    if (retval != DECOMP_SAFETY)
+	goto error;
+    current->t_regs.ds = seg;
+    retval = filp->f_op->read(inode, filp, buf, compr_size - DECOMP_SAFETY);
+    if (retval != (int)(compr_size - DECOMP_SAFETY))
+	goto error;
+    if (decompress(buf, seg, orig_size, compr_size, head) != orig_size)
+	return -ENOEXEC;
+    return 0;
+  error:
+    debug("EXEC(compressed read): bad result %d, expected %u\n", retval, compr_size);
+    return (retval < 0)? retval: -ENOEXEC;
+}
+#endif
+
 #ifdef CONFIG_EXEC_MMODEL
 /*
  * Read relocations for a particular segment and apply them
  * Only IA-16 segment relocations are accepted
+ * Relocations are read RELOC_BUFSIZ bytes at a time into a heap buffer
+ * An R_SEGRUN relocation is followed by records of byte deltas to its
+ * further places, which may continue into the next buffer
  */
 static int relocate(seg_t place_base, lsize_t rsize, segment_s *seg_code,
                segment_s *seg_data, struct inode *inode, struct file *filp, size_t tseg)
 {
+    struct minix_reloc *buf, *reloc;
     int retval = 0;
+    size_t n;
+    word_t val = 0, place = 0, run = 0;
+    unsigned char *delta;
+    int k;
     __u16 save_ds = current->t_regs.ds;
 
     if ((int)rsize % sizeof(struct minix_reloc))
 	return -EINVAL;
+    if (!rsize)
+	return 0;
+    if (!(buf = heap_alloc(RELOC_BUFSIZ, HEAP_TAG_EXEC)))
+	return -ENOMEM;
     current->t_regs.ds = kernel_ds;
     debug("EXEC: applying 0x%lx bytes of relocations to segment 0x%x\n",
 	   (unsigned long)rsize, place_base);
     while (rsize >= sizeof(struct minix_reloc)) {
-	struct minix_reloc reloc;
-	word_t val;
-	retval = filp->f_op->read(inode, filp, (char *)&reloc, sizeof(reloc));
-	if (retval != (int)sizeof(reloc))
+	n = (rsize > RELOC_BUFSIZ)? RELOC_BUFSIZ: (size_t)rsize;
+	n -= n % sizeof(struct minix_reloc);
+	retval = filp->f_op->read(inode, filp, (char *)buf, n);
+	if (retval != (int)n)
 	    goto error;
-	switch (reloc.r_type) {
-	case R_SEGWORD:
-	    switch (reloc.r_symndx) {
+	rsize -= n;
+	for (reloc = buf; n; reloc++, n -= sizeof(struct minix_reloc)) {
+	    if (run) {
+		delta = (unsigned char *)reloc;
+		for (k = sizeof(struct minix_reloc); k && run; k--, run--) {
+		    place += *delta++;
+		    pokew(place, place_base, val);
+		}
+		continue;
+	    }
+	    if (reloc->r_type != R_SEGWORD && reloc->r_type != R_SEGRUN) {
+		debug("EXEC: bad relocation type 0x%x\n", reloc->r_type);
+		goto error;
+	    }
+	    switch (reloc->r_symndx) {
 	    case S_TEXT:
 		val = seg_code->base; break;
 	    case S_FTEXT:
@@ -96,24 +274,26 @@ static int relocate(seg_t place_base, lsize_t rsize, segment_s *seg_code,
 		val = seg_data->base; break;
 	    default:
 		debug("EXEC: bad relocation symbol index 0x%x\n",
-		       reloc.r_symndx);
+		       reloc->r_symndx);
 		goto error;
 	    }
-	    debug("EXEC: reloc %d,%d: %04x, %x, %x\n", reloc.r_type,
-		reloc.r_symndx, (word_t)reloc.r_vaddr, place_base, val);
-	    pokew((word_t)reloc.r_vaddr, place_base, val);
-	    break;
-	default:
-	    debug("EXEC: bad relocation type 0x%x\n", reloc.r_type);
-	    goto error;
+	    debug("EXEC: reloc %d,%d: %04x, %x, %x\n", reloc->r_type,
+		reloc->r_symndx, (word_t)reloc->r_vaddr, place_base, val);
+	    place = (word_t)reloc->r_vaddr;
+	    pokew(place, place_base, val);
+	    if (reloc->r_type == R_SEGRUN)
+		run = (word_t)(reloc->r_vaddr >> 16);
 	}
-	rsize -= sizeof(struct minix_reloc);
     }
+    if (run)
+	goto error;
     current->t_regs.ds = save_ds;
+    heap_free(buf);
     return 0;
   error:
     debug("EXEC: error in relocations\n");
     current->t_regs.ds = save_ds;
+    heap_free(buf);
     if (retval >= 0)
 	retval = -EINVAL;
     return retval;
@@ -138,6 +318,8 @@ int sys_execve(const char *filename, char *sptr, size_t slen)
     ASYNCIO_REENTRANT struct elks_supl_hdr esuph;       /* 24 bytes */
     int need_reloc_code = 1;
 #endif
+    int loaded_code = 0;
+    int vforked;
 
     /* Open the image */
     debug_file("EXEC: '%t' env %d\n", filename, slen);
@@ -153,9 +335,9 @@ int sys_execve(const char *filename, char *sptr, size_t slen)
     if ((retval = open_filp(O_RDONLY, inode, &filp))) goto error_exec2;
 
     /* Look for the binary in memory */
-    seg_code = 0;
+    seg_code = textcache_find(inode);
     currentp = &task[0];
-    do {
+    if (!seg_code) do {
 	if ((currentp->state <= TASK_STOPPED) && (currentp->t_inode == inode)) {
 	    debug("EXEC found copy\n");
 	    seg_code = currentp->mm.seg_code;
@@ -318,6 +500,28 @@ int sys_execve(const char *filename, char *sptr, size_t slen)
 
     debug("EXEC: Malloc time\n");
 
+#ifdef CONFIG_ROMFS_FS
+    /*
+     * Execute in place from ROMFS when the text can be used as is,
+     * its ROM segment is then shared as if found in memory
+     */
+    if (!seg_code && inode->i_sb->s_type->type == FST_ROMFS
+	&& !inode->u.romfs.comp && !((size_t)filp->f_pos & 15)
+#ifdef CONFIG_EXEC_MMODEL
+	&& !esuph.msh_trsize && !esuph.esh_ftrsize
+	&& !esuph.esh_compr_tseg && !esuph.esh_compr_ftseg
+	&& (!esuph.esh_ftseg || !((size_t)mh.tseg & 15))
+#endif
+	) {
+	paras = bytes_to_paras((size_t)mh.tseg);
+#ifdef CONFIG_EXEC_MMODEL
+	paras += bytes_to_paras((size_t)esuph.esh_ftseg);
+#endif
+	seg_code = seg_rom(inode->u.romfs.seg + ((size_t)filp->f_pos >> 4), paras);
+	debug("EXEC: text in place at 0x%x\n", seg_code? seg_code->base: 0);
+    }
+#endif
+
     /*
      *      Looks good. Get the memory we need
      */
@@ -326,11 +530,8 @@ int sys_execve(const char *filename, char *sptr, size_t slen)
 	paras = bytes_to_paras(bytes);
 	retval = -ENOMEM;
 #ifdef CONFIG_EXEC_COMPRESS
-	if (esuph.esh_compr_tseg || esuph.esh_compr_ftseg) {
-	    if (esuph.esh_compr_tseg)
-		bytes = esuph.esh_compr_tseg;
-	    paras += 1;		/* add 16 bytes for safety offset */
-	}
+	if (esuph.esh_compr_tseg || esuph.esh_compr_ftseg)
+	    paras += 1;		/* compressed data may be larger than text */
 #endif
 #ifdef CONFIG_EXEC_MMODEL
 	paras += bytes_to_paras((size_t)esuph.esh_ftseg);
@@ -338,38 +539,43 @@ int sys_execve(const char *filename, char *sptr, size_t slen)
 	debug("EXEC: Allocating 0x%x paragraphs for text segment(s)\n", paras);
 	seg_code = seg_alloc(paras, SEG_FLAG_CSEG);
 	if (!seg_code) goto error_exec3;
-	currentp->t_regs.ds = seg_code->base;  // segment used by read()
-	retval = filp->f_op->read(inode, filp, 0, bytes);
-	if (retval != bytes) {
-	    debug("EXEC(tseg read): bad result %u, expected %u\n", retval, bytes);
-	    goto error_exec4;
-	}
+	loaded_code = 1;
 #ifdef CONFIG_EXEC_COMPRESS
-	retval = -ENOEXEC;
-	if (esuph.esh_compr_tseg &&
-	    decompress(0, seg_code->base, (size_t)mh.tseg, bytes, 16) != (size_t)mh.tseg)
+	if (esuph.esh_compr_tseg) {
+	    retval = read_compressed(inode, filp, seg_code->base, 0,
+		(size_t)mh.tseg, esuph.esh_compr_tseg, esuph.esh_compr_flags);
+	    if (retval)
 		goto error_exec4;
+	} else
 #endif
-#ifdef CONFIG_EXEC_MMODEL
-	bytes = esuph.esh_ftseg;
-	if (bytes) {
-#ifdef CONFIG_EXEC_COMPRESS
-	    if (esuph.esh_compr_ftseg)
-		bytes = esuph.esh_compr_ftseg;
-#endif
-	    currentp->t_regs.ds = seg_code->base + bytes_to_paras((size_t)mh.tseg);
+	{
+	    currentp->t_regs.ds = seg_code->base;  // segment used by read()
 	    retval = filp->f_op->read(inode, filp, 0, bytes);
 	    if (retval != bytes) {
-		debug("EXEC(ftseg read): bad result %u, expected %u\n", retval, bytes);
+		debug("EXEC(tseg read): bad result %u, expected %u\n", retval, bytes);
 		goto error_exec4;
 	    }
+	}
+#ifdef CONFIG_EXEC_MMODEL
+	bytes = esuph.esh_ftseg;
+	if (bytes) {
+	    seg_t ftseg = seg_code->base + bytes_to_paras((size_t)mh.tseg);
 #ifdef CONFIG_EXEC_COMPRESS
-	    retval = -ENOEXEC;
-	    if (esuph.esh_compr_ftseg &&
-		decompress(0, seg_code->base + bytes_to_paras((size_t)mh.tseg),
-		    (size_t)esuph.esh_ftseg, bytes, 16) != (size_t)esuph.esh_ftseg)
-			goto error_exec4;
+	    if (esuph.esh_compr_ftseg) {
+		retval = read_compressed(inode, filp, ftseg, 0,
+		    bytes, esuph.esh_compr_ftseg, esuph.esh_compr_flags);
+		if (retval)
+		    goto error_exec4;
+	    } else
 #endif
+	    {
+		currentp->t_regs.ds = ftseg;
+		retval = filp->f_op->read(inode, filp, 0, bytes);
+		if (retval != bytes) {
+		    debug("EXEC(ftseg read): bad result %u, expected %u\n", retval, bytes);
+		    goto error_exec4;
+		}
+	    }
 	}
 #endif
     } else {
@@ -386,29 +592,32 @@ int sys_execve(const char *filename, char *sptr, size_t slen)
     paras = len >> 4;
     retval = -ENOMEM;
     debug("EXEC: Allocating 0x%x paragraphs for data segment\n", paras);
-    seg_data = seg_alloc (paras, SEG_FLAG_DSEG);
+    seg_data = seg_alloc (paras, SEG_FLAG_DSEG |
+        (paras <= HIGH_DSEG_PARAS? SEG_FLAG_HIGH: 0));
     if (!seg_data) goto error_exec4;
     debug("EXEC: Malloc succeeded - cs=%x ds=%x\n", seg_code->base, seg_data->base);
 
     bytes = (size_t)mh.dseg;
 #ifdef CONFIG_EXEC_COMPRESS
     if (esuph.esh_compr_dseg) {
-	    bytes = esuph.esh_compr_dseg;
-	    //if (mh.bss < 16 && !stack && !heap)
-		//paras += 1;		/* add 16 bytes for safety offset */
-    }
+	retval = -ENOEXEC;
+	if ((esuph.esh_compr_flags & ESH_COMPR_LZ)
+	    && (size_t)base_data + bytes + DECOMP_SAFETY > len)
+	    goto error_exec5;
+	retval = read_compressed(inode, filp, seg_data->base, (char *)base_data,
+	    bytes, esuph.esh_compr_dseg, esuph.esh_compr_flags);
+	if (retval)
+	    goto error_exec5;
+    } else
 #endif
-    currentp->t_regs.ds = seg_data->base;  // segment used by read()
-    retval = filp->f_op->read(inode, filp, (char *)base_data, bytes);
-    if (retval != bytes) {
-	debug("EXEC(dseg read): bad result %d, expected %u\n", retval, bytes);
-	goto error_exec5;
+    {
+	currentp->t_regs.ds = seg_data->base;  // segment used by read()
+	retval = filp->f_op->read(inode, filp, (char *)base_data, bytes);
+	if (retval != bytes) {
+	    debug("EXEC(dseg read): bad result %d, expected %u\n", retval, bytes);
+	    goto error_exec5;
+	}
     }
-#ifdef CONFIG_EXEC_COMPRESS
-	if (esuph.esh_compr_dseg &&
-	    decompress(0, seg_data->base, (size_t)mh.dseg, bytes, 16) != (size_t)mh.dseg)
-		goto error_exec5;
-#endif
 
 #ifdef CONFIG_EXEC_MMODEL
     if (need_reloc_code) {
@@ -433,10 +642,17 @@ int sys_execve(const char *filename, char *sptr, size_t slen)
 		      inode, filp, mh.tseg);
     if (retval != 0)
 	goto error_exec5;
+
+    /* relocated segment values must stay valid, so keep data segment in place */
+    if (esuph.msh_trsize || esuph.esh_ftrsize || esuph.msh_drsize)
+	seg_data->flags |= SEG_FLAG_FIXED;
 #endif
 
     /* From this point, exec() will surely succeed */
 
+    if (loaded_code)
+	textcache_add(inode, seg_code);
+
     currentp->t_endseg = (__pptr)len;	/* Needed for sys_brk() */
 
     /* Copy the command line and environment */
@@ -450,6 +666,9 @@ int sys_execve(const char *filename, char *sptr, size_t slen)
 
     /* From this point, the old code and data segments are not needed anymore */
 
+    vforked = (currentp->p_parent &&
+		currentp->mm.seg_data == currentp->p_parent->mm.seg_data);
+
     /* Flush the old binary out.  */
     if (currentp->mm.seg_code) seg_put(currentp->mm.seg_code);
     if (currentp->mm.seg_data) seg_put(currentp->mm.seg_data);
@@ -518,9 +737,9 @@ int sys_execve(const char *filename, char *sptr, size_t slen)
      */
     arch_setup_user_stack(currentp, (word_t) mh.entry);
 
-#if UNUSED      /* used only for vfork()*/
-    wake_up(&currentp->p_parent->child_wait);
-#endif
+    /* release a parent suspended in spawnfork() */
+    if (vforked)
+	wake_up(&currentp->p_parent->child_wait);
 
     /* Done */
 
@@ -2,6 +2,7 @@
 #include <linuxmt/memory.h>
 #include <linuxmt/kernel.h>
 #include <linuxmt/debug.h>
+#include <linuxmt/fs.h>
 /*
  * Exomizer decruncher ported to ELKS by Greg Haerr, Apr 2021
  * Copyright (c) 2005-2017 Magnus Lind.
@@ -38,10 +39,13 @@
 static unsigned short int base[52];
 static char bits[52];
 static unsigned char bit_buffer;
-static const char *inp;
+static int inp;                 /* input position in compressed stream */
+static word_t inbase;           /* segment offset of compressed stream start */
+static const unsigned char *inhead; /* first DECOMP_SAFETY bytes of stream */
 static seg_t segp = 0;
 
-#define read_byte()	peekb((word_t)--inp, segp)
+/* compressed stream is read backwards, its first bytes are held in inhead */
+#define read_byte()	(--inp < DECOMP_SAFETY? inhead[inp]: peekb(inbase + inp, segp))
 
 static int bitbuffer_rotate(int carry)
 {
@@ -106,7 +110,7 @@ init_table(void)
 }
 
 static char *
-exo_decrunch(const char *in, char *out)
+exo_decrunch(int in, char *out)
 {
     unsigned short int index;
     unsigned short int length;
@@ -183,9 +187,10 @@ exo_decrunch(const char *in, char *out)
                 c = peekb((word_t)out+offset, segp); /* c = out[offset]; */
             }
 			pokeb((word_t)out, segp, c);			/* *out = c; */
-			if ((int)(out - inp) < 0)
+			if ((int)((word_t)out - (inbase + inp)) < 0)
 			{
-				debug("EXEC: decompress output overflow by %d\n", (int)(out - inp));
+				debug("EXEC: decompress output overflow by %d\n",
+					(int)((word_t)out - (inbase + inp)));
 				return 0;
 			}
         }
@@ -196,20 +201,28 @@ exo_decrunch(const char *in, char *out)
     return out;
 }
 
-size_t decompress(char *buf, seg_t seg, size_t orig_size, size_t compr_size, int safety)
+/*
+ * Decompress in place to buf in seg. The compressed data must have been
+ * read to buf less its first DECOMP_SAFETY bytes, which are passed in head.
+ * This places the stream exactly DECOMP_SAFETY bytes below the output, the
+ * gap the decruncher requires, so the output lands at buf without a copy.
+ */
+size_t decompress(char *buf, seg_t seg, size_t orig_size, size_t compr_size,
+	const unsigned char *head)
 {
-	char *in = buf + compr_size;
-	char *out = buf + orig_size + safety;
+	char *out = buf + orig_size;
 
-	debug("decompress: seg %x orig %u compr %u safety %d\n",
-		seg, orig_size, compr_size, safety);
+	debug("decompress: seg %x orig %u compr %u\n", seg, orig_size, compr_size);
+	if (compr_size <= DECOMP_SAFETY)
+		return 0;
 	segp = seg;
-	out = exo_decrunch(in, out);
-	if (out - buf != safety)
+	inbase = (word_t)buf - DECOMP_SAFETY;
+	inhead = head;
+	out = exo_decrunch(compr_size, out);
+	if (out != buf)
 	{
 		debug("EXEC: decompress error\n");
 		return 0;
 	}
-	fmemcpyb(buf, seg, out, seg, orig_size);
 	return orig_size;
 }
@@ -86,6 +86,12 @@ int sys_fcntl(unsigned int fd, unsigned int cmd, unsigned int arg)
 	}
 	result = -EPERM;
 	break;
+#ifdef CONFIG_PIPE
+    case F_GETPIPE_SZ:
+    case F_SETPIPE_SZ:
+	result = pipe_fcntl(filp->f_inode, cmd, arg);
+	break;
+#endif
     default:
 	result = -EINVAL;
     }
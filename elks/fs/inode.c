@@ -24,6 +24,11 @@ static struct inode *inode_lru = inode_block;
 static struct inode *inode_llru = inode_block;
 static struct wait_queue inode_wait;
 
+/* in-core inodes are also chained by (dev, ino) so iget need not scan the LRU */
+#define NR_IHASH        32      /* power of two */
+#define ihashfn(dev,ino) (((unsigned int)(dev) ^ (unsigned int)(ino)) & (NR_IHASH - 1))
+static struct inode *inode_hash[NR_IHASH];
+
 #ifdef CHECK_FREECNTS
 static int nr_free_inodes = NR_INODE;
 #define DCR_COUNT(i) if(!(--i->i_count))nr_free_inodes++
@@ -59,6 +64,30 @@ static void put_last_lru(register struct inode *inode)
     inode_llru = inode;
 }
 
+/* add inode to its hash chain once i_dev and i_ino are set */
+void insert_inode_hash(register struct inode *inode)
+{
+    struct inode **head = &inode_hash[ihashfn(inode->i_dev, inode->i_ino)];
+
+    inode->i_hash = *head;
+    *head = inode;
+}
+
+/* remove inode from its hash chain before i_dev or i_ino change */
+static void remove_inode_hash(register struct inode *inode)
+{
+    register struct inode **p;
+
+    if (!inode->i_ino)
+        return;
+    for (p = &inode_hash[ihashfn(inode->i_dev, inode->i_ino)]; *p; p = &(*p)->i_hash) {
+        if (*p == inode) {
+            *p = inode->i_hash;
+            break;
+        }
+    }
+}
+
 /*
  * Note that we don't have to care about wait queues unlike Linux proper
  * because they are not in the object as such
@@ -67,6 +96,7 @@ static void put_last_lru(register struct inode *inode)
 void clear_inode(register struct inode *inode) /* and put_first_lru() */
 {
     remove_inode_free(inode);
+    remove_inode_hash(inode);
     CLR_COUNT(inode);
     memset(inode, 0, sizeof(struct inode));
     //inode->i_prev = NULL;
@@ -151,7 +181,7 @@ void invalidate_inodes(kdev_t dev)
     } while ((inode = prev) != NULL);
 }
 
-static void write_inode(register struct inode *inode)
+void write_inode(register struct inode *inode)
 {
     register struct super_block *sb = inode->i_sb;
     if (inode->i_dirt) {
@@ -238,6 +268,7 @@ void iput(register struct inode *inode)
         DCR_COUNT(inode);
 #ifdef CHECK_FREECNTS
         if (inode->i_count == 0) {
+            remove_inode_hash(inode);
             inode->i_dev = 0;
             inode->i_ino = 0;
         }
@@ -320,10 +351,9 @@ struct inode *iget(struct super_block *sb, ino_t inr)
         debug("iget: getting an empty inode...\n");
         n_ino = get_empty_inode();      /* This function may sleep and someone else */
       start:                            /* can create the inode */
-        inode = inode_llru;
-        do {
+        for (inode = inode_hash[ihashfn(sb->s_dev, inr)]; inode; inode = inode->i_hash) {
             if (inode->i_ino == inr && inode->i_dev == sb->s_dev) goto found_it;
-        } while ((inode = inode->i_prev) != NULL);
+        }
     } while (n_ino == NULL);
     inode = n_ino;                      /* Inode not found, use the new structure */
     debug("iget: got one...\n");
@@ -332,6 +362,7 @@ struct inode *iget(struct super_block *sb, ino_t inr)
     inode->i_dev = sb->s_dev;
     inode->i_flags = sb->s_flags;
     inode->i_ino = inr;
+    insert_inode_hash(inode);
     read_inode(inode);
     goto return_it;
 
@@ -354,6 +385,49 @@ struct inode *iget(struct super_block *sb, ino_t inr)
     return inode;
 }
 
+#ifdef CONFIG_FS_FLUSHER
+/*
+ * Releasing the zones of a large unlinked file can be left to the flusher
+ * task so unlink returns at once. A queued inode keeps the last reference
+ * iput didn't drop, and its put_inode is called again by the flusher.
+ */
+#define NR_DEFERRED     4
+static struct inode *deferred[NR_DEFERRED];
+static int in_deferred;
+
+/* queue unlinked inode for put_deferred_inodes, returns 0 if not queued */
+int defer_put_inode(struct inode *inode)
+{
+    int i;
+
+    if (in_deferred)
+        return 0;
+    for (i = 0; i < NR_DEFERRED; i++) {
+        if (!deferred[i]) {
+            deferred[i] = inode;
+            wake_flusher();
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void put_deferred_inodes(void)
+{
+    register struct inode *inode;
+    int i;
+
+    in_deferred++;
+    for (i = 0; i < NR_DEFERRED; i++) {
+        if ((inode = deferred[i]) != NULL) {
+            deferred[i] = NULL;
+            inode->i_sb->s_op->put_inode(inode);
+        }
+    }
+    in_deferred--;
+}
+#endif
+
 int fs_may_mount(kdev_t dev)    /* and invalidate_inodes() */
 {
     register struct inode *prev;
@@ -372,6 +446,10 @@ int fs_may_umount(kdev_t dev, struct inode *mount_rooti)
 {
     register struct inode *inode = inode_llru;
 
+#ifdef CONFIG_FS_FLUSHER
+    put_deferred_inodes();
+#endif
+
     do {
         if (inode->i_dev != dev || !inode->i_count) continue;
         if ((inode != mount_rooti) || (inode->i_count != 1))
@@ -385,6 +463,9 @@ int fs_may_remount_ro(kdev_t dev)
     register struct file *file = file_array;
     register struct inode *inode;
 
+#ifdef CONFIG_FS_FLUSHER
+    put_deferred_inodes();
+#endif
     /* Check that no files are currently opened for writing. */
     do {
         inode = file->f_inode;
@@ -399,6 +480,26 @@ int fs_may_remount_ro(kdev_t dev)
 }
 
 /* POSIX UID/GID verification for setting inode attributes */
+/*
+ * Set the access time after a read. Nothing is changed on a read-only or
+ * noatime file system, and with relatime only if the access time is not
+ * already later than the last change or is more than a day old.
+ */
+void update_atime(register struct inode *inode)
+{
+    register struct super_block *sb = inode->i_sb;
+    time_t now;
+
+    if (sb && (sb->s_flags & (MS_RDONLY|MS_NOATIME)))
+        return;
+    now = current_time();
+    if (sb && (sb->s_flags & MS_RELATIME) &&
+        inode->i_atime >= inode->i_mtime && inode->i_atime >= inode->i_ctime &&
+        now - inode->i_atime < 24*60*60L)
+        return;
+    inode->i_atime = now;
+}
+
 #if USE_NOTIFY_CHANGE
 static int inode_change_ok(register struct inode *inode,
                            register struct iattr *attr)
@@ -79,6 +79,19 @@ unsigned short minix_count_free_inodes(register struct super_block *sb)
 	    sb->u.minix_sb.s_ninodes));
 }
 
+/*
+ * Recount free zones and inodes from the bitmaps, called at mount and when
+ * remounting read-write (possibly after fsck). The counts are kept up to date
+ * by the allocation routines afterwards so statfs needn't rescan the maps.
+ */
+void minix_init_free_counts(register struct super_block *sb)
+{
+    sb->u.minix_sb.s_zone_hint = 0;
+    sb->u.minix_sb.s_free_zones =
+	minix_count_free_blocks(sb) >> sb->u.minix_sb.s_log_zone_size;
+    sb->u.minix_sb.s_free_inodes = minix_count_free_inodes(sb);
+}
+
 void minix_free_block(register struct super_block *sb, unsigned short block)
 {
     register struct buffer_head *bh;
@@ -99,6 +112,7 @@ void minix_free_block(register struct super_block *sb, unsigned short block)
 	    map_buffer(bh);
 	    if (!clear_bit(zone & 8191, bh->b_data))
 		s = "already cleared";
+	    else sb->u.minix_sb.s_free_zones++;
 	    mark_buffer_dirty(bh);
 	    unmap_brelse(bh);
 	}
@@ -107,25 +121,87 @@ void minix_free_block(register struct super_block *sb, unsigned short block)
 	printk("free_block: block %u %s\n", block, s);
 }
 
-block_t minix_new_block(struct super_block *sb)
+/*
+ * Free a zone for truncate. The zone bitmap block is kept mapped in zf
+ * while following zones are in the same block, so a large file is freed
+ * with one map and dirtying per bitmap block. The caller marks any cached
+ * data buffer of the zone clean, and releases zf with minix_free_zones_done().
+ */
+void minix_free_zone(struct super_block *sb, struct minix_zfree *zf, block_t block)
+{
+    unsigned int zone;
+
+    if (block < sb->u.minix_sb.s_firstdatazone || block >= sb->u.minix_sb.s_nzones) {
+	printk("free_block: block %u not in datazone\n", block);
+	return;
+    }
+    zone = block - sb->u.minix_sb.s_firstdatazone + 1;
+    if (zf->bh && zf->map != (zone >> 13))
+	minix_free_zones_done(zf);
+    if (!zf->bh) {
+	zf->map = zone >> 13;
+	if (!(zf->bh = get_map_block(sb->s_dev, sb->u.minix_sb.s_zmap[zf->map]))) {
+	    printk("free_block: block %u null zmap\n", block);
+	    return;
+	}
+	map_buffer(zf->bh);
+	mark_buffer_dirty(zf->bh);
+    }
+    if (!clear_bit(zone & 8191, zf->bh->b_data))
+	printk("free_block: block %u already cleared\n", block);
+    else sb->u.minix_sb.s_free_zones++;
+}
+
+void minix_free_zones_done(struct minix_zfree *zf)
 {
+    if (zf->bh) {
+	unmap_brelse(zf->bh);
+	zf->bh = NULL;
+    }
+}
+
+/*
+ * Allocate a new zone, searching the zone bitmap from the zone following goal
+ * if given, else from where the last allocation left off, and wrapping around.
+ */
+block_t minix_new_block(struct super_block *sb, block_t goal)
+{
+    struct minix_sb_info *msb;
     struct buffer_head *bh = NULL;
-    block_t i, j;
+    block_t i, j, n, start, nbits, limit;
     if (!sb) return 0;
+    msb = &sb->u.minix_sb;
 
 repeat:
-    j = 8192;
-    for (i = 0; i < sb->u.minix_sb.s_zmap_blocks; i++) {
-        if (i > 0)
-            unmap_brelse(bh);
-        if ((bh = get_map_block(sb->s_dev, sb->u.minix_sb.s_zmap[i])) != NULL) {
+    if (!msb->s_free_zones)             /* don't scan bitmaps when full */
+        return 0;
+    nbits = msb->s_nzones - msb->s_firstdatazone + 1;
+    if (goal >= msb->s_firstdatazone && goal < msb->s_nzones)
+        start = goal - msb->s_firstdatazone + 1;
+    else
+        start = msb->s_zone_hint;
+    if (start >= nbits)
+        start = 0;
+
+    i = start >> 13;
+    j = start & 8191;
+    for (n = 0; n <= msb->s_zmap_blocks; n++) {
+        if ((bh = get_map_block(sb->s_dev, msb->s_zmap[i])) != NULL) {
+            limit = nbits - (i << 13);
+            if (limit > 8192)
+                limit = 8192;
             map_buffer(bh);
-            if ((j = find_first_zero_bit((void *)bh->b_data, 8192)) < 8192)
+            if ((j = find_next_zero_bit((void *)bh->b_data, limit, j)) < limit)
                 break;
+            unmap_brelse(bh);
+            bh = NULL;
         }
+        j = 0;
+        if (++i >= msb->s_zmap_blocks)
+            i = 0;
     }
-    if (i >= sb->u.minix_sb.s_zmap_blocks || !bh || j >= 8192) {
-        if (bh) unmap_brelse(bh);
+    if (!bh) {
+        msb->s_free_zones = 0;
         return 0;
     }
     if (set_bit(j, bh->b_data)) {
@@ -135,6 +211,8 @@ repeat:
     }
     mark_buffer_dirty(bh);
     unmap_brelse(bh);
+    msb->s_free_zones--;
+    msb->s_zone_hint = (i << 13) + j + 1;
     j += i*8192 + sb->u.minix_sb.s_firstdatazone - 1;
     if (j < sb->u.minix_sb.s_firstdatazone || j >= sb->u.minix_sb.s_nzones) {
         return 0;
@@ -180,6 +258,7 @@ void minix_free_inode(register struct inode *inode)
 	map_buffer(bh);
 	if (!clear_bit((int)inode->i_ino & 8191, bh->b_data))
 	    printk("free_inode: already cleared %d\n", (int)inode->i_ino & 8191);
+	else inode->i_sb->u.minix_sb.s_free_inodes++;
 	clear_inode(inode);
 	mark_buffer_dirty(bh);
 	unmap_brelse(bh);
@@ -221,8 +300,11 @@ struct inode *minix_new_inode(struct inode *dir, __u16 mode)
     }
     mark_buffer_dirty(bh);
     unmap_brelse(bh);
+    if (sb->u.minix_sb.s_free_inodes)
+        sb->u.minix_sb.s_free_inodes--;
     inode->i_dirt = 1;
     inode->i_ino = j;
+    insert_inode_hash(inode);
     return inode;
 
 errout:
@@ -13,6 +13,7 @@
 #include <linuxmt/minix_fs.h>
 #include <linuxmt/stat.h>
 #include <linuxmt/config.h>
+#include <linuxmt/limits.h>
 
 #include <arch/segment.h>
 
@@ -59,6 +60,36 @@ struct inode_operations minix_dir_inode_operations = {
 
 /*@+type@*/
 
+/*
+ * Read ahead the inode table blocks of the entries in a directory block
+ * from 'offset' on, since ls -l, find and du will iget each one next.
+ * The distinct blocks are submitted together, so a scan of a directory
+ * whose inodes are spread out costs one pass per directory block rather
+ * than a disk access per inode.
+ */
+static void minix_inode_readahead(struct inode *dir, struct buffer_head *bh,
+				  unsigned short offset)
+{
+    struct minix_sb_info *info = &dir->i_sb->u.minix_sb;
+    struct minix_dir_entry *de;
+    block_t blocks[MAX_READAHEAD];
+    block_t block, first;
+    int i, n = 0;
+
+    first = info->s_imap_blocks + 2 + info->s_zmap_blocks;
+    for (; offset < BLOCK_SIZE && n < MAX_READAHEAD; offset += info->s_dirsize) {
+	de = (struct minix_dir_entry *) (offset + bh->b_data);
+	if (!de->inode || de->inode > info->s_ninodes)
+	    continue;
+	block = first + (de->inode - 1) / MINIX_INODES_PER_BLOCK;
+	for (i = 0; i < n; i++)
+	    if (blocks[i] == block) break;
+	if (i == n)
+	    blocks[n++] = block;
+    }
+    block_readahead_list(dir->i_dev, blocks, n);	/* cached blocks are skipped */
+}
+
 static int minix_readdir(struct inode *inode,
 			 register struct file *filp,
 			 char *dirent, filldir_t filldir)
@@ -78,14 +109,13 @@ static int minix_readdir(struct inode *inode,
 	    filp->f_pos += (BLOCK_SIZE - offset);
 	    continue;
 	} else map_buffer(bh);
+	minix_inode_readahead(inode, bh, offset);
 	do {
 	    de = (struct minix_dir_entry *) (offset + bh->b_data);
-	    if (de->inode) {
-			filldir(dirent, de->name, strnlen(de->name, info->s_namelen),
-				filp->f_pos, de->inode);
-			filp->f_pos += info->s_dirsize;
-		    unmap_brelse(bh);
-		    return 0;
+	    if (de->inode && filldir(dirent, de->name, strnlen(de->name, info->s_namelen),
+				    filp->f_pos, de->inode) < 0) {
+		unmap_brelse(bh);	/* caller's buffer full, f_pos at this entry */
+		return 0;
 	    }
 	    offset += info->s_dirsize;
 	    filp->f_pos += info->s_dirsize;
@@ -21,7 +21,7 @@
 
 /* Static functions in this file */
 
-static unsigned short map_iblock(register struct inode *,block_t,block_t,int);
+static unsigned short map_iblock(register struct inode *,block_t,block_t,int,block_t);
 static unsigned short map_izone(register struct inode *,block_t,int);
 static int minix_set_super_state(struct super_block *sb, int notflags, int state);
 static void minix_read_inode(register struct inode *);
@@ -29,9 +29,16 @@ static struct buffer_head *minix_update_inode(register struct inode *);
 
 /* Function definitions */
 
+/* files at least this big have their zones freed by the flusher task */
+#define DEFER_FREE_SIZE	(64 * 1024L)
+
 static void minix_put_inode(register struct inode *inode)
 {
     if (!inode->i_nlink) {
+#ifdef CONFIG_FS_FLUSHER
+	if (inode->i_size >= DEFER_FREE_SIZE && defer_put_inode(inode))
+	    return;
+#endif
 	inode->i_size = 0;
 	minix_truncate(inode);
 	minix_free_inode(inode);
@@ -71,6 +78,7 @@ void minix_write_super(register struct super_block *sb)
 void minix_put_super(register struct super_block *sb)
 {
 	debug_sup("MINIX put super\n");
+	dcache_inval(sb->s_dev, 0);
 	lock_super(sb);
 	if (!(sb->s_flags & MS_RDONLY))
 		minix_set_super_state(sb, 0, sb->u.minix_sb.s_mount_state);	/* set original fs state*/
@@ -114,6 +122,8 @@ int minix_remount(register struct super_block *sb, int *flags, char *data)
 		debug_sup("MINIX remount RO to RW\n");
 		sb->u.minix_sb.s_mount_state = minix_set_super_state(sb, ~MINIX_VALID_FS, 0); /* unset fs checked flag*/
 		sb->s_dirt = 1;
+		minix_init_free_counts(sb);	/* fsck may have changed the maps */
+		dcache_inval(sb->s_dev, 0);	/* and directories */
 		minix_mount_warning(sb, "re");
 	}
     return 0;
@@ -180,6 +190,8 @@ struct super_block *minix_read_super(register struct super_block *s, char *data,
 	    goto err_read_super_1;
 	}
 
+    minix_init_free_counts(s);
+
     unlock_super(s);
     /* set up enough so that it can read an inode */
     s->s_op = &minix_sops;
@@ -211,10 +223,10 @@ void minix_statfs(struct super_block *s, struct statfs *sf, int flags)
 {
     sf->f_bsize = BLOCK_SIZE;
     sf->f_blocks = s->u.minix_sb.s_nzones << s->u.minix_sb.s_log_zone_size;
-    sf->f_bfree = minix_count_free_blocks(s);
+    sf->f_bfree = (long)s->u.minix_sb.s_free_zones << s->u.minix_sb.s_log_zone_size;
     sf->f_bavail = sf->f_bfree;
     sf->f_files = s->u.minix_sb.s_ninodes;
-    sf->f_ffree = minix_count_free_inodes(s);
+    sf->f_ffree = s->u.minix_sb.s_free_inodes;
 }
 
 /* Adapted from Linux 0.12's inode.c.  _bmap() is a big function, I know
@@ -226,7 +238,8 @@ static unsigned short map_izone(register struct inode *inode, block_t block, int
     register __u16 *i_zone = &(inode->u.minix_i.i_zone[block]);
 
     if (create && !(*i_zone)) {
-	if ((*i_zone = minix_new_block(inode->i_sb))) {
+	/* place new zone after the file's previous zone when possible */
+	if ((*i_zone = minix_new_block(inode->i_sb, block? i_zone[-1]: 0))) {
 	    inode->i_ctime = current_time();
 	    inode->i_dirt = 1;
 	}
@@ -234,12 +247,19 @@ static unsigned short map_izone(register struct inode *inode, block_t block, int
     return *i_zone;
 }
 
+/*
+ * Return zone at index block of indirect block i. If fblock, the file block
+ * being mapped, is nonzero this is the last indirection, and the run of
+ * contiguous zones starting there is cached so that following sequential
+ * blocks are mapped without reading the indirect block again.
+ */
 static unsigned short map_iblock(struct inode *inode, block_t i,
-				 block_t block, int create)
+				 block_t block, int create, block_t fblock)
 {
     register struct buffer_head *bh;
     register block_t *b_zone;
     block_t b;
+    unsigned int n;
 
     if (!(bh = bread(inode->i_dev, i))) {
 	return 0;
@@ -247,11 +267,18 @@ static unsigned short map_iblock(struct inode *inode, block_t i,
     map_buffer(bh);
     b_zone = &(((block_t *) (bh->b_data))[block]);
     if (create && !(*b_zone)) {
-	if ((*b_zone = minix_new_block(inode->i_sb))) {
+	if ((*b_zone = minix_new_block(inode->i_sb, block? b_zone[-1]: i))) {
 	    mark_buffer_dirty(bh);
 	}
     }
     b = *b_zone;
+    if (fblock && b) {
+	for (n = 1; block + n < 512 && b_zone[n] == b + n; n++)
+	    continue;
+	inode->u.minix_i.i_run_block = fblock;
+	inode->u.minix_i.i_run_zone = b;
+	inode->u.minix_i.i_run_count = n;
+    }
     unmap_brelse(bh);
     return b;
 }
@@ -259,6 +286,7 @@ static unsigned short map_iblock(struct inode *inode, block_t i,
 unsigned short _minix_bmap(register struct inode *inode, block_t block, int create)
 {
     int i;
+    block_t fblock = block;
 
 #if UNUSED  /* block always less than 65536 */
     if (block > (7 + 512 + 512 * 512))
@@ -267,6 +295,8 @@ unsigned short _minix_bmap(register struct inode *inode, block_t block, int crea
 
     if (block < 7)
 	return map_izone(inode, block, create);
+    if ((block_t)(block - inode->u.minix_i.i_run_block) < inode->u.minix_i.i_run_count)
+	return inode->u.minix_i.i_run_zone + (block - inode->u.minix_i.i_run_block);
     block -= 7;
     if (block < 512) {
 	i = map_izone(inode, 7, create);
@@ -281,7 +311,7 @@ unsigned short _minix_bmap(register struct inode *inode, block_t block, int crea
     i = map_izone(inode, 8, create);
     if (i != 0) {
 	/* Two layer indirection */
-	i = map_iblock(inode, (block_t)i, (block_t) (block >> 9), create);
+	i = map_iblock(inode, (block_t)i, (block_t) (block >> 9), create, 0);
 
   map1:
 	/*
@@ -289,7 +319,7 @@ unsigned short _minix_bmap(register struct inode *inode, block_t block, int crea
 	 */
 	if (i != 0)
 	    /* Ok now load the second indirect block */
-	    i = map_iblock(inode, (block_t)i, (block_t) (block & 511), create);
+	    i = map_iblock(inode, (block_t)i, (block_t) (block & 511), create, fblock);
     }
     return i;
 }
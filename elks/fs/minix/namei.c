@@ -36,7 +36,7 @@ static int namecompare(size_t len, size_t max, const char *name, register char *
  *
  * NOTE! unlike strncmp, minix_match returns 1 for success, 0 for failure.
  *
- * Note2: bh must already be mapped!
+ * Note2: de must be in kernel data, from a mapped bh or get_dir_entry()!
  */
 static int minix_match(size_t len,
 		       const char *name,
@@ -53,6 +53,29 @@ static int minix_match(size_t len,
     return namecompare(len, minixlen, name, de->name);
 }
 
+/*
+ * Directory blocks are scanned straight from L2 a directory entry at a time,
+ * so only the block holding the wanted entry is mapped into L1. With the
+ * INT 15 XMS driver each copy is a BIOS block move, so map the whole block.
+ */
+#ifdef CONFIG_FS_XMS_INT15
+#define map_dirblock(bh)	map_buffer(bh)
+#define unmap_dirblock(bh)	unmap_buffer(bh)
+#else
+#define map_dirblock(bh)
+#define unmap_dirblock(bh)
+#endif
+
+static struct minix_dir_entry *get_dir_entry(struct buffer_head *bh,
+					     unsigned short offset, __u16 *debuf,
+					     size_t dirsize)
+{
+    if (bh->b_data)
+	return (struct minix_dir_entry *)(bh->b_data + offset);
+    buffer_get(bh, offset, debuf, dirsize);
+    return (struct minix_dir_entry *)debuf;
+}
+
 /*
  *	minix_find_entry()
  *
@@ -61,6 +84,10 @@ static int minix_match(size_t len,
  * itself (as a parameter - res_dir). It does NOT read the inode of the
  * entry - you'll have to do that yourself if you want to.
  *
+ * The search starts after the entry last found and wraps around, so
+ * names looked up in directory order, as by ls -l or shell completion
+ * after readdir, are each found at once instead of by a scan from the start.
+ *
  * If succesful, the buffer cache returns MAPPED, otherwise returns NULL
  *
  */
@@ -71,11 +98,12 @@ static struct buffer_head *minix_find_entry(register struct inode *dir,
 {
     register struct buffer_head *bh;
     struct minix_sb_info *info;
-    __u32 bo;
+    __u32 bo, start, next;
     unsigned short offset;
+    __u16 debuf[16];		/* s_dirsize <= 32 */
 
     *res_dir = NULL;
-    if (!dir || !dir->i_sb)
+    if (!dir || !dir->i_sb || !dir->i_size)
 	return NULL;
     info = &dir->i_sb->u.minix_sb;
     if (namelen > info->s_namelen) {
@@ -87,27 +115,38 @@ static struct buffer_head *minix_find_entry(register struct inode *dir,
 #endif
 
     }
-    bo = 0L;
-    offset = 0;
-    goto minix_find;
+    start = (__u32)dir->u.minix_i.i_diroff * info->s_dirsize;
+    if (start >= dir->i_size)
+	start = 0;
+    bo = start;
     do {
-	offset = (__u16)bo & (BLOCK_SIZE - 1);
-	if (!offset) {
-	    unmap_brelse(bh);
-      minix_find:
-	    bh = minix_bread(dir, (__u16)(bo >> BLOCK_SIZE_BITS), 0);
-	    if (!bh) {
-		continue;
-	    }
-	    map_buffer(bh);
-	}
-	if (minix_match(namelen, name,
-		(struct minix_dir_entry *)(bh->b_data + offset), info->s_namelen)) {
-	    *res_dir = (struct minix_dir_entry *) (bh->b_data + offset);
-	    return bh;
+	bh = minix_bread(dir, (__u16)(bo >> BLOCK_SIZE_BITS), 0);
+	if (!bh) {
+	    next = (bo | (BLOCK_SIZE - 1)) + 1;	/* skip missing block */
+	    if (bo < start && next > start)
+		break;
+	    bo = next;
+	} else {
+	    map_dirblock(bh);
+	    offset = (__u16)bo & (BLOCK_SIZE - 1);
+	    do {
+		if (minix_match(namelen, name,
+			get_dir_entry(bh, offset, debuf, info->s_dirsize), info->s_namelen)) {
+		    map_buffer(bh);
+		    unmap_dirblock(bh);
+		    *res_dir = (struct minix_dir_entry *) (bh->b_data + offset);
+		    dir->u.minix_i.i_diroff = (__u16)(bo / info->s_dirsize) + 1;
+		    return bh;
+		}
+		bo += info->s_dirsize;
+		offset += info->s_dirsize;
+	    } while (offset < BLOCK_SIZE && bo < dir->i_size && bo != start);
+	    unmap_dirblock(bh);
+	    brelse(bh);
 	}
-    } while ((bo += info->s_dirsize) < dir->i_size);
-    unmap_brelse(bh);
+	if (bo >= dir->i_size)
+	    bo = 0;
+    } while (bo != start);
     return NULL;
 }
 
@@ -116,6 +155,8 @@ int minix_lookup(register struct inode *dir, const char *name, size_t len,
 {
     struct minix_dir_entry *de;
     struct buffer_head *bh;
+    ino_t ino;
+    unsigned int gen;
     int error;
 
     error = -ENOENT;
@@ -123,14 +164,27 @@ int minix_lookup(register struct inode *dir, const char *name, size_t len,
 
 /*    if (dir) { dir != NULL always, because reached this function dereferencing dir */
 	if (S_ISDIR(dir->i_mode)) {
+	    if (len <= dir->i_sb->u.minix_sb.s_namelen && dcache_lookup(dir, name, len, &ino)) {
+		if (ino) {
+		    *result = iget(dir->i_sb, ino);
+		    error = (!*result) ? -EACCES : 0;
+		}
+		iput(dir);
+		return error;
+	    }
+	    gen = dcache_gen;
 	    debug("minix_lookup: Entering minix_find_entry\n");
 	    bh = minix_find_entry(dir, name, len, &de);
 	    debug("minix_lookup: minix_find_entry returned %x %d\n", bh, bh->b_mapcount);
+	    ino = 0;
 	    if (bh) {
-		*result = iget(dir->i_sb, (ino_t) de->inode);
+		ino = (ino_t) de->inode;
+		*result = iget(dir->i_sb, ino);
 		unmap_brelse(bh);
 		error = (!*result) ? -EACCES : 0;
 	    }
+	    if (len <= dir->i_sb->u.minix_sb.s_namelen)
+		dcache_add(dir, name, len, ino, gen);
 	}
 	iput(dir);
 /*    }*/
@@ -196,6 +250,7 @@ static int minix_add_entry(register struct inode *dir,
     }
     dir->i_mtime = dir->i_ctime = current_time();
     dir->i_dirt = 1;
+    dcache_remove(dir, name, namelen);
     memcpy_fromfs(de->name, name, namelen);
     if (info->s_namelen > namelen)
 	memset(de->name + namelen, 0, info->s_namelen - namelen);
@@ -408,6 +463,8 @@ int minix_rmdir(register struct inode *dir, char *name, size_t len)
 		if (inode->i_nlink != 2)
 		    printk("empty directory has nlink!=2 (%u)\n", inode->i_nlink);
 		de->inode = 0;
+		dcache_remove(dir, name, len);
+		dcache_inval(inode->i_dev, inode->i_ino);
 
 		mark_buffer_dirty(bh);
 		inode->i_nlink = 0;
@@ -455,6 +512,7 @@ int minix_unlink(register struct inode *dir, char *name, size_t len)
 	inode->i_nlink = 1;
     }
     de->inode = 0;
+    dcache_remove(dir, name, len);
 
     mark_buffer_dirty(bh);
     dir->i_ctime = dir->i_mtime = current_time();
@@ -33,7 +33,7 @@
 /*
  * The functions for minix V1 fs truncation.
  */
-static int V1_trunc_direct(register struct inode *inode)
+static int V1_trunc_direct(register struct inode *inode, struct minix_zfree *zf)
 {
     unsigned short *p;
     register struct buffer_head *bh;
@@ -62,12 +62,12 @@ static int V1_trunc_direct(register struct inode *inode)
 	    mark_buffer_clean(bh);
 	    brelse(bh);
 	}
-	minix_free_block(inode->i_sb, tmp);
+	minix_free_zone(inode->i_sb, zf, tmp);
     }
     return retry;
 }
 
-static int V1_trunc_indirect(register struct inode *inode,
+static int V1_trunc_indirect(register struct inode *inode, struct minix_zfree *zf,
 			     unsigned int offset, unsigned short *p)
 {
     struct buffer_head *bh;
@@ -110,8 +110,11 @@ static int V1_trunc_indirect(register struct inode *inode,
 	}
 	*ind = 0;
 	mark_buffer_dirty(ind_bh);
-	brelse(bh);
-	minix_free_block(inode->i_sb, tmp);
+	if (bh) {
+	    mark_buffer_clean(bh);
+	    brelse(bh);
+	}
+	minix_free_zone(inode->i_sb, zf, tmp);
     }
     ind = (unsigned short *) ind_bh->b_data;
     for (i = 0; i < 512; i++)
@@ -121,14 +124,15 @@ static int V1_trunc_indirect(register struct inode *inode,
 	else {
 	    tmp = *p;
 	    *p = 0;
-	    minix_free_block(inode->i_sb, tmp);
+	    mark_buffer_clean(ind_bh);
+	    minix_free_zone(inode->i_sb, zf, tmp);
 	}
     }
     unmap_brelse(ind_bh);
     return retry;
 }
 
-static int V1_trunc_dindirect(register struct inode *inode,
+static int V1_trunc_dindirect(register struct inode *inode, struct minix_zfree *zf,
 			      unsigned int offset, unsigned short *p)
 {
     int i;
@@ -154,7 +158,7 @@ static int V1_trunc_dindirect(register struct inode *inode,
 	if (i < 0) i = 0;
 	if (i < DINDIRECT_BLOCK(offset)) goto repeat;
 	dind = i + (unsigned short *) dind_bh->b_data;
-	retry |= V1_trunc_indirect(inode, offset + (i << 9), dind);
+	retry |= V1_trunc_indirect(inode, zf, offset + (i << 9), dind);
 	mark_buffer_dirty(dind_bh);
     }
     dind = (unsigned short *) dind_bh->b_data;
@@ -166,7 +170,8 @@ static int V1_trunc_dindirect(register struct inode *inode,
 	    tmp = *p;
 	    *p = 0;
 	    inode->i_dirt = 1;
-	    minix_free_block(inode->i_sb, tmp);
+	    mark_buffer_clean(dind_bh);
+	    minix_free_zone(inode->i_sb, zf, tmp);
 	}
     }
     unmap_brelse(dind_bh);
@@ -175,14 +180,18 @@ static int V1_trunc_dindirect(register struct inode *inode,
 
 void minix_truncate(register struct inode *inode)
 {
+    struct minix_zfree zf;
     int retry;
 
     if (!(S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode) ||
 	  S_ISLNK(inode->i_mode))) return;
+    inode->u.minix_i.i_run_count = 0;
+    zf.bh = NULL;
     while (1) {
-	retry = V1_trunc_direct(inode);
-	retry |= V1_trunc_indirect(inode, 7, &inode->u.minix_i.i_zone[7]);
-	retry |= V1_trunc_dindirect(inode, 7 + 512, &inode->u.minix_i.i_zone[8]);
+	retry = V1_trunc_direct(inode, &zf);
+	retry |= V1_trunc_indirect(inode, &zf, 7, &inode->u.minix_i.i_zone[7]);
+	retry |= V1_trunc_dindirect(inode, &zf, 7 + 512, &inode->u.minix_i.i_zone[8]);
+	minix_free_zones_done(&zf);
 	if (!retry) break;
 	schedule();
     }
@@ -216,34 +216,47 @@ int FATPROC msdos_get_entry_long(
 	return 0;
 }
 
-/* Read a complete directory entry for a (specified) file,
- * submit a message to the callback function,
+/* Read complete directory entries from f_pos on,
+ * submitting each to the callback function until it returns an error,
  * return a value of 0 or an error code.
+ * Each entry's offset is where it starts, so seeking there rereads it.
  */
 static int msdos_readdir(struct inode *dir, struct file *filp, char *dirbuf,
 	filldir_t filldir)
 {
 	struct buffer_head *bh = NULL;
 	ino_t ino;
-	off_t dirpos;
+	off_t dirpos, pos;
 	int res, namelen;
 	ASYNCIO_REENTRANT char name[14];
 
 	if (!dir || !S_ISDIR(dir->i_mode)) return -EBADF;
 	if (dir->i_ino == MSDOS_ROOT_INO) {
-		/* Fake . and .. for the root directory*/
-		if ((int)filp->f_pos < 2) {
+		/* Fake . and .. for the root directory at offsets 0 and 1*/
+		while ((int)filp->f_pos < 2) {
 			/* Tricky: returns "." or ".." depending on namelen*/
-			size_t namlen = (size_t)++filp->f_pos;
-			return filldir(dirbuf, (char *)"..", namlen, filp->f_pos, (ino_t)MSDOS_ROOT_INO);
+			size_t namlen = (size_t)filp->f_pos + 1;
+			if (filldir(dirbuf, (char *)"..", namlen, filp->f_pos, (ino_t)MSDOS_ROOT_INO) < 0)
+				return 0;
+			filp->f_pos++;
 		}
 		if ((int)filp->f_pos == 2)	/* reset to 0 after '..' for real directory offset*/
 			filp->f_pos = 0;
 	}
 
-	res = msdos_get_entry_long(dir, &filp->f_pos, &bh, name, &namelen, &dirpos, &ino);
-	if (res > 0)
-		filldir(dirbuf, name, namelen, dirpos, ino);
+	for (;;) {
+		pos = filp->f_pos;
+		res = msdos_get_entry_long(dir, &filp->f_pos, &bh, name, &namelen, &dirpos, &ino);
+		if (res <= 0)
+			break;
+		if (dir->i_ino == MSDOS_ROOT_INO && pos == 0)
+			pos = 2;			/* 0 would be '.' again*/
+		if (filldir(dirbuf, name, namelen, pos, ino) < 0) {
+			filp->f_pos = pos;		/* caller's buffer full*/
+			res = 0;
+			break;
+		}
+	}
 	if (bh)
 		unmap_brelse(bh);
 	if (res < 0)
@@ -0,0 +1,204 @@
+/*
+ * FAT directory name index
+ *
+ * Lookups in a large directory would otherwise read and convert every
+ * entry. The first lookup in a directory of at least DIRHASH_MIN entries
+ * scans it once, hashing each name as returned by msdos_get_entry_long, and
+ * records the directory position of each entry in a far segment. Later
+ * lookups only read the entries whose hash matches, and a name not in the
+ * index is known not to exist.
+ *
+ * At most NR_DIRHASH directories are indexed, the least recently used
+ * index being dropped for a new one, and directories of more than
+ * DIRHASH_MAX entries are not indexed. Any change to a directory's entries
+ * drops its index.
+ */
+
+#include <linuxmt/sched.h>
+#include <linuxmt/msdos_fs.h>
+#include <linuxmt/kernel.h>
+#include <linuxmt/errno.h>
+#include <linuxmt/string.h>
+#include <linuxmt/mm.h>
+#include <linuxmt/memory.h>
+#include <linuxmt/debug.h>
+
+#define NR_DIRHASH      2       /* directories indexed at once */
+#define DIRHASH_MIN     128     /* smallest directory indexed, in entries */
+#define DIRHASH_MAX     4096    /* largest directory indexed, in entries */
+#define DIRHASH_BUCKETS 256
+
+struct dirhash_ent {
+	unsigned short  next;       /* next entry in bucket + 1, 0 at end */
+	unsigned short  hash;       /* full name hash */
+	unsigned short  pos;        /* directory position / 32 to read entry from */
+};
+
+struct dirhash {
+	kdev_t          dev;        /* 0 if unused */
+	ino_t           dir;
+	segment_s       *seg;       /* bucket heads then entries */
+	unsigned int    lru;
+};
+
+static struct dirhash dirhash[NR_DIRHASH];
+static unsigned int dirhash_stamp;
+static unsigned int dirhash_gen;        /* incremented on each invalidation */
+
+#define HEADS(h)    ((unsigned short __far *)_MK_FP((h)->seg->base, 0))
+#define ENTS(h)     ((struct dirhash_ent __far *)_MK_FP((h)->seg->base, \
+						DIRHASH_BUCKETS * sizeof(unsigned short)))
+
+static unsigned short FATPROC name_hash(const char *name, int len)
+{
+	unsigned short h = len;
+
+	while (--len >= 0)
+		h = (h << 5) - h + (unsigned char)*name++;
+	return h;
+}
+
+static void FATPROC dirhash_drop(struct dirhash *h)
+{
+	if (h->dev) {
+		seg_free(h->seg);
+		h->dev = 0;
+	}
+}
+
+/* build the index for dir, returns NULL if not indexed */
+static struct dirhash * FATPROC dirhash_build(struct inode *dir)
+{
+	struct dirhash *h, *victim;
+	struct buffer_head *bh = NULL;
+	segment_s *seg;
+	unsigned short __far *heads;
+	struct dirhash_ent __far *ents;
+	unsigned int n, max, gen;
+	int full = 0;
+	unsigned short hash;
+	off_t pos, start, dirpos;
+	ino_t ino;
+	int len;
+	ASYNCIO_REENTRANT char name[14];
+
+	max = dir->i_size >> MSDOS_DIR_BITS;
+	if (max < DIRHASH_MIN || max > DIRHASH_MAX)
+		return NULL;
+	seg = seg_alloc((DIRHASH_BUCKETS * sizeof(unsigned short) +
+		max * sizeof(struct dirhash_ent) + 15) >> 4, SEG_FLAG_EXTBUF|SEG_FLAG_HIGH);
+	if (!seg)
+		return NULL;
+	heads = _MK_FP(seg->base, 0);
+	ents = _MK_FP(seg->base, DIRHASH_BUCKETS * sizeof(unsigned short));
+	fmemsetw(0, seg->base, 0, DIRHASH_BUCKETS);
+
+	gen = dirhash_gen;
+	pos = 0;
+	for (n = 0; ; n++) {
+		start = pos;
+		if (msdos_get_entry_long(dir, &pos, &bh, name, &len, &dirpos, &ino) <= 0)
+			break;
+		if (n >= max) {                 /* more names than the size allows */
+			full = 1;
+			break;
+		}
+		hash = name_hash(name, len);
+		ents[n].hash = hash;
+		ents[n].pos = (unsigned short)(start >> MSDOS_DIR_BITS);
+		ents[n].next = heads[hash & (DIRHASH_BUCKETS - 1)];
+		heads[hash & (DIRHASH_BUCKETS - 1)] = n + 1;
+	}
+	if (bh)
+		unmap_brelse(bh);
+	if (full || gen != dirhash_gen) {   /* directory changed while scanning */
+		seg_free(seg);
+		return NULL;
+	}
+
+	victim = dirhash;
+	for (h = dirhash; h < &dirhash[NR_DIRHASH]; h++) {
+		if (h->dev == dir->i_dev && h->dir == dir->i_ino) {
+			seg_free(seg);          /* indexed by another task meanwhile */
+			return h;
+		}
+	}
+	for (h = dirhash; h < &dirhash[NR_DIRHASH]; h++) {
+		if (!h->dev) {
+			victim = h;
+			break;
+		}
+		if ((int)(h->lru - victim->lru) < 0)
+			victim = h;
+	}
+	dirhash_drop(victim);
+	victim->dev = dir->i_dev;
+	victim->dir = dir->i_ino;
+	victim->seg = seg;
+	debug_fat("dirhash: indexed dir %ld, %u entries\n", (unsigned long)dir->i_ino, n);
+	return victim;
+}
+
+/*
+ * Look up the name, already in kernel space, in dir through its index.
+ * Returns 0 with the entry's buffer in *bh and inode in *ino if found,
+ * -ENOENT if not, or 1 if the directory isn't indexed.
+ */
+int FATPROC msdos_dirhash_find(struct inode *dir, const char *name, int len,
+	struct buffer_head **bh, ino_t *ino)
+{
+	struct dirhash *h;
+	struct dirhash_ent __far *ents;
+	unsigned short hash, n;
+	off_t pos, dirpos;
+	int entry_len;
+	ASYNCIO_REENTRANT char entry_name[14];
+
+	for (h = dirhash; h < &dirhash[NR_DIRHASH]; h++) {
+		if (h->dev == dir->i_dev && h->dir == dir->i_ino)
+			break;
+	}
+	if (h >= &dirhash[NR_DIRHASH] && !(h = dirhash_build(dir)))
+		return 1;
+	h->lru = ++dirhash_stamp;
+
+	hash = name_hash(name, len);
+	ents = ENTS(h);
+	*bh = NULL;
+	for (n = HEADS(h)[hash & (DIRHASH_BUCKETS - 1)]; n; n = ents[n - 1].next) {
+		if (ents[n - 1].hash != hash)
+			continue;
+		pos = (off_t)ents[n - 1].pos << MSDOS_DIR_BITS;
+		if (msdos_get_entry_long(dir, &pos, bh, entry_name, &entry_len, &dirpos, ino) > 0
+			&& entry_len == len && !memcmp(entry_name, name, len))
+			return 0;
+	}
+	if (*bh)
+		unmap_brelse(*bh);
+	*bh = NULL;
+	return -ENOENT;
+}
+
+/* Drop the index of dir, called whenever an entry is added or removed */
+void FATPROC msdos_dirhash_inval(struct inode *dir)
+{
+	struct dirhash *h;
+
+	dirhash_gen++;
+	for (h = dirhash; h < &dirhash[NR_DIRHASH]; h++) {
+		if (h->dev == dir->i_dev && h->dir == dir->i_ino)
+			dirhash_drop(h);
+	}
+}
+
+/* Drop all indexes on device */
+void FATPROC msdos_dirhash_inval_dev(kdev_t dev)
+{
+	struct dirhash *h;
+
+	dirhash_gen++;
+	for (h = dirhash; h < &dirhash[NR_DIRHASH]; h++) {
+		if (h->dev == dev)
+			dirhash_drop(h);
+	}
+}
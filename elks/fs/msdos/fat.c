@@ -11,8 +11,6 @@
 #include <linuxmt/mm.h>
 #include <linuxmt/debug.h>
 
-static struct fat_cache *fat_cache,cache[FAT_CACHE];
-
 /* Returns the this'th FAT entry, -1 if it is an end-of-file entry.
    If new_value is != -1, that FAT entry is replaced by it. */
 
@@ -23,9 +21,6 @@ cluster_t FATPROC fat_access(struct super_block *sb,cluster_t this,cluster_t new
 	void *data,*data2;
 	cluster_t first,last,next;
 	int fatsz = MSDOS_SB(sb)->fat_bits;
-	//long copy;
-	//void *c_data, *c_data2;
-	//struct buffer_head *c_bh, *c_bh2;
 
 #ifndef FAT_BITS_32
 	if (fatsz == 32)
@@ -99,72 +94,122 @@ cluster_t FATPROC fat_access(struct super_block *sb,cluster_t this,cluster_t new
 #endif
 		debug_fat("fat_access block bh dirty %lu\n", buffer_blocknr(bh));
 		mark_buffer_dirty(bh);
-#if UNUSED  /* FIXME update 2nd FAT table? */
-		/* update extra FAT table copies*/
-		//FIXME does not look like multiple fat table update is working
-		// should use copy=2 and <= #fats below
-		// temp removed because of useless slow memcpy below w/each file write
-		// needs rewrite for speed using operations above then mark dirty
-		// or perhaps just make a complete FAT table copy on unmount!
-		for (copy = 1; copy < MSDOS_SB(sb)->fats; copy++) {
+		/* extra FAT copies are brought up to date by msdos_write_super */
+		if (MSDOS_SB(sb)->fats > 1) {
+			struct msdos_sb_info *msb = MSDOS_SB(sb);
+			unsigned short sect = (unsigned short)(first >> SECTOR_BITS_SB(sb));
+
+			if (sect < msb->fat_dirty_lo)
+				msb->fat_dirty_lo = sect;
+			sect = (unsigned short)(last >> SECTOR_BITS_SB(sb));
+			if (sect > msb->fat_dirty_hi)
+				msb->fat_dirty_hi = sect;
+			sb->s_dirt = 1;
+		}
+	}
+	unmap_brelse(bh);
+	if (data != data2) unmap_brelse(bh2);
+	return next;
+}
+
+
+/* Copy the FAT sectors changed since the last call to the other FAT copies */
+void FATPROC fat_sync_mirrors(struct super_block *sb)
+{
+	struct msdos_sb_info *msb = MSDOS_SB(sb);
+	struct buffer_head *bh, *c_bh;
+	void *data, *c_data;
+	unsigned short sect, hi;
+	int copy;
+
+	/* take the range first, changes made while copying are kept for next time */
+	sect = msb->fat_dirty_lo;
+	hi = msb->fat_dirty_hi;
+	msb->fat_dirty_lo = 0xffff;
+	msb->fat_dirty_hi = 0;
+	for (; sect <= hi; sect++) {
+		if (!(bh = msdos_sread(sb, (sector_t)(msb->fat_start + sect), &data))) {
+			printk("FAT: bread fat failed\n");
+			continue;
+		}
+		for (copy = 1; copy < msb->fats; copy++) {
 			if (!(c_bh = msdos_sread(sb,
-				(sector_t)(MSDOS_SB(sb)->fat_start+(first >> SECTOR_BITS_SB(sb)) +
-				MSDOS_SB(sb)->fat_length*copy), &c_data)))
+				(sector_t)(msb->fat_start + msb->fat_length*copy + sect), &c_data)))
 				break;
-			memcpy(c_data,data,SECTOR_SIZE_SB(sb));
-		debug_fat("fat_access block cbh write %lu\n", buffer_blocknr(bh));
+			memcpy(c_data, data, SECTOR_SIZE_SB(sb));
+			debug_fat("fat_sync_mirrors block write %lu\n", buffer_blocknr(c_bh));
 			mark_buffer_dirty(c_bh);
-			if (data != data2 || bh != bh2) {
-				if (!(c_bh2 = msdos_sread(sb,
-					(sector_t)(MSDOS_SB(sb)->fat_start+(first >> SECTOR_BITS_SB(sb)) +
-					MSDOS_SB(sb)->fat_length*copy + 1), &c_data2))) {
-					unmap_brelse(c_bh);
-					break;
-				}
-				memcpy(c_data2,data2,SECTOR_SIZE_SB(sb));
-				mark_buffer_dirty(c_bh2);	//FIXME looks like bug without this
-		debug_fat("fat_access block cbh2 write %lu\n", buffer_blocknr(c_bh2));
-				unmap_brelse(c_bh2);
-			}
 			unmap_brelse(c_bh);
 		}
-#endif /* extra copy FAT table update*/
+		unmap_brelse(bh);
 	}
-	unmap_brelse(bh);
-	if (data != data2) unmap_brelse(bh2);
-	return next;
 }
 
 
+/*
+ * The FAT cache holds extents of clusters that are contiguous on disk,
+ * hashed by (device, inode) so a lookup only visits extents of that file.
+ * get_cluster records the runs it finds while walking the FAT chain, so
+ * seeking within a mostly contiguous file doesn't need to walk the FAT.
+ */
+static struct fat_cache cache[FAT_CACHE];
+static struct fat_cache *fat_hash[FAT_CACHE_HASH];
+static unsigned int cache_stamp;
+
+#define fathash(dev,ino) (((unsigned int)(ino) ^ (dev)) & (FAT_CACHE_HASH-1))
+
 void FATPROC cache_init(void)
 {
 	static int initialized = 0;
 	int count;
 
 	if (initialized) return;
-	fat_cache = &cache[0];
-	for (count = 0; count < FAT_CACHE; count++) {
+	for (count = 0; count < FAT_CACHE; count++)
 		cache[count].device = 0;
-		cache[count].next = count == (FAT_CACHE - 1)? NULL : &cache[count+1];
-	}
+	for (count = 0; count < FAT_CACHE_HASH; count++)
+		fat_hash[count] = NULL;
 	initialized = 1;
 }
 
 
+static void FATPROC cache_unhash(register struct fat_cache *entry)
+{
+	struct fat_cache **p;
+
+	for (p = &fat_hash[fathash(entry->device, entry->ino)]; *p; p = &(*p)->next)
+		if (*p == entry) {
+			*p = entry->next;
+			break;
+		}
+	entry->device = 0;
+}
+
+
+/* Find the closest mapping at or before cluster, *f_clu is the best so far */
 void FATPROC cache_lookup(struct inode *inode,cluster_t cluster,
 	cluster_t *f_clu, cluster_t *d_clu)
 {
 	register struct fat_cache *walk;
+	cluster_t last;
 
 	debug("cache lookup: %d\r\n",*f_clu);
 
-	for (walk = fat_cache; walk; walk = walk->next)
+	for (walk = fat_hash[fathash(inode->i_dev, inode->i_ino)]; walk; walk = walk->next)
 		if (inode->i_dev == walk->device && walk->ino == inode->i_ino
-			&& walk->file_cluster <= cluster && walk->file_cluster > *f_clu) {
-			*d_clu = walk->disk_cluster;
-			debug("cache hit: %ld (%ld)\r\n",walk->file_cluster,*d_clu);
-
-			if ((*f_clu = walk->file_cluster) == cluster) return;
+			&& walk->file_cluster <= cluster) {
+			last = walk->file_cluster + walk->length - 1;
+			if (cluster <= last) {
+				*f_clu = cluster;
+				*d_clu = walk->disk_cluster + (cluster - walk->file_cluster);
+				walk->lru = ++cache_stamp;
+				debug("cache hit: %ld (%ld)\r\n",cluster,*d_clu);
+				return;
+			}
+			if (last > *f_clu) {
+				*f_clu = last;
+				*d_clu = walk->disk_cluster + walk->length - 1;
+				walk->lru = ++cache_stamp;
+			}
 		}
 }
 
@@ -174,9 +219,9 @@ static void FATPROC list_cache(void)
 {
 	struct fat_cache *walk;
 
-	for (walk = fat_cache; walk; walk = walk->next) {
-		if (walk->device) dprintk("(%d,%d) ",walk->file_cluster,
-			walk->disk_cluster);
+	for (walk = cache; walk < &cache[FAT_CACHE]; walk++) {
+		if (walk->device) dprintk("(%ld,%ld+%ld) ",walk->file_cluster,
+			walk->disk_cluster,walk->length);
 		else dprintk("-- ");
 	}
 	dprintk("\r\n");
@@ -184,53 +229,72 @@ static void FATPROC list_cache(void)
 #endif
 
 
-void FATPROC cache_add(struct inode *inode, cluster_t f_clu, cluster_t d_clu)
+/* Add a run of len clusters at f_clu/d_clu, extending an existing extent if possible */
+void FATPROC cache_add(struct inode *inode, cluster_t f_clu, cluster_t d_clu,
+	cluster_t len)
 {
-	register struct fat_cache *walk,*last;
+	register struct fat_cache *walk;
+	struct fat_cache *victim;
+	int hash;
 
-	debug("cache add: %d (%d)\r\n",f_clu,d_clu);
+	debug("cache add: %d (%d) %d\r\n",f_clu,d_clu,len);
 
-	last = NULL;
-	for (walk = fat_cache; walk->next; walk = (last = walk)->next)
+	hash = fathash(inode->i_dev, inode->i_ino);
+	for (walk = fat_hash[hash]; walk; walk = walk->next)
 		if (inode->i_dev == walk->device && walk->ino == inode->i_ino
-			&& walk->file_cluster == f_clu) {
-			if (walk->disk_cluster != d_clu) {
+			&& walk->file_cluster <= f_clu
+			&& f_clu <= walk->file_cluster + walk->length) {
+			if (walk->disk_cluster + (f_clu - walk->file_cluster) != d_clu) {
+				if (f_clu == walk->file_cluster + walk->length)
+					continue;	/* not contiguous, needs its own extent */
 				printk("FAT: corrupt cache");
+				cache_unhash(walk);
 				return;
 			}
-			/* update LRU */
-			if (last == NULL) return;
-			last->next = walk->next;
-			walk->next = fat_cache;
-			fat_cache = walk;
+			if (f_clu + len > walk->file_cluster + walk->length)
+				walk->length = f_clu + len - walk->file_cluster;
+			walk->lru = ++cache_stamp;
 #if DEBUG
 			list_cache();
 #endif
 			return;
 		}
-	walk->device = inode->i_dev;
-	walk->ino = inode->i_ino;
-	walk->file_cluster = f_clu;
-	walk->disk_cluster = d_clu;
-	last->next = NULL;
-	walk->next = fat_cache;
-	fat_cache = walk;
+
+	/* replace an unused or the least recently used extent */
+	victim = cache;
+	for (walk = cache; walk < &cache[FAT_CACHE]; walk++) {
+		if (!walk->device) {
+			victim = walk;
+			break;
+		}
+		if ((int)(walk->lru - victim->lru) < 0)
+			victim = walk;
+	}
+	if (victim->device)
+		cache_unhash(victim);
+	victim->device = inode->i_dev;
+	victim->ino = inode->i_ino;
+	victim->file_cluster = f_clu;
+	victim->disk_cluster = d_clu;
+	victim->length = len;
+	victim->lru = ++cache_stamp;
+	victim->next = fat_hash[hash];
+	fat_hash[hash] = victim;
 #if DEBUG
 	list_cache();
 #endif
 }
 
 
-/* Cache invalidation occurs rarely, thus the LRU chain is not updated. It
-   fixes itself after a while. */
-
 void FATPROC cache_inval_inode(struct inode *inode)
 {
-	register struct fat_cache *walk;
+	register struct fat_cache *walk, *next;
 
-	for (walk = fat_cache; walk; walk = walk->next)
+	for (walk = fat_hash[fathash(inode->i_dev, inode->i_ino)]; walk; walk = next) {
+		next = walk->next;
 		if (walk->device == inode->i_dev && walk->ino == inode->i_ino)
-			walk->device = 0;
+			cache_unhash(walk);
+	}
 }
 
 
@@ -238,23 +302,39 @@ void FATPROC cache_inval_dev(kdev_t device)
 {
 	register struct fat_cache *walk;
 
-	for (walk = fat_cache; walk; walk = walk->next)
-		if (walk->device == device) walk->device = 0;
+	for (walk = cache; walk < &cache[FAT_CACHE]; walk++)
+		if (walk->device == device) cache_unhash(walk);
 }
 
 
+/*
+ * Map file cluster to disk cluster, starting from the nearest cached extent.
+ * Runs of disk-contiguous clusters are entered into the cache as they are walked;
+ * single-cluster fragments aren't, to avoid flushing useful extents.
+ */
 cluster_t FATPROC get_cluster(register struct inode *inode, cluster_t cluster)
 {
-	cluster_t this, count;
+	cluster_t this, next, count;
+	cluster_t run_f, run_d;
 
 	if (!(this = inode->u.msdos_i.i_start)) return 0;
 	if (!cluster) return this;
 	count = 0;
-	for (cache_lookup(inode,cluster,&count,&this); count < cluster; count++) {
-		if ((this = fat_access(inode->i_sb,this,-1L)) == -1) return 0;
-		if (!this) return 0;
+	cache_lookup(inode,cluster,&count,&this);
+	run_f = count;
+	run_d = this;
+	for (; count < cluster; count++) {
+		if ((next = fat_access(inode->i_sb,this,-1L)) == -1) return 0;
+		if (!next) return 0;
+		if (next != this + 1) {		/* end of contiguous run */
+			if (count > run_f)
+				cache_add(inode,run_f,run_d,count - run_f + 1);
+			run_f = count + 1;
+			run_d = next;
+		}
+		this = next;
 	}
-	cache_add(inode,cluster,this);
+	cache_add(inode,run_f,run_d,cluster - run_f + 1);
 	return this;
 }
 
@@ -311,11 +391,14 @@ int FATPROC fat_free(register struct inode *inode, cluster_t skip)
 		inode->u.msdos_i.i_start = 0;
 		inode->i_dirt = 1;
 	}
-	while (this != -1)
+	while (this != -1) {
 		if (!(this = fat_access(inode->i_sb,this,0L))) {
 			printk("FAT: delete past EOF");
 			return -EIO;
 		}
+		if (MSDOS_SB(inode->i_sb)->free_clusters >= 0)
+			MSDOS_SB(inode->i_sb)->free_clusters++;
+	}
 	cache_inval_inode(inode);
 	return 0;
 }
@@ -58,6 +58,28 @@ struct inode_operations msdos_file_inode_operations_no_bmap = {
 };
 
 
+#ifdef CONFIG_FS_READAHEAD
+/*
+ * Read the rest of the cluster of file sector 'fsec', at disk 'sector', and
+ * the clusters following it while they are next on disk, all at once.
+ */
+static void msdos_readahead(struct inode *inode, sector_t fsec, sector_t sector)
+{
+	struct msdos_sb_info *sb = MSDOS_SB(inode->i_sb);
+	int bits = BLOCK_SIZE_BITS - SECTOR_BITS(inode);
+	sector_t last = (sector_t)((inode->i_size - 1) >> SECTOR_BITS(inode));
+	sector_t end = fsec - fsec % sb->cluster_size + sb->cluster_size;
+
+	while (end <= last && ((end - fsec) >> bits) < MAX_READAHEAD &&
+	       msdos_smap(inode, end) == sector + (end - fsec))
+		end += sb->cluster_size;
+	if (end > last)
+		end = last + 1;
+	block_readahead32(inode->i_sb->s_dev, sector >> bits,
+		(sector + (end - fsec - 1)) >> bits);
+}
+#endif
+
 static size_t msdos_file_read(register struct inode *inode,register struct file *filp,
 	char *buf,size_t count)
 {
@@ -81,12 +103,21 @@ static size_t msdos_file_read(register struct inode *inode,register struct file
 		if (!(sector = msdos_smap(inode,filp->f_pos >> SECTOR_BITS(inode))))
 			break;
 		offset = (int)filp->f_pos & (SECTOR_SIZE(inode)-1);
+#ifdef CONFIG_FS_READAHEAD
+		/* at each block of a sequential read, fetch any uncached clusters */
+		if (!((int)filp->f_pos & (BLOCK_SIZE-1) & ~(SECTOR_SIZE(inode)-1)) &&
+		    (block_t)(filp->f_pos >> BLOCK_SIZE_BITS) == filp->f_ranext)
+			msdos_readahead(inode, filp->f_pos >> SECTOR_BITS(inode), sector);
+#endif
 		if (!(bh = msdos_sread_nomap(inode->i_sb,sector, &secoff))) break;
 		filp->f_pos += (size = MIN(SECTOR_SIZE(inode)-offset,left));
 		xms_fmemcpyb(buf, current->t_regs.ds,
 			buffer_data(bh) + offset + secoff, buffer_seg(bh), size);
 		buf += size;
 		brelse(bh);
+#ifdef CONFIG_FS_READAHEAD
+		filp->f_ranext = (block_t)(filp->f_pos >> BLOCK_SIZE_BITS);
+#endif
 	}
 	if (start == buf) return -EIO;
 	return buf-start;
@@ -137,7 +168,7 @@ static size_t msdos_file_write(register struct inode *inode,register struct file
 			inode->i_dirt = 1;
 		}
 		debug_fat("file block write %lu\n", buffer_blocknr(bh));
-		mark_buffer_dirty(bh);
+		mark_buffer_dirty_inode(bh, inode);
 		brelse(bh);
 	}
 	inode->i_mtime = current_time();
@@ -83,12 +83,20 @@ static void msdos_put_super(register struct super_block *sb)
 {
 	debug_fat("put_super\n");
 	cache_inval_dev(sb->s_dev);
+	msdos_dirhash_inval_dev(sb->s_dev);
 	lock_super(sb);
 	sb->s_dev = 0;
 	unlock_super(sb);
 	return;
 }
 
+static void msdos_write_super(register struct super_block *sb)
+{
+	debug_fat("write_super\n");
+	sb->s_dirt = 0;
+	fat_sync_mirrors(sb);
+}
+
 static void print_formatted(unsigned long n)
 {
 	char kbytes_or_mbytes = 'k';
@@ -165,6 +173,9 @@ static struct super_block *msdos_read_super(struct super_block *s, char *data,
 	sb->clusters = sb->cluster_size?  data_sectors / sb->cluster_size : 0;
 	sb->fat_bits = fat32 ? 32 : sb->clusters > MSDOS_FAT12_MAX_CLUSTERS ? 16 : 12;
 	sb->previous_cluster = 0;
+	sb->free_clusters = -1;
+	sb->fat_dirty_lo = 0xffff;
+	sb->fat_dirty_hi = 0;
 	unmap_brelse(bh);
 
 printk("FAT: me=%x,csz=%d,#f=%d,floc=%d,fsz=%d,rloc=%d,#d=%d,dloc=%d,#s=%ld,ts=%ld\n",
@@ -254,11 +265,16 @@ static void msdos_statfs(struct super_block *s,struct statfs *sf, int flags)
 	total  = (MSDOS_SB(s)->clusters * cluster_size) + MSDOS_SB(s)->data_start;
 	sf->f_blocks = total >> (BLOCK_SIZE_BITS - SECTOR_BITS_SB(s));
 	if (!(flags & UF_NOFREESPACE)) {
-		free = 0;
-		for (cluster = 2; cluster < MSDOS_SB(s)->clusters + 2; cluster++)
-			if (!fat_access(s, cluster, -1))
-				free += cluster_size;
-		free >>= (BLOCK_SIZE_BITS - SECTOR_BITS_SB(s));
+		/* count once, then kept up to date by add_cluster and fat_free */
+		if (MSDOS_SB(s)->free_clusters < 0) {
+			free = 0;
+			for (cluster = 2; cluster < MSDOS_SB(s)->clusters + 2; cluster++)
+				if (!fat_access(s, cluster, -1))
+					free++;
+			MSDOS_SB(s)->free_clusters = free;
+		}
+		free = (MSDOS_SB(s)->free_clusters * cluster_size) >>
+			(BLOCK_SIZE_BITS - SECTOR_BITS_SB(s));
 	} else free = -1L;
 	sf->f_bfree = free;
 	sf->f_bavail = free;
@@ -339,7 +355,7 @@ void msdos_read_inode(register struct inode *inode)
 	if (raw_entry->attr & ATTR_DIR) {
 		inode->i_mode = MSDOS_MKMODE(raw_entry->attr,0777 & ~current->fs.umask) | S_IFDIR;
 		inode->i_op = &msdos_dir_inode_operations;
-		inode->i_nlink = 3;
+		inode->i_nlink = 1;	/* subdirectories not counted, as for the root */
 		inode->i_size = 0;
 		/* read FAT chain to set directory size */
 		for (this = inode->u.msdos_i.i_start; this && this != -1; this = fat_access(inode->i_sb,this,-1L))
@@ -398,7 +414,7 @@ static struct super_operations msdos_sops = {
 	msdos_write_inode,
 	msdos_put_inode,
 	msdos_put_super,
-	NULL,		/* write_super*/
+	msdos_write_super,
 	NULL,		/* remount*/
 	msdos_statfs
 };
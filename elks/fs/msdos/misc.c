@@ -76,48 +76,56 @@ int FATPROC msdos_add_cluster(register struct inode *inode)
 	if (fatsz != 32)
 		if (inode->i_ino == MSDOS_ROOT_INO) return -ENOSPC;
 #endif
+	if (!S_ISDIR(inode->i_mode)) {
+		last = inode->i_size?
+			get_cluster(inode,(inode->i_size-1) / SECTOR_SIZE(inode) / sb->cluster_size)
+			: 0;
+	} else {
+		last = 0;
+		if ((curr = inode->u.msdos_i.i_start) != 0) {
+			cache_lookup(inode,0x7fffffffL,&last,&curr);
+			while (curr && curr != -1)
+				if (!(curr = fat_access(inode->i_sb, last = curr,-1L))) {
+					printk("FAT: no EOF in file");
+					return -ENOSPC;
+				}
+			}
+	}
+	debug("last = %d\r\n",last);
+
 	while (lock) sleep_on(&wait);
 	lock = 1;
 	limit = sb->clusters;
-	for (count = 0; count < limit; count++) {
-		this = ((count+prev) % limit)+2;
-		if (fat_access(inode->i_sb,this,-1L) == 0) break;
+	/* keep the file contiguous if the cluster after its last one is free */
+	if (last && last + 1 < limit + 2 && fat_access(inode->i_sb,last+1,-1L) == 0) {
+		this = last + 1;
+		count = 0;
+	} else {
+		for (count = 0; count < limit; count++) {
+			this = ((count+prev) % limit)+2;
+			if (fat_access(inode->i_sb,this,-1L) == 0) break;
+		}
 	}
 	debug("free cluster: %d\r\n",this);
 
-	prev = (count+prev+1) % limit;
-	sb->previous_cluster = prev;
 	if (count >= limit) {
+		sb->free_clusters = 0;
 		lock = 0;
 		wake_up(&wait);
 		return -ENOSPC;
 	}
+	sb->previous_cluster = (this - 2 + 1) % limit;
 	fat_access(inode->i_sb,this,
 #ifndef FAT_BITS_32
 	    fatsz == 12? 0xff8UL : fatsz == 16? 0xfff8UL:
 #endif
 	    0xffffff8UL);
+	if (sb->free_clusters > 0)
+		sb->free_clusters--;
 	lock = 0;
 	wake_up(&wait);
 	debug("set to %x\r\n",fat_access(inode->i_sb,this,-1L));
 
-	if (!S_ISDIR(inode->i_mode)) {
-		last = inode->i_size?
-			get_cluster(inode,(inode->i_size-1) / SECTOR_SIZE(inode) / sb->cluster_size)
-			: 0;
-	} else {
-		last = 0;
-		if ((curr = inode->u.msdos_i.i_start) != 0) {
-			cache_lookup(inode,0x7fffffffL,&last,&curr);
-			while (curr && curr != -1)
-				if (!(curr = fat_access(inode->i_sb, last = curr,-1L))) {
-					printk("FAT: no EOF in file");
-					return -ENOSPC;
-				}
-			}
-	}
-	debug("last = %d\r\n",last);
-
 	if (last)
 		fat_access(inode->i_sb,last,this);
 	else {
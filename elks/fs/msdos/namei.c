@@ -101,6 +101,14 @@ static int FATPROC msdos_find_long(struct inode *dir, const char *name, int len,
 	for (i=0; i<len; i++)
 		msdos_name[i] = get_fs_byte(name++);
 
+#ifdef CONFIG_FS_DEV
+	if (dir->i_ino != MSDOS_SB(dir->i_sb)->dev_ino)
+#endif
+	{
+		if ((res = msdos_dirhash_find(dir, msdos_name, len, bh, ino)) <= 0)
+			return res;
+	}
+
 	*bh = NULL;
 	do {
 		res = msdos_get_entry_long(dir, &pos, bh, entry_name, &entry_len, &dirpos, ino);
@@ -184,6 +192,7 @@ static int FATPROC msdos_create_entry(struct inode *dir,const char *name,int is_
 		/* if can't find empty entry return error*/
 		if ((res = msdos_scan(dir,NULL,&bh,&de,&ino)) < 0) return res;
 	}
+	msdos_dirhash_inval(dir);
 	memcpy(de->name,name,MSDOS_NAME);
 	de->attr = is_dir ? ATTR_DIR : ATTR_ARCH;
 	de->start = 0;
@@ -322,6 +331,8 @@ int msdos_rmdir(register struct inode *dir,const char *name,int len)
 	dir->i_mtime = current_time();
 	inode->i_dirt = dir->i_dirt = 1;
 	de->name[0] = (unsigned char)DELETED_FLAG;
+	msdos_dirhash_inval(dir);
+	msdos_dirhash_inval(inode);
 	debug_fat("rmdir block write %lu\n", buffer_blocknr(bh));
 	mark_buffer_dirty(bh);
 	res = 0;
@@ -362,6 +373,7 @@ int msdos_unlink(register struct inode *dir,const char *name,int len)
 	inode->i_dirt = 1;
 	de->name[0] = (unsigned char)DELETED_FLAG;
 	dir->i_dirt = 1;
+	msdos_dirhash_inval(dir);
 	debug_fat("unlink block write %lu\n", buffer_blocknr(bh));
 	mark_buffer_dirty(bh);
 unlink_done:
@@ -71,42 +71,121 @@ int pipe_lseek(struct inode *inode, struct file *file, loff_t offset,
 
 #ifdef CONFIG_PIPE
 
-/* pipes are allocated from kernel local heap */
-static unsigned char *get_pipe_mem(void)
+/*
+ * Pipe buffers are allocated from the kernel local heap, except for
+ * those enlarged past PIPE_MAX_NEAR with F_SETPIPE_SZ, which are
+ * allocated from main memory. All copies use fmemcpyb so either works.
+ */
+static int get_pipe_mem(struct inode *inode, size_t size)
+{
+    segment_s *seg = NULL;
+    unsigned char *base = NULL;
+
+    if (size > PIPE_MAX_NEAR) {
+        if (!(seg = seg_alloc((segext_t)((size + 15) >> 4), SEG_FLAG_PIPE)))
+            return -ENOMEM;
+        size = seg->size << 4;
+    } else if (!(base = heap_alloc(size, HEAP_TAG_PIPE)))
+        return -ENOMEM;
+    PIPE_SEGMENT(inode) = seg;
+    PIPE_BASE(inode) = base;
+    PIPE_SIZE(inode) = size;
+    return 0;
+}
+
+static void free_pipe_mem(struct inode *inode)
 {
-    return heap_alloc(PIPE_BUFSIZ, HEAP_TAG_PIPE);
+    if (PIPE_SEGMENT(inode))
+        seg_put(PIPE_SEGMENT(inode));
+    else heap_free(PIPE_BASE(inode));
+    PIPE_SEGMENT(inode) = NULL;
+    PIPE_BASE(inode) = NULL;
+}
+
+/* Resize pipe buffer, preserving any data in it */
+static int pipe_resize(register struct inode *inode, size_t size)
+{
+    struct pipe_inode_info old = inode->u.pipe_i;
+    size_t chars;
+    int error;
+
+    if (size > PIPE_MAX_BUFSIZ) return -EINVAL;
+    if (size < PIPE_BUFSIZ) size = PIPE_BUFSIZ;
+    if (size < PIPE_LEN(inode)) return -EBUSY;
+    if (PIPE_LOCK(inode)) return -EAGAIN;
+    if ((error = get_pipe_mem(inode, size)) < 0)
+        return error;
+
+    /* copy old contents to start of new buffer */
+    chars = old.q.size - old.q.tail;
+    if (chars > old.q.len) chars = old.q.len;
+    fmemcpyb(PIPE_BASE(inode), PIPE_SEG(inode), old.q.base + old.q.tail,
+        old.seg? old.seg->base: kernel_ds, chars);
+    if (chars < old.q.len)
+        fmemcpyb(PIPE_BASE(inode) + chars, PIPE_SEG(inode), old.q.base,
+            old.seg? old.seg->base: kernel_ds, old.q.len - chars);
+    PIPE_TAIL(inode) = 0;
+    PIPE_HEAD(inode) = old.q.len;
+    if (old.seg)
+        seg_put(old.seg);
+    else heap_free(old.q.base);
+    wake_up_interruptible(&PIPE_WAIT(inode));     /* may have more free space */
+    return PIPE_SIZE(inode);
 }
 
-static void free_pipe_mem(unsigned char *buf)
+int pipe_fcntl(struct inode *inode, unsigned int cmd, unsigned int arg)
 {
-    heap_free(buf);
+    if (!S_ISFIFO(inode->i_mode) || !PIPE_ALLOCATED(inode))
+        return -EBADF;
+    if (cmd == F_SETPIPE_SZ)
+        return pipe_resize(inode, arg);
+    return PIPE_SIZE(inode);
 }
 
 static size_t pipe_read(register struct inode *inode, struct file *filp,
                      char *buf, size_t count)
 {
     size_t chars;
+    struct pipe_post post;
 
     debug("PIPE: read called.\n");
     while (PIPE_EMPTY(inode) || PIPE_LOCK(inode)) {
         if (!PIPE_LOCK(inode) && !PIPE_WRITERS(inode)) return 0;
         if (filp->f_flags & O_NONBLOCK) return -EAGAIN;
         if (current->signal) return -ERESTARTSYS;       // FIXME
+        if (PIPE_EMPTY(inode) && !PIPE_POST(inode) && count) {
+            /* post our buffer so a writer can copy directly into it */
+            post.buf = buf;
+            post.task = current;
+            post.count = count;
+            post.done = 0;
+            PIPE_POST(inode) = &post;
+            interruptible_sleep_on(&PIPE_WAIT(inode));
+            if (PIPE_POST(inode) == &post)
+                PIPE_POST(inode) = NULL;
+            if (post.done) {
+                update_atime(inode);
+                return post.done;
+            }
+            continue;
+        }
         interruptible_sleep_on(&PIPE_WAIT(inode));
     }
     PIPE_LOCK(inode)++;
     if (count > PIPE_LEN(inode)) count = PIPE_LEN(inode);
     chars = PIPE_SIZE(inode) - PIPE_TAIL(inode);
     if (chars > count) chars = count;
-    memcpy_tofs(buf, PIPE_BASE(inode) + PIPE_TAIL(inode), chars);
+    fmemcpyb(buf, current->t_regs.ds, PIPE_BASE(inode) + PIPE_TAIL(inode),
+        PIPE_SEG(inode), chars);
     if (chars < count)
-        memcpy_tofs(buf + chars, PIPE_BASE(inode), count - chars);
+        fmemcpyb(buf + chars, current->t_regs.ds, PIPE_BASE(inode),
+            PIPE_SEG(inode), count - chars);
     if ((PIPE_TAIL(inode) += count) >= PIPE_SIZE(inode))
         PIPE_TAIL(inode) -= PIPE_SIZE(inode);
     PIPE_LEN(inode) -= count;
     PIPE_LOCK(inode)--;
     wake_up_interruptible(&PIPE_WAIT(inode));
-    if (count) inode->i_atime = current_time();
+    if (count) update_atime(inode);
     else if (PIPE_WRITERS(inode)) count = -EAGAIN;
     return count;
 }
@@ -115,6 +194,7 @@ static size_t pipe_write(register struct inode *inode, struct file *filp,
                       char *buf, size_t count)
 {
     size_t free, head, chars, written = 0;
+    struct pipe_post *post;
 
     debug("PIPE: write called.\n");
     if (!PIPE_READERS(inode)) goto snd_signal;
@@ -133,13 +213,28 @@ static size_t pipe_write(register struct inode *inode, struct file *filp,
             interruptible_sleep_on(&PIPE_WAIT(inode));
         }
         PIPE_LOCK(inode)++;
+        /* hand off directly to a reader waiting on an empty pipe */
+        if ((post = PIPE_POST(inode)) && PIPE_EMPTY(inode)
+#ifdef CONFIG_SEG_SWAP
+                && !(post->task->mm.seg_data->flags & SEG_FLAG_SWAPPED)
+#endif
+                ) {
+            chars = (count > post->count)? post->count: count;
+            fmemcpyb(post->buf, post->task->t_regs.ds, buf, current->t_regs.ds, chars);
+            post->done = chars;
+            PIPE_POST(inode) = NULL;
+            buf += chars;
+            written += chars;
+            count -= chars;
+        }
         while (count > 0 && (free = (PIPE_SIZE(inode) - PIPE_LEN(inode)))) {
             head = PIPE_HEAD(inode);
             chars = PIPE_SIZE(inode) - head;
             if (chars > count) chars = count;
             if (chars > free) chars = free;
 
-            memcpy_fromfs(PIPE_BASE(inode) + head, buf, chars);
+            fmemcpyb(PIPE_BASE(inode) + head, PIPE_SEG(inode), buf,
+                current->t_regs.ds, chars);
             buf += chars;
             if ((PIPE_HEAD(inode) += chars) >= PIPE_SIZE(inode))
                 PIPE_HEAD(inode) -= PIPE_SIZE(inode);
@@ -181,10 +276,9 @@ static void pipe_rdwr_release(register struct inode *inode,
     if (filp->f_mode & FMODE_WRITE) PIPE_WRITERS(inode)--;
 
     if (!(PIPE_READERS(inode) + PIPE_WRITERS(inode))) {
-        if (PIPE_BASE(inode)) {
+        if (PIPE_ALLOCATED(inode)) {
             /* Free up any memory allocated to the pipe */
-            free_pipe_mem(PIPE_BASE(inode));
-            PIPE_BASE(inode) = NULL;
+            free_pipe_mem(inode);
         }
     } else wake_up_interruptible(&PIPE_WAIT(inode));
 }
@@ -212,12 +306,12 @@ static int pipe_rdwr_open(register struct inode *inode,
 {
     debug("PIPE: rdwr called.\n");
 
-    if (!PIPE_BASE(inode)) {
-        if (!(PIPE_BASE(inode) = get_pipe_mem())) return -ENOMEM;
-        PIPE_SIZE(inode) = PIPE_BUFSIZ;
+    if (!PIPE_ALLOCATED(inode)) {
+        int error = get_pipe_mem(inode, PIPE_BUFSIZ);
+        if (error) return error;
 #if NOTNEEDED /* next fields already set to zero by get_empty_inode() */
         PIPE_HEAD(inode) = PIPE_TAIL(inode) = PIPE_LEN(inode) = 0;
-        PIPE_RD_OPENERS(inode) = PIPE_WR_OPENERS(inode) = 0;
+        PIPE_POST(inode) = NULL;
         PIPE_READERS(inode) = PIPE_WRITERS(inode) = 0;
 #endif
     }
@@ -12,6 +12,8 @@
 #include <linuxmt/fcntl.h>
 #include <linuxmt/mm.h>
 #include <linuxmt/fs.h>
+#include <linuxmt/uio.h>
+#include <linuxmt/socket.h>
 #include <arch/segment.h>
 #include <linuxmt/debug.h>
 
@@ -96,6 +98,41 @@ int sys_read(unsigned int fd, char *buf, size_t count)
     return retval;
 }
 
+/*
+ * If data has been written to the file, remove the setuid and
+ * the setgid bits. We do it anyway otherwise there is an
+ * extremely exploitable race - does your OS get it right |->
+ *
+ * Set ATTR_FORCE so it will always be changed.
+ */
+static void remove_suid(register struct inode *inode)
+{
+    if (!suser() && (inode->i_mode & (S_ISUID | S_ISGID))) {
+
+#ifdef USE_NOTIFY_CHANGE
+	struct iattr newattrs;
+	newattrs.ia_mode = inode->i_mode & ~(S_ISUID | S_ISGID);
+	newattrs.ia_valid = ATTR_CTIME | ATTR_MODE | ATTR_FORCE;
+	notify_change(inode, &newattrs);
+#else
+	inode->i_mode = inode->i_mode & ~(S_ISUID | S_ISGID);
+#endif
+
+    }
+}
+
+/* make a write to an O_SYNC file durable before returning it */
+static int write_sync(struct file *file, int written)
+{
+    int err;
+
+    if (written > 0 && (file->f_flags & O_SYNC) && S_ISREG(file->f_inode->i_mode)) {
+	if ((err = fsync_inode(file->f_inode)) < 0)
+	    return err;
+    }
+    return written;
+}
+
 int sys_write(unsigned int fd, char *buf, size_t count)
 {
     register struct file_operations *fop;
@@ -109,28 +146,251 @@ int sys_write(unsigned int fd, char *buf, size_t count)
 	if (fop->write) {
 	    inode = file->f_inode;
 
-	    /*
-	     * If data has been written to the file, remove the setuid and
-	     * the setgid bits. We do it anyway otherwise there is an
-	     * extremely exploitable race - does your OS get it right |->
-	     *
-	     * Set ATTR_FORCE so it will always be changed.
-	     */
-	    if (!suser() && (inode->i_mode & (S_ISUID | S_ISGID))) {
+	    remove_suid(inode);
+	    written = write_sync(file, (int) fop->write(inode, file, buf, count));
+	    schedule();         // FIXME removing these slows down localhost networking
+	}
+    }
+    return written;
+}
 
-#ifdef USE_NOTIFY_CHANGE
-		struct iattr newattrs;
-		newattrs.ia_mode = inode->i_mode & ~(S_ISUID | S_ISGID);
-		newattrs.ia_valid = ATTR_CTIME | ATTR_MODE | ATTR_FORCE;
-		notify_change(inode, &newattrs);
-#else
-		inode->i_mode = inode->i_mode & ~(S_ISUID | S_ISGID);
+/*
+ * Read or write at *p_offset without using or changing the file position.
+ * The transfer runs on a copy of the file with its position set, so other
+ * users of the same open file are not disturbed. Only regular files and
+ * block devices can be positioned.
+ */
+static int rw_at(unsigned int fd, char *buf, size_t count, loff_t *p_offset, int rw)
+{
+    register struct file_operations *fop;
+    struct file *file;
+    struct file tmp;
+    int ret;
+
+    if ((ret = fd_check(fd, buf, count, rw, &file)) < 0)
+	return ret;
+    if (!S_ISREG(file->f_inode->i_mode) && !S_ISBLK(file->f_inode->i_mode))
+	return -ESPIPE;
+    fop = file->f_op;
+    if (!(rw == FMODE_READ? fop->read: fop->write))
+	return -EINVAL;
+    if (!count)
+	return 0;
+
+    tmp = *file;
+    tmp.f_pos = (loff_t) get_user_long(p_offset);
+    tmp.f_flags &= ~O_APPEND;
+    if (tmp.f_pos < 0)
+	return -EINVAL;
+    if (rw == FMODE_READ)
+	ret = (int) fop->read(file->f_inode, &tmp, buf, count);
+    else {
+	remove_suid(file->f_inode);
+	ret = write_sync(file, (int) fop->write(file->f_inode, &tmp, buf, count));
+    }
+    return ret;
+}
+
+int sys_pread(unsigned int fd, char *buf, size_t count, loff_t *p_offset)
+{
+    return rw_at(fd, buf, count, p_offset, FMODE_READ);
+}
+
+int sys_pwrite(unsigned int fd, char *buf, size_t count, loff_t *p_offset)
+{
+    return rw_at(fd, buf, count, p_offset, FMODE_WRITE);
+}
+
+/*
+ * Copy a user iovec array into kiov and check each entry, returning the
+ * total length or an error. rw is the verify_area type for the buffers.
+ */
+static int get_iovec(struct iovec *iov, int iovcnt, struct iovec *kiov, int rw)
+{
+    int i, total = 0;
+
+    if (iovcnt <= 0 || iovcnt > UIO_MAXIOV)
+	return -EINVAL;
+    if (verify_area(VERIFY_READ, iov, iovcnt * sizeof(struct iovec)))
+	return -EFAULT;
+    memcpy_fromfs(kiov, iov, iovcnt * sizeof(struct iovec));
+    for (i = 0; i < iovcnt; i++) {
+	if (kiov[i].iov_len < 0 || total + kiov[i].iov_len < total)
+	    return -EINVAL;
+	if (kiov[i].iov_len && verify_area(rw, kiov[i].iov_base, kiov[i].iov_len))
+	    return -EFAULT;
+	total += kiov[i].iov_len;
+    }
+    return total;
+}
+
+/*
+ * Read into each iov entry in turn, all within the one system call.
+ * Stops early at a short read, and returns the number of bytes read or
+ * the error of the first read.
+ */
+int sys_readv(unsigned int fd, struct iovec *iov, int iovcnt)
+{
+    register struct file_operations *fop;
+    struct file *file;
+    struct iovec kiov[UIO_MAXIOV];
+    int i, ret, total = 0;
+
+    if ((ret = fd_check(fd, NULL, 0, FMODE_READ, &file)) < 0)
+	return ret;
+    fop = file->f_op;
+    if (!fop->read)
+	return -EINVAL;
+    if ((ret = get_iovec(iov, iovcnt, kiov, VERIFY_WRITE)) <= 0)
+	return ret;
+
+    for (i = 0; i < iovcnt; i++) {
+	if (!kiov[i].iov_len)
+	    continue;
+	ret = (int) fop->read(file->f_inode, file, kiov[i].iov_base, kiov[i].iov_len);
+	if (ret <= 0)
+	    break;
+	total += ret;
+	if (ret < kiov[i].iov_len)
+	    break;
+    }
+    schedule();
+    return write_sync(file, total? total: ret);
+}
+
+/*
+ * Write each iov entry in turn, all within the one system call. A socket
+ * whose protocol can gather gets the whole iovec in one send, so ktcp
+ * receives a header and body as one TDC_WRITE.
+ */
+int sys_writev(unsigned int fd, struct iovec *iov, int iovcnt)
+{
+    register struct file_operations *fop;
+    register struct inode *inode;
+    struct file *file;
+    struct iovec kiov[UIO_MAXIOV];
+    int i, ret, total = 0;
+
+    if ((ret = fd_check(fd, NULL, 0, FMODE_WRITE, &file)) < 0)
+	return ret;
+    fop = file->f_op;
+    if (!fop->write)
+	return -EINVAL;
+    if ((ret = get_iovec(iov, iovcnt, kiov, VERIFY_READ)) <= 0)
+	return ret;
+
+    inode = file->f_inode;
+#ifdef CONFIG_SOCKET
+    if (S_ISSOCK(inode->i_mode)) {
+	ret = sock_writev(inode, file, kiov, iovcnt);
+	if (ret != -ENOSYS) {
+	    schedule();
+	    return ret;
+	}
+    }
 #endif
+    remove_suid(inode);
+    for (i = 0; i < iovcnt; i++) {
+	if (!kiov[i].iov_len)
+	    continue;
+	ret = (int) fop->write(inode, file, kiov[i].iov_base, kiov[i].iov_len);
+	if (ret <= 0)
+	    break;
+	total += ret;
+	if (ret < kiov[i].iov_len)
+	    break;
+    }
+    schedule();
+    return total? total: ret;
+}
+
+/*
+ * Copy count bytes from in_fd to out_fd without passing through user
+ * space. Each block is read into the buffer cache, mapped into L1 and
+ * handed to the output write routine as kernel data, so a socket gets
+ * the file data copied once, straight into the tcpdev payload.
+ *
+ * in_fd must be a regular file on a filesystem with block mapping. When
+ * offset is non-NULL the file is read from *offset, which is updated,
+ * and the file position is unchanged; otherwise the file position is
+ * used and advanced. Returns the number of bytes written, which is less
+ * than count at EOF or if the output accepts only part of a block.
+ */
+int sys_sendfile(unsigned int out_fd, unsigned int in_fd, loff_t *offset, size_t count)
+{
+    register struct file *in;
+    register struct inode *inode;
+    struct file *out;
+    struct buffer_head *bh;
+    loff_t pos;
+    seg_t old_ds;
+    size_t chars, off;
+    int ret = 0, sent = 0;
+    static char zeroes[32];
+
+    if (in_fd >= NR_OPEN || !(in = current->files.fd[in_fd])
+	|| !(inode = in->f_inode) || !(in->f_mode & FMODE_READ))
+	return -EBADF;
+    if (out_fd >= NR_OPEN || !(out = current->files.fd[out_fd])
+	|| !(out->f_inode) || !(out->f_mode & FMODE_WRITE))
+	return -EBADF;
+    if (!S_ISREG(inode->i_mode) || !inode->i_op || !inode->i_op->getblk
+	|| !out->f_op || !out->f_op->write)
+	return -EINVAL;
+
+    pos = offset? (loff_t) get_user_long(offset): in->f_pos;
+    if (pos < 0)
+	return -EINVAL;
+    if ((loff_t)count > (loff_t)inode->i_size - pos)
+	count = (pos < (loff_t)inode->i_size)? (size_t)(inode->i_size - pos): 0;
+    if (count > (size_t)INT_MAX)
+	count = INT_MAX;
+
+    old_ds = current->t_regs.ds;
+    while (count > 0) {
+	off = ((size_t)pos) & (BLOCK_SIZE - 1);
+	chars = BLOCK_SIZE - off;
+	if (chars > count) chars = count;
 
+	bh = inode->i_op->getblk(inode, (block_t)(pos >> BLOCK_SIZE_BITS), 0);
+	if (bh) {
+#ifdef CONFIG_FS_READAHEAD
+	    if (!EBH(bh)->b_uptodate &&
+		    (block_t)(pos >> BLOCK_SIZE_BITS) == in->f_ranext)
+		block_readahead(inode, in->f_ranext,
+		    (block_t)((inode->i_size - 1) >> BLOCK_SIZE_BITS));
+#endif
+	    if (!readbuf(bh)) {
+		ret = -EIO;
+		break;
 	    }
-	    written = (int) fop->write(inode, file, buf, count);
-	    schedule();         // FIXME removing these slows down localhost networking
+	    map_buffer(bh);
+	    current->t_regs.ds = kernel_ds;
+	    ret = out->f_op->write(out->f_inode, out, bh->b_data + off, chars);
+	    current->t_regs.ds = old_ds;
+	    unmap_brelse(bh);
+	} else {
+	    /* hole in the file */
+	    if (chars > sizeof(zeroes)) chars = sizeof(zeroes);
+	    current->t_regs.ds = kernel_ds;
+	    ret = out->f_op->write(out->f_inode, out, zeroes, chars);
+	    current->t_regs.ds = old_ds;
 	}
+	if (ret <= 0)
+	    break;
+	pos += ret;
+	sent += ret;
+	count -= ret;
+#ifdef CONFIG_FS_READAHEAD
+	in->f_ranext = (block_t)(pos >> BLOCK_SIZE_BITS);
+#endif
+	if (ret < chars)
+	    break;
     }
-    return written;
+
+    if (offset)
+	put_user_long((unsigned long)pos, (void *)offset);
+    else
+	in->f_pos = pos;
+    return sent? sent: ret;
 }
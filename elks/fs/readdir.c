@@ -17,9 +17,22 @@
 
 #include <arch/segment.h>
 
+static void put_dirent(struct dirent *dirent, char *name, size_t namlen, off_t offset,
+	ino_t ino)
+{
+    put_user_long(ino, &dirent->d_ino);
+    put_user_long(offset, &dirent->d_offset);
+    if (namlen > MAXNAMLEN) namlen = MAXNAMLEN;
+    put_user(namlen, &dirent->d_namlen);
+    memcpy_tofs(dirent->d_name, name, namlen);
+    put_user_char('\0', dirent->d_name + namlen);
+}
+
 /*
  * Traditional linux readdir() handling..
  *
+ * The filesystem readdir calls filldir for each entry from f_pos on until
+ * filldir returns an error, leaving f_pos at the rejected entry.
  */
 struct readdir_callback {
     struct dirent *dirent;
@@ -28,17 +41,9 @@ struct readdir_callback {
 
 static int fillonedir(char *__buf, char *name, size_t namlen, off_t offset, ino_t ino)
 {
-    struct dirent *dirent;
-
     if (((struct readdir_callback *)__buf)->count) return -EINVAL;
     ((struct readdir_callback *)__buf)->count = 1;
-    dirent = ((struct readdir_callback *)__buf)->dirent;
-    put_user_long(ino, &dirent->d_ino);
-    put_user_long(offset, &dirent->d_offset);
-    if (namlen > MAXNAMLEN) namlen = MAXNAMLEN;
-    put_user(namlen, &dirent->d_namlen);
-    memcpy_tofs(dirent->d_name, name, namlen);
-    put_user_char('\0', dirent->d_name + namlen);
+    put_dirent(((struct readdir_callback *)__buf)->dirent, name, namlen, offset, ino);
     return 0;
 }
 
@@ -65,3 +70,47 @@ int sys_readdir(unsigned int fd, char *dirent, unsigned int count
 
     return error;
 }
+
+/*
+ * getdents fills the user buffer with as many struct dirent as fit
+ * and returns the number of bytes used, 0 at end of directory.
+ */
+struct getdents_callback {
+    struct dirent *current;
+    unsigned int count;		/* bytes left in buffer */
+};
+
+static int filldir(char *__buf, char *name, size_t namlen, off_t offset, ino_t ino)
+{
+    register struct getdents_callback *buf = (struct getdents_callback *)__buf;
+
+    if (buf->count < sizeof(struct dirent)) return -EINVAL;
+    put_dirent(buf->current++, name, namlen, offset, ino);
+    buf->count -= sizeof(struct dirent);
+    return 0;
+}
+
+int sys_getdents(unsigned int fd, char *dirent, unsigned int count)
+{
+    int error;
+    struct file *file;
+    register struct file *filp;
+    register struct file_operations *fop;
+    struct getdents_callback buf;
+
+    if (count < sizeof(struct dirent))
+	return -EINVAL;
+    if ((error = fd_check(fd, dirent, count, FMODE_READ, &file)) >= 0) {
+	error = -ENOTDIR;
+	filp = file;
+	fop = filp->f_op;
+	if (fop && fop->readdir) {
+	    buf.current = (struct dirent *) dirent;
+	    buf.count = count;
+	    if ((error = fop->readdir(filp->f_inode, filp, &buf, filldir)) >= 0)
+		error = count - buf.count;
+	}
+    }
+
+    return error;
+}
@@ -15,6 +15,69 @@
 
 /* File operations */
 
+#ifdef CONFIG_ROMFS_COMPRESS
+
+/* Get the buffer of decompressed file block n, mapped */
+
+static struct buffer_head * romfs_zbread (struct inode * i, word_t n)
+{
+	struct buffer_head * bh;
+	seg_t seg = i->u.romfs.seg;
+	word_t start, zlen, len;
+
+	bh = getblk32 (i->i_sb->s_dev, ROMFS_ZBLOCK (seg, n));
+	map_buffer (bh);
+	if (EBH(bh)->b_uptodate)
+		return bh;
+
+	start = peekw (n << 1, seg);
+	zlen = peekw ((n + 1) << 1, seg) - start;
+	len = BLOCK_SIZE;
+	if (i->i_size - ((loff_t) n << BLOCK_SIZE_BITS) < BLOCK_SIZE)
+		len = (word_t) i->i_size & (BLOCK_SIZE - 1);
+
+	if (zlen == len)		/* stored as is */
+		fmemcpyb (bh->b_data, kernel_ds, (char *) start, seg, len);
+	else if (lz_decompress_far (bh->b_data, kernel_ds, (char *) start, seg,
+			bh->b_data + len) != bh->b_data + len) {
+		printk ("romfs: bad compressed block %u at %x\n", n, seg);
+		unmap_brelse (bh);
+		return NULL;
+	}
+	mark_buffer_uptodate (bh, 1);
+	return bh;
+}
+
+/* Read from a compressed file through the buffer cache */
+
+static size_t romfs_zread (struct inode * i, struct file * f,
+	char * buf, size_t len)
+{
+	struct buffer_head * bh;
+	size_t count = 0;
+	word_t offset, chars;
+
+	while (len) {
+		bh = romfs_zbread (i, (word_t) (f->f_pos >> BLOCK_SIZE_BITS));
+		if (!bh)
+			return count? count: -EIO;
+		offset = (word_t) f->f_pos & (BLOCK_SIZE - 1);
+		chars = BLOCK_SIZE - offset;
+		if (chars > len) chars = len;
+
+		/* ELKS trick: the destination buffer is in the current task data segment */
+		fmemcpyb (buf, current->t_regs.ds, bh->b_data + offset, kernel_ds, chars);
+		unmap_brelse (bh);
+
+		buf += chars;
+		f->f_pos += chars;
+		count += chars;
+		len -= chars;
+	}
+	return count;
+}
+#endif
+
 static size_t romfs_read (struct inode * i, struct file * f,
 	char * buf, size_t len)
 {
@@ -33,6 +96,15 @@ static size_t romfs_read (struct inode * i, struct file * f,
 			len = i->i_size - f->f_pos;
 		}
 
+		if (i->u.romfs.comp) {
+#ifdef CONFIG_ROMFS_COMPRESS
+			count = romfs_zread (i, f, buf, len);
+#else
+			count = -EIO;	/* kernel built without compressed files */
+#endif
+			break;
+		}
+
 		/* ELKS trick: the destination buffer is in the current task data segment */
 		fmemcpyb (buf, current->t_regs.ds, (char *)(int) f->f_pos, i->u.romfs.seg, len);
 
@@ -61,8 +133,6 @@ static int romfs_readdir (struct inode * i, struct file * f,
 		iseg = i->u.romfs.seg;
 		pos = f->f_pos;
 
-		/* Only one entry is asked by the kernel */
-
 		if (pos >= i->i_size) {
 			f->f_pos = -1;
 			res = 0;
@@ -79,17 +149,46 @@ static int romfs_readdir (struct inode * i, struct file * f,
 
 		res = filldir (dirent, name, len, pos, (ino_t)peekw(pos, iseg));
 		debug("readdir %T, %ld\n", iseg, pos + 3, (ino_t)peekw(pos, iseg));
-		if (res < 0) break;
+		if (res < 0) {			/* caller's buffer full */
+			res = 0;
+			break;
+		}
 
 		/* inode index + name length + name string */
 		f->f_pos = pos + 3 + len;
-		break;
 	}
 
 	return res;
 }
 
 
+/* Compare the entry at offset with name, return its inode or 0 */
+
+static word_t romfs_match (seg_t seg_i, word_t offset, const char * name, size_t len1)
+{
+	debug("romfs lookup %t, %T\n", name, seg_i, offset+3);
+	/* ELKS trick: the name is in the current task data segment */
+	/* TODO: remove that trick with explicit segment in call */
+	if (peekb (offset + 2, seg_i) == len1
+		&& !fmemcmpb ((char *)offset + 3, seg_i, (void *)name, current->t_regs.ds, len1))
+		return peekw (offset, seg_i);
+	return 0;
+}
+
+
+/* Hash of an entry name, must match dir_hash() in mkromfs */
+
+static word_t romfs_hash (const char * name, size_t len)
+{
+	word_t h = 0;
+	seg_t ds = current->t_regs.ds;
+
+	while (len--)
+		h = (h << 5) - h + peekb ((word_t)name++, ds);
+	return h;
+}
+
+
 static int romfs_lookup (struct inode * dir, const char * name, size_t len1,
 	struct inode ** result)
 {
@@ -98,29 +197,33 @@ static int romfs_lookup (struct inode * dir, const char * name, size_t len1,
 
 	word_t ino;
 	word_t offset;
-	size_t len2;
+	word_t index, table, k, end;
 	seg_t seg_i;
 
 	while (1) {
 		seg_i = dir->u.romfs.seg;
 
 		ino = 0;
-		offset = 0;
-
-		while (offset < dir->i_size) {
-			debug("romfs lookup %t, %T\n", name, seg_i, offset+3);
-			len2 = peekb (offset + 2, seg_i);
-			/* ELKS trick: the name is in the current task data segment */
-			/* TODO: remove that trick with explicit segment in call */
-			if (len2 == len1) {
-				if (!fmemcmpb ((char *)offset + 3, seg_i, (void *)name, current->t_regs.ds, len2)) {
-					ino = peekw (offset, seg_i);
-					break;
-				}
+		index = dir->u.romfs.hash;
+
+		if (index) {
+			/* bucket count, bucket starts, entry offsets sorted by bucket */
+			k = (romfs_hash (name, len1) & (peekw (index, seg_i) - 1)) << 1;
+			table = index + 4 + (peekw (index, seg_i) << 1);
+			end = peekw (index + 4 + k, seg_i);
+			for (k = peekw (index + 2 + k, seg_i); k < end; k++) {
+				ino = romfs_match (seg_i, peekw (table + (k << 1), seg_i), name, len1);
+				if (ino) break;
+			}
+		} else {
+			offset = 0;
+			while (offset < dir->i_size) {
+				ino = romfs_match (seg_i, offset, name, len1);
+				if (ino) break;
+
+				/* inode index + name length + name string */
+				offset += 3 + peekb (offset + 2, seg_i);
 			}
-
-			/* inode index + name length + name string */
-			offset += 3 + len2;
 		}
 
 		if (!ino) {
@@ -273,6 +376,8 @@ static void romfs_read_inode (struct inode * i)
 		}
 		else {
 			i->u.romfs.seg = CONFIG_ROMFS_BASE + rim.offset;
+			i->u.romfs.hash = (rim.flags & ROMFH_HASH)? rim.size: 0;
+			i->u.romfs.comp = rim.flags & ROMFH_COMP;
 		}
 
 		i->i_mode = m;
@@ -15,6 +15,7 @@
 #include <linuxmt/fs.h>
 #include <linuxmt/kernel.h>
 #include <linuxmt/mm.h>
+#include <linuxmt/poll.h>
 #include <linuxmt/sched.h>
 #include <linuxmt/signal.h>
 #include <linuxmt/stat.h>
@@ -23,6 +24,7 @@
 #include <linuxmt/types.h>
 #include <linuxmt/debug.h>
 
+#include <arch/irq.h>
 #include <arch/segment.h>
 #include <arch/system.h>
 
@@ -48,6 +50,8 @@
 
 struct wait_queue select_queue;  /* magic queue - see sleepwake.c */
 
+static unsigned char poll_added;  /* poll slots used by current check() */
+
 /* Add queue to polled ones */
 
 void select_wait (struct wait_queue *q)
@@ -57,8 +61,9 @@ void select_wait (struct wait_queue *q)
 
 	for (n = 0; n < POLL_MAX; n++) {
 		p = &(current->poll [n]);
-		if (!*p) {
-			*p = q;
+		if (!*p) *p = q;
+		if (*p == q) {
+			poll_added |= 1 << n;
 			return;
 		}
 	}
@@ -66,20 +71,25 @@ void select_wait (struct wait_queue *q)
 	panic ("select_wait:no slot left");
 }
 
-/* Return true if queue is polled */
+/* Return true if queue is polled, marking its slot as woken */
 
 int select_poll (struct task_struct * t, struct wait_queue *q)
 {
 	int n;
 	struct wait_queue *p;
+	flag_t flags;
 
 	for (n = 0; n < POLL_MAX; n++) {
 		p = t->poll [n];
 		if (!p) return 0;
-		if (p == q) return 1;
+		if (p == q) {
+			save_flags(flags);
+			clr_irq();
+			t->poll_ready |= 1 << n;
+			restore_flags(flags);
+			return 1;
+		}
 	}
-
-	panic ("select_poll:no slot found\n");
 	return 0;
 }
 
@@ -110,6 +120,39 @@ static int check(int flag, register struct file *file)
     return (flag != SEL_EX);
 }
 
+/* start polling, registered queues are kept until poll_end */
+static void poll_start(unsigned char *fdpoll, int n)
+{
+    memset (current->poll, 0, sizeof (struct wait_queue *) * POLL_MAX);
+    memset (fdpoll, 0, n);
+    current->poll_ready = 0;
+    wait_set(&select_queue);
+}
+
+/* sleep until a polled queue is woken or timeout, returns woken slots */
+static unsigned char poll_sleep(void)
+{
+    unsigned char ready;
+    flag_t flags;
+
+    debug_sched("select(%P): timeout %lx\n", current->timeout);
+    schedule();
+    save_flags(flags);
+    clr_irq();
+    ready = current->poll_ready;
+    current->poll_ready = 0;
+    restore_flags(flags);
+    return ready;
+}
+
+static void poll_end(void)
+{
+    memset (current->poll, 0, sizeof (struct wait_queue *) * POLL_MAX);
+    current->poll_ready = 0;
+    current->state = TASK_RUNNING;
+    wait_clear(&select_queue);
+}
+
 static int do_select(int n, fd_set * in, fd_set * out, fd_set * ex,
 		     fd_set * res_in, fd_set * res_out, fd_set * res_ex)
 {
@@ -117,6 +160,8 @@ static int do_select(int n, fd_set * in, fd_set * out, fd_set * ex,
     int count = -1;
     int i;
     struct file **filp;
+    unsigned char fdpoll[NR_OPEN];  /* poll slots registered by each file */
+    unsigned char ready = 0;
 
     set = *in | *out | *ex;
     filp = current->files.fd;
@@ -129,17 +174,18 @@ static int do_select(int n, fd_set * in, fd_set * out, fd_set * ex,
     }
     n = count + 1;
     count = 0;
-    wait_set(&select_queue);
+    poll_start(fdpoll, n);
   repeat:
     /* Note: Race condition here where wake_up_process sets TASK_RUNNING state
      * but check()/fops->select returns 0. This then causes schedule() to
      * reschedule current task since current->state == TASK_RUNNING by wake_up.
      */
     current->state = TASK_INTERRUPTIBLE;
-    memset (current->poll, 0, sizeof (struct wait_queue *) * POLL_MAX);
     filp = current->files.fd;
     for (i = 0; i < n; i++, filp++) {
-	if (*filp) {
+	/* after a wakeup, only recheck files waiting on a woken queue */
+	if (*filp && (!fdpoll[i] || (fdpoll[i] & ready))) {
+	    poll_added = 0;
 	    if (FD_ISSET(i, in) && check(SEL_IN, *filp)) {
 		FD_SET(i, res_in);
 		count++;
@@ -152,17 +198,15 @@ static int do_select(int n, fd_set * in, fd_set * out, fd_set * ex,
 		FD_SET(i, res_ex);
 		count++;
 	    }
+	    fdpoll[i] |= poll_added;
 	}
     }
     if (!count && current->timeout && !(current->signal /* & ~currentp->blocked */ )) {
-	debug_sched("select(%P): timeout %lx\n", current->timeout);
-	schedule();
+	ready = poll_sleep();
 	goto repeat;
     }
 
-    memset (current->poll, 0, sizeof (struct wait_queue *) * POLL_MAX);
-    current->state = TASK_RUNNING;
-    wait_clear(&select_queue);
+    poll_end();
     return count;
 }
 
@@ -234,3 +278,71 @@ int sys_select(int n, fd_set * inp, fd_set * outp, fd_set * exp,
   outl:
     return error;
 }
+
+/*
+ * Poll an array of descriptors, using the same fops->select hooks and
+ * queue registration as select. Only the entries given are examined,
+ * and after a wakeup only those waiting on a woken queue are rechecked.
+ * Timeout is in milliseconds, negative for no timeout.
+ */
+int sys_poll(struct pollfd *ufds, unsigned int nfds, int timeout)
+{
+    struct pollfd *pfd;
+    struct file *filp;
+    int count, i, fd, events, revents;
+    unsigned char fdpoll[NR_OPEN];  /* poll slots registered by each entry */
+    unsigned char ready = 0;
+
+    if (nfds > NR_OPEN)
+	return -EINVAL;
+    count = verify_area(VERIFY_WRITE, ufds, nfds * sizeof(struct pollfd));
+    if (count)
+	return count;
+
+    if (timeout < 0)
+	current->timeout = ~0UL;
+    else if (timeout == 0)
+	current->timeout = 0UL;
+    else current->timeout = ROUND_UP(timeout, 1000/HZ) + jiffies + 1UL;
+
+    poll_start(fdpoll, nfds);
+  repeat:
+    current->state = TASK_INTERRUPTIBLE;
+    pfd = ufds;
+    for (i = 0; i < nfds; i++, pfd++) {
+	/* after a wakeup, only recheck entries waiting on a woken queue */
+	if (fdpoll[i] && !(fdpoll[i] & ready))
+	    continue;
+	fd = get_user(&pfd->fd);
+	events = get_user(&pfd->events);
+	revents = 0;
+	if (fd >= 0) {
+	    filp = (fd < NR_OPEN)? current->files.fd[fd]: NULL;
+	    if (!filp || !filp->f_inode)
+		revents = POLLNVAL;
+	    else {
+		poll_added = 0;
+		if ((events & POLLIN) && check(SEL_IN, filp))
+		    revents |= POLLIN;
+		if ((events & POLLOUT) && check(SEL_OUT, filp))
+		    revents |= POLLOUT;
+		if ((events & POLLPRI) && check(SEL_EX, filp))
+		    revents |= POLLPRI;
+		fdpoll[i] |= poll_added;
+	    }
+	}
+	put_user(revents, &pfd->revents);
+	if (revents)
+	    count++;
+    }
+    if (!count && current->timeout && !current->signal) {
+	ready = poll_sleep();
+	goto repeat;
+    }
+
+    poll_end();
+    current->timeout = 0UL;
+    if (!count && current->signal)
+	return -EINTR;
+    return count;
+}
@@ -44,6 +44,10 @@ extern struct file_system_type romfs_fs_type;
 extern struct file_system_type msdos_fs_type;
 #endif
 
+#ifdef CONFIG_TMPFS_FS
+extern struct file_system_type tmpfs_fs_type;
+#endif
+
 static struct file_system_type *file_systems[] = {
 /* first filesystem is default filesystem for mount w/o -t parm*/
 #ifdef CONFIG_ROMFS_FS
@@ -54,10 +58,13 @@ static struct file_system_type *file_systems[] = {
 #endif
 #ifdef CONFIG_FS_FAT
         &msdos_fs_type,
+#endif
+#ifdef CONFIG_TMPFS_FS
+        &tmpfs_fs_type,         /* never the root filesystem */
 #endif
         NULL
 };
-static const char *fsname[] = { NULL, "minix", "msdos", "romfs" };
+static const char *fsname[] = { NULL, "minix", "msdos", "romfs", "tmpfs" };
 
 #ifdef CONFIG_FULL_VFS
 static struct file_system_type *get_fs_type(int type)
@@ -240,6 +247,7 @@ int do_umount(kdev_t dev)
                 sop = sb->s_op;
                 if (sop && sop->write_super && sb->s_dirt) sop->write_super(sb);
                 put_super(dev);
+                textcache_inval(dev);
             }
         }
     }
@@ -388,6 +396,29 @@ static int do_remount(char *dir, int flags, char *data)
     return retval;
 }
 
+#ifdef CONFIG_TMPFS_FS
+/*
+ * A tmpfs has no device, so it gets the first free unnamed device number.
+ * The device name argument is instead the mount data, the size in K.
+ */
+static int mount_tmpfs(char *data, char *dir_name, int flags)
+{
+    kdev_t dev;
+    int minor;
+    char buf[16];
+
+    buf[0] = '\0';
+    if (data && strlen_fromfs(data, sizeof(buf)) < sizeof(buf))
+        memcpy_fromfs(buf, data, strlen_fromfs(data, sizeof(buf)) + 1);
+    for (minor = 1; minor < 256; minor++) {
+        dev = MKDEV(UNNAMED_MAJOR, minor);
+        if (!get_super(dev))
+            return do_mount(dev, dir_name, FST_TMPFS, flags, buf);
+    }
+    return -EMFILE;
+}
+#endif
+
 /*
  * Flags is a 16-bit value that allows up to 16 non-fs dependent flags to
  * be given to the mount() call (ie: read-only, no-dev, no-suid etc).
@@ -417,6 +448,11 @@ int sys_mount(char *dev_name, char *dir_name, int type, int flags)
 
     filp = NULL;
 
+#ifdef CONFIG_TMPFS_FS
+    if (fstype->type == FST_TMPFS)
+        return mount_tmpfs(dev_name, dir_name, flags);
+#endif
+
         retval = namei(dev_name, &inode, 0, 0);
         if (retval) return retval;
         inodep = inode;
@@ -472,6 +508,9 @@ void mount_root(void)
 #ifdef BLOAT_FS
         if (!fp->requires_dev) continue;
 #endif
+#ifdef CONFIG_TMPFS_FS
+        if (fp->type == FST_TMPFS) continue;
+#endif
 
         sb = read_super(ROOT_DEV, fp->type, root_mountflags, NULL, 1);
         if (sb) {
@@ -0,0 +1,903 @@
+/*
+ * TMPFS - a read-write filesystem in main memory
+ *
+ * Files live in 1K blocks taken from main memory TMPFS_CHUNK_BLOCKS at a
+ * time as they are written, up to the size given at mount, so scratch
+ * files never touch a disk. The metadata segment allocated at mount holds
+ * the node table, one struct tmpfs_node per file, followed by the next
+ * block table chaining the blocks of each file and of the free list, and
+ * the chunk table. Directories are files of struct tmpfs_dirent, with
+ * "." and ".." as for minix.
+ *
+ * Mount with "mount -t tmpfs <KB> <dir>", where the device argument is
+ * the size in K, or "size=<KB>". Everything is lost at umount. Chunks
+ * are only returned to main memory at umount.
+ */
+
+#include <linuxmt/config.h>
+#include <linuxmt/types.h>
+#include <linuxmt/errno.h>
+#include <linuxmt/fs.h>
+#include <linuxmt/sched.h>
+#include <linuxmt/stat.h>
+#include <linuxmt/fcntl.h>
+#include <linuxmt/kernel.h>
+#include <linuxmt/mm.h>
+#include <linuxmt/string.h>
+#include <linuxmt/debug.h>
+#include <arch/segment.h>
+
+#define TSB(sb)             (&(sb)->u.tmpfs_sb)
+#define META(sbi)           ((sbi)->s_meta->base)
+#define NODE_OFF(ino)       ((word_t)((ino) - 1) * sizeof(struct tmpfs_node))
+#define NEXT_OFF(sbi, b)    ((sbi)->s_next_off + ((b) << 1))
+#define CHUNK_OFF(sbi, c)   ((sbi)->s_chunk_off + ((c) << 1))
+#define DIRENT_SIZE         sizeof(struct tmpfs_dirent)
+
+static struct super_operations tmpfs_sops;
+static struct inode_operations tmpfs_file_inode_operations;
+static struct inode_operations tmpfs_dir_inode_operations;
+static struct inode_operations tmpfs_symlink_inode_operations;
+
+/* Block management */
+
+static word_t get_next(struct tmpfs_sb_info *sbi, word_t b)
+{
+	return peekw(NEXT_OFF(sbi, b), META(sbi));
+}
+
+static void set_next(struct tmpfs_sb_info *sbi, word_t b, word_t next)
+{
+	pokew(NEXT_OFF(sbi, b), META(sbi), next);
+}
+
+/* Segment whose offset 0 is the start of block b */
+static seg_t block_seg(struct tmpfs_sb_info *sbi, word_t b)
+{
+	segment_s *seg;
+
+	b--;
+	seg = (segment_s *)peekw(CHUNK_OFF(sbi, b / TMPFS_CHUNK_BLOCKS), META(sbi));
+	return seg->base + ((b % TMPFS_CHUNK_BLOCKS) << (TMPFS_BLOCK_BITS - 4));
+}
+
+/* Return a zeroed block, taking a new chunk from main memory if needed */
+static word_t alloc_block(struct tmpfs_sb_info *sbi)
+{
+	segment_s *seg;
+	word_t b, n;
+
+	if (!sbi->s_free) {
+		n = sbi->s_nchunks * TMPFS_CHUNK_BLOCKS;
+		if (n >= sbi->s_nblocks
+		    || !(seg = seg_alloc(TMPFS_CHUNK_BLOCKS << (TMPFS_BLOCK_BITS - 4), SEG_FLAG_RAMDSK)))
+			return 0;
+		pokew(CHUNK_OFF(sbi, sbi->s_nchunks), META(sbi), (word_t)seg);
+		sbi->s_nchunks++;
+		for (b = n + TMPFS_CHUNK_BLOCKS; b > n; b--) {
+			set_next(sbi, b, sbi->s_free);
+			sbi->s_free = b;
+		}
+	}
+	b = sbi->s_free;
+	sbi->s_free = get_next(sbi, b);
+	set_next(sbi, b, 0);
+	sbi->s_used++;
+	fmemsetw(0, block_seg(sbi, b), 0, TMPFS_BLOCK_SIZE >> 1);
+	return b;
+}
+
+/* Free the chain of blocks starting at b */
+static void free_blocks(struct tmpfs_sb_info *sbi, word_t b)
+{
+	word_t next;
+
+	while (b) {
+		next = get_next(sbi, b);
+		set_next(sbi, b, sbi->s_free);
+		sbi->s_free = b;
+		sbi->s_used--;
+		b = next;
+	}
+}
+
+/*
+ * Return the block holding block index n of the file, 0 if none. With
+ * create, missing blocks up to n are allocated. The last block found is
+ * remembered, so sequential access doesn't walk the chain from the start.
+ */
+static word_t tmpfs_bmap(register struct inode *inode, word_t n, int create)
+{
+	struct tmpfs_sb_info *sbi = TSB(inode->i_sb);
+	word_t b, i, prev;
+
+	if (inode->u.tmpfs_i.i_cblk && n >= inode->u.tmpfs_i.i_cidx) {
+		b = inode->u.tmpfs_i.i_cblk;
+		i = inode->u.tmpfs_i.i_cidx;
+	} else {
+		if (!(b = inode->u.tmpfs_i.i_first)) {
+			if (!create || !(b = alloc_block(sbi)))
+				return 0;
+			inode->u.tmpfs_i.i_first = b;
+			inode->i_dirt = 1;
+		}
+		i = 0;
+	}
+	for (; i < n; i++) {
+		prev = b;
+		if (!(b = get_next(sbi, b))) {
+			if (!create || !(b = alloc_block(sbi)))
+				return 0;
+			set_next(sbi, prev, b);
+		}
+	}
+	inode->u.tmpfs_i.i_cblk = b;
+	inode->u.tmpfs_i.i_cidx = n;
+	return b;
+}
+
+/* Free the blocks past i_size, and zero the tail of the last one kept */
+static void tmpfs_truncate(register struct inode *inode)
+{
+	struct tmpfs_sb_info *sbi = TSB(inode->i_sb);
+	word_t keep, off, b, last;
+
+	if (!(S_ISREG(inode->i_mode) || S_ISDIR(inode->i_mode) || S_ISLNK(inode->i_mode)))
+		return;
+	keep = (word_t)((inode->i_size + TMPFS_BLOCK_SIZE - 1) >> TMPFS_BLOCK_BITS);
+	last = 0;
+	for (b = inode->u.tmpfs_i.i_first; b && keep; keep--) {
+		last = b;
+		b = get_next(sbi, b);
+	}
+	if (last) {
+		set_next(sbi, last, 0);
+		off = (word_t)inode->i_size & (TMPFS_BLOCK_SIZE - 1);
+		if (off)
+			fmemsetb((char *)off, block_seg(sbi, last), 0, TMPFS_BLOCK_SIZE - off);
+	} else
+		inode->u.tmpfs_i.i_first = 0;
+	free_blocks(sbi, b);
+	inode->u.tmpfs_i.i_cblk = 0;
+	inode->i_mtime = inode->i_ctime = current_time();
+	inode->i_dirt = 1;
+}
+
+/* File operations */
+
+static size_t tmpfs_file_read(struct inode *inode, struct file *filp, char *buf, size_t count)
+{
+	struct tmpfs_sb_info *sbi = TSB(inode->i_sb);
+	size_t chars, off, done = 0;
+	word_t b;
+
+	if (filp->f_pos >= (loff_t)inode->i_size)
+		return 0;
+	if ((loff_t)count > (loff_t)inode->i_size - filp->f_pos)
+		count = (size_t)(inode->i_size - filp->f_pos);
+	while (count) {
+		off = (size_t)filp->f_pos & (TMPFS_BLOCK_SIZE - 1);
+		chars = TMPFS_BLOCK_SIZE - off;
+		if (chars > count)
+			chars = count;
+		b = tmpfs_bmap(inode, (word_t)(filp->f_pos >> TMPFS_BLOCK_BITS), 0);
+		if (b)
+			fmemcpyb(buf, current->t_regs.ds, (char *)off, block_seg(sbi, b), chars);
+		else
+			fmemsetb(buf, current->t_regs.ds, 0, chars);
+		filp->f_pos += chars;
+		buf += chars;
+		done += chars;
+		count -= chars;
+	}
+	if (done)
+		update_atime(inode);
+	return done;
+}
+
+static size_t tmpfs_file_write(register struct inode *inode, struct file *filp,
+	char *buf, size_t count)
+{
+	struct tmpfs_sb_info *sbi = TSB(inode->i_sb);
+	size_t chars, off, done = 0;
+	word_t b;
+
+	if (filp->f_flags & O_APPEND)
+		filp->f_pos = (loff_t)inode->i_size;
+	while (count) {
+		off = (size_t)filp->f_pos & (TMPFS_BLOCK_SIZE - 1);
+		chars = TMPFS_BLOCK_SIZE - off;
+		if (chars > count)
+			chars = count;
+		b = tmpfs_bmap(inode, (word_t)(filp->f_pos >> TMPFS_BLOCK_BITS), 1);
+		if (!b) {
+			if (!done)
+				return -ENOSPC;
+			break;
+		}
+		fmemcpyb((char *)off, block_seg(sbi, b), buf, current->t_regs.ds, chars);
+		filp->f_pos += chars;
+		if (filp->f_pos > (loff_t)inode->i_size)
+			inode->i_size = (__u32)filp->f_pos;
+		buf += chars;
+		done += chars;
+		count -= chars;
+	}
+	inode->i_mtime = inode->i_ctime = current_time();
+	inode->i_dirt = 1;
+	return done;
+}
+
+/* Directory entries */
+
+static void get_dirent(struct inode *dir, loff_t pos, struct tmpfs_dirent *de)
+{
+	word_t b = tmpfs_bmap(dir, (word_t)(pos >> TMPFS_BLOCK_BITS), 0);
+
+	if (b)
+		fmemcpyw(de, kernel_ds, (char *)((word_t)pos & (TMPFS_BLOCK_SIZE - 1)),
+			block_seg(TSB(dir->i_sb), b), DIRENT_SIZE >> 1);
+	else
+		de->ino = 0;
+}
+
+static void put_dirent(struct inode *dir, loff_t pos, struct tmpfs_dirent *de)
+{
+	word_t b = tmpfs_bmap(dir, (word_t)(pos >> TMPFS_BLOCK_BITS), 0);
+
+	if (b)
+		fmemcpyw((char *)((word_t)pos & (TMPFS_BLOCK_SIZE - 1)),
+			block_seg(TSB(dir->i_sb), b), de, kernel_ds, DIRENT_SIZE >> 1);
+}
+
+/* Compare name in user space with entry, "" matches "." */
+static int tmpfs_match(size_t len, const char *name, struct tmpfs_dirent *de)
+{
+	if (!de->ino || len > TMPFS_NAME_LEN)
+		return 0;
+	if (!len)
+		return de->name[0] == '.' && de->name[1] == '\0';
+	return (len == TMPFS_NAME_LEN || !de->name[len]) && !fs_memcmp(name, de->name, len);
+}
+
+/* Find name in dir, returning its inode number and entry position, or 0 */
+static ino_t tmpfs_find_entry(struct inode *dir, const char *name, size_t len, loff_t *ppos)
+{
+	struct tmpfs_dirent de;
+	loff_t pos;
+
+	for (pos = 0; pos < (loff_t)dir->i_size; pos += DIRENT_SIZE) {
+		get_dirent(dir, pos, &de);
+		if (tmpfs_match(len, name, &de)) {
+			if (ppos)
+				*ppos = pos;
+			return de.ino;
+		}
+	}
+	return 0;
+}
+
+static int tmpfs_add_entry(register struct inode *dir, const char *name, size_t len, ino_t ino)
+{
+	struct tmpfs_dirent de;
+	loff_t pos, slot = -1;
+
+	if (len > TMPFS_NAME_LEN)
+		return -ENAMETOOLONG;
+	if (!len)
+		return -ENOENT;
+	for (pos = 0; pos < (loff_t)dir->i_size; pos += DIRENT_SIZE) {
+		get_dirent(dir, pos, &de);
+		if (!de.ino) {
+			if (slot < 0)
+				slot = pos;
+		} else if (tmpfs_match(len, name, &de))
+			return -EEXIST;
+	}
+	if (slot < 0) {
+		slot = dir->i_size;
+		if (!tmpfs_bmap(dir, (word_t)(slot >> TMPFS_BLOCK_BITS), 1))
+			return -ENOSPC;
+		dir->i_size += DIRENT_SIZE;
+	}
+	de.ino = (__u16)ino;
+	memset(de.name, 0, TMPFS_NAME_LEN);
+	memcpy_fromfs(de.name, (char *)name, len);
+	put_dirent(dir, slot, &de);
+	dir->i_mtime = dir->i_ctime = current_time();
+	dir->i_dirt = 1;
+	return 0;
+}
+
+static int tmpfs_readdir(struct inode *inode, register struct file *filp,
+	char *dirent, filldir_t filldir)
+{
+	struct tmpfs_dirent de;
+
+	if (!S_ISDIR(inode->i_mode))
+		return -EBADF;
+	while (filp->f_pos < (loff_t)inode->i_size) {
+		get_dirent(inode, filp->f_pos, &de);
+		if (de.ino && filldir(dirent, de.name, strnlen(de.name, TMPFS_NAME_LEN),
+				filp->f_pos, (ino_t)de.ino) < 0)
+			break;
+		filp->f_pos += DIRENT_SIZE;
+	}
+	return 0;
+}
+
+static size_t tmpfs_dir_read(struct inode *inode, struct file *filp, char *buf, size_t count)
+{
+	return -EISDIR;
+}
+
+/* Inodes */
+
+static void tmpfs_set_ops(register struct inode *inode)
+{
+	if (S_ISREG(inode->i_mode))
+		inode->i_op = &tmpfs_file_inode_operations;
+	else if (S_ISDIR(inode->i_mode))
+		inode->i_op = &tmpfs_dir_inode_operations;
+	else if (S_ISLNK(inode->i_mode))
+		inode->i_op = &tmpfs_symlink_inode_operations;
+	/* others get the standard handlers */
+}
+
+static void tmpfs_read_inode(register struct inode *inode)
+{
+	struct tmpfs_sb_info *sbi = TSB(inode->i_sb);
+	struct tmpfs_node node;
+
+	if (inode->i_ino < 1 || inode->i_ino > sbi->s_nnodes)
+		return;
+	fmemcpyw(&node, kernel_ds, (char *)NODE_OFF(inode->i_ino), META(sbi), sizeof(node) >> 1);
+	inode->i_mode = node.mode;
+	inode->i_uid = node.uid;
+	inode->i_gid = node.gid;
+	inode->i_nlink = node.nlink;
+	inode->i_size = node.size;
+	inode->i_mtime = inode->i_atime = inode->i_ctime = node.mtime;
+	if (S_ISCHR(node.mode) || S_ISBLK(node.mode))
+		inode->i_rdev = to_kdev_t(node.rdev);
+	inode->u.tmpfs_i.i_first = node.first;
+	inode->u.tmpfs_i.i_cblk = 0;
+	tmpfs_set_ops(inode);
+}
+
+static void tmpfs_write_inode(register struct inode *inode)
+{
+	struct tmpfs_sb_info *sbi = TSB(inode->i_sb);
+	struct tmpfs_node node;
+
+	node.mode = inode->i_mode;
+	node.uid = inode->i_uid;
+	node.gid = inode->i_gid;
+	node.nlink = inode->i_nlink;
+	node.size = inode->i_size;
+	node.mtime = inode->i_mtime;
+	node.first = inode->u.tmpfs_i.i_first;
+	node.rdev = (S_ISCHR(inode->i_mode) || S_ISBLK(inode->i_mode))?
+		kdev_t_to_nr(inode->i_rdev): 0;
+	fmemcpyw((char *)NODE_OFF(inode->i_ino), META(sbi), &node, kernel_ds, sizeof(node) >> 1);
+	inode->i_dirt = 0;
+}
+
+static void tmpfs_put_inode(register struct inode *inode)
+{
+	if (!inode->i_nlink) {
+		inode->i_size = 0;
+		tmpfs_truncate(inode);
+		pokew(NODE_OFF(inode->i_ino) + offsetof(struct tmpfs_node, mode),
+			META(TSB(inode->i_sb)), 0);
+		clear_inode(inode);
+	}
+}
+
+/* Return a new in-core inode with a free node, or NULL */
+static struct inode *tmpfs_new_inode(struct inode *dir, __u16 mode)
+{
+	struct tmpfs_sb_info *sbi = TSB(dir->i_sb);
+	register struct inode *inode;
+	ino_t ino;
+
+	if (!(inode = new_inode(dir, mode)))        /* may sleep, so look for a node after */
+		return NULL;
+	for (ino = 1; ino <= sbi->s_nnodes; ino++) {
+		if (!peekw(NODE_OFF(ino) + offsetof(struct tmpfs_node, mode), META(sbi)))
+			break;
+	}
+	if (ino > sbi->s_nnodes) {
+		iput(inode);
+		return NULL;
+	}
+	inode->i_ino = ino;
+	tmpfs_set_ops(inode);
+	insert_inode_hash(inode);
+	tmpfs_write_inode(inode);                   /* claims the node */
+	return inode;
+}
+
+static int tmpfs_lookup(register struct inode *dir, const char *name, size_t len,
+	struct inode **result)
+{
+	ino_t ino;
+	int error = -ENOENT;
+
+	*result = NULL;
+	if (S_ISDIR(dir->i_mode) && (ino = tmpfs_find_entry(dir, name, len, NULL))) {
+		*result = iget(dir->i_sb, ino);
+		error = (!*result)? -EACCES: 0;
+	}
+	iput(dir);
+	return error;
+}
+
+static int tmpfs_create(register struct inode *dir, char *name, size_t len,
+	int mode, struct inode **result)
+{
+	register struct inode *inode;
+	int error;
+
+	*result = NULL;
+	if (!(inode = tmpfs_new_inode(dir, (__u16)mode)))
+		error = -ENOSPC;
+	else if ((error = tmpfs_add_entry(dir, name, len, inode->i_ino))) {
+		inode->i_nlink = 0;
+		iput(inode);
+	} else
+		*result = inode;
+	iput(dir);
+	return error;
+}
+
+static int tmpfs_mknod(register struct inode *dir, char *name, size_t len,
+	int mode, int rdev)
+{
+	register struct inode *inode;
+	int error;
+
+	if (tmpfs_find_entry(dir, name, len, NULL))
+		error = -EEXIST;
+	else if (!(inode = tmpfs_new_inode(dir, (__u16)mode)))
+		error = -ENOSPC;
+	else {
+		if (S_ISBLK(mode) || S_ISCHR(mode))
+			inode->i_rdev = to_kdev_t(rdev);
+		if ((error = tmpfs_add_entry(dir, name, len, inode->i_ino)))
+			inode->i_nlink = 0;
+		inode->i_dirt = 1;
+		iput(inode);
+	}
+	iput(dir);
+	return error;
+}
+
+static int tmpfs_mkdir(register struct inode *dir, char *name, size_t len, int mode)
+{
+	register struct inode *inode;
+	struct tmpfs_dirent de;
+	int error;
+
+	if (dir->i_nlink >= TMPFS_LINK_MAX)
+		error = -EMLINK;
+	else if (tmpfs_find_entry(dir, name, len, NULL))
+		error = -EEXIST;
+	else if (!(inode = tmpfs_new_inode(dir, (__u16)mode)))
+		error = -ENOSPC;
+	else {
+		error = -ENOSPC;
+		if (tmpfs_bmap(inode, 0, 1)) {
+			memset(&de, 0, sizeof(de));
+			de.ino = (__u16)inode->i_ino;
+			de.name[0] = '.';
+			put_dirent(inode, 0, &de);
+			de.ino = (__u16)dir->i_ino;
+			de.name[1] = '.';
+			put_dirent(inode, DIRENT_SIZE, &de);
+			inode->i_size = DIRENT_SIZE << 1;
+			error = tmpfs_add_entry(dir, name, len, inode->i_ino);
+		}
+		if (error)
+			inode->i_nlink = 0;
+		else {
+			inode->i_nlink = 2;
+			dir->i_nlink++;
+			dir->i_dirt = 1;
+		}
+		inode->i_dirt = 1;
+		iput(inode);
+	}
+	iput(dir);
+	return error;
+}
+
+static int empty_dir(struct inode *inode)
+{
+	struct tmpfs_dirent de;
+	loff_t pos;
+
+	for (pos = DIRENT_SIZE << 1; pos < (loff_t)inode->i_size; pos += DIRENT_SIZE) {
+		get_dirent(inode, pos, &de);
+		if (de.ino)
+			return 0;
+	}
+	return 1;
+}
+
+/* Remove the entry at pos in dir */
+static void tmpfs_clear_entry(struct inode *dir, loff_t pos)
+{
+	struct tmpfs_dirent de;
+
+	memset(&de, 0, sizeof(de));
+	put_dirent(dir, pos, &de);
+	dir->i_mtime = dir->i_ctime = current_time();
+	dir->i_dirt = 1;
+}
+
+static int tmpfs_rmdir(register struct inode *dir, char *name, size_t len)
+{
+	register struct inode *inode;
+	loff_t pos;
+	ino_t ino;
+	int error = -ENOENT;
+
+	if ((ino = tmpfs_find_entry(dir, name, len, &pos))) {
+		error = -EPERM;
+		if ((inode = iget(dir->i_sb, ino))) {
+			if (((dir->i_mode & S_ISVTX) && !suser() &&
+				(current->euid != inode->i_uid) && (current->euid != dir->i_uid))
+			    || inode == dir)
+				;
+			else if (!S_ISDIR(inode->i_mode))
+				error = -ENOTDIR;
+			else if (!empty_dir(inode))
+				error = -ENOTEMPTY;
+			else if (inode->i_count > 1)
+				error = -EBUSY;
+			else {
+				tmpfs_clear_entry(dir, pos);
+				inode->i_nlink = 0;
+				inode->i_dirt = 1;
+				dir->i_nlink--;
+				error = 0;
+			}
+			iput(inode);
+		}
+	}
+	iput(dir);
+	return error;
+}
+
+static int tmpfs_unlink(register struct inode *dir, char *name, size_t len)
+{
+	register struct inode *inode;
+	loff_t pos;
+	ino_t ino;
+	int error = -ENOENT;
+
+	if ((ino = tmpfs_find_entry(dir, name, len, &pos))) {
+		error = -EPERM;
+		if ((inode = iget(dir->i_sb, ino))) {
+			if (S_ISDIR(inode->i_mode)
+			    || ((dir->i_mode & S_ISVTX) && !suser() &&
+				current->euid != inode->i_uid && current->euid != dir->i_uid))
+				;
+			else {
+				tmpfs_clear_entry(dir, pos);
+				if (inode->i_nlink)
+					inode->i_nlink--;
+				inode->i_ctime = dir->i_ctime;
+				inode->i_dirt = 1;
+				error = 0;
+			}
+			iput(inode);
+		}
+	}
+	iput(dir);
+	return error;
+}
+
+static int tmpfs_symlink(struct inode *dir, char *name, size_t len, char *symname)
+{
+	register struct inode *inode;
+	word_t b;
+	int error;
+
+	if (tmpfs_find_entry(dir, name, len, NULL))
+		error = -EEXIST;
+	else if (!(inode = tmpfs_new_inode(dir, S_IFLNK)))
+		error = -ENOSPC;
+	else {
+		error = -ENOSPC;
+		if ((b = tmpfs_bmap(inode, 0, 1))) {
+			/* the block is zeroed, so the target stays null terminated */
+			if ((error = strlen_fromfs(symname, TMPFS_BLOCK_SIZE - 1)) > TMPFS_BLOCK_SIZE - 1)
+				error = TMPFS_BLOCK_SIZE - 1;
+			inode->i_size = (__u32)error;
+			fmemcpyb(0, block_seg(TSB(dir->i_sb), b), symname, current->t_regs.ds, error);
+			error = tmpfs_add_entry(dir, name, len, inode->i_ino);
+		}
+		if (error)
+			inode->i_nlink = 0;
+		inode->i_dirt = 1;
+		iput(inode);
+	}
+	iput(dir);
+	return error;
+}
+
+static int tmpfs_link(register struct inode *dir, char *name, size_t len,
+	register struct inode *oldinode)
+{
+	int error;
+
+	if (S_ISDIR(oldinode->i_mode))
+		error = -EPERM;
+	else if (oldinode->i_nlink >= TMPFS_LINK_MAX)
+		error = -EMLINK;
+	else if (!(error = tmpfs_add_entry(dir, name, len, oldinode->i_ino))) {
+		oldinode->i_nlink++;
+		oldinode->i_ctime = current_time();
+		oldinode->i_dirt = 1;
+	}
+	iput(dir);
+	iput(oldinode);
+	return error;
+}
+
+static int tmpfs_readlink(register struct inode *inode, char *buf, size_t len)
+{
+	word_t b;
+
+	if (!S_ISLNK(inode->i_mode))
+		len = -EINVAL;
+	else if (!(b = inode->u.tmpfs_i.i_first))
+		len = 0;
+	else {
+		if (len > inode->i_size)
+			len = inode->i_size;
+		fmemcpyb(buf, current->t_regs.ds, 0, block_seg(TSB(inode->i_sb), b), len);
+	}
+	iput(inode);
+	return len;
+}
+
+static int tmpfs_follow_link(struct inode *dir, register struct inode *inode,
+	int flag, int mode, struct inode **res_inode)
+{
+	static int link_count = 0;
+	seg_t ds, *pds;
+	word_t b;
+	int error;
+
+	*res_inode = NULL;
+	if (!dir) {
+		dir = current->fs.root;
+		dir->i_count++;
+	}
+	if (!inode)
+		error = -ENOENT;
+	else if (!S_ISLNK(inode->i_mode)) {
+		*res_inode = inode;
+		error = 0;
+	} else if (link_count > 5) {
+		iput(inode);
+		error = -ELOOP;
+	} else {
+		b = inode->u.tmpfs_i.i_first;
+		iput(inode);
+		if (!b)
+			error = -ENOENT;
+		else {
+			/* the target is read in place, as romfs does */
+			link_count++;
+			pds = &current->t_regs.ds;
+			ds = *pds;
+			*pds = block_seg(TSB(dir->i_sb), b);
+			error = open_namei(0, flag, mode, res_inode, dir);
+			*pds = ds;
+			link_count--;
+			return error;
+		}
+	}
+	iput(dir);
+	return error;
+}
+
+static struct file_operations tmpfs_file_operations = {
+	NULL,                   /* lseek - default */
+	tmpfs_file_read,        /* read */
+	tmpfs_file_write,       /* write */
+	NULL,                   /* readdir - bad */
+	NULL,                   /* select - default */
+	NULL,                   /* ioctl - default */
+	NULL,                   /* no special open is needed */
+	NULL                    /* release */
+};
+
+static struct inode_operations tmpfs_file_inode_operations = {
+	&tmpfs_file_operations, /* default file operations */
+	NULL,                   /* create */
+	NULL,                   /* lookup */
+	NULL,                   /* link */
+	NULL,                   /* unlink */
+	NULL,                   /* symlink */
+	NULL,                   /* mkdir */
+	NULL,                   /* rmdir */
+	NULL,                   /* mknod */
+	NULL,                   /* readlink */
+	NULL,                   /* follow_link */
+	NULL,                   /* getblk */
+	tmpfs_truncate          /* truncate */
+};
+
+static struct file_operations tmpfs_dir_operations = {
+	NULL,                   /* lseek - default */
+	tmpfs_dir_read,         /* read */
+	NULL,                   /* write - bad */
+	tmpfs_readdir,          /* readdir */
+	NULL,                   /* select - default */
+	NULL,                   /* ioctl - default */
+	NULL,                   /* no special open code */
+	NULL                    /* no special release code */
+};
+
+static struct inode_operations tmpfs_dir_inode_operations = {
+	&tmpfs_dir_operations,  /* default directory file-ops */
+	tmpfs_create,           /* create */
+	tmpfs_lookup,           /* lookup */
+	tmpfs_link,             /* link */
+	tmpfs_unlink,           /* unlink */
+	tmpfs_symlink,          /* symlink */
+	tmpfs_mkdir,            /* mkdir */
+	tmpfs_rmdir,            /* rmdir */
+	tmpfs_mknod,            /* mknod */
+	NULL,                   /* readlink */
+	NULL,                   /* follow_link */
+	NULL,                   /* getblk */
+	tmpfs_truncate          /* truncate */
+};
+
+static struct inode_operations tmpfs_symlink_inode_operations = {
+	NULL,                   /* no file-operations */
+	NULL,                   /* create */
+	NULL,                   /* lookup */
+	NULL,                   /* link */
+	NULL,                   /* unlink */
+	NULL,                   /* symlink */
+	NULL,                   /* mkdir */
+	NULL,                   /* rmdir */
+	NULL,                   /* mknod */
+	tmpfs_readlink,         /* readlink */
+	tmpfs_follow_link,      /* follow_link */
+	NULL,                   /* getblk */
+	NULL                    /* truncate */
+};
+
+/* Superblock */
+
+static void tmpfs_put_super(register struct super_block *sb)
+{
+	struct tmpfs_sb_info *sbi = TSB(sb);
+	word_t c;
+
+	lock_super(sb);
+	for (c = 0; c < sbi->s_nchunks; c++)
+		seg_free((segment_s *)peekw(CHUNK_OFF(sbi, c), META(sbi)));
+	seg_free(sbi->s_meta);
+	sb->s_dev = 0;
+	unlock_super(sb);
+}
+
+static void tmpfs_statfs(struct super_block *sb, struct statfs *sf, int flags)
+{
+	struct tmpfs_sb_info *sbi = TSB(sb);
+	ino_t ino;
+	long ffree = 0;
+
+	sf->f_bsize = TMPFS_BLOCK_SIZE;
+	sf->f_blocks = sbi->s_nblocks;
+	sf->f_bfree = sf->f_bavail = sbi->s_nblocks - sbi->s_used;
+	sf->f_files = sbi->s_nnodes;
+	for (ino = 1; ino <= sbi->s_nnodes; ino++) {
+		if (!peekw(NODE_OFF(ino) + offsetof(struct tmpfs_node, mode), META(sbi)))
+			ffree++;
+	}
+	sf->f_ffree = ffree;
+}
+
+static struct super_operations tmpfs_sops = {
+	tmpfs_read_inode,
+	tmpfs_write_inode,
+	tmpfs_put_inode,
+	tmpfs_put_super,
+	NULL,                   /* write_super */
+	NULL,                   /* remount */
+	tmpfs_statfs
+};
+
+/* Parse the size in K from "<KB>" or "size=<KB>", 0 if not given */
+static unsigned int tmpfs_size_kb(char *data)
+{
+	unsigned int kb = 0;
+
+	if (!data)
+		return 0;
+	if (!strncmp(data, "size=", 5))
+		data += 5;
+	while (*data >= '0' && *data <= '9')
+		kb = kb * 10 + *data++ - '0';
+	return kb;
+}
+
+static struct super_block *tmpfs_read_super(register struct super_block *s, void *data, int silent)
+{
+	struct tmpfs_sb_info *sbi = TSB(s);
+	struct tmpfs_node node;
+	struct tmpfs_dirent de;
+	struct inode *root;
+	unsigned int kb;
+	word_t nchunks, size, b;
+
+	kb = tmpfs_size_kb(data);
+	if (!kb)
+		kb = TMPFS_DEFAULT_KB;
+	if (kb < TMPFS_MIN_KB)
+		kb = TMPFS_MIN_KB;
+	if (kb > TMPFS_MAX_KB)
+		kb = TMPFS_MAX_KB;
+	nchunks = (kb + TMPFS_CHUNK_BLOCKS - 1) / TMPFS_CHUNK_BLOCKS;
+
+	lock_super(s);
+	sbi->s_nblocks = nchunks * TMPFS_CHUNK_BLOCKS;
+	sbi->s_nnodes = sbi->s_nblocks / 2 + 16;    /* average file of 2K */
+	sbi->s_next_off = sbi->s_nnodes * sizeof(struct tmpfs_node);
+	sbi->s_chunk_off = sbi->s_next_off + (sbi->s_nblocks + 1) * sizeof(word_t);
+	size = sbi->s_chunk_off + nchunks * sizeof(word_t);
+	if (!(sbi->s_meta = seg_alloc((size + 15) >> 4, SEG_FLAG_RAMDSK))) {
+		if (!silent)
+			printk("tmpfs: no memory\n");
+		unlock_super(s);
+		return NULL;
+	}
+	fmemsetw(0, META(sbi), 0, (size + 1) >> 1);
+	sbi->s_nchunks = sbi->s_used = sbi->s_free = 0;
+	s->s_op = &tmpfs_sops;
+
+	/* root directory with "." and ".." */
+	b = 0;
+	if (sbi->s_nblocks)
+		b = alloc_block(sbi);
+	if (b) {
+		memset(&de, 0, sizeof(de));
+		de.ino = TMPFS_ROOT_INO;
+		de.name[0] = '.';
+		fmemcpyw(0, block_seg(sbi, b), &de, kernel_ds, DIRENT_SIZE >> 1);
+		de.name[1] = '.';
+		fmemcpyw((char *)DIRENT_SIZE, block_seg(sbi, b), &de, kernel_ds, DIRENT_SIZE >> 1);
+	}
+	memset(&node, 0, sizeof(node));
+	node.mode = S_IFDIR | S_ISVTX | 0777;
+	node.nlink = 2;
+	node.size = DIRENT_SIZE << 1;
+	node.mtime = current_time();
+	node.first = b;
+	fmemcpyw((char *)NODE_OFF(TMPFS_ROOT_INO), META(sbi), &node, kernel_ds, sizeof(node) >> 1);
+
+	if (!b || !(root = iget(s, TMPFS_ROOT_INO))) {
+		printk("tmpfs: can't make root directory\n");
+		tmpfs_put_super(s);
+		return NULL;
+	}
+	s->s_mounted = root;
+	printk("tmpfs: %uK\n", sbi->s_nblocks);
+	unlock_super(s);
+	return s;
+}
+
+struct file_system_type tmpfs_fs_type = {
+	tmpfs_read_super,
+	FST_TMPFS
+};
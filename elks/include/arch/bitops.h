@@ -7,5 +7,6 @@ unsigned char test_bit(unsigned int,void *);
 
 unsigned int find_first_non_zero_bit(int *,unsigned int);
 unsigned int find_first_zero_bit(int *,unsigned int);
+unsigned int find_next_zero_bit(int *,unsigned int,unsigned int);
 
 #endif
@@ -7,16 +7,30 @@
 
 #define INT_GENERIC  0  // use the generic interrupt handler (aka '_irqit')
 #define INT_SPECIFIC 1  // use a specific interrupt handler
+#define INT_SHARED   2  // generic handler, IRQ may be shared with other INT_SHARED handlers
 
 typedef void (* int_proc) (void);  // any INT handler
 typedef void (* irq_handler) (int,struct pt_regs *);   // IRQ handler
 
 void do_IRQ(int,void *);
 int request_irq(int,irq_handler,int hflag);
+int request_irq_entry(int,irq_handler,int_proc);
 int free_irq(int irq);
+int free_shared_irq(int irq, irq_handler handler);
 void int_vector_set (int vect, int_proc proc, int seg);
 void _irqit (void);
 
+/* bottom halves, run after the interrupt handler with interrupts enabled */
+#define NET_BH       0  // network interface
+#define KBD_BH       1  // keyboard typeahead
+#define NR_BH        4
+
+typedef void (* bh_handler) (void);
+
+void init_bh(int nr, bh_handler routine);
+void mark_bh(int nr);
+void do_bottom_halves(void);
+
 
 /* irq-8259.c, irq-8018x.c*/
 void initialize_irq(void);
@@ -26,6 +40,7 @@ int remap_irq(int);
 int irq_vector(int irq);
 
 void idle_halt(void);
+void idle_halt_sti(void);
 
 #ifdef __ia16__
 #define save_flags(x)                   \
@@ -11,10 +11,12 @@
  *  4   Com1 (/dev/ttyS0)   CONFIG_CHAR_DEV_RS      Optional
  *  5*  Unused
  *  5*  Com3 (/devb/ttyS2)  CONFIG_CHAR_DEV_RS      Optional
+ *  5*  LPT2 (/dev/lp1)     CONFIG_CHAR_DEV_LP      Optional, polled if unavailable
  *  5*  HW IDE hard drive   CONFIG_BLK_DEV_HD       Driver doesn't work
  *  6*  Unused
  *  6*  HW floppy drive     CONFIG_BLK_DEV_FD       Driver doesn't compile
- *  7   Unused (LPT, Com4)
+ *  7*  LPT1 (/dev/lp0)     CONFIG_CHAR_DEV_LP      Optional, polled if unavailable
+ *  7*  Com4 (/dev/ttyS3)   CONFIG_CHAR_DEV_RS      Optional
  *  8   Unused (RTC)
  *  9   3C509/EL3 (/dev/eth) CONFIG_ETH_EL3         Optional
  * 10   Unused (USB)                                Turned off
@@ -73,8 +75,7 @@
 
 /* serial, serial.c*/
 #ifdef CONFIG_CHAR_DEV_RS
-//#define CONFIG_FAST_IRQ4             /* COM1 very fast serial driver, no ISIG handling*/
-//#define CONFIG_FAST_IRQ3             /* COM2 very fast serial driver, no ISIG handling*/
+//#define CONFIG_FAST_IRQ              /* very fast serial receive on all ports, see serfast.S*/
 #endif
 
 #ifdef CONFIG_ARCH_PC98
@@ -94,6 +95,14 @@
 #define COM4_IRQ	7		/* unregistered unless COM4_PORT found*/
 #endif
 
+/* parallel, lp.c*/
+#ifdef CONFIG_ARCH_IBMPC
+#define LPT1_PORT	0x378		/* also 0x3BC on monochrome adapters*/
+#define LPT1_IRQ	7		/* requested at open, polled if busy*/
+#define LPT2_PORT	0x278
+#define LPT2_IRQ	5		/* requested at open, polled if busy*/
+#endif
+
 /* Ethernet card settings may be overridden in /bootopts using netirq= and netport= */ 
 /* ne2k, ne2k.c */ 
 #define NE2K_PORT	0x300
@@ -118,7 +127,7 @@
 #define HD1_PORT	0x1f0
 #define HD2_PORT	0x170
 #define HD_IRQ		5		/* missing request_irq call*/
-#define HD1_AT_IRQ	14		/* missing request_irq call*/
+#define HD1_AT_IRQ	14
 #define HD2_AT_IRQ	15		/* missing request_irq call*/
 
 /* direct floppy driver, directfd.c */
@@ -5,9 +5,12 @@
 #include <linuxmt/init.h>
 
 extern byte_t sys_caps;		/* system capabilities bits*/
+extern byte_t memcpy_dwords;	/* fmemcpy uses 32-bit moves*/
 
 extern void INITPROC setup_arch(seg_t *,seg_t *);
 extern void hard_reset_now(void);
 extern void apm_shutdown_now(void);
+extern void INITPROC apm_init(void);
+extern void idle_cpu(void);
 
 #endif
@@ -29,6 +29,10 @@
 					   should use this drive number to
 					   figure out the correct root
 					   device */
+#define EF_LZ_SYS	0x04		/* says that the kernel is LZ
+					   compressed by build -z, and
+					   setup decompresses it to SYSSEG:0
+					   to sys_usize paragraphs */
 
 /* If we are not building the (dummy) boot sector (elks/elks/arch/i86/boot/
    {bootsect.S, netbootsect.S}) at the start of /linux, then define
@@ -49,7 +53,8 @@
 #define elks_magic	0x1e6		/* long "ELKS" (45 4c 4b 53) checked by bootsect.S*/
 #define setup_sects	0x1f1		/* byte 512-byte sectors used by setup.S*/
 #define syssize		0x1f4		/* word paragraph kernel size used by setup.S*/
-#define elks_flags	0x1f6		/* byte ELKS flags, BLOB and BIOS_DRV*/
+#define elks_flags	0x1f6		/* byte ELKS flags, BLOB, BIOS_DRV and LZ_SYS*/
+#define sys_usize	0x1f8		/* word paragraph uncompressed kernel size if LZ_SYS*/
 #define root_dev	0x1fc		/* word BIOS drive or kdev_t ROOT_DEV*/
 #define boot_flag	0x1fe		/* word constant AA55h*/
 #endif
@@ -15,6 +15,9 @@ extern int chq_wait_wr(register struct ch_queue *,int);
 extern int chq_wait_rd(register struct ch_queue *,int);
 extern void chq_addch(register struct ch_queue *,unsigned char);
 extern void chq_addch_nowakeup(register struct ch_queue *,unsigned char);
+extern int chq_addbuf(register struct ch_queue *,char *,int);
+extern int chq_getbuf(register struct ch_queue *,char *,int);
+extern void chq_skip(register struct ch_queue *,int);
 extern int chq_peekch(register struct ch_queue *);
 extern int chq_getch(register struct ch_queue *);
 /*extern int chq_full(register struct ch_queue *);*/
@@ -19,8 +19,9 @@
 #define O_NONBLOCK	 04000
 #define O_NDELAY	O_NONBLOCK
 
+#define O_SYNC		010000	/* fsync after each write */
+
 #if UNUSED
-#define O_SYNC		010000	/* Not supported */
 #define FASYNC		020000	/* Not supported */
 #endif
 
@@ -35,6 +36,8 @@
 
 #define F_SETOWN	8	/*  for sockets. */
 #define F_GETOWN	9	/*  for sockets. */
+#define F_SETPIPE_SZ	10	/* set pipe buffer size */
+#define F_GETPIPE_SZ	11	/* get pipe buffer size */
 
 /* for F_[GET|SET]FL */
 #define FD_CLOEXEC	1	/* actually anything with low bit set goes */
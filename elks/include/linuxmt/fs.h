@@ -38,6 +38,10 @@
 #include <linuxmt/romfs_fs.h>
 #endif
 
+#ifdef CONFIG_TMPFS_FS
+#include <linuxmt/tmpfs_fs.h>
+#endif
+
 #endif /* __KERNEL__ */
 
 #define BLOCK_SIZE      1024
@@ -68,6 +72,7 @@
 #define FST_MINIX       1
 #define FST_MSDOS       2
 #define FST_ROMFS       3
+#define FST_TMPFS       4
 
 /*
  * These are the fs-independent mount-flags: up to 16 flags are supported
@@ -79,6 +84,8 @@
 #define MS_SYNCHRONOUS     16   /* writes are synced at once */
 #define MS_REMOUNT         32   /* alter flags of a mounted FS */
 #define MS_AUTOMOUNT       64   /* auto mount based on superblock */
+#define MS_NOATIME       1024   /* don't update access times */
+#define MS_RELATIME      2048   /* update access times only if older than change */
 
 #define S_APPEND          256   /* append-only file */
 #define S_IMMUTABLE       512   /* immutable file */
@@ -86,7 +93,7 @@
 /*
  * Flags that can be altered by MS_REMOUNT
  */
-#define MS_RMT_MASK (MS_RDONLY)
+#define MS_RMT_MASK (MS_RDONLY|MS_NOATIME|MS_RELATIME)
 
 #ifdef __KERNEL__
 
@@ -114,6 +121,9 @@
 
 struct buffer_head {
     char                        *b_data;    /* Address if in L1 buffer area, else 0 */
+#ifdef CONFIG_FS_BUFFER_HASH
+    struct buffer_head          *b_next_hash; /* (dev, blocknr) hash chain, kept near */
+#endif
 #ifdef CONFIG_FAR_BUFHEADS
 };
 /* a little tricky here - buffer_head is split into near and far components */
@@ -127,6 +137,10 @@ struct ext_buffer_head_s {
     unsigned char               b_locked;
     unsigned char               b_dirty;
     unsigned char               b_uptodate;
+    struct inode                *b_inode;   /* file of a data buffer, for fsync */
+#ifdef CONFIG_FS_FLUSHER
+    unsigned int                b_dirtytime; /* low word of jiffies when dirtied */
+#endif
 #ifdef CONFIG_FS_EXTERNAL_BUFFER
     ramdesc_t                   b_L2seg;    /* EXT seg:0 or XMS linear addr of L2 */
     char                        b_mapcount; /* count of L2 buffer mapped into L1 */
@@ -151,8 +165,13 @@ typedef struct buffer_head      ext_buffer_head;
 #define EBH(bh)         (bh)
 
 /* macros for buffer_head pointers called outside of buffer.c */
+#ifdef CONFIG_FS_FLUSHER
+void mark_buffer_dirty(struct buffer_head *bh);
+void mark_buffer_clean(struct buffer_head *bh);
+#else
 #define mark_buffer_dirty(bh)   ((bh)->b_dirty = 1)
 #define mark_buffer_clean(bh)   ((bh)->b_dirty = 0)
+#endif
 #define buffer_count(bh)        ((bh)->b_count)
 #define buffer_blocknr(bh)      ((bh)->b_blocknr)
 #define buffer_dev(bh)          ((bh)->b_dev)
@@ -163,6 +182,7 @@ typedef struct buffer_head      ext_buffer_head;
 #define BLOCK_WRITE     1
 
 void brelse(struct buffer_head *);
+void mark_buffer_dirty_inode(struct buffer_head *, struct inode *);
 void bforget(struct buffer_head *);
 void wait_on_buffer (struct buffer_head *);
 void lock_buffer (struct buffer_head *);
@@ -188,6 +208,7 @@ struct inode {
     struct super_block          *i_sb;
     struct inode                *i_next;
     struct inode                *i_prev;
+    struct inode                *i_hash;        /* (dev, ino) hash chain */
     struct inode                *i_mount;
     unsigned short              i_count;
     unsigned short              i_flags;
@@ -216,6 +237,9 @@ struct inode {
 #ifdef CONFIG_ROMFS_FS
                 struct romfs_inode_info romfs;
 #endif
+#ifdef CONFIG_TMPFS_FS
+                struct tmpfs_inode_info tmpfs_i;
+#endif
 #ifdef CONFIG_SOCKET
                 struct socket socket_i;
 #endif
@@ -233,6 +257,9 @@ struct file {
     unsigned short              f_count;
     struct inode                *f_inode;
     struct file_operations      *f_op;
+#ifdef CONFIG_FS_READAHEAD
+    block_t                     f_ranext;   /* next block of a sequential read */
+#endif
 };
 
 struct super_block {
@@ -260,6 +287,9 @@ struct super_block {
 #endif
 #ifdef CONFIG_ROMFS_FS
                 struct romfs_super_info romfs;
+#endif
+#ifdef CONFIG_TMPFS_FS
+                struct tmpfs_sb_info tmpfs_sb;
 #endif
                 void * generic_sbp;
     } u;
@@ -406,6 +436,7 @@ extern struct file_operations read_pipe_fops;
 extern struct file_operations write_pipe_fops;
 extern struct file_operations rdwr_pipe_fops;
 extern struct inode_operations pipe_inode_operations;
+extern int pipe_fcntl(struct inode *,unsigned int,unsigned int);
 
 #ifdef CONFIG_SOCKET
 extern struct inode_operations sock_inode_operations;
@@ -421,6 +452,8 @@ extern struct super_block super_blocks[];
 extern void invalidate_inodes(kdev_t);
 extern void invalidate_buffers(kdev_t);
 extern void sync_inodes(kdev_t);
+extern void write_inode(struct inode *);
+extern int fsync_inode(struct inode *);
 extern void sync_dev(kdev_t);
 extern void fsync_dev(kdev_t);
 extern void sync_supers(kdev_t);
@@ -436,6 +469,8 @@ extern void iput(struct inode *);
 
 extern struct inode *new_inode(struct inode *dir, __u16 mode);
 extern void clear_inode(struct inode *);
+extern void update_atime(struct inode *);
+extern void insert_inode_hash(struct inode *);
 extern int open_filp(unsigned short, struct inode *, struct file **);
 extern void close_filp(struct inode *, struct file *);
 
@@ -445,8 +480,32 @@ extern struct buffer_head *getblk32(kdev_t,block32_t);
 extern struct buffer_head *readbuf(struct buffer_head *);
 
 extern void ll_rw_blk(int,struct buffer_head *);
+extern void ll_rw_block(int,int,struct buffer_head **);
+extern void block_readahead(struct inode *,block_t,block_t);
+extern void block_readahead32(kdev_t,block32_t,block32_t);
+extern void block_readahead_list(kdev_t,block_t *,int);
+extern void flusher_task(void);
+extern void wake_flusher(void);
+extern int defer_put_inode(struct inode *);
+extern void put_deferred_inodes(void);
 extern int get_sector_size(kdev_t dev);
 
+#ifdef CONFIG_FS_DCACHE
+struct dcache_stats;
+extern unsigned int dcache_gen;
+extern int dcache_lookup(struct inode *,const char *,size_t,ino_t *);
+extern void dcache_add(struct inode *,const char *,size_t,ino_t,unsigned int);
+extern void dcache_remove(struct inode *,const char *,size_t);
+extern void dcache_inval(kdev_t,ino_t);
+extern void dcache_get_stats(struct dcache_stats *);
+#else
+#define dcache_gen                          0
+#define dcache_lookup(dir,name,len,ino)     0
+#define dcache_add(dir,name,len,ino,gen)
+#define dcache_remove(dir,name,len)
+#define dcache_inval(dev,dir)
+#endif
+
 extern struct super_block *get_super(kdev_t);
 extern void put_super(kdev_t);
 extern int do_umount(kdev_t);
@@ -466,6 +525,7 @@ extern void brelseL1(struct buffer_head *bh, int copyout);
 extern void brelseL1_index(int i, int copyout);
 ramdesc_t buffer_seg(struct buffer_head *bh);
 extern char *buffer_data(struct buffer_head *);
+extern void buffer_get(struct buffer_head *bh, size_t offset, void *dst, size_t count);
 #else
 #define map_buffer(bh)
 #define unmap_buffer(bh)
@@ -474,13 +534,20 @@ extern char *buffer_data(struct buffer_head *);
 #define brelseL1(bh,copyout)
 #define buffer_data(bh)  ((bh)->b_data)
 #define buffer_seg(bh)   (kernel_ds)
+#define buffer_get(bh,offset,dst,count) memcpy((dst), (bh)->b_data + (offset), (count))
 #endif
 
 extern size_t block_read(struct inode *,struct file *,char *,size_t);
 extern size_t block_write(struct inode *,struct file *,char *,size_t);
 
 #ifdef CONFIG_EXEC_COMPRESS
-extern size_t decompress(char *buf, seg_t seg, size_t orig_size, size_t compr_size, int safety);
+#define DECOMP_SAFETY   16      /* gap between in place decompression stream and output */
+extern size_t decompress(char *buf, seg_t seg, size_t orig_size, size_t compr_size,
+    const unsigned char *head);
+#endif
+#if defined(CONFIG_EXEC_COMPRESS) || defined(CONFIG_ROMFS_COMPRESS)
+extern char *lz_decompress(char *out, char *in, char *end, seg_t seg);
+extern char *lz_decompress_far(char *out, seg_t outseg, char *in, seg_t inseg, char *end);
 #endif
 
 #ifdef CONFIG_BLK_DEV_FD
@@ -23,6 +23,8 @@
 #define HEAP_TAG_INTHAND 0x04
 #define HEAP_TAG_BUFHEAD 0x05
 #define HEAP_TAG_PIPE    0x06
+#define HEAP_TAG_EXEC    0x07	/* exec relocation buffer*/
+#define HEAP_TAG_SOCK    0x08	/* unix socket buffer*/
 
 
 // TODO: move free list node from header to body
@@ -50,8 +52,10 @@ void heap_free (void * data);
 void heap_add (void * data, word_t size);
 void heap_init ();
 
-#ifdef HEAP_DEBUG
 void heap_iterate (void (* cb) (heap_s * h));
+
+#ifdef HEAP_DEBUG
+void heap_dump (void);
 #endif /* HEAP_DEBUG */
 
 #endif
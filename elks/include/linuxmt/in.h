@@ -16,4 +16,9 @@ struct sockaddr_in {
 #define INADDR_NONE     ((unsigned long) 0xffffffff)
 #define INADDR_LOOPBACK ((unsigned long) 0x7f000001)
 
+#define IPPROTO_TCP	6
+
+/* for setsockopt(2) at level IPPROTO_TCP */
+#define TCP_NODELAY	1	/* disable Nagle small write coalescing*/
+
 #endif
@@ -27,6 +27,7 @@ extern void INITPROC inode_init(void);
 extern void INITPROC irq_init(void);
 extern void save_timer_irq(void);
 extern void INITPROC mm_init(seg_t,seg_t);
+extern void INITPROC swap_init(void);
 extern void INITPROC seg_add(seg_t start, seg_t end);
 extern void INITPROC sched_init(void);
 extern void INITPROC serial_init(void);
@@ -56,6 +57,7 @@ extern void romflash_init(void);
 extern void INITPROC chr_dev_init(void);
 extern void INITPROC cgatext_init(void);
 extern void INITPROC eth_init(void);
+extern void INITPROC eth_probe(void);
 extern void INITPROC ne2k_drv_init(void);
 extern void INITPROC el3_drv_init(void);
 extern void INITPROC wd_drv_init(void);
@@ -65,7 +67,20 @@ extern void INITPROC meta_init(void);
 extern void INITPROC pty_init(void);
 extern void INITPROC tcpdev_init(void);
 
-extern void kfork_proc(void (*addr)());
+extern struct task_struct *kfork_proc(void (*addr)());
 extern void arch_setup_user_stack(struct task_struct *, word_t entry);
 
+/*
+ * Boot time profile, set by /bootopts bootprof. INITCALL runs an init
+ * routine and prints the time it took, callers include sched.h.
+ */
+extern int boot_profile;
+extern void INITPROC init_profile(const char *name, jiff_t start);
+#define INITCALL(fn)    do { jiff_t __start = jiffies; fn; \
+                             init_profile(#fn, __start); } while (0)
+
+/* NIC probes deferred to a kernel task by /bootopts deferprobe */
+extern int boot_defer;
+extern void wait_deferred_probes(void);
+
 #endif
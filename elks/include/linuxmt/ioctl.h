@@ -5,6 +5,22 @@
 
 /* Block device generic driver operations */
 #define IOCTL_BLK_GET_SECTOR_SIZE 0x0330    /* ioctl get drive sector size */
+#define IOCTL_BLK_GET_CACHE_STATS 0x0331    /* ioctl get track cache statistics */
+
+struct blk_cache_stats {
+    unsigned int tries;                     /* track cache lookups */
+    unsigned int hits;                      /* track cache hits */
+    unsigned int entries;                   /* number of cached tracks */
+};
+
+/* Pseudo tty master operations */
+#define IOCTL_PTY_SETQ          0x0201  /* set slave queue sizes, arg struct pty_qsize */
+#define IOCTL_PTY_GETQ          0x0202  /* get slave queue sizes */
+
+struct pty_qsize {
+    unsigned int inq;                       /* slave input queue, 0 for default */
+    unsigned int outq;                      /* slave output queue, 0 for default */
+};
 
 /* Ethernet generic driver operations */
 #define IOCTL_ETH_ADDR_GET      0x0901
@@ -13,5 +29,7 @@
 #define IOCTL_ETH_GETSTAT       0x0904  /* get error stats from NIC */
 #define IOCTL_ETH_OFWSKIP_SET   0x0906  /* Set # of packets to skip on buffer overflow */
 #define IOCTL_ETH_OFWSKIP_GET   0x0905  /* get current overrflow skip value */
+#define IOCTL_ETH_RXBATCH       0x0907  /* read returns all queued packets if arg != 0 */
+#define IOCTL_ETH_WRITEV        0x0908  /* send several frames, arg struct eth_writev */
 
 #endif
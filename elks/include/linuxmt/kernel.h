@@ -31,6 +31,26 @@ extern void panic(const char *, ...) wontreturn;
 extern void printk(const char *, ...) printfesque(1);
 extern void early_putchar(int);
 
+/* printk log levels, lines below console_loglevel are shown on the console */
+#define KERN_ERR        "<3>"
+#define KERN_WARNING    "<4>"
+#define KERN_NOTICE     "<5>"
+#define KERN_INFO       "<6>"
+#define KERN_DEBUG      "<7>"
+#define DEFAULT_MSGLEVEL        4       /* printk without a level */
+#define DEFAULT_CONSOLE_LOGLEVEL 7      /* KERN_DEBUG only logged */
+
+extern int console_loglevel;
+extern int klog_async;
+extern void klog_flush(void);
+extern int klog_drain(int count);
+extern void klog_tick(void);
+
+struct inode;
+struct file;
+extern size_t klog_read(struct inode *, struct file *, char *, size_t);
+extern int klog_ioctl(struct inode *, struct file *, int, char *);
+
 extern int wait_for_keypress(void);
 extern int in_group_p(gid_t);
 
@@ -5,6 +5,8 @@
 
 /* kernel */
 #define MAX_TASKS       16      /* Max # processes */
+#define PIDHASH_SIZE    16      /* pid hash buckets, power of 2 */
+#define SCTRACE_ENTRIES 64      /* syscall latency trace ring, power of 2 */
 
 #ifdef CONFIG_ARCH_PC98
 #define KSTACK_BYTES    740     /* Size of kernel stacks for PC-98 */
@@ -20,10 +22,26 @@
 
 #define KSTACK_GUARD    100     /* bytes before CHECK_KSTACK overflow warning */
 
-#define POLL_MAX        6       /* Maximum number of polled queues per process */
+#define POLL_MAX        6       /* Maximum number of polled queues per process (<= 8) */
+#define NR_PRIO         4       /* Number of scheduler run queue levels for nice */
+#define PRIO_STARVE     16      /* Run lowest level at least every N task switches */
+#define TIMER_WHEEL     64      /* Timer wheel buckets, must be power of 2 */
 
 /* buffers */
 #define NR_MAPBUFS      8       /* Number of internal L1 buffers */
+#define MAX_SWAP_KB     2048    /* Max size of XMS swap area */
+#define NR_READAHEAD    4       /* Default read-ahead window in blocks */
+#define MAX_READAHEAD   16      /* Max read-ahead window in blocks */
+#define FLUSH_INTERVAL  5       /* Seconds between write-behind flusher passes */
+#define FLUSH_AGE       30      /* Default age in seconds before dirty buffer written */
+
+/* filesystem */
+#define NR_DCACHE       24      /* Number of directory lookup cache entries */
+#define DCACHE_NAMELEN  14      /* Max name length cached in directory lookup cache */
+
+/* exec */
+#define NR_TEXTCACHE    6       /* Number of code segments kept after program exit */
+#define RELOC_BUFSIZ    512     /* Size of exec relocation read buffer */
 
 #ifdef CONFIG_ASYNCIO
 #define NR_REQUEST      15      /* Number of async I/O request headers */
@@ -38,11 +56,18 @@
 #define NR_SUPER        6       /* Max mounts */
 
 #define PIPE_BUFSIZ     80      /* doesn't have to be power of two */
+#define PIPE_MAX_NEAR   512     /* larger pipe buffers are allocated from main memory */
+#define PIPE_MAX_BUFSIZ 16384   /* max size settable with F_SETPIPE_SZ */
+
+#define UN_BUFSIZ       64      /* default unix socket receive buffer */
+#define UN_MAX_NEAR     512     /* larger unix socket buffers are allocated from main memory */
+#define UN_MAX_BUFSIZ   16384   /* max size settable with SO_RCVBUF */
 
 #define MAXNAMLEN       26      /* Max filename, 14 for MINIX, 26 for FAT (not tunable) */
 
 #define NR_ALARMS       5       /* Max number of simultaneous alarms system-wide */
 
 #define MAX_PACKET_ETH 1536     /* Max packet size, 6 blocks of 256 bytes */
+#define ETH_RING_SIZE  8192     /* Per NIC receive ring in far memory, bytes */
 
 #endif /* !__LINUXMT_LIMITS_H */
@@ -13,6 +13,11 @@
 #define LP_EXIST	0x01
 #define LP_BUSY		0x04
 
+/* output queue state flags */
+
+#define LP_SENDING	0x01	/* characters being sent, see lp_output */
+#define LP_REPORTED	0x02	/* printer problem already reported */
+
 /* define offsets from base port address for status and control port */
 
 #define STATUS		1
@@ -22,6 +27,7 @@
 
 #define LP_STATUS(p)	inb_p(p->io + STATUS)
 
+#define LP_NOTBUSY	0x80
 #define LP_OUTOFPAPER	0x20
 #define LP_SELECTED	0x10
 #define LP_ERROR	0x08
@@ -31,6 +37,7 @@
 #define LP_CONTROL(val, p)	\
 	outb_p((unsigned char) (val), (void *) ((p)->io + CONTROL));
 
+#define LP_INTR		0x10	/* interrupt on acknowledge */
 #define LP_SELECT	0x08
 #define LP_INIT		0x04
 #define LP_STROBE	0x01
@@ -45,6 +52,12 @@
 #define LP_CHAR_WAIT	100
 #define LP_STROBE_WAIT	50
 
+/* output queue */
+#define LP_BUFSIZE	256
+#define LP_TICK_CHARS	64	/* most characters sent per timer tick */
+#define LP_WATCHDOG	(HZ/10)	/* timer interval when interrupt driven */
+#define LP_RETRY	HZ	/* timer interval while printer has a problem */
+
 /* defines max number of ports */
 #ifndef BIOS_PORTS
 
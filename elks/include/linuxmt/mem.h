@@ -9,10 +9,165 @@
 #define MEM_GETHEAP	7
 #define MEM_GETUPTIME	8
 #define MEM_GETFARTEXT  9
+#define MEM_GETDCACHE   10
+#define MEM_COMPACT     11
+#define MEM_GETHEAPSTAT 12
+#define MEM_GETKSTAT    13
+#define MEM_PROFSTART   14
+#define MEM_PROFSTOP    15
+#define MEM_GETPROF     16
+#define MEM_SCTRACE     17
+#define MEM_COPYBENCH   18
+#define MEM_GETSYSCNT   19
+#define MEM_GETPROCS    20
+#define MEM_SETLOGLEVEL 21
+
+/*
+ * Kernel log, read from /dev/kmsg. Each line starts with a byte
+ * KLOG_MARK + level, lines of level >= the console level set by
+ * MEM_SETLOGLEVEL are not shown on the console.
+ */
+#define KLOG_MARK	0x10
+#define KLOG_ISMARK(c)	((unsigned char)((c) - KLOG_MARK) < 8)
+
+/* MEM_GETSYSCNT copies one unsigned long per syscall number, returns count*/
+#define SYSCNT_MAX	256
 
 struct mem_usage {
 	unsigned int free_memory;
 	unsigned int used_memory;
+	unsigned int largest_free;	/* largest free segment in KB */
+	unsigned int free_blocks;	/* number of free segments */
+};
+
+struct dcache_stats {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned int entries;
+};
+
+/* kernel local heap usage by block tag type, index 0 is free*/
+#define HEAP_STAT_TYPES	16
+
+struct heap_stats {
+	unsigned int count[HEAP_STAT_TYPES];	/* number of blocks*/
+	unsigned int size[HEAP_STAT_TYPES];	/* total bytes excluding headers*/
+	unsigned int largest_free;		/* largest free block*/
+};
+
+/* kernel-wide event counters, always maintained*/
+#define KSTAT_IRQS	16
+#define KSTAT_BLKDEV	8			/* indexed by block major*/
+
+struct kernel_stats {
+	unsigned long context_switches;		/* schedule() task changes*/
+	unsigned long irqs[KSTAT_IRQS];		/* interrupts handled per IRQ*/
+	unsigned long buffer_hits;		/* bread found block uptodate*/
+	unsigned long buffer_misses;		/* bread had to read block*/
+	unsigned long buffer_maps;		/* L2 buffer mapped into L1*/
+	unsigned long buffer_remaps;		/* mapped buffer found in L1*/
+	unsigned long buffer_unmaps;		/* L2 buffer unmapped from L1*/
+	unsigned long blk_reads[KSTAT_BLKDEV];	/* blocks read per major*/
+	unsigned long blk_writes[KSTAT_BLKDEV];	/* blocks written per major*/
+	unsigned long track_tries;		/* BIOS track cache lookups*/
+	unsigned long track_hits;		/* BIOS track cache hits*/
+};
+
+/*
+ * Copy bandwidth in KB/s of the kernel memory copy routines, measured by
+ * repeating size byte copies between the kernel and buf or a far segment.
+ */
+#define COPYBENCH_MAX	1024			/* largest size*/
+
+struct copy_bench {
+	char *buf;				/* in: user buffer of size bytes*/
+	unsigned int size;			/* in: bytes per copy*/
+	unsigned long fmemcpy;			/* out: fmemcpyb, even destination*/
+	unsigned long fmemcpy_odd;		/* out: fmemcpyb, odd destination*/
+	unsigned long tofs;			/* out: memcpy_tofs*/
+	unsigned long fromfs;			/* out: memcpy_fromfs*/
+};
+
+/*
+ * Process table snapshot returned by MEM_GETPROCS, one record per task in
+ * use, taken in a single call so ps needn't read the task table through
+ * /dev/kmem. cmd holds the command line arguments separated by spaces.
+ */
+#define PROC_CMDLEN	40
+
+#define PROC_SWAPPED	0x01			/* data segment swapped out*/
+
+struct proc_snap {
+	unsigned int pid;
+	unsigned int pgrp;
+	unsigned int ppid;
+	unsigned int uid;
+	unsigned char state;			/* TASK_RUNNING etc*/
+	unsigned char prio;			/* run queue level*/
+	signed char nice;
+	unsigned char flags;			/* PROC_SWAPPED*/
+	int tty;				/* tty minor, -1 if none*/
+	unsigned int cseg, dseg;		/* segment bases, 0 if none*/
+	unsigned int csize, dsize;		/* segment sizes in paragraphs*/
+	unsigned int heap;			/* bytes in heap*/
+	unsigned int stack_free;		/* bytes between heap and stack*/
+	unsigned long cpu;			/* fixed point CPU %, CONFIG_CPU_USAGE*/
+	char cmd[PROC_CMDLEN];
+};
+
+struct proc_list {
+	struct proc_snap *procs;		/* in: user array*/
+	unsigned int max;			/* in: number of records*/
 };
 
+/*
+ * Sampling profiler. Each timer tick the interrupted CS:IP is counted in
+ * a histogram of 16-bit buckets, one array per region, held in a main
+ * memory segment that is read through /dev/kmem.
+ */
+#define PROF_KTEXT	0			/* kernel .text*/
+#define PROF_KFTEXT	1			/* kernel .fartext*/
+#define PROF_USER	2			/* code of profiled process*/
+#define PROF_REGIONS	3
+
+struct prof_ctl {
+	unsigned int shift;			/* log2 bytes per bucket, 0 frees*/
+	unsigned int pid;			/* process to profile, 0 for none*/
+};
+
+struct prof_stats {
+	unsigned int seg;			/* histogram segment, 0 if none*/
+	unsigned int shift;			/* log2 bytes per bucket*/
+	unsigned int buckets;			/* buckets per region*/
+	unsigned int pid;			/* profiled process*/
+	unsigned int running;			/* sampling enabled*/
+	unsigned int cs[PROF_REGIONS];		/* code segment of each region*/
+	unsigned long samples[PROF_REGIONS];	/* samples counted per region*/
+	unsigned long other;			/* samples outside all regions*/
+};
+
+/*
+ * System call latency trace, read from /dev/sctrace as an array of
+ * struct sctrace_ent. Times are in timer counts, ticks_per_jiffy per jiffy.
+ */
+struct sctrace_ent {
+	unsigned int callno;			/* system call number*/
+	unsigned int pid;			/* calling process*/
+	unsigned long jiffies;			/* entry time*/
+	unsigned int count;			/* timer counts into entry jiffy*/
+	int retval;				/* return value*/
+	unsigned long duration;			/* timer counts entry to return*/
+};
+
+struct sctrace_ctl {
+	unsigned int enable;			/* in: start or stop tracing*/
+	unsigned int lost;			/* out: entries overwritten unread*/
+	unsigned int ticks_per_jiffy;		/* out: timer counts per jiffy*/
+	unsigned int usecs_per_jiffy;		/* out: microseconds per jiffy*/
+};
+
+#ifdef __KERNEL__
+extern struct kernel_stats kstat;
+#endif
+
 #endif
@@ -41,9 +41,12 @@ int verify_a20(void);		/* returns 0 if a20 disabled */
 #ifdef CONFIG_FS_XMS_BUFFER
 typedef __u32 ramdesc_t;	/* special physical ram descriptor */
 
+extern int xms_enabled;		/* set when XMS usable by xms_fmemcpyw */
+
 /* allocate from XMS memory */
 int xms_init(void);		/* enables unreal mode and A20 gate */
 ramdesc_t xms_alloc(long_t size);
+void __far *hma_alloc(size_t size);	/* allocate from high memory area at init */
 
 /* copy to/from XMS or far memory - XMS requires unreal mode and A20 gate enabled */
 void xms_fmemcpyw(void *dst_off, ramdesc_t dst_seg, void *src_off, ramdesc_t src_seg,
@@ -62,6 +65,7 @@ void linear32_fmemset(void *dst_off, addr_t dst_seg, byte_t val, size_t count);
 #else
 
 typedef seg_t ramdesc_t;	/* ramdesc_t is just a regular segment descriptor */
+#define xms_enabled	0
 #define xms_fmemcpyw	fmemcpyw
 #define xms_fmemcpyb	fmemcpyb
 #define xms_fmemset     fmemsetb
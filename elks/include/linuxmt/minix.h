@@ -49,9 +49,11 @@ struct elks_supl_hdr {
     unsigned short	esh_compr_tseg;	/* compressed tseg size */
     unsigned short	esh_compr_dseg;	/* compressed dseg size* */
     unsigned short	esh_compr_ftseg;/* compressed ftseg size*/
-    unsigned short	esh_reserved;
+    unsigned short	esh_compr_flags;	/* compression format */
 };
 
+#define ESH_COMPR_LZ	0x0001	/* sections are LZ, not exomizer compressed */
+
 struct minix_reloc {
     unsigned long	r_vaddr;	/* address of place within section */
     unsigned short	r_symndx;	/* index into symbol table */	// 0x04
@@ -60,6 +62,8 @@ struct minix_reloc {
 
 /* r_type values */
 #define R_SEGWORD	80
+#define R_SEGRUN	81	/* r_vaddr bits 16-31 = n further places, then (n+7)/8
+				   records of byte deltas from each place to the next */
 
 /* special r_symndx values */
 #define S_ABS		((unsigned short)-1U)
@@ -36,6 +36,11 @@ struct inode;
 
 struct minix_inode_info {
     __u16	i_zone[9];
+    /* bmap cache: run of contiguous zones from the last indirect block read */
+    __u16	i_run_block;	/* first file block of run */
+    __u16	i_run_zone;	/* its zone */
+    __u16	i_run_count;	/* zones in run, 0 if none */
+    __u16	i_diroff;	/* directory: entry after last found, lookups start here */
 };
 
 /*  This is the original minix inode layout on disk.
@@ -72,6 +77,14 @@ struct minix_dir_entry {
     char	name[];
 };
 
+#ifdef __KERNEL__
+/* zone frees gathered by truncate, see minix_free_zone() */
+struct minix_zfree {
+    struct buffer_head	*bh;	/* mapped zone bitmap block */
+    unsigned int	map;	/* its index in s_zmap */
+};
+#endif
+
 #ifdef __KERNEL__
 
 extern unsigned short minix_bmap(register struct inode *,block_t,int);
@@ -79,9 +92,12 @@ extern struct buffer_head *minix_bread(struct inode *,block_t,int);
 extern struct buffer_head *get_map_block(kdev_t dev, block_t block);
 extern unsigned short minix_count_free_blocks(register struct super_block *);
 extern unsigned short minix_count_free_inodes(register struct super_block *);
+extern void minix_init_free_counts(register struct super_block *);
 extern int minix_create(register struct inode *,char *,size_t,int,
 			struct inode **);
 extern void minix_free_block(register struct super_block *,block_t);
+extern void minix_free_zone(struct super_block *,struct minix_zfree *,block_t);
+extern void minix_free_zones_done(struct minix_zfree *);
 extern void minix_free_inode(register struct inode *);
 extern struct buffer_head *minix_getblk(register struct inode *,block_t,int);
 extern int minix_link(register struct inode *,char *,size_t,
@@ -90,7 +106,7 @@ extern int minix_lookup(register struct inode *,const char *,size_t,
 			register struct inode **);
 extern int minix_mkdir(register struct inode *,char *,size_t,int);
 extern int minix_mknod(register struct inode *,char *,size_t,int,int);
-extern block_t minix_new_block(register struct super_block *);
+extern block_t minix_new_block(register struct super_block *,block_t);
 extern struct inode *minix_new_inode(struct inode *,__u16);
 /*extern void minix_put_inode(register struct inode *);*/
 extern void minix_put_super(register struct super_block *);
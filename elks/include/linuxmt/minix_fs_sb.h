@@ -19,6 +19,9 @@ struct minix_sb_info {
     unsigned short		s_dirsize;
     unsigned short		s_namelen;
     unsigned short		s_mount_state;
+    unsigned short		s_zone_hint;	/* zmap bit to start next block search */
+    unsigned short		s_free_zones;	/* cached count of free zones */
+    unsigned short		s_free_inodes;	/* cached count of free inodes */
 };
 
 #endif
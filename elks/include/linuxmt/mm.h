@@ -20,16 +20,27 @@ typedef struct segment segment_s;
 #define SEG_FLAG_FREE    0x00
 #define SEG_FLAG_USED	 0x80
 #define SEG_FLAG_ALIGN1K 0x40
+#define SEG_FLAG_FIXED	 0x20	/* holds relocated segment values, never moved */
+#define SEG_FLAG_SWAPPED 0x10	/* contents in swap area, base is swap block */
 #define SEG_FLAG_TYPE	 0x0F
 #define SEG_FLAG_CSEG	 0x01
 #define SEG_FLAG_DSEG	 0x02
 #define SEG_FLAG_EXTBUF	 0x03
 #define SEG_FLAG_RAMDSK	 0x04
 #define SEG_FLAG_PROG	 0x05
+#define SEG_FLAG_PIPE	 0x06
+#define SEG_FLAG_SOCK	 0x07
+#define SEG_FLAG_PROF	 0x08
+#define SEG_FLAG_ROM	 0x09	/* in ROM, not part of main memory */
+#define SEG_FLAG_SHM	 0x0A	/* shared memory, see shm.c */
+
+/* seg_alloc request only, not kept in flags */
+#define SEG_FLAG_HIGH	 0x0100	/* prefer upper memory blocks */
 
 #ifdef __KERNEL__
 
 #include <linuxmt/kernel.h>
+#include <linuxmt/kdev_t.h>
 
 /*@-namechecks@*/
 
@@ -63,10 +74,22 @@ void seg_free (segment_s *);
 segment_s * seg_get (segment_s *);
 void seg_put (segment_s *);
 segment_s * seg_dup (segment_s *);
+segment_s * seg_rom (seg_t, segext_t);
 
 void seg_free_pid(pid_t pid);
-
-void mm_get_usage (unsigned int * free, unsigned int * used);
+segext_t seg_compact (void);
+int seg_swap_in (segment_s *);
+
+#ifdef CONFIG_EXEC_TEXTCACHE
+/* fs/exec.c */
+int textcache_shrink(void);
+void textcache_inval(kdev_t dev);
+#else
+#define textcache_inval(dev)
+#endif
+
+struct mem_usage;
+void mm_get_usage (struct mem_usage *);
 
 #endif // __KERNEL__
 #endif // !__LINUXMT_MM_H
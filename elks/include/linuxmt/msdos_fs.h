@@ -18,7 +18,8 @@
 
 #define MSDOS_SUPER_MAGIC 0x4d44 /* MD */
 
-#define FAT_CACHE    8 /* FAT cache size */
+#define FAT_CACHE    16 /* FAT cache size (extents) */
+#define FAT_CACHE_HASH 8 /* FAT cache hash buckets, power of two */
 
 #define ATTR_RO      1  /* read-only */
 #define ATTR_HIDDEN  2  /* hidden */
@@ -99,12 +100,15 @@ struct slot_info {
 	ino_t ino;		       /* ino for the file */
 };
 
+/* A run of clusters contiguous both in the file and on disk */
 struct fat_cache {
 	kdev_t device; /* device number. 0 means unused. */
 	ino_t ino; /* inode number. */
-	cluster_t file_cluster; /* cluster number in the file. */
-	cluster_t disk_cluster; /* cluster number on disk. */
-	struct fat_cache *next; /* next cache entry */
+	cluster_t file_cluster; /* first cluster number in the file. */
+	cluster_t disk_cluster; /* first cluster number on disk. */
+	cluster_t length; /* number of clusters in run. */
+	unsigned int lru; /* last use stamp for replacement */
+	struct fat_cache *next; /* next entry in hash chain */
 };
 
 /* Convert attribute bits and a mask to the UNIX mode. */
@@ -135,10 +139,12 @@ ino_t FATPROC msdos_parent_ino(struct inode *dir,int locked);
 cluster_t FATPROC fat_access(struct super_block *sb,cluster_t this,cluster_t new_value);
 sector_t FATPROC msdos_smap(struct inode *inode, sector_t sector);
 int  FATPROC fat_free(struct inode *inode,long skip);
+void FATPROC fat_sync_mirrors(struct super_block *sb);
 void FATPROC cache_init(void);
 void FATPROC cache_lookup(struct inode *inode,cluster_t cluster,
 	cluster_t *f_clu, cluster_t *d_clu);
-void FATPROC cache_add(struct inode *inode, cluster_t f_clu, cluster_t d_clu);
+void FATPROC cache_add(struct inode *inode, cluster_t f_clu, cluster_t d_clu,
+	cluster_t len);
 void FATPROC cache_inval_inode(struct inode *inode);
 void FATPROC cache_inval_dev(kdev_t device);
 cluster_t FATPROC get_cluster(struct inode *inode, cluster_t cluster);
@@ -160,6 +166,13 @@ extern int msdos_rename(struct inode *old_dir,const char *old_name,int old_len,
 extern void msdos_read_inode(struct inode *inode);
 extern int init_msdos_fs(void);
 
+/* dirhash.c */
+
+int  FATPROC msdos_dirhash_find(struct inode *dir, const char *name, int len,
+	struct buffer_head **bh, ino_t *ino);
+void FATPROC msdos_dirhash_inval(struct inode *dir);
+void FATPROC msdos_dirhash_inval_dev(kdev_t dev);
+
 /* dir.c */
 
 extern struct inode_operations msdos_dir_inode_operations;
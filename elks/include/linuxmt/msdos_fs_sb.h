@@ -12,7 +12,10 @@ struct msdos_sb_info { /* space in struct super_block is 28 bytes */
 	unsigned short data_start;   /* first data sector */
 	unsigned long clusters;      /* number of clusters */
 	unsigned long root_cluster;  /* root directory cluster */
-	long previous_cluster;       /* used in add_cluster */
+	long previous_cluster;       /* next free cluster search start - 2 */
+	long free_clusters;          /* cached free cluster count, -1 if unknown */
+	unsigned short fat_dirty_lo; /* FAT sectors changed since mirrors updated, */
+	unsigned short fat_dirty_hi; /*   lo > hi if none */
 #ifdef CONFIG_FS_DEV
 	ino_t dev_ino;               /* "/dev" ino */
 #endif
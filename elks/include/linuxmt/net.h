@@ -20,8 +20,9 @@ typedef enum {
 
 struct socket {
     unsigned char state;
+    unsigned char type;		/* SOCK_STREAM or SOCK_DGRAM */
     struct wait_queue *wait;
-    unsigned char flags;
+    unsigned short flags;
     unsigned int rcv_bufsiz;
     struct proto_ops *ops;
     struct inode *inode;
@@ -69,6 +70,7 @@ struct proto_ops {
     int (*setsocketopt) ();
     int (*getsocketopt) ();
     int (*fcntl) ();
+    int (*writev) ();		/* optional, gathers iovec in one send */
 };
 
 /* careful: option names are close to public SO_ options in socket.h */
@@ -79,6 +81,8 @@ struct proto_ops {
 #define SF_RST_ON_CLOSE	(1 << 4) /* inet */
 #define SF_REUSE_ADDR	(1 << 5) /* inet */
 #define SF_CONNECT	(1 << 6) /* inet */
+#define SF_WAITREPLY	(1 << 7) /* inet */
+#define SF_NODELAY	(1 << 8) /* inet */
 
 struct net_proto {
     const char *name;		/* Protocol name */
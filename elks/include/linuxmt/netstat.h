@@ -10,6 +10,7 @@
 
 #ifndef __ASSEMBLER__
 #include <linuxmt/types.h>
+#include <linuxmt/uio.h>
 
 /* /bootopts parms for each NIC */
 struct netif_parms {
@@ -38,6 +39,12 @@ struct netif_stat {
 	char  mac_addr[6];	/* Current MAC address */
 };
 
+/* IOCTL_ETH_WRITEV: send several frames in one call */
+struct eth_writev {
+	int	count;		/* number of frames, at most UIO_MAXIOV */
+	struct iovec *iov;	/* one entry per frame */
+};
+
 #endif	/* __ASSEMBLER__ */
 
 /* status flags for if_status */
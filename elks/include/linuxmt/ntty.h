@@ -11,9 +11,12 @@
 
 #define PTYINQ_SIZE	80	/* pty input queue size*/
 #define PTYOUTQ_SIZE	512	/* pty output queue size (=TDB_WRITE_MAX and telnetd buffer)*/
+#define PTYQ_MIN	16	/* IOCTL_PTY_SETQ queue size limits*/
+#define PTYQ_MAX	2048
 
 #define RSINQ_SIZE	1024	/* serial input queue SLIP_MTU+128+8*/
 #define RSOUTQ_SIZE	80	/* serial output queue size*/
+#define RS_FAST_WAKEUP	(RSINQ_SIZE/4)	/* CONFIG_FAST_IRQ wakeup before next tick at this fill*/
 
 /*
  * Note: don't mess with NR_PTYS until you understand the tty minor
@@ -93,6 +96,7 @@ extern int pipe_lseek(struct inode *,struct file *,off_t,int);
 		/* Empty function, returns -ESPIPE. useful */
 
 extern int tty_outproc(register struct tty *);
+extern int tty_outrun(register struct tty *);
 		/* TTY postprocessing */
 
 extern struct termios def_vals;
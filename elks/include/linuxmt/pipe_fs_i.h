@@ -3,11 +3,21 @@
 
 #include <linuxmt/chqueue.h>
 
+/* user buffer posted by a reader sleeping on an empty pipe */
+struct task_struct;
+
+struct pipe_post {
+    char *buf;
+    struct task_struct *task;	/* reader, whose DS may change while asleep */
+    size_t count;
+    size_t done;		/* bytes handed directly to reader by writer */
+};
+
 struct pipe_inode_info {
-    struct ch_queue q;
+    struct ch_queue q;		/* q.base is offset in seg if far buffer */
     unsigned int lock;
-    unsigned int rd_openers;
-    unsigned int wr_openers;
+    struct segment *seg;	/* far buffer segment or NULL if near heap */
+    struct pipe_post *post;	/* sleeping reader awaiting direct handoff */
     unsigned int readers;
     unsigned int writers;
 };
@@ -19,11 +29,14 @@ struct pipe_inode_info {
 #define PIPE_LEN(inode)		((inode)->u.pipe_i.q.len)
 #define PIPE_SIZE(inode)	((inode)->u.pipe_i.q.size)
 #define PIPE_LOCK(inode)	((inode)->u.pipe_i.lock)
-#define PIPE_RD_OPENERS(inode)	((inode)->u.pipe_i.rd_openers)
-#define PIPE_WR_OPENERS(inode)	((inode)->u.pipe_i.wr_openers)
+#define PIPE_SEGMENT(inode)	((inode)->u.pipe_i.seg)
+#define PIPE_POST(inode)	((inode)->u.pipe_i.post)
 #define PIPE_READERS(inode)	((inode)->u.pipe_i.readers)
 #define PIPE_WRITERS(inode)	((inode)->u.pipe_i.writers)
 
+#define PIPE_SEG(inode)		(PIPE_SEGMENT(inode)? PIPE_SEGMENT(inode)->base: kernel_ds)
+#define PIPE_ALLOCATED(inode)	(PIPE_BASE(inode) || PIPE_SEGMENT(inode))
+
 #define PIPE_EMPTY(inode)	(PIPE_LEN(inode) == 0)
 #define PIPE_FULL(inode)	(PIPE_LEN(inode) == PIPE_SIZE(inode))
 #define PIPE_FREE(inode)	(PIPE_SIZE(inode) - PIPE_LEN(inode))
@@ -0,0 +1,18 @@
+#ifndef __LINUXMT_POLL_H
+#define __LINUXMT_POLL_H
+
+/* poll() events and returned events */
+#define POLLIN          0x0001  /* data may be read without blocking */
+#define POLLPRI         0x0002  /* exceptional condition (select errorfds) */
+#define POLLOUT         0x0004  /* data may be written without blocking */
+#define POLLERR         0x0008  /* error, revents only */
+#define POLLHUP         0x0010  /* hung up, revents only */
+#define POLLNVAL        0x0020  /* fd not open, revents only */
+
+struct pollfd {
+    int fd;                     /* file descriptor, ignored if negative */
+    short events;               /* requested events */
+    short revents;              /* returned events */
+};
+
+#endif
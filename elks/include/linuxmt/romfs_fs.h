@@ -37,6 +37,14 @@ struct romfs_inode_mem {
 #define ROMFH_CHR 2
 #define ROMFH_BLK 3
 #define ROMFH_LNK 4
+#define ROMFH_HASH 8  /* directory has a hashed index after its entries */
+#define ROMFH_COMP 16 /* file data is LZ compressed by BLOCK_SIZE blocks */
+
+/* Compressed file data: word offsets of the blocks [count + 1] from the */
+/* start of the data, then the blocks, each stored as is if not smaller. */
+/* Blocks are decompressed into buffers of the mounted device at these */
+/* block numbers, above any the device has. */
+#define ROMFS_ZBLOCK(seg,n) (0x80000000UL | ((block32_t)(seg) << 6) | (n))
 
 struct romfs_super_info {
        word_t ssize;   /* size of superblock */
@@ -46,6 +54,8 @@ struct romfs_super_info {
 
 struct romfs_inode_info {
        word_t seg;     /* inode segment */
+       word_t hash;    /* offset of hashed directory index, 0 if none */
+       word_t comp;    /* file data is compressed */
 };
 
 #endif  /* !_LINUXMT_ROMFS_FS_H */
@@ -56,10 +56,15 @@ struct task_struct {
 
 /* Scheduling + status variables */
     unsigned char               state;
+    signed char                 nice;           /* nice value, NICE_MIN..NICE_MAX */
+    unsigned char               prio;           /* current run queue level */
+    unsigned char               policy;         /* SCHED_OTHER or SCHED_FIFO */
     struct wait_queue           child_wait;
     jiff_t                      timeout;        /* for select() */
+    jiff_t                      sleep_time;     /* jiffies when last went to sleep */
     struct wait_queue           *waitpt;        /* Wait pointer */
     struct wait_queue           *poll[POLL_MAX];  /* polled queues */
+    unsigned char               poll_ready;     /* bitmask of woken poll[] slots */
     struct task_struct          *next_run;
     struct task_struct          *prev_run;
     struct file_struct          files;          /* File system structure */
@@ -67,6 +72,7 @@ struct task_struct {
     struct mm_struct            mm;             /* Memory blocks */
     struct tty                  *tty;
     struct task_struct          *p_parent;
+    struct task_struct          *pid_next;      /* pid hash chain or free slot list */
     int                         exit_status;    /* process exit status*/
     struct inode                *t_inode;
     sigset_t                    signal;         /* Signal status */
@@ -76,6 +82,10 @@ struct task_struct {
     unsigned long               average;        /* fixed point CPU % usage */
     unsigned char               ticks;          /* # jiffies / 2 seconds */
 #endif
+#ifdef CONFIG_SYSCALL_TRACE
+    jiff_t                      sc_jiffies;     /* syscall entry time, 0 if untraced */
+    unsigned int                sc_count;       /* and timer counts into that jiffy */
+#endif
 
 #ifdef CONFIG_SUPPLEMENTARY_GROUPS
 #define NGROUPS     13
@@ -104,6 +114,25 @@ struct task_struct {
 #define TASK_EXITING            6
 #define TASK_UNUSED             7
 
+/* scheduling policies */
+#define SCHED_OTHER             0
+#define SCHED_FIFO              1
+
+/*
+ * Run queue levels, level 0 runs first. SCHED_FIFO tasks have level 0 to
+ * themselves, nice values map to levels 1 to NR_PRIO.
+ */
+#define PRIO_RT                 0
+#define NICE_MIN                (-20)
+#define NICE_MAX                19
+#define nice_to_prio(n)         (1 + ((n) - NICE_MIN) * NR_PRIO / (NICE_MAX - NICE_MIN + 1))
+#define task_prio(p)            ((p)->policy == SCHED_FIFO? PRIO_RT: nice_to_prio((p)->nice))
+
+/* getpriority/setpriority which values */
+#define PRIO_PROCESS            0
+#define PRIO_PGRP               1
+#define PRIO_USER               2
+
 #define DEPRECATED
 //#define DEPRECATED    __attribute__ ((deprecated))
 
@@ -159,8 +188,13 @@ extern int kill_process(pid_t,sig_t,int);
 extern void kill_all(sig_t);
 
 extern void add_to_runqueue(struct task_struct *);
+extern void set_task_nice(struct task_struct *, int);
+extern void set_task_policy(struct task_struct *, int);
+extern unsigned char need_resched;
 
 extern struct task_struct *find_empty_process(void);
+extern void free_task_slot(struct task_struct *);
+extern struct task_struct *find_task_by_pid(pid_t);
 extern void arch_build_stack(struct task_struct *, void (*)());
 extern int restart_syscall(void);
 extern unsigned int get_ustack(struct task_struct *,int);
@@ -0,0 +1,22 @@
+#ifndef __LINUXMT_SHM_H
+#define __LINUXMT_SHM_H
+
+/* shared memory segments */
+
+#define IPC_PRIVATE	0	/* key of a new segment never found by others */
+
+/* shmat flags */
+#define IPC_CREAT	0x0200	/* create the segment if not found */
+#define IPC_EXCL	0x0400	/* fail if found */
+
+#ifdef __KERNEL__
+
+#define NR_SHM		8	/* segments in use at once */
+
+struct task_struct;
+void shm_fork(struct task_struct *parent, struct task_struct *child);
+void shm_exit(struct task_struct *t);
+
+#endif
+
+#endif
@@ -102,6 +102,15 @@ typedef unsigned long sigset_t;	/* at least 32 bits */
 #define SA_INTERRUPT	0x20000000
 #define SA_NOMASK	0x40000000
 #define SA_ONESHOT	0x80000000
+#define SA_NODEFER	SA_NOMASK
+#define SA_RESETHAND	SA_ONESHOT
+
+/*
+ * Or'd into the signal number passed to the signal system call: the handler
+ * stays installed after delivery rather than being reset to the default,
+ * saving the signal call that a handler would otherwise make to re-arm it.
+ */
+#define SIGF_KEEP	0x0100
 
 #ifdef __KERNEL__
 /*
@@ -209,6 +218,8 @@ typedef __attribute__((__stdcall__)) __far void (*__kern_sighandler_t)(int);
  *     or to use the custom handler (which is the same throughout a single
  *     process).  As there are only 3 possible dispositions, the SIGDISP_*
  *     values can be 8-bit or smaller.  -- tkchia 20200512
+ *   * SIGDISP_KEEP is a custom handler that is not reset to SIGDISP_DFL
+ *     when the signal is delivered, set by signal numbers with SIGF_KEEP.
  */
 
 #define SIG_DFL	((sighandler_t) 0)	/* default signal handling */
@@ -224,6 +235,7 @@ typedef unsigned char __sigdisposition_t;
 #define SIGDISP_DFL	((__sigdisposition_t) 0)
 #define SIGDISP_IGN	((__sigdisposition_t) 1)
 #define SIGDISP_CUSTOM	((__sigdisposition_t) 2)
+#define SIGDISP_KEEP	((__sigdisposition_t) 3)
 #endif
 
 /*@end@*/
@@ -55,7 +55,10 @@ struct msghdr {
 #ifdef __KERNEL__
 struct proto_ops;
 struct socket;
+struct inode;
+struct file;
 int sock_register(int,struct proto_ops *);
+int sock_writev(struct inode *inode, struct file *file, struct iovec *iov, int iovcnt);
 int move_addr_to_user(char *,size_t,char *,int *);
 int sock_awaitconn(struct socket *mysock, struct socket *servsock, int flags);
 #endif
@@ -7,6 +7,7 @@
 
 #include <linuxmt/in.h>
 #include <linuxmt/net.h>
+#include <linuxmt/uio.h>
 
 #define TCP_DEVICE_NAME	"tcpdev"
 
@@ -16,7 +17,13 @@
 #define TCPDEV_INBUFFERSIZE	1500	/* max data writable to tcpdev from ktcp*/
 #define TCPDEV_OUTBUFFERSIZE	(TDB_WRITE_MAX + sizeof(struct tdb_write))
 
-#define TCPDEV_MAXREAD TCPDEV_INBUFFERSIZE - sizeof(struct tdb_return_data)
+#define TCPDEV_MAXCHUNK (TCPDEV_INBUFFERSIZE - sizeof(struct tdb_return_data))
+
+/* max data returned by one socket read, sent by ktcp in TCPDEV_MAXCHUNK pieces*/
+#define TCPDEV_MAXREAD		8192
+
+#define TDB_SLOTS		4	/* commands and replies outstanding at once*/
+#define TDB_HDR_MAX		32	/* max tdb command or reply header size*/
 
 /* outgoing ops */
 #define TDC_BIND	1
@@ -26,6 +33,9 @@
 #define TDC_RELEASE	5
 #define TDC_READ	8
 #define TDC_WRITE	9
+#define TDC_SETOPT	10
+#define TDC_SENDTO	11	/* UDP datagram, no reply*/
+#define TDC_RECVFROM	12	/* UDP receive, uses struct tdb_read*/
 
 struct tdb_release {
     unsigned char cmd;
@@ -50,7 +60,9 @@ struct tdb_bind {
     unsigned char cmd;
     struct socket *sock;
     int reuse_addr;
+    int nodelay;
     int rcv_bufsiz;
+    int type;			/* SOCK_STREAM or SOCK_DGRAM*/
     struct sockaddr_in addr;
 };
 
@@ -67,12 +79,29 @@ struct tdb_read {
     int nonblock;
 };
 
+struct tdb_setopt {
+    unsigned char cmd;
+    struct socket *sock;
+    int level;
+    int option;
+    int value;
+};
+
 struct tdb_write {
     unsigned char cmd;
     struct socket *sock;
     int size;
     int nonblock;
-    unsigned char data[TDB_WRITE_MAX];
+    unsigned char data[];	/* up to TDB_WRITE_MAX bytes*/
+};
+
+struct tdb_sendto {
+    unsigned char cmd;
+    struct socket *sock;
+    int size;
+    __u32 addr_ip;		/* network byte order*/
+    __u16 addr_port;
+    unsigned char data[];	/* up to TDB_WRITE_MAX bytes*/
 };
 
 /* incoming (ktcp to kernel) ops */
@@ -82,6 +111,8 @@ struct tdb_write {
 #define TDT_ACCEPT	4
 #define TDT_BIND	5
 #define TDT_CONNECT	6
+#define TDT_WINDOW	7	/* send window opened, retry write*/
+#define TDT_RECVFROM	8	/* UDP datagram with source address*/
 
 struct tdb_return_data {
     char type;
@@ -91,6 +122,17 @@ struct tdb_return_data {
     unsigned char data[];
 };
 
+/* starts as struct tdb_return_data, ret_value is the datagram length*/
+struct tdb_recvfrom_ret {
+    char type;
+    int ret_value;
+    struct socket *sock;
+    int size;
+    __u32 addr_ip;
+    __u16 addr_port;
+    unsigned char data[];
+};
+
 struct tdb_accept_ret {
     char type;
     int ret_value;
@@ -107,7 +149,13 @@ struct tdb_bind_ret {
     __u16 addr_port;
 };
 
-extern void tcpdev_clear_data_avail(void);
+extern int tcpdev_inetwrite(void *cmd, unsigned int hlen, char *udata, unsigned int dlen);
+extern int tcpdev_inetwritev(void *cmd, unsigned int hlen, struct iovec *iov,
+                             unsigned int skip, unsigned int dlen);
+extern struct tdb_return_data *tcpdev_find_reply(struct socket *sock);
+extern void tcpdev_reply_data(struct tdb_return_data *ret, char *ubuf, size_t len);
+extern void tcpdev_clear_data_avail(struct tdb_return_data *ret);
+extern void tcpdev_drop_replies(struct socket *sock);
 extern int inet_process_tcpdev(char *buf, int len);
 
 #endif
@@ -25,6 +25,18 @@ struct timezone {
     int tz_dsttime;		/* type of dst correction */
 };
 
+struct itimerval {
+    struct timeval it_interval;	/* timer reload value */
+    struct timeval it_value;	/* time until next expiry */
+};
+
+#define ITIMER_REAL     0	/* only real time timer supported */
+#define ITIMER_VIRTUAL  1
+#define ITIMER_PROF     2
+
+/* sys2.c*/
+void alarm_exit(void);
+
 #endif
 
 #define NFDBITS                 __NFDBITS
@@ -20,6 +20,7 @@ struct timer_list {
     jiff_t tl_expires;
     int tl_data;
     void (*tl_function) ();
+    struct timer_list **tl_pprev;   /* link to us in timer wheel, NULL if not pending */
 };
 
 struct pt_regs;
@@ -28,17 +29,39 @@ struct pt_regs;
 void add_timer(struct timer_list *);
 int del_timer(struct timer_list *);
 void do_timer(void);
+unsigned int idle_sleep_ticks(unsigned int);
 
 /* timer.c*/
+void tickless_idle(void);
+
 void timer_tick(int, struct pt_regs *);
 void spin_timer(int);
 
 /* timer-8254.c*/
 void enable_timer_tick(void);
 void disable_timer_tick(void);
+unsigned int timer_max_ticks(void);
+void timer_set_ticks(unsigned int);
+unsigned int timer_ticks_elapsed(unsigned int);
+
+#if defined(CONFIG_SYSCALL_TRACE) || defined(CONFIG_TIME_USEC)
+unsigned int timer_get_count(void);
+unsigned int timer_tick_counts(void);
+#endif
 
 #ifdef CONFIG_CPU_USAGE
 extern jiff_t uptime;
 #endif
 
+#ifdef CONFIG_PROFILE
+/* profile.c*/
+struct pt_regs;
+struct prof_ctl;
+struct prof_stats;
+void profile_tick(struct pt_regs *regs);
+int profile_start(struct prof_ctl *ctl);
+void profile_stop(void);
+void profile_get_stats(struct prof_stats *ps);
+#endif
+
 #endif
@@ -0,0 +1,51 @@
+/* TMPFS - a read-write filesystem in main memory */
+
+#ifndef _LINUXMT_TMPFS_FS_H
+#define _LINUXMT_TMPFS_FS_H
+
+#define TMPFS_BLOCK_BITS   10
+#define TMPFS_BLOCK_SIZE   (1 << TMPFS_BLOCK_BITS)
+#define TMPFS_CHUNK_BLOCKS 8       /* blocks per segment allocated from main memory */
+#define TMPFS_MIN_KB       16
+#define TMPFS_MAX_KB       512
+#define TMPFS_DEFAULT_KB   64
+#define TMPFS_NAME_LEN     14
+#define TMPFS_LINK_MAX     250
+#define TMPFS_ROOT_INO     1
+
+/* Node, one per file, kept in the node table of the metadata segment */
+struct tmpfs_node {
+	__u16 mode;     /* 0 if unused */
+	__u16 uid;
+	__u32 size;
+	__u32 mtime;
+	__u8  gid;
+	__u8  nlink;
+	__u16 first;    /* first data block, 0 if none */
+	__u16 rdev;
+};
+
+/* Directory entry, stored in directory data blocks */
+struct tmpfs_dirent {
+	__u16 ino;      /* 0 if unused */
+	char  name[TMPFS_NAME_LEN];
+};
+
+struct tmpfs_inode_info {
+	__u16 i_first;  /* first data block */
+	__u16 i_cblk;   /* last block found by bmap, 0 if none */
+	__u16 i_cidx;   /*   and its index in the file */
+};
+
+struct tmpfs_sb_info {
+	struct segment *s_meta; /* node table, next block table, chunk table */
+	__u16 s_nnodes;
+	__u16 s_nblocks;        /* size cap in blocks */
+	__u16 s_nchunks;        /* chunks allocated so far */
+	__u16 s_used;           /* blocks in use */
+	__u16 s_free;           /* free list of allocated blocks, 0 if empty */
+	__u16 s_next_off;       /* offset of next block table */
+	__u16 s_chunk_off;      /* offset of chunk table */
+};
+
+#endif  /* !_LINUXMT_TMPFS_FS_H */
@@ -47,6 +47,20 @@ extern int tracing;
 
 extern void trace_begin(void);
 extern void trace_end(unsigned int retval);
+
+#ifdef CONFIG_SYSCALL_TRACE
+struct inode;
+struct file;
+size_t sctrace_read(struct inode *inode, struct file *filp, char *data, size_t len);
+int sctrace_ioctl(struct inode *inode, struct file *filp, int cmd, char *arg);
+void sctrace_release(struct inode *inode, struct file *filp);
+#endif
+
+#ifdef CONFIG_SYSCALL_COUNTS
+/* generated with the syscall table in entry.S */
+extern unsigned int nr_syscalls;
+extern unsigned long syscall_counts[];
+#endif
 #endif
 
 #endif /* __LINUXMT_TRACE_H */
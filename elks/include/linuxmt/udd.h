@@ -16,6 +16,7 @@
 
 #define MAX_UDD	1 /* FIXME only 1 UDD until device passed to request_fn*/
 #define MAX_UDR	8
+#define UDD_BATCH	8	/* block requests claimed at once, see META_CLAIM */
 
 struct ud_driver {
     int udd_type;
@@ -25,6 +26,7 @@ struct ud_driver {
     struct ud_request *udd_req;
     struct wait_queue udd_wait;
     struct wait_queue udd_rwait;
+    struct request *udd_claimed[UDD_BATCH];	/* block requests with the daemon */
 };
 
 /*
@@ -70,6 +72,30 @@ struct ud_request_trunc {
     int udr_status;
 };
 
+/*
+ * Block requests are passed to the driver task in batches. META_CLAIM
+ * waits for block requests and returns as many as are queued, up to
+ * UDD_BATCH, with the data of each write already copied to its slot of
+ * the task's udd_data area, which must hold UDD_BATCH blocks. The task
+ * sets udbr_status of each to 1 for success or 0 for an I/O error,
+ * leaves the data of each read in its slot, and returns the batch with
+ * META_DONE, which completes them all.
+ */
+struct ud_blkreq {
+    unsigned int udbr_id;	/* returned unchanged in META_DONE */
+    int udbr_cmd;		/* READ or WRITE */
+    int udbr_minor;
+    unsigned long udbr_sector;	/* start sector, get_sector_size() bytes each */
+    unsigned int udbr_nr_sectors;
+    char *udbr_data;		/* this request's block in udd_data */
+    int udbr_status;
+};
+
+struct ud_batch {
+    unsigned int udb_count;	/* number of requests that follow */
+    struct ud_blkreq udb_req[UDD_BATCH];
+};
+
 /* udr_type can be */
 #define UDR_LSEEK	0
 #define UDR_READ	1
@@ -88,5 +114,7 @@ struct ud_request_trunc {
 #define	META_CREAT	0x0701
 #define	META_POLL	0x0702
 #define	META_ACK	0x0703
+#define	META_CLAIM	0x0704
+#define	META_DONE	0x0705
 
 #endif
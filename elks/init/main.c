@@ -42,7 +42,29 @@ struct netif_parms netif_parms[MAX_ETHS] = {
 };
 __u16 kernel_cs, kernel_ds;
 int tracing;
-int nr_ext_bufs, nr_xms_bufs, nr_map_bufs;
+int nr_ext_bufs, nr_xms_bufs, nr_map_bufs, max_map_bufs;
+#ifdef CONFIG_FS_READAHEAD
+int nr_readahead;
+#endif
+#ifdef CONFIG_FS_FLUSHER
+int flush_age, flush_hiwater;
+#endif
+#ifdef CONFIG_EXEC_TEXTCACHE
+int textcache_mode;
+#endif
+int seg_best_fit;
+int boot_profile;
+#ifdef CONFIG_ETH
+int boot_defer;
+static int probes_pending;
+static struct wait_queue probe_wait;
+#ifdef CONFIG_FARTEXT_KERNEL
+static seg_t init_start, init_end;  /* init section, freed after deferred probes */
+#endif
+#endif
+#ifdef CONFIG_SEG_SWAP
+int xms_swap_kb;
+#endif
 static int boot_console;
 static char bininit[] = "/bin/init";
 static char binshell[] = "/bin/sh";
@@ -80,6 +102,9 @@ static char * INITPROC option(char *s);
 #endif
 
 static void init_task(void);
+#ifdef CONFIG_ETH
+static void probe_task(void);
+#endif
 static void INITPROC kernel_banner(seg_t start, seg_t end, seg_t init, seg_t extra);
 
 
@@ -91,15 +116,40 @@ void start_kernel(void)
     kfork_proc(init_task);
     wake_up_process(&task[1]);
 
+#ifdef CONFIG_ETH
+    if (boot_defer) {
+        /* fork the deferred probes as a kernel task, reaped by init */
+        struct task_struct *t = kfork_proc(probe_task);
+        t->p_parent = &task[1];
+        t->ppid = task[1].pid;
+        probes_pending = 1;
+        wake_up_process(t);
+    }
+#endif
+
+#ifdef CONFIG_FS_FLUSHER
+    /* fork and run the buffer write-behind flusher as a kernel task */
+    wake_up_process(kfork_proc(flusher_task));
+#endif
+
     /*
      * We are now the idle task. We won't run unless no other process can run.
      */
+#ifdef CONFIG_KLOG
+    klog_async = 1;
+#endif
     while (1) {
         schedule();
+#ifdef CONFIG_KLOG
+        if (klog_drain(16))
+            continue;   /* more console output waiting, check for tasks first */
+#endif
 #ifdef CONFIG_TIMER_INT0F
         int0F();        /* simulate timer interrupt hooked on IRQ 7 */
+#elif defined(CONFIG_TIMER_TICKLESS)
+        tickless_idle();    /* halt with timer tick stopped until next timer */
 #else
-        idle_halt();    /* halt until interrupt to save power */
+        idle_cpu();     /* halt or APM idle until interrupt to save power */
 #endif
     }
 }
@@ -128,23 +178,26 @@ void INITPROC kernel_init(void)
     set_console(boot_console);
 
     /* init direct, bios or headless console*/
-    console_init();
+    INITCALL(console_init());
 
 #ifdef CONFIG_CHAR_DEV_RS
-    serial_init();
+    INITCALL(serial_init());
 #endif
 
     inode_init();
     if (buffer_init())	/* also enables xms and unreal mode if configured and possible*/
         panic("No buf mem");
+#ifdef CONFIG_SEG_SWAP
+    INITCALL(swap_init());	/* after buffer_init, which may have enabled xms */
+#endif
 
-    device_init();
+    INITCALL(device_init());
 
 #ifdef CONFIG_SOCKET
-    sock_init();
+    INITCALL(sock_init());
 #endif
 
-    fs_init();
+    INITCALL(fs_init());
 
 #ifdef CONFIG_BOOTOPTS
     finalize_options();
@@ -157,6 +210,13 @@ void INITPROC kernel_init(void)
     seg_t s = init_seg + (((word_t)(void *)__start_fartext_init + 15) >> 4);
     seg_t e = init_seg + (((word_t)(void *)  __end_fartext_init + 15) >> 4);
     debug("init: seg %04x to %04x size %04x (%d)\n", s, e, (e - s) << 4, (e - s) << 4);
+#ifdef CONFIG_ETH
+    if (boot_defer) {           /* still needed by probe_task */
+        init_start = s;
+        init_end = e;
+        e = s;
+    } else
+#endif
     seg_add(s, e);
 #else
     seg_t s = 0, e = 0;
@@ -165,6 +225,13 @@ void INITPROC kernel_init(void)
     kernel_banner(base, end, s, e - s);
 }
 
+/* print the time taken by an init call started at jiffies start, if profiling */
+void INITPROC init_profile(const char *name, jiff_t start)
+{
+    if (boot_profile)
+        printk("init: %s %lums\n", name, (jiffies - start) * (1000 / HZ));
+}
+
 static void INITPROC kernel_banner(seg_t start, seg_t end, seg_t init, seg_t extra)
 {
 #ifdef CONFIG_ARCH_IBMPC
@@ -248,6 +315,37 @@ static void init_task(void)
     do_init_task();
 }
 
+#ifdef CONFIG_ETH
+static void INITPROC deferred_probes(void)
+{
+    INITCALL(eth_probe());
+}
+
+/* runs the probes deferred by bootopts deferprobe while init starts */
+static void probe_task(void)
+{
+    current->signal = 0;            /* kernel task, signals would spin */
+    deferred_probes();
+#ifdef CONFIG_FARTEXT_KERNEL
+    seg_add(init_start, init_end);  /* init section no longer needed */
+#endif
+    probes_pending = 0;
+    wake_up(&probe_wait);
+    do_exit(0);
+}
+
+/* wait for the deferred probes, for opening a device they set up */
+void wait_deferred_probes(void)
+{
+    while (probes_pending) {
+        prepare_to_wait(&probe_wait);
+        if (probes_pending)
+            do_wait();
+        finish_wait(&probe_wait);
+    }
+}
+#endif
+
 #ifdef CONFIG_BOOTOPTS
 static struct dev_name_struct {
 	const char *name;
@@ -439,6 +537,20 @@ static int INITPROC parse_options(void)
 			root_mountflags &= ~MS_RDONLY;
 			continue;
 		}
+		if (!strcmp(line,"noatime")) {
+			root_mountflags |= MS_NOATIME;
+			continue;
+		}
+		if (!strcmp(line,"relatime")) {
+			root_mountflags |= MS_RELATIME;
+			continue;
+		}
+#ifdef CONFIG_KLOG
+		if (!strncmp(line,"loglevel=",9)) {
+			console_loglevel = (int)simple_strtol(line+9, 10);
+			continue;
+		}
+#endif
 		if (!strcmp(line,"debug")) {
 			dprintk_on = 1;
 			continue;
@@ -451,6 +563,16 @@ static int INITPROC parse_options(void)
 			tracing |= TRACE_KSTACK;
 			continue;
 		}
+		if (!strcmp(line,"bootprof")) {
+			boot_profile = 1;
+			continue;
+		}
+#ifdef CONFIG_ETH
+		if (!strcmp(line,"deferprobe")) {
+			boot_defer = 1;
+			continue;
+		}
+#endif
 		if (!strncmp(line,"init=",5)) {
 			line += 5;
 			init_command = argv_init[1] = line;
@@ -476,10 +598,46 @@ static int INITPROC parse_options(void)
 			nr_xms_bufs = (int)simple_strtol(line+7, 10);
 			continue;
 		}
+#ifdef CONFIG_SEG_SWAP
+		if (!strncmp(line,"xmsswap=",8)) {
+			xms_swap_kb = (int)simple_strtol(line+8, 10);
+			continue;
+		}
+#endif
 		if (!strncmp(line,"cache=",6)) {
 			nr_map_bufs = (int)simple_strtol(line+6, 10);
 			continue;
 		}
+		if (!strncmp(line,"cachemax=",9)) {
+			max_map_bufs = (int)simple_strtol(line+9, 10);
+			continue;
+		}
+#ifdef CONFIG_FS_READAHEAD
+		if (!strncmp(line,"readahead=",10)) {
+			nr_readahead = (int)simple_strtol(line+10, 10);
+			continue;
+		}
+#endif
+#ifdef CONFIG_FS_FLUSHER
+		if (!strncmp(line,"flushage=",9)) {
+			flush_age = (int)simple_strtol(line+9, 10);
+			continue;
+		}
+		if (!strncmp(line,"flushmax=",9)) {
+			flush_hiwater = (int)simple_strtol(line+9, 10);
+			continue;
+		}
+#endif
+#ifdef CONFIG_EXEC_TEXTCACHE
+		if (!strncmp(line,"textcache=",10)) {
+			textcache_mode = (int)simple_strtol(line+10, 10);
+			continue;
+		}
+#endif
+		if (!strncmp(line,"segfit=",7)) {
+			seg_best_fit = strcmp(line+7, "first");
+			continue;
+		}
 		if (!strncmp(line,"comirq=",7)) {
 			comirq(line+7);
 			continue;
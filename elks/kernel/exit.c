@@ -7,11 +7,10 @@
 #include <linuxmt/sched.h>
 #include <linuxmt/errno.h>
 #include <linuxmt/mm.h>
+#include <linuxmt/shm.h>
+#include <linuxmt/time.h>
 #include <linuxmt/debug.h>
 
-extern int task_slots_unused;
-extern struct task_struct *next_task_slot;
-
 static void reparent_children(void)
 {
     register struct task_struct *p;
@@ -21,9 +20,7 @@ static void reparent_children(void)
             /* remove orphaned zombies, no need to reparent them to init*/
             if (p->state == TASK_ZOMBIE) {
                 debug_wait("Zombie orphan pid %d ppid %d removed\n", p->pid, p->ppid);
-                p->state = TASK_UNUSED;     /* unassign task entry*/
-                next_task_slot = p;
-                task_slots_unused++;
+                free_task_slot(p);          /* unassign task entry*/
             }
 
             /* reparent orphans to init*/
@@ -37,6 +34,26 @@ static void reparent_children(void)
     }
 }
 
+/* return status of a zombie or stopped child, releasing a zombie's task slot */
+static int wait_collect(struct task_struct *p, int *status)
+{
+    pid_t pid = p->pid;
+
+    if (status) {
+        if (verified_memcpy_tofs(status, &p->exit_status, sizeof(int)))
+            return -EFAULT;
+    }
+
+    /* just return status on stopped state, don't release task*/
+    if (p->state == TASK_STOPPED)
+        return pid;
+
+    free_task_slot(p);              /* unassign task entry*/
+
+    debug_wait("WAIT(%P) got %d\n", pid);
+    return pid;
+}
+
 /* note: 'usage' parameter ignored */
 int sys_wait4(pid_t pid, int *status, int options, void *usage)
 {
@@ -48,30 +65,26 @@ int sys_wait4(pid_t pid, int *status, int options, void *usage)
  for (;;) {
     waitagain = 0;
 
-    for_each_task(p) {
+    if ((int)pid > 0) {
+        /* waiting for a specific child, look it up directly */
+        p = find_task_by_pid(pid);
+        if (p && p->p_parent == current) {
+            if (p->state == TASK_ZOMBIE || p->state == TASK_STOPPED)
+                return wait_collect(p, status);
+            debug_wait("WAIT(%P) again for pid %d state %d\n", p->pid, p->state);
+            waitagain = 1;
+        }
+    } else {
+      for_each_task(p) {
         if (p->p_parent == current && p->state != TASK_UNUSED) {
           if (p->state == TASK_ZOMBIE || p->state == TASK_STOPPED) {
-            if (pid == (pid_t)-1 || p->pid == pid || (!pid && p->pgrp == current->pgrp)) {
-                if (status) {
-                    if (verified_memcpy_tofs(status, &p->exit_status, sizeof(int)))
-                        return -EFAULT;
-                }
-
-                /* just return status on stopped state, don't release task*/
-                if (p->state == TASK_STOPPED)
-                    return p->pid;
-
-                p->state = TASK_UNUSED;     /* unassign task entry*/
-                next_task_slot = p;
-                task_slots_unused++;
-
-                debug_wait("WAIT(%P) got %d\n", p->pid);
-                return p->pid;
-            }
-        } else {
+            if (pid == (pid_t)-1 || (!pid && p->pgrp == current->pgrp))
+                return wait_collect(p, status);
+          } else {
             /* keep waiting while process has non-zombie/stopped children*/
             debug_wait("WAIT(%P) again for pid %d state %d\n", p->pid, p->state);
             waitagain = 1;
+          }
         }
       }
     }
@@ -100,6 +113,7 @@ void do_exit(int status)
 
     debug_wait("EXIT(%P) status %d\n", status);
     _close_allfiles();
+    alarm_exit();
 
     /* release process group and TTY*/
     current->pgrp = 0;
@@ -115,6 +129,7 @@ void do_exit(int status)
 
     /* free program allocated memory */
     seg_free_pid(current->pid);
+    shm_exit(current);
 
 #if BLOAT
     /* Keep all of the family stuff straight */
@@ -2,35 +2,91 @@
 #include <linuxmt/errno.h>
 #include <linuxmt/kernel.h>
 #include <linuxmt/mm.h>
+#include <linuxmt/shm.h>
 #include <linuxmt/sched.h>
 #include <linuxmt/trace.h>
 #include <linuxmt/debug.h>
 
 #include <arch/segment.h>
 
-int task_slots_unused = MAX_TASKS;
-struct task_struct *next_task_slot = task;
+#define PID_MAX     32767
+#define pid_hashfn(pid) ((pid) & (PIDHASH_SIZE - 1))
 
+int task_slots_unused;
+static struct task_struct *free_tasks;          /* unused slots via pid_next */
+static struct task_struct *pidhash[PIDHASH_SIZE];
+
+/*
+ * Allocate the next pid not in use as a pid, process group or session.
+ * The task table is only scanned when last_pid reaches next_safe, the
+ * lowest id in use above the previous scan, so a fork usually costs O(1).
+ */
 static pid_t get_pid(void)
 {
     register struct task_struct *p;
-    static pid_t last_pid = -1;
+    static unsigned int last_pid = -1;      /* idle task gets pid 0 */
+    static unsigned int next_safe = 0;
 
-    goto startgp;
-    do {
-        if (p->state == TASK_UNUSED)
-            continue;
-        if (p->pid == last_pid || p->pgrp == last_pid ||
-            p->session == last_pid) {
-          startgp:
-            if ((int)(++last_pid) < 0)
-                last_pid = 1;
-            p = &task[0];
+    if (++last_pid > PID_MAX) {
+        last_pid = 1;
+        goto rescan;
+    }
+    if (last_pid >= next_safe) {
+  rescan:
+        next_safe = PID_MAX + 1;
+  repeat:
+        for_each_task(p) {
+            if (p->state == TASK_UNUSED)
+                continue;
+            if (p->pid == last_pid || p->pgrp == last_pid ||
+                p->session == last_pid) {
+                if (++last_pid >= next_safe) {
+                    if (last_pid > PID_MAX)
+                        last_pid = 1;
+                    next_safe = PID_MAX + 1;
+                }
+                goto repeat;
+            }
+            if (p->pid > last_pid && next_safe > p->pid)
+                next_safe = p->pid;
+            if (p->pgrp > last_pid && next_safe > p->pgrp)
+                next_safe = p->pgrp;
+            if (p->session > last_pid && next_safe > p->session)
+                next_safe = p->session;
         }
-    } while (++p < &task[MAX_TASKS]);
+    }
     return last_pid;
 }
 
+struct task_struct *find_task_by_pid(pid_t pid)
+{
+    register struct task_struct *p;
+
+    for (p = pidhash[pid_hashfn(pid)]; p; p = p->pid_next)
+        if (p->pid == pid)
+            return p;
+    return NULL;
+}
+
+/*
+ *  Return a task slot to the free list, removing it from the pid hash.
+ */
+void free_task_slot(struct task_struct *t)
+{
+    register struct task_struct **pp;
+
+    for (pp = &pidhash[pid_hashfn(t->pid)]; *pp; pp = &(*pp)->pid_next) {
+        if (*pp == t) {
+            *pp = t->pid_next;
+            break;
+        }
+    }
+    t->state = TASK_UNUSED;
+    t->pid_next = free_tasks;
+    free_tasks = t;
+    task_slots_unused++;
+}
+
 /*
  *  Find a free task slot.
  */
@@ -38,22 +94,22 @@ struct task_struct *find_empty_process(void)
 {
     register struct task_struct *t;
     register struct task_struct *currentp = current;
+    pid_t pid;
 
     if (task_slots_unused <= 1) {
         printk("Only %d task slots\n", task_slots_unused);
         if (!task_slots_unused || currentp->uid)
             return NULL;
     }
-    t = next_task_slot;
-    while (t->state != TASK_UNUSED) {
-        if (++t >= &task[MAX_TASKS])
-            t = &task[1];
-    }
-    next_task_slot = t;
+    pid = get_pid();                /* before slot is in use */
+    t = free_tasks;
+    free_tasks = t->pid_next;
     task_slots_unused--;
     *t = *currentp;
     t->state = TASK_UNINTERRUPTIBLE;
-    t->pid = get_pid();
+    t->pid = pid;
+    t->pid_next = pidhash[pid_hashfn(t->pid)];
+    pidhash[pid_hashfn(t->pid)] = t;
 #ifdef CONFIG_CPU_USAGE
     t->ticks = 0;
     t->average = 0;
@@ -95,9 +151,7 @@ pid_t do_fork(int virtual)
 
         if (t->mm.seg_data == 0) {
             seg_put (currentp->mm.seg_code);
-            t->state = TASK_UNUSED;
-            task_slots_unused++;
-            next_task_slot = t;
+            free_task_slot(t);
             return -ENOMEM;
         }
 
@@ -117,6 +171,9 @@ pid_t do_fork(int virtual)
     t->fs.root->i_count++;
     t->fs.pwd->i_count++;
 
+    /* Attach to the shared memory segments of the parent */
+    shm_fork(currentp, t);
+
     t->exit_status = 0;
 
     t->ppid = currentp->pid;
@@ -142,33 +199,44 @@ pid_t sys_fork(void)
 
 pid_t sys_vfork(void)
 {
-#if 1
     return do_fork(0);
-#else
+}
+
+/*
+ * Virtual fork used by posix_spawn: the child shares the parent's data
+ * segment and the parent sleeps until the child execs or exits.
+ */
+pid_t sys_spawnfork(void)
+{
     register __ptask currentp = current;
-    int retval, sc[5];
+    struct task_struct *t;
+    pid_t pid;
+    int sc[6];
 
-    if ((retval = do_fork(1)) >= 0) {
+    if ((pid = do_fork(1)) >= 0) {
 
         /* Parent and child are sharing the user stack at this point.
          * The child will go first, coming into life in the middle of
          * the tswitch() function, returning to user space, then will
          * return from the library code where the actual syscall was
          * done and then will issue an exec syscall, destroying the
-         * first few bytes at the top of the user stack. Save those
-         * bytes in the parent's kernel stack.
+         * interrupt return frame and return address at the top of the
+         * user stack. Save those bytes in the parent's kernel stack.
          */
         memcpy_fromfs(sc, (void *)currentp->t_regs.sp, sizeof(sc));
+
+        t = find_task_by_pid(pid);
         /*
-         * Let the child go on first.
+         * Let the child go on first, until exec or exit leaves
+         * it with its own data segment or none.
          */
-        sleep_on(&currentp->child_wait);
+        while (t->mm.seg_data == currentp->mm.seg_data)
+            sleep_on(&currentp->child_wait);
         /*
          * By now, the child should have its own user stack. Restore
          * the parent's user stack.
          */
         memcpy_tofs((void *)currentp->t_regs.sp, sc, sizeof(sc));
     }
-    return retval;
-#endif
+    return pid;
 }
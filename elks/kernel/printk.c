@@ -37,6 +37,10 @@
 #include <linuxmt/ntty.h>
 #include <linuxmt/debug.h>
 #include <linuxmt/signal.h>
+#include <linuxmt/fs.h>
+#include <linuxmt/errno.h>
+#include <linuxmt/mem.h>
+#include <arch/irq.h>
 #include <stdarg.h>
 
 dev_t dev_console;
@@ -48,6 +52,9 @@ dev_t dev_console;
 #endif
 static void (*kputc)(dev_t, int) = 0;
 
+int console_loglevel = DEFAULT_CONSOLE_LOGLEVEL;
+static int msg_level = DEFAULT_MSGLEVEL;
+
 
 void set_console(dev_t dev)
 {
@@ -61,21 +68,202 @@ void set_console(dev_t dev)
     }
 }
 
-void kputchar(int ch)
+static void con_putchar(int ch)
 {
     if (ch == '\n')
-            kputchar('\r');
+            con_putchar('\r');
     if (kputc)
             (*kputc)(dev_console, ch);
     else early_putchar(ch);
 }
 
+#ifdef CONFIG_KLOG
+/*
+ * Kernel log. printk appends to klog_buf, and the console is fed from it a
+ * few characters each timer tick and in bulk from the idle task, so that a
+ * message on a slow serial console doesn't stall its caller. Output stays
+ * synchronous until the idle task first runs, and when the console falls a
+ * whole buffer behind. Each line is stored after a KLOG_MARK + level byte.
+ */
+#define KLOG_SIZE       1024            /* power of 2 */
+#define KLOG_TICK_CHARS 2               /* console characters per timer tick */
+
+static char klog_buf[KLOG_SIZE];
+static unsigned int klog_head;          /* next write, free running */
+static unsigned int klog_con;           /* next character for the console */
+static unsigned int klog_len;           /* history kept, up to KLOG_SIZE */
+static unsigned char klog_bol = 1;      /* next character starts a line */
+static unsigned char klog_busy;         /* console output in progress */
+static unsigned char con_level;         /* level of line on console */
+int klog_async;                         /* set once the idle task runs */
+
+/* output the next logged character, called with interrupts disabled */
+static void klog_output(void)
+{
+    int ch = klog_buf[klog_con++ & (KLOG_SIZE - 1)];
+
+    if (KLOG_ISMARK(ch))
+        con_level = ch - KLOG_MARK;
+    else if (con_level < console_loglevel)
+        con_putchar(ch);
+}
+
+static void klog_store(int ch)
+{
+    if (klog_head - klog_con >= KLOG_SIZE) {    /* console a buffer behind */
+        if (klog_busy)
+            klog_con++;                 /* interrupted a drain, drop oldest */
+        else klog_output();
+    }
+    klog_buf[klog_head++ & (KLOG_SIZE - 1)] = ch;
+    if (klog_len < KLOG_SIZE)
+        klog_len++;
+}
+
+void kputchar(int ch)
+{
+    flag_t flags;
+
+    save_flags(flags);
+    clr_irq();
+    if (klog_bol) {
+        klog_bol = 0;
+        klog_store(KLOG_MARK + msg_level);
+    }
+    klog_store(ch);
+    if (ch == '\n')
+        klog_bol = 1;
+    restore_flags(flags);
+}
+
+/*
+ * Output up to count logged characters to the console with interrupts on,
+ * returns nonzero if more are waiting. Called from the timer interrupt and
+ * the idle task, a drain interrupted by another is left to finish.
+ */
+int klog_drain(int count)
+{
+    flag_t flags;
+    int more;
+
+    save_flags(flags);
+    clr_irq();
+    if (!klog_busy) {
+        klog_busy = 1;
+        while (count-- > 0 && klog_con != klog_head) {
+            int ch = klog_buf[klog_con & (KLOG_SIZE - 1)];
+
+            klog_con++;
+            if (KLOG_ISMARK(ch)) {
+                con_level = ch - KLOG_MARK;
+                count++;
+            } else if (con_level < console_loglevel) {
+                restore_flags(flags);
+                con_putchar(ch);
+                clr_irq();
+            }
+        }
+        klog_busy = 0;
+    }
+    more = (klog_con != klog_head);
+    restore_flags(flags);
+    return more;
+}
+
+/* output everything logged to the console before returning */
+void klog_flush(void)
+{
+    flag_t flags;
+
+    save_flags(flags);
+    clr_irq();
+    while (klog_con != klog_head)
+        klog_output();
+    restore_flags(flags);
+}
+
+void klog_tick(void)
+{
+    if (klog_async && klog_con != klog_head)
+        klog_drain(KLOG_TICK_CHARS);
+}
+
+/* read the log history from the oldest line kept, pos is from its start */
+size_t klog_read(struct inode *inode, struct file *filp, char *data, size_t len)
+{
+    unsigned int start, pos, n;
+    flag_t flags;
+    size_t total = 0;
+
+    while (len) {
+        save_flags(flags);
+        clr_irq();
+        if (filp->f_pos >= klog_len) {
+            restore_flags(flags);
+            break;
+        }
+        pos = (unsigned int)filp->f_pos;
+        start = (klog_head - klog_len + pos) & (KLOG_SIZE - 1);
+        n = klog_len - pos;
+        if (n > KLOG_SIZE - start)
+            n = KLOG_SIZE - start;
+        if (n > len)
+            n = len;
+        restore_flags(flags);
+        memcpy_tofs(data, klog_buf + start, n);
+        filp->f_pos += n;
+        data += n;
+        total += n;
+        len -= n;
+    }
+    return total;
+}
+
+int klog_ioctl(struct inode *inode, struct file *filp, int cmd, char *arg)
+{
+    int old = console_loglevel;
+
+    if (cmd != MEM_SETLOGLEVEL)
+        return -EINVAL;
+    if (!suser())
+        return -EPERM;
+    if ((unsigned int)arg > 8)
+        return -EINVAL;
+    if (arg)
+        console_loglevel = (int)arg;
+    return old;
+}
+
+#else
+
+/* without the log everything is shown, levels are only stripped */
+void kputchar(int ch)
+{
+    con_putchar(ch);
+}
+
+void klog_flush(void)
+{
+}
+#endif /* CONFIG_KLOG */
+
 static void kputs(const char *buf)
 {
     while (*buf)
         kputchar(*buf++);
 }
 
+/* set msg_level from a leading KERN_ level, returns the rest of fmt */
+static const char *msg_level_of(const char *fmt)
+{
+    if (fmt[0] == '<' && fmt[1] >= '0' && fmt[1] <= '7' && fmt[2] == '>') {
+        msg_level = fmt[1] - '0';
+        return fmt + 3;
+    }
+    msg_level = DEFAULT_MSGLEVEL;
+    return fmt;
+}
+
 /************************************************************************
  *
  *      Output a number
@@ -141,6 +329,7 @@ static void vprintk(const char *fmt, va_list p)
     unsigned long v;
     char *str;
 
+    fmt = msg_level_of(fmt);
     while ((c = *fmt++)) {
         if (c != '%')
             kputchar(c);
@@ -235,12 +424,18 @@ void printk(const char *fmt, ...)
     va_start(p, fmt);
     vprintk(fmt, p);
     va_end(p);
+#ifdef CONFIG_KLOG
+    if (!klog_async)
+        klog_flush();
+#endif
 }
 
 void halt(void)
 {
     /* Lock up with infinite loop */
+    msg_level = 0;
     kputs("\nSYSTEM HALTED - Press CTRL-ALT-DEL to reboot:");
+    klog_flush();
 
     while (1)
         idle_halt();
@@ -250,6 +445,7 @@ void panic(const char *error, ...)
 {
     va_list p;
 
+    msg_level = 0;
     kputs("\npanic: ");
     va_start(p, error);
     vprintk(error, p);
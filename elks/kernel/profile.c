@@ -0,0 +1,115 @@
+/*
+ * Sampling profiler
+ *
+ * On each timer tick the CS:IP saved by the interrupt is counted in a
+ * histogram bucket of (1 << shift) bytes. Samples in the kernel near or
+ * far text, or in the code segment of a chosen process, each have their
+ * own region of 64K >> shift buckets. Buckets saturate at 0xFFFF. The
+ * histogram lives in a main memory segment so it costs no kernel data
+ * space; the profile tool reads it back through /dev/kmem.
+ */
+
+#include <linuxmt/config.h>
+#include <linuxmt/kernel.h>
+#include <linuxmt/sched.h>
+#include <linuxmt/mm.h>
+#include <linuxmt/mem.h>
+#include <linuxmt/memory.h>
+#include <linuxmt/timer.h>
+#include <linuxmt/init.h>
+#include <linuxmt/string.h>
+#include <linuxmt/errno.h>
+
+#include <arch/irq.h>
+#include <arch/segment.h>
+
+#ifdef CONFIG_PROFILE
+
+static struct prof_stats prof;
+static segment_s *prof_seg;
+
+/* called from the timer interrupt with the interrupted registers */
+void profile_tick(struct pt_regs *regs)
+{
+    word_t ip, cs, n;
+    int r;
+
+    if (!prof.running)
+        return;
+
+    /* interrupt entry leaves struct uregs (BP, IP, CS, flags) at SS:SP */
+    ip = peekw(regs->sp + 2, regs->ss);
+    cs = peekw(regs->sp + 4, regs->ss);
+
+    if (cs == kernel_cs)
+        r = PROF_KTEXT;
+#ifdef CONFIG_FARTEXT_KERNEL
+    else if (cs == prof.cs[PROF_KFTEXT])
+        r = PROF_KFTEXT;
+#endif
+    else if (prof.pid && current->pid == prof.pid &&
+             current->mm.seg_code && cs == current->mm.seg_code->base) {
+        prof.cs[PROF_USER] = cs;
+        r = PROF_USER;
+    } else {
+        prof.other++;
+        return;
+    }
+
+    prof.samples[r]++;
+    cs = prof.seg + r * (prof.buckets >> 3);        /* region paragraph */
+    ip = (ip >> prof.shift) << 1;
+    n = peekw(ip, cs);
+    if (n != 0xFFFF)
+        pokew(ip, cs, n + 1);
+}
+
+void profile_stop(void)
+{
+    prof.running = 0;
+}
+
+/* start sampling into a new cleared histogram, or free it if shift is 0 */
+int profile_start(struct prof_ctl *ctl)
+{
+    segext_t paras;
+
+    if (ctl->shift && (ctl->shift < 2 || ctl->shift > 12))
+        return -EINVAL;
+
+    prof.running = 0;
+    if (prof_seg) {
+        seg_free(prof_seg);
+        prof_seg = NULL;
+    }
+    memset(&prof, 0, sizeof(prof));
+    if (!ctl->shift)
+        return 0;
+
+    prof.buckets = (unsigned int)(0x10000UL >> ctl->shift);
+    paras = (prof.buckets >> 3) * PROF_REGIONS;
+    if (!(prof_seg = seg_alloc(paras, SEG_FLAG_PROF)))
+        return -ENOMEM;
+    fmemsetw(0, prof_seg->base, 0, paras << 3);
+
+    prof.seg = prof_seg->base;
+    prof.shift = ctl->shift;
+    prof.pid = ctl->pid;
+    prof.cs[PROF_KTEXT] = kernel_cs;
+#ifdef CONFIG_FARTEXT_KERNEL
+    prof.cs[PROF_KFTEXT] = (unsigned)((long)kernel_init >> 16);
+#endif
+    prof.running = 1;
+    return 0;
+}
+
+void profile_get_stats(struct prof_stats *ps)
+{
+    flag_t flags;
+
+    save_flags(flags);
+    clr_irq();
+    memcpy(ps, &prof, sizeof(prof));
+    restore_flags(flags);
+}
+#endif
@@ -7,11 +7,13 @@
 
 #include <linuxmt/kernel.h>
 #include <linuxmt/sched.h>
+#include <linuxmt/mm.h>
 #include <linuxmt/init.h>
 #include <linuxmt/timer.h>
 #include <linuxmt/string.h>
 #include <linuxmt/trace.h>
 #include <linuxmt/debug.h>
+#include <linuxmt/mem.h>
 
 #include <arch/irq.h>
 
@@ -21,29 +23,134 @@ __task task[MAX_TASKS];
 __ptask current = task;
 __ptask previous;
 
-//static unsigned char nr_running;
 extern int intr_count;
 
+/*
+ * Run queues. Runnable tasks are kept on one circular list per priority
+ * level, level 0 running first, and run_bitmap has a bit set for each
+ * non-empty level so the next task is found without scanning tasks.
+ * The idle task is never queued, it runs only when all levels are empty.
+ * Level PRIO_RT holds the SCHED_FIFO tasks, which always run first.
+ */
+struct kernel_stats kstat;
+
+static struct task_struct *run_queue[NR_PRIO + 1];
+static unsigned char run_bitmap;
+static unsigned char run_picks;
+unsigned char need_resched;         /* schedule on return to user mode */
+
+/* Add a task to the tail of the run queue for its level */
 void add_to_runqueue(register struct task_struct *p)
 {
-    //nr_running++;
-    (p->prev_run = idle_task.prev_run)->next_run = p;
-    p->next_run = &idle_task;
-    idle_task.prev_run = p;
+    register struct task_struct *head;
+    int level = p->prio;
+
+    if ((head = run_queue[level]) != NULL) {
+        (p->prev_run = head->prev_run)->next_run = p;
+        p->next_run = head;
+        head->prev_run = p;
+    } else {
+        run_queue[level] = p->next_run = p->prev_run = p;
+        run_bitmap |= 1 << level;
+    }
 }
 
 static void del_from_runqueue(register struct task_struct *p)
 {
+    int level = p->prio;
+
 #ifdef CHECK_SCHED
     if (!p->next_run || !p->prev_run)
         panic("SCHED(%d): task not on run-queue, state %d", p->pid, p->state);
     if (p == &idle_task)
         panic("SCHED: trying to sleep idle task");
 #endif
-    //nr_running--;
-    (p->next_run->prev_run = p->prev_run)->next_run = p->next_run;
+    if (p->next_run == p) {
+        run_queue[level] = NULL;
+        run_bitmap &= ~(1 << level);
+    } else {
+        (p->next_run->prev_run = p->prev_run)->next_run = p->next_run;
+        if (run_queue[level] == p)
+            run_queue[level] = p->next_run;
+    }
     p->next_run = p->prev_run = NULL;
+}
+
+/*
+ * Return the task at the head of the highest non-empty level. Every
+ * PRIO_STARVE picks the lowest non-empty level is taken instead, so
+ * niced CPU hogs still make some progress under load. A runnable
+ * SCHED_FIFO task is always picked.
+ */
+static struct task_struct *pick_next_task(void)
+{
+    unsigned char map = run_bitmap;
+    int level = 0;
+
+    if (!map)
+        return &idle_task;
+    if (map & (1 << PRIO_RT))
+        return run_queue[PRIO_RT];
+    if (++run_picks >= PRIO_STARVE) {
+        run_picks = 0;
+        level = NR_PRIO;
+        while (!(map & (1 << level)))
+            level--;
+    } else {
+        while (!(map & 1)) {
+            map >>= 1;
+            level++;
+        }
+    }
+    return run_queue[level];
+}
+
+/* Move a task to the level for its nice value and policy, called with irqs off */
+static void requeue_task(register struct task_struct *p)
+{
+    int queued;
+
+    if (p != &idle_task) {
+        queued = (p->next_run != NULL);
+        if (queued)
+            del_from_runqueue(p);
+        p->prio = task_prio(p);
+        if (queued)
+            add_to_runqueue(p);
+    }
+}
+
+/*
+ * Set a task's nice value, moving it to its new level if runnable.
+ */
+void set_task_nice(register struct task_struct *p, int nice)
+{
+    flag_t flags;
+
+    if (nice < NICE_MIN)
+        nice = NICE_MIN;
+    if (nice > NICE_MAX)
+        nice = NICE_MAX;
+    save_flags(flags);
+    clr_irq();
+    p->nice = nice;
+    requeue_task(p);
+    restore_flags(flags);
+}
+
+/*
+ * Set a task's scheduling policy. A SCHED_FIFO task runs before all
+ * others until it sleeps, and preempts them as soon as it is woken.
+ */
+void set_task_policy(register struct task_struct *p, int policy)
+{
+    flag_t flags;
 
+    save_flags(flags);
+    clr_irq();
+    p->policy = policy;
+    requeue_task(p);
+    restore_flags(flags);
 }
 
 static void process_timeout(int __data)
@@ -83,6 +190,7 @@ void schedule(void)
         return;
 
     clr_irq();
+    need_resched = 0;
     if (prev->state == TASK_INTERRUPTIBLE) {
         if (prev->signal || (prev->timeout && (prev->timeout <= jiffies))) {
             prev->timeout = 0UL;
@@ -93,15 +201,42 @@ void schedule(void)
         }
     }
 
-    /* Choose a task to run next */
-    next = prev->next_run;
-    if (prev->state != TASK_RUNNING)
+    /*
+     * A task still runnable here has used its turn: it loses any wakeup
+     * boost and goes to the back of its own level. A SCHED_FIFO task
+     * stays at the front, it only gives way to others by sleeping.
+     */
+    if (prev != &idle_task) {
         del_from_runqueue(prev);
-    if (next == &idle_task)
-        next = next->next_run;
+        if (prev->state == TASK_RUNNING) {
+            prev->prio = task_prio(prev);
+            add_to_runqueue(prev);
+            if (prev->prio == PRIO_RT)
+                run_queue[PRIO_RT] = prev;
+        } else
+            prev->sleep_time = jiffies;
+    }
+
+    /* Choose a task to run next */
+    next = pick_next_task();
     set_irq();
 
+#ifdef CONFIG_SEG_SWAP
+    /* bring back a swapped out task, or let it wait at the back of its queue */
+    if (next->mm.seg_data && (next->mm.seg_data->flags & SEG_FLAG_SWAPPED)
+            && !seg_swap_in(next->mm.seg_data)) {
+        clr_irq();
+        if (next->next_run) {
+            del_from_runqueue(next);
+            add_to_runqueue(next);
+        }
+        set_irq();
+        next = (prev->state == TASK_RUNNING)? prev: &idle_task;
+    }
+#endif
+
     if (next != prev) {
+        kstat.context_switches++;
 
         if (timeout) {
             timer.tl_expires = timeout;
@@ -122,62 +257,106 @@ void schedule(void)
         debug_sched("resched: %P prevstate %d\n", prev->state);
 }
 
-static struct timer_list *next_timer;
+/*
+ * Pending timers are hashed by expiry tick into a wheel of TIMER_WHEEL
+ * buckets, each an unsorted doubly linked list, so add_timer and del_timer
+ * are O(1). Each tick only the bucket for that tick is scanned; timers more
+ * than one revolution away stay in it until their tick comes around.
+ */
+static struct timer_list *timer_wheel[TIMER_WHEEL];
+static jiff_t timer_jiffies;        /* last tick whose bucket was run */
+static unsigned char timer_running;
 
 void add_timer(struct timer_list * timer)
 {
     struct timer_list **p;
+    jiff_t expires = timer->tl_expires;
     flag_t flags;
 
-    timer->tl_next = NULL;
-    p = &next_timer;
     save_flags(flags);
     clr_irq();
-    while (*p) {
-        if ((*p)->tl_expires > timer->tl_expires) {
-            timer->tl_next = *p;
-            break;
-        }
-        p = &(*p)->tl_next;
-    }
+    if (expires <= timer_jiffies)   /* already due, run on next tick */
+        expires = timer_jiffies + 1;
+    p = &timer_wheel[(unsigned int)expires & (TIMER_WHEEL - 1)];
+    if ((timer->tl_next = *p) != NULL)
+        (*p)->tl_pprev = &timer->tl_next;
     *p = timer;
+    timer->tl_pprev = p;
     restore_flags(flags);
 }
 
 int del_timer(struct timer_list * timer)
 {
-    struct timer_list **p;
     flag_t flags;
+    int ret = 0;
 
-    p = &next_timer;
     save_flags(flags);
     clr_irq();
-    while (*p) {
-        if (*p == timer) {
-            *p = timer->tl_next;
-            restore_flags(flags);
-            return 1;
-        }
-        p = &(*p)->tl_next;
+    if (timer->tl_pprev) {
+        if ((*timer->tl_pprev = timer->tl_next) != NULL)
+            timer->tl_next->tl_pprev = timer->tl_pprev;
+        timer->tl_pprev = NULL;
+        ret = 1;
     }
     restore_flags(flags);
-    return 0;
+    return ret;
 }
 
 static void run_timer_list(void)
 {
     struct timer_list *timer;
+    struct timer_list **bucket;
 
     clr_irq();
-    while ((timer = next_timer) && timer->tl_expires <= jiffies) {
-        del_timer(timer);
+    if (timer_running) {        /* nested tick, outer loop will catch up */
         set_irq();
-        timer->tl_function(timer->tl_data);
-        clr_irq();
+        return;
     }
+    timer_running = 1;
+    while (timer_jiffies < jiffies) {
+        timer_jiffies++;
+        bucket = &timer_wheel[(unsigned int)timer_jiffies & (TIMER_WHEEL - 1)];
+        /* rescan from the head after each call, the callback may change the list */
+        for (;;) {
+            for (timer = *bucket; timer; timer = timer->tl_next)
+                if (timer->tl_expires <= timer_jiffies)
+                    break;
+            if (!timer)
+                break;
+            del_timer(timer);
+            set_irq();
+            timer->tl_function(timer->tl_data);
+            clr_irq();
+        }
+    }
+    timer_running = 0;
     set_irq();
 }
 
+#ifdef CONFIG_TIMER_TICKLESS
+/*
+ * Return the number of ticks, 1 to max, the idle task can go without a
+ * timer interrupt: until the next pending timer expires. Only the buckets
+ * for those ticks need looking at. Returns 0 if a task is runnable or
+ * timers are still being caught up. Called with interrupts disabled.
+ */
+unsigned int idle_sleep_ticks(unsigned int max)
+{
+    struct timer_list *timer;
+    unsigned int n;
+
+    if (run_bitmap || timer_jiffies != jiffies || timer_running)
+        return 0;
+    for (n = 1; n < max; n++) {
+        timer = timer_wheel[(unsigned int)(jiffies + n) & (TIMER_WHEEL - 1)];
+        for (; timer; timer = timer->tl_next)
+            if (timer->tl_expires <= jiffies + n)
+                return n;
+    }
+    return max;
+}
+#endif
+
 #if UNUSED
 /* maybe someday I'll implement these profiling things -PL */
 
@@ -207,14 +386,13 @@ static void update_one_process(struct taks_struct *p,
 void do_timer(void)
 {
     jiffies++;
-
-#ifdef NEED_RESCHED             /* need_resched is not checked anywhere */
-    if (!((int) jiffies & 7))
-        need_resched = 1;       /* how primitive can you get? */
-#endif
+    need_resched = 1;               /* end of the current task's turn */
 
     run_timer_list();
 
+#ifdef CONFIG_KLOG
+    klog_tick();
+#endif
 }
 
 void INITPROC sched_init(void)
@@ -225,7 +403,7 @@ void INITPROC sched_init(void)
  *  Mark tasks 0-(MAX_TASKS-1) as not in use.
  */
     do {
-        (--t)->state = TASK_UNUSED;
+        free_task_slot(--t);        /* task[0] ends up first on free list */
     } while (t > task);
 
 /*
@@ -234,5 +412,8 @@ void INITPROC sched_init(void)
     kfork_proc(NULL);
 
     t->state = TASK_RUNNING;
-    t->next_run = t->prev_run = t;
+    t->nice = 0;
+    t->policy = SCHED_OTHER;
+    t->prio = nice_to_prio(0);
+    t->next_run = t->prev_run = t;  /* never queued, but never woken either */
 }
@@ -87,9 +87,9 @@ int kill_process(pid_t pid, sig_t sig, int priv)
     register struct task_struct *p;
 
     debug_sig("SIGNAL kill_proc sig %d pid %d\n", sig, pid);
-    for_each_task(p)
-        if (p->pid == pid && p->state < TASK_ZOMBIE)
-            return send_sig(sig, p, 0);
+    p = find_task_by_pid(pid);
+    if (p && p->state < TASK_ZOMBIE)
+        return send_sig(sig, p, 0);
     return -ESRCH;
 }
 
@@ -130,9 +130,12 @@ int sys_kill(pid_t pid, sig_t sig)
 
 int sys_signal(int signr, __kern_sighandler_t handler)
 {
+    int keep = signr & SIGF_KEEP;
+
+    signr &= ~SIGF_KEEP;
     debug_sig("SIGNAL sys_signal %d action %x:%x pid %P\n", signr,
               _FP_SEG(handler), _FP_OFF(handler));
-    if (((unsigned int)signr > NSIG) || signr == SIGKILL || signr == SIGSTOP)
+    if ((unsigned int)(signr - 1) >= NSIG || signr == SIGKILL || signr == SIGSTOP)
         return -EINVAL;
     if (handler == KERN_SIG_DFL)
         current->sig.action[signr - 1].sa_dispose = SIGDISP_DFL;
@@ -149,7 +152,7 @@ int sys_signal(int signr, __kern_sighandler_t handler)
             return -EINVAL;
         }
         current->sig.handler = handler;
-        current->sig.action[signr - 1].sa_dispose = SIGDISP_CUSTOM;
+        current->sig.action[signr - 1].sa_dispose = keep? SIGDISP_KEEP: SIGDISP_CUSTOM;
     }
     return 0;
 }
@@ -120,8 +120,17 @@ void wake_up_process(register struct task_struct *p)
     save_flags(flags);
     clr_irq();
     p->state = TASK_RUNNING;
-    if (!p->next_run)
+    if (!p->next_run) {
+        /* tasks waking from sleep run one level above their base */
+        p->prio = task_prio(p);
+        if (p->prio > nice_to_prio(NICE_MIN))
+            p->prio--;
         add_to_runqueue(p);
+
+        /* a task that outranks current preempts it on return to user mode */
+        if (p->prio < current->prio)
+            need_resched = 1;
+    }
     restore_flags(flags);
 }
 
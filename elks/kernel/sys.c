@@ -177,6 +177,114 @@ int sys_setsid(void)
     return currentp->pgrp;
 }
 
+/*
+ * Scheduling priority. As in Linux, nice and getpriority return
+ * 20 - nice so that a successful result is never negative.
+ * Only the superuser may lower a nice value.
+ */
+int sys_nice(int inc)
+{
+    register __ptask currentp = current;
+
+    if (inc < 0 && !suser())
+	return -EPERM;
+    set_task_nice(currentp, currentp->nice + inc);
+    return 20 - currentp->nice;
+}
+
+static int prio_match(register struct task_struct *p, int which, int who)
+{
+    if (p->state == TASK_UNUSED || p == &task[0])
+	return 0;
+    switch (which) {
+    case PRIO_PROCESS:
+	return p->pid == (who? who: current->pid);
+    case PRIO_PGRP:
+	return p->pgrp == (who? who: current->pgrp);
+    case PRIO_USER:
+	return p->uid == (who? who: current->uid);
+    }
+    return 0;
+}
+
+int sys_getpriority(int which, int who)
+{
+    register struct task_struct *p;
+    int max_prio = -ESRCH;
+
+    if ((unsigned)which > PRIO_USER)
+	return -EINVAL;
+    for_each_task(p) {
+	if (prio_match(p, which, who) && 20 - p->nice > max_prio)
+	    max_prio = 20 - p->nice;
+    }
+    return max_prio;
+}
+
+int sys_setpriority(int which, int who, int niceval)
+{
+    register struct task_struct *p;
+    int error = -ESRCH;
+
+    if ((unsigned)which > PRIO_USER)
+	return -EINVAL;
+    for_each_task(p) {
+	if (!prio_match(p, which, who))
+	    continue;
+	if (current->euid && current->euid != p->uid && current->uid != p->uid) {
+	    error = -EPERM;
+	    continue;
+	}
+	if (niceval < p->nice && !suser()) {
+	    error = -EACCES;
+	    continue;
+	}
+	set_task_nice(p, niceval);
+	if (error == -ESRCH)
+	    error = 0;
+    }
+    return error;
+}
+
+/*
+ * Scheduling policy, SCHED_OTHER or SCHED_FIFO. Only the superuser may
+ * change it, since a SCHED_FIFO task can keep all others from running.
+ */
+static struct task_struct *sched_task(pid_t pid)
+{
+    register struct task_struct *p;
+
+    if (!pid)
+	return current;
+    p = find_task_by_pid(pid);
+    if (!p || p->state == TASK_UNUSED || p == &task[0])
+	return NULL;
+    return p;
+}
+
+int sys_sched_setscheduler(pid_t pid, int policy)
+{
+    register struct task_struct *p;
+
+    if (policy != SCHED_OTHER && policy != SCHED_FIFO)
+	return -EINVAL;
+    if (!(p = sched_task(pid)))
+	return -ESRCH;
+    if (!suser())
+	return -EPERM;
+    set_task_policy(p, policy);
+    return 0;
+}
+
+int sys_sched_getscheduler(pid_t pid)
+{
+    register struct task_struct *p;
+
+    if (!(p = sched_task(pid)))
+	return -ESRCH;
+    return p->policy;
+}
+
 #if UNUSED
 int sys_times(struct tms *tbuf)
 {
@@ -1,5 +1,7 @@
 #include <linuxmt/sched.h>
 #include <linuxmt/timer.h>
+#include <linuxmt/time.h>
+#include <linuxmt/mm.h>
 #include <linuxmt/kernel.h>
 #include <linuxmt/signal.h>
 #include <linuxmt/errno.h>
@@ -7,54 +9,148 @@
 #include <arch/segment.h>
 #include <arch/io.h>
 /*
- * Alarm system call
+ * Alarm and interval timer system calls
  *
  * Feb 2022 Greg Haerr
+ *
+ * Only ITIMER_REAL is supported, shared with alarm. Timer values are kept
+ * in jiffies, rounded up to the next tick, as the timer wheel runs at HZ.
  */
 
-static struct timer_list alarms[NR_ALARMS];
+#define USEC_PER_TICK	(1000000L / HZ)
+
+struct alarm {
+	struct timer_list timer;
+	jiff_t interval;		/* reload value, 0 for one shot */
+};
+
+static struct alarm alarms[NR_ALARMS];
 
 static void alarm_callback(int data)
 {
 	struct task_struct *p = (struct task_struct *)data;
+	struct alarm *ap;
 
 	debug("kernel ALARM pid %P for %d\n", p->pid);
+	for (ap = alarms; ap < &alarms[NR_ALARMS]; ap++) {
+		if (ap->timer.tl_data == data) {
+			if (ap->interval) {
+				ap->timer.tl_expires += ap->interval;
+				add_timer(&ap->timer);
+			} else
+				ap->timer.tl_data = 0;
+			break;
+		}
+	}
 	send_sig(SIGALRM, p, 1);
 }
 
-static struct timer_list *find_alarm(struct task_struct *t)
+static struct alarm *find_alarm(struct task_struct *t)
 {
-	struct timer_list *ap;
+	struct alarm *ap;
 
 	for (ap = alarms; ap < &alarms[NR_ALARMS]; ap++ ) {
-		if (ap->tl_data == (int)t)
+		if (ap->timer.tl_data == (int)t)
 			return ap;
 	}
 	return NULL;
 }
 
+/* return jiffies until the alarm expires, 0 if none */
+static jiff_t alarm_remaining(struct alarm *ap)
+{
+	jiff_t left = 0;
+	flag_t flags;
+
+	save_flags(flags);
+	clr_irq();
+	if (ap && ap->timer.tl_pprev) {
+		left = ap->timer.tl_expires - jiffies;
+		if ((long)left <= 0)
+			left = 1;
+	}
+	restore_flags(flags);
+	return left;
+}
+
+/* stop the alarm of current, then start it if value nonzero */
+static int set_alarm(jiff_t value, jiff_t interval)
+{
+	struct alarm *ap = find_alarm(current);
+
+	if (ap) {
+		del_timer(&ap->timer);
+		ap->timer.tl_data = 0;
+	}
+	if (!value)
+		return 0;
+	if (!ap && !(ap = find_alarm(NULL))) {
+		printk("No more alarms\n");
+		return -EAGAIN;
+	}
+	ap->timer.tl_expires = jiffies + value;
+	ap->timer.tl_function = alarm_callback;
+	ap->timer.tl_data = (int)current;	/* deleted by alarm_exit on process exit*/
+	ap->interval = interval;
+	add_timer(&ap->timer);
+	return 0;
+}
+
+/* cancel the alarm of an exiting process */
+void alarm_exit(void)
+{
+	set_alarm(0, 0);
+}
+
 unsigned int sys_alarm(unsigned int secs)
 {
-	struct timer_list *ap;
+	jiff_t left;
 
 	debug("sys_alarm %d\n", secs);
+	left = alarm_remaining(find_alarm(current));
+	set_alarm((jiff_t)secs * HZ, 0);
+	return (unsigned int)((left + HZ - 1) / HZ);
+}
+
+static jiff_t timeval_to_jiffies(struct timeval *tv)
+{
+	return tv->tv_sec * HZ + (tv->tv_usec + USEC_PER_TICK - 1) / USEC_PER_TICK;
+}
+
+static void jiffies_to_timeval(jiff_t j, struct timeval *tv)
+{
+	tv->tv_sec = j / HZ;
+	tv->tv_usec = (j % HZ) * USEC_PER_TICK;
+}
+
+int sys_getitimer(int which, struct itimerval *value)
+{
+	struct itimerval it;
+	struct alarm *ap;
+
+	if (which != ITIMER_REAL)
+		return -EINVAL;
 	ap = find_alarm(current);
-	if (secs == 0) {
-		if (ap) {
-			del_timer(ap);
-			ap->tl_data = 0;
-			return 0;
-		}
-	} else {
-		if (!ap && !(ap = find_alarm(NULL))) {
-			printk("No more alarms\n");
-			return 0;
-		}
-		del_timer(ap);
-		ap->tl_expires = jiffies + ((unsigned long)secs * HZ);
-		ap->tl_function = alarm_callback;
-		ap->tl_data = (int)current;	/* must delete timer on process exit*/
-		add_timer(ap);
-	}
-	return 0;
+	jiffies_to_timeval(alarm_remaining(ap), &it.it_value);
+	jiffies_to_timeval(ap? ap->interval: 0, &it.it_interval);
+	return verified_memcpy_tofs(value, &it, sizeof(it));
+}
+
+int sys_setitimer(int which, struct itimerval *value, struct itimerval *ovalue)
+{
+	struct itimerval it;
+	int error;
+
+	if (which != ITIMER_REAL)
+		return -EINVAL;
+	if (verified_memcpy_fromfs(&it, value, sizeof(it)))
+		return -EFAULT;
+	if ((unsigned long)it.it_value.tv_usec >= 1000000L ||
+	    (unsigned long)it.it_interval.tv_usec >= 1000000L ||
+	    it.it_value.tv_sec < 0 || it.it_interval.tv_sec < 0)
+		return -EINVAL;
+	if (ovalue && (error = sys_getitimer(which, ovalue)))
+		return error;
+	return set_alarm(timeval_to_jiffies(&it.it_value),
+		timeval_to_jiffies(&it.it_interval));
 }
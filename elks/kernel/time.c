@@ -30,6 +30,7 @@
 #include <linuxmt/errno.h>
 #include <linuxmt/mm.h>
 #include <linuxmt/string.h>
+#include <linuxmt/timer.h>
 
 #include <linuxmt/config.h>
 #include <arch/system.h>
@@ -105,14 +106,32 @@ int sys_gettimeofday(register struct timeval *tv, struct timezone *tz)
 {
     struct timeval tmp_tv;
     jiff_t now;
+#ifdef CONFIG_TIME_USEC
+    unsigned int count;
+    flag_t flags;
+#endif
 
     /* load the current time into the structures passed */
     if (tv != NULL) {
+#ifdef CONFIG_TIME_USEC
+	/* interpolate between ticks using the timer counter */
+	save_flags(flags);
+	clr_irq();
 	now = jiffies;
+	count = timer_get_count();
+	restore_flags(flags);
+#else
+	now = jiffies;
+#endif
 	tmp_tv.tv_sec = xtime.tv_sec + (now - xtime_jiffies) / HZ;
 	tmp_tv.tv_usec = xtime.tv_usec + ((now - xtime_jiffies) % HZ) * (1000000L / HZ);
-	if (tmp_tv.tv_usec >= 10000000L)
-	    tmp_tv.tv_usec -= 10000000L;
+#ifdef CONFIG_TIME_USEC
+	tmp_tv.tv_usec += (unsigned long)count * (1000000L / HZ) / timer_tick_counts();
+#endif
+	while (tmp_tv.tv_usec >= 1000000L) {
+	    tmp_tv.tv_usec -= 1000000L;
+	    tmp_tv.tv_sec++;
+	}
 	if (verified_memcpy_tofs(tv, &tmp_tv, sizeof(struct timeval)))
 	    return -EFAULT;
     }
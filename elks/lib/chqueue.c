@@ -25,6 +25,7 @@
 #include <linuxmt/sched.h>
 #include <linuxmt/types.h>
 #include <linuxmt/errno.h>
+#include <linuxmt/mm.h>
 #include <linuxmt/debug.h>
 
 void chq_init(register struct ch_queue *q, unsigned char *buf, int size)
@@ -78,6 +79,70 @@ void chq_addch_nowakeup(register struct ch_queue *q, unsigned char c)
     set_irq();
 }
 
+/*
+ * Copy up to len bytes from user space into the queue, returns count copied.
+ * Only the writer moves head, so the copy is done with interrupts enabled
+ * into space that an interrupt-time reader can't touch.
+ */
+int chq_addbuf(register struct ch_queue *q, char *buf, int len)
+{
+    int n, count = 0;
+
+    while (len > 0 && q->len < q->size) {
+	n = q->size - q->len;		/* room, not changed by reader except up*/
+	if (n > q->size - q->head)	/* contiguous run up to buffer end*/
+	    n = q->size - q->head;
+	if (n > len)
+	    n = len;
+	memcpy_fromfs(q->base + q->head, buf, n);
+
+	clr_irq();
+	if ((q->head += n) >= q->size)
+	    q->head = 0;
+	q->len += n;
+	set_irq();
+	buf += n;
+	count += n;
+	len -= n;
+    }
+    return count;
+}
+
+/* Copy up to len bytes from the queue to user space, returns count copied*/
+int chq_getbuf(register struct ch_queue *q, char *buf, int len)
+{
+    int n, count = 0;
+
+    while (len > 0 && q->len) {
+	n = q->len;
+	if (n > q->size - q->tail)
+	    n = q->size - q->tail;
+	if (n > len)
+	    n = len;
+	memcpy_tofs(buf, q->base + q->tail, n);
+
+	clr_irq();
+	if ((q->tail += n) >= q->size)
+	    q->tail = 0;
+	q->len -= n;
+	set_irq();
+	buf += n;
+	count += n;
+	len -= n;
+    }
+    return count;
+}
+
+/* Remove n characters at the tail, already consumed by the caller*/
+void chq_skip(register struct ch_queue *q, int n)
+{
+    clr_irq();
+    if ((q->tail += n) >= q->size)
+	q->tail -= q->size;
+    q->len -= n;
+    set_irq();
+}
+
 int chq_wait_rd(register struct ch_queue *q, int nonblock)
 {
     int	res = 0;
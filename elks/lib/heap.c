@@ -19,8 +19,38 @@
 #define WAIT_LOCK(lockp)
 #define EVENT_UNLOCK(lockp)
 
+// Free blocks are kept in size class bins so that allocation
+// only scans blocks of about the right size:
+//   bin 0 < 32 bytes, bin 1 < 64, ... bin 6 < 2048, bin 7 the rest
+
+#define HEAP_BINS 8
+#define HEAP_BIN0_SHIFT 5
+
 list_s _heap_all;
-static list_s _heap_free;
+static list_s _heap_free [HEAP_BINS];
+
+
+// Size class of a block
+
+static int heap_bin (word_t size)
+{
+	int b = 0;
+
+	size >>= HEAP_BIN0_SHIFT;
+	while (size && b < HEAP_BINS - 1) {
+		size >>= 1;
+		b++;
+	}
+	return b;
+}
+
+
+// Insert to head of its bin free list
+
+static void free_insert (heap_s * h)
+{
+	list_insert_after (&_heap_free [heap_bin (h->size)], &(h->free));
+}
 
 
 // Split block if enough large
@@ -37,7 +67,7 @@ static void heap_split (heap_s * h1, word_t size0)
 		h2->tag = HEAP_TAG_FREE;
 
 		list_insert_after (&(h1->all), &(h2->all));
-		list_insert_after (&(h1->free), &(h2->free));
+		free_insert (h2);
 	}
 }
 
@@ -46,31 +76,38 @@ static void heap_split (heap_s * h1, word_t size0)
 
 static heap_s * free_get (word_t size0, byte_t tag)
 {
-	// First get the smallest suitable free block
+	// First get the smallest suitable free block of the size class,
+	// else the first block of a larger class, where all blocks fit
 
 	heap_s * best_h  = 0;
 	word_t best_size = 0xFFFF;
-	list_s * n = _heap_free.next;
+	int b0 = heap_bin (size0);
+	int b;
 
-	while (n != &_heap_free) {
-		heap_s * h = structof (n, heap_s, free);
-		word_t size1  = h->size;
+	for (b = b0; b < HEAP_BINS && !best_h; b++) {
+		list_s * l = &_heap_free [b];
+		list_s * n = l->next;
 
-		if ((h->tag == HEAP_TAG_FREE) && (size1 >= size0) && (size1 < best_size)) {
-			best_h  = h;
-			best_size = size1;
-			if (size1 == size0) break;
-		}
+		while (n != l) {
+			heap_s * h = structof (n, heap_s, free);
+			word_t size1  = h->size;
+
+			if ((h->tag == HEAP_TAG_FREE) && (size1 >= size0) && (size1 < best_size)) {
+				best_h  = h;
+				best_size = size1;
+				if (size1 == size0 || b != b0) break;
+			}
 
-		n = h->free.next;
+			n = h->free.next;
+		}
 	}
 
 	// Then allocate that free block
 
 	if (best_h) {
+		list_remove (&(best_h->free));
 		heap_split (best_h, size0);
 		best_h->tag = HEAP_TAG_USED | tag;
-		list_remove (&(best_h->free));
 	}
 
 	return best_h;
@@ -111,25 +148,16 @@ void heap_free (void * data)
 
 	heap_s * h = ((heap_s *) (data)) - 1;  // back to header
 
-	// Free block will be inserted to free list:
-	//   - tail if merged to previous or next free block
-	//   - head if still alone to increase 'exact hit'
-	//     chance on next allocation of same size
-
-	list_s * i = &_heap_free;
-
 	// Try to merge with previous block if free
 
 	list_s * p = h->all.prev;
+	h->tag = HEAP_TAG_FREE;
 	if (&_heap_all != p) {
 		heap_s * prev = structof (p, heap_s, all);
 		if (prev->tag == HEAP_TAG_FREE) {
 			list_remove (&(prev->free));
 			heap_merge (prev, h);
-			i = _heap_free.prev;
 			h = prev;
-		} else {
-			h->tag = HEAP_TAG_FREE;
 		}
 	}
 
@@ -141,13 +169,13 @@ void heap_free (void * data)
 		if (next->tag == HEAP_TAG_FREE) {
 			list_remove (&(next->free));
 			heap_merge (h, next);
-			i = _heap_free.prev;
 		}
 	}
 
-	// Insert to free list head or tail
+	// Insert to head of its bin to increase 'exact hit'
+	// chance on next allocation of same size
 
-	list_insert_after (i, &(h->free));
+	free_insert (h);
 
 	EVENT_UNLOCK (&_heap_lock);
 }
@@ -163,11 +191,8 @@ void heap_add (void * data, word_t size)
 		h->size = size - sizeof (heap_s);
 		h->tag = HEAP_TAG_FREE;
 
-		// Add large block to tails of both lists
-		// as almost no chance for 'exact hit'
-
 		list_insert_before (&_heap_all, &(h->all));
-		list_insert_before (&_heap_free, &(h->free));
+		free_insert (h);
 
 		EVENT_UNLOCK (&_heap_lock);
 	}
@@ -177,18 +202,14 @@ void heap_add (void * data, word_t size)
 
 void heap_init ()
 {
+	int b;
+
 	list_init (&_heap_all);
-	list_init (&_heap_free);
+	for (b = 0; b < HEAP_BINS; b++)
+		list_init (&_heap_free [b]);
 }
 
-// Dump heap
-
-#ifdef HEAP_DEBUG
-
-static void heap_cb (heap_s * h)
-{
-        printk ("heap:%Xh:%u:%hxh\n",h, h->size, h->tag);
-}
+// Walk all heap blocks
 
 void heap_iterate (void (* cb) (heap_s *))
 {
@@ -201,5 +222,19 @@ void heap_iterate (void (* cb) (heap_s *))
 	}
 }
 
+#ifdef HEAP_DEBUG
+
+// Dump heap
+
+static void heap_cb (heap_s * h)
+{
+        printk ("heap:%Xh:%u:%hxh\n",h, h->size, h->tag);
+}
+
+void heap_dump (void)
+{
+	heap_iterate (heap_cb);
+}
+
 #endif /* HEAP_DEBUG */
 
@@ -28,13 +28,61 @@
 
 #ifdef CONFIG_INET
 
-extern unsigned char tdin_buf[];
-extern sem_t bufin_sem, bufout_sem;
 extern char tcpdev_inuse;
-extern int tcpdev_inetwrite(void *data, unsigned int len);
-extern char *get_tdout_buf(void);
 
-static sem_t rwlock;    /* global inet_read/write semaphore*/
+/*
+ * Send a command that ktcp answers with a reply. Replies are matched by
+ * socket alone, so only one such command may be outstanding per socket;
+ * other sockets proceed independently through the tcpdev slots.
+ */
+static int inet_commandv(register struct socket *sock, void *cmd, unsigned int len,
+                         struct iovec *iov, unsigned int skip, unsigned int ulen)
+{
+    int ret;
+
+    while (sock->flags & SF_WAITREPLY) {
+        interruptible_sleep_on(sock->wait);
+        if (current->signal)
+            return -ERESTARTSYS;
+    }
+    sock->flags |= SF_WAITREPLY;
+    ret = tcpdev_inetwritev(cmd, len, iov, skip, ulen);
+    if (ret < 0) {
+        sock->flags &= ~SF_WAITREPLY;
+        wake_up(sock->wait);
+    }
+    return ret;
+}
+
+static int inet_command(struct socket *sock, void *cmd, unsigned int len,
+                        char *udata, unsigned int ulen)
+{
+    struct iovec iov;
+
+    iov.iov_base = udata;
+    iov.iov_len = ulen;
+    return inet_commandv(sock, cmd, len, &iov, 0, ulen);
+}
+
+/* Sleep until ktcp has replied to the outstanding command on sock */
+static struct tdb_return_data *inet_wait_reply(struct socket *sock)
+{
+    struct tdb_return_data *ret;
+
+    while (!(ret = tcpdev_find_reply(sock))) {
+        debug_net("INET(%P) WAIT reply sock %x\n", sock);
+        interruptible_sleep_on(sock->wait);
+    }
+    return ret;
+}
+
+/* Release the reply slot and allow the next command on sock */
+static void inet_reply_done(register struct socket *sock, struct tdb_return_data *ret)
+{
+    tcpdev_clear_data_avail(ret);
+    sock->flags &= ~SF_WAITREPLY;
+    wake_up(sock->wait);
+}
 
 int inet_process_tcpdev(register char *buf, int len)
 {
@@ -47,7 +95,6 @@ int inet_process_tcpdev(register char *buf, int len)
     switch (((struct tdb_return_data *)buf)->type) {
     case TDT_CHG_STATE:
         sock->state = (unsigned char) ((struct tdb_return_data *)buf)->ret_value;
-        tcpdev_clear_data_avail();
         debug_net("INET(%P) chg_state sock %x %d\n", sock, sock->state);
         if (sock->state == SS_DISCONNECTING) {
             sock->flags |= SF_CLOSING;
@@ -58,10 +105,8 @@ int inet_process_tcpdev(register char *buf, int len)
     case TDT_AVAIL_DATA:
         down(&sock->sem);
         sock->avail_data = ((struct tdb_return_data *)buf)->ret_value;
-        debug_net("INET(%P) sock %x avail %u bufin %d\n",
-            sock, sock->avail_data, bufin_sem);
+        debug_net("INET(%P) sock %x avail %u\n", sock, sock->avail_data);
         up(&sock->sem);
-        tcpdev_clear_data_avail();
         wake_up(sock->wait);
         break;
 
@@ -69,18 +114,21 @@ int inet_process_tcpdev(register char *buf, int len)
         down(&sock->sem);
         sock->flags |= SF_CONNECT;
         sock->retval = ((struct tdb_return_data *)buf)->ret_value;
-        debug_net("INET(%P) sock %x connect %d bufin %d\n",
-            sock, sock->retval, bufin_sem);
+        debug_net("INET(%P) sock %x connect %d\n", sock, sock->retval);
         up(&sock->sem);
-        tcpdev_clear_data_avail();
+        wake_up(sock->wait);
+        break;
+
+    case TDT_WINDOW:
+        debug_net("INET(%P) sock %x send window open\n", sock);
         wake_up(sock->wait);
         break;
 
     case TDT_RETURN:
     case TDT_ACCEPT:
     case TDT_BIND:
-        debug_net("INET(%P) retval %d bufin %d\n",
-            ((struct tdb_return_data *)buf)->ret_value, bufin_sem);
+    case TDT_RECVFROM:
+        debug_net("INET(%P) retval %d\n", ((struct tdb_return_data *)buf)->ret_value);
         /* tcpdev_clear_data_avail() called by woken process */
         wake_up(sock->wait);
         break;
@@ -108,25 +156,54 @@ static int inet_dup(struct socket *newsock, struct socket *oldsock)
 
 static int inet_release(struct socket *sock, struct socket *peer)
 {
-    register struct tdb_release *cmd;
+    struct tdb_release cmd;
     int ret;
 
     debug_net("INET(%P) release sock %x\n", sock);
     if (!tcpdev_inuse)
         return -EINVAL;
-    cmd = (struct tdb_release *)get_tdout_buf();
-    cmd->cmd = TDC_RELEASE;
+    tcpdev_drop_replies(sock);
+    cmd.cmd = TDC_RELEASE;
+    cmd.sock = sock;
+    cmd.reset = sock->flags & SF_RST_ON_CLOSE;
+    ret = tcpdev_inetwrite(&cmd, sizeof(struct tdb_release), NULL, 0);
+    return (ret >= 0 ? 0 : ret);
+}
+
+/* Send a bind command whose address is already filled in */
+static int inet_do_bind(register struct socket *sock, struct tdb_bind *cmd)
+{
+    struct tdb_return_data *r;
+    int ret;
+
+    cmd->cmd = TDC_BIND;
     cmd->sock = sock;
-    cmd->reset = sock->flags & SF_RST_ON_CLOSE;
-    ret = tcpdev_inetwrite(cmd, sizeof(struct tdb_release));
+    cmd->reuse_addr = sock->flags & SF_REUSE_ADDR;
+    cmd->nodelay = sock->flags & SF_NODELAY;
+    cmd->rcv_bufsiz = sock->rcv_bufsiz;
+    cmd->type = sock->type;
+
+    ret = inet_command(sock, cmd, sizeof(struct tdb_bind), NULL, 0);
+    if (ret < 0)
+        return ret;
+
+    /* Sleep until tcpdev has news */
+    r = inet_wait_reply(sock);
+    ret = r->ret_value;
+    if (r->type == TDT_BIND) {
+        sock->localaddr = ((struct tdb_bind_ret *)r)->addr_ip;
+        sock->localport = ((struct tdb_bind_ret *)r)->addr_port;
+    }
+    inet_reply_done(sock, r);
+
+    debug_net("INET(%P) bind returns %d\n", ret);
     return (ret >= 0 ? 0 : ret);
 }
 
 static int inet_bind(register struct socket *sock, struct sockaddr *addr,
                      size_t sockaddr_len)
 {
-    register struct tdb_bind *cmd;
-    int ret;
+    struct tdb_bind cmd;
 
     debug_net("INET(%P) bind sock %x\n", sock);
 
@@ -135,34 +212,28 @@ static int inet_bind(register struct socket *sock, struct sockaddr *addr,
 
     /* TODO : Check if the user has permision to bind the port */
 
-    down(&rwlock);
-    cmd = (struct tdb_bind *)get_tdout_buf();
-    cmd->cmd = TDC_BIND;
-    cmd->sock = sock;
-    cmd->reuse_addr = sock->flags & SF_REUSE_ADDR;
-    cmd->rcv_bufsiz = sock->rcv_bufsiz;
-    memcpy_fromfs(&cmd->addr, addr, sockaddr_len);
-
-    tcpdev_inetwrite(cmd, sizeof(struct tdb_bind));
-
-    /* Sleep until tcpdev has news */
-    while (bufin_sem == 0)
-        interruptible_sleep_on(sock->wait);
+    memcpy_fromfs(&cmd.addr, addr, sockaddr_len);
+    return inet_do_bind(sock, &cmd);
+}
 
-    sock->localaddr = ((struct tdb_bind_ret *)tdin_buf)->addr_ip;
-    sock->localport = ((struct tdb_bind_ret *)tdin_buf)->addr_port;
-    ret = ((struct tdb_return_data *)tdin_buf)->ret_value;
-    tcpdev_clear_data_avail();
-    up(&rwlock);
+/* Bind a datagram socket used without bind to an ephemeral port */
+static int inet_autobind(struct socket *sock)
+{
+    struct tdb_bind cmd;
 
-    debug_net("INET(%P) bind returns %d\n", ret);
-    return (ret >= 0 ? 0 : ret);
+    if (sock->localport)
+        return 0;
+    cmd.addr.sin_family = AF_INET;
+    cmd.addr.sin_port = 0;
+    cmd.addr.sin_addr.s_addr = INADDR_ANY;
+    return inet_do_bind(sock, &cmd);
 }
 
 static int inet_connect(struct socket *sock, struct sockaddr *uservaddr,
                         size_t sockaddr_len, int flags)
 {
-    register struct tdb_connect *cmd;
+    struct tdb_connect cmd;
+    int ret;
 
     debug_net("INET(%P) connect sock %x\n", sock);
 
@@ -175,13 +246,27 @@ static int inet_connect(struct socket *sock, struct sockaddr *uservaddr,
     if (sock->state == SS_CONNECTING)
         return -EINPROGRESS;
 
+    /* a datagram socket only records its default destination */
+    if (sock->type == SOCK_DGRAM) {
+        struct sockaddr_in sin;
+
+        if (sockaddr_len < sizeof(struct sockaddr_in))
+            return -EINVAL;
+        memcpy_fromfs(&sin, uservaddr, sizeof(struct sockaddr_in));
+        sock->remaddr = sin.sin_addr.s_addr;
+        sock->remport = sin.sin_port;
+        sock->state = SS_CONNECTED;
+        return 0;
+    }
+
     sock->flags &= ~SF_CONNECT;
-    cmd = (struct tdb_connect *)get_tdout_buf();
-    cmd->cmd = TDC_CONNECT;
-    cmd->sock = sock;
-    memcpy_fromfs(&cmd->addr, uservaddr, sockaddr_len);
+    cmd.cmd = TDC_CONNECT;
+    cmd.sock = sock;
+    memcpy_fromfs(&cmd.addr, uservaddr, sockaddr_len);
 
-    tcpdev_inetwrite(cmd, sizeof(struct tdb_connect));
+    ret = tcpdev_inetwrite(&cmd, sizeof(struct tdb_connect), NULL, 0);
+    if (ret < 0)
+        return ret;
 
     do {
         interruptible_sleep_on(sock->wait);
@@ -197,42 +282,42 @@ static int inet_connect(struct socket *sock, struct sockaddr *uservaddr,
 
 static int inet_listen(register struct socket *sock, int backlog)
 {
-    register struct tdb_listen *cmd;
+    struct tdb_listen cmd;
+    struct tdb_return_data *r;
     int ret;
 
     debug("inet_listen(socket : 0x%x)\n", sock);
-    down(&rwlock);
-    cmd = (struct tdb_listen *)get_tdout_buf();
-    cmd->cmd = TDC_LISTEN;
-    cmd->sock = sock;
-    cmd->backlog = backlog;
+    cmd.cmd = TDC_LISTEN;
+    cmd.sock = sock;
+    cmd.backlog = backlog;
 
-    tcpdev_inetwrite(cmd, sizeof(struct tdb_listen));
+    ret = inet_command(sock, &cmd, sizeof(struct tdb_listen), NULL, 0);
+    if (ret < 0)
+        return ret;
 
     /* Sleep until tcpdev has news */
-    while (bufin_sem == 0)
-        interruptible_sleep_on(sock->wait);
-
-    ret = ((struct tdb_return_data *)tdin_buf)->ret_value;
-    tcpdev_clear_data_avail();
-    up(&rwlock);
+    r = inet_wait_reply(sock);
+    ret = r->ret_value;
+    inet_reply_done(sock, r);
 
     return ret;
 }
 
 static int inet_accept(register struct socket *sock, struct socket *newsock, int flags)
 {
-    register struct tdb_accept *cmd;
+    struct tdb_accept cmd;
+    struct tdb_return_data *r;
     int ret;
 
     debug_tune("INET(%P) accept wait sock %x newsock %x\n", sock, newsock);
-    cmd = (struct tdb_accept *)get_tdout_buf();
-    cmd->cmd = TDC_ACCEPT;
-    cmd->sock = sock;
-    cmd->newsock = newsock;
-    cmd->nonblock = flags & O_NONBLOCK;
+    cmd.cmd = TDC_ACCEPT;
+    cmd.sock = sock;
+    cmd.newsock = newsock;
+    cmd.nonblock = flags & O_NONBLOCK;
 
-    tcpdev_inetwrite(cmd, sizeof(struct tdb_accept));
+    ret = inet_command(sock, &cmd, sizeof(struct tdb_accept), NULL, 0);
+    if (ret < 0)
+        return ret;
 
     /* Sleep until tcpdev has news */
     do {        /* always sleep once to prevent accept race condition #1082 */
@@ -241,16 +326,20 @@ static int inet_accept(register struct socket *sock, struct socket *newsock, int
         //interruptible_sleep_on(newsock->wait);
 
         if (current->signal) {
-            debug_net("INET(%P) accept RESTARTSYS bufin %d\n", bufin_sem);
+            /* a late reply stays queued for the restarted accept */
+            debug_net("INET(%P) accept RESTARTSYS\n");
+            sock->flags &= ~SF_WAITREPLY;
             return -ERESTARTSYS;
         }
-    } while (bufin_sem == 0);
+    } while (!(r = tcpdev_find_reply(sock)));
 
     debug_tune("INET(%P) accepted sock %x newsock %x\n", sock, newsock);
-    newsock->remaddr = ((struct tdb_accept_ret *)tdin_buf)->addr_ip;
-    newsock->remport = ((struct tdb_accept_ret *)tdin_buf)->addr_port;
-    ret = ((struct tdb_accept_ret *)tdin_buf)->ret_value;
-    tcpdev_clear_data_avail();
+    ret = r->ret_value;
+    if (r->type == TDT_ACCEPT) {
+        newsock->remaddr = ((struct tdb_accept_ret *)r)->addr_ip;
+        newsock->remport = ((struct tdb_accept_ret *)r)->addr_port;
+    }
+    inet_reply_done(sock, r);
     if (ret >= 0) {
         newsock->state = SS_CONNECTED;
         ret = 0;
@@ -258,13 +347,140 @@ static int inet_accept(register struct socket *sock, struct socket *newsock, int
     return ret;
 }
 
-static int inet_read(struct socket *sock, char *ubuf, int size, int nonblock)
+static int inet_read(struct socket *sock, char *ubuf, int size, int nonblock);
+static int inet_write(struct socket *sock, char *ubuf, int size, int nonblock);
+
+/*
+ * Datagrams bypass the reply handshake used for stream writes: the
+ * datagram is copied into a tcpdev slot and sendto returns at once.
+ */
+static int inet_send_dgramv(struct socket *sock, struct iovec *iov, int size,
+                            __u32 addr, __u16 port)
+{
+    struct tdb_sendto cmd;
+    int ret;
+
+    if ((unsigned int)size > TDB_WRITE_MAX)
+        return -EMSGSIZE;
+    if ((ret = inet_autobind(sock)) < 0)
+        return ret;
+
+    cmd.cmd = TDC_SENDTO;
+    cmd.sock = sock;
+    cmd.size = size;
+    cmd.addr_ip = addr;
+    cmd.addr_port = port;
+    debug_net("INET(%P) sendto sock %x size %d\n", sock, size);
+
+    ret = tcpdev_inetwritev(&cmd, sizeof(struct tdb_sendto), iov, 0, size);
+    return (ret < 0 ? ret : size);
+}
+
+static int inet_send_dgram(struct socket *sock, char *ubuf, int size,
+                           __u32 addr, __u16 port)
+{
+    struct iovec iov;
+
+    iov.iov_base = ubuf;
+    iov.iov_len = size;
+    return inet_send_dgramv(sock, &iov, size, addr, port);
+}
+
+static int inet_sendto(struct socket *sock, char *ubuf, int size, int nonblock,
+                       struct sockaddr *uaddr, size_t addrlen)
 {
-    register struct tdb_read *cmd;
+    struct sockaddr_in sin;
+
+    if (sock->type != SOCK_DGRAM)
+        return inet_write(sock, ubuf, size, nonblock);
+
+    if (!uaddr) {
+        if (sock->state != SS_CONNECTED)
+            return -EDESTADDRREQ;
+        return inet_send_dgram(sock, ubuf, size, sock->remaddr, sock->remport);
+    }
+
+    if (addrlen < sizeof(struct sockaddr_in))
+        return -EINVAL;
+    memcpy_fromfs(&sin, uaddr, sizeof(struct sockaddr_in));
+    if (sin.sin_family != AF_INET)
+        return -EINVAL;
+    return inet_send_dgram(sock, ubuf, size, sin.sin_addr.s_addr, sin.sin_port);
+}
+
+/*
+ * Receive one datagram. ktcp answers at once from its queue, or holds
+ * the request and answers as soon as a datagram arrives. A reply that
+ * arrives after a signal stays queued for the next receive.
+ */
+static int inet_recvfrom(struct socket *sock, char *ubuf, int size, int nonblock,
+                         struct sockaddr *uaddr, int *uaddrlen)
+{
+    struct tdb_read cmd;
+    struct tdb_return_data *r;
+    struct sockaddr_in sin;
     int ret;
 
-    debug_net("INET(%P) read sock %x size %d nonblock %d bufin %d\n",
-           sock, size, nonblock, bufin_sem);
+    if (sock->type != SOCK_DGRAM)
+        return inet_read(sock, ubuf, size, nonblock);
+
+    if ((ret = inet_autobind(sock)) < 0)
+        return ret;
+
+    if (!(r = tcpdev_find_reply(sock))) {
+        if (nonblock && sock->avail_data == 0)
+            return -EAGAIN;
+
+        cmd.cmd = TDC_RECVFROM;
+        cmd.sock = sock;
+        cmd.size = size;
+        cmd.nonblock = nonblock;
+        ret = inet_command(sock, &cmd, sizeof(struct tdb_read), NULL, 0);
+        if (ret < 0)
+            return ret;
+
+        while (!(r = tcpdev_find_reply(sock))) {
+            interruptible_sleep_on(sock->wait);
+            if (current->signal) {
+                sock->flags &= ~SF_WAITREPLY;
+                wake_up(sock->wait);
+                return -EINTR;
+            }
+        }
+    }
+
+    ret = r->ret_value;
+    if (r->type == TDT_RECVFROM) {
+        if (ret > size)
+            ret = size;         /* excess datagram bytes are discarded */
+        tcpdev_reply_data(r, ubuf, (size_t) ret);
+        sin.sin_family = AF_INET;
+        sin.sin_addr.s_addr = ((struct tdb_recvfrom_ret *)r)->addr_ip;
+        sin.sin_port = ((struct tdb_recvfrom_ret *)r)->addr_port;
+    }
+    inet_reply_done(sock, r);
+    debug_net("INET(%P) recvfrom sock %x returns %d\n", sock, ret);
+
+    if (ret >= 0 && uaddr && uaddrlen) {
+        int err = move_addr_to_user((char *)&sin, sizeof(struct sockaddr_in),
+                                    (char *)uaddr, uaddrlen);
+        if (err < 0)
+            return err;
+    }
+    return ret;
+}
+
+static int inet_read(struct socket *sock, char *ubuf, int size, int nonblock)
+{
+    struct tdb_read cmd;
+    struct tdb_return_data *r;
+    int ret, count;
+
+    debug_net("INET(%P) read sock %x size %d nonblock %d\n",
+           sock, size, nonblock);
+
+    if (sock->type == SOCK_DGRAM)
+        return inet_recvfrom(sock, ubuf, size, nonblock, NULL, NULL);
 
     if (size > TCPDEV_MAXREAD)
         size = TCPDEV_MAXREAD;
@@ -275,59 +491,73 @@ static int inet_read(struct socket *sock, char *ubuf, int size, int nonblock)
         if (sock->flags & SF_CLOSING)
             return 0;
 
-        debug_net("INET(%P) read waiting on sock->avail_data sock %x buf_in %d\n",
-            sock, bufin_sem);
+        debug_net("INET(%P) read waiting on sock->avail_data sock %x\n", sock);
 
         interruptible_sleep_on(sock->wait);
         if (current->signal)
             return -EINTR;
     }
 
-    down(&rwlock);
-    cmd = (struct tdb_read *)get_tdout_buf();
-    cmd->cmd = TDC_READ;
-    cmd->sock = sock;
-    cmd->size = size;
-    cmd->nonblock = nonblock;
-    tcpdev_inetwrite(cmd, sizeof(struct tdb_read));
-
-    debug_net("INET(%P) read waiting on wait %x, bufin %d\n",
-        sock->wait, bufin_sem);
-
-    /* Sleep until tcpdev has news and we have a lock on the buffer */
-    while (bufin_sem == 0) {
-        debug_net("INET(%P) read WAIT sock %x bufin_sem\n", sock);
-        interruptible_sleep_on(sock->wait);
-    }
-    debug_net("INET(%P) read wait done bufin_sem %d\n", bufin_sem);
+    cmd.cmd = TDC_READ;
+    cmd.sock = sock;
+    cmd.size = size;
+    cmd.nonblock = nonblock;
+    ret = inet_command(sock, &cmd, sizeof(struct tdb_read), NULL, 0);
+    if (ret < 0)
+        return ret;
 
-    down(&sock->sem);
-    ret = ((struct tdb_return_data *)tdin_buf)->ret_value;
+    /* Sleep until tcpdev has news for this socket */
+    r = inet_wait_reply(sock);
+    ret = r->ret_value;
 
     if (ret > 0) {
         debug_net("INET(%P) READ %u ask %u avail %u\n",
             ret, size, sock->avail_data);
 
-        memcpy_tofs(ubuf, &((struct tdb_return_data *)tdin_buf)->data,
-            (size_t) ((struct tdb_return_data *)tdin_buf)->size);
+        /* ktcp streams reads larger than a reply slot as consecutive chunks */
+        count = 0;
+        for (;;) {
+            tcpdev_reply_data(r, ubuf + count, (size_t) r->size);
+            count += r->size;
+            if (count >= ret || r->size == 0)
+                break;
+            tcpdev_clear_data_avail(r);
+            r = inet_wait_reply(sock);
+        }
+        ret = count;
+
+        down(&sock->sem);
         sock->avail_data = 0;
+        up(&sock->sem);
     } else debug_net("INET(%P) READ %d ask %u avail %u\n",
         ret, size, sock->avail_data);
 
-    up(&sock->sem);
-
-    tcpdev_clear_data_avail();
-    up(&rwlock);
+    inet_reply_done(sock, r);
     return ret;
 }
 
-static int inet_write(register struct socket *sock, char *ubuf, int size,
-                      int nonblock)
+/*
+ * Stream data is sent in TDC_WRITE commands of up to TDB_WRITE_MAX bytes,
+ * each gathered from as many iov entries as fit, so a writev of a header
+ * and a body reaches ktcp as a single command.
+ */
+static int inet_writev(register struct socket *sock, struct iovec *iov, int iovcnt,
+                       int nonblock)
 {
-    register struct tdb_write *cmd;
-    int ret, usize, count;
+    struct tdb_write cmd;
+    struct tdb_return_data *r;
+    unsigned int skip, usize, n;
+    int ret, size, count, i;
 
+    for (size = 0, i = 0; i < iovcnt; i++)
+        size += iov[i].iov_len;
     debug("INET(%P) write sock %x size %d nonblock %d\n", sock, size, nonblock);
+    if (sock->type == SOCK_DGRAM) {
+        if (sock->state != SS_CONNECTED)
+            return -EDESTADDRREQ;
+        return inet_send_dgramv(sock, iov, size, sock->remaddr, sock->remport);
+    }
+
     if (size <= 0)
         return 0;
 
@@ -338,51 +568,73 @@ static int inet_write(register struct socket *sock, char *ubuf, int size,
         return -EINVAL;
 
     count = size;
+    skip = 0;
     while (count) {
-        down(&rwlock);
-        cmd = (struct tdb_write *)get_tdout_buf();
-        cmd->cmd = TDC_WRITE;
-        cmd->sock = sock;
-        cmd->nonblock = nonblock;
-        cmd->size = count > TDB_WRITE_MAX ? TDB_WRITE_MAX : count;
-
-        debug_net("INET(%P) WRITE %u\n", cmd->size);
-
-        memcpy_fromfs(cmd->data, ubuf, (size_t) cmd->size);
-        usize = cmd->size;
-        tcpdev_inetwrite(cmd, sizeof(struct tdb_write));
-
-        /* Sleep until tcpdev has news and we have a lock on the buffer */
-        while (bufin_sem == 0) {
-            debug_net("INET(%P) write WAIT sock %x\n", sock);
-            interruptible_sleep_on(sock->wait);
+        while (iov->iov_len == skip) {  /* skip empty and finished entries */
+            iov++;
+            skip = 0;
         }
-        debug_net("INET(%P) write WAIT done bufin_sem %d\n", bufin_sem);
+        cmd.cmd = TDC_WRITE;
+        cmd.sock = sock;
+        cmd.nonblock = nonblock;
+        cmd.size = count > TDB_WRITE_MAX ? TDB_WRITE_MAX : count;
+        usize = cmd.size;
+
+        debug_net("INET(%P) WRITE %u\n", usize);
 
-        ret = ((struct tdb_return_data *)tdin_buf)->ret_value;
+        /* user data is copied straight into the tcpdev payload slot */
+        ret = inet_commandv(sock, &cmd, sizeof(struct tdb_write), iov, skip, usize);
+        if (ret < 0)
+            return (count == size)? ret: size - count;
+
+        /* Sleep until tcpdev has news for this socket */
+        r = inet_wait_reply(sock);
+        ret = r->ret_value;
 
         debug_net("INET(%P) write retval %d\n", ret);
-        tcpdev_clear_data_avail();
-        up(&rwlock);
+        inet_reply_done(sock, r);
 
         if (ret < 0) {
             if (ret == -ERESTARTSYS) {
-                /* delay process 100ms*/
-                current->state = TASK_INTERRUPTIBLE;
+                if (nonblock)       /* send window full */
+                    return (count == size)? -EAGAIN: size - count;
+                /* wait for TDT_WINDOW from ktcp, at most 100ms*/
                 current->timeout = jiffies + (HZ / 10); /* 1/10 sec = 100ms*/
-                schedule();
+                prepare_to_wait_interruptible(sock->wait);
+                do_wait();
+                finish_wait(sock->wait);
+                current->timeout = 0;
             } else
                 return ret;
         }
         else {
             count -= usize;
-            ubuf += usize;
+            while (usize) {             /* advance past the data sent */
+                n = iov->iov_len - skip;
+                if (n > usize) {
+                    skip += usize;
+                    break;
+                }
+                usize -= n;
+                iov++;
+                skip = 0;
+            }
         }
     }
 
     return size;
 }
 
+static int inet_write(register struct socket *sock, char *ubuf, int size,
+                      int nonblock)
+{
+    struct iovec iov;
+
+    iov.iov_base = ubuf;
+    iov.iov_len = size;
+    return inet_writev(sock, &iov, 1, nonblock);
+}
+
 
 static int inet_select(register struct socket *sock, int sel_type)
 {
@@ -390,7 +642,7 @@ static int inet_select(register struct socket *sock, int sel_type)
          sock, sock->wait, sel_type, sock->avail_data);
 
     if (sel_type == SEL_IN) {
-        if (sock->avail_data || sock->state != SS_CONNECTED)
+        if (sock->avail_data || (sock->state != SS_CONNECTED && sock->type != SOCK_DGRAM))
             return 1;
         else {
             select_wait(sock->wait);
@@ -439,6 +691,38 @@ static int inet_getname(struct socket *sock, struct sockaddr *usockaddr,
                                     (char *)usockaddr, usockaddr_len);
 }
 
+/*
+ * Called by sys_setsockopt with the option value already in kernel space.
+ * Unbound sockets pass the receive buffer size and TCP_NODELAY to ktcp
+ * with the bind.
+ */
+static int inet_setsockopt(register struct socket *sock, int level, int option,
+                           int value)
+{
+    struct tdb_setopt cmd;
+    struct tdb_return_data *r;
+    int ret;
+
+    if ((!sock->localport && sock->state != SS_CONNECTED) || sock->type == SOCK_DGRAM)
+        return 0;
+    if (!tcpdev_inuse)
+        return -ENETDOWN;
+
+    cmd.cmd = TDC_SETOPT;
+    cmd.sock = sock;
+    cmd.level = level;
+    cmd.option = option;
+    cmd.value = value;
+    ret = inet_command(sock, &cmd, sizeof(struct tdb_setopt), NULL, 0);
+    if (ret < 0)
+        return ret;
+
+    r = inet_wait_reply(sock);
+    ret = r->ret_value;
+    inet_reply_done(sock, r);
+    return ret;
+}
+
 int not_implemented(void)
 {
     debug("not_implemented\n");
@@ -464,12 +748,13 @@ static struct proto_ops inet_proto_ops = {
     inet_listen,
     inet_send,
     inet_recv,
-    not_implemented,    /* inet_sendto */
-    not_implemented,    /* inet_recvfrom */
+    inet_sendto,
+    inet_recvfrom,
     not_implemented,    /* inet_shutdown */
-    not_implemented,    /* inet_setsockopt */
+    inet_setsockopt,    /* inet_setsockopt */
     not_implemented,    /* inet_getsockopt */
     not_implemented,    /* inet_fcntl */
+    inet_writev,
 };
 
 /*@+type@*/
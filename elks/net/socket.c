@@ -17,6 +17,7 @@
 
 #include <linuxmt/errno.h>
 #include <linuxmt/socket.h>
+#include <linuxmt/in.h>
 #include <linuxmt/net.h>
 #include <linuxmt/fs.h>
 #include <linuxmt/mm.h>
@@ -79,6 +80,7 @@ static struct socket *sock_alloc(void)
 {
     static struct socket ini_sock = {	/* order dependent on net.h! */
 	SS_UNCONNECTED, /* state */
+	SOCK_STREAM,	/* type */
 	NULL,		/* wait */
 	0,		/* flags */
 	0,		/* rcv_bufsiz */
@@ -182,6 +184,27 @@ static size_t sock_write(struct inode *inode, struct file *file,
     return sock->ops->write(sock, ubuf, size, (file->f_flags & O_NONBLOCK));
 }
 
+/*
+ * Write a kernel copy of a verified user iovec in a single protocol send.
+ * Returns -ENOSYS if the protocol has no writev, in which case sys_writev
+ * writes each entry in turn.
+ */
+int sock_writev(struct inode *inode, struct file *file, struct iovec *iov, int iovcnt)
+{
+    register struct socket *sock;
+
+    if (!(sock = socki_lookup(inode)))
+	return -EBADF;
+
+    if (sock->flags & SF_ACCEPTCON)
+	return -EINVAL;
+
+    if (!sock->ops->writev)
+	return -ENOSYS;
+
+    return sock->ops->writev(sock, iov, iovcnt, (file->f_flags & O_NONBLOCK));
+}
+
 static int sock_select(struct inode *inode, struct file *file, int sel_type)
 {
     register struct socket *sock;
@@ -517,13 +540,13 @@ int sys_socket(int family, int type, int protocol)
     if (ops == NULL)
 	return -EINVAL;
 
-    if (type != SOCK_STREAM)
+    if (type != SOCK_STREAM && (type != SOCK_DGRAM || !ops->sendto))
 	return -EINVAL;
 
     if (!(sock = sock_alloc()))
 	return -ENOSR;
 
-    //sock->type = type;
+    sock->type = type;
     sock->ops = ops;
     if ((fd = sock->ops->create(sock, protocol)) < 0) {
 	sock_release(sock);
@@ -556,6 +579,17 @@ int sys_setsockopt(int fd, int level, int option_name, void *option_value,
     if (flags < 0)
 	return flags;
 
+    if (level == IPPROTO_TCP) {
+	if (option_name != TCP_NODELAY || option_len != sizeof(int)
+	    || !sock->ops->setsocketopt)
+	    return -EINVAL;
+	memcpy_fromfs(&setoption, option_value, sizeof(int));
+	if (setoption)
+	    sock->flags |= SF_NODELAY;
+	else sock->flags &= ~SF_NODELAY;
+	return sock->ops->setsocketopt(sock, level, option_name, setoption);
+    }
+
     switch (option_name) {
     case SO_LINGER:
 	if (option_len != sizeof(struct linger))
@@ -573,6 +607,9 @@ int sys_setsockopt(int fd, int level, int option_name, void *option_value,
 	memcpy_fromfs(&setoption, option_value, sizeof(int));
 	if (option_name == SO_RCVBUF) {
 	    sock->rcv_bufsiz = setoption;
+	    /* let the protocol resize an existing connection's buffer */
+	    if (sock->ops->setsocketopt)
+		return sock->ops->setsocketopt(sock, SOL_SOCKET, SO_RCVBUF, setoption);
 	    return 0;
 	}
 	flags = SF_REUSE_ADDR;
@@ -602,4 +639,49 @@ int sys_getsocknam(int fd, struct sockaddr *usockaddr, int *usockaddr_len, int p
     return sock->ops->getname(sock, usockaddr, usockaddr_len, peer);
 }
 
+/*
+ * sendto and recvfrom without their flags argument, which no protocol
+ * supports, to fit five syscall arguments. libc supplies the wrappers.
+ */
+int sys_sndto(int fd, char *ubuf, size_t size, struct sockaddr *uaddr, int addrlen)
+{
+    register struct socket *sock;
+    struct file *file;
+    int err;
+
+    if (!(sock = sockfd_lookup(fd, &file)))
+	return -ENOTSOCK;
+
+    if (!sock->ops->sendto)
+	return -EOPNOTSUPP;
+
+    if ((err = verify_area(VERIFY_READ, ubuf, size)) < 0)
+	return err;
+
+    if (uaddr && (err = check_addr_to_kernel(uaddr, addrlen)) < 0)
+	return err;
+
+    return sock->ops->sendto(sock, ubuf, size, (file->f_flags & O_NONBLOCK),
+	uaddr, addrlen);
+}
+
+int sys_rcvfrom(int fd, char *ubuf, size_t size, struct sockaddr *uaddr, int *uaddrlen)
+{
+    register struct socket *sock;
+    struct file *file;
+    int err;
+
+    if (!(sock = sockfd_lookup(fd, &file)))
+	return -ENOTSOCK;
+
+    if (!sock->ops->recvfrom)
+	return -EOPNOTSUPP;
+
+    if ((err = verify_area(VERIFY_WRITE, ubuf, size)) < 0)
+	return err;
+
+    return sock->ops->recvfrom(sock, ubuf, size, (file->f_flags & O_NONBLOCK),
+	uaddr, uaddrlen);
+}
+
 #endif /* CONFIG_SOCKET */
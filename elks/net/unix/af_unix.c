@@ -15,6 +15,7 @@
 #include <linuxmt/mm.h>
 #include <linuxmt/stat.h>
 #include <linuxmt/fcntl.h>
+#include <linuxmt/heap.h>
 #include <linuxmt/debug.h>
 
 #include <arch/segment.h>
@@ -37,7 +38,11 @@ static struct unix_proto_data *unix_data_alloc(void)
 	    upd->socket = NULL;
 	    upd->sockaddr_len = 0;
 	    upd->sockaddr_un.sun_family = 0;
-	    upd->bp_head = upd->bp_tail = 0;
+	    upd->buf = NULL;
+	    upd->seg = NULL;
+	    upd->bufsize = 0;
+	    upd->bp_head = upd->bp_tail = upd->bp_len = 0;
+	    upd->post = NULL;
 	    upd->inode = NULL;
 	    upd->peerupd = NULL;
 	    upd->sem = 0;
@@ -64,6 +69,64 @@ static struct unix_proto_data *unix_data_lookup(struct sockaddr_un *sockun,
 }
 
 
+/*
+ * Receive buffers are allocated from the kernel local heap, except for
+ * those enlarged past UN_MAX_NEAR with SO_RCVBUF, which are allocated
+ * from main memory. All copies use fmemcpyb so either works.
+ */
+static int unix_buf_alloc(struct unix_proto_data *upd, int size)
+{
+    segment_s *seg = NULL;
+    unsigned char *base = NULL;
+
+    if (size > UN_MAX_NEAR) {
+	if (!(seg = seg_alloc((segext_t)((size + 15) >> 4), SEG_FLAG_SOCK)))
+	    return -ENOMEM;
+	size = seg->size << 4;
+    } else if (!(base = heap_alloc(size, HEAP_TAG_SOCK)))
+	return -ENOMEM;
+    upd->seg = seg;
+    upd->buf = base;
+    upd->bufsize = size;
+    return 0;
+}
+
+static void unix_buf_free(struct unix_proto_data *upd)
+{
+    if (upd->seg)
+	seg_put(upd->seg);
+    else heap_free(upd->buf);
+    upd->seg = NULL;
+    upd->buf = NULL;
+    upd->bufsize = 0;
+}
+
+/* Resize receive buffer, preserving any data in it */
+static int unix_buf_resize(struct unix_proto_data *upd, int size)
+{
+    struct unix_proto_data old = *upd;
+    int chars, error;
+
+    if (size < 0 || size > UN_MAX_BUFSIZ) return -EINVAL;
+    if (size < UN_BUFSIZ) size = UN_BUFSIZ;
+    if (size < upd->bp_len) return -EBUSY;
+    if (upd->sem < 0) return -EAGAIN;
+    if ((error = unix_buf_alloc(upd, size)) < 0)
+	return error;
+
+    /* copy old contents to start of new buffer */
+    chars = old.bufsize - old.bp_tail;
+    if (chars > old.bp_len) chars = old.bp_len;
+    fmemcpyb(upd->buf, UN_BUF_SEG(upd), old.buf + old.bp_tail, UN_BUF_SEG(&old), chars);
+    if (chars < old.bp_len)
+	fmemcpyb(upd->buf + chars, UN_BUF_SEG(upd), old.buf, UN_BUF_SEG(&old),
+	    old.bp_len - chars);
+    upd->bp_tail = 0;
+    upd->bp_head = old.bp_len;
+    unix_buf_free(&old);
+    return 0;
+}
+
 static void unix_data_ref(struct unix_proto_data *upd)
 {
     if (upd)
@@ -72,8 +135,10 @@ static void unix_data_ref(struct unix_proto_data *upd)
 
 static void unix_data_deref(struct unix_proto_data *upd)
 {
-    if (upd->refcnt == 1)
-	upd->bp_head = upd->bp_tail = 0;
+    if (upd->refcnt == 1) {
+	upd->bp_head = upd->bp_tail = upd->bp_len = 0;
+	unix_buf_free(upd);
+    }
     --upd->refcnt;
 }
 
@@ -87,6 +152,11 @@ static int unix_create(struct socket *sock, int protocol)
     if (!(upd = unix_data_alloc()))
 	return -ENOMEM;
 
+    if (unix_buf_alloc(upd, UN_BUFSIZ) < 0) {
+	upd->refcnt = 0;
+	return -ENOMEM;
+    }
+
     upd->socket = sock;
     sock->data = upd;
     upd->refcnt = 1;
@@ -274,6 +344,8 @@ static int unix_accept(struct socket *sock, struct socket *newsock, int flags)
     UN_DATA(newsock)->peerupd = UN_DATA(clientsock);
     UN_DATA(newsock)->sockaddr_un = UN_DATA(sock)->sockaddr_un;
     UN_DATA(newsock)->sockaddr_len = UN_DATA(sock)->sockaddr_len;
+    if (sock->rcv_bufsiz)	/* inherit listening socket SO_RCVBUF */
+	unix_buf_resize(UN_DATA(newsock), sock->rcv_bufsiz);
     wake_up_interruptible(clientsock->wait);
 
 #if UNUSED
@@ -303,12 +375,14 @@ static int unix_getname(struct socket *sock,
 static int unix_read(struct socket *sock, char *ubuf, int size, int nonblock)
 {
     struct unix_proto_data *upd;
+    struct unix_post post;
     int todo, avail;
 
     if ((todo = size) <= 0)
 	return 0;
 
     upd = UN_DATA(sock);
+    post.done = 0;
 
     while (!(avail = UN_BUF_AVAIL(upd))) {
 	if (sock->state != SS_CONNECTED)
@@ -317,10 +391,23 @@ static int unix_read(struct socket *sock, char *ubuf, int size, int nonblock)
 	if (nonblock)
 	    return -EAGAIN;
 
+	/* post our buffer so a writer can copy directly into it */
+	if (!upd->post) {
+	    post.buf = ubuf;
+	    post.task = current;
+	    post.count = size;
+	    upd->post = &post;
+	}
+
 	sock->flags |= SF_WAITDATA;
 	interruptible_sleep_on(sock->wait);
 	sock->flags &= ~SF_WAITDATA;
 
+	if (upd->post == &post)
+	    upd->post = NULL;
+	if (post.done)
+	    return post.done;
+
 	if (current->signal /* & ~current->blocked */ )
 	    return -ERESTARTSYS;
     }
@@ -334,20 +421,16 @@ static int unix_read(struct socket *sock, char *ubuf, int size, int nonblock)
     do {
 	int part, cando;
 
-	if (avail <= 0) {
-	    printk("UNIX: read: avail is negative (%d)\n", avail);
-	    send_sig(SIGKILL, current, 1);
-	    return -EPIPE;
-	}
-
 	if ((cando = todo) > avail)
 	    cando = avail;
 
-	if (cando > (part = UN_BUF_SIZE - upd->bp_tail))
+	if (cando > (part = upd->bufsize - upd->bp_tail))
 	    cando = part;
 
-	memcpy_tofs(ubuf, upd->buf + upd->bp_tail, cando);
-	upd->bp_tail = (upd->bp_tail + cando) & (UN_BUF_SIZE - 1);
+	fmemcpyb(ubuf, current->t_regs.ds, upd->buf + upd->bp_tail, UN_BUF_SEG(upd), cando);
+	if ((upd->bp_tail += cando) >= upd->bufsize)
+	    upd->bp_tail = 0;
+	upd->bp_len -= cando;
 	ubuf += cando;
 	todo -= cando;
 
@@ -368,6 +451,7 @@ static int unix_read(struct socket *sock, char *ubuf, int size, int nonblock)
 static int unix_write(struct socket *sock, char *ubuf, int size, int nonblock)
 {
     struct unix_proto_data *pupd;
+    struct unix_post *post;
     int todo, space;
 
     if ((todo = size) <= 0)
@@ -383,17 +467,35 @@ static int unix_write(struct socket *sock, char *ubuf, int size, int nonblock)
 
     pupd = UN_DATA(sock)->peerupd;	/* safer than sock->conn */
 
+    /* hand off directly to a reader waiting on an empty buffer */
+    if ((post = pupd->post) && !UN_BUF_AVAIL(pupd)
+#ifdef CONFIG_SEG_SWAP
+	    && !(post->task->mm.seg_data->flags & SEG_FLAG_SWAPPED)
+#endif
+	    ) {
+	int cando = (todo > post->count)? post->count: todo;
+
+	fmemcpyb(post->buf, post->task->t_regs.ds, ubuf, current->t_regs.ds, cando);
+	post->done = cando;
+	pupd->post = NULL;
+	ubuf += cando;
+	todo -= cando;
+	wake_up_interruptible(sock->conn->wait);
+	if (!todo || nonblock)
+	    return (size - todo);
+    }
+
     while (!(space = UN_BUF_SPACE(pupd))) {
 	sock->flags |= SF_NOSPACE;
 
 	if (nonblock)
-	    return -EAGAIN;
+	    return (todo == size)? -EAGAIN: (size - todo);
 
 	sock->flags &= ~SF_NOSPACE;
 	interruptible_sleep_on(sock->wait);
 
 	if (current->signal /* & ~current->blocked */ )
-	    return -ERESTARTSYS;
+	    return (todo == size)? -ERESTARTSYS: (size - todo);
 
 	if (sock->state == SS_DISCONNECTING) {
 	    send_sig(SIGPIPE, current, 1);
@@ -410,12 +512,6 @@ static int unix_write(struct socket *sock, char *ubuf, int size, int nonblock)
     do {
 	int part, cando;
 
-	if (space <= 0) {
-	    printk("UNIX: write: space is negative (%d)\n", space);
-	    send_sig(SIGKILL, current, 1);
-	    return -EPIPE;
-	}
-
 	/*
 	 *      We may become disconnected inside this loop, so watch
 	 *      for it (peerupd is safe until we close).
@@ -430,11 +526,13 @@ static int unix_write(struct socket *sock, char *ubuf, int size, int nonblock)
 	if ((cando = todo) > space)
 	    cando = space;
 
-	if (cando > (part = UN_BUF_SIZE - pupd->bp_head))
+	if (cando > (part = pupd->bufsize - pupd->bp_head))
 	    cando = part;
 
-	memcpy_fromfs(pupd->buf + pupd->bp_head, ubuf, cando);
-	pupd->bp_head = (pupd->bp_head + cando) & (UN_BUF_SIZE - 1);
+	fmemcpyb(pupd->buf + pupd->bp_head, UN_BUF_SEG(pupd), ubuf, current->t_regs.ds, cando);
+	if ((pupd->bp_head += cando) >= pupd->bufsize)
+	    pupd->bp_head = 0;
+	pupd->bp_len += cando;
 
 	ubuf += cando;
 	todo -= cando;
@@ -512,6 +610,17 @@ static int unix_select(struct socket *sock, int sel_type)
     return 0;
 }
 
+/* SO_RCVBUF resizes the receive buffer, which may be in far memory */
+static int unix_setsockopt(struct socket *sock, int level, int option_name, int value)
+{
+    if (level != SOL_SOCKET || option_name != SO_RCVBUF)
+	return -EINVAL;
+
+    if (sock->flags & SF_ACCEPTCON)	/* applied to accepted sockets */
+	return 0;
+    return unix_buf_resize(UN_DATA(sock), value);
+}
+
 static int unix_listen(struct socket *sock, int backlog)
 {
     return 0;
@@ -559,7 +668,7 @@ struct proto_ops unix_proto_ops = {
     NULL,			/* sendto */
     NULL,			/* recvfrom */
     NULL,			/* shutdown */
-    NULL,			/* setsockopt */
+    unix_setsockopt,
     NULL,			/* getsockopt */
     NULL			/* fcntl */
 };
@@ -7,19 +7,31 @@
 
 #define last_unix_data (unix_datas + NSOCKETS_UNIX - 1)
 #define UN_DATA(SOCK) ((struct unix_proto_data *)(SOCK)->data)
-#define UN_BUF_SIZE 64
+#define UN_BUF_AVAIL(UPD)	((UPD)->bp_len)
+#define UN_BUF_SPACE(UPD)	((UPD)->bufsize - (UPD)->bp_len)
+#define UN_BUF_SEG(UPD)		((UPD)->seg? (UPD)->seg->base: kernel_ds)
 
-#define UN_BUF_AVAIL(UPD)	(((UPD)->bp_head - (UPD)->bp_tail) & \
-							(UN_BUF_SIZE-1))
-#define UN_BUF_SPACE(UPD)	((UN_BUF_SIZE-1) - UN_BUF_AVAIL(UPD))
+struct task_struct;
+struct segment;
+
+/* user buffer posted by a reader sleeping on an empty socket */
+struct unix_post {
+    char *buf;
+    struct task_struct *task;	/* reader, whose DS may change while asleep */
+    int count;
+    int done;			/* bytes handed directly to reader by writer */
+};
 
 struct unix_proto_data {
     int refcnt;
     struct socket *socket;
     struct sockaddr_un sockaddr_un;
     short sockaddr_len;
-    char buf[UN_BUF_SIZE];
-    int bp_head, bp_tail;
+    unsigned char *buf;		/* receive buffer, offset in seg if far */
+    struct segment *seg;	/* far buffer segment or NULL if near heap */
+    int bufsize;
+    int bp_head, bp_tail, bp_len;
+    struct unix_post *post;	/* sleeping reader awaiting direct handoff */
     struct inode *inode;
     struct unix_proto_data *peerupd;
     struct wait_queue wait;
@@ -76,6 +76,7 @@ struct minix_reloc
 #define MINIX_SPLITID_AHISTORICAL ((uint32_t) 0x04300301ul)
 
 #define R_SEGWORD	80
+#define R_SEGRUN	81	/* vaddr bits 16--31 = n, then n byte deltas */
 
 #define S_TEXT		((uint16_t) -2u)
 #define S_DATA		((uint16_t) -3u)
@@ -85,6 +86,7 @@ struct minix_reloc
 static const char *me;
 static bool verbose = false, tiny = false, romable = false;
 static bool symtab = false;
+static bool reloc_runs = true;
 static bool symfile = false;
 static const char *file_name = NULL;
 static char *tmp_file_name = NULL;
@@ -101,6 +103,9 @@ static const Elf32_Shdr *text_sh = NULL, *ftext_sh = NULL, *data_sh = NULL,
 static uint32_t text_n_rels = 0, ftext_n_rels = 0, data_n_rels = 0,
 		tot_n_rels = 0;
 static struct minix_reloc *mrels = NULL;
+static struct minix_reloc *orels = NULL;
+static uint32_t text_n_orels = 0, ftext_n_orels = 0, data_n_orels = 0;
+static uint16_t data_trim = 0;
 
 static void
 error_exit (void)
@@ -169,7 +174,7 @@ error_with_help (const char *fmt, ...)
 	   "\n"
 	   "\n"
 	   "%s -- convert ELF file into ELKS executable\n"
-	   "usage: %s [-v] [--tiny] [--symtab] [--symfile file] \\\n"
+	   "usage: %s [-v] [--tiny] [--symtab] [--symfile file] [--no-reloc-runs] \\\n"
 	   "  [--aout-seg A --data-seg D] \\\n"
 	   "  [[--total-data T | --chmem C | [--stack S] [--heap H]]\n"
 	   "options:\n"
@@ -177,6 +182,8 @@ error_with_help (const char *fmt, ...)
 	   "  --tiny          output tiny model ELKS a.out\n"
 	   "  --symtab        include symbol table in output file\n"
 	   "  --symfile file  write symbol table to file\n"
+	   "  --no-reloc-runs write only single word relocations, for older\n"
+	   "                  kernels\n"
 	   "  --aout-seg A    output ROMable ELKS a.out, place a.out header\n"
 	   "                  in ROM at A:0\n"
 	   "  --data-seg D    output ROMable ELKS a.out, place data segment\n"
@@ -248,6 +255,8 @@ parse_args (int argc, char **argv)
 		tiny = true;
 	      else if (strcmp (arg + 2, "symtab") == 0)
 		symtab = true;
+	      else if (strcmp (arg + 2, "no-reloc-runs") == 0)
+		reloc_runs = false;
 	      else if (strcmp (arg + 2, "symfile") == 0)
 		{
 		    symfile = true;
@@ -709,7 +718,8 @@ output_header (void)
     mh.bseg = bss_sh->sh_size;
   if (data_sh)
     {
-      mh.dseg = data_sh->sh_size;
+      mh.dseg = data_sh->sh_size - data_trim;
+      mh.bseg += data_trim;
       if (bss_sh)
 	mh.bseg += bss_sh->sh_addr - data_sh->sh_addr - data_sh->sh_size;
     }
@@ -759,10 +769,10 @@ output_header (void)
   if (! romable && ((ftext_sh && ftext_sh->sh_size) || ftext_n_rels))
     {
       mh.hlen = sizeof mh + sizeof esuph1 + sizeof esuph2;
-      esuph1.trsize = (uint32_t) text_n_rels * sizeof (struct minix_reloc);
-      esuph1.drsize = (uint32_t) data_n_rels * sizeof (struct minix_reloc);
+      esuph1.trsize = (uint32_t) text_n_orels * sizeof (struct minix_reloc);
+      esuph1.drsize = (uint32_t) data_n_orels * sizeof (struct minix_reloc);
       esuph2.ftseg = ftext_sh->sh_size;
-      esuph2.ftrsize = (uint32_t) ftext_n_rels * sizeof (struct minix_reloc);
+      esuph2.ftrsize = (uint32_t) ftext_n_orels * sizeof (struct minix_reloc);
       output (&mh, sizeof mh);
       output (&esuph1, sizeof esuph1);
       output (&esuph2, sizeof esuph2);
@@ -770,8 +780,8 @@ output_header (void)
   else if (! romable && (text_n_rels || data_n_rels))
     {
       mh.hlen = sizeof mh + sizeof esuph1;
-      esuph1.trsize = (uint32_t) text_n_rels * sizeof (struct minix_reloc);
-      esuph1.drsize = (uint32_t) data_n_rels * sizeof (struct minix_reloc);
+      esuph1.trsize = (uint32_t) text_n_orels * sizeof (struct minix_reloc);
+      esuph1.drsize = (uint32_t) data_n_orels * sizeof (struct minix_reloc);
       output (&mh, sizeof mh);
       output (&esuph1, sizeof esuph1);
     }
@@ -780,6 +790,11 @@ output_header (void)
       mh.hlen = sizeof mh;
       output (&mh, sizeof mh);
     }
+
+  INFO ("text %" PRIu32 " far text %" PRIu32 " data %" PRIu32 " (%" PRIu16
+	" trimmed to BSS) BSS %" PRIu32 " relocs %" PRIu32 " %" PRIu32 " %" PRIu32 " bytes",
+	mh.tseg, esuph2.ftseg, mh.dseg, data_trim, mh.bseg,
+	esuph1.trsize, esuph2.ftrsize, esuph1.drsize);
 }
 
 #define R_386_SEGRELATIVE 48
@@ -831,6 +846,128 @@ convert_reloc (struct minix_reloc *pmrel, const Elf32_Rel *prel,
   pmrel->type = R_SEGWORD;
 }
 
+static int
+compare_relocs (const void *a, const void *b)
+{
+  const struct minix_reloc *ra = a, *rb = b;
+
+  if (ra->vaddr != rb->vaddr)
+    return ra->vaddr < rb->vaddr ? -1 : 1;
+  return 0;
+}
+
+/*
+ * Sort a section's relocations by address, so that the kernel applies
+ * them in a single ascending pass over the segment, and drop duplicates.
+ * Returns the new count.
+ */
+static uint32_t
+sort_relocs (struct minix_reloc *rels, uint32_t n, const char *nature)
+{
+  uint32_t i, j;
+
+  if (! n)
+    return 0;
+
+  qsort (rels, n, sizeof (struct minix_reloc), compare_relocs);
+  for (i = j = 1; i < n; ++i)
+    {
+      if (rels[i].vaddr == rels[j - 1].vaddr)
+	{
+	  if (rels[i].symndx != rels[j - 1].symndx)
+	    error ("conflicting %s relocations at %#" PRIx32, nature,
+		   rels[i].vaddr);
+	  continue;
+	}
+      if (rels[i].vaddr < rels[j - 1].vaddr + 2)
+	error ("overlapping %s relocations at %#" PRIx32, nature,
+	       rels[i].vaddr);
+      rels[j++] = rels[i];
+    }
+  if (j != n)
+    INFO ("dropped %" PRIu32 " duplicate %s reloc(s).", n - j, nature);
+  return j;
+}
+
+/*
+ * Encode a section's sorted relocations for output.  Places for the same
+ * segment that are each within 255 bytes of the last are written as an
+ * R_SEGRUN record holding the first place and the count of the rest,
+ * followed by records holding one byte delta per further place.  The
+ * kernel then applies a whole run without decoding a record per place.
+ * Returns the number of records written to out.
+ */
+static uint32_t
+encode_relocs (struct minix_reloc *out, const struct minix_reloc *rels,
+	       uint32_t n)
+{
+  uint32_t i = 0, o = 0, k, run;
+  uint8_t *deltas;
+
+  while (i < n)
+    {
+      run = 0;
+      if (reloc_runs)
+	while (i + run + 1 < n && run < 0xffffu
+	       && rels[i + run + 1].symndx == rels[i].symndx
+	       && rels[i + run + 1].vaddr - rels[i + run].vaddr <= 0xffu)
+	  ++run;
+
+      out[o] = rels[i];
+      if (run < 2)
+	{
+	  /* an R_SEGRUN of one more place is no smaller than two records */
+	  ++i;
+	  ++o;
+	  continue;
+	}
+
+      out[o].vaddr |= run << 16;
+      out[o].type = R_SEGRUN;
+      ++o;
+      deltas = (uint8_t *) &out[o];
+      memset (deltas, 0, (run + 7) / 8 * sizeof (struct minix_reloc));
+      for (k = 1; k <= run; ++k)
+	deltas[k - 1] = (uint8_t) (rels[i + k].vaddr - rels[i + k - 1].vaddr);
+      o += (run + 7) / 8;
+      i += run + 1;
+    }
+  return o;
+}
+
+/*
+ * Trailing zero bytes of the data segment need not be stored, as the
+ * kernel clears the BSS after them, so count them into the BSS instead.
+ * Relocated places must stay in the data segment.
+ */
+static void
+trim_data (void)
+{
+  Elf_Data *stuff;
+  const uint8_t *buf;
+  uint32_t size, keep = 0, ri;
+
+  if (tiny || romable || ! data)
+    return;
+
+  stuff = elf_getdata (data, NULL);
+  if (! stuff || stuff->d_size != data_sh->sh_size)
+    return;
+
+  buf = (const uint8_t *) stuff->d_buf;
+  size = stuff->d_size;
+  while (size && ! buf[size - 1])
+    --size;
+
+  for (ri = text_n_rels + ftext_n_rels; ri != tot_n_rels; ++ri)
+    if (mrels[ri].vaddr + 2 > keep)
+      keep = mrels[ri].vaddr + 2;
+  if (size < keep)
+    size = keep;
+
+  data_trim = data_sh->sh_size - size;
+}
+
 static void
 convert_relocs (void)
 {
@@ -840,7 +977,10 @@ convert_relocs (void)
   const Elf32_Rel *prel;
 
   if (! tot_n_rels)
-    return;
+    {
+      trim_data ();
+      return;
+    }
 
   /*
    * Convert ELF-format relocations to Minix-format relocations, & arrange
@@ -898,6 +1038,35 @@ convert_relocs (void)
       ++prel;
       stuff_size -= sizeof (Elf32_Rel);
     }
+
+  /* sort and deduplicate each section's relocations, keeping them packed */
+  tridx = sort_relocs (mrels, text_n_rels, "text");
+  ftridx = sort_relocs (mrels + text_n_rels, ftext_n_rels, "far text");
+  memmove (mrels + tridx, mrels + text_n_rels,
+	   ftridx * sizeof (struct minix_reloc));
+  dridx = sort_relocs (mrels + text_n_rels + ftext_n_rels, data_n_rels, "data");
+  memmove (mrels + tridx + ftridx, mrels + text_n_rels + ftext_n_rels,
+	   dridx * sizeof (struct minix_reloc));
+  text_n_rels = tridx;
+  ftext_n_rels = ftridx;
+  data_n_rels = dridx;
+  tot_n_rels = text_n_rels + ftext_n_rels + data_n_rels;
+
+  trim_data ();
+
+  /* encoding never takes more records than there are relocations */
+  orels = malloc (tot_n_rels * sizeof (struct minix_reloc));
+  if (! orels)
+    error_with_errno ("cannot create output relocations");
+
+  text_n_orels = encode_relocs (orels, mrels, text_n_rels);
+  ftext_n_orels = encode_relocs (orels + text_n_orels, mrels + text_n_rels,
+				 ftext_n_rels);
+  data_n_orels = encode_relocs (orels + text_n_orels + ftext_n_orels,
+				mrels + text_n_rels + ftext_n_rels, data_n_rels);
+
+  INFO ("%" PRIu32 " text, %" PRIu32 " far text, %" PRIu32 " data reloc "
+	"record(s). written", text_n_orels, ftext_n_orels, data_n_orels);
 }
 
 static void
@@ -918,6 +1087,9 @@ output_scn_stuff (Elf_Scn *scn, const Elf32_Shdr *shdr, uint32_t rels_start,
   if (stuff_size != shdr->sh_size)
     error ("short ELF read of %s segment", nature);
 
+  if (scn == data)
+    stuff_size -= data_trim;
+
   if (! romable || ! n_rels)
     output (stuff->d_buf, stuff_size);
   else
@@ -969,7 +1141,8 @@ static void
 output_relocs (void)
 {
   if (! romable && tot_n_rels)
-    output (mrels, tot_n_rels * sizeof (struct minix_reloc));
+    output (orels, (text_n_orels + ftext_n_orels + data_n_orels)
+		   * sizeof (struct minix_reloc));
 }
 
 static void
@@ -1019,8 +1192,8 @@ main(int argc, char **argv)
   elf_version (1);
   input_for_header ();
   create_symtab ();
-  output_header ();
   convert_relocs ();
+  output_header ();
   output_scns_stuff ();
   output_relocs ();
   output_symtab ();
@@ -11,12 +11,25 @@
 #include <getopt.h>
 #include <sys/stat.h>
 #include "minix.h"
+#include "lz.h"
 
 int keep_infile = 0;
 int verbose = 0;
 char exomizer_binary[] = "exomizer";
 
+/* format selection */
+#define FMT_AUTO	0	/* choose per binary by estimated load time */
+#define FMT_EXO		1	/* exomizer, best ratio */
+#define FMT_LZ		2	/* LZ, fastest decompression */
+int format = FMT_AUTO;
+
+/* estimated 8086 rates in KB/s used by FMT_AUTO */
+int disk_rate = 30;		/* storage read, default floppy, set by -s */
+#define EXO_RATE	8	/* exomizer decruncher output */
+#define LZ_RATE		150	/* LZ decoder output */
+
 typedef unsigned short elks_size_t;
+#define DECOMP_SAFETY	16	/* same as kernel linuxmt/fs.h */
 
 static char *readsection(int fd, int size, char *filename)
 {
@@ -69,6 +82,19 @@ error:
 	if (size != 0) goto error;
 }
 
+/*
+ * Estimated time to load a section stored in size bytes that decompresses
+ * to orig bytes at rate KB/s, in units of about a millisecond.
+ */
+static long load_time(long size, long orig, int rate)
+{
+	long t = size * 1000 / disk_rate;
+
+	if (rate)
+		t += orig * 1000 / rate;
+	return t;
+}
+
 static int compress(char *infile, char *outfile, int do_text, int do_ftext, int do_data)
 {
 	int ifd, ofd, efd, n;
@@ -78,6 +104,10 @@ static int compress(char *infile, char *outfile, int do_text, int do_ftext, int
 	elks_size_t compr_sztext, compr_szdata, compr_szftext;
 	char *text, *data = NULL, *ftext = NULL;
 	char *compr_text = NULL, *compr_data = NULL, *compr_ftext = NULL;
+	char *lz_text = NULL, *lz_data = NULL, *lz_ftext = NULL;
+	int lz_sztext = 0, lz_szftext = 0, lz_szdata = 0;
+	long exo_time, lz_time;
+	int use_lz = 0;
 	struct stat sbuf;
 	struct minix_exec_hdr mh;
 	struct elks_supl_hdr eh;
@@ -137,7 +167,7 @@ static int compress(char *infile, char *outfile, int do_text, int do_ftext, int
 	if (szdata)
 		data = readsection(ifd, szdata, infile);
 
-	if (do_text)
+	if (do_text && format != FMT_LZ)
 	{
 		/*
 		 * compress text section -> ex.out
@@ -184,7 +214,7 @@ static int compress(char *infile, char *outfile, int do_text, int do_ftext, int
 		if (verbose) printf("compressed text from %d to %d\n", sztext, compr_sztext);
 	}
 
-	if (do_ftext && szftext)
+	if (do_ftext && szftext && format != FMT_LZ)
 	{
 		/*
 		 * compress fartext section -> ex.out
@@ -231,7 +261,7 @@ static int compress(char *infile, char *outfile, int do_text, int do_ftext, int
 		if (verbose) printf("compressed fartext from %d to %d\n", szftext, compr_szftext);
 	}
 
-	if (do_data && szdata)
+	if (do_data && szdata && format != FMT_LZ)
 	{
 		/*
 		 * compress data section -> ex.out
@@ -280,6 +310,63 @@ static int compress(char *infile, char *outfile, int do_text, int do_ftext, int
 	}
 
 next:
+	if (format != FMT_EXO)
+	{
+		/*
+		 * compress each section to LZ format, for programs that are
+		 * exec'd often the faster decompression may outweigh its size
+		 */
+		if (do_text)
+			lz_sztext = lz_pack((unsigned char *)text, sztext, DECOMP_SAFETY, (unsigned char **)&lz_text);
+		if (do_ftext && szftext)
+			lz_szftext = lz_pack((unsigned char *)ftext, szftext, DECOMP_SAFETY, (unsigned char **)&lz_ftext);
+		if (do_data && szdata)
+			lz_szdata = lz_pack((unsigned char *)data, szdata, DECOMP_SAFETY, (unsigned char **)&lz_data);
+		if (verbose) printf("LZ text %d ftext %d data %d\n", lz_sztext, lz_szftext, lz_szdata);
+
+		if (format == FMT_LZ)
+			use_lz = 1;
+		else
+		{
+			exo_time = load_time(eh.esh_compr_tseg? eh.esh_compr_tseg: sztext,
+					eh.esh_compr_tseg? sztext: 0, EXO_RATE) +
+				load_time(eh.esh_compr_ftseg? eh.esh_compr_ftseg: szftext,
+					eh.esh_compr_ftseg? szftext: 0, EXO_RATE) +
+				load_time(eh.esh_compr_dseg? eh.esh_compr_dseg: szdata,
+					eh.esh_compr_dseg? szdata: 0, EXO_RATE);
+			lz_time = load_time(lz_sztext? lz_sztext: sztext, lz_sztext? sztext: 0, LZ_RATE) +
+				load_time(lz_szftext? lz_szftext: szftext, lz_szftext? szftext: 0, LZ_RATE) +
+				load_time(lz_szdata? lz_szdata: szdata, lz_szdata? szdata: 0, LZ_RATE);
+			use_lz = lz_time < exo_time;
+			if (verbose) printf("load time exomizer %ld LZ %ld\n", exo_time, lz_time);
+		}
+		if (use_lz)
+		{
+			if (!lz_sztext && !lz_szftext && !lz_szdata)
+			{
+				printf("Rejecting conversion of %s: LZ compressed sections not smaller\n", infile);
+				return 2;
+			}
+			eh.esh_compr_tseg = lz_sztext;
+			eh.esh_compr_ftseg = lz_szftext;
+			eh.esh_compr_dseg = lz_szdata;
+			eh.esh_compr_flags |= ESH_COMPR_LZ;
+			do_text = lz_sztext != 0;
+			do_ftext = lz_szftext != 0;
+			do_data = lz_szdata != 0;
+			if (compr_text)		free(compr_text);
+			if (compr_ftext)	free(compr_ftext);
+			if (compr_data)		free(compr_data);
+			compr_text = lz_text;
+			compr_ftext = lz_ftext;
+			compr_data = lz_data;
+			compr_sztext = lz_sztext;
+			compr_szftext = lz_szftext;
+			compr_szdata = lz_szdata;
+			lz_text = lz_ftext = lz_data = NULL;
+		}
+	}
+
 	if ((ofd = creat(outfile, 0755)) < 0) {
 		printf("Can't create %s\n", outfile);
 		close(ifd);
@@ -308,13 +395,17 @@ next:
 	if (compr_text)		free(compr_text);
 	if (compr_ftext)	free(compr_ftext);
 	if (compr_data)		free(compr_data);
+	if (lz_text)		free(lz_text);
+	if (lz_ftext)		free(lz_ftext);
+	if (lz_data)		free(lz_data);
 
 	stat(infile, &sbuf);
 	orig_size = sbuf.st_size;
 	stat(outfile, &sbuf);
 	compr_size = sbuf.st_size;
-	printf("%s: compressed from %ld to %ld (%ld%% reduction)\n",
-		infile, orig_size, compr_size, 100 - (compr_size*100/orig_size));
+	printf("%s: compressed from %ld to %ld (%ld%% reduction%s)\n",
+		infile, orig_size, compr_size, 100 - (compr_size*100/orig_size),
+		use_lz? ", LZ": "");
 
 	return 0;
 }
@@ -386,12 +477,16 @@ error_exit:
 
 static void usage(void)
 {
-	printf("Usage: elks-compress [-vztfd] [-o outfile] file [...]\n");
+	printf("Usage: elks-compress [-vztfdxl] [-s KB/s] [-o outfile] file [...]\n");
 	printf("	-v: verbose\n"
 	       "	-z: keep input file (create input.z)\n"
 		   "	-t: compress just text section\n"
 		   "	-f: compress just fartext section\n"
-		   "	-d: compress just data section\n");
+		   "	-d: compress just data section\n"
+		   "	-x: use exomizer format (best ratio)\n"
+		   "	-l: use LZ format (fastest decompression)\n"
+		   "	-s: storage read rate for choosing between them (default %d)\n",
+		   disk_rate);
 	exit(1);
 }
 
@@ -404,7 +499,7 @@ int main(int ac, char **av)
 	int do_data = 0;
 	char outname[256];
 
-	while ((ret = getopt(ac, av, "ztfdo:")) != -1)
+	while ((ret = getopt(ac, av, "vztfdxls:o:")) != -1)
 	{
 		switch (ret)
 		{
@@ -423,6 +518,17 @@ int main(int ac, char **av)
 		case 'd':
 			do_data = 1;
 			break;
+		case 'x':
+			format = FMT_EXO;
+			break;
+		case 'l':
+			format = FMT_LZ;
+			break;
+		case 's':
+			disk_rate = atoi(optarg);
+			if (disk_rate <= 0)
+				usage();
+			break;
 		case 'o':
 			outfile = optarg;
 			break;
@@ -0,0 +1,267 @@
+/*
+ * LZ compressor for the kernel lz_decompress format
+ *
+ * Shared by elks-compress for executables and mkromfs for ROMFS blocks.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lz.h"
+
+/*
+ * LZ format, as decoded by lz_decompress in the kernel.
+ *
+ * A sequence of LZ4 style byte aligned sequences. Each starts with a token
+ * byte, the high nibble a literal count and the low nibble a match length
+ * less LZ_MINMATCH. A nibble of 15 is followed by extension bytes that are
+ * added to it, continuing while a byte is 255. The literals follow, then
+ * a 2 byte little endian match offset back from the output position and
+ * the match length extension. The last sequence has literals only and ends
+ * when the output reaches its original size.
+ *
+ * The kernel decodes exec sections in place, forwards, with the stream read
+ * to end 'slack' (DECOMP_SAFETY) bytes past the end of the output. lz_pack
+ * checks the output never overruns unread input in that layout. ROMFS
+ * blocks are decoded from ROM into a buffer, with a slack of -1.
+ */
+#define LZ_MINMATCH	4
+#define LZ_HASHBITS	13
+#define LZ_MAXCHAIN	256
+#define LZ_WINDOW	65535
+
+static int lz_hash(const unsigned char *p)
+{
+	unsigned long v = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned long)p[3] << 24);
+
+	return (int)((v * 2654435761UL) >> (32 - LZ_HASHBITS)) & ((1 << LZ_HASHBITS) - 1);
+}
+
+static int lz_length(unsigned char *out, int len)
+{
+	int n = 0;
+
+	for (len -= 15; len >= 255; len -= 255)
+		out[n++] = 255;
+	out[n++] = len;
+	return n;
+}
+
+/* find the longest match for src[pos], return its length and set *offset */
+static int lz_match(const unsigned char *src, int n, int pos, int *head, int *chain,
+	int window, int *offset)
+{
+	int best = 0, len, depth = LZ_MAXCHAIN;
+	int cand;
+
+	if (pos + LZ_MINMATCH > n)
+		return 0;
+	for (cand = head[lz_hash(src + pos)]; cand >= 0 && depth--; cand = chain[cand])
+	{
+		if (pos - cand > window || best == n - pos)
+			break;
+		if (src[cand + best] != src[pos + best])
+			continue;
+		for (len = 0; pos + len < n && src[cand + len] == src[pos + len]; len++)
+			;
+		if (len > best)
+		{
+			best = len;
+			*offset = pos - cand;
+		}
+	}
+	return best >= LZ_MINMATCH? best: 0;
+}
+
+static void lz_insert(const unsigned char *src, int n, int pos, int *head, int *chain)
+{
+	int h;
+
+	if (pos + LZ_MINMATCH > n)
+		return;
+	h = lz_hash(src + pos);
+	chain[pos] = head[h];
+	head[h] = pos;
+}
+
+/*
+ * Decode as the kernel does and return the largest amount the output
+ * gets ahead of the input, or -1 if the stream does not decode to src.
+ */
+static int lz_extra(const unsigned char *in, int clen, int *r)
+{
+	int len = 0;
+
+	while (*r < clen)
+	{
+		len += in[*r];
+		if (in[(*r)++] != 255)
+			break;
+	}
+	return len;
+}
+
+static int lz_check(const unsigned char *src, int n, const unsigned char *in, int clen)
+{
+	unsigned char *out = malloc(n + 1);
+	int w = 0, r = 0, ahead = 0;
+	int lit, len, off, c;
+
+	if (!out)
+		return -1;
+	for (;;)
+	{
+		if (r >= clen)
+			goto bad;
+		c = in[r++];
+		lit = c >> 4;
+		if (lit == 15)
+			lit += lz_extra(in, clen, &r);
+		if (lit > n - w || lit > clen - r)
+			goto bad;
+		while (lit--)
+		{
+			out[w] = in[r++];
+			if (w + 1 - r > ahead)
+				ahead = w + 1 - r;
+			w++;
+		}
+		if (w == n)
+			break;
+		if (r + 2 > clen)
+			goto bad;
+		off = in[r] | (in[r + 1] << 8);
+		r += 2;
+		len = (c & 15) + LZ_MINMATCH;
+		if ((c & 15) == 15)
+			len += lz_extra(in, clen, &r);
+		if (!off || off > w || len > n - w)
+			goto bad;
+		while (len--)
+		{
+			out[w] = out[w - off];
+			if (w + 1 - r > ahead)
+				ahead = w + 1 - r;
+			w++;
+		}
+	}
+	if (r != clen || memcmp(out, src, n))
+		goto bad;
+	free(out);
+	return ahead;
+bad:
+	free(out);
+	return -1;
+}
+
+/*
+ * Compress to LZ format with match offsets up to 'window'. Returns the
+ * compressed size, or 0 if it is not smaller or can't be decompressed in
+ * place with 'slack' bytes.
+ */
+int lz_pack_window(const unsigned char *src, int n, int window, int slack,
+	unsigned char **result)
+{
+	unsigned char *out;
+	int *head, *chain;
+	int pos = 0, anchor = 0, ins = 0, o = 0;
+	int len, off, len2, off2, lit, i, ahead;
+
+	*result = NULL;
+	out = malloc(n + n / 255 + 16);
+	head = malloc(sizeof(int) << LZ_HASHBITS);
+	chain = malloc(sizeof(int) * (n + 1));
+	if (!out || !head || !chain)
+	{
+		printf("Out of memory\n");
+		exit(1);
+	}
+	for (i = 0; i < (1 << LZ_HASHBITS); i++)
+		head[i] = -1;
+
+	while (pos < n)
+	{
+		for ( ; ins < pos; ins++)
+			lz_insert(src, n, ins, head, chain);
+		len = lz_match(src, n, pos, head, chain, window, &off);
+		if (len)
+		{
+			/* lazy evaluation: prefer a longer match one byte on */
+			lz_insert(src, n, ins++, head, chain);
+			len2 = lz_match(src, n, pos + 1, head, chain, window, &off2);
+			if (len2 > len + 1)
+			{
+				pos++;
+				len = len2;
+				off = off2;
+			}
+		}
+		if (!len)
+		{
+			pos++;
+			continue;
+		}
+
+		/* emit literals from anchor then the match */
+		lit = pos - anchor;
+		out[o++] = ((lit < 15? lit: 15) << 4) |
+			(len - LZ_MINMATCH < 15? len - LZ_MINMATCH: 15);
+		if (lit >= 15)
+			o += lz_length(out + o, lit);
+		memcpy(out + o, src + anchor, lit);
+		o += lit;
+		out[o++] = off & 255;
+		out[o++] = off >> 8;
+		if (len - LZ_MINMATCH >= 15)
+			o += lz_length(out + o, len - LZ_MINMATCH);
+
+		pos += len;
+		anchor = pos;
+		if (o >= n)
+			break;
+	}
+
+	/* last literals */
+	if (o < n)
+	{
+		lit = n - anchor;
+		out[o++] = (lit < 15? lit: 15) << 4;
+		if (lit >= 15)
+			o += lz_length(out + o, lit);
+		memcpy(out + o, src + anchor, lit);
+		o += lit;
+	}
+	free(head);
+	free(chain);
+
+	if (o >= n)
+	{
+		free(out);
+		return 0;
+	}
+	ahead = lz_check(src, n, out, o);
+	if (ahead < 0 || (slack >= 0 && ahead > n - o + slack))
+	{
+		free(out);
+		return 0;
+	}
+	*result = out;
+	return o;
+}
+
+/*
+ * Compress a section to LZ format. Returns the compressed size, or 0 if it
+ * is not smaller, over 64K or can't be decompressed in place with 'slack'
+ * bytes.
+ */
+int lz_pack(const unsigned char *src, int n, int slack, unsigned char **result)
+{
+	int o = lz_pack_window(src, n, LZ_WINDOW, slack, result);
+
+	if (o >= 65520)
+	{
+		free(*result);
+		*result = NULL;
+		return 0;
+	}
+	return o;
+}
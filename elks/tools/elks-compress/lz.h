@@ -0,0 +1,5 @@
+/* LZ compressor for the kernel lz_decompress format, see lz.c */
+
+int lz_pack(const unsigned char *src, int n, int slack, unsigned char **result);
+int lz_pack_window(const unsigned char *src, int n, int window, int slack,
+	unsigned char **result);
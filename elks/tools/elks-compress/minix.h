@@ -53,9 +53,11 @@ struct elks_supl_hdr {
     uint16	esh_compr_tseg;	/* compressed tseg size */
     uint16	esh_compr_dseg;	/* compressed dseg size* */
     uint16	esh_compr_ftseg;/* compressed ftseg size*/
-    uint16	esh_reserved;
+    uint16	esh_compr_flags;	/* compression format */
 };
 
+#define ESH_COMPR_LZ	0x0001	/* sections are LZ, not exomizer compressed */
+
 struct minix_reloc {
     uint32	r_vaddr;	/* address of place within section */
     uint16	r_symndx;	/* index into symbol table */	// 0x04
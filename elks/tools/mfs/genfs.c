@@ -33,6 +33,7 @@
 #include <fcntl.h>
 #include "minix_fs.h"
 #include "protos.h"
+#include "bitops.h"
 
 typedef unsigned short u16_t;
 typedef unsigned long u32_t;
@@ -59,6 +60,8 @@ struct inode_build_s {
 	int			dev;	/* major & minor for device */
 	u16_t		flags;
 	u32_t		blocks;	/* disk blocks required*/
+	int			ino;	/* image inode of regular file */
+	int			rank;	/* position in boot order */
 };
 typedef struct inode_build_s inode_build_t;
 
@@ -74,6 +77,14 @@ typedef struct entry_build_s entry_build_t;
 static list_root_t inodes;	/* list of inodes */
 static int	numblocks;
 static int	prefix;
+static u32	next_zone;	/* first zone to search for a free extent */
+
+/* files read at boot, copied first and in this order unless -o given */
+static char *boot_order[] = {
+	"/linux", "/bootopts", "/bin/init", "/etc/inittab", "/bin/sh", "/etc/rc.sys",
+	"/etc/profile", "/bin/clock", "/etc/mount.cfg", "/bin/date", "/bin/getty",
+	"/etc/issue", "/bin/login", "/etc/passwd", "/etc/motd", NULL
+};
 
 /* Double-linked list with near pointers */
 #define LIST_LINK \
@@ -366,12 +377,167 @@ parse_filelist(char *filelist, inode_build_t *parent_inode, char *parent_path)
 }
 
 
-/* generate filesystem commands*/
+/* rank the files in boot order, from -o file or the default list */
+static void
+rank_files(inode_build_t **files, int nfiles)
+{
+	FILE	*fp = NULL;
+	char	line[256];
+	char	*name;
+	int		i, n;
+
+	for (i = 0; i < nfiles; i++)
+		files[i]->rank = 0x7fff;
+	if (opt_bootorder) {
+		fp = fopen(opt_bootorder, "r");
+		if (!fp) die(opt_bootorder);
+	}
+	for (n = 0; ; n++) {
+		if (fp) {
+			if (!fgets(line, sizeof(line), fp))
+				break;
+			line[strcspn(line, "\r\n")] = '\0';
+			if (line[0] == '#' || line[0] == '\0')
+				continue;
+			name = line;
+		} else if ((name = boot_order[n]) == NULL)
+			break;
+		for (i = 0; i < nfiles; i++) {
+			if (!strcmp(prefix+files[i]->path, name) && files[i]->rank > n)
+				files[i]->rank = n;
+		}
+	}
+	if (fp)
+		fclose(fp);
+}
+
+static inode_build_t **sort_files;
+
+/* boot order first, then tree order */
+static int
+cmp_rank(const void *a, const void *b)
+{
+	const inode_build_t *x = *(inode_build_t * const *)a;
+	const inode_build_t *y = *(inode_build_t * const *)b;
+
+	if (x->rank != y->rank)
+		return x->rank - y->rank;
+	return x->index - y->index;
+}
+
+/* find n free contiguous zones, returns first zone or 0 */
+static u32
+find_extent(struct minix_fs_dat *fs, u32 n)
+{
+	u32 zone, run = 0;
+
+	for (zone = next_zone; zone < ZONES(fs); zone++) {
+		if (bit(fs->zone_bmap, zone - FIRSTZONE(fs) + 1))
+			run = 0;
+		else if (++run == n)
+			return zone - n + 1;
+	}
+	return 0;
+}
+
+/* store zone number at index i of an indirect block */
+static void
+set_izone(struct minix_fs_dat *fs, u8 *blk, u32 i, u32 zone)
+{
+	if (VERSION_2(fs))
+		((u32 *)blk)[i] = zone;
+	else
+		((u16 *)blk)[i] = zone;
+}
+
+/*
+ * Copy a file into one extent of contiguous zones, with its indirect
+ * blocks placed before the data, and write it in a single write.
+ * Returns -1 if no free extent is large enough.
+ */
+static int
+write_extent(struct minix_fs_dat *fs, int inode, char *path)
+{
+	FILE	*fp;
+	struct stat sb;
+	u32		nblks, meta, zone, data, i;
+	u32		zsz = VERSION_2(fs)? MINIX2_ZONESZ: MINIX_ZONESZ;
+	u8		*buf, *ind, *dind;
+
+	if (stat(path, &sb)) die("stat(%s)", path);
+	nblks = UPPER(sb.st_size, BLOCK_SIZE);
+	if (!nblks)
+		return 0;
+	if (nblks > 7 + zsz + zsz * zsz)
+		return -1;
+	meta = 0;
+	if (nblks > 7)
+		meta++;							/* indirect block */
+	if (nblks > 7 + zsz)
+		meta += 1 + UPPER(nblks - 7 - zsz, zsz);	/* double indirect and its blocks */
+	zone = find_extent(fs, meta + nblks);
+	if (!zone)
+		return -1;
+
+	buf = domalloc((meta + nblks) * BLOCK_SIZE, 0);
+	fp = fopen(path, "rb");
+	if (!fp) die(path);
+	if (fread(buf + meta * BLOCK_SIZE, 1, sb.st_size, fp) != sb.st_size)
+		die("fread(%s)", path);
+	fclose(fp);
+
+	data = zone + meta;
+	ind = buf;
+	dind = buf + BLOCK_SIZE;
+	for (i = 0; i < nblks; i++) {
+		u32 blk = i;
+		if (blk < 7) {
+			if (VERSION_2(fs))
+				INODE2(fs,inode)->i_zone[blk] = data + i;
+			else
+				INODE(fs,inode)->i_zone[blk] = data + i;
+			continue;
+		}
+		blk -= 7;
+		if (blk < zsz) {
+			set_izone(fs, ind, blk, data + i);
+			continue;
+		}
+		blk -= zsz;
+		if (blk % zsz == 0)				/* next block of double indirect */
+			set_izone(fs, dind, blk / zsz, zone + 2 + blk / zsz);
+		set_izone(fs, buf + (2 + blk / zsz) * BLOCK_SIZE, blk % zsz, data + i);
+	}
+	if (VERSION_2(fs)) {
+		if (meta > 0) INODE2(fs,inode)->i_indir_zone = zone;
+		if (meta > 1) INODE2(fs,inode)->i_dbl_indr_zone = zone + 1;
+	} else {
+		if (meta > 0) INODE(fs,inode)->i_indir_zone = zone;
+		if (meta > 1) INODE(fs,inode)->i_dbl_indr_zone = zone + 1;
+	}
+	for (i = 0; i < meta + nblks; i++)
+		mark_zone(fs, zone + i);
+	next_zone = zone + meta + nblks;
+
+	dofwrite(goto_blk(fs->fp, zone), buf, (meta + nblks) * BLOCK_SIZE);
+	free(buf);
+	return 0;
+}
+
+/*
+ * Generate filesystem commands. The directories, nodes and directory
+ * entries of all files are made first, so the directory blocks are
+ * together at the start, then the file contents are laid out in
+ * boot order, each file in one contiguous extent.
+ */
 static int 
 compile_fs(struct minix_fs_dat *fs)
 {
 		char major[32], minor[32];
 		char *av[6];
+		int nfiles = 0, i;
+
+		sort_files = domalloc(inodes.count * sizeof(inode_build_t *), -1);
 
 		/* Compile the inodes (directories, files, etc) */
 		inode_build_t  *inode_build = (inode_build_t *) inodes.node.next;
@@ -389,6 +555,8 @@ compile_fs(struct minix_fs_dat *fs)
 				av[2] = 0;
 				cmd_mkdir(fs, 2, av, sb.st_mode & 0777);
 			} else if (flags == S_IFREG) {
+				struct stat sb;
+				char filename[256];
 				if (opt_nocopyzero && !inode_build->blocks) {
 					char *p = strrchr(inode_build->path, '/');
 					if (p && *++p == '.') {
@@ -396,12 +564,22 @@ compile_fs(struct minix_fs_dat *fs)
 						continue;
 					}
 				}
-				if (opt_verbose) printf("cp %s %s\n", inode_build->path, prefix+inode_build->path);
-				av[0] = "cp";
-				av[1] = inode_build->path;
-				av[2] = prefix+inode_build->path;
-				av[3] = 0;
-				cmd_cp(fs, 3, av);
+				if (stat(inode_build->path, &sb)) die("stat(%s)",inode_build->path);
+				if (find_inode(fs, prefix+inode_build->path) != -1) {
+					/* addfs onto existing file, copy over it */
+					if (opt_verbose) printf("cp %s %s\n", inode_build->path, prefix+inode_build->path);
+					av[0] = "cp";
+					av[1] = inode_build->path;
+					av[2] = prefix+inode_build->path;
+					av[3] = 0;
+					cmd_cp(fs, 3, av);
+					continue;
+				}
+				strcpy(filename, prefix+inode_build->path);
+				inode_build->ino = make_node(fs, filename, sb.st_mode,
+					opt_keepuid? sb.st_uid: 0, opt_keepuid? sb.st_gid: 0,
+					sb.st_size, sb.st_atime, sb.st_mtime, sb.st_ctime, NULL);
+				sort_files[nfiles++] = inode_build;
 			} else if (flags == S_IFCHR) {
 				if (opt_verbose) printf("mknod %s c %d %d\n", prefix+inode_build->path,
 					major(inode_build->dev), minor(inode_build->dev));
@@ -438,6 +616,22 @@ compile_fs(struct minix_fs_dat *fs)
 				}
 			}
 		}
+
+		/* Copy the file contents in boot order */
+		rank_files(sort_files, nfiles);
+		qsort(sort_files, nfiles, sizeof(inode_build_t *), cmp_rank);
+		next_zone = FIRSTZONE(fs);
+		for (i = 0; i < nfiles; i++) {
+			inode_build = sort_files[i];
+			if (opt_verbose) printf("cp %s %s\n", inode_build->path, prefix+inode_build->path);
+			if (write_extent(fs, inode_build->ino, inode_build->path) < 0) {
+				FILE *fp = fopen(inode_build->path, "rb");
+				if (!fp) die(inode_build->path);
+				writefile(fs, fp, inode_build->ino);	/* no free extent, fragment */
+				fclose(fp);
+			}
+		}
+		free(sort_files);
 		return 0;
 }
 
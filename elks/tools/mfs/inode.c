@@ -443,6 +443,29 @@ void write_inoblk(struct minix_fs_dat *fs,int inode,u32 blk,u8 *buf) {
     dofwrite(goto_blk(fs->fp,zone),buf,BLOCK_SIZE);
   }
 }
+/**
+ * Allocate a file's indirect block ahead of its data, so that a file
+ * written in one go gets contiguous zones the boot loader can read in
+ * a few multi-sector reads.
+ * @param fs - filesystem structure
+ * @param inode - inode to allocate for
+ */
+void alloc_indirect(struct minix_fs_dat *fs,int inode) {
+  u8 blk[BLOCK_SIZE];
+  u32 zone;
+
+  if (VERSION_2(fs) ? INODE2(fs,inode)->i_indir_zone : INODE(fs,inode)->i_indir_zone)
+    return;
+  zone = get_free_block(fs);
+  mark_zone(fs,zone);
+  memset(blk,0,sizeof blk);
+  dofwrite(goto_blk(fs->fp,zone),blk,BLOCK_SIZE);
+  if (VERSION_2(fs))
+    INODE2(fs,inode)->i_indir_zone = zone;
+  else
+    INODE(fs,inode)->i_indir_zone = zone;
+}
+
 /**
  * Free an inode block.
  * @param fs - filesystem structure
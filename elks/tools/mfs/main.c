@@ -40,6 +40,8 @@
  *	use ELKS defaults of -1 -n14 -i360 -s1440 for mkfs/genfs
  *	add genfs -k option to not copy 0 length (hidden) files starting with .
  *	add addfs option to add files/dirs specified in file from directory
+ *	genfs makes all directories first, then copies each file into one
+ *		contiguous extent in boot order, add genfs -o boot order file
  *
  * Bug fixes by ghaerr:
  * fix mkfs -1, -n overwriting -i, -n14
@@ -77,7 +79,7 @@ void usage(const char *name) {
 	"cmd:\n"
 	"	mkfs [-1|2] [-i<#inodes>] [-n<#direntlen>] [-s<#blocks>]\n"
 	"	boot <boot block image>\n"
-	"	genfs [-1|2] [-i<#inodes>] [-n<#direntlen>] [-s<#blocks>] [-k] <directory>\n"
+	"	genfs [-1|2] [-i<#inodes>] [-n<#direntlen>] [-s<#blocks>] [-k] [-o<bootorder>] <directory>\n"
 	"	addfs <file_of_filenames> <directory>\n"
 	"	[stat]\n"
 	"	ls [-ld] [filelist...]"
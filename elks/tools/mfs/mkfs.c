@@ -29,6 +29,7 @@
 #include <stdlib.h>
 
 int opt_nocopyzero = 0;		/* don't copy zero-length files starting with . */
+char *opt_bootorder;		/* file listing files in boot access order */
 
 /**
  * Parse mkfs/genfs command line arguments
@@ -44,6 +45,7 @@ int opt_nocopyzero = 0;		/* don't copy zero-length files starting with . */
  * -2|v -> version2
  * -i nodecount
  * -s nblocks
+ * -o bootorder
  */
 void parse_mkfs(int argc,char **argv,int *magic_p,int *nblks_p,int *inodes_p) {
   int c;
@@ -54,7 +56,7 @@ void parse_mkfs(int argc,char **argv,int *magic_p,int *nblks_p,int *inodes_p) {
     
   optind = 1;
   while (1) {
-    c = getoptX(argc,argv,"12vi:n:s:k");
+    c = getoptX(argc,argv,"12vi:n:s:ko:");
     if (c == -1) break;
     switch (c) {
     case '1':
@@ -78,6 +80,9 @@ void parse_mkfs(int argc,char **argv,int *magic_p,int *nblks_p,int *inodes_p) {
 	case 'k':
 		opt_nocopyzero = 1;
 		break;
+	case 'o':
+		opt_bootorder = optarg;
+		break;
     default:
       usage(argv[0]);
     }
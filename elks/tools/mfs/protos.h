@@ -30,6 +30,7 @@ void ino_freezone(struct minix_fs_dat *fs, struct minix_inode *ino, int blk);
 int read_inoblk(struct minix_fs_dat *fs, int inode, u32 blk, u8 *buf);
 void write_inoblk(struct minix_fs_dat *fs, int inode, u32 blk, u8 *buf);
 void free_inoblk(struct minix_fs_dat *fs, int inode, u32 blk);
+void alloc_indirect(struct minix_fs_dat *fs, int inode);
 void trunc_inode(struct minix_fs_dat *fs, int inode, u32 sz);
 int find_inode(struct minix_fs_dat *fs, const char *path);
 void set_inode(struct minix_fs_dat *fs, int inode, int mode, int nlinks, int uid, int gid, u32 size, u32 atime, u32 mtime, u32 ctime, int clr);
@@ -75,6 +76,7 @@ extern int opt_fsbad_fatal;
 extern char *toolname;
 
 extern int opt_nocopyzero;
+extern char *opt_bootorder;
 
 extern char *optarg;
 extern int opterr;
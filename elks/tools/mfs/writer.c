@@ -40,7 +40,10 @@ void writefile(struct minix_fs_dat *fs,FILE *fp,int inode) {
   int j,bsz,blkcnt = 0;
   u32 count = 0;
   u8 blk[BLOCK_SIZE];
+  struct stat sb;
 
+  if (fstat(fileno(fp),&sb) == 0 && sb.st_size > 7 * BLOCK_SIZE)
+    alloc_indirect(fs,inode);
   do {
     bsz = fread(blk,1,BLOCK_SIZE,fp);
     if (!bsz) break;
@@ -101,6 +101,7 @@
 #include <termios.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <sys/mman.h>
 #if LINUX
 #include <mntent.h>
 #endif
@@ -125,6 +126,8 @@
 static char * program_name = "fsck.minix";
 static char * device_name = NULL;
 static int IN;
+static char *image;		/* read-only mapping of the device, or NULL */
+static off_t image_size;
 static int repair=0, automatic=0, verbose=1, list=0, show=0, warn_mode=0, 
 	force=1;
 static int directory=0, regular=0, blockdev=0, chardev=0, links=0,
@@ -390,6 +393,25 @@ check_zone_nr2 (unsigned int *nr, int *corrected) {
 	return 0;
 }
 
+/*
+ * map_image maps the whole device read-only where the host allows it,
+ * so block reads are copies from memory rather than a seek and read each.
+ * Writes still go through write(), which the shared mapping sees.
+ */
+static void
+map_image(void) {
+	struct stat st;
+	void *p;
+
+	if (fstat(IN, &st) < 0 || !S_ISREG(st.st_mode) || !st.st_size)
+		return;
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, IN, 0);
+	if (p == MAP_FAILED)
+		return;
+	image = p;
+	image_size = st.st_size;
+}
+
 /*
  * read-block reads block nr into the buffer at addr.
  */
@@ -399,6 +421,10 @@ read_block(unsigned int nr, char * addr) {
 		memset(addr,0,BLOCK_SIZE);
 		return;
 	}
+	if (image && (off_t)BLOCK_SIZE*(nr+1) <= image_size) {
+		memcpy(addr, image + (off_t)BLOCK_SIZE*nr, BLOCK_SIZE);
+		return;
+	}
 	if (BLOCK_SIZE*nr != lseek(IN, BLOCK_SIZE*nr, SEEK_SET)) {
 		get_current_name();
 		printf(_("Read error: unable to seek to block in file '%s'\n"),
@@ -964,15 +990,12 @@ check_zones2 (unsigned int i) {
 }
 
 static void
-check_file(struct minix_inode * dir, unsigned int offset) {
-	static char blk[BLOCK_SIZE];
+check_file(struct minix_inode * dir, unsigned int offset, char *blk,
+	int block) {
 	struct minix_inode * inode;
 	int ino;
 	char * name;
-	int block;
 
-	block = map_block(dir,offset/BLOCK_SIZE);
-	read_block(block, blk);
 	name = blk + (offset % BLOCK_SIZE) + 2;
 	ino = * (unsigned short *) (name-2);
 	if (ino > INODES) {
@@ -1031,15 +1054,12 @@ check_file(struct minix_inode * dir, unsigned int offset) {
 }
 
 static void
-check_file2 (struct minix2_inode *dir, unsigned int offset) {
-	static char blk[BLOCK_SIZE];
+check_file2 (struct minix2_inode *dir, unsigned int offset, char *blk,
+	int block) {
 	struct minix2_inode *inode;
 	int ino;
 	char *name;
-	int block;
 
-	block = map_block2 (dir, offset / BLOCK_SIZE);
-	read_block (block, blk);
 	name = blk + (offset % BLOCK_SIZE) + 2;
 	ino = *(unsigned short *) (name - 2);
 	if (ino > INODES) {
@@ -1097,10 +1117,16 @@ check_file2 (struct minix2_inode *dir, unsigned int offset) {
 	return;
 }
 
+/*
+ * Each directory block is mapped and read once, then all of its
+ * entries are checked from the buffer.
+ */
 static void
 recursive_check(unsigned int ino) {
 	struct minix_inode * dir;
 	unsigned int offset;
+	char blk[BLOCK_SIZE];
+	int block = 0;
 
 	dir = Inode + ino;
 	if (!S_ISDIR(dir->i_mode))
@@ -1111,14 +1137,21 @@ recursive_check(unsigned int ino) {
 		       current_name);
 		errors_uncorrected = 1;
 	}
-	for (offset = 0 ; offset < dir->i_size ; offset += dirsize)
-		check_file(dir,offset);
+	for (offset = 0 ; offset < dir->i_size ; offset += dirsize) {
+		if (offset % BLOCK_SIZE == 0) {
+			block = map_block(dir,offset/BLOCK_SIZE);
+			read_block(block, blk);
+		}
+		check_file(dir,offset,blk,block);
+	}
 }
 
 static void
 recursive_check2 (unsigned int ino) {
 	struct minix2_inode *dir;
 	unsigned int offset;
+	char blk[BLOCK_SIZE];
+	int block = 0;
 
 	dir = Inode2 + ino;
 	if (!S_ISDIR (dir->i_mode))
@@ -1129,19 +1162,48 @@ recursive_check2 (unsigned int ino) {
 			current_name);
 		errors_uncorrected = 1;
 	}
-	for (offset = 0; offset < dir->i_size; offset += dirsize)
-		check_file2 (dir, offset);
+	for (offset = 0; offset < dir->i_size; offset += dirsize) {
+		if (offset % BLOCK_SIZE == 0) {
+			block = map_block2 (dir, offset / BLOCK_SIZE);
+			read_block (block, blk);
+		}
+		check_file2 (dir, offset, blk, block);
+	}
 }
 
 static int
 bad_zone(int i) {
 	char buffer[1024];
 
+	if (image)
+		return (off_t)BLOCK_SIZE*(i+1) > image_size;
 	if (BLOCK_SIZE*i != lseek(IN, BLOCK_SIZE*i, SEEK_SET))
 		die(_("seek failed in bad_zone"));
 	return (BLOCK_SIZE != read(IN, buffer, BLOCK_SIZE));
 }
 
+/*
+ * Count the bits set in map from bit first up to but not including last,
+ * a byte at a time where the whole byte is inside the range.
+ */
+static unsigned long
+count_bits(char * map, unsigned long first, unsigned long last) {
+	static const unsigned char nbits[16] =
+		{ 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+	unsigned long count = 0;
+	unsigned char c;
+
+	while (first < last && (first & 7))
+		count += bit(map, first++);
+	for ( ; first + 8 <= last ; first += 8) {
+		c = map[first >> 3];
+		count += nbits[c & 15] + nbits[c >> 4];
+	}
+	while (first < last)
+		count += bit(map, first++);
+	return count;
+}
+
 static void
 check_counts(void) {
 	int i;
@@ -1322,6 +1384,7 @@ main(int argc, char ** argv) {
 	IN = open(device_name,repair?O_RDWR:O_RDONLY);
 	if (IN < 0)
 		die(_("unable to open '%s': %s"), device_name, strerror(errno));
+	map_image();
 
 	/* unnecessary in ELKS build and for speed, remove sync*/
 	/***for (count=0 ; count<3 ; count++)
@@ -1372,16 +1435,12 @@ main(int argc, char ** argv) {
 		check();
 	}
 	if (verbose) {
-		int i, free;
+		long free;
 
-		for (i=1,free=0 ; i <= INODES ; i++)
-			if (!inode_in_use(i))
-				free++;
+		free = INODES - count_bits(inode_map, 1, INODES + 1);
 		printf(_("\n%6ld inodes used (%2ld%%) %6ld total\n"),(INODES-free),
 			100*(INODES-free)/INODES, INODES);
-		for (i=FIRSTZONE,free=0 ; i < ZONES ; i++)
-			if (!zone_in_use(i))
-				free++;
+		free = (ZONES - FIRSTZONE) - count_bits(zone_map, 1, ZONES - FIRSTZONE + 1);
 		printf(_("%6ld  zones used (%2ld%%) %6ld total\n"),
 			(ZONES-free), 100*(ZONES-free)/ZONES, ZONES);
 		printf(_("\n%6d regular files\n"
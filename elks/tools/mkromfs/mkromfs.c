@@ -19,6 +19,7 @@
 /* Common types */
 
 #include "list.h"
+#include "../elks-compress/lz.h"
 
 
 /* Super block in memory */
@@ -43,6 +44,9 @@ typedef struct super_disk_s super_disk_t;
 #define INODE_CHAR  0x0002
 #define INODE_BLOCK 0x0003
 #define INODE_LINK  0x0004
+#define INODE_TYPE  0x0007
+#define INODE_HASH  0x0008  /* directory has a hashed index after its entries */
+#define INODE_COMP  0x0010  /* file data is LZ compressed by blocks */
 
 struct inode_disk_s
 	{
@@ -54,6 +58,32 @@ struct inode_disk_s
 typedef struct inode_disk_s inode_disk_t;
 
 
+/* Compressed file */
+/* Block offsets [count + 1] from the data start, then each block of */
+/* ZBLOCK_SIZE (the last may be shorter) LZ compressed, or stored as is */
+/* when that is not smaller. ZBLOCK_SIZE must match kernel BLOCK_SIZE. */
+
+#define ZBLOCK_SIZE 1024
+
+
+/* Hashed directory index */
+/* Written after the entries of a large directory, at offset inode size: */
+/* bucket count (power of 2), bucket starts [count + 1], entry offsets */
+/* sorted by bucket. The hash must match the one in romfs_lookup(). */
+
+#define DIR_HASH_MIN 16  /* entries below which lookup stays linear */
+
+static u16_t dir_hash (char * name, int len)
+	{
+	u16_t h = 0;
+
+	while (len--)
+		h = (h << 5) - h + (byte_t) *name++;
+
+	return h;
+	}
+
+
 /* INode to build */
 
 #define ROMFS_MAX 0x100000
@@ -70,6 +100,9 @@ struct inode_build_s
 	u16_t flags;
 	off_t offset;
 	u32_t size;
+	u16_t hsize;         /* size of hashed directory index after the data */
+	u32_t zsize;         /* size of compressed data, 0 if not compressed */
+	u16_t rank;          /* position in access order list, 0 = not listed */
 	};
 
 typedef struct inode_build_s inode_build_t;
@@ -78,6 +111,8 @@ static list_root_t _inodes;  /* list of inodes */
 
 static int arglen;					/* passed filesystem prefix length*/
 static char *devfile;				/* passed special device filename*/
+static char *orderfile;				/* passed access order list filename*/
+static int compress;				/* compress regular files*/
 
 /* Entry to build */
 
@@ -130,6 +165,7 @@ static inode_build_t * inode_alloc (inode_build_t * parent, char * path)
 		{
 		inode = (inode_build_t *) malloc (sizeof (inode_build_t));
 		assert (inode);
+		memset (inode, 0, sizeof (inode_build_t));
 
 		list_init (&inode->entries);
 
@@ -370,6 +406,60 @@ static int parse_dir (inode_build_t * grand_parent_inode,
 
 #define BLOCK_SIZE 256
 
+/* Write the file as compressed blocks, return 0 and leave */
+/* inode->zsize 0 to write it as is when that is not smaller */
+
+static int compile_file_lz (int fdout, inode_build_t * inode, byte_t * data)
+	{
+	int nblocks = (inode->size + ZBLOCK_SIZE - 1) / ZBLOCK_SIZE;
+	u16_t table [ROMFS_FILE_MAX / ZBLOCK_SIZE + 1];
+	byte_t * zdata [ROMFS_FILE_MAX / ZBLOCK_SIZE];
+	int zlen [ROMFS_FILE_MAX / ZBLOCK_SIZE];
+	u32_t zsize = (nblocks + 1) * sizeof (u16_t);
+	int b, err = 0;
+
+	for (b = 0; b < nblocks; b++)
+		{
+		int len = inode->size - b * ZBLOCK_SIZE;
+		if (len > ZBLOCK_SIZE) len = ZBLOCK_SIZE;
+
+		zlen [b] = lz_pack (data + b * ZBLOCK_SIZE, len, -1, &zdata [b]);
+		if (!zlen [b])
+			{
+			zdata [b] = NULL;
+			zlen [b] = len;
+			}
+		table [b] = zsize;
+		zsize += zlen [b];
+		}
+	table [nblocks] = zsize;
+
+	if (zsize < inode->size && zsize < ROMFS_FILE_MAX)
+		{
+		if (write (fdout, table, (nblocks + 1) * sizeof (u16_t)) != (nblocks + 1) * sizeof (u16_t))
+			err = errno;
+		for (b = 0; b < nblocks && !err; b++)
+			{
+			byte_t * p = zdata [b]? zdata [b]: data + b * ZBLOCK_SIZE;
+			if (write (fdout, p, zlen [b]) != zlen [b])
+				err = errno;
+			}
+		if (err)
+			perror ("write");
+		else
+			{
+			printf ("        compressed %lu to %lu\n", inode->size, zsize);
+			inode->zsize = zsize;
+			inode->flags |= INODE_COMP;
+			}
+		}
+
+	for (b = 0; b < nblocks; b++)
+		free (zdata [b]);
+	return err;
+	}
+
+
 static int compile_file (int fdout, inode_build_t * inode)
 	{
 	int err;
@@ -388,6 +478,30 @@ static int compile_file (int fdout, inode_build_t * inode)
 
 		u16_t size = 0;
 
+		if (compress && inode->size && inode->size < ROMFS_FILE_MAX)
+			{
+			byte_t * data = malloc (inode->size);
+			assert (data);
+
+			if (read (fdin, data, inode->size) != inode->size)
+				{
+				perror ("read");
+				err = errno ? errno : EIO;
+				free (data);
+				break;
+				}
+			err = compile_file_lz (fdout, inode, data);
+			free (data);
+			if (err || inode->zsize) break;
+
+			if (lseek (fdin, 0, SEEK_SET) < 0)
+				{
+				perror ("lseek");
+				err = errno;
+				break;
+				}
+			}
+
 		while (1)
 			{
 			byte_t buf [BLOCK_SIZE];
@@ -482,6 +596,62 @@ static int compile_link (int fdout, inode_build_t * inode)
 	}
 
 
+static int compile_dir_hash (int fd, inode_build_t * inode, int n,
+	u16_t * offsets, u16_t * hashes)
+	{
+	int err;
+
+	while (1)
+		{
+		/* About two entries per bucket */
+
+		u16_t buckets = 1;
+		while (buckets * 2 < n) buckets <<= 1;
+
+		int words = 1 + buckets + 1 + n;
+		u16_t * index = calloc (words, sizeof (u16_t));
+		assert (index);
+
+		u16_t * start = index + 1;
+		u16_t * table = start + buckets + 1;
+		int b, i;
+
+		index [0] = buckets;
+
+		for (i = 0; i < n; i++)
+			start [(hashes [i] & (buckets - 1)) + 1]++;
+
+		for (b = 0; b < buckets; b++)
+			start [b + 1] += start [b];
+
+		/* Fill each bucket in entry order, using start [b] as cursor */
+
+		for (i = 0; i < n; i++)
+			table [start [hashes [i] & (buckets - 1)]++] = offsets [i];
+
+		for (b = buckets; b > 0; b--)
+			start [b] = start [b - 1];
+		start [0] = 0;
+
+		int count = write (fd, index, words * sizeof (u16_t));
+		free (index);
+		if (count != words * sizeof (u16_t))
+			{
+			err = errno;
+			break;
+			}
+
+		inode->hsize = count;
+		inode->flags |= INODE_HASH;
+
+		err = 0;
+		break;
+		}
+
+	return err;
+	}
+
+
 static int compile_dir (int fd, inode_build_t * inode)
 	{
 	int err;
@@ -490,10 +660,17 @@ static int compile_dir (int fd, inode_build_t * inode)
 		{
 		u16_t size = 0;
 		int count;
+		int n = 0;
+
+		u16_t * offsets = malloc (inode->entries.count * sizeof (u16_t));
+		u16_t * hashes = malloc (inode->entries.count * sizeof (u16_t));
+		assert (offsets && hashes);
 
 		entry_build_t * entry = (entry_build_t *) inode->entries.node.next;
 		while (entry != (entry_build_t *) &inode->entries.node)
 			{
+			offsets [n] = size;
+
 			/* Entry inode index */
 
 			count = write (fd, &entry->inode->index, sizeof (u16_t));
@@ -515,6 +692,8 @@ static int compile_dir (int fd, inode_build_t * inode)
 				break;
 				}
 
+			hashes [n++] = dir_hash (entry->name, len);
+
 			count = write (fd, &len, sizeof (byte_t));
 			if (count != sizeof (byte_t))
 				{
@@ -540,6 +719,11 @@ static int compile_dir (int fd, inode_build_t * inode)
 		inode->size = size;
 
 		err = 0;
+		if (n >= DIR_HASH_MIN)
+			err = compile_dir_hash (fd, inode, n, offsets, hashes);
+
+		free (offsets);
+		free (hashes);
 		break;
 		}
 
@@ -547,6 +731,86 @@ static int compile_dir (int fd, inode_build_t * inode)
 	}
 
 
+/*---------------------------------------------------------------------------*/
+/* Data layout order                                                         */
+/*---------------------------------------------------------------------------*/
+
+/* Read the access order list: one path per line, relative to the */
+/* filesystem root, such as "/bin/sh". The path is taken from the first */
+/* '/' in the line, so trace lines like 'open("/bin/sh", 0)' work as is. */
+
+static int read_order (void)
+	{
+	int err;
+
+	FILE * fp;
+	while (1)
+		{
+		char buf [256];
+		u16_t rank = 0;
+
+		fp = fopen (orderfile, "r");
+		if (!fp)
+			{
+			perror ("fopen");
+			err = errno;
+			break;
+			}
+
+		while (fgets (buf, sizeof (buf), fp))
+			{
+			char * path = strchr (buf, '/');
+			if (!path || buf [0] == '#') continue;
+			path [strcspn (path, "\"\', \t\r\n)")] = 0;
+
+			inode_build_t * inode = (inode_build_t *) _inodes.node.next;
+			while (inode != (inode_build_t *) &_inodes.node)
+				{
+				if (!inode->rank && !strcmp (&inode->path [arglen], path))
+					{
+					inode->rank = ++rank;
+					break;
+					}
+
+				inode = (inode_build_t *) inode->node.next;
+				}
+			}
+
+		printf ("Access order: %u files\n", rank);
+		err = 0;
+		break;
+		}
+
+	if (fp) fclose (fp);
+	return err;
+	}
+
+
+/* Directories first, root first as it has the lowest index, so path */
+/* lookups stay in the start of the image; then files in access order, */
+/* then everything else in directory-list order. */
+
+static int layout_class (inode_build_t * inode)
+	{
+	if ((inode->flags & INODE_TYPE) == INODE_DIR) return 0;
+	if (inode->rank) return 1;
+	return 2;
+	}
+
+
+static int layout_cmp (const void * p1, const void * p2)
+	{
+	inode_build_t * i1 = * (inode_build_t **) p1;
+	inode_build_t * i2 = * (inode_build_t **) p2;
+
+	int c1 = layout_class (i1);
+	int c2 = layout_class (i2);
+	if (c1 != c2) return c1 - c2;
+	if (c1 == 1 && i1->rank != i2->rank) return i1->rank - i2->rank;
+	return i1->index - i2->index;
+	}
+
+
 static int compile_fs ()
 	{
 	int err;
@@ -580,11 +844,24 @@ static int compile_fs ()
 			break;
 			}
 
-		/* Compile the inodes (directories, files, etc) */
+		/* Compile the inodes (directories, files, etc) in layout order */
 
+		inode_build_t ** layout = malloc (_inodes.count * sizeof (inode_build_t *));
+		assert (layout);
+
+		int n = 0;
 		inode_build_t * inode_build = (inode_build_t *) _inodes.node.next;
 		while (inode_build != (inode_build_t *) &_inodes.node)
 			{
+			layout [n++] = inode_build;
+			inode_build = (inode_build_t *) inode_build->node.next;
+			}
+
+		qsort (layout, n, sizeof (inode_build_t *), layout_cmp);
+
+		for (n = 0; n < _inodes.count; n++)
+			{
+			inode_build = layout [n];
 			inode_build->offset = offset;
 			u16_t flags = inode_build->flags;
 
@@ -621,8 +898,10 @@ static int compile_fs ()
 			if (err) break;
 
 			/* Align every data block on paragraph */
+			/* so that programs can be executed in place */
 
-			offset += inode_build->size;
+			offset += (inode_build->zsize ? inode_build->zsize : inode_build->size)
+				+ inode_build->hsize;
 
 			if (offset & 0xF)
 				{
@@ -634,10 +913,9 @@ static int compile_fs ()
 					break;
 					}
 				}
-
-			inode_build = (inode_build_t *) inode_build->node.next;
 			}
 
+		free (layout);
 		if (err) break;
 
 		/* Now write first data block */
@@ -675,11 +953,12 @@ static int compile_fs ()
 
 			u16_t flags = inode_build->flags;
 			inode_disk.flags = flags;
+			flags &= INODE_TYPE;
 
 			if (flags == INODE_FILE || flags == INODE_DIR || flags == INODE_LINK)
 				{
 				/* TODO: replace assert() by error */
-				assert (inode_build->size < ROMFS_FILE_MAX);
+				assert (inode_build->size + inode_build->hsize < ROMFS_FILE_MAX);
 				u16_t size = inode_build->size;
 				inode_disk.size = size;
 
@@ -738,16 +1017,26 @@ int main (int argc, char ** argv)
 		if (argc < 2)
 			{
 help:
-			puts ("usage: mkromfs [-d <devfile>] <dir>");
+			puts ("usage: mkromfs [-z] [-d <devfile>] [-o <orderfile>] <dir>");
+			puts ("  -z  compress files, compressed programs are not executed in place");
 			err = 1;
 			break;
 			}
 
-		if (argv[1][0] == '-' && argv[1][1] == 'd') {
-			++argv;
-			devfile = argv[1];
-			++argv;
-			if (argc < 4)
+		while (argv[1][0] == '-' && (argv[1][1] == 'd' || argv[1][1] == 'o' || argv[1][1] == 'z')) {
+			if (argv[1][1] == 'z') {
+				compress = 1;
+				argv++;
+				argc--;
+			} else {
+				if (argv[1][1] == 'd')
+					devfile = argv[2];
+				else
+					orderfile = argv[2];
+				argv += 2;
+				argc -= 2;
+			}
+			if (argc < 2)
 				goto help;
 		}
 
@@ -768,6 +1057,12 @@ help:
 
 		printf ("\nTotal inodes: %u\n", _inodes.count);
 
+		if (orderfile)
+			{
+			err = read_order ();
+			if (err) break;
+			}
+
 		puts ("\nCompiling file system...");
 
 		err = compile_fs ();
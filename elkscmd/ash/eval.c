@@ -673,6 +673,12 @@ evalcommand(cmd, flags, backcmd)
 		 || cmdentry.u.index == EVALCMD))) {
 		jp = makejob(cmd, 1);
 		mode = cmd->ncmd.backgnd;
+		/* simple foreground commands are spawned without a fork */
+		if (mode == 0 && cmdentry.cmdtype == CMDNORMAL
+		 && (flags & (EV_EXIT|EV_BACKCMD)) == 0
+		 && cmd->ncmd.redirect == NULL && varlist.list == NULL
+		 && spawnshell(jp, cmd, argv, cmdentry.u.index) > 0)
+			goto parent;
 		if (flags & EV_BACKCMD) {
 			mode = FORK_NOJOB;
 			if (pipe(pip) < 0)
@@ -74,6 +74,7 @@ static char sccsid[] = "@(#)exec.c	5.2 (Berkeley) 3/13/91";
 
 #define CMDTABLESIZE 31		/* should be prime */
 #define ARB 1			/* actual size determined at run time */
+#define CMDNOTFOUND 3		/* not in path, param.index is the errno */
 
 
 
@@ -323,7 +324,8 @@ hashcmd(argc, argv)  char **argv; {
 	if (argc <= 1) {
 		for (pp = cmdtable ; pp < &cmdtable[CMDTABLESIZE] ; pp++) {
 			for (cmdp = *pp ; cmdp ; cmdp = cmdp->next) {
-				printentry(cmdp);
+				if (cmdp->cmdtype != CMDNOTFOUND)
+					printentry(cmdp);
 			}
 		}
 		return 0;
@@ -338,7 +340,7 @@ hashcmd(argc, argv)  char **argv; {
 	}
 	while ((name = *argptr) != NULL) {
 		if ((cmdp = cmdlookup(name, 0)) != NULL
-		 && (cmdp->cmdtype == CMDNORMAL
+		 && (cmdp->cmdtype == CMDNORMAL || cmdp->cmdtype == CMDNOTFOUND
 		     || (cmdp->cmdtype == CMDBUILTIN && builtinloc >= 0)))
 			delete_cmd_entry();
 		find_command(name, &entry, 1);
@@ -414,8 +416,13 @@ find_command(name, entry, printerr)
 	}
 
 	/* If name is in the table, and not invalidated by cd, we're done */
-	if ((cmdp = cmdlookup(name, 0)) != NULL && cmdp->rehash == 0)
+	if ((cmdp = cmdlookup(name, 0)) != NULL && cmdp->rehash == 0) {
+		if (cmdp->cmdtype == CMDNOTFOUND) {
+			e = cmdp->param.index;
+			goto notfound;
+		}
 		goto success;
+	}
 
 	/* If %builtin not in path, check for builtin next */
 	if (builtinloc < 0 && (i = find_builtin(name)) >= 0) {
@@ -429,7 +436,7 @@ find_command(name, entry, printerr)
 
 	/* We have to search path. */
 	prev = -1;		/* where to start */
-	if (cmdp) {		/* doing a rehash */
+	if (cmdp && cmdp->cmdtype != CMDNOTFOUND) {	/* doing a rehash */
 		if (cmdp->cmdtype == CMDBUILTIN)
 			prev = builtinloc;
 		else
@@ -519,9 +526,21 @@ loop:
 		goto success;
 	}
 
-	/* We failed.  If there was an entry for this command, delete it */
-	if (cmdp)
+	/*
+	 * We failed.  A script remembers the failure, so that a loop
+	 * running a missing command does not search the path every time.
+	 * Otherwise if there was an entry for this command, delete it.
+	 */
+	if (!iflag) {
+		INTOFF;
+		cmdp = cmdlookup(name, 1);
+		cmdp->cmdtype = CMDNOTFOUND;
+		cmdp->param.index = e;
+		cmdp->rehash = 0;
+		INTON;
+	} else if (cmdp)
 		delete_cmd_entry();
+notfound:
 	if (printerr)
 		outfmt(out2, "%s: %s\n", name, errmsg(e, E_EXEC));
 	entry->cmdtype = CMDUNKNOWN;
@@ -556,7 +575,8 @@ find_builtin(name)
 
 /*
  * Called when a cd is done.  Marks all commands so the next time they
- * are executed they will be rehashed.
+ * are executed they will be rehashed.  Commands that were not found are
+ * searched for again, as a relative path entry may now find them.
  */
 
 void
@@ -566,7 +586,7 @@ hashcd() {
 
 	for (pp = cmdtable ; pp < &cmdtable[CMDTABLESIZE] ; pp++) {
 		for (cmdp = *pp ; cmdp ; cmdp = cmdp->next) {
-			if (cmdp->cmdtype == CMDNORMAL
+			if (cmdp->cmdtype == CMDNORMAL || cmdp->cmdtype == CMDNOTFOUND
 			 || (cmdp->cmdtype == CMDBUILTIN && builtinloc >= 0))
 				cmdp->rehash = 1;
 		}
@@ -624,7 +644,8 @@ changepath(newval)
 
 /*
  * Clear out command entries.  The argument specifies the first entry in
- * PATH which has changed.
+ * PATH which has changed.  Any change may find a command that was not
+ * found before.
  */
 
 STATIC void
@@ -638,7 +659,8 @@ clearcmdentry(firstchange) {
 		pp = tblp;
 		while ((cmdp = *pp) != NULL) {
 			if ((cmdp->cmdtype == CMDNORMAL && cmdp->param.index >= firstchange)
-			 || (cmdp->cmdtype == CMDBUILTIN && builtinloc >= firstchange)) {
+			 || (cmdp->cmdtype == CMDBUILTIN && builtinloc >= firstchange)
+			 || (cmdp->cmdtype == CMDNOTFOUND && firstchange < 9999)) {
 				*pp = cmdp->next;
 				ckfree(cmdp);
 			} else {
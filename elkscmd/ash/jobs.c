@@ -57,8 +57,11 @@ static char sccsid[] = "@(#)jobs.c	5.1 (Berkeley) 3/7/91";
 #include "error.h"
 #include "mystring.h"
 #include "redir.h"
+#include "exec.h"
+#include "var.h"
 #include <sys/types.h>
 #include <fcntl.h>
+#include <spawn.h>
 #include <signal.h>
 #include <errno.h>
 #include <unistd.h>
@@ -617,6 +620,64 @@ forkshell(jp, n, mode)
 
 
 
+/*
+ * Run a simple command without forking a copy of the shell.  The program
+ * is spawned straight from the search path, the shell being suspended
+ * until it execs (see posix_spawn).  Returns -1 if the command has to be
+ * run with forkshell instead, e.g. a shell script without "#!".
+ */
+
+int
+spawnshell(jp, n, argv, index)
+	union node *n;
+	struct job *jp;
+	char **argv;
+	{
+	char *path, *cmdname;
+	char **envp;
+	int pid;
+	int e;
+
+#if JOBS
+	if (jflag)
+		return -1;
+#endif
+	TRACE(("spawnshell(%%%d, 0x%x) called\n", jp - jobtab, (int)n));
+	INTOFF;
+	envp = environment();
+	if (strchr(argv[0], '/') != NULL) {
+		e = posix_spawn(&pid, argv[0], NULL, NULL, argv, envp);
+	} else {
+		e = ENOENT;
+		path = pathval();
+		while ((cmdname = padvance(&path, argv[0])) != NULL) {
+			if (--index < 0 && pathopt == NULL) {
+				e = posix_spawn(&pid, cmdname, NULL, NULL, argv, envp);
+				if (e != ENOENT && e != ENOTDIR)
+					break;
+			}
+			stunalloc(cmdname);
+		}
+	}
+	if (e != 0) {
+		INTON;
+		TRACE(("Spawn failed, errno=%d\n", e));
+		return -1;
+	}
+	if (jp) {
+		struct procstat *ps = &jp->ps[jp->nprocs++];
+		ps->pid = pid;
+		ps->status = -1;
+		ps->cmd = nullstr;
+		if (iflag && rootshell && n)
+			ps->cmd = commandtext(n);
+	}
+	INTON;
+	TRACE(("In parent shell:  spawned child = %d\n", pid));
+	return pid;
+}
+
+
 /*
  * Wait for job to finish.
  *
@@ -275,33 +275,47 @@ void listProg(uint16_t first, uint16_t last) {
     }
 }
 
-unsigned char *findProgLine(uint16_t targetLineNumber) {
-    unsigned char *p = &mem[0];
-    while (p < &mem[sysPROGEND]) {
-        uint16_t lineNum = *(uint16_t*)(p+2);
-        if (lineNum >= targetLineNumber)
-            break;
-        p+= *(uint16_t *)p;
+// offsets in mem of each program line, in line number order
+static uint16_t lineIndex[MEMORY_SIZE / 5];
+static int numLines;
+
+// index of the first line at or after the line number, by binary search
+static int findLineIndex(uint16_t targetLineNumber) {
+    int lo = 0, hi = numLines;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (*(uint16_t*)&mem[lineIndex[mid] + 2] < targetLineNumber)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
-    return p;
+    return lo;
+}
+
+unsigned char *findProgLine(uint16_t targetLineNumber) {
+    int i = findLineIndex(targetLineNumber);
+    if (i < numLines)
+        return &mem[lineIndex[i]];
+    return &mem[sysPROGEND];
 }
 
-void deleteProgLine(unsigned char *p) {
+void deleteProgLine(int i) {
+    unsigned char *p = &mem[lineIndex[i]];
     uint16_t lineLen = *(uint16_t*)p;
     sysPROGEND -= lineLen;
     memmove(p, p+lineLen, &mem[sysPROGEND] - p);
+    numLines--;
+    for (; i < numLines; i++)
+        lineIndex[i] = lineIndex[i+1] - lineLen;
 }
 
 int doProgLine(uint16_t lineNumber, unsigned char* tokenPtr, int tokensLength)
 {
     // find line of the at or immediately after the number
-    unsigned char *p = findProgLine(lineNumber);
-    uint16_t foundLine = 0;
-    if (p < &mem[sysPROGEND])
-        foundLine = *(uint16_t*)(p+2);
+    int i = findLineIndex(lineNumber);
     // if there's a line matching this one - delete it
-    if (foundLine == lineNumber)
-        deleteProgLine(p);
+    if (i < numLines && *(uint16_t*)&mem[lineIndex[i] + 2] == lineNumber)
+        deleteProgLine(i);
     // now check to see if this is an empty line, if so don't insert it
     if (*tokenPtr == TOKEN_EOL)
         return 1;
@@ -309,8 +323,10 @@ int doProgLine(uint16_t lineNumber, unsigned char* tokenPtr, int tokensLength)
     int bytesNeeded = 4 + tokensLength;	// length, linenum + tokens
     if (sysPROGEND + bytesNeeded > sysVARSTART)
         return 0;
+    uint16_t offset = (i < numLines) ? lineIndex[i] : sysPROGEND;
+    unsigned char *p = &mem[offset];
     // make room if this isn't the last line
-    if (foundLine)
+    if (i < numLines)
         memmove(p + bytesNeeded, p, &mem[sysPROGEND] - p);
     *(uint16_t *)p = bytesNeeded; 
     p += 2;
@@ -318,6 +334,11 @@ int doProgLine(uint16_t lineNumber, unsigned char* tokenPtr, int tokensLength)
     p += 2;
     memcpy(p, tokenPtr, tokensLength);
     sysPROGEND += bytesNeeded;
+    // lines after the new one have moved up
+    for (int j = numLines; j > i; j--)
+        lineIndex[j] = lineIndex[j-1] + bytesNeeded;
+    lineIndex[i] = offset;
+    numLines++;
     return 1;
 }
 
@@ -454,14 +475,36 @@ void stackMidStr(int start, int len) {
 #define VAR_TYPE_STRING		0x8
 #define VAR_TYPE_STR_ARRAY	0x10
 
+// recently found variables by name hash, held as offsets back from sysVAREND
+// since adding a variable or moving the gosub stack doesn't change those.
+// 0 is an empty slot, the cache is cleared whenever variables are moved.
+#define VAR_CACHE_SIZE		16
+static uint16_t varCache[VAR_CACHE_SIZE];
+
+static void clearVarCache() {
+    memset(varCache, 0, sizeof(varCache));
+}
+
 unsigned char *findVariable(char *searchName, int searchMask) {
-    unsigned char *p = &mem[sysVARSTART];
+    unsigned int hash = searchMask;
+    for (char *s = searchName; *s; s++)
+        hash = hash * 31 + *s;
+    uint16_t *slot = &varCache[hash & (VAR_CACHE_SIZE - 1)];
+    unsigned char *p;
+    if (*slot) {
+        p = &mem[sysVAREND - *slot];
+        if ((*(p+2) & searchMask) && strcmp((char*)p+3, searchName) == 0)
+            return p;
+    }
+    p = &mem[sysVARSTART];
     while (p < &mem[sysVAREND]) {
         int type = *(p+2);
         if (type & searchMask) {
             unsigned char *name = p+3;
-            if (strcmp((char*)name, searchName) == 0)
+            if (strcmp((char*)name, searchName) == 0) {
+                *slot = &mem[sysVAREND] - p;
                 return p;
+            }
         }
         p+= *(uint16_t *)p;
     }
@@ -470,6 +513,7 @@ unsigned char *findVariable(char *searchName, int searchMask) {
 
 void deleteVariableAt(unsigned char *pos) {
     int len = *(uint16_t *)pos;
+    clearVarCache();
     if (pos == &mem[sysVARSTART]) {
         sysVARSTART += len;
         return;
@@ -703,6 +747,8 @@ int setStrArrayElem(char *name) {
         return 0;	// out of memory
     // correct the length of the variable
     *(uint16_t*)p1 += bytesNeeded;
+    if (bytesNeeded)
+        clearVarCache();
     memmove(&mem[sysVARSTART - bytesNeeded], &mem[sysVARSTART], p - &mem[sysVARSTART]);
     // copy in the new value
     strcpy((char*)(p - bytesNeeded), newValPtr);
@@ -1624,6 +1670,7 @@ int parse_RUN(int isRestore) {
         else {
             // clear variables
             sysVARSTART = sysVAREND = sysGOSUBSTART = sysGOSUBEND = MEMORY_SIZE;
+            clearVarCache();
             jumpLineNumber = startLine;
             stopLineNumber = stopStmtNumber = 0;
             dataLineNumber = 1;
@@ -2320,11 +2367,13 @@ int processInput(unsigned char *tokenBuf) {
 void reset() {
     // program at the start of memory
     sysPROGEND = 0;
+    numLines = 0;
     // stack is at the end of the program area
     sysSTACKSTART = sysSTACKEND = sysPROGEND;
     // variables/gosub stack at the end of memory
     sysVARSTART = sysVAREND = sysGOSUBSTART = sysGOSUBEND = MEMORY_SIZE;
     memset(&mem[0], 0, MEMORY_SIZE);
+    clearVarCache();
 
     stopLineNumber = 0;
     stopStmtNumber = 0;
@@ -183,8 +183,24 @@ _PROTOTYPE(static int _do_compare, (bc_num n1, bc_num n2, int use_sign,
 _PROTOTYPE(static void _rm_leading_zeros, (bc_num num));
 _PROTOTYPE(static bc_num _do_add, (bc_num n1, bc_num n2));
 _PROTOTYPE(static bc_num _do_sub, (bc_num n1, bc_num n2));
-_PROTOTYPE(static void _one_mult, (unsigned char *num, int size, int digit,
-				   unsigned char *result));
+
+/* Multiply and divide work on digits packed into base 10000 words. */
+typedef unsigned short bc_word;
+
+#define WBASE		10000
+#define WDIGITS		4	/* decimal digits per word */
+#define KARATSUBA_MIN	16	/* smallest word count to split, below is faster */
+
+_PROTOTYPE(static bc_word *_new_words, (int count));
+_PROTOTYPE(static int _to_words, (unsigned char *digits, int count,
+				  bc_word *words));
+_PROTOTYPE(static void _from_words, (bc_word *words, int nw,
+				     unsigned char *digits, int count,
+				     int skip));
+_PROTOTYPE(static void _w_mul, (bc_word *r, bc_word *a, int na,
+				bc_word *b, int nb));
+_PROTOTYPE(static void _w_divide, (bc_word *q, bc_word *u, int nu,
+				   bc_word *v, int nv));
 
 
 
@@ -630,6 +646,326 @@ bc_sub ( n1, n2, result)
 }
 
 
+/* Word arithmetic for multiply and divide.  Word arrays are stored least
+   significant word first, each word holding WDIGITS decimal digits. */
+
+static bc_word *
+_new_words (count)
+     int count;
+{
+  bc_word *w;
+
+  w = (bc_word *) malloc ((count+1) * sizeof(bc_word));
+  if (w == NULL) out_of_memory ();
+  return w;
+}
+
+
+/* Pack COUNT decimal DIGITS, most significant first, into WORDS and
+   return the number of words. */
+
+static int
+_to_words (digits, count, words)
+     unsigned char *digits;
+     int count;
+     bc_word *words;
+{
+  int nw, i;
+  bc_word val;
+  unsigned char *dptr;
+
+  nw = 0;
+  for (i = count; i > 0; i -= WDIGITS)
+    {
+      dptr = digits + MAX(0, i-WDIGITS);
+      val = 0;
+      while (dptr < digits + i)
+	val = val * 10 + *dptr++;
+      words[nw++] = val;
+    }
+  return nw;
+}
+
+
+/* Unpack the value of NW WORDS divided by 10^SKIP into COUNT decimal
+   DIGITS, most significant first.  Missing high digits are zero. */
+
+static void
+_from_words (words, nw, digits, count, skip)
+     bc_word *words;
+     int nw;
+     unsigned char *digits;
+     int count, skip;
+{
+  int indx, d;
+  bc_word val;
+  unsigned char *dptr;
+
+  dptr = digits + count;
+  for (indx = 0; dptr > digits; indx++)
+    {
+      val = (indx < nw ? words[indx] : 0);
+      for (d = 0; d < WDIGITS && dptr > digits; d++)
+	{
+	  if (skip > 0)
+	    skip--;
+	  else
+	    *--dptr = val % 10;
+	  val /= 10;
+	}
+    }
+}
+
+
+/* R = A * B, the schoolbook way.  R has NA+NB words. */
+
+static void
+_w_school (r, a, na, b, nb)
+     bc_word *r, *a, *b;
+     int na, nb;
+{
+  int i, j;
+  unsigned long val;
+  bc_word carry;
+
+  memset (r, 0, (na+nb) * sizeof(bc_word));
+  for (i = 0; i < na; i++)
+    {
+      if (a[i] == 0) continue;
+      carry = 0;
+      for (j = 0; j < nb; j++)
+	{
+	  val = (unsigned long) a[i] * b[j] + r[i+j] + carry;
+	  r[i+j] = val % WBASE;
+	  carry = val / WBASE;
+	}
+      r[i+nb] = carry;
+    }
+}
+
+
+/* R = A + B, NA >= NB.  R has NA+1 words. */
+
+static void
+_w_add (r, a, na, b, nb)
+     bc_word *r, *a, *b;
+     int na, nb;
+{
+  int i;
+  bc_word val, carry;
+
+  carry = 0;
+  for (i = 0; i < na; i++)
+    {
+      val = a[i] + (i < nb ? b[i] : 0) + carry;
+      carry = (val >= WBASE);
+      r[i] = (carry ? val - WBASE : val);
+    }
+  r[na] = carry;
+}
+
+
+/* R -= A for R of NR words, A of NA words.  R must not be less than A. */
+
+static void
+_w_sub (r, nr, a, na)
+     bc_word *r, *a;
+     int nr, na;
+{
+  int i, val, borrow;
+
+  borrow = 0;
+  for (i = 0; i < nr && (i < na || borrow); i++)
+    {
+      val = r[i] - (i < na ? a[i] : 0) - borrow;
+      borrow = (val < 0);
+      r[i] = (borrow ? val + WBASE : val);
+    }
+}
+
+
+/* R += A for R of NR words, A of NA words.  The sum must fit in R. */
+
+static void
+_w_addto (r, nr, a, na)
+     bc_word *r, *a;
+     int nr, na;
+{
+  int i;
+  bc_word val, carry;
+
+  carry = 0;
+  for (i = 0; i < nr && (i < na || carry); i++)
+    {
+      val = r[i] + (i < na ? a[i] : 0) + carry;
+      carry = (val >= WBASE);
+      r[i] = (carry ? val - WBASE : val);
+    }
+}
+
+
+/* R = A * B.  R has NA+NB words.  Large numbers are split in halves
+   and multiplied with Karatsuba's method, needing three half size
+   products instead of four:
+     A*B = z2*W^2m + ((a1+a0)*(b1+b0) - z2 - z0)*W^m + z0
+   where z2 = a1*b1 and z0 = a0*b0. */
+
+static void
+_w_mul (r, a, na, b, nb)
+     bc_word *r, *a, *b;
+     int na, nb;
+{
+  bc_word *t, *sa, *sb, *z1;
+  int nr, m, nsa, nsb, nz1;
+
+  nr = na + nb;
+  while (na > 0 && a[na-1] == 0) na--;
+  while (nb > 0 && b[nb-1] == 0) nb--;
+  if (na < nb)
+    {
+      t = a; a = b; b = t;
+      m = na; na = nb; nb = m;
+    }
+  m = na / 2;
+  if (nb < KARATSUBA_MIN || nb <= m)
+    {
+      memset (r, 0, nr * sizeof(bc_word));
+      if (nb > 0)
+	_w_school (r, a, na, b, nb);
+      return;
+    }
+  memset (r+na+nb, 0, (nr-na-nb) * sizeof(bc_word));
+
+  /* z0 and z2 go straight into the result. */
+  _w_mul (r, a, m, b, m);
+  _w_mul (r+2*m, a+m, na-m, b+m, nb-m);
+
+  /* z1 = (a1+a0)*(b1+b0) - z2 - z0 */
+  nsa = na - m + 1;
+  nsb = MAX(m, nb-m) + 1;
+  nz1 = nsa + nsb;
+  sa = _new_words (nsa + nsb + nz1);
+  sb = sa + nsa;
+  z1 = sb + nsb;
+  _w_add (sa, a+m, na-m, a, m);
+  if (nb-m >= m)
+    _w_add (sb, b+m, nb-m, b, m);
+  else
+    _w_add (sb, b, m, b+m, nb-m);
+  _w_mul (z1, sa, nsa, sb, nsb);
+  _w_sub (z1, nz1, r, 2*m);
+  _w_sub (z1, nz1, r+2*m, na+nb-2*m);
+  while (nz1 > 0 && z1[nz1-1] == 0) nz1--;
+  _w_addto (r+m, na+nb-m, z1, nz1);
+  free (sa);
+}
+
+
+/* Q = U / V, truncated, by Knuth Vol 2. p272 algorithm D.  U has NU
+   words and room for one more, its contents are destroyed.  The top
+   word of V is not zero and NU >= NV.  Q gets NU-NV+1 words. */
+
+static void
+_w_divide (q, u, nu, v, nv)
+     bc_word *q, *u, *v;
+     int nu, nv;
+{
+  unsigned long val, qhat, rhat, prod;
+  bc_word norm, carry, vtop, vnext;
+  long diff;
+  int i, j;
+
+  /* One word divisor, short division. */
+  if (nv == 1)
+    {
+      rhat = 0;
+      for (i = nu-1; i >= 0; i--)
+	{
+	  val = rhat * WBASE + u[i];
+	  q[i] = val / v[0];
+	  rhat = val % v[0];
+	}
+      return;
+    }
+
+  /* Normalize so the top word of V is at least WBASE/2. */
+  norm = WBASE / (v[nv-1] + 1);
+  u[nu] = 0;
+  if (norm != 1)
+    {
+      carry = 0;
+      for (i = 0; i < nu; i++)
+	{
+	  val = (unsigned long) u[i] * norm + carry;
+	  u[i] = val % WBASE;
+	  carry = val / WBASE;
+	}
+      u[nu] = carry;
+      carry = 0;
+      for (i = 0; i < nv; i++)
+	{
+	  val = (unsigned long) v[i] * norm + carry;
+	  v[i] = val % WBASE;
+	  carry = val / WBASE;
+	}
+    }
+  vtop = v[nv-1];
+  vnext = v[nv-2];
+
+  for (j = nu - nv; j >= 0; j--)
+    {
+      /* Estimate the quotient word, at most one too large after this. */
+      val = (unsigned long) u[j+nv] * WBASE + u[j+nv-1];
+      qhat = val / vtop;
+      rhat = val % vtop;
+      while (qhat >= WBASE
+	     || qhat * vnext > rhat * WBASE + u[j+nv-2])
+	{
+	  qhat--;
+	  rhat += vtop;
+	  if (rhat >= WBASE) break;
+	}
+
+      /* Multiply and subtract. */
+      carry = 0;
+      diff = 0;
+      for (i = 0; i < nv; i++)
+	{
+	  prod = qhat * v[i] + carry;
+	  carry = prod / WBASE;
+	  diff = (long) u[i+j] - (long) (prod % WBASE) + diff;
+	  if (diff < 0)
+	    {
+	      u[i+j] = diff + WBASE;
+	      diff = -1;
+	    }
+	  else
+	    {
+	      u[i+j] = diff;
+	      diff = 0;
+	    }
+	}
+      diff = (long) u[j+nv] - carry + diff;
+
+      /* Add back if the estimate was one too large. */
+      if (diff < 0)
+	{
+	  qhat--;
+	  carry = 0;
+	  for (i = 0; i < nv; i++)
+	    {
+	      val = (unsigned long) u[i+j] + v[i] + carry;
+	      carry = (val >= WBASE);
+	      u[i+j] = (carry ? val - WBASE : val);
+	    }
+	  diff += carry;
+	}
+      u[j+nv] = diff;
+      q[j] = qhat;
+    }
+}
+
+
 /* The multiply routine.  N2 time N1 is put int PROD with the scale of
    the result being MIN(N2 scale+N1 scale, MAX (SCALE, N2 scale, N1 scale)).
    */
@@ -640,12 +976,9 @@ bc_multiply (n1, n2, prod, scale)
      int scale;
 {
   bc_num pval;			/* For the working storage. */
-  char *n1ptr, *n2ptr, *pvptr;	/* Work pointers. */
-  char *n1end, *n2end;		/* To the end of n1 and n2. */
-
-  int indx;
+  bc_word *w1, *w2, *wp;	/* The numbers and product in words. */
   int len1, len2, total_digits;
-  long sum;
+  int nw1, nw2;
   int full_scale, prod_scale;
   int toss;
 
@@ -658,30 +991,17 @@ bc_multiply (n1, n2, prod, scale)
   toss = full_scale - prod_scale;
   pval =  new_num (total_digits-full_scale, prod_scale);
   pval->n_sign = ( n1->n_sign == n2->n_sign ? PLUS : MINUS );
-  n1end = (char *) (n1->n_value + len1 - 1);
-  n2end = (char *) (n2->n_value + len2 - 1);
-  pvptr = (char *) (pval->n_value + total_digits - toss - 1);
-  sum = 0;
 
-  /* Here are the loops... */
-  for (indx = 0; indx < toss; indx++)
-    {
-      n1ptr = (char *) (n1end - MAX(0, indx-len2+1));
-      n2ptr = (char *) (n2end - MIN(indx, len2-1));
-      while ((n1ptr >= n1->n_value) && (n2ptr <= n2end))
-	sum += *n1ptr-- * *n2ptr++;
-      sum = sum / 10;
-    }
-  for ( ; indx < total_digits-1; indx++)
-    {
-      n1ptr = (char *) (n1end - MAX(0, indx-len2+1));
-      n2ptr = (char *) (n2end - MIN(indx, len2-1));
-      while ((n1ptr >= n1->n_value) && (n2ptr <= n2end))
-	sum += *n1ptr-- * *n2ptr++;
-      *pvptr-- = sum % 10;
-      sum = sum / 10;
-    }
-  *pvptr-- = sum;
+  /* Multiply the digits as integers, then drop the tossed scale digits. */
+  w1 = _new_words (2 * (len1 + len2) / WDIGITS + 4);
+  nw1 = _to_words ((unsigned char *) n1->n_value, len1, w1);
+  w2 = w1 + nw1;
+  nw2 = _to_words ((unsigned char *) n2->n_value, len2, w2);
+  wp = w2 + nw2;
+  _w_mul (wp, w1, nw1, w2, nw2);
+  _from_words (wp, nw1+nw2, (unsigned char *) pval->n_value,
+	       total_digits-toss, toss);
+  free (w1);
 
   /* Assign to prod and clean up the number. */
   free_num (prod);
@@ -692,50 +1012,11 @@ bc_multiply (n1, n2, prod, scale)
 }
 
 
-/* Some utility routines for the divide:  First a one digit multiply.
-   NUM (with SIZE digits) is multiplied by DIGIT and the result is
-   placed into RESULT.  It is written so that NUM and RESULT can be
-   the same pointers.  */
-
-static void
-_one_mult (num, size, digit, result)
-     unsigned char *num;
-     int size, digit;
-     unsigned char *result;
-{
-  int carry, value;
-  unsigned char *nptr, *rptr;
-
-  if (digit == 0)
-    memset (result, 0, size);
-  else
-    {
-      if (digit == 1)
-	memcpy (result, num, size);
-      else
-	{
-	  /* Initialize */
-	  nptr = (unsigned char *) (num+size-1);
-	  rptr = (unsigned char *) (result+size-1);
-	  carry = 0;
-
-	  while (size-- > 0)
-	    {
-	      value = *nptr-- * digit + carry;
-	      *rptr-- = value % 10;
-	      carry = value / 10;
-	    }
-
-	  if (carry != 0) *rptr = carry;
-	}
-    }
-}
-
-
 /* The full division routine. This computes N1 / N2.  It returns
    0 if the division is ok and the result is in QUOT.  The number of
    digits after the decimal point is SCALE. It returns -1 if division
-   by zero is tried.  The algorithm is found in Knuth Vol 2. p237. */
+   by zero is tried.  The digits are divided as integers in base 10000
+   words by _w_divide. */
 
 int
 bc_divide (n1, n2, quot, scale)
@@ -744,13 +1025,12 @@ bc_divide (n1, n2, quot, scale)
 {
   bc_num qval;
   unsigned char *num1, *num2;
-  unsigned char *ptr1, *ptr2, *n2ptr, *qptr;
-  int  scale1, val;
-  unsigned int  len1, len2, scale2, qdigits, extra, count;
-  unsigned int  qdig, qguess, borrow, carry;
-  unsigned char *mval;
+  unsigned char *n2ptr;
+  int  scale1;
+  unsigned int  len1, len2, scale2, qdigits, extra;
+  bc_word *u, *v, *q;
+  int  nu, nv;
   char zero;
-  unsigned int  norm;
 
   /* Test for divide by zero. */
   if (is_zero (n2)) return -1;
@@ -818,98 +1098,26 @@ bc_divide (n1, n2, quot, scale)
   qval = new_num (qdigits-scale,scale);
   memset (qval->n_value, 0, qdigits);
 
-  /* Allocate storage for the temporary storage mval. */
-  mval = (unsigned char *) malloc (len2+1);
-  if (mval == NULL) out_of_memory ();
-
-  /* Now for the full divide algorithm. */
+  /* Now for the full divide: the len1+scale digits of num1 from its
+     first, divided by the len2 digits of n2ptr, give the quotient
+     digits right aligned in qval. */
   if (!zero)
     {
-      /* Normalize */
-      norm =  10 / ((int)*n2ptr + 1);
-      if (norm != 1)
-	{
-	  _one_mult (num1, len1+scale1+extra+1, norm, num1);
-	  _one_mult (n2ptr, len2, norm, n2ptr);
-	}
-
-      /* Initialize divide loop. */
-      qdig = 0;
-      if (len2 > len1)
-	qptr = (unsigned char *) qval->n_value+len2-len1;
-      else
-	qptr = (unsigned char *) qval->n_value;
-
-      /* Loop */
-      while (qdig <= len1+scale-len2)
+      u = _new_words ((len1+scale) / WDIGITS + 1);
+      v = _new_words (len2 / WDIGITS + 1);
+      nu = _to_words (num1+1, len1+scale, u);
+      nv = _to_words (n2ptr, len2, v);
+      while (nu > 0 && u[nu-1] == 0) nu--;
+      if (nu >= nv)
 	{
-	  /* Calculate the quotient digit guess. */
-	  if (*n2ptr == num1[qdig])
-	    qguess = 9;
-	  else
-	    qguess = (num1[qdig]*10 + num1[qdig+1]) / *n2ptr;
-
-	  /* Test qguess. */
-	  if (n2ptr[1]*qguess >
-	      (num1[qdig]*10 + num1[qdig+1] - *n2ptr*qguess)*10
-	       + num1[qdig+2])
-	    {
-	      qguess--;
-	      /* And again. */
-	      if (n2ptr[1]*qguess >
-		  (num1[qdig]*10 + num1[qdig+1] - *n2ptr*qguess)*10
-		  + num1[qdig+2])
-		qguess--;
-	    }
-
-	  /* Multiply and subtract. */
-	  borrow = 0;
-	  if (qguess != 0)
-	    {
-	      *mval = 0;
-	      _one_mult (n2ptr, len2, qguess, mval+1);
-	      ptr1 = (unsigned char *) num1+qdig+len2;
-	      ptr2 = (unsigned char *) mval+len2;
-	      for (count = 0; count < len2+1; count++)
-		{
-		  val = (int) *ptr1 - (int) *ptr2-- - borrow;
-		  if (val < 0)
-		    {
-		      val += 10;
-		      borrow = 1;
-		    }
-		  else
-		    borrow = 0;
-		  *ptr1-- = val;
-		}
-	    }
-
-	  /* Test for negative result. */
-	  if (borrow == 1)
-	    {
-	      qguess--;
-	      ptr1 = (unsigned char *) num1+qdig+len2;
-	      ptr2 = (unsigned char *) n2ptr+len2-1;
-	      carry = 0;
-	      for (count = 0; count < len2; count++)
-		{
-		  val = (int) *ptr1 + (int) *ptr2-- + carry;
-		  if (val > 9)
-		    {
-		      val -= 10;
-		      carry = 1;
-		    }
-		  else
-		    carry = 0;
-		  *ptr1-- = val;
-		}
-	      if (carry == 1) *ptr1 = (*ptr1 + 1) % 10;
-	    }
-
-	  /* We now know the quotient digit. */
-	  *qptr++ =  qguess;
-	  qdig++;
+	  q = _new_words (nu - nv + 1);
+	  _w_divide (q, u, nu, v, nv);
+	  _from_words (q, nu-nv+1, (unsigned char *) qval->n_value,
+		       qdigits, 0);
+	  free (q);
 	}
+      free (u);
+      free (v);
     }
 
   /* Clean up and return the number. */
@@ -920,7 +1128,6 @@ bc_divide (n1, n2, quot, scale)
   *quot = qval;
 
   /* Clean up temporary storage. */
-  free (mval);
   free (num1);
   free (num2);
 
@@ -10,13 +10,35 @@
 /bin/cp
 /bin/cut
 /bin/date
-/bin/dirname
 /bin/dd
 /bin/diff
+/bin/dirname
 /bin/du
 /bin/echo
 /usr/bin/ed
 /bin/false
 /bin/fdisk
 /bin/find
+/bin/grep
+/bin/head
+/bin/ln
+/bin/ls
+/bin/mkdir
+/bin/mknod
+/bin/more
+/bin/mv
+/bin/printenv
+/bin/pwd
+/bin/rm
+/bin/rmdir
+/bin/sync
+/bin/tail
+/bin/tee
+/bin/touch
+/bin/tr
 /bin/true
+/bin/uname
+/bin/uniq
+/bin/wc
+/bin/xargs
+/bin/yes
@@ -24,6 +24,28 @@ int echo_main(int argc, char * argv[]);
 int ed_main(int argc, char * argv[]);
 int fdisk_main(int argc, char * argv[]);
 int find_main(int argc, char * argv[]);
+int grep_main(int argc, char * argv[]);
+int head_main(int argc, char * argv[]);
+int ln_main(int argc, char * argv[]);
+int ls_main(int argc, char * argv[]);
+int mkdir_main(int argc, char * argv[]);
+int mknod_main(int argc, char * argv[]);
+int more_main(int argc, char * argv[]);
+int mv_main(int argc, char * argv[]);
+int printenv_main(int argc, char * argv[]);
+int pwd_main(int argc, char * argv[]);
+int rm_main(int argc, char * argv[]);
+int rmdir_main(int argc, char * argv[]);
+int sync_main(int argc, char * argv[]);
+int tail_main(int argc, char * argv[]);
+int tee_main(int argc, char * argv[]);
+int touch_main(int argc, char * argv[]);
+int tr_main(int argc, char * argv[]);
+int uname_main(int argc, char * argv[]);
+int uniq_main(int argc, char * argv[]);
+int wc_main(int argc, char * argv[]);
+int xargs_main(int argc, char * argv[]);
+int yes_main(int argc, char * argv[]);
 
 #if defined(__cplusplus)
 }
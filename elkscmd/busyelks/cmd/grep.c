@@ -33,11 +33,12 @@
 
 /* External interfaces */
 #include <sys/types.h>
-#include <regexp.h>		/* Thanks to Henry Spencer */
+#include <regex.h>		/* Thanks to Henry Spencer */
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
+#include "cmd.h"
 
 /* Internal constants */
 #define MATCH		0	/* exit code: some match somewhere */
@@ -173,7 +174,7 @@ char *filename;
   if (FLAG('s') || FLAG('l')) {
 	while ((line = get_line(input)) != NULL) {
 		testline = FLAG('i') ? map_nocase(line) : line;
-		if (regexec(expression, testline, 1)) {
+		if (regexec(expression, testline)) {
 			status = MATCH;
 			break;
 		}
@@ -188,7 +189,7 @@ char *filename;
   while ((line = get_line(input)) != NULL) {
 	++lineno;
 	testline = FLAG('i') ? map_nocase(line) : line;
-	if (regexec(expression, testline, 1)) {
+	if (regexec(expression, testline)) {
 		status = MATCH;
 		if (!FLAG('v')) {
 			if (label != NULL)
@@ -231,7 +232,7 @@ FILE *input;
 {
   int n;
   register char *bp;
-  register int c;
+  register int c = 0;
   char *new_buf;
   size_t new_size;
 
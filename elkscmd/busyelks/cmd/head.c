@@ -5,12 +5,13 @@
 #include <stdio.h>
 #include <string.h>
 #include "../defs.h"
+#include "cmd.h"
 
 #define DEFAULT 10
 
 _PROTOTYPE(int head_main, (int argc, char **argv));
 _PROTOTYPE(void do_file, (int n, FILE *f));
-_PROTOTYPE(void head_usage, (void));
+_PROTOTYPE(static void usage, (void));
 
 int head_main(argc, argv)
 int argc;
@@ -27,7 +28,7 @@ char *argv[];
   if (argc > 1 && *ptr++ == '-') {
 	k++;
 	n = atoi(ptr);
-	if (n <= 0) head_usage();
+	if (n <= 0) usage();
   }
   nfiles = argc - k;
 
@@ -72,7 +73,7 @@ FILE *f;
 }
 
 
-void head_usage()
+static void usage()
 {
   fprintf(stderr, "Usage: head [-n] [file ...]\n");
   exit(1);
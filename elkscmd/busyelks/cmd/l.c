@@ -163,12 +163,7 @@ l_main(argc, argv)
 		for (i = 0; i < listused; i++) {
 			name = list[i];
 
-			if (lstat (name, &statbuf) < 0) {
-				perror(name);
-				free(name);
-				continue;
-			}
-
+			/* only names are shown, no need to stat */
 			cp = strrchr(name, '/');
 			if (cp)
 				cp++;
@@ -6,8 +6,6 @@
  * Most simple built-in commands are here.
  */
 
-#include "../sash.h"
-
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,6 +18,10 @@
 #include <grp.h>
 #include <utime.h>
 #include <errno.h>
+#include <limits.h>
+#include "../futils.h"
+#include "cmd.h"
+#include "lib.h"
 
 
 int ln_main(int argc, char **argv)
@@ -38,9 +40,9 @@ int ln_main(int argc, char **argv)
 
 		if (symlink(argv[2], argv[3]) < 0) {
 			perror(argv[3]);
-			exit(1);
+			return 1;
 		}
-		exit(0);
+		return 0;
 	}
 
 	/*
@@ -50,7 +52,8 @@ int ln_main(int argc, char **argv)
 	dirflag = isadir(lastarg);
 
 	if ((argc > 3) && !dirflag) {
-		fprintf(stderr, "%s: not a directory\n", lastarg);
+		errstr(lastarg);
+		errmsg(": not a directory\n");
 		goto usage;
 	}
 
@@ -70,12 +73,11 @@ int ln_main(int argc, char **argv)
 			continue;
 		}
 	}
-	exit(0);
+	return 0;
 
 usage:
-	fprintf(stderr, "usage: %s [-s] link_target link_name\n", argv[0]);
-	fprintf(stderr, "Hard links are made by default. The -s option creates symbolic links instead.\n");
-	fprintf(stderr, "Creating hard links to directories is not allowed and will return an error.\n");
-	exit(1);
+	errmsg("usage: ln [-s] link_target link_name\n");
+	errmsg("Hard links are made by default. The -s option creates symbolic links instead.\n");
+	errmsg("Creating hard links to directories is not allowed and will return an error.\n");
+	return 1;
 }
-
@@ -2,40 +2,25 @@
  * Copyright (c) 1993 by David I. Bell
  * Permission is granted to use, distribute, or modify this source,
  * provided that this copyright notice remains intact.
- *
- * Most simple built-in commands are here.
  */
 
-#include "../sash.h"
-
-#include <sys/types.h>
-#include <sys/stat.h>
+#include "../shutils.h"
 #include <unistd.h>
-#include <fcntl.h>
-#include <signal.h>
-#include <pwd.h>
-#include <grp.h>
-#include <utime.h>
-#include <errno.h>
+#include "cmd.h"
 
-void
-printenv_main(argc, argv)
-	char	**argv;
+int printenv_main(int argc, char **argv)
 {
-	char		**env;
+	char		**env = environ;
 	char		*eptr;
-	extern char	**environ;
 	int		len;
 
-	env = environ;
-
 	if (argc == 1) {
 		while (*env) {
 			eptr = *env++;
 			write(STDOUT_FILENO, eptr, strlen(eptr));
 			write(STDOUT_FILENO, "\n", 1);
 		}
-		exit(0);
+		return 0;
 	}
 
 	len = strlen(argv[1]);
@@ -46,9 +31,9 @@ printenv_main(argc, argv)
 			eptr = &env[0][len+1];
 			write(STDOUT_FILENO, eptr, strlen(eptr));
 			write(STDOUT_FILENO, "\n", 1);
-			exit(0);
+			return 0;
 		}
 		env++;
 	}
-	exit(0);
+	return 0;
 }
@@ -1,14 +1,17 @@
+#include <limits.h>
 #include <unistd.h>
 #include <string.h>
+#include "cmd.h"
 
-void pwd_main ()
+int pwd_main(int ac, char **av)
 {
-	char wd[255];
-	int i;
-	
-	getcwd(wd,255);
-	i = strlen(wd);
-	write(STDOUT_FILENO,wd,i);
-	write(STDOUT_FILENO,"\n",1);
-	exit(0);
+    char wd[PATH_MAX];
+
+    if (getcwd(wd, sizeof(wd)) == NULL) {
+        write(STDOUT_FILENO, "Cannot get current directory\n", 29);
+        return 1;
+    }
+    write(STDOUT_FILENO, wd, strlen(wd));
+    write(STDOUT_FILENO, "\n", 1);
+    return 0;
 }
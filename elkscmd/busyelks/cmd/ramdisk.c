@@ -4,7 +4,7 @@
 #include <stdlib.h>
 #include <linuxmt/rd.h>
 
-#define MAX_SIZE 640 /* 1 KB blocks */
+#define MAX_SIZE 32767 /* 1 KB blocks, over 512 requires XMS */
 
 int ramdisk_main(argc, argv)
 int argc;
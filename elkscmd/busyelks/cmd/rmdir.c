@@ -1,54 +1,54 @@
 #include <unistd.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 #include <stdio.h>
 #include <string.h>
+#include "../futils.h"
+#include "cmd.h"
 
-unsigned short newmode;
-
-int
-remove_dir(name,f)
-	char *name;
-	int f;
+static int remove_dir(char *name, int f)
 {
-	int er,era=2;
-	char *line;
-	
-	while (((er = rmdir(name)) == 0) && ((line = rindex(name,'/')) != NULL) && f) {
-		while ((line > name) && (*line == '/'))
-			--line;
-		line[1] = 0;
-		era=0;
-	}
-	return(er && era);
+    int ret, once = 1;
+    char *line;
+
+    while (((ret = rmdir(name)) == 0) && ((line = strrchr(name,'/')) != NULL) && f) {
+        while ((line > name) && (*line == '/'))
+            --line;
+        line[1] = 0;
+        once = 0;
+    }
+    return (ret && once);
 }
-	
 
-int
-rmdir_main (argc,argv)
-	int argc;
-	char **argv;
+int rmdir_main(int argc, char **argv)
 {
-	int i, parent = 0, er = 0;
-	
-	if ((argv[1][0] == '-') && (argv[1][1] == 'p'))	
-		parent = 1;
-	
-	newmode = 0666 & ~umask(0);
+    int i, parent = 0, force = 0, ret = 0;
+
+    if (argc < 2) goto usage;
+
+    while (argv[1][0] == '-') {
+        switch (argv[1][1]) {
+        case 'p': parent = 1; break;
+        case 'f': force = 1; break;
+        default: goto usage;
+        }
+        argv++;
+        argc--;
+    }
+
+    for (i = 1; i < argc; i++) {
+            while (argv[i][strlen(argv[i])-1] == '/')
+                argv[i][strlen(argv[i])-1] = '\0';
+            if (remove_dir(argv[i],parent)) {
+                errstr(argv[i]);
+                errmsg(": cannot remove directory\n");
+                if (!force)
+                    ret = 1;
+            }
+    }
+    return ret;
 
-	for(i=parent+1;i<argc;i++) {
-		if (argv[i][0] != '-') {
-			while (argv[i][strlen(argv[i])-1] == '/')
-				argv[i][strlen(argv[i])-1] = '\0';
-			if (remove_dir(argv[i],parent)) {
-				write(STDERR_FILENO,"rmdir: cannot remove directory ",31);
-				write(STDERR_FILENO,argv[i],strlen(argv[i]));
-				write(STDERR_FILENO,"\n",1);
-				er = 1;
-			}
-		} else {
-			write(STDERR_FILENO,"rmdir: usage error.\n",20);
-			exit(1);
-		}
-	}
-	exit(er);
+usage:
+    errmsg("usage: rmdir [-pf] directory [...]\n");
+    return 1;
 }
@@ -22,6 +22,7 @@ $(OBJS):	sed.h
 
 #include <ctype.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -101,6 +102,7 @@ typedef struct cmd_t sedcmd;	/* use this name for declarations */
 #define CLNUM	18		/* numeric-address index follows */
 #define CEND	20		/* symbol for end-of-source */
 #define CEOF	22		/* end-of-field mark */
+#define CLIT	24		/* literal string and its BMH shifts follow */
 
 /* Sed.h ends here */
 
@@ -146,6 +148,7 @@ long linenum[MAXLINES];		/* numeric-addresses table */
 
 /* Miscellaneous shared variables */
 int nflag;			/* -n option flag */
+int iflag;			/* -i option flag */
 int eargc;			/* scratch copy of argument count */
 char **eargv;			/* scratch copy of argument list */
 char bits[] = {1, 2, 4, 8, 16, 32, 64, 128};
@@ -227,7 +230,9 @@ _PROTOTYPE(static void resolve, (void));
 _PROTOTYPE(static char *ycomp, (char *ep, int delim));
 _PROTOTYPE(void sed_execute, (void));
 _PROTOTYPE(static int selected, (sedcmd *ipc));
+_PROTOTYPE(static char *litcomp, (char *expbuf, char *ep));
 _PROTOTYPE(static int match, (char *expbuf, int gf));
+_PROTOTYPE(static int litmatch, (char *lp, char *ep));
 _PROTOTYPE(static int advance, (char *lp, char *ep));
 _PROTOTYPE(static int substitute, (sedcmd *ipc));
 _PROTOTYPE(static void dosub, (char *rhsbuf));
@@ -236,6 +241,8 @@ _PROTOTYPE(static void listto, (char *p1, FILE *fp));
 _PROTOTYPE(static void truncated, (int h));
 _PROTOTYPE(static void command, (sedcmd *ipc));
 _PROTOTYPE(static void openfile, (char *file));
+_PROTOTYPE(static void inplace, (char *file));
+_PROTOTYPE(static void endinplace, (int keep));
 _PROTOTYPE(static void get, (void));
 _PROTOTYPE(static void initget, (void));
 _PROTOTYPE(static char *ourgetline, (char *buf));
@@ -271,6 +278,9 @@ char *argv[];
 	    case 'g':
 		gflag++;	/* set global flag on all s cmds */
 		continue;
+	    case 'i':
+		iflag++;	/* edit files in place */
+		continue;
 	    case 'n':
 		nflag++;	/* no print except on p flag or w */
 		continue;
@@ -291,10 +301,15 @@ char *argv[];
   }
   if (bdepth)			/* we have unbalanced squigglies */
 	ABORT(TMLBR);
+  if (iflag && eargc <= 0) {	/* nothing to edit in place */
+	fprintf(stderr, "sed: no input files\n");
+	exit(2);
+  }
 
   lablst->address = cmdp;	/* set up header of label linked list */
   resolve();			/* resolve label table indirections */
   sed_execute();			/* execute commands */
+  if (iflag) endinplace(1);	/* keep the last file edited in place */
   exit(0);			/* everything was O.K. if we got here */
   return(0);
 }
@@ -586,7 +601,7 @@ char redelim;			/* RE end-marker to look for */
 		if (brnestp != brnest)	/* \(, \) unbalanced */
 			return(BAD);
 		*ep++ = CEOF;	/* write end-of-pattern mark */
-		return(ep);	/* return ptr to compiled RE */
+		return(litcomp(expbuf, ep));	/* return ptr to compiled RE */
 	}
 	if (c != '*')		/* if we're a postfix op */
 		lastep = ep;	/* get ready to match last */
@@ -687,6 +702,30 @@ char redelim;			/* RE end-marker to look for */
   }
 }
 
+static char *litcomp(expbuf, ep)
+/* Recompile an unanchored RE of only literal chars for BMH search */
+char *expbuf;			/* compiled RE */
+char *ep;			/* ptr past its end */
+{
+  char lit[RELIMIT / 2];
+  register char *p;
+  int n, i;
+
+  n = 0;
+  for (p = expbuf + 1; *p == CCHR; p += 2) lit[n++] = p[1];
+  if (*expbuf || *p != CEOF || n < 2 ||	/* not literal or first char is enough */
+      expbuf + 3 + n + 256 > poolend)
+	return(ep);
+
+  p = expbuf + 1;
+  *p++ = CLIT;			/* literal mark */
+  *p++ = n;			/* length */
+  for (i = 0; i < n; i++) *p++ = lit[i];
+  for (i = 0; i < 256; i++) p[i] = n;	/* shift on last char of window */
+  for (i = 0; i < n - 1; i++) p[lit[i] & CMASK] = n - 1 - i;
+  return(p + 256);
+}
+
 static int cmdline(cbuf)	/* uses eflag, eargc, cmdf */
  /* Read next command from -e argument or command file */
 register char *cbuf;
@@ -903,6 +942,7 @@ extern long linenum[];		/* numeric-addresses table */
 
 /* Miscellaneous shared variables */
 extern int nflag;		/* -n option flag */
+extern int iflag;		/* -i option flag */
 extern int eargc;		/* scratch copy of argument count */
 extern char **eargv;		/* scratch copy of argument list */
 extern char bits[];		/* the bits table */
@@ -955,8 +995,13 @@ void sed_execute()
   /* Here's the main command-execution loop */
   for (;;) {
 
-	/* Get next line to filter */
-	if ((execp = ourgetline(linebuf)) == BAD) return;
+	/* Get next line to filter, files being edited in place one by one */
+	if ((execp = ourgetline(linebuf)) == BAD) {
+		if (!iflag || --eargc < 0) return;
+		openfile(*eargv++);
+		get();
+		continue;
+	}
 	spend = execp;
 	anysub = FALSE;
 
@@ -985,8 +1030,9 @@ void sed_execute()
 
 	/* Here's where the transformed line is output */
 	if (!nflag && !delete) {
-		for (p1 = linebuf; p1 < spend; p1++) putc(*p1, stdout);
-		putc('\n', stdout);
+		*spend = '\n';
+		fwrite(linebuf, 1, spend - linebuf + 1, stdout);
+		*spend = '\0';
 	}
 
 	/* If we've been set up for append, emit the text from it */
@@ -1052,6 +1098,8 @@ int gf;
   }
 
   p2 = expbuf;
+  if (*p2 == 0 && p2[1] == CLIT)	/* literal string */
+	return(litmatch(p1, p2 + 2));
   if (*p2++) {
 	loc1 = p1;
 	if (*p2 == CCHR && p2[1] != *p1)	/* 1st char is wrong */
@@ -1081,6 +1129,34 @@ int gf;
   return(FALSE);
 }
 
+static int litmatch(lp, ep)
+/* Find the literal string at ep in lp using its Boyer-Moore-Horspool shifts */
+register char *lp;		/* source (linebuf) ptr */
+char *ep;			/* CLIT length, string and shift table */
+{
+  register int i;
+  char *lit;
+  unsigned char *shift;
+  int n, len;
+
+  n = *ep++ & CMASK;
+  lit = ep;
+  shift = (unsigned char *) ep + n;
+  len = strlen(lp);
+  while (len >= n) {
+	for (i = n - 1; lp[i] == lit[i];)
+		if (--i < 0) {
+			loc1 = lp;
+			loc2 = lp + n;
+			return(TRUE);
+		}
+	i = shift[lp[n - 1] & CMASK];
+	lp += i;
+	len -= i;
+  }
+  return(FALSE);
+}
+
 static int advance(lp, ep)
 /* Attempt to advance match pointer by one pattern element */
 register char *lp;		/* source (linebuf) ptr */
@@ -1455,6 +1531,7 @@ cpcom:				/* so s command can jump here */
 	if (!nflag) puts(linebuf);	/* flush out the current line */
 	if (aptr > appends)
 		readout();	/* do any pending a and r commands */
+	if (iflag) endinplace(TRUE);
 	exit(0);
 
       case RCMD:		/* read a file into the stream */
@@ -1520,19 +1597,69 @@ static void openfile(file)
 char *file;
 /* Replace stdin by given file */
 {
+  if (iflag) endinplace(TRUE);
   if (freopen(file, "r", stdin) == NULL) {
 	fprintf(stderr, "sed: can't open %s\n", file);
 	exit(1);
   }
+  if (iflag) inplace(file);
+}
+
+static char *ipfile;		/* file being edited in place */
+static char iptemp[128];	/* and its replacement */
+static char ipbuf[4096];	/* output buffer for the replacement */
+
+static void inplace(file)
+char *file;
+/* Send output to a new file beside file, which replaces it at the end.
+ * Line numbers, $ and ranges start afresh for each file.
+ */
+{
+  struct stat st;
+  char *p;
+  int n;
+  sedcmd *ipc;
+
+  p = strrchr(file, '/');
+  n = p ? p - file + 1 : 0;
+  if (n > sizeof(iptemp) - 10) n = -1;
+  if (n >= 0) sprintf(iptemp, "%.*ssed%05d", n, file, getpid());
+  if (n < 0 || fstat(0, &st) < 0 || freopen(iptemp, "w", stdout) == NULL) {
+	fprintf(stderr, "sed: can't edit %s\n", file);
+	exit(1);
+  }
+  setvbuf(stdout, ipbuf, _IOFBF, sizeof(ipbuf));
+  chmod(iptemp, st.st_mode & 07777);
+  ipfile = file;
+
+  lnum = 0L;
+  lastline = FALSE;
+  for (ipc = cmds; ipc->command; ipc++) ipc->flags.inrange = FALSE;
+}
+
+static void endinplace(keep)
+int keep;
+/* Replace the file being edited by the new one, or discard the new one */
+{
+  if (!ipfile) return;
+  if (fflush(stdout) == EOF || ferror(stdout)) keep = FALSE;
+  if (keep && rename(iptemp, ipfile) < 0) {
+	fprintf(stderr, "sed: can't replace %s\n", ipfile);
+	keep = FALSE;
+  }
+  if (!keep) unlink(iptemp);
+  ipfile = NULL;
 }
 
 static int c;			/* Will be the next char to read, a kind of
 			 * lookahead */
 
 static void get()
-/* Read next character into c treating all argument files as run through cat */
+/* Read next character into c treating all argument files as run through cat,
+ * unless editing in place, where sed_execute() moves to the next file
+ */
 {
-  while ((c = getchar()) == EOF && --eargc >= 0) openfile(*eargv++);
+  while ((c = getchar()) == EOF && !iflag && --eargc >= 0) openfile(*eargv++);
 }
 
 static void initget()
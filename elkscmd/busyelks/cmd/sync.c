@@ -0,0 +1,10 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include "cmd.h"
+
+
+int sync_main(int argc, char **argv)
+{
+	sync();
+	return 0;
+}
@@ -26,7 +26,7 @@
  *   the argument and is equivalent to specifying "-f" in the standard
  *   syntax.  Look for lines marked "OBSOLESCENT".
  *
- *   If no file is specified, standard input is assumed. 
+ *   If no file is specified, standard input is assumed.
  *
  *   P1003.2 does not specify tail's behavior when a count of 0 is given.
  *   It also does not specify clearly whether the first byte (line) of a
@@ -36,7 +36,7 @@
  *   while a count of +0 results in the entire file being copied (just like
  *   +1).  The implementor does not agree with these behaviors, but has
  *   copied them slavishly.  Look for lines marked "HISTORICAL".
- *   
+ *
  *   Author:    Norbert Schlenker
  *   Copyright: None.  Released to the public domain.
  *   Reference: P1003.2 section 4.59 (draft 10)
@@ -52,11 +52,13 @@
 /* External interfaces */
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/select.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "../defs.h"
+#include "cmd.h"
 
 /* External interfaces that should have been standardized into <getopt.h> */
 extern char *optarg;
@@ -66,7 +68,7 @@ extern int optind;
  * but we'll specify it here just in case it's been left out.
  */
 #ifndef LINE_MAX
-#define LINE_MAX 2048		/* minimum acceptable lower bound */
+#define LINE_MAX 128		/* minimum acceptable lower bound */
 #endif
 
 /* Magic numbers suggested or required by Posix specification */
@@ -75,6 +77,7 @@ extern int optind;
 #define DEFAULT_COUNT 10	/* default number of lines or bytes */
 #define MIN_BUFSIZE (LINE_MAX * DEFAULT_COUNT)
 #define SLEEP_INTERVAL	1	/* sleep for one second intervals with -f */
+#define BLOCK_SIZE	1024	/* read size when scanning back from EOF */
 
 #define FALSE 0
 #define TRUE 1
@@ -82,8 +85,10 @@ extern int optind;
 /* Internal functions - prototyped under Minix */
 _PROTOTYPE(int tail_main, (int argc, char **argv));
 _PROTOTYPE(int tail, (int count, int bytes, int read_until_killed));
+_PROTOTYPE(int tail_file, (int count, int bytes, int read_until_killed,
+							off_t size));
 _PROTOTYPE(int keep_reading, (void));
-_PROTOTYPE(void tail_usage, (void));
+_PROTOTYPE(static void usage, (void));
 
 int tail_main(argc, argv)
 int argc;
@@ -156,7 +161,7 @@ char *argv[];
 			if (isdigit(*optarg))
 				number = -atoi(optarg);
 			else
-				tail_usage();
+				usage();
 			if (number == 0) {		/* HISTORICAL */
 				if (*optarg == '+')
 					number = 1;
@@ -175,7 +180,7 @@ char *argv[];
 			if (isdigit(*optarg))
 				number = -atoi(optarg);
 			else
-				tail_usage();
+				usage();
 			if (number == 0) {		/* HISTORICAL */
 				if (*optarg == '+')
 					number = 1;
@@ -184,7 +189,7 @@ char *argv[];
 			}
 			break;
 		      default:
-			tail_usage();
+			usage();
 			/* NOTREACHED */
 		}
 	}
@@ -194,7 +199,7 @@ char *argv[];
 
   if (argc > 1 ||		/* too many arguments */
       (cflag && nflag)) {	/* both bytes and lines specified */
-	tail_usage();
+	usage();
   }
 
   if (argc > 0) {		/* an actual file */
@@ -204,18 +209,12 @@ char *argv[];
 		fputs("\n", stderr);
 		exit(FAILURE);
 	}
-	/* There is an optimization possibility here.  If a file is being
-	 * read, we need not look at the front of it.  If we seek backwards
-         * from the end, we can (potentially) avoid looking at most of the
-	 * file.  Some systems fail when asked to seek backwards to a point
-	 * before the start of the file, so we avoid that possibility.
+	/* A regular file need not be read from the front when counting
+	 * from the end: scan it backwards in blocks instead.
 	 */
-	if (number < 0 && fstat(fileno(stdin), &stat_buf) == 0) {
-		long offset = cflag ? (long)number : (long)number * LINE_MAX;
-
-		if (-offset < stat_buf.st_size)
-			fseek(stdin, offset, SEEK_END);
-	}
+	if (number < 0 && fstat(fileno(stdin), &stat_buf) == 0 &&
+	    S_ISREG(stat_buf.st_mode))
+		exit(tail_file(number, cflag, fflag, stat_buf.st_size));
   } else {
 	fflag = FALSE;		/* force -f off when reading a pipe */
   }
@@ -282,7 +281,7 @@ int read_until_killed;		/* keep reading at EOF */
 /* Back up inside the buffer.  The count has already been adjusted to
  * back up exactly one character too far, so we will bump the buffer
  * pointer once after we're done.
- * 
+ *
  * BUG: For large line counts, the buffer may not be large enough to
  *	hold all the lines.  The specification allows the program to
  *	fail in such a case - this program will simply dump the entire
@@ -316,44 +315,106 @@ int read_until_killed;		/* keep reading at EOF */
   return ferror(stdout) ? FAILURE : SUCCESS;
 }
 
-/* Wake at intervals to reread standard input.  Copy anything read to
- * standard output and then go to sleep again.
+/* Copy the last -count lines or bytes of the regular file on standard
+ * input.  Blocks are read backwards from EOF, aligned so all but the
+ * last are whole, until the (count + 1)'th newline from the end is
+ * found; only the tail itself is then read forwards and copied.
+ */
+int tail_file(count, bytes, read_until_killed, size)
+int count;			/* lines or bytes desired, negative */
+int bytes;			/* TRUE if we want bytes */
+int read_until_killed;		/* keep reading at EOF */
+off_t size;			/* file size */
+{
+  char buf[BLOCK_SIZE];
+  off_t pos;			/* file offset of buf */
+  off_t start;			/* offset of first desired character */
+  int n;
+  int i;
+
+  if (bytes) {
+	start = (size > (off_t) -count) ? size + count : 0;
+  } else {
+	start = 0;
+	--count;			/* see tail() */
+	pos = size;
+	while (pos > 0 && count < 0) {
+		n = (int) (pos % BLOCK_SIZE);
+		if (n == 0) n = BLOCK_SIZE;
+		pos -= n;
+		if (lseek(0, pos, SEEK_SET) != pos || read(0, buf, n) != n)
+			return FAILURE;
+		for (i = n; --i >= 0;) {
+			if (buf[i] == '\n' && ++count == 0) {
+				start = pos + i + 1;
+				break;
+			}
+		}
+	}
+  }
+
+  if (lseek(0, start, SEEK_SET) != start) return FAILURE;
+  while ((n = read(0, buf, sizeof(buf))) > 0) {
+	if (write(1, buf, n) != n) return FAILURE;
+  }
+  if (n < 0) return FAILURE;
+  if (read_until_killed)
+	return keep_reading();
+  return SUCCESS;
+}
+
+/* Copy anything more appended to standard input to standard output.
+ * A FIFO is waited on with select().  A regular file always selects as
+ * readable, so its size is checked each SLEEP_INTERVAL instead and it is
+ * only read once it has grown, or rewound if it was truncated.
  */
 int keep_reading()
 {
   char buf[1024];
   int n;
-  int i;
+  int got;
   off_t pos;
   struct stat st;
+  fd_set fds;
 
-  pos = lseek(0, (off_t) 0, SEEK_CUR);
+  if (fstat(0, &st) == 0 && S_ISREG(st.st_mode))
+	pos = lseek(0, (off_t) 0, SEEK_CUR);
+  else
+	pos = -1;
   for (;;) {
-  	for (i = 0; i < 60; i++) {
-  		while ((n = read(0, buf, sizeof(buf))) > 0) {
-  			if (write(1, buf, n) < 0) return FAILURE;
-  		}
-  		if (n < 0) return FAILURE;
-
-		sleep(SLEEP_INTERVAL);
+	got = FALSE;
+	while ((n = read(0, buf, sizeof(buf))) > 0) {
+		if (write(1, buf, n) < 0) return FAILURE;
+		if (pos != -1) pos += n;
+		got = TRUE;
 	}
+	if (n < 0) return FAILURE;
 
-	/* Rewind if suddenly truncated. */
 	if (pos != -1) {
-		if (fstat(0, &st) == -1) {
-			pos = -1;
-		} else
-		if (st.st_size < pos) {
+		do {
+			sleep(SLEEP_INTERVAL);
+			if (fstat(0, &st) == -1) return FAILURE;
+		} while (st.st_size == pos);
+
+		/* Rewind if suddenly truncated. */
+		if (st.st_size < pos)
 			pos = lseek(0, (off_t) 0, SEEK_SET);
-		} else {
-			pos = st.st_size;
-		}
+	} else {
+		/* A FIFO without writers selects at EOF at once, so wait
+		 * before trying again unless something arrived.
+		 */
+		if (!got) sleep(SLEEP_INTERVAL);
+		FD_ZERO(&fds);
+		FD_SET(0, &fds);
+		if (select(1, &fds, (fd_set *) NULL, (fd_set *) NULL,
+			   (struct timeval *) NULL) < 0)
+			return FAILURE;
 	}
   }
 }
 
 /* Tell the user the standard syntax. */
-void tail_usage()
+static void usage()
 {
   fputs("Usage: tail [-f] [-c number | -n number] [file]\n", stderr);
   exit(FAILURE);
@@ -1,7 +1,5 @@
 /* tee - pipe fitting			Author: Paul Polderman */
 
-#include "../sash.h"
-
 #include <stdio.h>
 #include <sys/types.h>
 #include <fcntl.h>
@@ -9,16 +7,25 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include "../defs.h"
+#include "cmd.h"
 
 #define	MAXFD	18
+#define CHUNK_SIZE	BUFSIZ		/* use disk block size for stack limit and efficiency*/
+
+#define errmsg(str) write(STDERR_FILENO, str, sizeof(str) - 1)
+#define errstr(str) write(STDERR_FILENO, str, strlen(str))
+
+int fd[MAXFD];
 
-int tee_main(int argc, char **argv)
+_PROTOTYPE(int tee_main, (int argc, char **argv));
+
+int tee_main(argc, argv)
+int argc;
+char **argv;
 {
   char iflag = 0, aflag = 0;
-  char buf[BUF_SIZE];
+  char buf[CHUNK_SIZE];
   int i, s, n;
-  int fd[MAXFD];
-
 
   argv++;
   --argc;
@@ -27,12 +34,11 @@ int tee_main(int argc, char **argv)
 	    case 'i':		/* Interrupt turned off. */
 		iflag++;
 		break;
-	    case 'a':		/* Append to outputfile(s), instead of
-			 * overwriting them. */
+	    case 'a':		/* Append to outputfile(s), instead of overwriting them. */
 		aflag++;
 		break;
 	    default:
-		fprintf(stderr,"Usage: tee [-i] [-a] [files].\n");
+		errmsg("usage: tee [-i][-a] [file ...]\n");
 		exit(1);
 	}
 	argv++;
@@ -46,15 +52,15 @@ int tee_main(int argc, char **argv)
 	} else {
 		if ((fd[s] = creat(*argv, 0666)) >= 0) continue;
 	}
-	fprintf(stderr,"Cannot open output file: ");
-	fprintf(stderr,*argv);
-	fprintf(stderr,"\n");
+	errmsg("Cannot open output file: ");
+	errmsg(*argv);
+	errmsg("\n");
 	exit(2);
   }
 
   if (iflag) signal(SIGINT, SIG_IGN);
 
-  while ((n = read(0, buf, BUF_SIZE)) > 0) {
+  while ((n = read(0, buf, CHUNK_SIZE)) > 0) {
 	for (i = 0; i < s; i++) write(fd[i], buf, n);
   }
 
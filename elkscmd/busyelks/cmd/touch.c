@@ -1,28 +1,42 @@
+#include <stdio.h>
+#include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <utime.h>
+#include "../futils.h"
+#include "cmd.h"
 
-
-int
-touch_main (argc,argv)
-	int argc;
-	char **argv;
+int touch_main(int argc, char **argv)
 {
 	int i, ncreate = 0;
+	int err = 0;
 	struct stat sbuf;
-	int fd,er;
-	
+
+	if (argc < 2) {
+		errmsg("usage: touch file [...]\n");
+		return 1;
+	}
 	if ((argv[1][0] == '-') && (argv[1][1] == 'c'))
 		ncreate = 1;
-	
-	for(i=ncreate+1;i<argc;i++) {
-		if (argv[i][0] != '-') {	
-			if (stat(argv[i],&sbuf)) {
-				if (!ncreate)
-					er = close(creat(argv[i], 0666));				
+
+	for (i = ncreate + 1; i < argc; i++) {
+		if (argv[i][0] != '-') {
+			if (stat(argv[i], &sbuf)) {
+				if (!ncreate) {
+					int fd = creat(argv[i], 0666);
+					if (fd < 0) {
+						errstr(argv[i]);
+						errmsg(": cannot create file\n");
+						err = 1;
+					}
+					else close(fd);
+				}
 			} else
-				er = utime(argv[i],NULL);
+				err |= utime(argv[i], NULL);
 		}
 	}
-	exit(0);
+	return (err ? 1 : 0);
 }
@@ -21,6 +21,7 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <string.h>
+#include "cmd.h"
 
 int truncate1 = 0;	/* Truncate set1 to set2 length (SYSV) */
 int complement1 = 0;	/* Complement set1 */
@@ -37,7 +38,7 @@ char * progname;
  *
  */
 
-void tr_usage(char ** argv)
+static void usage(char ** argv)
 {
 	fprintf(stderr, "%s [-cstd] string1 [string2]\n", argv[0]);
 	exit(1);
@@ -56,12 +57,13 @@ void tr_usage(char ** argv)
  *
  */
 
-int tr_do_args(int argc, register char ** argv)
+static int do_args(int argc, char ** argv)
 {
-	int i = 1, j;
+	int i = 1;
+	size_t j;
 
-	while(i < argc && argv[i][0] == '-') {
-		for(j = 1; j < strlen(argv[i]); j++) {
+	while (i < argc && argv[i][0] == '-') {
+		for (j = 1; j < strlen(argv[i]); j++) {
 			switch (argv[i][j]) {
 				case 'c':
 					complement1 = 1;
@@ -98,6 +100,20 @@ int tr_do_args(int argc, register char ** argv)
 	return i;
 }
 
+void out_of_mem()
+{
+	perror("malloc");
+	exit(1);
+}
+
+void *xrealloc(void *ptr, size_t size)
+{
+	ptr = realloc(ptr, size);
+	if (ptr == NULL)
+		out_of_mem();
+	return ptr;
+}
+
 /*
  *
  * build_string()
@@ -110,21 +126,20 @@ int tr_do_args(int argc, register char ** argv)
  */
 
 #define BSIZE 64
-#define out_of_mem() { perror("malloc"); exit(1); }
 
 char * build_string(char * set_descr, int num)
 {
-	register char * buf = malloc(BSIZE);
+	char * buf = calloc(1, BSIZE);
 	int size = BSIZE;
 	int tail = 0;
-	int i;
+	size_t i;
 	char ch, n1, n2;
 
 	if (buf == NULL) {
 		out_of_mem();
 	}
 
-	for(i = 0; i < strlen(set_descr); i++) {
+	for (i = 0; i < strlen(set_descr); i++) {
 		ch = set_descr[i];
 again:
 		switch (ch) {
@@ -162,16 +177,24 @@ again:
 							ch = n1 * 8 + n2;
 							goto again;
 						}
+						/* fallthrough */
 					default:
 						fprintf(stderr, "%s: Illegal %c in set%d\n", progname, ch, num);
 						exit(1);
-							
+
 				}
 				break;
 			case '-':
-				if ((tail) && 
-				    ((n1 = set_descr[++i]) > buf[tail-1])) {
-					for(n2 = buf[tail-1] + 1;n2 <= n1;n2++){
+				n1 = ' ';
+				if ((tail) &&
+				    ((n1 = set_descr[++i]) >= (n2 = buf[tail-1] + 1))) {
+					int need = n1 - n2 + 1;
+					if (size - tail < need + 4) {
+						buf = xrealloc(buf, size + need);
+						memset(buf + size, 0, need);
+						size += need;
+					}
+					for (;n2 <= n1;n2++){
 						buf[tail++] = n2;
 					}
 				} else {
@@ -181,28 +204,89 @@ again:
 			default:
 				buf[tail++] = ch;
 				break;
-		
+
 		}
 		if ((size - tail) < 4) {
+			buf = xrealloc(buf, size + BSIZE);
+			memset(buf + size, 0, BSIZE);
 			size += BSIZE;
-			buf = realloc(buf, size);
-			if (buf == NULL) {
-				out_of_mem();
-			}
 		}
 	}
 	return buf;
 }
 
+/*
+ *
+ * build_tables()
+ *
+ * Turn the sets into per character tables, so each input character
+ * costs a lookup rather than a search of the sets.
+ *
+ * unsigned char * set1;	First set, already padded or truncated.
+ * unsigned char * set2;	Second set or NULL.
+ *
+ */
+
+#define T_DELETE	1	/* delete character */
+#define T_SQUEEZE	2	/* squeeze repeats of character */
+
+unsigned char xlate[256];	/* translation of each character */
+unsigned char flags[256];	/* T_ flags of each character */
+
+void build_tables(unsigned char * set1, unsigned char * set2)
+{
+	unsigned char in1[256];
+	unsigned char * sq;
+	int c, i, len2;
+
+	memset(in1, 0, sizeof(in1));
+	for (i = 0; set1[i]; i++)
+		in1[set1[i]] = 1;
+	if (complement1) {
+		for (c = 0; c < 256; c++)
+			in1[c] = !in1[c];
+	}
+	for (c = 0; c < 256; c++) {
+		xlate[c] = c;
+		flags[c] = (delete && in1[c])? T_DELETE: 0;
+	}
+
+	if (set2 && !delete) {
+		if (complement1) {
+			/* characters not in set1 map in order onto set2 */
+			len2 = strlen((char *)set2);
+			for (c = 0, i = 0; c < 256; c++) {
+				if (in1[c] && len2)
+					xlate[c] = set2[i < len2? i++: len2 - 1];
+			}
+		} else {
+			/* first occurrence in set1 wins, as strchr found */
+			for (i = strlen((char *)set1); --i >= 0; )
+				xlate[set1[i]] = set2[i];
+		}
+	}
+
+	if (squeeze) {
+		if (set2) {
+			for (sq = set2; *sq; sq++)
+				flags[*sq] |= T_SQUEEZE;
+		} else {
+			for (c = 0; c < 256; c++)
+				if (in1[c]) flags[c] |= T_SQUEEZE;
+		}
+	}
+}
+
 int tr_main(int argc, char ** argv)
 {
-	int num_args, i, lchar = 0;
-	register char * set1, * set2;
-	char * ip;
-	int len, len1, len2;
+	int num_args, i, n, lchar = -1;
+	char * set1, * set2;
+	int len1, len2;
+	static unsigned char ibuf[1024], obuf[1024];
+	unsigned char * ip, * iend, * op;
 
 	progname = argv[0];
-	num_args = tr_do_args(argc, argv);
+	num_args = do_args(argc, argv);
 
 	set1 = build_string(argv[num_args++], 1);
 	len1 = strlen(set1);
@@ -211,45 +295,39 @@ int tr_main(int argc, char ** argv)
 		len2 = strlen(set2);
 	} else {
 		set2 = NULL;
+		len2 = 0;
 	}
 	/* printf("{%d,%d}",len1,len2); */
-	if (len1 > len2) {
+	if (set2 && len1 > len2 && !complement1) {
 		if (truncate1) {
-			len = len2;
-			set1[len] = '\0';
+			set1[len2] = '\0';
 		} else {
-			set2 = realloc(set2, len1);
+			char pad = len2 ? set2[len2 - 1] : '\0';
+			set2 = xrealloc(set2, len1 + 1);
 			for (i = len2; i < len1; i++) {
-				set2[i] = set2[len2 - 1];
+				set2[i] = pad;
 			}
-			len = len1;
+			set2[len1] = 0;
 		}
 	}
 	/* printf("String 1 = %s\n", set1);
 	printf("String 2 = %s\n", set2); */
-	while ((i = getchar()) != EOF) {
-		if (set2 == NULL || delete) {
-			if (delete) {
-				if ((ip = strchr(set1, i)) != NULL) {
-					i = 0;
-				}
-			}
-		} else {
-			if ((ip = strchr(set1, i)) != NULL) {
-				i = ip - set1;
-				ip = set2 + i;
-				i = *ip;
-			}
-		}
-		if (squeeze) {
-			if ((set2 && ((ip = strchr(set2, i)) != NULL)) ||
-			   (!set2 && ((ip = strchr(set1, i)) != NULL))) {
-				if (i == lchar) i = 0;
-			}
-		}
-		if (i) {
+	build_tables((unsigned char *)set1, (unsigned char *)set2);
+
+	while ((n = read(0, ibuf, sizeof(ibuf))) > 0) {
+		op = obuf;
+		for (ip = ibuf, iend = ibuf + n; ip < iend; ip++) {
+			if (flags[*ip] & T_DELETE)
+				continue;
+			i = xlate[*ip];
+			if ((flags[i] & T_SQUEEZE) && i == lchar)
+				continue;
 			lchar = i;
-			putchar(i);
+			*op++ = i;
+		}
+		if (op > obuf && write(1, obuf, op - obuf) != op - obuf) {
+			perror("write");
+			exit(1);
 		}
 	}
 	exit(0);
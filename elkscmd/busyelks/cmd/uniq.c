@@ -16,25 +16,26 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
+#include "cmd.h"
 
-char buffer[BUFSIZ];
-int uflag = 1;			/* default is union of -d and -u outputs */
-int dflag = 1;			/* flags are mutually exclusive */
-int cflag = 0;
-int fields = 0;
-int chars = 0;
-
-int uniq_main();
-FILE *xfopen();
-char *skip();
-int equal();
-void show();
-int uniq();
-void uniq_usage();
-int ourgetline();
-
-FILE *xfopen(fn, mode)
-char *fn, *mode;
+static char buffer[BUFSIZ];
+static int uflag = 1;			/* default is union of -d and -u outputs */
+static int dflag = 1;			/* flags are mutually exclusive */
+static int cflag = 0;
+static int fields = 0;
+static int chars = 0;
+
+/* The meat of the whole affair */
+static char *nowline, *prevline, buf1[1024], buf2[1024];
+static unsigned int nowhash, prevhash;	/* hashes of the compared parts */
+
+/* Input is read a buffer at a time and split in place */
+static char inbuf[BUFSIZ], *inp = inbuf, *inend = inbuf;
+
+static int ourgetline(char *buf, int count);
+
+static FILE *xfopen(const char *fn, const char *mode)
 {
   FILE *p;
 
@@ -46,62 +47,7 @@ char *fn, *mode;
   return(p);
 }
 
-int uniq_main(argc, argv)
-int argc;
-char *argv[];
-{
-  char *p;
-  int inf = -1, outf;
-
-  setbuf(stdout, buffer);
-  for (--argc, ++argv; argc > 0 && (**argv == '-' || **argv == '+');
-       --argc, ++argv) {
-	if (**argv == '+')
-		chars = atoi(*argv + 1);
-	else if (isdigit(argv[0][1]))
-		fields = atoi(*argv + 1);
-	else if (argv[0][1] == '\0')
-		inf = 0;	/* - is stdin */
-	else
-		for (p = *argv + 1; *p; p++) {
-			switch (*p) {
-			    case 'd':
-				dflag = 1;
-				uflag = 0;
-				break;
-			    case 'u':
-				uflag = 1;
-				dflag = 0;
-				break;
-			    case 'c':	cflag = 1;	break;
-			    default:	uniq_usage();
-			}
-		}
-  }
-
-  /* Input file */
-  if (argc == 0)
-	inf = 0;
-  else if (inf == -1) {		/* if - was not given */
-	fclose(stdin);
-	xfopen(*argv++, "r");
-	argc--;
-  }
-  if (argc == 0)
-	outf = 1;
-  else {
-	fclose(stdout);
-	xfopen(*argv++, "w");
-	argc--;
-  }
-
-  uniq();
-  fflush(stdout);
-  exit(0);
-}
-
-char *skip(s)
-char *s;
+static char *skip(char *s)
 {
   int n;
 
@@ -122,15 +68,23 @@ char *s;
   return s;
 }
 
-int equal(s1, s2)
-char *s1, *s2;
+static unsigned int hash(char *s)
 {
-  return !strcmp(skip(s1), skip(s2));
+  unsigned int h = 0;
+
+  while (*s) h = (h << 5) - h + (unsigned char)*s++;
+  return h;
 }
 
-void show(line, count)
-char *line;
-int count;
+/* Lines differing in hash can't be equal, so most are told apart without
+ * skipping fields and comparing them again.
+ */
+static int equal(char *s1, char *s2)
+{
+  return prevhash == nowhash && !strcmp(skip(s1), skip(s2));
+}
+
+static void show(char *line, int count)
 {
   if (cflag)
 	printf("%4d %s", count, line);
@@ -140,10 +94,7 @@ int count;
   }
 }
 
-/* The meat of the whole affair */
-char *nowline, *prevline, buf1[1024], buf2[1024];
-
-int uniq()
+static int uniq(void)
 {
   char *p;
   int seen;
@@ -151,18 +102,21 @@ int uniq()
   /* Setup */
   prevline = buf1;
   if (ourgetline(prevline, 1024) < 0) return(0);
+  prevhash = hash(skip(prevline));
   seen = 1;
   nowline = buf2;
 
   /* Get nowline and compare if not equal, dump prevline and swap
    * pointers else continue, bumping seen count */
   while (ourgetline(nowline, 1024) > 0) {
+	nowhash = hash(skip(nowline));
 	if (!equal(prevline, nowline)) {
 		show(prevline, seen);
 		seen = 1;
 		p = nowline;
 		nowline = prevline;
 		prevline = p;
+		prevhash = nowhash;
 	} else
 		seen += 1;
   }
@@ -170,26 +124,88 @@ int uniq()
   return 0;
 }
 
-void uniq_usage()
-{
-  fprintf(stderr, "Usage: uniq [-udc] [+n] [-n] [input [output]]\n");
-}
 
-int ourgetline(buf, count)
-char *buf;
-int count;
+/* Read the next line of at most count - 2 characters into buf, adding the
+ * newline if missing at EOF and a NUL.  Returns its length or -1 at EOF.
+ */
+static int ourgetline(char *buf, int count)
 {
-  int c;
+  char *nl;
+  int n;
   int ct = 0;
 
-  while (ct++ < count) {
-	c = getc(stdin);
-	if (c < 0) return(-1);
-	*buf++ = c;
-	if (c == '\n') {
-		*buf++ = 0;
-		return(ct);
+  while (ct < count - 2) {
+	if (inp == inend) {
+		if ((n = read(0, inbuf, sizeof(inbuf))) <= 0) {
+			if (ct == 0) return(-1);
+			buf[ct++] = '\n';
+			break;
+		}
+		inp = inbuf;
+		inend = inbuf + n;
 	}
+	n = inend - inp;
+	if (n > count - 2 - ct) n = count - 2 - ct;
+	if ((nl = memchr(inp, '\n', n)) != NULL) n = nl - inp + 1;
+	memcpy(buf + ct, inp, n);
+	inp += n;
+	ct += n;
+	if (nl) break;
   }
+  buf[ct] = 0;
   return(ct);
 }
+
+int uniq_main(int argc, char **argv)
+{
+  char *p;
+  int inf = -1;
+
+  setbuf(stdout, buffer);
+  for (--argc, ++argv; argc > 0 && (**argv == '-' || **argv == '+');
+       --argc, ++argv) {
+	if (**argv == '+')
+		chars = atoi(*argv + 1);
+	else if (isdigit(argv[0][1]))
+		fields = atoi(*argv + 1);
+	else if (argv[0][1] == '\0')
+		inf = 0;	/* - is stdin */
+	else
+		for (p = *argv + 1; *p; p++) {
+			switch (*p) {
+			    case 'd':
+				dflag = 1;
+				uflag = 0;
+				break;
+			    case 'u':
+				uflag = 1;
+				dflag = 0;
+				break;
+			    case 'c':	cflag = 1;	break;
+			    default:	goto usage;
+			}
+		}
+  }
+
+  /* Input file */
+  if (argc == 0)
+	inf = 0;
+  else if (inf == -1) {		/* if - was not given */
+	fclose(stdin);
+	xfopen(*argv++, "r");
+	argc--;
+  }
+  if (argc > 0) {
+	fclose(stdout);
+	xfopen(*argv++, "w");
+	argc--;
+  }
+
+  uniq();
+  fflush(stdout);
+  exit(0);
+
+usage:
+	fprintf(stderr, "Usage: uniq [-udc] [+n] [-n] [input [output]]\n");
+	exit(1);
+}
@@ -3,6 +3,9 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "cmd.h"
 
 /*
  *
@@ -39,13 +42,56 @@ long ltotal;			/* Total count of lines */
 long wtotal;			/* Total count of words */
 long ctotal;			/* Total count of characters */
 
-int wc_main();
-void count();
-void wc_usage();
+#define C_SPACE	1		/* ends a word */
+#define C_LINE	2		/* ends a line */
 
-int wc_main(argc, argv)
-int argc;
-char *argv[];
+unsigned char cclass[256];	/* class of each character */
+char iobuf[2048];
+
+
+void init_class(void)
+{
+  int c;
+
+  for (c = 0; c < 256; c++)
+	if (isspace(c)) cclass[c] = C_SPACE;
+  cclass['\n'] |= C_LINE;
+  cclass['\f'] |= C_LINE;
+}
+
+
+void count(int fd)
+{
+  register char *p;
+  register int cl;
+  register int word = 0;
+  char *end;
+  int n;
+
+  lcount = 0L;
+  wcount = 0L;
+  ccount = 0L;
+
+  while ((n = read(fd, iobuf, sizeof(iobuf))) > 0) {
+	ccount += n;
+	end = iobuf + n;
+	for (p = iobuf; p < end; p++) {
+		if ((cl = cclass[(unsigned char)*p]) != 0) {
+			if (word) wcount++;
+			word = 0;
+			if (cl & C_LINE) lcount++;
+		} else {
+			word = 1;
+		}
+	}
+  }
+  ltotal += lcount;
+  wtotal += wcount;
+  ctotal += ccount;
+}
+
+
+int wc_main(int argc, char **argv)
 {
   int k;
   char *cp;
@@ -63,7 +109,7 @@ char *argv[];
 		    case 'l':	lflag++;	break;
 		    case 'w':	wflag++;	break;
 		    case 'c':	cflag++;	break;
-		    default:	wc_usage();
+		    default:	goto usage;
 		}
 		cp++;
 	}
@@ -77,11 +123,12 @@ char *argv[];
   }
 
   /* Process files. */
+  init_class();
   tflag = files >= 2;		/* set if # files > 1 */
 
   /* Check to see if input comes from std input. */
   if (k >= argc) {
-	count(stdin);
+	count(0);
 	if (lflag) printf(" %6ld", lcount);
 	if (wflag) printf(" %6ld", wcount);
 	if (cflag) printf(" %6ld", ccount);
@@ -92,17 +139,17 @@ char *argv[];
 
   /* There is an explicit list of files.  Loop on files. */
   while (k < argc) {
-	FILE *f;
+	int fd;
 
-	if ((f = fopen(argv[k], "r")) == NULL) {
+	if ((fd = open(argv[k], O_RDONLY)) < 0) {
 		fprintf(stderr, "wc: cannot open %s\n", argv[k]);
 	} else {
-		count(f);
+		count(fd);
 		if (lflag) printf(" %6ld", lcount);
 		if (wflag) printf(" %6ld", wcount);
 		if (cflag) printf(" %6ld", ccount);
 		printf(" %s\n", argv[k]);
-		fclose(f);
+		close(fd);
 	}
 	k++;
   }
@@ -114,38 +161,10 @@ char *argv[];
 	printf(" total\n");
   }
   fflush(stdout);
-  return(0);
-}
-
-void count(f)
-FILE *f;
-{
-  register int c;
-  register int word = 0;
-
-  lcount = 0;
-  wcount = 0;
-  ccount = 0L;
+  exit(0);
 
-  while ((c = getc(f)) != EOF) {
-	ccount++;
-
-	if (isspace(c)) {
-		if (word) wcount++;
-		word = 0;
-	} else {
-		word = 1;
-	}
-
-	if (c == '\n' || c == '\f') lcount++;
-  }
-  ltotal += lcount;
-  wtotal += wcount;
-  ctotal += ccount;
-}
-
-void wc_usage()
-{
-  fprintf(stderr, "Usage: wc [-lwc] [name ...]\n");
-  exit(1);
+usage:
+	fprintf(stderr, "Usage: wc [-lwc] [file] ...\n");
+	fprintf(stderr, "Switches show line, word, and char totals, respectively\n");
+	exit(1);
 }
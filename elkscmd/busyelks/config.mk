@@ -13,18 +13,34 @@ ifeq "$(CONFIG_APP_FILE_UTILS)" "b"
 	CMD_cmp		= yes
 	CMD_cp		= yes
 	CMD_dd		= yes
+	CMD_ln		= yes
+	CMD_ls		= yes
+	CMD_mkdir	= yes
+	CMD_mknod	= yes
+	CMD_more	= yes
+	CMD_mv		= yes
+	CMD_rm		= yes
+	CMD_rmdir	= yes
+	CMD_sync	= yes
+	CMD_touch	= yes
 endif
 
 ifeq "$(CONFIG_APP_MINIX1)" "b"
 	CMD_cksum	= yes
 	CMD_cut		= yes
 	CMD_du		= yes
+	CMD_grep	= yes
+	CMD_uniq	= yes
+	CMD_wc		= yes
 endif
 
 ifeq "$(CONFIG_APP_MINIX3)" "b"
 	CMD_cal		= yes
 	CMD_diff	= yes
 	CMD_find	= yes
+	CMD_head	= yes
+	CMD_tail	= yes
+	CMD_tee		= yes
 endif
 
 ifeq "$(CONFIG_APP_MISC_UTILS)" "b"
@@ -37,5 +53,11 @@ ifeq "$(CONFIG_APP_SH_UTILS)" "b"
 	CMD_dirname	= yes
 	CMD_echo	= yes
 	CMD_false	= yes
+	CMD_printenv	= yes
+	CMD_pwd		= yes
+	CMD_tr		= yes
 	CMD_true	= yes
+	CMD_uname	= yes
+	CMD_xargs	= yes
+	CMD_yes		= yes
 endif
@@ -13,6 +13,9 @@ bsearch(const void * key, const void * base, size_t nmemb, size_t size,
 
 time_t	utc_mktime(struct tm * t);
 
+int	isadir(char * name);
+char *	buildname(char * dirname, char * filename);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -110,9 +110,75 @@ static struct cmd cmd[] =
 #if defined(CMD_find)
 	CMD("find",	find_main,	"path-list [predicate-list]", "Search for files in a directory hierarchy."),
 #endif
+#if defined(CMD_grep)
+	CMD("grep",	grep_main,	"[-cilnsv] [-e] expression [file ...]", "Print lines matching a pattern."),
+#endif
+#if defined(CMD_head)
+	CMD("head",	head_main,	"[-n] [file ...]", "Output the first part of files."),
+#endif
+#if defined(CMD_ln)
+	CMD("ln",	ln_main,	"[-s] link_target link_name", "Make links between files."),
+#endif
+#if defined(CMD_ls)
+	CMD("ls",	ls_main,	"[-aAFiltSrR1U] [name ...]", "List directory contents."),
+#endif
+#if defined(CMD_mkdir)
+	CMD("mkdir",	mkdir_main,	"[-p] directory [...]", "Make directories."),
+#endif
+#if defined(CMD_mknod)
+	CMD("mknod",	mknod_main,	"device [bcup] major minor", "Make block or character special files."),
+#endif
+#if defined(CMD_more)
+	CMD("more",	more_main,	"[file ...]", "Page through text one screenful at a time."),
+#endif
+#if defined(CMD_mv)
+	CMD("mv",	mv_main,	"source [...] target_file_or_directory", "Move or rename files."),
+#endif
+#if defined(CMD_printenv)
+	CMD("printenv",	printenv_main,	"[name ...]", "Print the environment."),
+#endif
+#if defined(CMD_pwd)
+	CMD("pwd",	pwd_main,	NULL, "Print name of current directory."),
+#endif
+#if defined(CMD_rm)
+	CMD("rm",	rm_main,	"[-rfi] file [...]", "Remove files or directories."),
+#endif
+#if defined(CMD_rmdir)
+	CMD("rmdir",	rmdir_main,	"[-pf] directory [...]", "Remove empty directories."),
+#endif
+#if defined(CMD_sync)
+	CMD("sync",	sync_main,	NULL, "Flush file system buffers."),
+#endif
+#if defined(CMD_tail)
+	CMD("tail",	tail_main,	"[-f] [-c number | -n number] [file]", "Output the last part of a file."),
+#endif
+#if defined(CMD_tee)
+	CMD("tee",	tee_main,	"[-i][-a] [file ...]", "Copy standard input to files and standard output."),
+#endif
+#if defined(CMD_touch)
+	CMD("touch",	touch_main,	"file [...]", "Change file timestamps."),
+#endif
+#if defined(CMD_tr)
+	CMD("tr",	tr_main,	"[-cstd] string1 [string2]", "Translate or delete characters."),
+#endif
 #if defined(CMD_true)
 	CMD("true",	true_main, NULL, "Do nothing, successfully"),
 #endif
+#if defined(CMD_uname)
+	CMD("uname",	uname_main,	"[-asnrvm]", "Print system information."),
+#endif
+#if defined(CMD_uniq)
+	CMD("uniq",	uniq_main,	"[-udc] [+n] [-n] [input [output]]", "Report or omit repeated lines."),
+#endif
+#if defined(CMD_wc)
+	CMD("wc",	wc_main,	"[-lwc] [file] ...", "Count lines, words and bytes."),
+#endif
+#if defined(CMD_xargs)
+	CMD("xargs",	xargs_main,	"[-n max-args] [-s max-chars] [-P max-procs] [command [initial-arguments]]", "Build and execute command lines from standard input."),
+#endif
+#if defined(CMD_yes)
+	CMD("yes",	yes_main,	"[string]", "Output a string repeatedly until killed."),
+#endif
 };
 
 static int
@@ -28,6 +28,7 @@ int nrtabs = 0;
 int sztabs = 0;
 
 static int ct_add, ct_update, ct_inact;
+static int rescan;
 
 
 /*
@@ -46,6 +47,19 @@ eat(int sig)
 }
 
 
+/*
+ * SIGHUP handler -- reread the crontabs at once.
+ */
+static void
+hup(int sig)
+{
+    (void)sig;
+
+    rescan = 1;
+    signal(SIGHUP, hup);
+}
+
+
 /*
  * sort crontab entries by userid
  */
@@ -192,18 +206,101 @@ securepath(char *path)
 
 
 /*
- * does the current time fall inside a job event mask?
+ * run queue: the next run time of every active job, kept as a binary heap
+ * ordered by time so the earliest is always runq[0].
  */
-int
-triggered(Evmask *t, Evmask *m)
+typedef struct {
+    time_t next;
+    int tab;                    /* index into tabs */
+    int job;                    /* index into tabs[tab].list */
+} runent;
+
+runent *runq = 0;
+int nrrunq = 0;
+int szrunq = 0;
+
+#define MAXDAYS (4 * 366)       /* give up on masks that never match, Feb 30 */
+
+/*
+ * return the start of the first minute after t that falls inside the event
+ * mask, or 0 if there is none.  Local hours start on whole hours of time_t.
+ */
+time_t
+nextrun(Evmask *m, time_t t)
 {
-    if (((t->minutes[0] & m->minutes[0]) || (t->minutes[1] & m->minutes[1]))
-        && (t->hours & m->hours)
-        && (t->mday & m->mday)
-        && (t->month & m->month)
-        && (t->wday & m->wday))
-        return 1;
-    return 0;
+    struct tm *tm;
+    int days = 0;
+
+    t += 60 - t % 60;
+    for (;;) {
+        tm = localtime(&t);
+        if (!(m->month & CBIT(tm->tm_mon + 1))
+            || !(m->mday & (1UL << tm->tm_mday))
+            || !(m->wday & CBIT(tm->tm_wday ? tm->tm_wday : 7))) {
+            if (++days > MAXDAYS)
+                return 0;
+            t += (long)(23 - tm->tm_hour) * 3600 + (60 - tm->tm_min) * 60;
+        } else if (!(m->hours & (1UL << tm->tm_hour)))
+            t += (60 - tm->tm_min) * 60;
+        else if (tm->tm_min < 32 ? !(m->minutes[0] & (1UL << tm->tm_min))
+                                 : !(m->minutes[1] & (1UL << (tm->tm_min - 32))))
+            t += 60;
+        else
+            return t;
+    }
+}
+
+static void
+runq_push(time_t next, int tab, int job)
+{
+    int i, parent;
+
+    EXPAND(runq, szrunq, nrrunq + 1);
+    for (i = nrrunq++; i > 0; i = parent) {
+        parent = (i - 1) / 2;
+        if (runq[parent].next <= next)
+            break;
+        runq[i] = runq[parent];
+    }
+    runq[i].next = next;
+    runq[i].tab = tab;
+    runq[i].job = job;
+}
+
+static runent
+runq_pop(void)
+{
+    runent top = runq[0], last = runq[--nrrunq];
+    int i, child;
+
+    for (i = 0; (child = 2 * i + 1) < nrrunq; i = child) {
+        if (child + 1 < nrrunq && runq[child + 1].next < runq[child].next)
+            child++;
+        if (last.next <= runq[child].next)
+            break;
+        runq[i] = runq[child];
+    }
+    runq[i] = last;
+    return top;
+}
+
+/*
+ * compute the next run time of every job in the active crontabs
+ */
+void
+schedule(time_t now)
+{
+    int i, j;
+    time_t next;
+
+    nrrunq = 0;
+    for (i = 0; i < nrtabs; i++) {
+        if (!(tabs[i].flags & ACTIVE))
+            continue;
+        for (j = 0; j < tabs[i].nrl; j++)
+            if ((next = nextrun(&tabs[i].list[j].trigger, now)) != 0)
+                runq_push(next, i, j);
+    }
 }
 
 
@@ -304,14 +401,15 @@ time_t ct_dirtime;
 
 /*
  * see if the crondir has been modified since the last time we looked at it.
- * If it has, update our crontab collection.
+ * If it has, update our crontab collection and return 1.
  */
-void
+int
 checkcrondir()
 {
     time_t newtime = mtime(".");
 
-    if (newtime != ct_dirtime) {
+    if (newtime != ct_dirtime || rescan) {
+        rescan = 0;
         scanctdir();
 #if DEBUG
         printf("scanctdir:  time WAS %s", ctime(&ct_dirtime));
@@ -321,21 +419,23 @@ checkcrondir()
 #endif
         ct_dirtime = newtime;
         printcrontab(tabs, nrtabs);
+        return 1;
     }
+    return 0;
 }
 
 
 /*
- * cron.
+ * cron.  Sleep until the earliest job in the run queue is due, waking at
+ * least every interval minutes to look for changed crontabs.
  */
 int
 main(int argc, char **argv)
 {
-    time_t ticks;
-    Evmask Now;
-    int i, j;
-    int interval = 1;
-    unsigned int delay;
+    time_t now, last;
+    long delay;
+    int interval = 10;
+    runent e;
 
     pgm = argv[0];
     if (argc > 1)
@@ -362,63 +462,31 @@ main(int argc, char **argv)
     info("startup");
 
     signal(SIGCHLD, eat);
-    signal(SIGHUP, SIG_IGN);
+    signal(SIGHUP, hup);
 
+    last = 0;
     while (1) {
-        struct tm *tm;
-        int adjust;
-
-#if TEST
-        unsigned int n = 2;
-        do {
-            printf("cron: sleep start %d\n", n);
-            n = sleep(n);
-            printf("cron: sleep return %d\n", n);
-        } while (n > 0);
-#else
-        time(&ticks);
-        tm = localtime(&ticks);
-        adjust = (30 - tm->tm_sec) % 60;
-        /*
-         * if ( adjust ) error("adjust: %d", adjust);
-         */
-        if (adjust < -15 || adjust > 15)
-            error("adjust: %d", adjust);
-
-        delay = (60 * interval) + adjust;
-        if (delay > 300)
-            error("long delay: %d", delay);
-
-        while (delay) {
-            unsigned int left = sleep(delay);
-            if (left > delay) {
-                error("sleep(%d) returned %d", delay, left);
-                //--delay;
-            } else
-                delay = left;
+        time(&now);
+        /* reschedule on crontab changes or if the clock was set back */
+        if (checkcrondir() || now < last)
+            schedule(now);
+        last = now;
+
+        while (nrrunq && runq[0].next <= now) {
+            e = runq_pop();
+            if (now - e.next < 60)      /* skip runs missed while asleep */
+                runjob(&tabs[e.tab], &tabs[e.tab].list[e.job]);
+            if ((e.next = nextrun(&tabs[e.tab].list[e.job].trigger, now)) != 0)
+                runq_push(e.next, e.tab, e.job);
         }
-#endif
 
-        checkcrondir();
-
-        time(&ticks);
-        tm = localtime(&ticks);
-        tmtoEvmask(tm, interval, &Now);
+        delay = 60L * interval;
+        if (nrrunq && runq[0].next - now < delay)
+            delay = runq[0].next - now;
 #if DEBUG
-        printf("run Evmask:");
-        printtrig(&Now);
-        putchar('\n');
-#endif
-
-        for (i = 0; i < nrtabs; i++) {
-            for (j = 0; j < tabs[i].nrl; j++) {
-#if !TEST
-                if ((tabs[i].flags & ACTIVE) && triggered(&Now, &(tabs[i].list[j].trigger)))
+        printf("cron: %d jobs queued, sleep %ld\n", nrrunq, delay);
 #endif
-                {
-                    runjob(&tabs[i], &tabs[i].list[j]);
-                }
-            }
-        }
+        if (delay > 0)
+            sleep((unsigned int)delay);    /* signals cut it short, recheck */
     }
 }
@@ -17,6 +17,8 @@
 #include <errno.h>
 #include <paths.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <spawn.h>
 #ifdef ELKS
 #include <linuxmt/fs.h>
 #endif
@@ -35,8 +37,11 @@ runjobprocess(crontab *tab, cron *job, struct passwd *usr)
     char *home = usr->pw_dir ? usr->pw_dir : "/tmp";
     int status;
     int input[2];
+    int ret;
     char *shell;
-    input[0] = input[1] = 0;
+    char *argv[4];
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
 
 #if TEST
     printf("cron: running '%s'\n", job->command);
@@ -55,32 +60,36 @@ runjobprocess(crontab *tab, cron *job, struct passwd *usr)
     if (chdir(home) == -1)
         fatal("chdir(\"%s\"): %s", home, strerror(errno));
 
-    if ((jpid = fork()) == -1)
-        fatal("job fork(): %s", strerror(errno));
-    else if (jpid == 0) {       /* the job to run */
-        info("(%s) CMD (%s)", usr->pw_name, job->command);
-
-        setsid();
-
-        close(input[1]);
-        close(0);
-        dup2(input[0], 0);
-        close(input[0]);
-        close(2);
-        dup2(1, 2);
-
-        execle(shell, "sh", "-c", job->command, (char *)0, tab->env);
-        perror(shell);
-        exit(1);
-    } else {                    /* runjobprocess() */
-        close(input[0]);
-
-        if (job->input && (fork() == 0)) {
+    /* spawn the job to run, with stdin from job->input and stderr to stdout */
+    info("(%s) CMD (%s)", usr->pw_name, job->command);
+    posix_spawn_file_actions_init(&fa);
+    if (job->input) {
+        if (pipe(input) == -1)
+            fatal("job pipe(): %s", strerror(errno));
+        posix_spawn_file_actions_adddup2(&fa, input[0], 0);
+        posix_spawn_file_actions_addclose(&fa, input[0]);
+        posix_spawn_file_actions_addclose(&fa, input[1]);
+    } else
+        posix_spawn_file_actions_addopen(&fa, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&fa, 1, 2);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+
+    argv[0] = "sh";
+    argv[1] = "-c";
+    argv[2] = job->command;
+    argv[3] = NULL;
+    ret = posix_spawn(&jpid, shell, &fa, &attr, argv, tab->env);
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    if (ret)
+        fatal("can't spawn(\"%s\"): %s", shell, strerror(ret));
+    else {                      /* runjobprocess() */
+        if (job->input) {
+            close(input[0]);
             write(input[1], job->input, strlen(job->input));
             close(input[1]);
-            exit(0);
         }
-        close(input[1]);
 
 #ifdef _PATH_MAIL //no email support in ELKS yet
         if (fork() == 0) {
@@ -2,39 +2,172 @@
  * ELKS instrumentation functions for ia16-elf-gcc
  *
  * June 2022 Greg Haerr
+ *
+ * Run an instrumented program with --ftrace or FTRACE=1 to trace each call,
+ * or with FTRACE=prof to instead count calls and time per function and
+ * print a summary sorted by exclusive time on exit. Without RDTSC the
+ * times come from gettimeofday, so they include its system call overhead.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/time.h>
 #include "instrument.h"
 #include "syms.h"
 
-/* turn on for microcycle (CPU cycle/1000) timing info */
+/* turn on for microcycle (CPU cycle/1000) timing info, else microseconds */
 #define HAS_RDTSC       0   /* has RDTSC instruction: requires 386+ CPU */
 
+#define FTRACE_TRACE    1   /* print each call */
+#define FTRACE_PROF     2   /* accumulate per function histogram */
+
+#define NR_FUNCS        256 /* functions profiled, power of 2 */
+#define MAX_DEPTH       64  /* call depth timed */
+
+struct fprof {
+    int *addr;                  /* address in function, 0 if unused */
+    unsigned long calls;
+    unsigned long incl;         /* time including called functions */
+    unsigned long excl;         /* time in the function itself */
+    unsigned int max_stack;     /* max stack used on entry */
+};
+
+struct fframe {
+    struct fprof *fp;
+    unsigned long start;
+    unsigned long child;        /* time in called functions */
+};
+
 static char ftrace;
 static int count;
 static unsigned int start_sp;
 static unsigned int max_stack;
 
+static struct fprof *fprof;
+static struct fframe fstack[MAX_DEPTH];
+static unsigned long now;       /* sum of _get_micro_count deltas */
+static int lost;                /* calls not counted, fprof full */
+
+static void noinstrument ftrace_prof_summary(void);
+
 /* runs before main and rewrites argc/argv on stack if --ftrace found */
 __attribute__((no_instrument_function,constructor(120)))
 static void ftrace_checkargs(void)
 {
     char **avp = __argv + 1;
+    char *env = getenv("FTRACE");
 
-    if ((*avp && !strcmp(*avp, "--ftrace")) || getenv("FTRACE")) {
+    if (*avp && !strcmp(*avp, "--ftrace")) {
         while (*avp) {
             *avp = *(avp + 1);
             avp++;
         }
-        ftrace = 1;
+        ftrace = FTRACE_TRACE;
         __argc--;
+    } else if (env)
+        ftrace = strcmp(env, "prof")? FTRACE_TRACE: FTRACE_PROF;
+    if (ftrace == FTRACE_PROF) {
+        fprof = calloc(NR_FUNCS, sizeof(struct fprof));
+        if (!fprof || atexit(ftrace_prof_summary) < 0) {
+            free(fprof);
+            fprof = NULL;
+            ftrace = 0;
+        }
     }
     _get_micro_count();     /* init timer base */
 }
 
+/* find or add the histogram entry for a function */
+static struct fprof * noinstrument ftrace_prof_lookup(int *addr)
+{
+    unsigned int i = ((unsigned int)addr >> 1) & (NR_FUNCS - 1);
+    int n;
+
+    for (n = 0; n < NR_FUNCS; n++) {
+        if (fprof[i].addr == addr)
+            return &fprof[i];
+        if (!fprof[i].addr) {
+            fprof[i].addr = addr;
+            return &fprof[i];
+        }
+        i = (i + 1) & (NR_FUNCS - 1);
+    }
+    lost++;
+    return NULL;
+}
+
+static void noinstrument ftrace_prof_enter(int *calling_fn, unsigned int stack_used)
+{
+    struct fprof *fp;
+
+    now += _get_micro_count();
+    if (count < MAX_DEPTH) {
+        fp = ftrace_prof_lookup(calling_fn);
+        if (fp) {
+            fp->calls++;
+            if (stack_used > fp->max_stack)
+                fp->max_stack = stack_used;
+        }
+        fstack[count].fp = fp;
+        fstack[count].start = now;
+        fstack[count].child = 0;
+    }
+    ++count;
+}
+
+static void noinstrument ftrace_prof_exit(void)
+{
+    struct fframe *f;
+    unsigned long elapsed;
+
+    now += _get_micro_count();
+    if (--count >= MAX_DEPTH || count < 0)
+        return;
+    f = &fstack[count];
+    elapsed = now - f->start;
+    if (f->fp) {
+        f->fp->incl += elapsed;
+        f->fp->excl += elapsed - f->child;
+    }
+    if (count > 0)
+        fstack[count - 1].child += elapsed;
+}
+
+static int noinstrument ftrace_prof_cmp(const void *a, const void *b)
+{
+    const struct fprof *fa = a;
+    const struct fprof *fb = b;
+
+    if (fa->excl != fb->excl)
+        return fa->excl < fb->excl? 1: -1;
+    return fa->calls < fb->calls? 1: (fa->calls > fb->calls? -1: 0);
+}
+
+/* called at exit: close out functions not returned from and print the summary */
+static void noinstrument ftrace_prof_summary(void)
+{
+    struct fprof *fp;
+    unsigned long total = 0;
+
+    ftrace = 0;
+    while (count > 0)
+        ftrace_prof_exit();
+    qsort(fprof, NR_FUNCS, sizeof(struct fprof), ftrace_prof_cmp);
+    for (fp = fprof; fp < &fprof[NR_FUNCS] && fp->addr; fp++)
+        total += fp->excl;
+    fprintf(stderr, "\n%10s %10s %10s %5s %5s  %s (%s)\n", "CALLS", "INCL", "EXCL", "%",
+        "STACK", "FUNCTION", HAS_RDTSC? "kcycles": "usecs");
+    for (fp = fprof; fp < &fprof[NR_FUNCS] && fp->addr; fp++) {
+        fprintf(stderr, "%10lu %10lu %10lu %5lu %5u  %s\n", fp->calls, fp->incl, fp->excl,
+            total? fp->excl * 100 / total: 0UL, fp->max_stack,
+            sym_text_symbol(fp->addr, 0));
+    }
+    if (lost)
+        fprintf(stderr, "%d calls to functions past the first %d not counted\n",
+            lost, NR_FUNCS);
+}
+
 /* every function this function calls must also be noinstrument!! */
 void noinstrument __cyg_profile_func_enter_simple(void)
 {
@@ -57,6 +190,11 @@ void noinstrument __cyg_profile_func_enter_simple(void)
     unsigned int stack_used = start_sp - (unsigned int)bp;
     if (stack_used > max_stack) max_stack = stack_used;
 
+    if (ftrace == FTRACE_PROF) {
+        ftrace_prof_enter(calling_fn, stack_used);
+        return;
+    }
+
     /* calc caller address */
     i = _get_push_count(calling_fn);
     if (i & BP_PUSHED) {            /* caller pushed BP */
@@ -80,11 +218,13 @@ void noinstrument __cyg_profile_func_enter_simple(void)
 
 void noinstrument __cyg_profile_func_exit_simple(void)
 {
-    if (ftrace)
+    if (ftrace == FTRACE_PROF)
+        ftrace_prof_exit();
+    else if (ftrace)
         --count;
 }
 
-/* return CPU cycles / 1000 via RDTSC instruction */
+/* return CPU cycles / 1000 via RDTSC instruction, else microseconds, since last call */
 unsigned long noinstrument _get_micro_count(void)
 {
 #if HAS_RDTSC
@@ -95,7 +235,14 @@ unsigned long noinstrument _get_micro_count(void)
     last_ts = ts;
     return diff;
 #else
-    return 0;
+    static struct timeval last_tv;
+    struct timeval tv;
+    unsigned long diff;
+
+    gettimeofday(&tv, NULL);
+    diff = (tv.tv_sec - last_tv.tv_sec) * 1000000L + tv.tv_usec - last_tv.tv_usec;
+    last_tv = tv;
+    return diff;
 #endif
 }
 
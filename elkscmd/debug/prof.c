@@ -0,0 +1,198 @@
+/*
+ * ELKS sampling profiler control and report
+ *
+ * Starts and stops the kernel timer tick profiler, then reads its
+ * histogram through /dev/kmem and lists the functions where the
+ * samples fell, using the kernel and program symbol tables.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/ioctl.h>
+#include <linuxmt/mem.h>
+#include "syms.h"
+
+#define KSYMTAB     "/lib/system.sym"
+#define DEFSHIFT    4       /* 16 bytes per bucket */
+#define MAXFNS      200     /* functions kept per region */
+#define CHUNK       256     /* buckets read at a time */
+
+struct fn {
+    char name[32];
+    unsigned long count;
+};
+
+static struct fn fns[MAXFNS];
+static int nfns;
+static unsigned int hist[CHUNK];
+
+static char *region_name[PROF_REGIONS] = { ".text", ".fartext", "user" };
+
+static void noinstrument add_sample(char *name, unsigned int count)
+{
+    /* buckets are read in address order, so a function's buckets are adjacent */
+    if (nfns && !strncmp(fns[nfns-1].name, name, sizeof(fns[0].name) - 1)) {
+        fns[nfns-1].count += count;
+        return;
+    }
+    if (nfns >= MAXFNS)
+        return;
+    strncpy(fns[nfns].name, name, sizeof(fns[0].name) - 1);
+    fns[nfns++].count = count;
+}
+
+static int noinstrument cmp_count(const void *a, const void *b)
+{
+    unsigned long ca = ((struct fn *)a)->count;
+    unsigned long cb = ((struct fn *)b)->count;
+
+    return (ca < cb)? 1: (ca > cb)? -1: 0;
+}
+
+static char * noinstrument bucket_name(int r, unsigned int addr, unsigned char *table)
+{
+    static char buf[8];
+
+    if (!table) {
+        sprintf(buf, "%04x", addr);
+        return buf;
+    }
+    sym_select(table);
+    if (r == PROF_KFTEXT)
+        return sym_ftext_symbol((void *)addr, 0);
+    return sym_text_symbol((void *)addr, 0);
+}
+
+static void noinstrument report(int fd, struct prof_stats *ps, int r,
+    unsigned char *table, int top)
+{
+    unsigned int i, j, n;
+    unsigned long total = ps->samples[r];
+
+    if (!total)
+        return;
+    printf("\n%s %04x: %lu samples\n", region_name[r], ps->cs[r], total);
+
+    nfns = 0;
+    if (lseek(fd, ((long)ps->seg << 4) + (long)r * ps->buckets * 2, SEEK_SET) == -1)
+        return;
+    for (i = 0; i < ps->buckets; i += n) {
+        n = ps->buckets - i;
+        if (n > CHUNK)
+            n = CHUNK;
+        if (read(fd, hist, n * 2) != n * 2) {
+            perror("prof");
+            return;
+        }
+        for (j = 0; j < n; j++) {
+            if (hist[j])
+                add_sample(bucket_name(r, (i + j) << ps->shift, table), hist[j]);
+        }
+    }
+
+    qsort(fns, nfns, sizeof(struct fn), cmp_count);
+    printf("  COUNT    %%  FUNCTION\n");
+    for (i = 0; i < nfns && i < top; i++)
+        printf("%7lu %3lu%%  %s\n", fns[i].count, fns[i].count * 100 / total, fns[i].name);
+}
+
+static void usage(void)
+{
+    printf("Usage: prof -s [-p pid] [-g shift] | -x | -f | [-n count] [-k symfile] [-u program]\n");
+    exit(1);
+}
+
+int main(int ac, char **av)
+{
+    int fd, ch, top = 20;
+    int f_start = 0, f_stop = 0, f_free = 0;
+    char *ksymfile = KSYMTAB;
+    char *program = NULL;
+    unsigned char *ktable, *utable = NULL;
+    struct prof_ctl pc;
+    struct prof_stats ps;
+
+    pc.shift = DEFSHIFT;
+    pc.pid = 0;
+    while ((ch = getopt(ac, av, "sxfp:g:n:k:u:")) != -1) {
+        switch (ch) {
+        case 's':
+            f_start = 1;
+            break;
+        case 'x':
+            f_stop = 1;
+            break;
+        case 'f':
+            f_free = 1;
+            break;
+        case 'p':
+            pc.pid = atoi(optarg);
+            break;
+        case 'g':
+            pc.shift = atoi(optarg);
+            break;
+        case 'n':
+            top = atoi(optarg);
+            break;
+        case 'k':
+            ksymfile = optarg;
+            break;
+        case 'u':
+            program = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind < ac)
+        usage();
+
+    if ((fd = open("/dev/kmem", O_RDONLY)) < 0) {
+        perror("/dev/kmem");
+        return 1;
+    }
+    if (f_start || f_free) {
+        if (f_free)
+            pc.shift = 0;
+        if (ioctl(fd, MEM_PROFSTART, &pc) < 0) {
+            perror("prof");
+            return 1;
+        }
+        return 0;
+    }
+    if (f_stop) {
+        if (ioctl(fd, MEM_PROFSTOP, 0) < 0) {
+            perror("prof");
+            return 1;
+        }
+        return 0;
+    }
+
+    if (ioctl(fd, MEM_GETPROF, &ps) < 0) {
+        perror("prof");
+        return 1;
+    }
+    if (!ps.seg) {
+        printf("Profiler not started\n");
+        return 1;
+    }
+    printf("Profile %s, %u bytes per bucket, pid %u, %lu other samples\n",
+        ps.running? "running": "stopped", 1 << ps.shift, ps.pid, ps.other);
+
+    ktable = sym_read_symbols(ksymfile);
+    if (!ktable)
+        printf("Can't open %s\n", ksymfile);
+    if (program) {
+        sym_select(NULL);
+        if (!(utable = sym_read_exe_symbols(program)))
+            printf("No symbols in %s\n", program);
+    }
+
+    report(fd, &ps, PROF_KTEXT, ktable, top);
+    report(fd, &ps, PROF_KFTEXT, ktable, top);
+    report(fd, &ps, PROF_USER, utable, top);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * ELKS system call latency tracer
+ *
+ * Enables the kernel syscall trace ring on /dev/sctrace, collects entries
+ * until the time limit or ^C, then prints per-syscall counts, average and
+ * maximum durations and a histogram of durations.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/ioctl.h>
+#include <linuxmt/mem.h>
+#include "../../elks/arch/i86/kernel/strace.h"
+
+#define DEVICE      "/dev/sctrace"
+#define NSYSCALLS   256
+#define NBUCKETS    8       /* <128us, <256us ... <8ms, longer */
+
+struct sc_stat {
+    unsigned long count;
+    unsigned long total;    /* usecs */
+    unsigned long max;
+    unsigned int hist[NBUCKETS];
+};
+
+static struct sc_stat stats[NSYSCALLS];
+static struct sctrace_ent ents[16];
+static struct sctrace_ctl ctl;
+static volatile int done;
+static int f_verbose;
+static int f_pid;
+
+static char *bucket_label[NBUCKETS] = {
+    "128u", "256u", "512u", "1m", "2m", "4m", "8m", "more" };
+
+static void stop(int sig)
+{
+    done = 1;
+}
+
+static const char *sc_name(unsigned int n)
+{
+    static char buf[8];
+    const char *name = NULL;
+
+    if (n < sizeof(elks_table1)/sizeof(struct sc_info))
+        name = elks_table1[n].s_name;
+    else if (n >= START_TABLE2 && n < START_TABLE2 + sizeof(elks_table2)/sizeof(struct sc_info))
+        name = elks_table2[n - START_TABLE2].s_name;
+    if (name)
+        return name;
+    sprintf(buf, "#%u", n);
+    return buf;
+}
+
+/* timer counts to microseconds without overflowing 32 bits */
+static unsigned long usecs(unsigned long counts)
+{
+    unsigned int t = ctl.ticks_per_jiffy;
+
+    return (counts / t) * ctl.usecs_per_jiffy +
+        (counts % t) * ctl.usecs_per_jiffy / t;
+}
+
+static void add_entry(struct sctrace_ent *e)
+{
+    struct sc_stat *s;
+    unsigned long us;
+    int b;
+
+    if (f_pid && e->pid != f_pid)
+        return;
+    us = usecs(e->duration);
+    if (f_verbose)
+        printf("%5u %-12s %9lu:%-5u %6d %7luus\n", e->pid, sc_name(e->callno),
+            e->jiffies, e->count, e->retval, us);
+    s = &stats[e->callno & (NSYSCALLS - 1)];
+    s->count++;
+    s->total += us;
+    if (us > s->max)
+        s->max = us;
+    for (b = 0; b < NBUCKETS - 1; b++) {
+        if (us < (128UL << b))
+            break;
+    }
+    s->hist[b]++;
+}
+
+static void report(void)
+{
+    struct sc_stat *s;
+    int i, b;
+
+    printf("SYSCALL    COUNT  AVGus   MAXus");
+    for (b = 0; b < NBUCKETS; b++)
+        printf(" %5s", bucket_label[b]);
+    printf("\n");
+    for (i = 0; i < NSYSCALLS; i++) {
+        s = &stats[i];
+        if (!s->count)
+            continue;
+        printf("%-9s %6lu %6lu %7lu", sc_name(i), s->count, s->total / s->count, s->max);
+        for (b = 0; b < NBUCKETS; b++)
+            printf(" %5u", s->hist[b]);
+        printf("\n");
+    }
+    if (ctl.lost)
+        printf("%u entries lost\n", ctl.lost);
+}
+
+static void usage(void)
+{
+    printf("Usage: sctrace [-v] [-p pid] [-t seconds]\n");
+    exit(1);
+}
+
+int main(int ac, char **av)
+{
+    int fd, ch, n, i;
+    int seconds = 0;
+
+    while ((ch = getopt(ac, av, "vp:t:")) != -1) {
+        switch (ch) {
+        case 'v':
+            f_verbose = 1;
+            break;
+        case 'p':
+            f_pid = atoi(optarg);
+            break;
+        case 't':
+            seconds = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind < ac)
+        usage();
+
+    if ((fd = open(DEVICE, O_RDONLY)) < 0) {
+        perror(DEVICE);
+        return 1;
+    }
+    signal(SIGINT, stop);
+    signal(SIGALRM, stop);
+    ctl.enable = 1;
+    if (ioctl(fd, MEM_SCTRACE, &ctl) < 0) {
+        perror("sctrace");
+        return 1;
+    }
+    if (seconds)
+        alarm(seconds);
+    if (f_verbose)
+        printf("  PID SYSCALL      ENTRY JIFFY:COUNT    RET DURATION\n");
+
+    while (!done) {
+        n = read(fd, ents, sizeof(ents));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("sctrace");
+            break;
+        }
+        for (i = 0; i < n / (int)sizeof(struct sctrace_ent); i++)
+            add_entry(&ents[i]);
+    }
+
+    ctl.enable = 0;
+    ioctl(fd, MEM_SCTRACE, &ctl);
+    /* drain anything traced before tracing stopped */
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    while ((n = read(fd, ents, sizeof(ents))) > 0) {
+        for (i = 0; i < n / (int)sizeof(struct sctrace_ent); i++)
+            add_entry(&ents[i]);
+    }
+    close(fd);
+    report();
+    return 0;
+}
@@ -80,6 +80,15 @@ unsigned char * noinstrument sym_read_symbols(char *path)
     return syms;
 }
 
+/* switch the symbol table used for lookups, returns the previous one */
+unsigned char * noinstrument sym_select(unsigned char *table)
+{
+    unsigned char *old = syms;
+
+    syms = table;
+    return old;
+}
+
 static int noinstrument type_text(unsigned char *p)
 {
     return (p[TYPE] == 'T' || p[TYPE] == 't' || p[TYPE] == 'W');
@@ -21,6 +21,7 @@
 
 unsigned char * noinstrument sym_read_exe_symbols(char *path);
 unsigned char * noinstrument sym_read_symbols(char *path);
+unsigned char * noinstrument sym_select(unsigned char *table);
 char * noinstrument sym_text_symbol(void *addr, int exact);
 char * noinstrument sym_ftext_symbol(void *addr, int exact);
 char * noinstrument sym_data_symbol(void *addr, int exact);
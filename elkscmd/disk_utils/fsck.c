@@ -733,13 +733,17 @@ void check_zones(unsigned int i)
 void check_file(struct minix_inode * dir, unsigned long offset)
 {
 	static char blk[BLOCK_SIZE];
+	static unsigned int blk_nr;	/* block held in blk, read once for all its entries */
 	struct minix_inode * inode;
 	int ino, width;
 	char * name;
 	unsigned int block;
 
 	block = map_block(dir,(unsigned int)(offset >> 10));
-	read_block(block, blk);
+	if (!block || block != blk_nr) {
+		read_block(block, blk);
+		blk_nr = block;
+	}
 	name = blk + (offset % BLOCK_SIZE);
 	ino = * (unsigned short *) (name);
 	name += 2;
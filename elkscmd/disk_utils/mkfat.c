@@ -19,6 +19,7 @@
 #define FAT_TYPE_32             3
 
 #define FAT_SECTOR_SIZE         512
+#define ZERO_SECTORS            16      // sectors zeroed per write
 
 typedef unsigned char uint8;
 typedef unsigned short uint16;
@@ -45,6 +46,7 @@ int    fat_type;
 int    ofd;
 uint32 blocks;
 uint8  sector[FAT_SECTOR_SIZE];
+uint8  zeroes[ZERO_SECTORS * FAT_SECTOR_SIZE];
 
 struct sec_per_clus_table
 {
@@ -154,19 +156,20 @@ static uint8 fatfs_calc_cluster_size(uint32 sectors, int is_fat32)
     return 0;
 }
 //-----------------------------------------------------------------------------
-// fatfs_erase_sectors: Erase a number of sectors
+// fatfs_erase_sectors: Erase a number of sectors, ZERO_SECTORS per write
 //-----------------------------------------------------------------------------
-static int fatfs_erase_sectors(uint32 lba, int count)
+static int fatfs_erase_sectors(uint32 lba, uint32 count)
 {
-    int i;
-
-    // Zero sector first
-    memset(sector, 0, FAT_SECTOR_SIZE);
+    unsigned int n, len;
 
-    for (i=0;i<count;i++) {
-		lseek(ofd, (lba + i) * FAT_SECTOR_SIZE, SEEK_SET);
-        if (write(ofd, sector, FAT_SECTOR_SIZE) != FAT_SECTOR_SIZE)
+    if (lseek(ofd, (long)lba * FAT_SECTOR_SIZE, SEEK_SET) < 0)
+        return 0;
+    while (count) {
+        n = count > ZERO_SECTORS? ZERO_SECTORS: (unsigned int)count;
+        len = n * FAT_SECTOR_SIZE;
+        if (write(ofd, zeroes, len) != len)
             return 0;
+        count -= n;
     }
 
     return 1;
@@ -455,8 +458,6 @@ static int fatfs_create_fsinfo_sector(uint32 sector_lba)
 //-----------------------------------------------------------------------------
 static int fatfs_erase_fat(int is_fat32)
 {
-    uint32 i;
-
     // Zero sector initially
     memset(sector, 0, FAT_SECTOR_SIZE);
 
@@ -487,13 +488,7 @@ static int fatfs_erase_fat(int is_fat32)
         return 0;
 
     // Zero remaining FAT sectors
-    memset(sector, 0, FAT_SECTOR_SIZE);
-    for (i=1;i<fat_sectors*num_of_fats;i++) {
-        lseek(ofd, (fat_begin_lba + i) * FAT_SECTOR_SIZE, SEEK_SET);
-        if (write(ofd, sector, FAT_SECTOR_SIZE) != FAT_SECTOR_SIZE)
-            return 0;
-    }
-    return 1;
+    return fatfs_erase_sectors(fat_begin_lba + 1, fat_sectors * num_of_fats - 1);
 }
 //-----------------------------------------------------------------------------
 // fatfs_format_fat16: Format a FAT16 partition
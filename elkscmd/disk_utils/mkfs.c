@@ -33,8 +33,12 @@
  *
  ***************************************************************************
  *
- * Usage:  mkfs [-c] [-nXX] [-iXX] device size-in-blocks
- *         mkfs [-l filename ] device size-in-blocks
+ * Usage:  mkfs [-l] device size-in-blocks
+ *
+ * With -l only the inode table block holding the root inode is written,
+ * the rest is left as found on the device. The kernel fills in the whole
+ * on-disk inode when it allocates one, so an unused inode's contents never
+ * matter.
  *
  * The device may be a block device or a image of one, but this isn't
  * enforced (but it's not much fun on a character device :-). 
@@ -68,6 +72,7 @@
 #define MINIX_BAD_INO 2
 
 #define TEST_BUFFER_BLOCKS 16
+#define ZERO_BLOCKS 8			/* inode table blocks zeroed per write */
 #define MAX_GOOD_BLOCKS 512
 
 #define UPPER(size,n) ((size+((long)(n)-1))/(n))
@@ -82,10 +87,12 @@ static int DEV = -1;
 static long BLOCKS = 0;
 
 static int dirsize = 16;
+static int lazy;
 static int magic = MINIX_SUPER_MAGIC;
 static unsigned int ikl;
 
 static char root_block[BLOCK_SIZE];
+static char zero_buffer[ZERO_BLOCKS * BLOCK_SIZE];
 
 static char * inode_buffer = NULL;
 #define Inode (((struct minix_inode *) inode_buffer)-1)
@@ -163,11 +170,13 @@ volatile void fatal_error(const char * fmt_string,int status)
 	exit(status);
 }
 
-#define usage() fatal_error("Usage: mkfs /dev/name blocks (Max blocks=65535)\n",16)
+#define usage() fatal_error("Usage: mkfs [-l] /dev/name blocks (Max blocks=65535)\n",16)
 #define die(str) fatal_error("mkfs: " str "\n",8)
 
 void write_tables(void)
 {
+	unsigned int n;
+
 	Super.s_state |= MINIX_VALID_FS;
 	Super.s_state &= ~MINIX_ERROR_FS;
 
@@ -182,8 +191,13 @@ void write_tables(void)
 		die("Unable to write zone map");
 	if (BLOCK_SIZE != write(DEV,inode_buffer,BLOCK_SIZE))
 		die("Unable to write inodes");
-	for (ikl=1;ikl<INODE_BLOCKS;ikl++) {
-		if (BLOCK_SIZE != write(DEV,inode_buffer + BLOCK_SIZE,BLOCK_SIZE))
+	if (lazy)
+		return;
+	for (ikl=1;ikl<INODE_BLOCKS;ikl+=n) {
+		n = INODE_BLOCKS - ikl;
+		if (n > ZERO_BLOCKS)
+			n = ZERO_BLOCKS;
+		if (n*BLOCK_SIZE != write(DEV,zero_buffer,n*BLOCK_SIZE))
 			die("Unable to write inodes");
 	}
 }
@@ -261,10 +275,10 @@ void setup_tables(void)
 		unmark_zone(i);
 	for (i = MINIX_ROOT_INO ; i<INODES ; i++)
 		unmark_inode(i);
-	inode_buffer = malloc(2048);
+	inode_buffer = malloc(BLOCK_SIZE);
 	if (!inode_buffer)
 		die("Unable to allocate buffer for inodes");
-	memset(inode_buffer,0,2048);
+	memset(inode_buffer,0,BLOCK_SIZE);
 	printf("%u inodes\n",INODES);
 	printf("%u blocks\n",ZONES);
 	printf("Firstdatazone=%d (%ld)\n",FIRSTZONE,NORM_FIRSTZONE);
@@ -281,6 +295,11 @@ int main(int argc, char ** argv)
 	if (INODE_SIZE * MINIX_INODES_PER_BLOCK != BLOCK_SIZE)
 		die("bad inode size");
 
+	if (argc > 1 && !strcmp(argv[1], "-l")) {
+		lazy = 1;
+		argv++;
+		argc--;
+	}
 	if ((argc == 3) && (argv[1][0] != '-') && (argv[2][0] != '-')) {
 		BLOCKS = strtol(argv[2],&tmp,0);
 		if (*tmp) {
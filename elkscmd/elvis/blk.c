@@ -22,6 +22,14 @@
 # define NBUFS	3		/* must be at least 3 -- more is better */
 #endif
 
+#ifdef __ia16__
+# include <malloc.h>
+# include <string.h>
+# ifndef NFARBLKS
+#  define NFARBLKS	32	/* blocks cached in far memory, at most 63 */
+# endif
+#endif
+
 extern long lseek();
 
 /*------------------------------------------------------------------------*/
@@ -40,6 +48,48 @@ static struct _blkbuf
 		*newtoo,	/* another buffer which should be recycled */
 		*recycle = blk;	/* next block to be recycled */
 
+#ifdef __ia16__
+/* Blocks of the tmp file are also kept in a far memory cache, so a block
+ * that has been used before can usually be fetched again without reading
+ * the tmp file.  The cache is direct mapped on the physical block number
+ * and written through, so the tmp file stays complete for recovery.
+ */
+static char __far	*farblk;		/* NFARBLKS far block buffers */
+static unsigned short	fartag[NFARBLKS];	/* physical block in each, or 0 */
+
+/* This function copies a physical block from the far cache, if it's there */
+static int farget(physical, buf)
+	unsigned short	physical;	/* physical block number */
+	char		*buf;		/* where to put the block */
+{
+	int	i = physical % NFARBLKS;
+
+	if (!farblk || fartag[i] != physical)
+	{
+		return FALSE;
+	}
+	fmemcpy(buf, farblk + i * BLKSIZE, BLKSIZE);
+	return TRUE;
+}
+
+/* This function puts a physical block into the far cache */
+static void farput(physical, buf)
+	unsigned short	physical;	/* physical block number */
+	char		*buf;		/* the block's text */
+{
+	int	i = physical % NFARBLKS;
+
+	if (farblk)
+	{
+		fmemcpy(farblk + i * BLKSIZE, buf, BLKSIZE);
+		fartag[i] = physical;
+	}
+}
+#else
+# define farget(physical, buf)	FALSE
+# define farput(physical, buf)
+#endif
+
 
 
 
@@ -58,6 +108,16 @@ void blkinit()
 	{
 		hdr.n[i] = 0;
 	}
+#ifdef __ia16__
+	if (!farblk)
+	{
+		farblk = fmemalloc((long)NFARBLKS * BLKSIZE);
+	}
+	for (i = 0; i < NFARBLKS; i++)
+	{
+		fartag[i] = 0;
+	}
+#endif
 }
 
 /* This function allocates a buffer and fills it with a given block's text */
@@ -101,11 +161,18 @@ BLK *blkget(logical)
 	this->logical = logical;
 	if (hdr.n[logical])
 	{
-		/* it has been used before - fill it from tmp file */
-		lseek(tmpfd, (long)hdr.n[logical] * (long)BLKSIZE, 0);
-		if (read(tmpfd, this->buf.c, (unsigned)BLKSIZE) != BLKSIZE)
+		/* it has been used before - fill it from the cache or tmp file */
+		if (!farget(hdr.n[logical], this->buf.c))
 		{
-			msg("Error %d reading back from tmp file!", errno);
+			lseek(tmpfd, (long)hdr.n[logical] * (long)BLKSIZE, 0);
+			if (read(tmpfd, this->buf.c, (unsigned)BLKSIZE) != BLKSIZE)
+			{
+				msg("Error %d reading back from tmp file!", errno);
+			}
+			else
+			{
+				farput(hdr.n[logical], this->buf.c);
+			}
 		}
 	}
 	else
@@ -167,6 +234,7 @@ void blkflush(this)
 	{
 		msg("Trouble writing to tmp file");
 	}
+	farput(physical, this->buf.c);
 	this->dirty = FALSE;
 
 	/* update the header so it knows we put it there */
@@ -26,6 +26,63 @@
 /* This variable contains the line number that smartdrawtext() knows best */
 static long smartlno;
 
+/* These are checksums of the text shown on each screen row, so a redraw can
+ * skip rows that already show the right text.  Zero means "unknown".
+ */
+#define SUMROWS	64
+static unsigned long rowsum[SUMROWS];
+
+/* This function computes the checksum of a line as it would be drawn */
+static unsigned long linesum(text)
+	REG char	*text;	/* the text of the line */
+{
+	REG unsigned long	sum;
+
+	sum = ((long)leftcol << 10) ^ (*o_tabstop << 1) ^ (*o_list != 0);
+	while (*text)
+	{
+		sum = (sum << 5) + sum + *text++;
+	}
+	return sum | 1;
+}
+
+/* This function records the checksum of the line drawn on a screen row */
+static void setsum(row, text)
+	int	row;	/* screen row */
+	char	*text;	/* text drawn there */
+{
+	if (row >= 0 && row < SUMROWS)
+	{
+		rowsum[row] = linesum(text);
+	}
+}
+
+/* This function adjusts the checksums when n rows are inserted into the
+ * screen at row, or deleted from it if n is negative.
+ */
+static void shiftsums(row, n)
+	int	row;	/* first screen row that moves */
+	int	n;	/* number of rows inserted/deleted */
+{
+	int	i;
+	int	rows = (LINES - 1 < SUMROWS ? LINES - 1 : SUMROWS);
+
+	if (n > 0)
+	{
+		for (i = rows; --i >= row; )
+		{
+			rowsum[i] = (i - n >= row ? rowsum[i - n] : 0L);
+		}
+	}
+	else
+	{
+		for (i = row; i < rows; i++)
+		{
+			rowsum[i] = (i - n < rows ? rowsum[i - n] : 0L);
+		}
+	}
+}
+
 /* This function remebers where changes were made, so that the screen can be
  * redraw in a more efficient manner.
  */
@@ -464,7 +521,7 @@ static void drawtext(text, clr)
 }
 
 
-#ifndef CRUNCH
+#ifndef NO_SMARTDRAW
 static void nudgecursor(same, scan, new, lno)
 	int	same;	/* number of chars to be skipped over */
 	char	*scan;	/* where the same chars end */
@@ -489,7 +546,7 @@ static void nudgecursor(same, scan, new, lno)
 		}
 	}
 }
-#endif /* not CRUNCH */
+#endif /* not NO_SMARTDRAW */
 
 /* This function draws a single line of text on the screen, possibly with
  * some cursor optimization.  The cursor is repositioned before drawing
@@ -499,10 +556,11 @@ static void smartdrawtext(text, lno)
 	char	*text;	/* the text to draw */
 	long		lno;	/* line number of the text */
 {
-#ifdef CRUNCH
+	setsum((int)(lno - topline), text);
+#ifdef NO_SMARTDRAW
 	move((int)(lno - topline), 0);
 	drawtext(text, TRUE);
-#else /* not CRUNCH */
+#else /* not NO_SMARTDRAW */
 	static char	old[256];	/* how the line looked last time */
 	char		new[256];	/* how it looks now */
 	char		*build;		/* used to put chars into new[] */
@@ -703,7 +761,7 @@ static void smartdrawtext(text, lno)
 			*build++ = ' ';
 		}
 	}
-#endif /* not CRUNCH */
+#endif /* not NO_SMARTDRAW */
 }
 
 
@@ -739,6 +797,10 @@ void redraw(curs, inputting)
 		postredraw = 0L;
 		chgs = 0;
 		smartlno = 0L;
+		for (i = 0; i < SUMROWS; i++)
+		{
+			rowsum[i] = 0L;
+		}
 		return;
 	}
 
@@ -776,6 +838,8 @@ void redraw(curs, inputting)
 					insertln();
 				}
 				text = fetchline(topline);
+				shiftsums(0, 1);
+				setsum(0, text);
 				drawtext(text, FALSE);
 				do_UP();
 			}
@@ -807,6 +871,8 @@ void redraw(curs, inputting)
 			{
 				topline++; /* <-- also adjusts botline */
 				text = fetchline(botline);
+				shiftsums(0, -1);
+				setsum(LINES - 2, text);
 				drawtext(text, FALSE);
 			}
 			mustredraw = FALSE;
@@ -887,6 +953,7 @@ void redraw(curs, inputting)
 				{
 					insertln();
 				}
+				shiftsums((int)(l - topline), (int)(postredraw - preredraw));
 
 				/* NOTE: the contents of those lines will be
 				 * drawn as part of the regular redraw loop.
@@ -921,6 +988,7 @@ void redraw(curs, inputting)
 				{
 					deleteln();
 				}
+				shiftsums((int)(postredraw - topline), (int)(postredraw - l));
 
 				/* draw the lines that are now newly visible
 				 * at the bottom of the screen
@@ -936,10 +1004,12 @@ void redraw(curs, inputting)
 					if (l <= nlines)
 					{
 						text = fetchline(l);
+						setsum((int)(l - topline), text);
 						drawtext(text, FALSE);
 					}
 					else
 					{
+						setsum((int)(l - topline), "~");
 						addstr("~\n");
 					}
 				}
@@ -976,10 +1046,23 @@ void redraw(curs, inputting)
 				continue;
 			}
 
+			/* skip the line if it is already on the screen */
+			text = (l <= nlines ? fetchline(l) : "~");
+			i = (int)(l - topline);
+			if (i < SUMROWS && rowsum[i] == linesum(text))
+			{
+#if OSK
+				qaddch('\l');
+#else
+				qaddch('\n');
+#endif
+				continue;
+			}
+			setsum(i, text);
+
 			/* draw the line, or ~ for non-lines */
 			if (l <= nlines)
 			{
-				text = fetchline(l);
 				drawtext(text, TRUE);
 			}
 			else
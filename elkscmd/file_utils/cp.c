@@ -14,6 +14,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/sendfile.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <pwd.h>
@@ -24,6 +25,7 @@
 #include <limits.h>
 
 #define BUF_SIZE	BUFSIZ		/* use disk block size for stack limit and efficiency*/
+#define XFER_MAX	16384		/* largest transfer per system call */
 
 int opt_recurse;	/* implicitly initialized */
 int opt_verbose;
@@ -46,6 +48,8 @@ int copyfile(char *srcname, char *destname, int setmodes);
 #endif
 
 static char buf[BUF_SIZE];
+static char *xferbuf = buf;
+static int xfersize = BUF_SIZE;
 
 struct list_node_s {
 	struct list_node_s *prev;
@@ -528,6 +532,25 @@ int isadir(char *name)
 	return S_ISDIR(statbuf.st_mode);
 }
 
+/*
+ * Use the largest buffer up to XFER_MAX that can be had for read/write
+ * copies, so each system call moves several disk blocks.
+ */
+static void alloc_xferbuf(void)
+{
+	int size;
+
+	if (xferbuf != buf)
+		return;
+	for (size = XFER_MAX; size > BUF_SIZE; size >>= 1) {
+		if ((xferbuf = malloc(size)) != NULL) {
+			xfersize = size;
+			return;
+		}
+	}
+	xferbuf = buf;
+}
+
 /*
  * Copy one file to another, while possibly preserving its modes, times,
  * and modes.  Returns 0 if successful, or 1 on a failure with an
@@ -581,16 +604,22 @@ int copyfile(char *srcname, char *destname, int setmodes)
 		}
 	}
 
-	while ((rcc = read(rfd, buf, BUF_SIZE)) > 0) {
-		bp = buf;
-		while (rcc > 0) {
-			wcc = write(wfd, bp, rcc);
-			if (wcc < 0) {
-				perror(destname);
-				goto error_exit;
+	/* copy in the kernel from the buffer cache when the fs allows it */
+	while ((rcc = sendfile(wfd, rfd, NULL, XFER_MAX)) > 0)
+		continue;
+	if (rcc < 0 && errno == EINVAL) {
+		alloc_xferbuf();
+		while ((rcc = read(rfd, xferbuf, xfersize)) > 0) {
+			bp = xferbuf;
+			while (rcc > 0) {
+				wcc = write(wfd, bp, rcc);
+				if (wcc < 0) {
+					perror(destname);
+					goto error_exit;
+				}
+				bp += wcc;
+				rcc -= wcc;
 			}
-			bp += wcc;
-			rcc -= wcc;
 		}
 	}
 
@@ -14,6 +14,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
+#include <arch/hdreg.h>
 
 #define	PAR_NONE	0
 #define	PAR_IF		1
@@ -39,9 +41,30 @@ static struct param params[] = {
 	{ NULL,		PAR_NONE }
 };
 
+#define XFER_MAX	16384		/* largest default transfer */
+
 /* Fixed buffer */
 static char localbuf[BUFSIZ];		/* use disk block size for efficiency*/
 
+/*
+ * Default transfer size when no bs= is given: whole tracks when either
+ * file is a disk, so an image copy reads a track per call, otherwise
+ * XFER_MAX.
+ */
+static int xfer_size(int infd, int outfd)
+{
+	struct hd_geometry geom;
+	int track;
+
+	if (ioctl(infd, HDIO_GETGEO, &geom) < 0 &&
+	    ioctl(outfd, HDIO_GETGEO, &geom) < 0)
+		return XFER_MAX;
+	track = geom.sectors * 512;
+	if (track <= 0 || track > XFER_MAX)
+		return XFER_MAX;
+	return (XFER_MAX / track) * track;
+}
+
 /*
  * Read a number with a possible multiplier.
  * Returns -1 if the number format is illegal.
@@ -95,6 +118,8 @@ int main(int argc, char **argv)
 	int	incc = 0;
 	int	outcc;
 	int	blocksize;
+	int	xfer;
+	int	bsgiven = 0;
 	long	count = -1;
 	long	seekval;
 	long	skipval;
@@ -148,6 +173,7 @@ int main(int argc, char **argv)
 					errmsg("Bad block size value\n");
 					goto usage;
 				}
+				bsgiven = 1;
 				break;
 
 			case PAR_COUNT:
@@ -189,13 +215,6 @@ int main(int argc, char **argv)
 	}
 
 	buf = localbuf;
-	if (blocksize > sizeof(localbuf)) {
-		buf = malloc(blocksize);
-		if (buf == NULL) {
-			errmsg("Cannot allocate buffer\n");
-			return retval;
-		}
-	}
 
 	if (!strcmp(infile, "-"))  {
 		infd = 0;
@@ -219,6 +238,29 @@ int main(int argc, char **argv)
 		}
 	}
 
+	/*
+	 * An explicit bs= is used for each read. Otherwise records stay at
+	 * 512 bytes but are transferred several at a time, as large as
+	 * memory allows.
+	 */
+	xfer = blocksize;
+	if (!bsgiven) {
+		for (xfer = xfer_size(infd, outfd); xfer > sizeof(localbuf); xfer >>= 1) {
+			if ((buf = malloc(xfer)) != NULL)
+				break;
+		}
+		if (xfer <= sizeof(localbuf)) {
+			buf = localbuf;
+			xfer = sizeof(localbuf);
+		}
+	} else if (blocksize > sizeof(localbuf)) {
+		buf = malloc(blocksize);
+		if (buf == NULL) {
+			errmsg("Cannot allocate buffer\n");
+			goto cleanup;
+		}
+	}
+
 	if (skipval) {
 		if (lseek(infd, skipval * blocksize, 0) < 0) {
 			while (skipval-- > 0) {
@@ -251,7 +293,10 @@ int main(int argc, char **argv)
 	else
 		goto cleanup;	/* exit immediately if count == 0 */
 
-	while ((count > intotal) && (incc = read(infd, buf, blocksize)) > 0) {
+	while (count > intotal) {
+		incc = (count - intotal < xfer)? (int)(count - intotal): xfer;
+		if ((incc = read(infd, buf, incc)) <= 0)
+			break;
 		intotal += incc;
 		cp = buf;
 
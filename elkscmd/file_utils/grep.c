@@ -12,83 +12,95 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BUFSZ	4096		/* read size and longest line */
+
+static char		*word;		/* string to find, lower cased for -i */
+static int		wordlen;
+static unsigned char	fold[256];	/* case mapping applied to the input */
+static unsigned int	skip[256];	/* Boyer-Moore-Horspool shifts */
+static char		buf[BUFSZ + 1];
 
 /*
- * See if the specified word is found in the specified string.
+ * Build the case mapping and shift tables for the search word.
  */
-static int search(char *string, char *word, int ignorecase)
+static void setup(int ignorecase)
 {
-	char	*cp1;
-	char	*cp2;
-	int	len;
-	int	lowfirst;
-	int	ch1;
-	int	ch2;
-
-	len = strlen(word);
-
-	if (!ignorecase) {
-		while (1) {
-			string = strchr(string, word[0]);
-			if (string == NULL)
-				return 0;
+	int	i;
 
-			if (memcmp(string, word, len) == 0)
-				return 1;
+	for (i = 0; i < 256; i++) {
+		fold[i] = i;
+		if (ignorecase && i < 128 && isupper(i))
+			fold[i] = tolower(i);
+	}
+	wordlen = strlen(word);
+	for (i = 0; i < wordlen; i++)
+		word[i] = fold[(unsigned char)word[i]];
+	for (i = 0; i < 256; i++)
+		skip[i] = wordlen;
+	for (i = 0; i < wordlen - 1; i++)
+		skip[(unsigned char)word[i]] = wordlen - 1 - i;
+}
 
-			string++;
+/*
+ * Find the word in the text from cp up to end, which must be a line
+ * boundary. Returns the start of the match or NULL.
+ */
+static char *search(char *cp, char *end)
+{
+	int	last = wordlen - 1;
+	int	i;
+	unsigned int c;
+
+	if (wordlen == 0)
+		return (cp < end)? cp: NULL;
+
+	end -= last;
+	while (cp < end) {
+		c = fold[(unsigned char)cp[last]];
+		if (c == (unsigned char)word[last]) {
+			for (i = last - 1; i >= 0; i--)
+				if (fold[(unsigned char)cp[i]] != (unsigned char)word[i])
+					break;
+			/* a match must lie within one line */
+			if (i < 0 && (last == 0 || !memchr(cp, '\n', last)))
+				return cp;
 		}
+		cp += skip[c];
 	}
+	return NULL;
+}
 
-	/*
-	 * Here if we need to check case independence.
-	 * Do the search by lower casing both strings.
-	 */
-	lowfirst = *word;
-	if (isupper(lowfirst))
-		lowfirst = tolower(lowfirst);
-
-	while (1) {
-		while (*string && (*string != lowfirst) &&
-			(!isupper(*string) || (tolower(*string) != lowfirst)))
-				string++;
-
-		if (*string == '\0')
-			return 0;
-
-		cp1 = string;
-		cp2 = word;
-
-		do {
-			if (*cp2 == '\0')
-				return 1;
-
-			ch1 = *cp1++;
-			if (isupper(ch1))
-				ch1 = tolower(ch1);
-
-			ch2 = *cp2++;
-			if (isupper(ch2))
-				ch2 = tolower(ch2);
-
-		} while (ch1 == ch2);
+/*
+ * Count the lines from cp up to end.
+ */
+static long countlines(char *cp, char *end)
+{
+	long	n = 0;
 
-		string++;
+	while ((cp = memchr(cp, '\n', end - cp)) != NULL) {
+		cp++;
+		n++;
 	}
+	return n;
 }
 
-
 int main(int argc, char **argv)
 {
-	FILE	*fp;
-	char	*word;
+	int	fd;
 	char	*name;
 	char	*cp;
+	char	*ep;
+	char	*end;
+	char	*match;
 	int	tellname;
 	int	ignorecase;
 	int	tellline;
+	int	len;
+	int	n;
 	long	line;
-	char	buf[BUFSIZ];
 
 	if (argc < 2) goto usage;
 
@@ -119,41 +131,68 @@ int main(int argc, char **argv)
 
 	word = *argv++;
 	argc--;
+	setup(ignorecase);
 
 	tellname = (argc > 1);
 
 	while (argc-- > 0) {
 		name = *argv++;
 
-		fp = fopen(name, "r");
-		if (fp == NULL) {
+		fd = open(name, O_RDONLY);
+		if (fd < 0) {
 			perror(name);
 			continue;
 		}
 
-		line = 0;
+		line = 1;
+		len = 0;
 
-		while (fgets(buf, sizeof(buf), fp)) {
-			line++;
+		/*
+		 * Search whole buffers of lines at a time, only finding
+		 * the line boundaries around a match.
+		 */
+		do {
+			n = read(fd, buf + len, BUFSZ - len);
+			if (n < 0) {
+				perror(name);
+				break;
+			}
+			len += n;
+			if (n == 0) {
+				if (len == 0)
+					break;
+				buf[len++] = '\n';	/* unterminated last line */
+			}
 
-			/* Make sure the data is text and didn't overflow */
-			cp = &buf[strlen(buf) - 1];
-			if (*cp != '\n') goto error_line_length;
+			for (end = buf + len; end > buf && end[-1] != '\n'; end--)
+				continue;
+			if (end == buf) {
+				if (len == BUFSZ) goto error_line_length;
+				continue;
+			}
 
-			if (search(buf, word, ignorecase)) {
+			cp = buf;
+			while ((match = search(cp, end)) != NULL) {
+				while (match > cp && match[-1] != '\n')
+					match--;
+				ep = memchr(match, '\n', end - match) + 1;
+				if (tellline)
+					line += countlines(cp, match);
 				if (tellname)
 					printf("%s: ", name);
 				if (tellline)
-					printf("%ld: ", line);
-
-				fputs(buf, stdout);
+					printf("%ld: ", line++);
+				fwrite(match, 1, ep - match, stdout);
+				cp = ep;
 			}
-		}
+			if (tellline)
+				line += countlines(cp, end);
 
-		if (ferror(fp))
-			perror(name);
+			len -= end - buf;
+			memmove(buf, end, len);
+		} while (n > 0);
 
-		fclose(fp);
+		close(fd);
 	}
 	return 0;
 
@@ -75,6 +75,7 @@ static char *timestring(time_t t);
 struct sort {
     char *name;
     long longval;
+    struct stat *st;    /* read in directory order by getfiles, or NULL */
 };
 
 struct stack
@@ -88,6 +89,7 @@ static int reverse = -1;
 static int sortbytime;
 static int sortbysize;
 static int nosort;
+static int recursive;
 static char fmt[16] = "%s";
 
 /* return -1/0/1 based on sign of x */
@@ -111,12 +113,15 @@ static void initstack(struct stack *pstack)
     pstack->buf = NULL;
 }
 
-static char *popstack(struct stack *pstack)
+static char *popstack(struct stack *pstack, struct stat **st)
 {
-    return (pstack->size)?pstack->buf[--(pstack->size)].name:NULL;
+    if (!pstack->size)
+        return NULL;
+    *st = pstack->buf[--(pstack->size)].st;
+    return pstack->buf[pstack->size].name;
 }
 
-static void pushstack(struct stack *pstack, char *entry, long l)
+static void pushstack(struct stack *pstack, char *entry, long l, struct stat *st)
 {
     struct sort *allocbuf;
 
@@ -131,6 +136,7 @@ static void pushstack(struct stack *pstack, char *entry, long l)
         pstack->buf = allocbuf;
     }
     pstack->buf[pstack->size].longval = l;
+    pstack->buf[pstack->size].st = st;
     pstack->buf[pstack->size++].name = entry;
 }
 
@@ -180,12 +186,22 @@ toolong:
             }
             memcpy(fullname + pathlen, dp->d_name, namelen + 1);
             long l = 0;
-            if (sortbytime || sortbysize) {
-                struct stat statbuf;
-                if (LSTAT(fullname, &statbuf) >= 0)
-                    l = sortbytime? statbuf.st_mtime: statbuf.st_size;
-            }
-            pushstack(pstack, strdup(fullname), l);
+            struct stat *st = NULL;
+            /*
+             * Stat now rather than after sorting, since a lookup in
+             * directory order is fast. A plain listing needs no stat,
+             * and the inode number alone comes with the entry.
+             */
+            if (sortbytime || sortbysize || recursive || (flags & (LSF_LONG|LSF_CLASS))) {
+                if ((st = malloc(sizeof(struct stat))) && LSTAT(fullname, st) < 0) {
+                    free(st);
+                    st = NULL;
+                }
+                if (st)
+                    l = sortbytime? st->st_mtime: st->st_size;
+            } else if ((flags & LSF_INODE) && (st = calloc(1, sizeof(struct stat))))
+                st->st_ino = dp->d_ino;
+            pushstack(pstack, strdup(fullname), l, st);
         }
     }
     closedir(dirp);
@@ -451,8 +467,8 @@ int main(int argc, char **argv)
     char  *cp;
     char  *name = argv[0];
     int  status = EXIT_SUCCESS;
-    int  flags, recursive, is_dir;
-    struct stat statbuf;
+    int  flags, is_dir;
+    struct stat statbuf, *st, *sp;
     static char *def[] = {".", 0};
     struct stack files, dirs;
 
@@ -528,9 +544,9 @@ int main(int argc, char **argv)
             return EXIT_FAILURE;
         }
         if (recursive && S_ISDIR(statbuf.st_mode))
-            pushstack(&dirs, strdup(*argv), statbuf.st_mtime);
+            pushstack(&dirs, strdup(*argv), statbuf.st_mtime, NULL);
         else
-            pushstack(&files, strdup(*argv), statbuf.st_mtime);
+            pushstack(&files, strdup(*argv), statbuf.st_mtime, NULL);
     }
     if (recursive)
         recursive--;
@@ -542,31 +558,37 @@ int main(int argc, char **argv)
          */
         while (files.size) {
             int didls = 0;
-            name = popstack(&files);
+            name = popstack(&files, &st);
             TRACESTRING(name)
             if (!recursive || (flags & LSF_LONG)) {
-                lsfile(name, NULL, flags);
+                lsfile(name, st, flags);
                 didls = 1;
                 if (!recursive) {
                     free(name);
+                    free(st);
                     continue;
                 }
             }
-            if (LSTAT(name, &statbuf) < 0) {
-                perror(name);
-                free(name);
-                continue;
+            sp = st;
+            if (!sp) {
+                if (LSTAT(name, &statbuf) < 0) {
+                    perror(name);
+                    free(name);
+                    continue;
+                }
+                sp = &statbuf;
             }
-            is_dir = S_ISDIR(statbuf.st_mode);
+            is_dir = S_ISDIR(sp->st_mode);
             if (!didls)
-                lsfile(name, &statbuf, flags);
+                lsfile(name, sp, flags);
             if (is_dir && recursive && not_dotdir(name))
-                pushstack(&dirs, name, statbuf.st_mtime);
+                pushstack(&dirs, name, sp->st_mtime, NULL);
             else
                 free(name);
+            free(st);
         }
         if (dirs.size) {
-            if (getfiles(name = popstack(&dirs), &files, flags) != 0) {
+            if (getfiles(name = popstack(&dirs, &st), &files, flags) != 0) {
                 status = EXIT_FAILURE;
             } else if (strcmp(name, ".")) {
                 if (col) {
@@ -26,8 +26,13 @@ typedef struct md5_t {
     uint32_t in[16];
 } md5_t;
 
-static unsigned char readbuf[BUFSIZ];
+#define READSIZE    4096
 
+static unsigned char readbuf[READSIZE];
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define byteSwap(buf, words)    /* words are already in MD5 byte order */
+#else
 static void
 byteSwap(uint32_t *buf, unsigned words)
 {
@@ -39,6 +44,7 @@ byteSwap(uint32_t *buf, unsigned words)
         p += 4;
     } while (--words);
 }
+#endif
 
 /*
  * Start MD5 accumulation.  Set bit count to 0 and buffer to mysterious
@@ -56,6 +62,12 @@ md5_init(md5_t *ctx)
     ctx->bytes[1] = 0;
 }
 
+#ifdef __ia16__
+/* hand coded in md5.S */
+void md5_transform(uint32_t buf[4], uint32_t const in[16]);
+#define transform   md5_transform
+#else
+
 /* The four core functions - F1 is optimized somewhat */
 
 /* #define F1(x, y, z) (x & y | ~x & z) */
@@ -156,6 +168,7 @@ transform(uint32_t buf[4], uint32_t const in[16])
     buf[2] += c;
     buf[3] += d;
 }
+#endif
 
 /*
  * Update context to reflect the concatenation of another buffer full of
@@ -183,9 +196,13 @@ md5_update(md5_t *ctx, const unsigned char *buf, unsigned int len)
 
     /* Process data in 64-byte chunks */
     while (len >= 64) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        transform(ctx->buf, (uint32_t *)buf);   /* directly from the buffer */
+#else
         memmove(ctx->in, buf, 64);
         byteSwap(ctx->in, 16);
         transform(ctx->buf, ctx->in);
+#endif
         buf += 64;
         len -= 64;
     }
@@ -10,7 +10,6 @@
  *	- lcd with no params should print current local directory
  *	- add ABORT support in PUT
  *	- handle server timeout (no activity): Unsolicited server input (code 421)
- *	- add '15632 bytes sent in 0.00 secs (27.5561 MB/s)' type message after transfer
  */
 
 #define BLOATED		/* fully featured if defined */
@@ -21,6 +20,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <string.h>
 #include <arpa/inet.h>
@@ -42,6 +42,8 @@
 
 
 #define	IOBUFLEN 1500
+#define SENDSIZE 4096	/* largest sendfile per call */
+#define XFERBUF	4096	/* received data is written to files in these units */
 #define BUF_SIZE 512
 #define CMDBUF 80
 #define ADDRBUF	40
@@ -76,6 +78,7 @@ static int is_connected(int);
 static int parse_cmd(char *, char **);
 
 //static FILE *fcmd;
+static char xferbuf[XFERBUF];
 
 enum {	// commands in disconnected mode
 	CMD_OPEN,	// Must be first!!
@@ -565,9 +568,24 @@ int do_ls(int controlfd, int datafd, char **cmdline, int mode) {
 	return 1;
 }
 
+/* Report the size and speed of a transfer started at *start */
+static void xfer_stats(char *what, long bytes, struct timeval *start)
+{
+	struct timeval now;
+	long ms;
+
+	gettimeofday(&now, NULL);
+	ms = (now.tv_sec - start->tv_sec) * 1000L + (now.tv_usec - start->tv_usec) / 1000;
+	if (ms <= 0) ms = 1;
+	printf("%ld bytes %s in %ld.%02ld secs (%ld bytes/s)\n", bytes, what,
+		ms / 1000, (ms % 1000) / 10, bytes / ms * 1000 + bytes % ms * 1000 / ms);
+}
+
 int do_get(int controlfd, char *src, char *dst, int mode) {
 	char iobuf[IOBUFLEN+1];
-	int status = 1, bcnt = 0, fd, n, datafd = -1;
+	int status = 1, fd, n, len, datafd = -1;
+	long bcnt = 0;
+	struct timeval start;
 	int maxfdp1, data_finished = FALSE, control_finished = FALSE;
 	fd_set rdset;
 
@@ -610,6 +628,7 @@ int do_get(int controlfd, char *src, char *dst, int mode) {
 
 	maxfdp1 = MAX(controlfd, datafd) + 1;
 	printf("remote: %s, local: %s\n", src, dst);
+	gettimeofday(&start, NULL);
 	/*
 	 * NOTICE: When fetching very small or NULL size files, the '150 Opening'
 	 * message and the 226 Transfer Complete message arrive almost at the same time.
@@ -658,15 +677,25 @@ int do_get(int controlfd, char *src, char *dst, int mode) {
 		}
 
 		if (FD_ISSET(datafd, &rdset)) {
-			while ((n = read(datafd, iobuf, IOBUFLEN)) > 0) {
-				if (write(fd, iobuf, n) != n) {
-					perror("File write error");
-					break;
-					// MAY have to reset data connection 
-				}
+			/*
+			 * Collect the network reads, which are at most a packet,
+			 * so the file is written in whole blocks.
+			 */
+			len = 0;
+			while ((n = read(datafd, xferbuf + len, XFERBUF - len)) > 0) {
 				bcnt += n;
+				len += n;
+				if (len == XFERBUF) {
+					if (write(fd, xferbuf, len) != len)
+						break;
+					len = 0;
+				}
 			}
-			//printf("got %d\n", bcnt);	// For later use
+			if (n > 0 || (len && write(fd, xferbuf, len) != len)) {
+				perror("File write error");
+				// MAY have to reset data connection 
+			}
+			xfer_stats("received", bcnt, &start);
 			data_finished = TRUE;
 			FD_CLR(datafd, &rdset);
 		}
@@ -683,6 +712,8 @@ get_out:
 int do_put(int controlfd, char *src, char *dst, int mode){
 	char iobuf[IOBUFLEN+1];
 	int datafd, fd, n, status = 1;
+	long bcnt = 0;
+	struct timeval start;
 
 	bzero(iobuf, sizeof(iobuf));
 
@@ -760,12 +791,20 @@ int do_put(int controlfd, char *src, char *dst, int mode){
 		}
 	}
 #else
-	while ((n = read(fd, iobuf, IOBUFLEN)) > 0) {
-		if (write(datafd, iobuf, n) < n) {
-			perror("put");
-			break;
+	gettimeofday(&start, NULL);
+	while ((n = sendfile(datafd, fd, NULL, SENDSIZE)) > 0)
+		bcnt += n;
+	if (n < 0 && errno == EINVAL) {		/* fs without block mapping */
+		while ((n = read(fd, xferbuf, XFERBUF)) > 0) {
+			if (write(datafd, xferbuf, n) < n) {
+				perror("put");
+				break;
+			}
+			bcnt += n;
 		}
-	}
+	} else if (n < 0)
+		perror("put");
+	xfer_stats("sent", bcnt, &start);
 #endif
 	close(datafd);
 	get_reply(controlfd, iobuf, sizeof(iobuf), 1);
@@ -9,6 +9,7 @@
 
 #include	<time.h>
 #include	<sys/socket.h>
+#include	<sys/sendfile.h>
 #include	<string.h>
 #include	<arpa/inet.h>
 #include	<unistd.h>
@@ -38,6 +39,7 @@
 
 #define 	CMDBUFSIZ 	512
 #define		IOBUFSIZ	1500
+#define		SENDSIZE	4096	/* largest sendfile per call */
 #define		TRUE		1
 #define		FALSE		0
 #define		FTP_PORT	21
@@ -529,12 +531,18 @@ int do_retr(int datafd, char *input){
 			fstat(fd, &fst);
 			sprintf(iobuf, "150 Opening BINARY data connection for %s (%ld bytes).\r\n", cmd_buf, fst.st_size);
 			write(controlfd, iobuf, strlen(iobuf));
-			while ((len = read(fd, iobuf, sizeof(iobuf))) > 0) 
-				if (write(datafd, iobuf, len) != len) {
-					//printf("RETR error fd %d len %d\n", datafd, len);
-					perror("Data write error"); 
-					break;
-				}
+			/* copy from the buffer cache, or through iobuf if the fs can't */
+			while ((len = sendfile(datafd, fd, NULL, SENDSIZE)) > 0)
+				continue;
+			if (len < 0 && errno == EINVAL) {
+				while ((len = read(fd, iobuf, sizeof(iobuf))) > 0) 
+					if (write(datafd, iobuf, len) != len) {
+						//printf("RETR error fd %d len %d\n", datafd, len);
+						perror("Data write error"); 
+						break;
+					}
+			} else if (len < 0)
+				perror("Data write error");
 			close(fd);
 		} else {
 			send_reply(550, "No such file or directory");
@@ -24,26 +24,59 @@
 #include <limits.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <malloc.h>
 #include <stdio.h>
 #include <errno.h>
 #include <paths.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/wait.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <time.h>
 
 #define DEF_PORT		80
 #define DEF_CONTENT	"text/html"
 
+#define NSLOTS		4	/* connections served at once */
+#define REQSIZE		512	/* request header buffer */
+#define OUTSIZE		1024	/* file streaming chunk */
+#define SENDSIZE	4096	/* largest sendfile per call */
+#define KEEPALIVE	10	/* secs an idle connection is held open */
+#define IDLE_MS		50	/* sleep when every sender is waiting */
+#define CACHE_SIZE	8	/* default response cache, K bytes */
+#define CACHE_ENTS	8	/* files cached at once */
+#define CACHE_FILEMAX	4096	/* largest file cached */
+
 #define WS(c)	( ((c) == ' ') || ((c) == '\t') || ((c) == '\r') || ((c) == '\n') )
 
 int listen_sock;
 char buf[1536];
 
+/* connection slot for the single process server */
+struct conn {
+	int	fd;		/* socket, -1 if slot free */
+	int	file;		/* file being sent, -1 if none */
+	int	keepalive;	/* keep connection after response */
+	time_t	last;		/* time of last activity */
+	int	inlen;		/* bytes of request in ibuf */
+	char	*outp;		/* unsent output in obuf */
+	int	outlen;
+	struct cent *cent;	/* cached response being sent, or NULL */
+	unsigned int coff;	/* next cached data to send */
+	unsigned int cleft;
+	char	ibuf[REQSIZE];
+	char	obuf[OUTSIZE];
+};
+
+struct conn conns[NSLOTS];
+
 char* get_mime_type(char *name)
 {
     char* dot;
@@ -68,84 +101,611 @@ char* get_mime_type(char *name)
     return "text/plain";
 }
 
-void send_header(int fd, char *ct)
+/* format an error response into hdr, the connection is then closed */
+int format_error(char *hdr, int errnum, char *str)
 {
-	buf[0] = 0;
-	sprintf(buf, "HTTP/1.0 200 OK\r\nServer: nanoHTTPd/0.1\r\nDate: Thu Apr 26 15:37:46 GMT 2001\r\nContent-Type: %s\r\n",ct);
-	write(fd, buf, strlen(buf));
+	return sprintf(hdr, "HTTP/1.0 %d %s\r\nContent-type: %s\r\n"
+		"Connection: close\r\nDate: Thu Apr 26 15:37:46 GMT 2001\r\n\r\n%s\r\n",
+		errnum, str, DEF_CONTENT, str);
 }
 
-void send_error(int fd, int errnum, char *str)
+/* find a header line by name, case insensitively */
+char *find_header(char *req, char *name)
 {
-	sprintf(buf,"HTTP/1.0 %d %s\r\nContent-type: %s\r\n", errnum, str, DEF_CONTENT);
-	write(fd, buf, strlen(buf));
-	sprintf(buf,"Connection: close\r\nDate: Thu Apr 26 15:37:46 GMT 2001\r\n\r\n%s\r\n",str);
-	write(fd, buf, strlen(buf));
+	int len = strlen(name);
+	char *p;
+
+	for (p = strchr(req, '\n'); p; p = strchr(p, '\n')) {
+		p++;
+		if (!strncasecmp(p, name, len)) {
+			p += len;
+			while (*p == ' ' || *p == '\t')
+				p++;
+			return p;
+		}
+	}
+	return NULL;
 }
 
-void process_request(int fd)
+/*
+ * Response cache for small files, used by the single process server.
+ * Each entry holds the path, the entity header lines and the file
+ * contents in a far memory arena, and is valid while the file's mtime
+ * is unchanged. Entries being sent are pinned; otherwise the least
+ * recently used are dropped to make room.
+ */
+struct cent {
+	unsigned int	hash;		/* of path */
+	unsigned int	off;		/* of path in arena */
+	unsigned int	len;		/* bytes used in arena, 0 if free */
+	unsigned int	hdrlen;		/* entity header, follows path */
+	unsigned int	size;		/* file contents, follow header */
+	unsigned int	used;		/* LRU stamp */
+	time_t		mtime;
+	int		busy;		/* connections sending it */
+};
+
+#define CENT_DATA(ce)	((ce)->off + (ce)->len - (ce)->size)
+
+struct cent cache[CACHE_ENTS];
+char __far *arena;
+unsigned int arena_size;
+unsigned int cache_max;			/* largest file cached */
+unsigned int cache_clock;
+
+unsigned int strhash(char *s)
 {
-	int fin, ret;
-	off_t size;
-	char *c, *file, fullpath[PATH_MAX];
-	struct stat st;
-	
-	ret = read(fd, buf, sizeof(buf));
-	
-	c = buf;
-	while (*c && !WS(*c) && c < (buf + sizeof(buf))){
-		c++;
+	unsigned int h = 0;
+
+	while (*s)
+		h = (h << 5) + h + (unsigned char)*s++;
+	return h;
+}
+
+int fstrequal(char __far *fp, char *s)
+{
+	while (*s)
+		if (*fp++ != *s++)
+			return 0;
+	return *fp == 0;
+}
+
+/* format t as an HTTP date */
+char *http_date(time_t t)
+{
+	static char date[32];
+	struct tm *tm = gmtime(&t);
+
+	sprintf(date, "%.3s, %02d %.3s %d %02d:%02d:%02d GMT",
+		&"SunMonTueWedThuFriSat"[tm->tm_wday * 3], tm->tm_mday,
+		&"JanFebMarAprMayJunJulAugSepOctNovDec"[tm->tm_mon * 3],
+		tm->tm_year + 1900, tm->tm_hour, tm->tm_min, tm->tm_sec);
+	return date;
+}
+
+/* the entity header lines, the same whether cached or not */
+int format_entity(char *hdr, char *path, off_t size, time_t mtime)
+{
+	return sprintf(hdr, "Content-Type: %s\r\nContent-Length: %ld\r\n"
+		"Last-Modified: %s\r\n", get_mime_type(path), size, http_date(mtime));
+}
+
+int cache_evict(void)
+{
+	struct cent *ce, *lru = NULL;
+
+	for (ce = cache; ce < &cache[CACHE_ENTS]; ce++) {
+		if (ce->len && !ce->busy &&
+		    (!lru || (int)(ce->used - lru->used) < 0))
+			lru = ce;
+	}
+	if (!lru)
+		return 0;
+	lru->len = 0;
+	return 1;
+}
+
+/* return 1 if arena bytes off to off+len are unused */
+int cache_free(unsigned int off, unsigned int len)
+{
+	struct cent *ce;
+
+	for (ce = cache; ce < &cache[CACHE_ENTS]; ce++) {
+		if (ce->len && ce->off < off + len && off < ce->off + ce->len)
+			return 0;
 	}
-	*c = 0;
-	
-	if (strcasecmp(buf, "get")){
-		send_error(fd, 404, "Method not supported");
-		return;		
+	return 1;
+}
+
+/* find arena space for len bytes, first fit, evicting as needed */
+struct cent *cache_alloc(unsigned int len)
+{
+	struct cent *ce, *slot;
+	unsigned int off;
+
+	if (len > arena_size)
+		return NULL;
+	do {
+		slot = NULL;
+		for (ce = cache; ce < &cache[CACHE_ENTS]; ce++) {
+			if (!ce->len) {
+				slot = ce;
+				break;
+			}
+		}
+		if (!slot)
+			continue;
+
+		/* a gap starts at the arena base or the end of an entry */
+		off = 0;
+		ce = cache;
+		for (;;) {
+			if (len <= arena_size - off && cache_free(off, len)) {
+				slot->off = off;
+				slot->len = len;
+				return slot;
+			}
+			while (ce < &cache[CACHE_ENTS] && !ce->len)
+				ce++;
+			if (ce == &cache[CACHE_ENTS])
+				break;
+			off = ce->off + ce->len;
+			ce++;
+		}
+	} while (cache_evict());
+	return NULL;
+}
+
+/* return the cached entry for path if still valid, dropping stale ones */
+struct cent *cache_find(char *path, time_t mtime)
+{
+	struct cent *ce, *found = NULL;
+	unsigned int hash = strhash(path);
+
+	for (ce = cache; ce < &cache[CACHE_ENTS]; ce++) {
+		if (!ce->len || ce->hash != hash || !fstrequal(arena + ce->off, path))
+			continue;
+		if (ce->mtime == mtime)
+			found = ce;
+		else if (!ce->busy)
+			ce->len = 0;
 	}
-	
-	file = ++c;
-	while (*c && !WS(*c) && c < (buf + sizeof(buf))){
+	if (found)
+		found->used = ++cache_clock;
+	return found;
+}
+
+/* copy an open file into the cache, returns NULL if it can't be */
+struct cent *cache_fill(char *path, int fin, struct stat *st)
+{
+	struct cent *ce;
+	char __far *p;
+	char hdr[128];
+	unsigned int pathlen, hdrlen, left;
+	int n;
+
+	if (!arena || st->st_size > cache_max)
+		return NULL;
+	pathlen = strlen(path) + 1;
+	hdrlen = format_entity(hdr, path, st->st_size, st->st_mtime);
+	if ((ce = cache_alloc(pathlen + hdrlen + (unsigned int)st->st_size)) == NULL)
+		return NULL;
+
+	p = arena + ce->off;
+	fmemcpy(p, path, pathlen);
+	fmemcpy(p + pathlen, hdr, hdrlen);
+	p += pathlen + hdrlen;
+	for (left = st->st_size; left; left -= n, p += n) {
+		n = read(fin, buf, left < sizeof(buf)? left: sizeof(buf));
+		if (n <= 0) {
+			ce->len = 0;
+			lseek(fin, (off_t)0, SEEK_SET);
+			return NULL;
+		}
+		fmemcpy(p, buf, n);
+	}
+	ce->hash = strhash(path);
+	ce->hdrlen = hdrlen;
+	ce->size = st->st_size;
+	ce->mtime = st->st_mtime;
+	ce->busy = 0;
+	ce->used = ++cache_clock;
+	return ce;
+}
+
+void cache_init(unsigned int kbytes)
+{
+	if (kbytes > 63)
+		kbytes = 63;
+	arena_size = kbytes << 10;
+	if (arena_size && (arena = fmemalloc((unsigned long)arena_size)) == NULL)
+		arena_size = 0;
+	cache_max = arena_size / 4;
+	if (cache_max > CACHE_FILEMAX)
+		cache_max = CACHE_FILEMAX;
+}
+
+/*
+ * Parse the NUL terminated request header in req and open the file it
+ * asks for. The response header is formatted into hdr and its length
+ * stored in *hdrlen. Returns the open file, or -1 when no file need be
+ * sent. If cep is non-NULL the cache is used, and *cep is set to the
+ * cached entry to send, or NULL. If *keepalive is set on entry it is
+ * left set only if the client wants the connection kept open.
+ */
+int open_request(char *req, char *hdr, int *hdrlen, int *keepalive, struct cent **cep)
+{
+	int fin, http11, notmod;
+	char *c, *file, *conn, *ims, *date, fullpath[PATH_MAX];
+	struct cent *ce = NULL;
+	struct stat st;
+
+	if (cep)
+		*cep = NULL;
+	c = req;
+	while (*c && !WS(*c))
 		c++;
+	if (!*c || c - req != 3 || strncasecmp(req, "get", 3)) {
+		*keepalive = 0;
+		*hdrlen = format_error(hdr, 404, "Method not supported");
+		return -1;
 	}
-	*c = 0;
+	*c++ = 0;
 
-	/* TODO : Use strncat when security is the only problem of this server! */
+	file = c;
+	while (*c && !WS(*c))
+		c++;
+	if (*c)
+		*c++ = 0;
+	http11 = !strncmp(c, "HTTP/1.1", 8);
+	conn = find_header(c, "Connection:");
+	if (*keepalive)
+		*keepalive = conn? !strncasecmp(conn, "keep-alive", 10): http11;
+	ims = find_header(c, "If-Modified-Since:");
+
+	if (strlen(_PATH_DOCBASE) + strlen(file) + sizeof("/index.html") > PATH_MAX)
+		goto notfound;
 	strcpy(fullpath, _PATH_DOCBASE);
 	strcat(fullpath, file);
-	
-	if (!stat(fullpath, &st) && (st.st_mode & S_IFMT) == S_IFDIR) {
-		if (file[strlen(fullpath) - 1] != '/'){
+
+	if (stat(fullpath, &st) < 0)
+		goto notfound;
+	if ((st.st_mode & S_IFMT) == S_IFDIR) {
+		if (fullpath[strlen(fullpath) - 1] != '/'){
 			strcat(fullpath, "/");
 		}
 		strcat(fullpath, "index.html");
+		if (stat(fullpath, &st) < 0)
+			goto notfound;
 	}
-	
-	fin = open(fullpath, O_RDONLY);
-	if (fin < 0){
-		send_error(fd, 404, "Document (probably) not found");
+
+	date = http_date(st.st_mtime);
+	notmod = ims && !strncmp(ims, date, strlen(date));
+	*hdrlen = sprintf(hdr, "HTTP/1.%d %s\r\nServer: nanoHTTPd/0.1\r\n"
+		"Date: Thu Apr 26 15:37:46 GMT 2001\r\n", http11,
+		notmod? "304 Not Modified": "200 OK");
+	if (notmod) {
+		/* client's copy is current, answered without opening the file */
+		fin = -1;
+		goto done;
+	}
+
+	if (cep && (ce = cache_find(fullpath, st.st_mtime)) != NULL)
+		fin = -1;
+	else {
+		fin = open(fullpath, O_RDONLY);
+		if (fin < 0){
+notfound:
+			*keepalive = 0;
+			*hdrlen = format_error(hdr, 404, "Document (probably) not found");
+			return -1;
+		}
+		if (cep && (ce = cache_fill(fullpath, fin, &st)) != NULL) {
+			close(fin);
+			fin = -1;
+		}
+	}
+	if (ce) {
+		fmemcpy(hdr + *hdrlen, arena + CENT_DATA(ce) - ce->hdrlen, ce->hdrlen);
+		*hdrlen += ce->hdrlen;
+		ce->busy++;
+		*cep = ce;
+	} else
+		*hdrlen += format_entity(hdr + *hdrlen, fullpath, st.st_size, st.st_mtime);
+done:
+	*hdrlen += sprintf(hdr + *hdrlen, "Connection: %s\r\n\r\n",
+		*keepalive? "keep-alive": "close");
+	return fin;
+}
+
+/* forked server: one request per connection, blocking I/O */
+void process_request(int fd)
+{
+	int fin, ret, len, keepalive;
+
+	ret = read(fd, buf, sizeof(buf) - 1);
+	if (ret <= 0)
+		return;
+	buf[ret] = 0;
+
+	keepalive = 0;
+	fin = open_request(buf, buf, &len, &keepalive, NULL);
+	write(fd, buf, len);
+	if (fin < 0)
 		return;
+
+	while ((ret = sendfile(fd, fin, NULL, SENDSIZE)) > 0)
+		continue;
+	if (ret < 0 && errno == EINVAL) {
+		do {
+			ret = read(fin, buf, sizeof(buf));
+			if (ret > 0)
+				ret = write(fd, buf, ret);
+		} while (ret == sizeof(buf));
 	}
-	size = lseek(fin, (off_t)0, SEEK_END);
-	lseek(fin, (off_t)0, SEEK_SET);
-	send_header(fd, get_mime_type(fullpath));
-	sprintf(buf,"Content-Length: %ld\r\n\r\n", size);
-	write(fd, buf, strlen(buf));
-	
-	do {
-		ret = read(fin, buf, sizeof(buf));
-		if (ret > 0)
-			ret = write(fd, buf, ret);
-	} while (ret == sizeof(buf));
-	
+
 	close(fin);
-	
 }
 
-int main(int argc, char **argv)
+void conn_close(struct conn *cp)
+{
+	if (cp->file >= 0)
+		close(cp->file);
+	if (cp->cent)
+		cp->cent->busy--;
+	cp->cent = NULL;
+	close(cp->fd);
+	cp->fd = cp->file = -1;
+}
+
+/* take a request from the input buffer once its header is complete */
+void conn_request(struct conn *cp)
+{
+	char *end;
+	int len;
+
+	cp->ibuf[cp->inlen] = 0;
+	end = strstr(cp->ibuf, "\r\n\r\n");
+	if (end)
+		end += 4;
+	else if ((end = strstr(cp->ibuf, "\n\n")) != NULL)
+		end += 2;
+	else if (cp->inlen < REQSIZE - 1)
+		return;				/* wait for the rest */
+	else end = cp->ibuf + cp->inlen;	/* too long, use what fits */
+
+	len = end - cp->ibuf;
+	end[-1] = 0;
+	cp->keepalive = 1;
+	cp->file = open_request(cp->ibuf, cp->obuf, &cp->outlen, &cp->keepalive,
+		&cp->cent);
+	cp->outp = cp->obuf;
+	if (cp->cent) {
+		cp->coff = CENT_DATA(cp->cent);
+		cp->cleft = cp->cent->size;
+	}
+
+	/* keep any pipelined request */
+	cp->inlen -= len;
+	memmove(cp->ibuf, cp->ibuf + len, cp->inlen);
+}
+
+/* read request data, returns 0 if the connection was closed */
+int conn_read(struct conn *cp)
+{
+	int n;
+
+	n = read(cp->fd, cp->ibuf + cp->inlen, REQSIZE - 1 - cp->inlen);
+	if (n < 0 && errno == EAGAIN)
+		return 1;
+	if (n <= 0) {
+		conn_close(cp);
+		return 0;
+	}
+	cp->inlen += n;
+	cp->last = time(NULL);
+	conn_request(cp);
+	return 1;
+}
+
+/* send the next piece of the response, returns 1 if any was sent */
+int conn_write(struct conn *cp)
+{
+	int n;
+
+	if (cp->outlen == 0 && cp->cent) {
+		n = cp->cleft < OUTSIZE? cp->cleft: OUTSIZE;
+		fmemcpy(cp->obuf, arena + cp->coff, n);
+		cp->coff += n;
+		cp->cleft -= n;
+		cp->outp = cp->obuf;
+		cp->outlen = n;
+		if (!cp->cleft) {
+			cp->cent->busy--;
+			cp->cent = NULL;
+		}
+	}
+	if (cp->outlen == 0 && cp->file >= 0) {
+		/* send the file straight from the buffer cache when possible */
+		n = sendfile(cp->fd, cp->file, NULL, SENDSIZE);
+		if (n > 0) {
+			cp->last = time(NULL);
+			return 1;
+		}
+		if (n < 0 && errno == EAGAIN)
+			return 0;
+		if (n < 0 && errno == EINVAL)	/* not on a block mapped fs */
+			n = read(cp->file, cp->obuf, OUTSIZE);
+		if (n <= 0) {
+			close(cp->file);
+			cp->file = -1;
+		} else {
+			cp->outp = cp->obuf;
+			cp->outlen = n;
+		}
+	}
+	if (cp->outlen == 0) {
+		/* response complete */
+		if (!cp->keepalive)
+			conn_close(cp);
+		else if (cp->inlen)
+			conn_request(cp);
+		return 1;
+	}
+
+	n = write(cp->fd, cp->outp, cp->outlen);
+	if (n < 0) {
+		if (errno == EAGAIN)
+			return 0;
+		conn_close(cp);
+		return 1;
+	}
+	cp->outp += n;
+	cp->outlen -= n;
+	cp->last = time(NULL);
+	return 1;
+}
+
+#define SENDING(cp)	((cp)->outlen || (cp)->file >= 0 || (cp)->cent)
+
+/* add waiting connections to free slots, first waiting for one if wait set */
+void accept_conns(int wait)
+{
+	struct conn *cp;
+	int fd;
+
+	for (cp = conns; cp < &conns[NSLOTS]; cp++) {
+		if (cp->fd >= 0)
+			continue;
+		if (wait)
+			fcntl(listen_sock, F_SETFL, 0);
+		fd = accept(listen_sock, NULL, NULL);
+		if (wait) {
+			fcntl(listen_sock, F_SETFL, O_NONBLOCK);
+			wait = 0;
+		}
+		if (fd < 0) {
+			if (errno == ENOTSOCK)
+				exit(1);
+			break;
+		}
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+		cp->fd = fd;
+		cp->file = -1;
+		cp->cent = NULL;
+		cp->inlen = cp->outlen = 0;
+		cp->keepalive = 0;
+		cp->last = time(NULL);
+	}
+}
+
+/*
+ * Single process server. Connections are served from a fixed set of
+ * slots with nonblocking sockets, each sender writing one chunk per
+ * pass so several clients are served at once. accept is nonblocking
+ * as select always reports a listening socket ready; when no
+ * connections are open the server blocks in accept instead.
+ */
+void serve(void)
+{
+	struct conn *cp;
+	fd_set rfds;
+	struct timeval tv;
+	time_t now;
+	int nopen, progress, maxfd;
+
+	for (cp = conns; cp < &conns[NSLOTS]; cp++)
+		cp->fd = cp->file = -1;
+	fcntl(listen_sock, F_SETFL, O_NONBLOCK);
+
+	progress = 1;
+	for (;;) {
+		nopen = 0;
+		for (cp = conns; cp < &conns[NSLOTS]; cp++)
+			if (cp->fd >= 0)
+				nopen++;
+		if (nopen < NSLOTS)
+			accept_conns(nopen == 0);
+
+		FD_ZERO(&rfds);
+		maxfd = -1;
+		for (cp = conns; cp < &conns[NSLOTS]; cp++) {
+			if (cp->fd >= 0 && !SENDING(cp)) {
+				FD_SET(cp->fd, &rfds);
+				if (cp->fd > maxfd)
+					maxfd = cp->fd;
+			}
+		}
+
+		/* don't wait while responses can go out */
+		tv.tv_sec = 0;
+		tv.tv_usec = progress? 0: IDLE_MS * 1000L;
+		if (maxfd < 0 || select(maxfd + 1, &rfds, NULL, NULL, &tv) <= 0)
+			FD_ZERO(&rfds);
+
+		progress = 0;
+		now = time(NULL);
+		for (cp = conns; cp < &conns[NSLOTS]; cp++) {
+			if (cp->fd < 0)
+				continue;
+			if (SENDING(cp))
+				progress |= conn_write(cp);
+			else if (FD_ISSET(cp->fd, &rfds)) {
+				if (conn_read(cp) && SENDING(cp))
+					progress = 1;
+			} else if (now - cp->last > KEEPALIVE)
+				conn_close(cp);
+		}
+	}
+}
+
+/* forked server, each connection handled in turn by a child */
+void serve_fork(void)
 {
 	int ret, conn_sock;
+
+	while (1) {
+		conn_sock = accept(listen_sock, NULL, NULL);
+
+		if (conn_sock < 0) {
+			if (errno == ENOTSOCK)
+				exit(1);
+			continue;
+		}
+
+		if ((ret = fork()) == -1)
+			perror("httpd");
+		else if (ret == 0) {
+			close(listen_sock);
+			process_request(conn_sock);
+			close(conn_sock);
+			exit(0);
+		} else {
+			close(conn_sock);
+			waitpid(ret, NULL, 0);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int ret, forking = 0, cachesize = CACHE_SIZE;
 	struct sockaddr_in localadr;
 
+	while ((ret = getopt(argc, argv, "fc:")) != -1) {
+		switch (ret) {
+		case 'f':
+			forking = 1;
+			break;
+		case 'c':
+			cachesize = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: httpd [-f] [-c cache_kbytes]\n");
+			return 1;
+		}
+	}
+
 	if ((listen_sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
 		perror("httpd");
 		return -1;
@@ -188,25 +748,9 @@ int main(int argc, char **argv)
 		close(ret);
 	setsid();
 
-	while (1) {
-		conn_sock = accept(listen_sock, NULL, NULL);
-		
-		if (conn_sock < 0) {
-			if (errno == ENOTSOCK)
-				exit(1);
-			continue;
-		}
-
-		if ((ret = fork()) == -1)
-			perror("httpd");
-		else if (ret == 0) {
-			close(listen_sock);
-			process_request(conn_sock);
-			close(conn_sock);
-			exit(0);
-		} else {
-			close(conn_sock);
-			waitpid(ret, NULL, 0);
-		}
-	}
+	if (forking)
+		serve_fork();
+	cache_init(cachesize);
+	serve();
+	return 0;
 }
@@ -66,9 +66,18 @@ int main(int ac, char **av)
     }
 
     for(i=0; i<ARP_CACHE_MAX; i++) {
-	if (arp_cache[i].ip_addr)
+	switch (arp_cache[i].state) {
+	case ARP_RESOLVED:
 		printf("%-15s %s\n", in_ntoa(arp_cache[i].ip_addr),
 			mac_ntoa(arp_cache[i].eth_addr));
+		break;
+	case ARP_PENDING:
+		printf("%-15s (incomplete)\n", in_ntoa(arp_cache[i].ip_addr));
+		break;
+	case ARP_NEGATIVE:
+		printf("%-15s (unreachable)\n", in_ntoa(arp_cache[i].ip_addr));
+		break;
+	}
     }
     return 1;
 }
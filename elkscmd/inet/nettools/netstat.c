@@ -63,7 +63,7 @@ int main(int ac, char **av)
     unsigned int retrans_mem;
     struct sockaddr_in localadr,remaddr;
     __u8 *addrbytes;
-    char buf[100];
+    char buf[sizeof(struct packet_stats_s)];
     char addr[16];
 	    
     if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
@@ -101,11 +101,19 @@ int main(int ac, char **av)
     printf("TCP Packets      %7lu  TCP Packets      %7lu\n", ns->tcprcvcnt, ns->tcpsndcnt);
     printf("TCP Dropped      %7lu  TCP Retransmits  %7lu\n", ns->tcpdropcnt, ns->tcpretranscnt);
     printf("TCP Bad Checksum %7lu  TCP Retrans Memory%6u\n", ns->tcpbadchksum, retrans_mem);
+    printf("UDP Packets      %7lu  UDP Packets      %7lu\n", ns->udprcvcnt, ns->udpsndcnt);
+    printf("UDP Dropped      %7lu\n", ns->udpdropcnt);
     printf("IP Packets       %7lu  IP Packets       %7lu\n", ns->iprcvcnt, ns->ipsndcnt);
     printf("IP Bad Checksum  %7lu  IP Bad Headers   %7lu\n", ns->ipbadchksum, ns->ipbadhdr);
+    printf("IP Dropped       %7lu\n", ns->ipdropcnt);
     printf("ICMP Packets     %7lu  ICMP Packets     %7lu\n", ns->icmprcvcnt, ns->icmpsndcnt);
     printf("SLIP Packets     %7lu  SLIP Packets     %7lu\n", ns->sliprcvcnt, ns->slipsndcnt);
     printf("ETH Packets      %7lu  ETH Packets      %7lu\n", ns->ethrcvcnt, ns->ethsndcnt);
+    printf("ETH Dropped      %7lu\n", ns->ethdropcnt);
+    if (ns->nicvalid) {
+	printf("NIC Errors       %7u  NIC Errors       %7u\n", ns->nicrxerrs, ns->nictxerrs);
+	printf("NIC Overflows    %7u  NIC Queue Errors %7u\n", ns->nicoflows, ns->nicrqerrs);
+    }
     printf("ARP Reqs Sent    %7lu  ARP Replies Rcvd %7lu\n", ns->arpsndreqcnt, ns->arprcvreplycnt);
     printf("ARP Reqs Rcvd    %7lu  ARP Replies Sent %7lu\n", ns->arprcvreqcnt, ns->arpsndreplycnt);
     printf("ARP Cache Adds   %7lu\n", ns->arpcacheadds);
@@ -131,7 +139,9 @@ int main(int ac, char **av)
 			secs >>= 4;
 			printf(" (%d.%d secs)", secs, tenthsecs);
 		}
-		printf("\n");
+		printf("\n    in %lu out %lu rexmit %u rto %ums unack %u wnd %u/%u for %lu secs\n",
+			cbstats->bytes_in, cbstats->bytes_out, cbstats->retrans, cbstats->rto,
+			cbstats->unacked, cbstats->snd_wnd, cbstats->rcv_wnd, cbstats->state_secs);
     }
     return 0;
 }
@@ -0,0 +1,388 @@
+/*
+ * ttcp - TCP throughput, latency and connection rate benchmark
+ *
+ * Usage: ttcp -r [-p port]
+ *        ttcp -t [-p port] [-n kbytes] [-l length] [-c count] host [test...]
+ *
+ * -r runs the server, which serves one test connection at a time until
+ * killed. -t runs the client, which connects to the server on host and runs
+ * each test given, or all of them:
+ *
+ *	send	write kbytes in length writes, the server acknowledges the end
+ *	recv	read kbytes written by the server in length writes
+ *	rr	count request/response exchanges of length bytes each way
+ *	conn	count connections, each closed by the server when accepted
+ *
+ *	-p port		server port, default 5001
+ *	-n kbytes	bulk transfer size for send and recv, default 256
+ *	-l length	write size, or message size for rr, default 1024 (at most)
+ *	-c count	exchanges for rr and connections for conn, default 100
+ *
+ * Results are printed one per line as "BENCH name value unit", the same
+ * form as elksbench, for collection by a benchmark harness.
+ *
+ * The same source builds on the host (cc -o ttcp ttcp.c) for ELKS to host
+ * and host to ELKS runs. Under QEMU the host is reached at 10.0.2.2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#ifndef __ia16__
+#include <netdb.h>
+#endif
+
+#define DEF_PORT	5001
+#define BUFSIZE		1024
+#define HDRSIZE		8
+
+/* test header from client: mode, 0, length (2 bytes), count (4 bytes) */
+#define MODE_SEND	'S'	/* server reads count KB of data, writes 1 byte */
+#define MODE_RECV	'R'	/* server writes count KB in length writes */
+#define MODE_RR		'E'	/* server echoes count messages of length */
+#define MODE_CONN	'C'	/* server closes at once */
+
+static char buf[BUFSIZE];
+static int port = DEF_PORT;
+static long kbytes = 256;
+static int length = BUFSIZE;
+static long count = 100;
+
+static unsigned long msecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000UL + tv.tv_usec / 1000;
+}
+
+static void result(char *name, unsigned long value, char *unit)
+{
+	printf("BENCH %s %lu %s\n", name, value, unit);
+	fflush(stdout);
+}
+
+static void failed(char *name)
+{
+	printf("BENCH %s failed -\n", name);
+	fflush(stdout);
+}
+
+/* read exactly n bytes, 0 on EOF or error */
+static int readn(int fd, char *p, int n)
+{
+	int i;
+
+	while (n > 0) {
+		if ((i = read(fd, p, n)) <= 0)
+			return 0;
+		p += i;
+		n -= i;
+	}
+	return 1;
+}
+
+static int writen(int fd, char *p, int n)
+{
+	return write(fd, p, n) == n;
+}
+
+static void serve(int fd)
+{
+	unsigned char hdr[HDRSIZE];
+	long n, total;
+	int len, i;
+
+	if (!readn(fd, (char *)hdr, HDRSIZE))
+		return;
+	len = (hdr[2] << 8) | hdr[3];
+	n = ((long)hdr[4] << 24) | ((long)hdr[5] << 16) | ((long)hdr[6] << 8) | hdr[7];
+	if (len < 1 || len > BUFSIZE)
+		return;
+
+	switch (hdr[0]) {
+	case MODE_SEND:
+		total = n * 1024L;
+		while (total > 0) {
+			if ((i = read(fd, buf, total < BUFSIZE? (int)total: BUFSIZE)) <= 0)
+				return;
+			total -= i;
+		}
+		writen(fd, buf, 1);
+		break;
+	case MODE_RECV:
+		total = n * 1024L;
+		while (total > 0) {
+			i = total < len? (int)total: len;
+			if (!writen(fd, buf, i))
+				return;
+			total -= i;
+		}
+		break;
+	case MODE_RR:
+		while (n-- > 0) {
+			if (!readn(fd, buf, len) || !writen(fd, buf, len))
+				return;
+		}
+		break;
+	}
+}
+
+static int server(void)
+{
+	struct sockaddr_in addr;
+	int s, fd, on = 1;
+
+	if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+		perror("socket");
+		return 1;
+	}
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = INADDR_ANY;
+	if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		perror("bind");
+		return 1;
+	}
+	if (listen(s, 5) < 0) {
+		perror("listen");
+		return 1;
+	}
+	for (;;) {
+		if ((fd = accept(s, NULL, NULL)) < 0) {
+			perror("accept");
+			continue;
+		}
+		serve(fd);
+		close(fd);
+	}
+}
+
+static struct sockaddr_in server_addr;
+
+static unsigned long resolve(char *host)
+{
+#ifdef __ia16__
+	return in_gethostbyname(host);
+#else
+	struct hostent *h;
+	struct in_addr a;
+
+	if (!(h = gethostbyname(host)))
+		return 0;
+	memcpy(&a, h->h_addr, sizeof(a));
+	return a.s_addr;
+#endif
+}
+
+/* connect and send the test header, returns socket or -1 */
+static int start(int mode, long n)
+{
+	unsigned char hdr[HDRSIZE];
+	int fd;
+
+	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+		return -1;
+	if (connect(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	hdr[0] = mode;
+	hdr[1] = 0;
+	hdr[2] = length >> 8;
+	hdr[3] = length;
+	hdr[4] = n >> 24;
+	hdr[5] = n >> 16;
+	hdr[6] = n >> 8;
+	hdr[7] = n;
+	if (!writen(fd, (char *)hdr, HDRSIZE)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static unsigned long kbps(long kb, unsigned long ms)
+{
+	return ms > 0? kb * 1000L / ms: 0;
+}
+
+/* time from the first write until the server has read it all */
+static void test_send(void)
+{
+	unsigned long start_ms, ms;
+	long total;
+	int fd, i;
+
+	if ((fd = start(MODE_SEND, kbytes)) < 0) {
+		failed("tcp_send");
+		return;
+	}
+	start_ms = msecs();
+	for (total = kbytes * 1024L; total > 0; total -= i) {
+		i = total < length? (int)total: length;
+		if (!writen(fd, buf, i))
+			break;
+	}
+	if (total > 0 || !readn(fd, buf, 1)) {
+		close(fd);
+		failed("tcp_send");
+		return;
+	}
+	ms = msecs() - start_ms;
+	close(fd);
+	result("tcp_send", kbps(kbytes, ms), "KB/s");
+}
+
+static void test_recv(void)
+{
+	unsigned long start_ms, ms;
+	long total = 0;
+	int fd, i;
+
+	if ((fd = start(MODE_RECV, kbytes)) < 0) {
+		failed("tcp_recv");
+		return;
+	}
+	start_ms = msecs();
+	while ((i = read(fd, buf, BUFSIZE)) > 0)
+		total += i;
+	ms = msecs() - start_ms;
+	close(fd);
+	if (total != kbytes * 1024L)
+		failed("tcp_recv");
+	else
+		result("tcp_recv", kbps(kbytes, ms), "KB/s");
+}
+
+/* request/response rate and mean round trip time */
+static void test_rr(void)
+{
+	unsigned long start_ms, ms;
+	long n;
+	int fd;
+
+	if ((fd = start(MODE_RR, count)) < 0) {
+		failed("tcp_rr");
+		return;
+	}
+	start_ms = msecs();
+	for (n = 0; n < count; n++) {
+		if (!writen(fd, buf, length) || !readn(fd, buf, length))
+			break;
+	}
+	ms = msecs() - start_ms;
+	close(fd);
+	if (n < count) {
+		failed("tcp_rr");
+		return;
+	}
+	result("tcp_rr", ms > 0? count * 1000L / ms: 0, "/s");
+	result("tcp_rtt", ms * 1000L / count, "us");
+}
+
+/* connect, send the header and wait for the server close */
+static void test_conn(void)
+{
+	unsigned long start_ms, ms;
+	long n;
+	int fd;
+
+	start_ms = msecs();
+	for (n = 0; n < count; n++) {
+		if ((fd = start(MODE_CONN, 0)) < 0)
+			break;
+		while (read(fd, buf, BUFSIZE) > 0)
+			continue;
+		close(fd);
+	}
+	ms = msecs() - start_ms;
+	if (n < count)
+		failed("tcp_conn");
+	else
+		result("tcp_conn", ms > 0? count * 1000L / ms: 0, "/s");
+}
+
+static struct test {
+	char *name;
+	void (*fn)(void);
+} tests[] = {
+	{ "send",	test_send },
+	{ "recv",	test_recv },
+	{ "rr",		test_rr },
+	{ "conn",	test_conn },
+	{ NULL,		NULL }
+};
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: ttcp -r [-p port]\n"
+		"       ttcp -t [-p port] [-n kbytes] [-l length] [-c count] host [send|recv|rr|conn]...\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct test *t;
+	int c, i, receive = 0, transmit = 0;
+
+	while ((c = getopt(argc, argv, "rtp:n:l:c:")) != -1) {
+		switch (c) {
+		case 'r':
+			receive = 1;
+			break;
+		case 't':
+			transmit = 1;
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'n':
+			kbytes = atol(optarg);
+			break;
+		case 'l':
+			length = atoi(optarg);
+			break;
+		case 'c':
+			count = atol(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (receive == transmit || length < 1 || length > BUFSIZE || kbytes < 1 || count < 1)
+		usage();
+	memset(buf, 'x', BUFSIZE);
+	if (receive)
+		return server();
+
+	if (optind >= argc)
+		usage();
+	memset(&server_addr, 0, sizeof(server_addr));
+	server_addr.sin_family = AF_INET;
+	server_addr.sin_port = htons(port);
+	if (!(server_addr.sin_addr.s_addr = resolve(argv[optind++]))) {
+		fprintf(stderr, "ttcp: unknown host\n");
+		return 1;
+	}
+
+	printf("BENCH START\n");
+	for (t = tests; t->name; t++) {
+		if (optind < argc) {
+			for (i = optind; i < argc; i++)
+				if (!strcmp(argv[i], t->name))
+					break;
+			if (i == argc)
+				continue;
+		}
+		t->fn();
+	}
+	printf("BENCH END\n");
+	return 0;
+}
@@ -26,34 +26,34 @@
 #define	IN_IAC2	3
 #define IN_SB	4
 
-static void dowill(int c);
-static void dowont(int c);
-static void dodo(int c);
-static void dodont(int c);
-static void respond(int ack, int option);
-static void respond_really(int ack, int option);
-
-#define	LASTTELOPT	TELOPT_SGA
-
-static int r_winch = 0;
-
-static int TelROpts[LASTTELOPT+1];
-static int TelLOpts[LASTTELOPT+1];
-
-static int telfdout;
-
-void tel_init()
+static void dowill(struct telstate *ts, int c);
+static void dowont(struct telstate *ts, int c);
+static void dodo(struct telstate *ts, int c);
+static void dodont(struct telstate *ts, int c);
+static void respond(struct telstate *ts, int ack, int option);
+static void respond_really(struct telstate *ts, int ack, int option);
+
+void tel_init(ts, telout)
+struct telstate *ts;
+int telout;
 {
 int i;
 
+   ts->telout = telout;
+   ts->instate = IN_DATA;
+   ts->thisopt = 0;
+   ts->r_winch = 0;
+   ts->winchpos = -1;
+   ts->iacs = 0;
+   ts->lastiac = 0;
    for(i = 0; i <= LASTTELOPT; i++) {
-	TelROpts[i] = 0;
-	TelLOpts[i] = 0;
+	ts->ropts[i] = 0;
+	ts->lopts[i] = 0;
    }
 }
 
-void telopt(fdout, what, option)
-int fdout;
+void telopt(ts, what, option)
+struct telstate *ts;
 int what;
 int option;
 {
@@ -68,31 +68,31 @@ int len;
    switch(what) {
 	case DO:
 		if(option <= LASTTELOPT) {
-			TelROpts[option] = 1;
+			ts->ropts[option] = 1;
 			len = 3;
-		} else if(option == TELOPT_WINCH && !r_winch) { r_winch = 1; len = 3; } 
+		} else if(option == TELOPT_WINCH && !ts->r_winch) { ts->r_winch = 1; len = 3; } 
 		break;
 	case DONT:
 		if(option <= LASTTELOPT) {
-			TelROpts[option] = 1;
+			ts->ropts[option] = 1;
 			len = 3;
 		}
 		break;
 	case WILL:
 		if(option <= LASTTELOPT) {
-			TelLOpts[option] = 1;
+			ts->lopts[option] = 1;
 			len = 3;
 		}
 		break;
 	case WONT:
 		if(option <= LASTTELOPT) {
-			TelLOpts[option] = 1;
+			ts->lopts[option] = 1;
 			len = 3;
 		}
 		break;
    }
    if(len > 0)
-	(void) write(fdout, buf, len);
+	(void) write(ts->telout, buf, len);
 }
 
 void set_winsize(int fd, unsigned int cols, unsigned int rows)
@@ -104,54 +104,55 @@ void set_winsize(int fd, unsigned int cols, unsigned int rows)
 	ioctl(fd, TIOCSWINSZ, (char *) &w);
 }
 
-void tel_in(fdout, telout, buffer, len)
-int fdout;
-int telout;
+/*
+ * Process network input in place, answering options on the socket.
+ * Returns the length of the data left in buffer for the terminal.
+ */
+int tel_in(ts, fdterm, buffer, len)
+struct telstate *ts;
+int fdterm;
 char *buffer;
 int len;
 {
-static int InState = IN_DATA;
-static int ThisOpt = 0;
 char *p;
 char *p2;
 int size;
 int c;
 
-   telfdout = telout;
    p = p2 = buffer;
    size = 0;
 
    while(len > 0) {
    	c = (unsigned char)*p++; len--;
-	switch(InState) {
+	switch(ts->instate) {
    		case IN_CR:
-   			InState = IN_DATA;
+   			ts->instate = IN_DATA;
    			if(c == 0 || c == '\n')
    				break;
    			/* fall through */
    		case IN_DATA:
    			if(c == IAC) {
-   				InState = IN_IAC;
+   				ts->instate = IN_IAC;
    				break;
    			}
    			*p2++ = c; size++;
-   			if(c == '\r') InState = IN_CR;
+   			if(c == '\r') ts->instate = IN_CR;
    			break;
    		case IN_IAC:
    			switch(c) {
    				case IAC:
 	   				*p2++ = c; size++;
-   					InState = IN_DATA;
+   					ts->instate = IN_DATA;
    					break;
    				case WILL:
    				case WONT:
    				case DO:
    				case DONT:
-   					InState = IN_IAC2;
-   					ThisOpt = c;
+   					ts->instate = IN_IAC2;
+   					ts->thisopt = c;
    					break;
    				case SB:
-   				 	InState = IN_SB; 
+   				 	ts->instate = IN_SB; 
    					break;
    				case EOR:
    				case SE:
@@ -169,90 +170,73 @@ int c;
    			}
    			break;
    		case IN_IAC2:
-   			if(size > 0) {
-   				write(fdout, buffer, size);
-   				p2 = buffer;
-   				size = 0;
-   			}
-   			InState = IN_DATA;
-   			switch(ThisOpt) {
-   				case WILL:	dowill(c);	break;
-   				case WONT:	dowont(c);	break;
-   				case DO:	dodo(c);	break;
-   				case DONT:	dodont(c);	break;
+   			ts->instate = IN_DATA;
+   			switch(ts->thisopt) {
+   				case WILL:	dowill(ts, c);	break;
+   				case WONT:	dowont(ts, c);	break;
+   				case DO:	dodo(ts, c);	break;
+   				case DONT:	dodont(ts, c);	break;
    			}
    			break;
    		case IN_SB:
- 		{
-			static int winchpos = -1;
    			/* Subnegotiation. */
-   			if(winchpos >= 0) {
-				static unsigned int winchbuf[5], iacs = 0;
-   				winchbuf[winchpos] = c;
+   			if(ts->winchpos >= 0) {
+   				ts->winchbuf[ts->winchpos] = c;
    				/* IAC is escaped - unescape it. */
-   				if(c == IAC) iacs++; else { iacs = 0; winchpos++; }
-   				if(iacs == 2) { winchpos++; iacs = 0; }
-   				if(winchpos >= 4) {
+   				if(c == IAC) ts->iacs++; else { ts->iacs = 0; ts->winchpos++; }
+   				if(ts->iacs == 2) { ts->winchpos++; ts->iacs = 0; }
+   				if(ts->winchpos >= 4) {
    					/* End of WINCH data. */
-   					set_winsize(fdout,
-   					(winchbuf[0] << 8) | winchbuf[1],
-   					(winchbuf[2] << 8) | winchbuf[3]);
-   					winchpos = -1;
+   					set_winsize(fdterm,
+   					(ts->winchbuf[0] << 8) | ts->winchbuf[1],
+   					(ts->winchbuf[2] << 8) | ts->winchbuf[3]);
+   					ts->winchpos = -1;
    				}
    			} else {
-				static int lastiac = 0;
 	   			switch(c) {
    					case TELOPT_WINCH:
    						/* Start listening. */
-   						winchpos = 0;
+   						ts->winchpos = 0;
    						break;
    					case SE:
-   						if(lastiac) InState = IN_DATA;
+   						if(ts->lastiac) ts->instate = IN_DATA;
    						break;
    					default:
    						break;
    				}
-   				if(c == IAC) lastiac = 1;
-   				else lastiac = 0;
+   				if(c == IAC) ts->lastiac = 1;
+   				else ts->lastiac = 0;
 
 
    			}
    			break;
-   		}
    	}
    }
 
-   if(size > 0)
-   	write(fdout, buffer, size);
+   return size;
 }
 
-void tel_out(fdout, buf, size)
-int fdout;
-char *buf;
+/*
+ * Copy terminal output to dst for the network, doubling any IAC.
+ * dst must have room for twice size bytes.  Returns the length.
+ */
+int tel_out(dst, src, size)
+char *dst;
+char *src;
 int size;
 {
 char *p;
-int got_iac, len;
 
-   p = buf;
-   while(size > 0) {
-	buf = p;
-	got_iac = 0;
-	if((p = (char *)memchr(buf, IAC, size)) != (char *)NULL) {
-		got_iac = 1;
-		p++;
-	} else
-		p = buf + size;
-	len = p - buf;
-	if(len > 0)
-		(void) write(fdout, buf, len);
-	if(got_iac)
-		(void) write(fdout, p - 1, 1);
-	size = size - len;
+   p = dst;
+   while(size-- > 0) {
+	if((*p++ = *src++) == (char)IAC)
+		*p++ = IAC;
    }
+   return p - dst;
 }
 
-static void dowill(c)
+static void dowill(ts, c)
+struct telstate *ts;
 int c;
 {
 int ack;
@@ -261,36 +245,38 @@ int ack;
 	case TELOPT_BINARY:
 	case TELOPT_ECHO:
 	case TELOPT_SGA:
-		if(TelROpts[c] == 1)
+		if(ts->ropts[c] == 1)
 			return;
-		TelROpts[c] = 1;
+		ts->ropts[c] = 1;
 		ack = DO;
 		break;
 	case TELOPT_WINCH:
-		if(r_winch) return;
-		r_winch = 1;
+		if(ts->r_winch) return;
+		ts->r_winch = 1;
 		ack = DO;
- 		respond_really(ack, c); 
+ 		respond_really(ts, ack, c); 
 		return;
 	default:
 		ack = DONT;
    }
 
-   respond(ack, c);
+   respond(ts, ack, c);
 }
 
-static void dowont(c)
+static void dowont(ts, c)
+struct telstate *ts;
 int c;
 {
    if(c <= LASTTELOPT) {
-	if(TelROpts[c] == 0)
+	if(ts->ropts[c] == 0)
 		return;
-	TelROpts[c] = 0;
+	ts->ropts[c] = 0;
    }
-   respond(DONT, c);
+   respond(ts, DONT, c);
 }
 
-static void dodo(c)
+static void dodo(ts, c)
+struct telstate *ts;
 int c;
 {
 int ack;
@@ -299,21 +285,23 @@ int ack;
 	default:
 		ack = WONT;
    }
-   respond(ack, c);
+   respond(ts, ack, c);
 }
 
-static void dodont(c)
+static void dodont(ts, c)
+struct telstate *ts;
 int c;
 {
    if(c <= LASTTELOPT) {
-	if(TelLOpts[c] == 0)
+	if(ts->lopts[c] == 0)
 		return;
-	TelLOpts[c] = 0;
+	ts->lopts[c] = 0;
    }
-   respond(WONT, c);
+   respond(ts, WONT, c);
 }
 
-static void respond(ack, option)
+static void respond(ts, ack, option)
+struct telstate *ts;
 int ack, option;
 {
    /**unsigned char c[3];
@@ -321,10 +309,11 @@ int ack, option;
    c[0] = IAC;
    c[1] = ack;
    c[2] = option;**/
-/*   write(telfdout, c, 3); */
+/*   write(ts->telout, c, 3); */
 }
 
-static void respond_really(ack, option)
+static void respond_really(ts, ack, option)
+struct telstate *ts;
 int ack, option;
 {
 unsigned char c[3];
@@ -332,5 +321,5 @@ unsigned char c[3];
    c[0] = IAC;
    c[1] = ack;
    c[2] = option;
-   write(telfdout, c, 3); 
+   write(ts->telout, c, 3); 
 }
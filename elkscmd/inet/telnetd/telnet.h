@@ -68,8 +68,24 @@
 #define	TELQUAL_IS	0	/* option is...				*/
 #define	TELQUAL_SEND	1	/* send option				*/
 
-void tel_init(void);
-void telopt(int fdout, int what, int option);
-void tel_in(int fdout, int telout, char *buffer, int len);
-void tel_out(int fdout, char *buf, int size);
+#define	LASTTELOPT	TELOPT_SGA
+
+/* option and input parser state of one telnet session */
+struct telstate {
+	int	telout;			/* socket for option replies */
+	int	instate;		/* input parser state */
+	int	thisopt;		/* option command being parsed */
+	int	r_winch;		/* WINCH requested */
+	int	winchpos;		/* next WINCH data byte, -1 if none */
+	int	iacs;			/* escaped IACs in WINCH data */
+	int	lastiac;		/* last subnegotiation byte was IAC */
+	unsigned int winchbuf[5];
+	int	ropts[LASTTELOPT+1];
+	int	lopts[LASTTELOPT+1];
+};
+
+void tel_init(struct telstate *ts, int telout);
+void telopt(struct telstate *ts, int what, int option);
+int tel_in(struct telstate *ts, int fdterm, char *buffer, int len);
+int tel_out(char *dst, char *src, int size);
 #endif /* _ARPA_TELNET_H */
@@ -14,6 +14,7 @@
 #include <signal.h>
 #include <string.h>
 #include <sys/wait.h>
+#include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <time.h>
@@ -26,8 +27,26 @@
 #define errstr(str) write(STDERR_FILENO, str, strlen(str))
 
 #define MAX_BUFFER 512		/* should be equal to TDB_WRITE_MAX and PTYOUTQ_SIZE*/
-static char buf_in  [1500];
-static char buf_out [1500];
+#define NSESS	4		/* sessions, one per pty */
+#define ACCEPT_MS	1000	/* new connection check while sessions are open */
+#define RETRY_MS	20	/* retry of socket writes that would block */
+
+/* session slot for the single process server */
+struct sess {
+	int	sock;			/* network socket, -1 if slot free */
+	int	pty;			/* pty master */
+	pid_t	pid;			/* login process */
+	char	*inp;			/* network input waiting for the pty */
+	int	count_in;
+	char	*outp;			/* pty output waiting for the network */
+	int	count_out;
+	struct telstate tel;		/* telnet options */
+	char	buf_in  [1500];
+	char	buf_out [MAX_BUFFER * 2];	/* room for doubled IACs */
+};
+
+static struct sess sessions[NSESS];
+static char buf_pty [MAX_BUFFER];
 
 char *binlogin[2] = {_PATH_LOGIN, NULL};
 char *binsh[2] = {_PATH_BSHELL, NULL};
@@ -37,6 +56,7 @@ static pid_t term_init(int *pty_fd)
 	int n = 0;
 	int tty_fd;
 	pid_t pid;
+	struct pty_qsize qsize;
 	char pty_name[12];
 
 again:
@@ -52,9 +72,11 @@ again:
 		errmsg("\n");
 		return -1;
 	}
-	signal(SIGCHLD, SIG_IGN);
-	signal(SIGINT, SIG_IGN);
-	
+	/* size slave queues to our buffers, pasted input arrives in bursts*/
+	qsize.inq = qsize.outq = MAX_BUFFER;
+	ioctl(*pty_fd, IOCTL_PTY_SETQ, &qsize);
+	fcntl(*pty_fd, F_SETFD, FD_CLOEXEC);
+
 	if ((pid = fork()) == -1) {
 		perror("telnetd");
 		return -1;
@@ -104,88 +126,194 @@ again:
 		perror("execv");
 		exit(1);
 	}
+	fcntl(*pty_fd, F_SETFL, O_NONBLOCK);
 	return pid;
 }
 
-static void telnet_init(int ofd)
+static void telnet_init(struct sess *sp)
 {
 #ifndef RAWTELNET
-  tel_init();
-
-  telopt(ofd, WILL, TELOPT_SGA);
-  telopt(ofd, DO,   TELOPT_SGA);
-  telopt(ofd, WILL, TELOPT_BINARY);
-  telopt(ofd, DO,   TELOPT_BINARY);
-  telopt(ofd, WILL, TELOPT_ECHO);
-  //telopt(ofd, DO,   TELOPT_WINCH);
+  tel_init(&sp->tel, sp->sock);
+
+  telopt(&sp->tel, WILL, TELOPT_SGA);
+  telopt(&sp->tel, DO,   TELOPT_SGA);
+  telopt(&sp->tel, WILL, TELOPT_BINARY);
+  telopt(&sp->tel, DO,   TELOPT_BINARY);
+  telopt(&sp->tel, WILL, TELOPT_ECHO);
+  //telopt(&sp->tel, DO,   TELOPT_WINCH);
 #endif
 }
 
-static void client_loop (int fdsock, int fdterm)
+static void sess_open(int fdsock)
 {
-    fd_set fds_read;
-    fd_set fds_write;
-    int count;
-    int count_in = 0;
-    int count_out = 0;
-    int count_fd = (fdsock > fdterm) ? (fdsock + 1) : (fdterm + 1);
-    struct timeval timeint;
-
-    telnet_init(fdsock);
-
-    timeint.tv_sec = 0;
-    timeint.tv_usec = 50000L;	/* slow 50ms timeout to fix select hang bug in #1048 */
-    while (1) {
-		FD_ZERO (&fds_read);
-		if (!count_in)  FD_SET (fdsock, &fds_read);
-		if (!count_out) FD_SET (fdterm, &fds_read);
+	struct sess *sp;
 
-		FD_ZERO (&fds_write);
-		if (count_in)  FD_SET (fdterm, &fds_write);
-		if (count_out) FD_SET (fdsock, &fds_write);
-
-		count = select (count_fd, &fds_read, &fds_write, NULL, &timeint);
-		if (count < 0) {
-			perror ("telnetd select");
+	for (sp = sessions; sp < &sessions[NSESS]; sp++)
+		if (sp->sock < 0)
 			break;
+	if (sp == &sessions[NSESS]) {
+		close(fdsock);
+		return;
+	}
+	fcntl(fdsock, F_SETFD, FD_CLOEXEC);
+	sp->pid = term_init(&sp->pty);
+	if (sp->pid == -1) {
+		close(fdsock);
+		return;
+	}
+	fcntl(fdsock, F_SETFL, O_NONBLOCK);
+	sp->sock = fdsock;
+	sp->count_in = sp->count_out = 0;
+	telnet_init(sp);
+}
+
+static void sess_close(struct sess *sp)
+{
+	kill (sp->pid, SIGKILL);
+	waitpid(sp->pid, NULL, 0);
+	close (sp->sock);
+	close (sp->pty);
+	sp->sock = -1;
+}
+
+/* write pending data from *bufp, returns 0 on error */
+static int sess_write(int fd, char **bufp, int *countp)
+{
+	int n;
+
+	n = write (fd, *bufp, *countp);
+	if (n < 0)
+		return errno == EAGAIN;
+	*bufp += n;
+	*countp -= n;
+	return 1;
+}
+
+/* move data for a session, returns 0 if the session is over */
+static int sess_io(struct sess *sp, fd_set *fds_read, fd_set *fds_write)
+{
+	int n;
+
+	/* network -> login process*/
+	if (!sp->count_in && FD_ISSET (sp->sock, fds_read)) {
+		n = read (sp->sock, sp->buf_in, sizeof(sp->buf_in));
+		if (n <= 0) {
+			if (n < 0 && errno == EAGAIN)
+				return 1;
+			if (n < 0)
+				perror ("telnetd read sock");
+			return 0;
 		}
+#ifndef RAWTELNET
+		n = tel_in(&sp->tel, sp->pty, sp->buf_in, n);
+#endif
+		sp->inp = sp->buf_in;
+		sp->count_in = n;
+	}
+	if (sp->count_in && FD_ISSET (sp->pty, fds_write)) {
+		if (!sess_write(sp->pty, &sp->inp, &sp->count_in))
+			return 0;
+	}
 
-		/* network -> login process*/
-		if (!count_in && FD_ISSET (fdsock, &fds_read)) {
-			count_in = read (fdsock, buf_in, sizeof(buf_in));
-			if (count_in <= 0) {
-				if (count_in < 0)
-					perror ("telnetd read sock");
-				break;
-			}
+	/* login process -> network, as much as the pty has queued*/
+	if (!sp->count_out && FD_ISSET (sp->pty, fds_read)) {
+		n = read (sp->pty, buf_pty, sizeof(buf_pty));
+		if (n <= 0) {
+			if (n < 0 && errno == EAGAIN)
+				return 1;
+			if (n < 0)
+				perror ("telnetd read term");
+			return 0;
 		}
-		if (count_in && FD_ISSET (fdterm, &fds_write)) {
 #ifdef RAWTELNET
-			write (fdterm, buf_in, count_in);
+		memcpy(sp->buf_out, buf_pty, n);
 #else
-			tel_in(fdterm, fdsock, buf_in, count_in);
+		n = tel_out(sp->buf_out, buf_pty, n);
 #endif
-			count_in = 0;
-		}
+		sp->outp = sp->buf_out;
+		sp->count_out = n;
+	}
+	if (sp->count_out) {
+		if (!sess_write(sp->sock, &sp->outp, &sp->count_out))
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Single process server for all sessions. Network sockets always
+ * select ready for writing and the listening socket for reading, so
+ * socket writes that would block are retried after RETRY_MS, and new
+ * connections are accepted nonblocking every ACCEPT_MS while sessions
+ * are open, or with a blocking accept when there are none. Terminal and
+ * network input never wait for a timeout.
+ */
+static void serve(int sockfd)
+{
+	struct sess *sp;
+	fd_set fds_read;
+	fd_set fds_write;
+	struct timeval timeint;
+	int fd, nopen, ms, count_fd;
+
+	for (sp = sessions; sp < &sessions[NSESS]; sp++)
+		sp->sock = -1;
+	fcntl(sockfd, F_SETFL, O_NONBLOCK);
 
-		/* login process -> network*/
-		if (!count_out && FD_ISSET (fdterm, &fds_read)) {
-			count_out = read (fdterm, buf_out, sizeof(buf_out));
-			if (count_out <= 0) {
-				if (count_out < 0)
-					perror ("telnetd read term");
-				break;
+	while (1) {
+		nopen = 0;
+		for (sp = sessions; sp < &sessions[NSESS]; sp++)
+			if (sp->sock >= 0)
+				nopen++;
+		if (nopen < NSESS) {
+			if (!nopen)
+				fcntl(sockfd, F_SETFL, 0);
+			fd = accept(sockfd, NULL, NULL);
+			if (!nopen)
+				fcntl(sockfd, F_SETFL, O_NONBLOCK);
+			if (fd >= 0)
+				sess_open(fd);
+			else if (errno != EAGAIN) {
+				perror ("telnetd accept");
+				if (errno == ENOTSOCK)
+					break;
 			}
 		}
-		if (count_out && FD_ISSET (fdsock, &fds_write)) {
-#ifdef RAWTELNET
-			write (fdsock, buf_out, count_out);
-#else
-			tel_out(fdsock, buf_out, count_out);
-#endif
-			count_out = 0;
+
+		FD_ZERO (&fds_read);
+		FD_ZERO (&fds_write);
+		count_fd = 0;
+		ms = ACCEPT_MS;
+		for (sp = sessions; sp < &sessions[NSESS]; sp++) {
+			if (sp->sock < 0)
+				continue;
+			if (sp->count_in)
+				FD_SET (sp->pty, &fds_write);
+			else FD_SET (sp->sock, &fds_read);
+			if (sp->count_out)
+				ms = RETRY_MS;
+			else FD_SET (sp->pty, &fds_read);
+			if (sp->sock >= count_fd)
+				count_fd = sp->sock + 1;
+			if (sp->pty >= count_fd)
+				count_fd = sp->pty + 1;
+		}
+		if (!count_fd)
+			continue;
+
+		timeint.tv_sec = ms / 1000;
+		timeint.tv_usec = (ms % 1000) * 1000L;
+		if (select (count_fd, &fds_read, &fds_write, NULL, &timeint) < 0) {
+			if (errno != EINTR)
+				perror ("telnetd select");
+			continue;
+		}
+
+		for (sp = sessions; sp < &sessions[NSESS]; sp++) {
+			if (sp->sock >= 0 && !sess_io(sp, &fds_read, &fds_write))
+				sess_close(sp);
 		}
-    }
+	}
 }
 
 #if 0
@@ -199,9 +327,8 @@ void sigchild(void)
 int main(int argc, char **argv)
 {
 	struct sockaddr_in addr_in;
-	int sockfd,connectionfd,fd;
-	int pty_fd, ret;
-	pid_t pid;
+	int sockfd,fd;
+	int ret;
 
 	if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
 		perror("telnetd");
@@ -257,42 +384,11 @@ int main(int argc, char **argv)
 	setsid();
 	//signal(SIGCHLD, sigchild);
 
-	while (1) {
-		unsigned int len = sizeof(addr_in);
-		connectionfd = accept(sockfd, (struct sockaddr *)&addr_in, &len);
-		if (connectionfd < 0) {
-			perror ("telnetd accept");
-			break;
-		}
-
-		waitpid(-1, NULL, WNOHANG);		/* reap previous accepts*/
-
-		if ((ret = fork()) == -1)		/* handle new accept*/
-			perror("telnetd");
-		else if (ret == 0) {
-#if 0 /* test code for accept and getpeername */
-			fprintf(stderr, "accept from %s:%u\n", in_ntoa(addr_in.sin_addr.s_addr),
-				ntohs(addr_in.sin_port));
-			if (getpeername(connectionfd, (struct sockaddr *)&addr_in, &len) < 0)
-			    perror("getpeername");
-			fprintf(stderr, "getpeername %s:%u\n", in_ntoa(addr_in.sin_addr.s_addr),
-				ntohs(addr_in.sin_port));
-#endif
-			close(sockfd);
-			pid = term_init(&pty_fd);
-			if (pid != -1) {
-				client_loop (connectionfd, pty_fd);
-
-				kill (pid, SIGKILL);
-				waitpid(pid, NULL, 0);
-			}
-			close (connectionfd);
-			close (pty_fd);
-			exit(0);
-		} else {
-			close(connectionfd);
-		}
-	}
+	signal(SIGCHLD, SIG_IGN);
+	signal(SIGINT, SIG_IGN);
+	signal(SIGPIPE, SIG_IGN);
+	fcntl(sockfd, F_SETFD, FD_CLOEXEC);
+	serve(sockfd);
 
 	close (sockfd);
 	return 0;
@@ -74,9 +74,10 @@ struct dlist {
 struct dlist *obj = NULL, *olist = NULL, *newobj;
 unsigned short IRCPORT = DEFAULTPORT;
 int my_tcp, sok = 1, my_tty, hline, dumb = 0, CO, LI, column;
-char *tmp, *linein, *CM, *CS, *CE, *SO, *SE, *DC, *ptr, *term, *fromhost,
+char *tmp, *linein, *CM, *CS, *CE, *SO, *SE, *DC, *AL, *DL, *ptr, *term, *fromhost,
 *TOK[20], IRCNAME[32], IRCLOGIN[64], IRCGECOS[64], inputbuf[512], ib[IB_SIZE],
- serverdata[512], ch, bp[1024], lineout[512], *hist[HISTLEN], termcap[1024];
+ serverdata[512], ch, bp[1024], lineout[512], *hist[HISTLEN], termcap[1024],
+ obuf[2048];
 int cursd = 0, curli = 0, curx = 0, noinput = 0, reconnect = 1;
 fd_set readfs;
 struct timeval timeout;
@@ -207,6 +208,25 @@ char *s;
     for (i = 0; i < strlen(s); i++)
 	sprintf(&encoded[strlen(encoded)], "%02x", s[i]);
 }
+/*
+ * Start a new line at the bottom of the message area, scrolling only the
+ * message area up. Without a scroll region, the top line is deleted and
+ * a line inserted above the status line instead.
+ */
+void msgnewline()
+{
+    if (dumb)
+	printf("\n\r");
+    else if (CS) {
+	tputs_x(tgoto(CM, 0, LI - 3));
+	putchar('\n');
+    } else {
+	tputs_x(tgoto(CM, 0, 0));
+	tputs_x(DL);
+	tputs_x(tgoto(CM, 0, LI - 3));
+	tputs_x(AL);
+    }
+}
 int sendline()
 {
     if (write(my_tcp, lineout, strlen(lineout)) < 1)
@@ -270,7 +290,8 @@ static int dokick()
 	if (obj == NULL)
 	    obj = olist;
 	if (obj != NULL)
-	    printf("\n\r*** Now talking in %s", OBJ);
+	    msgnewline();
+	    printf("*** Now talking in %s", OBJ);
 	wasdate = 0;
     }
     return 0;
@@ -328,7 +349,8 @@ static int dopart()
 	if (obj == NULL)
 	    obj = olist;
 	if (obj != NULL)
-	    printf("\n\r*** Now talking in %s", OBJ);
+	    msgnewline();
+	    printf("*** Now talking in %s", OBJ);
 	wasdate = 0;
     }
     return 0;
@@ -437,6 +459,7 @@ int num;
 	    resetty();
 	}
 	printf("New Nick? ");
+	fflush(stdout);
 	while ((ch = getchar()) != '\n')
 	    if (strlen(IRCNAME) < 9)
 		*(tmp++) = ch;
@@ -499,8 +522,10 @@ int count;
 	    *(tmp++) = '\0';
 	if (strlen(p) < CO - count)
 	    count += printf(" %s", p);
-	else
-	    count = printf("\n\r   %s", p);
+	else {
+	    msgnewline();
+	    count = printf("   %s", p);
+	}
 	p = tmp;
     }
     return count;
@@ -514,8 +539,6 @@ int parsedata()
 	lineout[1] = 'O';
 	return sendline();
     }
-    if (!dumb)
-	tputs_x(tgoto(CM, 0, LI - 3));
     TOK[i = 0] = serverdata;
     TOK[i]++;
     while (TOK[i] != NULL && i < 15)
@@ -537,7 +560,7 @@ int parsedata()
     } else
 	fromhost = NULL;
     if (!dumb)
-	putchar('\n');
+	msgnewline();
     column = 0;
     if (i = atoi(TOK[1]))
 	i = donumeric(i);
@@ -584,7 +607,7 @@ int serverinput()
 	    cursd = 0;
 	    if (!parsedata())
 		return 0;
-	} else if (ib[i] != '\r')
+	} else if (ib[i] != '\r' && cursd < sizeof(serverdata) - 1)
 	    serverdata[cursd++] = ib[i];
     return 1;
 }
@@ -602,10 +625,8 @@ void parseinput()
 	} else
 	    TOK[++i] = NULL;
     TOK[++i] = NULL;
-    if (!dumb) {
-	tputs_x(tgoto(CM, 0, LI - 3));
-	putchar('\n');
-    }
+    if (!dumb)
+	msgnewline();
     if (*TOK[0] == COMMANDCHAR) {
 	TOK[0]++;
 	for (i = 0; i < strlen(TOK[0]) && isalpha(TOK[0][i]); i++)
@@ -852,7 +873,8 @@ int sig;
 {
     if (!dumb) {
 	resetty();
-	tputs_x(tgoto(CS, -1, -1));
+	if (CS)
+	    tputs_x(tgoto(CS, -1, -1));
 	tputs_x(tgoto(CM, 0, LI - 1));
 	fflush(stdout);
     }
@@ -884,7 +906,8 @@ void redraw()
 #endif
 	}
 	wasdate = 0;
-	tputs_x(tgoto(CS, LI - 3, 0));
+	if (CS)
+	    tputs_x(tgoto(CS, LI - 3, 0));
 	updatestatus();
 	tputs_x(tgoto(CM, LI - 3, 0));
     }
@@ -1052,13 +1075,17 @@ For details please see the file COPYING.\n", RELEASE);
 	    SO = "";
 	if ((SE = tgs("se")) == NULL)
 	    SE = "";
-	if (!CM || !(CS = tgs("cs")) ||
-	    !(CE = tgs("ce"))) {
-	    printf("tinyirc: sorry, no termcap cm,cs,ce: dumb mode set\n");
+	CS = tgs("cs");
+	AL = tgs("al");
+	DL = tgs("dl");
+	if (!CM || !(CE = tgs("ce")) || (!CS && !(AL && DL))) {
+	    printf("tinyirc: sorry, no termcap cm,ce,cs or al,dl: dumb mode set\n");
 	    dumb = 1;
 	}
 	if (!dumb) {
 	    DC = tgs("dc");
+	    /* send each update as a single write */
+	    setvbuf(stdout, obuf, _IOFBF, sizeof(obuf));
 	    savetty();
 	    raw();
 #ifdef CURSES
@@ -1097,6 +1124,7 @@ For details please see the file COPYING.\n", RELEASE);
 	if (!sok && reconnect) {
 	    close(my_tcp);	/* dead socket */
 	    printf("*** trying port %d of %s\n\n", IRCPORT, hostname);
+	    fflush(stdout);
 	    if (makeconnect(hostname) < 0) {
 		fprintf(stderr, "*** %s refused connection\n", hostname);
 		exit(0);
@@ -1108,7 +1136,8 @@ For details please see the file COPYING.\n", RELEASE);
 	fflush(stdout);
     }
     if (!dumb) {
-	tputs_x(tgoto(CS, -1, -1));
+	if (CS)
+	    tputs_x(tgoto(CS, -1, -1));
 	tputs_x(tgoto(CM, 0, LI - 1));
 #ifdef CURSES
 	echo();
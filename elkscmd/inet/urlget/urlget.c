@@ -14,6 +14,9 @@
  * 	-p -- post instead of get (httpget), data to post (ascii/UTF) is appended to the URL (after a '?').
  *	-v -- verbose file listing & error reporting, progress meter (ftpput/ftpget)
  *
+ * urlget also takes several URLs, each written to a file named after the
+ * last part of its path. Consecutive http URLs on the same host share one
+ * keep-alive connection, with the requests pipelined.
  */
 
 
@@ -42,6 +45,7 @@ _PROTOTYPE(int ftpreply, (FILE *fpr));
 _PROTOTYPE(int ftpcmd, (FILE *fpw, FILE *fpr, char *cmd, char *arg));
 _PROTOTYPE(int ftpio, (char *host, int port, char *user, char *pass, char *path, int type, int verbose));
 _PROTOTYPE(int tcpget, (char *host, int port, char *user, char *pass, char *path));
+_PROTOTYPE(int geturls, (char **urls, int n, int headers, int discard, int verbose));
 _PROTOTYPE(int main, (int argc, char *argv[]));
 _PROTOTYPE(void usage, (void));
 
@@ -57,8 +61,29 @@ char *progname;
 
 #define TRANS_DEBUG	0	/* for debug dumps */
 
+#define PIPEDEPTH	4	/* http requests sent ahead on a connection */
+#define MAXURL		400	/* longest URL in a list */
+
 char buffer[4096];
 
+/* parsed URL, pointing into the URL string */
+struct url {
+	char	*url;		/* original URL, for messages */
+	int	scheme;
+	char	host[64];
+	int	port;
+	char	*user;
+	char	*pass;
+	char	*path;
+	int	type;		/* ftp type */
+};
+
+/* keep-alive connection input in buffer, and file output */
+static char *bufp;
+static int buflen;
+static char outbuf[4096];
+static int outlen;
+
 char *unesc(char *s) {
    char *p, *p2;
    unsigned char c;
@@ -512,13 +537,366 @@ int tcpget(char *host, int port, char *user, char *pass, char *path) {
    return 0;
 }
 
+/* Split url into u, returns -1 if the scheme is unknown */
+int parseurl(char *url, struct url *u) {
+   char *ps, *p, *at, *path;
+   int hadslash;
+
+   u->url = url;
+   if (strncasecmp(url, "http://", 7) == 0) {
+   	u->scheme = SCHEME_HTTP;
+   	ps = url + 7;
+   } else
+   if (strncasecmp(url, "ftp://", 6) == 0) {
+   	u->scheme = SCHEME_FTP;
+   	ps = url + 6;
+   } else
+   if (strncasecmp(url, "tcp://", 6) == 0) {
+   	u->scheme = SCHEME_TCP;
+   	ps = url + 6;
+   } else {
+	errmsg("Must specify http://, ftp:// or tcp:// url prefix");
+	return(-1);
+   }
+
+   u->user = "";
+   u->pass = "";
+   u->host[0] = '\0';
+   u->port = 0;
+   u->type = 'i';
+
+   p = ps;
+   while (*p && *p != '/') p++;
+   path = p;
+   hadslash = (*path == '/');
+   *path = '\0';
+
+   at = strchr(ps, '@');
+   if (at != (char *)NULL) {
+   	*at = '\0';
+   	p = ps;
+   	while (*p && *p != ':') p++;
+   	if (*p)
+   		*p++ = '\0';
+	u->user = ps;
+   	u->pass = p;
+   	ps = at + 1;
+   }
+
+   if (hadslash)
+	*path = '/';
+   p = ps;
+   while (*p && *p != '/' && *p != ':') p++;
+   if (p - ps >= sizeof(u->host))
+	ps = p - (sizeof(u->host) - 1);
+   strncpy(u->host, ps, p - ps);
+   u->host[p - ps] = '\0';
+   if (*p == ':') {
+   	p++;
+   	while (*p && *p != '/')
+   		u->port = u->port * 10 + (*p++ - '0');
+   }
+   if (*p == '/')
+	u->path = p;
+   else
+   	u->path = "/";
+   if (u->scheme == SCHEME_FTP) {
+   	p = u->path;
+   	while (*p && *p != ';') p++;
+   	if (*p) {
+   		*p++ = '\0';
+   		if (strncasecmp(p, "type=", 5) == 0) {
+   			p += 5;
+   			u->type = tolower(*p);
+   		}
+   	}
+   }
+   return 0;
+}
+
+/* Output file name for a URL, the last part of its path */
+char *urlfile(struct url *u) {
+   static char name[64];
+   char *p, *e;
+
+   p = strrchr(u->path, '/');
+   p = p? p + 1: u->path;
+   e = p + strcspn(p, "?;");
+   if (e == p)
+	return "index.html";
+   if (e - p >= sizeof(name))
+	e = p + sizeof(name) - 1;
+   memcpy(name, p, e - p);
+   name[e - p] = '\0';
+   return name;
+}
+
+/*
+ * Send an http GET for u asking to keep the connection. It is built
+ * in its own buffer, as buffer may hold pipelined responses.
+ */
+void httpreq(int fd, struct url *u) {
+   static char req[MAXURL + 368];
+   int n;
+
+   n = snprintf(req, sizeof(req), "GET %s HTTP/1.0\r\nUser-Agent: urlget\r\n"
+	"Connection: keep-alive\r\nHost: %s\r\n%s%s%s\r\n", u->path, u->host,
+	*u->user? "Authorization: ": "", *u->user? auth(u->user, u->pass): "",
+	*u->user? "\r\n": "");
+   write(fd, req, n);
+}
+
+/* Get the next byte of connection input, -1 at EOF */
+int netbyte(int fd) {
+   if (buflen <= 0) {
+	buflen = read(fd, buffer, sizeof(buffer));
+	if (buflen <= 0) {
+		buflen = 0;
+		return -1;
+	}
+	bufp = buffer;
+   }
+   buflen--;
+   return (unsigned char)*bufp++;
+}
+
+/* Read a response header line, returns its length or -1 at EOF */
+int netline(int fd, char *line, int size) {
+   int c, n = 0;
+
+   while ((c = netbyte(fd)) >= 0) {
+	if (c == '\n') {
+		if (n && line[n-1] == '\r')
+			n--;
+		line[n] = '\0';
+		return n;
+	}
+	if (n < size - 1)
+		line[n++] = c;
+   }
+   return -1;
+}
+
+/* Buffer file output, writing whole buffers, returns -1 on error */
+int outdata(int ofd, char *p, int len) {
+   int n;
+
+   while (len > 0) {
+	n = sizeof(outbuf) - outlen;
+	if (n > len)
+		n = len;
+	memcpy(outbuf + outlen, p, n);
+	outlen += n;
+	p += n;
+	len -= n;
+	if (outlen == sizeof(outbuf)) {
+		if (ofd >= 0 && write(ofd, outbuf, outlen) != outlen)
+			return -1;
+		outlen = 0;
+	}
+   }
+   return 0;
+}
+
+int outflush(int ofd) {
+   int n = outlen;
+
+   outlen = 0;
+   if (ofd >= 0 && n && write(ofd, outbuf, n) != n)
+	return -1;
+   return 0;
+}
+
+#define RESP_NONE	0	/* connection closed before the response */
+#define RESP_KEEP	1	/* response read, connection kept */
+#define RESP_CLOSE	2	/* response read, connection closed */
+
+/*
+ * Read the response for u from the keep-alive connection into its file.
+ * Sets *err on failure.
+ */
+int httpresp(int fd, struct url *u, int headers, int discard, int *err) {
+   char line[256];
+   long clen = -1;
+   int n, code, keep, ofd = -1, first = 1;
+   char *name;
+
+   keep = 0;
+   code = 0;
+   while ((n = netline(fd, line, sizeof(line))) > 0) {
+	if (first) {
+		first = 0;
+		if (strncmp(line, "HTTP/", 5) == 0 && (name = strchr(line, ' ')))
+			code = atoi(name + 1);
+		keep = (strncmp(line, "HTTP/1.1", 8) == 0);
+	} else if (strncasecmp(line, "Content-Length:", 15) == 0)
+		clen = atol(line + 15);
+	else if (strncasecmp(line, "Connection:", 11) == 0) {
+		for (name = line + 11; *name == ' '; name++)
+			continue;
+		keep = (strncasecmp(name, "keep-alive", 10) == 0);
+	}
+	if (headers) {
+		outdata(1, line, n);
+		outdata(1, "\n", 1);
+	}
+   }
+   outflush(1);
+   if (n < 0) {
+	if (first)
+		return RESP_NONE;
+	errmsg("%s: connection closed early", u->url);
+	*err = 1;
+	return RESP_CLOSE;
+   }
+
+   if (code != 200) {
+	errmsg("%s: status %d", u->url, code);
+	*err = 1;
+	discard = 1;
+   }
+   if (!discard) {
+	name = urlfile(u);
+	if ((ofd = open(name, O_WRONLY|O_CREAT|O_TRUNC, 0644)) < 0) {
+		perror(name);
+		*err = 1;
+	}
+   }
+
+   /* copy the body, all of it up to EOF if there is no length */
+   while (clen != 0) {
+	if (buflen <= 0 && (n = netbyte(fd)) >= 0) {
+		bufp--;
+		buflen++;
+	}
+	if (buflen <= 0)
+		break;
+	n = (clen >= 0 && clen < buflen)? (int)clen: buflen;
+	if (outdata(ofd, bufp, n) < 0) {
+		perror(name);
+		*err = 1;
+		ofd = -1;
+	}
+	bufp += n;
+	buflen -= n;
+	if (clen > 0)
+		clen -= n;
+   }
+   if (outflush(ofd) < 0) {
+	perror(name);
+	*err = 1;
+   }
+   if (ofd >= 0)
+	close(ofd);
+   if (clen > 0) {
+	errmsg("%s: connection closed early", u->url);
+	*err = 1;
+   }
+   return (clen < 0 || !keep)? RESP_CLOSE: RESP_KEEP;
+}
+
+/*
+ * Fetch http URLs u[0..n-1], all on one host, keeping PIPEDEPTH requests
+ * ahead on a keep-alive connection. When the server closes the
+ * connection, the unanswered requests are sent again on a new one.
+ */
+int httpmany(struct url *u, int n, int headers, int discard) {
+   int fd = -1, sent = 0, done = 0, fresh = 0, err = 0;
+
+   while (done < n) {
+	if (fd < 0) {
+		fd = net_connect(u->host, u->port? u->port: 80);
+		if (fd < 0) {
+			perror(u->host);
+			return -1;
+		}
+		sent = done;
+		buflen = 0;
+		fresh = 1;
+	}
+	while (sent < n && sent - done < PIPEDEPTH)
+		httpreq(fd, &u[sent++]);
+
+	switch (httpresp(fd, &u[done], headers, discard, &err)) {
+	case RESP_NONE:
+		if (fresh) {
+			errmsg("%s: no response", u[done].url);
+			err = 1;
+			done++;
+		}
+		net_close(fd, 1);
+		fd = -1;
+		break;
+	case RESP_CLOSE:
+		done++;
+		net_close(fd, done < sent);
+		fd = -1;
+		break;
+	case RESP_KEEP:
+		done++;
+		fresh = 0;
+		break;
+	}
+   }
+   if (fd >= 0)
+	net_close(fd, 0);
+   return err? -1: 0;
+}
+
+/* Fetch several URLs, each into its own file */
+int geturls(char **urls, int n, int headers, int discard, int verbose) {
+   struct url *u;
+   int i, j, fd, s, err = 0;
+
+   if ((u = malloc(n * sizeof(struct url))) == NULL) {
+	errmsg("Out of memory");
+	return -1;
+   }
+   for (i = 0; i < n; i++) {
+	if (strlen(urls[i]) > MAXURL) {
+		errmsg("%s: URL too long", urls[i]);
+		return -1;
+	}
+	if (parseurl(urls[i], &u[i]) < 0)
+		return -1;
+   }
+
+   for (i = 0; i < n; i = j) {
+	j = i + 1;
+	if (u[i].scheme == SCHEME_HTTP) {
+		while (j < n && u[j].scheme == SCHEME_HTTP &&
+		       u[j].port == u[i].port && !strcmp(u[j].host, u[i].host))
+			j++;
+		if (httpmany(&u[i], j - i, headers, discard) < 0)
+			err = 1;
+		continue;
+	}
+	if ((fd = open(urlfile(&u[i]), O_WRONLY|O_CREAT|O_TRUNC, 0644)) < 0) {
+		perror(urlfile(&u[i]));
+		err = 1;
+		continue;
+	}
+	dup2(fd, 1);
+	close(fd);
+	if (u[i].scheme == SCHEME_FTP)
+		s = ftpio(u[i].host, u[i].port, u[i].user, u[i].pass, u[i].path,
+			u[i].type, verbose);
+	else
+		s = tcpget(u[i].host, u[i].port, u[i].user, u[i].pass, u[i].path);
+	if (s < 0)
+		err = 1;
+   }
+   return err? -1: 0;
+}
+
 int main(int argc, char **argv) {
 
    char *url, scheme;
    char user[64], pass[64], host[64];
    int port, s;
    int type = 'i';	/* default ftp type */
-   char *path, *ps, *p, *at;
+   char *path, *p;
+   struct url u;
    int opt_d = 0, opt_h = 0, opt_p = 0, opt_v = 0;
 
    if ((progname = strrchr(*argv, '/')))
@@ -600,81 +978,26 @@ int main(int argc, char **argv) {
 	return(s);
    }
 
-   if (argc != 1) {
-	fprintf(stderr, "Usage: %s [-h] [-p] url\n", progname);
+   if (argc < 1) {
+	fprintf(stderr, "Usage: %s [-h] [-p] url ...\n", progname);
 	fprintf(stderr, "e.g. urlget http://216.58.209.67/index.html\n");
    	return(-1);
    }
 
+   if (argc > 1)
+	return geturls(argv, argc, opt_h, opt_d, opt_v);
+
    url = *argv++;
    argc--;
-
-   if (strncasecmp(url, "http://", 7) == 0) {
-   	scheme = SCHEME_HTTP;
-   	ps = url + 7;
-   } else
-   if (strncasecmp(url, "ftp://", 6) == 0) {
-   	scheme = SCHEME_FTP;
-   	ps = url + 6;
-   } else
-   if (strncasecmp(url, "tcp://", 6) == 0) {
-   	scheme = SCHEME_TCP;
-   	ps = url + 6;
-   } else {
-	errmsg("Must specify http://, ftp:// or tcp:// url prefix");
+   if (parseurl(url, &u) < 0)
 	return(-1);
-   }
-
-   user[0] = '\0';
-   pass[0] = '\0';
-   host[0] = '\0';
-   port = 0;
-
-   p = ps;
-   while (*p && *p != '/') p++;
-   path = p;
-   *path = '\0';
-
-   at = strchr(ps, '@');
-   if (at != (char *)NULL) {
-   	*at = '\0';
-   	p = ps;
-   	while (*p && *p != ':') p++;
-   	if (*p)
-   		*p++ = '\0';
-	strcpy(user, ps);
-   	strcpy(pass, p);
-   	ps = at + 1;
-   }
-
-   *path = '/';
-   p = ps;
-   while (*p && *p != '/' && *p != ':') p++;
-   if (*p) {
-   	strncpy(host, ps, p - ps);
-   	host[p - ps] = '\0';
-   }
-   if (*p == ':') {
-   	p++;
-   	ps = p;
-   	while (*p && *p != '/')
-   		port = port * 10 + (*p++ - '0');
-   }
-   if (*p == '/')
-	path = p;
-   else
-   	path = "/";
-   if (scheme == SCHEME_FTP) {
-   	p = path;
-   	while (*p && *p != ';') p++;
-   	if (*p) {
-   		*p++ = '\0';
-   		if (strncasecmp(p, "type=", 5) == 0) {
-   			p += 5;
-   			type = tolower(*p);
-   		}
-   	}
-   }
+   scheme = u.scheme;
+   strcpy(user, u.user);
+   strcpy(pass, u.pass);
+   strcpy(host, u.host);
+   port = u.port;
+   path = u.path;
+   type = u.type;
 
 #if TRANS_DEBUG
    fprintf(stderr, "Host: %s\n", host);
@@ -27,85 +27,203 @@
 #include "netconf.h"
 
 struct arp_cache arp_cache [ARP_CACHE_MAX];
+int arp_pending;
+static struct timer_s arp_timer;	/* earliest pending entry retry*/
 static void arp_prep_request(struct arp *, ipaddr_t);
+static void arp_expire(void *arg);
+
+/* first entry of hash bucket, hashed on last octet of network order address*/
+#define arp_bucket(ip)	\
+	(arp_cache + (((unsigned char *)&(ip))[3] & (ARP_CACHE_HASH-1)) * ARP_CACHE_WAYS)
 
 int arp_init (void)
 {
 	memset (arp_cache, 0, ARP_CACHE_MAX * sizeof (struct arp_cache));
+	arp_pending = 0;
+	timer_init(&arp_timer, arp_expire, NULL);
 	return 0;
 }
 
+/* discard any queued packets and release entry*/
+static void arp_cache_free(struct arp_cache *entry)
+{
+	int i;
+
+	for (i = 0; i < entry->qcount; i++)
+		free(entry->qpacket[i] - sizeof(struct ip_ll));
+	entry->qcount = 0;
+	if (entry->state == ARP_PENDING)
+		arp_pending--;
+	entry->state = ARP_FREE;
+	entry->ip_addr = 0;
+}
+
+/* return entry for ip_addr in any state, expiring stale entries*/
+struct arp_cache *arp_cache_lookup(ipaddr_t ip_addr)
+{
+	struct arp_cache *entry = arp_bucket(ip_addr);
+	int i;
+
+	for (i = 0; i < ARP_CACHE_WAYS; i++, entry++) {
+		if (entry->state == ARP_FREE || entry->ip_addr != ip_addr)
+			continue;
+		if (entry->state != ARP_PENDING && TIME_GEQ(Now, entry->expires)) {
+			debug_arp("arp: expiring cache entry for %s\n", in_ntoa(ip_addr));
+			arp_cache_free(entry);
+			return NULL;
+		}
+		return entry;
+	}
+	return NULL;
+}
+
 struct arp_cache *arp_cache_get(ipaddr_t ip_addr, eth_addr_t eth_addr, int flags)
 {
-	register struct arp_cache *entry = arp_cache;
-
-	/* First pair is the more recent */
-	while (entry < arp_cache + ARP_CACHE_MAX) {
-		if (!entry->ip_addr)
-		    break;
-		if (entry->ip_addr == ip_addr) {
-			if ((flags & ARP_VALID) && !entry->valid)
-				return NULL;	/* not yet valid - awaiting ARP reply*/
-			if (flags & ARP_UPDATE) {
-				memcpy (entry->eth_addr, eth_addr, sizeof (eth_addr_t));
-				debug_arp("arp: merging cached entry for %s (%s)\n",
-					in_ntoa(ip_addr), mac_ntoa(entry->eth_addr));
-			} else {
-				memcpy (eth_addr, entry->eth_addr, sizeof (eth_addr_t));
-				debug_arp("arp: using cached entry for %s (%s)\n",
-					in_ntoa(ip_addr),mac_ntoa(entry->eth_addr));
-			}
-			return entry;	/* success*/
+	struct arp_cache *entry = arp_cache_lookup(ip_addr);
+
+	if (entry) {
+		if ((flags & ARP_VALID) && entry->state != ARP_RESOLVED)
+			return NULL;	/* not yet valid - awaiting ARP reply*/
+		if (flags & ARP_UPDATE) {
+			memcpy (entry->eth_addr, eth_addr, sizeof (eth_addr_t));
+			debug_arp("arp: merging cached entry for %s (%s)\n",
+				in_ntoa(ip_addr), mac_ntoa(entry->eth_addr));
+		} else {
+			memcpy (eth_addr, entry->eth_addr, sizeof (eth_addr_t));
+			debug_arp("arp: using cached entry for %s (%s)\n",
+				in_ntoa(ip_addr),mac_ntoa(entry->eth_addr));
 		}
-		entry++;
+		return entry;	/* success*/
 	}
 
 	debug_arp("arp: no cached entry for %s\n", in_ntoa(ip_addr));
 	return NULL;			/* not found*/
 }
 
+/* mark entry resolved and send any packets queued awaiting the reply*/
+static void arp_cache_resolve(struct arp_cache *entry, eth_addr_t eth_addr)
+{
+	int i;
+
+	memcpy (entry->eth_addr, eth_addr, sizeof (eth_addr_t));
+	if (entry->state == ARP_PENDING)
+		arp_pending--;
+	entry->state = ARP_RESOLVED;
+	entry->expires = Now + ARP_TIMEOUT_RESOLVED;
+
+	for (i = 0; i < entry->qcount; i++) {
+		debug_arp("arp: sending queued packet len %d\n", entry->qlen[i]);
+		eth_sendpacket(entry->qpacket[i], entry->qlen[i], entry->eth_addr);
+		free(entry->qpacket[i] - sizeof(struct ip_ll));
+	}
+	entry->qcount = 0;
+}
+
 struct arp_cache *arp_cache_update(ipaddr_t ip_addr, eth_addr_t eth_addr)
 {
 	struct arp_cache *entry;
-	eth_addr_t existing_addr;
 
-	if ((entry = arp_cache_get(ip_addr, existing_addr, 0))) {
-		memcpy (entry->eth_addr, eth_addr, sizeof (eth_addr_t));
+	if ((entry = arp_cache_lookup(ip_addr))) {
+		arp_cache_resolve(entry, eth_addr);
 		debug_arp("arp: updating cached entry for %s (%s)\n",
 			in_ntoa(entry->ip_addr), mac_ntoa(entry->eth_addr));
-		entry->valid = 1;
 	} else debug_arp("arp: no cached entry to update for %s\n", in_ntoa(ip_addr));
 
 	return entry;
 }
 
+/*
+ * Add entry for ip_addr, resolved if eth_addr passed, otherwise pending.
+ * A free slot in the bucket is used if possible, otherwise the entry
+ * closest to expiry is replaced, preferring not to replace pending entries.
+ */
 struct arp_cache *arp_cache_add(ipaddr_t ip_addr, eth_addr_t eth_addr)
 {
-	struct arp_cache *entry;
+	struct arp_cache *entry, *victim;
+	int i;
 
-	/* Shift the whole cache */
-	entry = arp_cache + ARP_CACHE_MAX - 1;
-	while (entry > arp_cache) {
-		memcpy (entry, entry - 1, sizeof (struct arp_cache));
-		entry--;
+	if ((entry = arp_cache_lookup(ip_addr)))
+		arp_cache_free(entry);
+	entry = victim = arp_bucket(ip_addr);
+	for (i = 0; i < ARP_CACHE_WAYS; i++, entry++) {
+		if (entry->state == ARP_FREE) {
+			victim = entry;
+			break;
+		}
+		if ((victim->state == ARP_PENDING && entry->state != ARP_PENDING) ||
+		    ((victim->state == ARP_PENDING) == (entry->state == ARP_PENDING) &&
+		     TIME_LT(entry->expires, victim->expires)))
+			victim = entry;
 	}
+	entry = victim;
+	if (entry->state != ARP_FREE)
+		arp_cache_free(entry);
 
-	/* Set the first entry as the more recent */
 	entry->ip_addr = ip_addr;
+	entry->retries = 0;
 	if (eth_addr) {
 		memcpy (entry->eth_addr, eth_addr, sizeof (eth_addr_t));
-		entry->valid = 1;
+		entry->state = ARP_RESOLVED;
+		entry->expires = Now + ARP_TIMEOUT_RESOLVED;
 	} else {
-		entry->valid = 0;	/* no MAC address yet, awaiting ARP reply*/
+		entry->state = ARP_PENDING;	/* no MAC address yet, awaiting ARP reply*/
+		entry->expires = Now + ARP_TIMEOUT_RETRY;
 		memset (entry->eth_addr, 0, sizeof(eth_addr_t));
+		arp_pending++;
+		timer_reduce(&arp_timer, entry->expires);
 	}
-	entry->qpacket = NULL;
-	debug_arp("arp: adding cache entry for %s, valid=%d\n", in_ntoa(ip_addr), entry->valid);
+	debug_arp("arp: adding cache entry for %s, state=%d\n", in_ntoa(ip_addr), entry->state);
 
 	netstats.arpcacheadds++;
 	return entry;
 }
 
+/* copy packet onto pending entry queue, return 0 if queue full or no memory*/
+int arp_cache_queue(struct arp_cache *entry, unsigned char *packet, int len)
+{
+	unsigned char *p;
+
+	if (entry->qcount >= ARP_QUEUE_MAX)
+		return 0;
+	/* leave room for ethernet header before packet*/
+	if (!(p = malloc(len + sizeof(struct ip_ll))))
+		return 0;
+	memcpy(p + sizeof(struct ip_ll), packet, len);
+	entry->qpacket[entry->qcount] = p + sizeof(struct ip_ll);
+	entry->qlen[entry->qcount++] = len;
+	debug_arp("arp: queueing packet len %d\n", len);
+	return 1;
+}
+
+/* ARP timer function, resend requests for pending entries, make unanswered entries negative*/
+static void arp_expire(void *arg)
+{
+	struct arp_cache *entry;
+	ipaddr_t ip_addr;
+
+	for (entry = arp_cache; entry < arp_cache + ARP_CACHE_MAX; entry++) {
+		if (entry->state != ARP_PENDING)
+			continue;
+		if (TIME_LT(Now, entry->expires)) {
+			timer_reduce(&arp_timer, entry->expires);
+			continue;
+		}
+		if (++entry->retries < ARP_RETRY_MAX) {
+			entry->expires = Now + ARP_TIMEOUT_RETRY;
+			timer_reduce(&arp_timer, entry->expires);
+			arp_request(entry->ip_addr);
+			continue;
+		}
+		ip_addr = entry->ip_addr;
+		printf("arp: no reply from %s, dropping %d packets\n",
+			in_ntoa(ip_addr), entry->qcount);
+		arp_cache_free(entry);
+		entry->ip_addr = ip_addr;	/* keep as negative entry*/
+		entry->state = ARP_NEGATIVE;
+		entry->expires = Now + ARP_TIMEOUT_NEGATIVE;
+	}
+}
+
 char *mac_ntoa(eth_addr_t eth_addr)
 {
 	unsigned char *p = (unsigned char *)eth_addr;
@@ -209,7 +327,8 @@ void arp_recvpacket(unsigned char *packet, int size)
 	switch (ntohs(arp->op)) {
 	case ARP_REQUEST:
 		debug_arp("arp: incoming REQUEST\n");
-		entry = arp_cache_get(arp->ip_src, arp->eth_src, ARP_UPDATE); /* possible cache update */
+		/* learn sender address, possible cache update and queue flush*/
+		entry = arp_cache_update(arp->ip_src, arp->eth_src);
 		if (arp->ip_dest == local_ip) {
 			if (!entry)
 				arp_cache_add(arp->ip_src, arp->eth_src);
@@ -220,16 +339,8 @@ void arp_recvpacket(unsigned char *packet, int size)
 
 	case ARP_REPLY:
 		debug_arp("arp: incoming REPLY\n");
-		/* update cache, check for queued packet*/
-		entry = arp_cache_update(arp->ip_src, arp->eth_src);
-		if (entry) {
-			if (entry->qpacket) {
-				debug_arp("arp: sending queued packet\n");
-				eth_sendpacket(entry->qpacket, entry->len, entry->eth_addr);
-				free(entry->qpacket - sizeof(struct ip_ll));
-				entry->qpacket = NULL;
-			}
-		}
+		/* update cache, send any queued packets*/
+		arp_cache_update(arp->ip_src, arp->eth_src);
 		netstats.arprcvreplycnt++;
 		break;
 	}
@@ -2,6 +2,7 @@
 #define ARP_H
 
 #include "ip.h"
+#include "timer.h"
 
 
 struct arp_addr {
@@ -27,14 +28,31 @@ struct arp
          __u32 ip_dest; 	/* IP destination address */
 };
 
+/*
+ * ARP cache entries are kept in a small set-associative table hashed on
+ * the low octet of the IP address, so lookups check at most ARP_CACHE_WAYS
+ * entries. Unresolved entries hold up to ARP_QUEUE_MAX packets which are
+ * sent as soon as the ARP reply arrives.
+ */
+#define ARP_QUEUE_MAX	3	/* max packets queued awaiting ARP reply*/
+
 struct arp_cache {
 	ipaddr_t   ip_addr;	/* IPv4 address */
 	eth_addr_t eth_addr;	/* MAC address */
-	int valid;		/* eth_addr valid flag*/
-	unsigned char *qpacket;	/* queued packet waiting for ARP reply*/
-	int len;		/* queued packet length*/
+	unsigned char state;	/* ARP_FREE, ARP_PENDING, ARP_RESOLVED or ARP_NEGATIVE*/
+	unsigned char retries;	/* ARP requests sent while pending*/
+	timeq_t expires;	/* time of next retry or expiry*/
+	unsigned char qcount;	/* number of queued packets*/
+	unsigned char *qpacket[ARP_QUEUE_MAX];	/* packets waiting for ARP reply*/
+	int qlen[ARP_QUEUE_MAX];		/* queued packet lengths*/
 };
 
+/* arp_cache states*/
+#define ARP_FREE	0	/* unused entry*/
+#define ARP_PENDING	1	/* ARP request sent, awaiting reply*/
+#define ARP_RESOLVED	2	/* eth_addr valid*/
+#define ARP_NEGATIVE	3	/* no reply after ARP_RETRY_MAX requests*/
+
 /* ARP operations */
 #define ARP_REQUEST  1
 #define ARP_REPLY    2
@@ -43,14 +61,25 @@ struct arp_cache {
 #define ARP_VALID	1	/* retrieve valid eth_addr entry only*/
 #define ARP_UPDATE	2	/* if present, update cache with passed eth_addr*/
 
+/* ARP timers, in 1/16 second units*/
+#define ARP_TIMEOUT_RESOLVED	(600<<4)	/* resolved entry lifetime*/
+#define ARP_TIMEOUT_NEGATIVE	(20<<4)		/* negative entry lifetime*/
+#define ARP_TIMEOUT_RETRY	(1<<4)		/* resend ARP request interval*/
+#define ARP_RETRY_MAX		3		/* ARP requests before negative entry*/
+
 /* Local ARP cache */
-#define ARP_CACHE_MAX 5
+#define ARP_CACHE_HASH	8	/* hash buckets, power of two*/
+#define ARP_CACHE_WAYS	2	/* entries per bucket*/
+#define ARP_CACHE_MAX	(ARP_CACHE_HASH * ARP_CACHE_WAYS)
 extern struct arp_cache arp_cache [ARP_CACHE_MAX];
+extern int arp_pending;		/* pending entries, ARP timer running*/
 
 int arp_init (void);
 struct arp_cache *arp_cache_get(ipaddr_t ip_addr, eth_addr_t eth_addr, int flags);
 struct arp_cache *arp_cache_update(ipaddr_t ip_addr, eth_addr_t eth_addr);
 struct arp_cache *arp_cache_add(ipaddr_t ip_addr, eth_addr_t eth_addr);
+struct arp_cache *arp_cache_lookup(ipaddr_t ip_addr);
+int arp_cache_queue(struct arp_cache *entry, unsigned char *packet, int len);
 void arp_recvpacket (unsigned char * packet, int size);
 void arp_request(ipaddr_t ipaddress);
 void arp_gratuitous(void);
@@ -2,7 +2,7 @@
 #define CONFIG_H
 
 /* compile time options*/
-#define CSLIP		0	/* compile in CSLIP support*/
+#define CSLIP		1	/* compile in CSLIP support*/
 
 /* turn these on for ELKS debugging*/
 #define USE_DEBUG_EVENT 1	/* use CTRLP to toggle debug output*/
@@ -16,6 +16,7 @@
 #define DEBUG_ACCEPT	0	/* TCP accept*/
 #define DEBUG_CLOSE	0	/* TCP close ops*/
 #define DEBUG_IP	0
+#define DEBUG_UDP	0
 #define DEBUG_ARP	0
 #define DEBUG_ETH	0
 #define DEBUG_CSLIP	0
@@ -87,6 +88,12 @@ void dprintf(const char *, ...);
 #define debug_ip(...)
 #endif
 
+#if DEBUG_UDP
+#define debug_udp	DPRINTF
+#else
+#define debug_udp(...)
+#endif
+
 #if DEBUG_ARP
 #define debug_arp	DPRINTF
 #else
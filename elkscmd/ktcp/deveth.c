@@ -20,6 +20,7 @@
 #include <limits.h>
 #include <errno.h>
 #include <linuxmt/limits.h>
+#include <linuxmt/netstat.h>
 #include "config.h"
 #include "tcp.h"
 #include "ip.h"
@@ -30,8 +31,20 @@
 
 eth_addr_t eth_local_addr;
 
-static unsigned char sbuf[MAX_PACKET_ETH];
+/* in batch mode a read returns several packets, each preceded by its length */
+#define ETH_RXBUFSIZ	(3 * (2 + MAX_PACKET_ETH))
+
+/* frames sent in one pass of the main loop are queued and sent with one call */
+#define ETH_TXQSIZ	(2 * MAX_PACKET_ETH)
+#define ETH_TXQMAX	8
+
+static unsigned char sbuf[ETH_RXBUFSIZ];
+static unsigned char txq[ETH_TXQSIZ];
+static struct iovec txiov[ETH_TXQMAX];
+static struct eth_writev txv = { 0, txiov };
+static unsigned int txq_len;
 static int devfd;
+static int rxbatch, txbatch;
 
 //static eth_addr_t broad_addr = {255, 255, 255, 255, 255, 255};
 
@@ -52,25 +65,26 @@ int deveth_init(char *fdev)
 
         return -2;
     }
+    /* older drivers or no memory for the receive ring: one packet per read */
+    rxbatch = (ioctl(devfd, IOCTL_ETH_RXBATCH, 1) == 0);
+    txbatch = (ioctl(devfd, IOCTL_ETH_WRITEV, &txv) == 0);
+
     arp_gratuitous();	/* send gratuituous ARP to the net */
 
     return devfd;
 }
 
 
-/*
- *  Called when select in ktcp indicates we have new data waiting
- */
-void eth_process(void)
+static void eth_recvpacket(unsigned char *packet, int len)
 {
   eth_head_t * eth_head;
-  int len = read (devfd, sbuf, MAX_PACKET_ETH);
+
   if (len < (int)sizeof(eth_head_t)) {
-	if (len < 0) printf("ktcp: eth_process error %d (errno %d), discarding packet\n", len, errno); //FIXME
+	netstats.ethdropcnt++;
 	return;
   }
 
-  eth_head = (eth_head_t *) sbuf;
+  eth_head = (eth_head_t *) packet;
 
 #if 0
   /* Filter on MAC addresses in case of promiscuous mode*/
@@ -83,26 +97,68 @@ void eth_process(void)
   switch (eth_head->eth_type) {
   case ETH_TYPE_IPV4:
 	  /* strip link layer */
-	  ip_recvpacket (sbuf + sizeof(eth_head_t), len - sizeof(eth_head_t));
+	  ip_recvpacket (packet + sizeof(eth_head_t), len - sizeof(eth_head_t));
 	  break;
 
   case ETH_TYPE_ARP:
-	  arp_recvpacket (sbuf, len);
+	  arp_recvpacket (packet, len);
+	  break;
+
+  default:
+	  netstats.ethdropcnt++;
 	  break;
   }
   netstats.ethrcvcnt++;
 }
 
+/* get the NIC driver counters, fails if not on ethernet */
+int eth_getstat(struct netif_stat *stat)
+{
+  if (devfd <= 0)
+	return -1;
+  return ioctl(devfd, IOCTL_ETH_GETSTAT, stat);
+}
+
+/*
+ *  Called when select in ktcp indicates we have new data waiting
+ */
+void eth_process(void)
+{
+  unsigned char *p;
+  unsigned int flen, rec;
+  int len = read (devfd, sbuf, rxbatch? ETH_RXBUFSIZ: MAX_PACKET_ETH);
+  if (len < 0) {
+	printf("ktcp: eth_process error %d (errno %d), discarding packet\n", len, errno); //FIXME
+	return;
+  }
+
+  if (!rxbatch) {
+	eth_recvpacket(sbuf, len);
+	return;
+  }
+
+  /* each packet is a length word followed by the packet, padded to even size */
+  for (p = sbuf; len >= 2; p += rec, len -= rec) {
+	flen = *(__u16 *)p;
+	rec = (2 + flen + 1) & ~1;
+	if (rec > (unsigned)len) {	/* truncated by a short read buffer */
+		flen = len - 2;
+		rec = len;
+	}
+	eth_recvpacket(p + 2, flen);
+  }
+}
+
 /*
  * Determine ethernet address for IP packet using ARP request/cache
- * Packet will be sent if address cached, otherwise sent after ARP reply
- * Only one packet will be queued per remote host waiting for ARP reply, others dropped
+ * Packet will be sent if address cached, otherwise queued and sent after ARP reply.
+ * Up to ARP_QUEUE_MAX packets are queued per remote host, others dropped.
+ * Packets to hosts with a negative cache entry are dropped until it expires.
  */
 void eth_route(unsigned char *packet, int len, ipaddr_t ip_addr)
 {
 	struct arp_cache *entry;
 	eth_addr_t eth_addr;
-	unsigned char *p;
 
 	/* try to get cached ethernet address and send packet*/
 	if (arp_cache_get (ip_addr, eth_addr, ARP_VALID)) {
@@ -110,24 +166,24 @@ void eth_route(unsigned char *packet, int len, ipaddr_t ip_addr)
 		return;
 	}
 
-	/* no address in cache, create holding entry, queue packet and send ARP request*/
-	entry = arp_cache_add(ip_addr, NULL);
-	if (entry->qpacket) {
-		/* TCP packet will auto retrans, 2+ ICMP will be lost until ARP reply seen*/
-		printf("eth: DROPPING packet to %s, one already queued awaiting ARP reply\n",
-			in_ntoa(ip_addr));
-		arp_request(ip_addr);		/* resend ARP request*/
+	entry = arp_cache_lookup(ip_addr);
+	if (entry && entry->state == ARP_NEGATIVE) {
+		debug_arp("eth: dropping packet to unreachable %s\n", in_ntoa(ip_addr));
 		return;
 	}
 
-	/* allocate memory and queue packet*/
-	if ((p = malloc(len + sizeof(struct ip_ll)))) {
-		memcpy(p+sizeof(struct ip_ll), packet, len);
-		entry->qpacket = p + sizeof(struct ip_ll);
-		entry->len = len;
-		debug_arp("eth: queueing packet len %d\n", len);
+	/* no address in cache, create holding entry and send ARP request*/
+	if (!entry) {
+		entry = arp_cache_add(ip_addr, NULL);
+		arp_request(ip_addr);
+	}
+
+	/* queue packet, ARP requests are resent by the ARP timer*/
+	if (!arp_cache_queue(entry, packet, len)) {
+		/* TCP packet will auto retrans, ICMP will be lost until ARP reply seen*/
+		printf("eth: DROPPING packet to %s, %d already queued awaiting ARP reply\n",
+			in_ntoa(ip_addr), entry->qcount);
 	}
-	arp_request(ip_addr);
 }
 
 /*
@@ -146,14 +202,33 @@ void eth_sendpacket(unsigned char *packet, int len, eth_addr_t eth_addr)
 	eth_write((unsigned char *)ipll, sizeof(struct ip_ll) + len);
 }
 
-/* raw ethernet packet send*/
+/* raw ethernet packet send, queued until eth_flush if the driver can batch*/
 void eth_write(unsigned char *packet, int len)
 {
 #if DEBUG_ETH
     eth_printhex(packet,len);
 #endif
-    write(devfd, packet, len);
     netstats.ethsndcnt++;
+    if (!txbatch) {
+	write(devfd, packet, len);
+	return;
+    }
+    if (txq_len + len > ETH_TXQSIZ || txv.count == ETH_TXQMAX)
+	eth_flush();
+    memcpy(txq + txq_len, packet, len);
+    txiov[txv.count].iov_base = txq + txq_len;
+    txiov[txv.count++].iov_len = len;
+    txq_len += (len + 1) & ~1;
+}
+
+/* send queued packets*/
+void eth_flush(void)
+{
+    if (txv.count) {
+	ioctl(devfd, IOCTL_ETH_WRITEV, &txv);
+	txv.count = 0;
+	txq_len = 0;
+    }
 }
 
 #if DEBUG_ETH
@@ -36,5 +36,8 @@ void eth_process(void);
 void eth_route(unsigned char *packet, int len, ipaddr_t ip_addr);
 void eth_sendpacket(unsigned char *packet, int len, eth_addr_t eth_addr);
 void eth_write(unsigned char *packet, int len);
+void eth_flush(void);
+struct netif_stat;
+int  eth_getstat(struct netif_stat *stat);
 
 #endif /* !DEVETH_H */
@@ -23,6 +23,7 @@
 #include "tcp.h"
 #include "tcpdev.h"
 #include "icmp.h"
+#include "udp.h"
 #include "slip.h"
 #include "deveth.h"
 #include "arp.h"
@@ -37,53 +38,22 @@ int ip_init(void)
 
 __u16 ip_calc_chksum(char *data, int len)
 {
-    __u32 sum = 0;
-    __u16 *p = (__u16 *) data;
-
-    for (; len > 1 ; len -= 2)
-	sum += *p++;
+    return ~in_chksum(data, len, 0);
+}
 
-    if (len == 1)
-	sum += (__u16)(*(__u8 *)p);
+/*
+ * Incrementally update checksum check for a 16 bit field changed from old to new,
+ * per RFC 1624 equation 3. Values are taken as stored in the packet.
+ */
+__u16 in_chksum_adjust(__u16 check, __u16 old, __u16 new)
+{
+    __u32 sum = (__u16)~check + (__u32)(__u16)~old + new;
 
-    while (sum >> 16)
-	sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
     return ~(__u16)sum;
 }
 
-/*** __u16 ip_calc_chksum(char *data, int len)
-	.text
-	.globl _ip_calc_chksum
-_ip_calc_chksum:
-
-	push	bp
-	mov	bp,sp
-	push	di
-
-	mov	cx, 6[bp]
-	shr	cx, 1
-	shr	cx, 1
-	mov	di, 4[bp]
-	xor	ax, ax
-loop1:
-	adc	ax, [di]
-	inc di
-	inc di
-	adc	ax, [di]
-	inc di
-	inc di
-
-        loop	loop1
-
-	adc	ax, 0
-	not	ax
-
-	pop di
-	pop bp
-
-	ret
-***/
-
 static void ip_print(struct iphdr_s *head, int size)
 {
 #if DEBUG_IP
@@ -149,6 +119,14 @@ void ip_recvpacket(unsigned char *packet, int size)
 	tcp_process(iphdr);
 	netstats.tcprcvcnt++;
 	break;
+
+    case PROTO_UDP:
+	udp_process(iphdr);
+	break;
+
+    default:
+	netstats.ipdropcnt++;
+	break;
     }
     netstats.iprcvcnt++;
 }
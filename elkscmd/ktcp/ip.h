@@ -51,6 +51,10 @@ extern unsigned int MTU;
 
 int ip_init(void);
 __u16 ip_calc_chksum(char *data, int len);
+__u16 in_chksum_adjust(__u16 check, __u16 old, __u16 new);
+
+/* cksum.S */
+__u16 in_chksum(void *data, unsigned int len, __u16 sum);
 void ip_recvpacket(unsigned char *packet, int size);
 void ip_sendpacket(unsigned char *packet, int len, struct addr_pair *apair, struct tcpcb_s *cb);
 void ip_route(unsigned char *packet, int len, struct addr_pair *apair);
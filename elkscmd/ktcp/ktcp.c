@@ -20,6 +20,7 @@
 #include <string.h>
 #include <getopt.h>
 #include <signal.h>
+#include <sched.h>
 #include <errno.h>
 #include <arpa/inet.h>
 #include "slip.h"
@@ -33,6 +34,7 @@
 #include "netconf.h"
 #include "deveth.h"
 #include "arp.h"
+#include "udp.h"
 
 ipaddr_t local_ip;
 ipaddr_t gateway_ip;
@@ -52,17 +54,23 @@ int dflag;
 unsigned int MTU;
 static int intfd;	/* interface fd*/
 
-// rename		timer			function called when active
+// counter		timer			function called when active
 //			----------------	-------------------------------------
-// tcp_timeruse		timer_retrans		tcp_retrans
-// cbs_in_time_wait	timer_time_wait		tcp_expire_timeouts
-// cbs_in_user_wait	timer_close_wait	tcp_expire_timeouts
+// tcp_timeruse		retrans n->timer	tcp_retrans_timeout
+// cbs_in_time_wait	expire_timer		tcpcb_expire_timeouts
+// cbs_in_user_wait	expire_timer		tcpcb_expire_timeouts
 // tcpcb_need_push				tcpcb_push_data -> notify_data_avail
-
-int tcp_timeruse;		/* retrans timer active, call tcp_retrans */
-int cbs_in_time_wait;		/* time_wait timer active, call tcp_expire_timeouts */
-int cbs_in_user_timeout;	/* fin_wait/closing/last_ack active, call " */
+// cbs_delayed_ack	delack_timer		tcpcb_send_delayed_acks
+// arp_pending		arp_timer		arp_expire
+//
+// Timers are kept in a queue sorted by expiry, the select timeout is the
+// time until the first one is due and timer_run calls only those due.
+
+int tcp_timeruse;		/* retrans or time_wait active, call tcp_retrans_expire */
+int cbs_in_time_wait;		/* CBs in time_wait */
+int cbs_in_user_timeout;	/* CBs in fin_wait/closing/last_ack */
 int tcpcb_need_push;		/* push required, tcpcb_push_data/call notify_data_avail */
+int cbs_delayed_ack;		/* delayed ACKs pending */
 int tcp_retrans_memory;		/* total retransmit memory in use*/
 
 void ktcp_run(void)
@@ -73,21 +81,17 @@ void ktcp_run(void)
     int loopagain = 0;
 
     while (1) {
-	if (tcp_timeruse > 0 || tcpcb_need_push > 0 || loopagain ||
-	    cbs_in_time_wait > 0 || cbs_in_user_timeout > 0) {
-
-	    //printf("tcp: timer %d needpush %d timewait %d usertime %d\n", tcp_timeruse,
-		//tcpcb_need_push, cbs_in_time_wait, cbs_in_user_timeout);
-
-	    /* don't wait long if data needs pushing to tcpdev */
-	    if (tcpcb_need_push || loopagain) {
-		timeint.tv_sec  = 0;
-		timeint.tv_usec = tcpcb_need_push? 1000: 0;	/* 1msec */
-	    } else {
-		timeint.tv_sec  = 1;
-		timeint.tv_usec = 0;
-	    }
+	/* send packets queued during the last pass*/
+	if (linkprotocol == LINK_ETHER)
+	    eth_flush();
+
+	/* don't wait long if data needs pushing to tcpdev */
+	if (tcpcb_need_push || loopagain) {
+	    timeint.tv_sec  = 0;
+	    timeint.tv_usec = tcpcb_need_push? 1000: 0;	/* 1msec */
 	    tv = &timeint;
+	} else if (timer_next(&timeint)) {
+	    tv = &timeint;	/* sleep until the next timer is due */
 	} else {
 	    tv = NULL;		/* no timeout if no timers active or push needed */
 	}
@@ -105,13 +109,6 @@ void ktcp_run(void)
 
 	Now = timer_get_time();
 
-	/* expire timeouts*/
-	if (cbs_in_time_wait > 0 || cbs_in_user_timeout > 0) {
-	    debug_tcp("tcp: time_wait %d user_timeout %d\n",
-		cbs_in_time_wait, cbs_in_user_timeout);
-	    tcpcb_expire_timeouts();
-	}
-
 	/* always push data*/
 	//if (tcpcb_need_push > 0)
 	    tcpcb_push_data();
@@ -132,7 +129,7 @@ void ktcp_run(void)
 		loopagain = 1;
 	}
 
-	/* check for expired retrans packets and free them*/
+	/* check retransmit memory use, acked packets already freed*/
 	if (tcp_timeruse > 0)
 		tcp_retrans_expire();
 
@@ -140,9 +137,8 @@ void ktcp_run(void)
 	if (loopagain)
 		continue;
 
-	/* check for retransmit packets required*/
-	if (tcp_timeruse > 0)
-		tcp_retrans_retransmit();
+	/* retransmits, TIME_WAIT and close timeouts, delayed ACKs and ARP retries*/
+	timer_run();
 
 	tcpcb_printall();
     }
@@ -284,8 +280,12 @@ int main(int argc,char **argv)
     ip_init();
     icmp_init();
     tcp_init();
+    udp_init();
     netconf_init();
 
+    /* run packets as soon as the driver wakes us, ahead of CPU-bound tasks */
+    sched_setscheduler(0, SCHED_FIFO, NULL);
+
     ktcp_run();
 
     return 0;
@@ -10,6 +10,7 @@
  */
 
 #include <arpa/inet.h>
+#include <linuxmt/netstat.h>
 #include "config.h"
 #include "tcp.h"
 #include "tcp_cb.h"
@@ -37,6 +38,7 @@ void netconf_send(struct tcpcb_s *cb)
 {
     struct general_stats_s gstats;
     struct cb_stats_s cbstats;
+    struct netif_stat nic;
     struct tcpcb_s *ncb;
 
     switch (sreq.type) {
@@ -50,16 +52,32 @@ void netconf_send(struct tcpcb_s *cb)
 	if (ncb) {
 	    cbstats.valid = 1;
 	    cbstats.state = ncb->state;
-	    cbstats.rtt = ncb->rtt * 1000 / 16;
+	    cbstats.rtt = (ncb->srtt >> 3) * 1000 / 16;
+	    cbstats.rttvar = (ncb->rttvar >> 2) * 1000 / 16;
+	    cbstats.rto = ncb->rto * 1000 / 16;
 	    cbstats.remaddr = ncb->remaddr;
 	    cbstats.remport = ncb->remport;
 	    cbstats.localport = ncb->localport;
-		cbstats.time_wait_exp = ncb->time_wait_exp;
+	    cbstats.time_wait_exp = ncb->time_wait_exp;
+	    cbstats.state_secs = (Now - ncb->state_time) >> 4;
+	    cbstats.bytes_in = ncb->bytes_in;
+	    cbstats.bytes_out = ncb->bytes_out;
+	    cbstats.retrans = ncb->retrans;
+	    cbstats.unacked = ncb->send_nxt - ncb->send_una;
+	    cbstats.snd_wnd = ncb->rcv_wnd;
+	    cbstats.rcv_wnd = CB_BUF_SPACE(ncb);
 	} else
 	    cbstats.valid = 0;
 	tcpcb_buf_write(cb, (unsigned char *)&cbstats, sizeof(cbstats));
 	break;
     case NS_NETSTATS:
+	netstats.nicvalid = (eth_getstat(&nic) == 0);
+	if (netstats.nicvalid) {
+	    netstats.nicrxerrs = nic.rx_errors;
+	    netstats.nicrqerrs = nic.rq_errors;
+	    netstats.nictxerrs = nic.tx_errors;
+	    netstats.nicoflows = nic.oflow_errors;
+	}
 	tcpcb_buf_write(cb, (unsigned char *)&netstats, sizeof(netstats));
 	break;
     case NS_ARP:
@@ -12,10 +12,19 @@ struct cb_stats_s {
 	__u32	remaddr;
 	__u32	time_wait_exp;
 	__u16	rtt;		/* Round trip time in ms */
+	__u16	rttvar;		/* RTT mean deviation in ms */
+	__u16	rto;		/* retransmit timeout in ms */
 	__u16	remport;
 	__u16	localport;
 	__u8	valid;
 	__u8	state;
+	__u32	state_secs;	/* seconds in current state */
+	__u32	bytes_in;	/* data bytes received */
+	__u32	bytes_out;	/* data bytes sent, not counting resends */
+	__u16	retrans;	/* segments resent */
+	__u16	unacked;	/* bytes sent and not yet acknowledged */
+	__u16	snd_wnd;	/* window last advertised by the peer */
+	__u16	rcv_wnd;	/* receive buffer space we advertise */
 };
 
 struct stat_request_s {
@@ -37,8 +46,15 @@ struct packet_stats_s {
 	__u32	tcpdropcnt;	/* packet refused or dropped for no space*/
 	__u32	tcpretranscnt;
 
+	__u32	udprcvcnt;
+	__u32	udpsndcnt;
+	__u32	udpdropcnt;	/* bad, unbound port or queue full*/
+
+	__u32	ipdropcnt;	/* unknown protocol */
+
 	__u32	ethsndcnt;
 	__u32	ethrcvcnt;
+	__u32	ethdropcnt;	/* runt or unknown type */
 	__u32	arprcvreplycnt;
 	__u32	arprcvreqcnt;
 	__u32	arpsndreplycnt;
@@ -47,6 +63,13 @@ struct packet_stats_s {
 
 	__u32	slipsndcnt;
 	__u32	sliprcvcnt;
+
+	/* NIC driver counters from IOCTL_ETH_GETSTAT, filled in for NS_NETSTATS */
+	__u16	nicvalid;	/* zero if not on ethernet */
+	__u16	nicrxerrs;	/* receive errors flagged by NIC */
+	__u16	nicrqerrs;	/* receive queue errors */
+	__u16	nictxerrs;	/* transmit errors flagged by NIC */
+	__u16	nicoflows;	/* receive ring overflows */
 };
 
 extern struct packet_stats_s netstats;
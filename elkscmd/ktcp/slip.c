@@ -15,8 +15,10 @@
 #include <sys/ioctl.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <termios.h>
+#include <sys/uio.h>
 
 #include "ip.h"
 #include "tcp.h"
@@ -34,10 +36,19 @@
 #define ESC_END		0334	/* 0xDC*/
 #define ESC_ESC		0335	/* 0xDD*/
 
-static unsigned char 	sbuf[SERIAL_BUFFER_SIZE];
+/*
+ * Serial data is read straight into packet after the packet being received
+ * and decoded in place, escapes only ever shortening it. The first 128 bytes
+ * are left free for CSLIP to rebuild a compressed header in front.
+ */
 static unsigned char	lastchar;
+static unsigned char	toolong;	/* discarding rest of an oversize frame*/
 static unsigned char 	packet[SLIP_MTU + 128];
 static unsigned int	packpos;
+
+static unsigned char	end_char = END;
+static unsigned char	esc_end[2] = { ESC, ESC_END };
+static unsigned char	esc_esc[2] = { ESC, ESC_ESC };
 static int devfd;
 
 static speed_t convert_baudrate(speed_t baudrate)
@@ -90,9 +101,9 @@ int slip_init(char *fdev, speed_t baudrate)
     struct termios tios;
 
 #if CSLIP
-    if (linkprotocol == LINK_CSLIP)
-	if (ip_vjhc_init() < 0)
-	    return -1;
+    /* cslip compresses from the start, slip once the peer is seen to*/
+    if (ip_vjhc_init(linkprotocol == LINK_CSLIP) < 0)
+	return -1;
 #endif
     if (baudrate)
 	baud = convert_baudrate(baudrate);
@@ -140,6 +151,10 @@ void cslip_decompress(__u8 **packet, size_t *len){
 
     c = *(*packet + 128) & 0xf0;
     if ( c != TYPE_IP){
+        if (!ip_snd_vjhc && (c & 0x80 || c == TYPE_UNCOMPRESSED_TCP)) {
+            if (ip_vjhc_snd_init() == 0)
+                printf("ktcp: peer uses header compression, enabling cslip\n");
+        }
         if (c & 0x80){
             c = TYPE_COMPRESSED_TCP;
             ip_vjhc_arr_compr(&p);
@@ -162,80 +177,86 @@ void cslip_decompress(__u8 **packet, size_t *len){
 }
 #endif
 
+/* pass received frame in packet up to IP*/
+static void slip_recvframe(void)
+{
+    size_t p_size;
+    unsigned char *p;
+
+    p_size = packpos - 128;
+#if CSLIP
+    p = packet;
+    cslip_decompress(&p, &p_size);
+#else
+    p = packet + 128;
+#endif
+    if (p_size > 0) {
+	ip_recvpacket(p, p_size);
+	netstats.sliprcvcnt++;
+    }
+}
+
 /*
  * slip_process()
  *  Called when we have new data waiting at the serial port
  */
 void slip_process(void)
 {
-    size_t p_size;
-    unsigned char *p;
-    int i, len;
+    unsigned char *r, *end;
+    unsigned char c;
+    int len;
 
-    len = read(devfd, sbuf, SERIAL_BUFFER_SIZE);
+    if (packpos >= sizeof(packet)) {	/* frame too long, drop it*/
+	toolong = 1;
+	packpos = 128;
+    }
+    len = sizeof(packet) - packpos;
+    if (len > SERIAL_BUFFER_SIZE)
+	len = SERIAL_BUFFER_SIZE;
+    len = read(devfd, &packet[packpos], len);
     if (len <= 0)
 	return;
 #if DEBUG_CSLIP
     DPRINTF("[%d]", len);
     DPRINTF("{");
-    for (i=0; i<len; i++)
-	DPRINTF("%2x,", sbuf[i]);
+    for (r = &packet[packpos]; r < &packet[packpos + len]; r++)
+	DPRINTF("%2x,", *r);
     DPRINTF("}");
 #endif
-	for (i=0; i < len ; i++) {
-	    if (lastchar == ESC) {
-		switch (sbuf[i]) {
-
-		    case ESC_END:
-			packet[packpos++] = END;
-			break;
-
-		    case ESC_ESC:
-			packet[packpos++] = ESC;
-			break;
-
-		    default:
-
-			/* Protocol error ??! */
-			packet[packpos++] = sbuf[i];
-		}
-	    } else {
-		switch (sbuf[i]) {
-
-		    case ESC:
-			break;
-
-		    case END:
-			if (packpos == 128)
-			    break;
-
-			p_size = packpos - 128;
-#if CSLIP
-			if (linkprotocol == LINK_CSLIP) {
-			    p = packet;
-		            cslip_decompress(&p, &p_size);
-			} else
-#endif
-			    p = packet + 128;
-		        if (p_size > 0) {
-			    ip_recvpacket(p, p_size);
-			    netstats.sliprcvcnt++;
-			}
-
-			/* Reset */
-			packpos = 128;
-			lastchar = 0;
-			continue;
-
-		    default:
-			/* drop characters over SLIP_MTU*/
-			if (packpos < sizeof(packet))
-			    packet[packpos++] = sbuf[i];
-		}
-	    }
-	    lastchar = sbuf[i];
+    r = &packet[packpos];
+    end = r + len;
+    while (r < end) {
+	c = *r++;
+	if (lastchar == ESC) {
+	    lastchar = c;
+	    if (c == ESC_END)
+		c = END;
+	    else if (c == ESC_ESC)
+		c = ESC;
+	    /* else protocol error, keep the byte*/
+	    packet[packpos++] = c;
+	    continue;
 	}
+	lastchar = c;
+	if (c == ESC)
+	    continue;
+	if (c != END) {
+	    packet[packpos++] = c;
+	    continue;
+	}
+	if (packpos > 128 && !toolong)
+	    slip_recvframe();
+	toolong = 0;
+	lastchar = 0;
+
+	/* start the next frame with any bytes left from this read*/
+	len = end - r;
+	memmove(&packet[128], r, len);
+	r = &packet[128];
+	end = r + len;
+	packpos = 128;
     }
+}
 
 #if CSLIP
 void cslip_compress(__u8 **packet, int *len)
@@ -261,38 +282,48 @@ void cslip_compress(__u8 **packet, int *len)
 }
 #endif
 
+/* send packet SLIP framed, escapes are written between runs of the packet data*/
 void slip_send(unsigned char *packet, int len)
 {
-    unsigned char buf[SLIP_MTU+2];
+    struct iovec iov[UIO_MAXIOV];
     unsigned char *p = packet;
-    unsigned char *q = buf;
+    unsigned char *run, *end;
+    int n = 0;
 
 #if CSLIP
-    if (linkprotocol == LINK_CSLIP)
+    if (ip_snd_vjhc)
 	cslip_compress(&p, &len);
 #endif
     debug_cslip("slip: send %d\n", len);
 
-    *q++ = END;
-    while (len--) {
-	switch (*p) {
-	case END:
-	    *q++ = ESC;
-	    *q++ = ESC_END;
-	    break;
-	case ESC:
-	    *q++ = ESC;
-	    *q++ = ESC_ESC;
-	    break;
-	default:
-	    *q++ = *p;
-	    break;
+    run = p;
+    iov[n].iov_base = &end_char;
+    iov[n++].iov_len = 1;
+    for (end = p + len; p < end; p++) {
+	if (*p != END && *p != ESC)
+	    continue;
+	if (n > UIO_MAXIOV - 3) {	/* room for run, escape and final END*/
+	    writev(devfd, iov, n);
+	    n = 0;
+	}
+	if (p > run) {
+	    iov[n].iov_base = run;
+	    iov[n++].iov_len = p - run;
 	}
-	p++;
-	if (q - buf >= sizeof(buf) - 2)
-	    write(devfd, buf, q - buf);
+	iov[n].iov_base = (*p == END)? esc_end: esc_esc;
+	iov[n++].iov_len = 2;
+	run = p + 1;
+    }
+    if (n > UIO_MAXIOV - 2) {
+	writev(devfd, iov, n);
+	n = 0;
+    }
+    if (p > run) {
+	iov[n].iov_base = run;
+	iov[n++].iov_len = p - run;
     }
-    *q++ = END;
-    write(devfd, buf, q - buf);
+    iov[n].iov_base = &end_char;
+    iov[n++].iov_len = 1;
+    writev(devfd, iov, n);
     netstats.slipsndcnt++;
 }
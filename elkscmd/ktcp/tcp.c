@@ -101,8 +101,26 @@ void tcp_reset_connection(struct tcpcb_s *cb)
     tcpcb_remove_cb(cb);	/* deallocate*/
 }
 
+void tcp_send_data(struct tcpcb_s *cb, __u8 *data, int len)
+{
+    cb->flags = TF_PSH|TF_ACK;
+    cb->datalen = len;
+    cb->data = data;
+    tcp_output(cb);
+}
+
+/* send data coalesced by Nagle as one segment*/
+void tcp_send_pending(struct tcpcb_s *cb)
+{
+    if (cb->snd_len) {
+	tcp_send_data(cb, cb->snd_buf, cb->snd_len);
+	cb->snd_len = 0;
+    }
+}
+
 void tcp_send_fin(struct tcpcb_s *cb)
 {
+    tcp_send_pending(cb);
     cb->flags = TF_FIN|TF_ACK;
     cb->datalen = 0;
     tcp_output(cb);
@@ -123,7 +141,7 @@ void tcp_connect(struct tcpcb_s *cb)
     cb->send_nxt = cb->iss;
     cb->send_una = cb->iss;
 
-    cb->state = TS_SYN_SENT;
+    TCP_SETSTATE(cb, TS_SYN_SENT);
     cb->flags = TF_SYN;
 
     cb->datalen = 0;
@@ -160,7 +178,8 @@ static void tcp_syn_sent(struct iptcp_s *iptcp, struct tcpcb_s *cb)
 
 	cb->send_nxt++;
 	cb->send_una++;
-	cb->state = TS_ESTABLISHED;
+	tcp_retrans_ack(cb);		/* SYN acked*/
+	TCP_SETSTATE(cb, TS_ESTABLISHED);
 	debug_tcp("TS_ESTABLISHED\n");
 
 	tcp_send_ack(cb);
@@ -201,6 +220,7 @@ static void tcp_listen(struct iptcp_s *iptcp, struct tcpcb_s *lcb)
 
     cb->remaddr = iptcp->iph->saddr; /* sender's ip address*/
     cb->remport = ntohs(h->sport);   /* sender's port*/
+    tcpcb_rehash(n);
     cb->irs = cb->seg_seq;           /* sender's sequence number*/
     cb->rcv_nxt = cb->irs + 1;       /* ktcp's acknum */
     cb->rcv_wnd = ntohs(h->window);
@@ -208,7 +228,7 @@ static void tcp_listen(struct iptcp_s *iptcp, struct tcpcb_s *lcb)
     cb->iss = choose_seq();	/* our arbitrary sequence number*/
     cb->send_nxt = cb->iss;
 
-    cb->state = TS_SYN_RECEIVED;
+    TCP_SETSTATE(cb, TS_SYN_RECEIVED);
     cb->flags = TF_SYN|TF_ACK;
 
     cb->datalen = 0;
@@ -229,11 +249,13 @@ static void tcp_established(struct iptcp_s *iptcp, struct tcpcb_s *cb)
 {
     struct tcphdr_s *h;
     __u32 acknum;
-    __u16 datasize;
+    __u16 datasize, oldwnd;
     __u8 *data;
+    int acked = 0;
 
     h = iptcp->tcph;
 
+    oldwnd = cb->rcv_wnd;
     cb->rcv_wnd = ntohs(h->window);
 
     if (h->flags & TF_RST) {
@@ -276,6 +298,7 @@ static void tcp_established(struct iptcp_s *iptcp, struct tcpcb_s *cb)
 	}
 
 	tcpcb_buf_write(cb, data, datasize);
+	cb->bytes_in += datasize;
 
 	/* always push data for now*/
 	if (1 /*|| (h->flags & TF_PSH) || CB_BUF_SPACE(cb) <= PUSH_THRESHOLD*/) {
@@ -287,15 +310,32 @@ static void tcp_established(struct iptcp_s *iptcp, struct tcpcb_s *cb)
 
     if (h->flags & TF_ACK) {		/* update unacked*/
 	acknum = ntohl(h->acknum);
-	if (SEQ_LT(cb->send_una, acknum))
+	if (SEQ_LT(cb->send_una, acknum)) {
 	    cb->send_una = acknum;
+	    cb->dupacks = 0;
+	    acked = 1;
+	    tcp_retrans_ack(cb);	/* free all segments covered by cumulative ACK*/
+	    if (cb->send_nxt == cb->send_una)
+		tcp_send_pending(cb);	/* Nagle: all data acked, send held data*/
+	} else if (acknum == cb->send_una && cb->send_nxt != cb->send_una &&
+		   datasize == 0 && cb->rcv_wnd == oldwnd && !(h->flags & (TF_SYN|TF_FIN))) {
+	    /* duplicate ACK, peer is missing the segment at send_una*/
+	    if (++cb->dupacks == TCP_DUPACK_THRESH)
+		tcp_retrans_fast(cb);
+	}
+    }
+
+    /* wake a kernel write refused for lack of send window*/
+    if (cb->send_blocked && (acked || cb->rcv_wnd != oldwnd)) {
+	cb->send_blocked = 0;
+	notify_sock(cb->sock, TDT_WINDOW, 0);
     }
 
     if (h->flags & TF_FIN) {
 	cb->rcv_nxt++;
 	debug_close("tcp[%p] packet in established, fin: 1, data: %d, setting state to CLOSE_WAIT\n", cb->sock, datasize);
 
-	cb->state = TS_CLOSE_WAIT;
+	TCP_SETSTATE(cb, TS_CLOSE_WAIT);
 	cb->time_wait_exp = Now;	/* used for debug output only*/
 	debug_tcp("tcp: got FIN with data %d buffer %d\n", datasize, cb->buf_used);
 	if (cb->bytes_to_push <= 0)
@@ -306,6 +346,18 @@ static void tcp_established(struct iptcp_s *iptcp, struct tcpcb_s *cb)
 	return; /* ACK with no data received - so don't answer*/
 
     cb->rcv_nxt += datasize;
+
+    /*
+     * Delay the ACK for a lone data segment, so it can be piggybacked on
+     * reply data from the application; tcp_output clears any pending delay.
+     */
+    if (datasize && !(h->flags & (TF_SYN|TF_FIN)) && ++cb->delack < TCP_DELACK_SEGS) {
+	debug_window("tcp: delay ACK seq %ld len %d\n", cb->rcv_nxt - cb->irs, datasize);
+	cb->delack_exp = Now + TCP_DELACK_TIME;
+	cbs_delayed_ack++;
+	tcpcb_schedule_delack(cb->delack_exp);
+	return;
+    }
     debug_window("tcp: ACK seq %ld len %d\n", cb->rcv_nxt - cb->irs, datasize);
     tcp_send_ack(cb);
 }
@@ -315,11 +367,11 @@ static void tcp_synrecv(struct iptcp_s *iptcp, struct tcpcb_s *cb)
     struct tcphdr_s *h = iptcp->tcph;
 
     if (h->flags & TF_RST)
-	cb->state = TS_LISTEN;		/* FIXME: not valid, should dealloc extra CB*/
+	TCP_SETSTATE(cb, TS_LISTEN);		/* FIXME: not valid, should dealloc extra CB*/
     else if ((h->flags & TF_ACK) == 0)
 	debug_tcp("tcp: NO ACK IN SYNRECV\n");
     else {
-	cb->state = TS_ESTABLISHED;
+	TCP_SETSTATE(cb, TS_ESTABLISHED);
 	debug_tcp("TS_ESTABLISHED\n");
 	tcpdev_notify_accept(cb);
 	tcp_established(iptcp, cb);
@@ -342,7 +394,7 @@ static void tcp_fin_wait_1(struct iptcp_s *iptcp, struct tcpcb_s *cb)
 	iptcp->tcph->flags &= ~TF_FIN;
 	debug_close("tcp[%p] setting state to CLOSING\n", cb->sock);
 
-	cb->state = TS_CLOSING; 	/* cbs_in_user_timeout stays unchanged */
+	TCP_SETSTATE(cb, TS_CLOSING); 	/* cbs_in_user_timeout stays unchanged */
 	cb->time_wait_exp = Now;
 	needack = 1;
     }
@@ -363,7 +415,7 @@ static void tcp_fin_wait_1(struct iptcp_s *iptcp, struct tcpcb_s *cb)
 	} else {
 	    debug_close("tcp[%p] set state CLOSED\n", cb->sock);
 
-	    cb->state = TS_FIN_WAIT_2;	/* cbs_in_user_timeout stays unchanged */
+	    TCP_SETSTATE(cb, TS_FIN_WAIT_2);	/* cbs_in_user_timeout stays unchanged */
 	}
 	cb->time_wait_exp = Now;
     }
@@ -440,7 +492,7 @@ static void tcp_last_ack(struct iptcp_s *iptcp, struct tcpcb_s *cb)
 	cbs_in_user_timeout--;
 	debug_close("tcp[%p] set state CLOSED\n", cb->sock);
 
-	cb->state = TS_CLOSED;
+	TCP_SETSTATE(cb, TS_CLOSED);
 	tcpcb_remove_cb(cb); 	/* deallocate*/
     }
 }
@@ -479,11 +531,12 @@ void tcp_process(struct iphdr_s *iph)
 	cbnode = tcpcb_new(1);
 	if (cbnode) {
 	    __u32 seqno = ntohl(tcph->seqnum);
-	    cbnode->tcpcb.state = TS_CLOSED;
+	    TCP_SETSTATE(&cbnode->tcpcb, TS_CLOSED);
 	    cbnode->tcpcb.localaddr = iph->daddr;
 	    cbnode->tcpcb.localport = ntohs(tcph->dport);
 	    cbnode->tcpcb.remaddr = iph->saddr;
 	    cbnode->tcpcb.remport = ntohs(tcph->sport);
+	    tcpcb_rehash(cbnode);
 	    if (tcph->flags & TF_ACK) {
 		cbnode->tcpcb.flags = TF_RST;
 		cbnode->tcpcb.send_nxt = ntohl(tcph->acknum);
@@ -27,14 +27,19 @@
  * default will be (ETH_MTU - IP_HDRSIZ) * 3 = (1500-40) * 3 = 4380
  */
 #define CB_NORMAL_BUFSIZ	4380	/* normal input buffer size*/
+#define CB_MAX_BUFSIZ		8192	/* max input buffer size settable by SO_RCVBUF*/
 #define USE_SWS			0	/* =1 to use silly window algorithm */
 
-/* max outstanding send window size*/
-#define TCP_SEND_WINDOW_MAX	1024	/* should be less than TCP_RETRANS_MAXMEM*/
+/* max outstanding send window size, room for several segments in flight*/
+#define TCP_SEND_WINDOW_MAX	3072	/* should be less than TCP_RETRANS_MAXMEM*/
 
 /* threshold to wait before pushing data to application (turned off for now) */
 //#define PUSH_THRESHOLD	512
 
+/* delayed ACK: ACK every second data segment, or after TCP_DELACK_TIME*/
+#define TCP_DELACK_SEGS		2
+#define TCP_DELACK_TIME		3	/* 3/16 sec, below the 200ms of most TCPs*/
+
 /* timeout values in 1/16 seconds, or (seconds << 4). Half second = 8*/
 #define TIMEOUT_ENTER_WAIT	(4<<4)	/* TIME_WAIT state (was 30, then 10)*/
 #define TIMEOUT_CLOSE_WAIT	(10<<4)	/* CLOSING/LAST_ACK/FIN_WAIT states (was 240)*/
@@ -44,8 +49,8 @@
 #define TCP_RETRANS_MINWAIT_ETH	4	/* min retrans timeout for ethernet (1/4 sec)*/
 
 /* retransmit settings*/
-#define TCP_RTT_ALPHA			90
-#define TCP_RETRANS_MAXMEM		4096	/* max retransmit total memory*/
+#define TCP_RETRANS_MAXMEM		8192	/* max retransmit total memory*/
+#define TCP_DUPACK_THRESH		3	/* duplicate ACKs before fast retransmit*/
 #define TCP_RETRANS_MAXTRIES		6	/* max # retransmits (~12 secs total)*/
 
 #define SEQ_LT(a,b)	((long)((a)-(b)) < 0)
@@ -68,7 +73,8 @@
 #define TCP_SETHDRSIZE(c,s)	( (c)->data_off = (s) << 2 )
 
 #define ENTER_TIME_WAIT(cb)	{ (cb)->time_wait_exp = Now + TIMEOUT_ENTER_WAIT; \
-				  (cb)->state = TS_TIME_WAIT; \
+				  TCP_SETSTATE(cb, TS_TIME_WAIT); \
+				  tcpcb_schedule_expire((cb)->time_wait_exp + 1); \
 				  tcp_timeruse++; \
 				  cbs_in_time_wait++; }
 
@@ -108,6 +114,9 @@ struct iptcp_s {
 #define	TS_LAST_ACK	9
 #define	TS_TIME_WAIT	10
 
+/* change connection state, noting the time for netstat*/
+#define TCP_SETSTATE(cb,s)	( (cb)->state = (s), (cb)->state_time = Now )
+
 #define CB_BUF_SPACE(x)	((x)->buf_size - (x)->buf_used)
 
 struct tcpcb_s {
@@ -121,7 +130,9 @@ struct tcpcb_s {
 
 	__u8	state;
 	__u8	unaccepted;		/* boolean */
-	timeq_t	rtt;			/* in 1/16 secs*/
+	timeq_t	srtt;			/* smoothed RTT << 3, in 1/16 secs*/
+	timeq_t	rttvar;			/* RTT mean deviation << 2*/
+	timeq_t	rto;			/* current retransmit timeout*/
 
 	__u32	time_wait_exp;
 	//__u16	wait_data;
@@ -131,10 +142,19 @@ struct tcpcb_s {
 	__u32	send_una;
 	__u32	send_nxt;
 	//__u16	send_wnd;
+	__u8	dupacks;		/* duplicate ACKs received for send_una*/
+	__u8	send_blocked;		/* write refused, notify kernel when window opens*/
+	__u8	nodelay;		/* TCP_NODELAY, no Nagle coalescing*/
+	__u16	snd_len;		/* unsent data held back by Nagle*/
+	__u8	*snd_buf;		/* MSS sized, allocated on first use*/
+	struct tcp_retrans_list_s *retrans_head;	/* unacked segments, in seq order*/
+	struct tcp_retrans_list_s *retrans_tail;
 	__u32	iss;
 
 	__u32	rcv_nxt;
 	__u16	rcv_wnd;
+	__u8	delack;			/* data segments received and not yet ACKed*/
+	timeq_t	delack_exp;		/* time delayed ACK must be sent*/
 	__u32	irs;
 
 	__u32	seg_seq;
@@ -148,7 +168,12 @@ struct tcpcb_s {
 	__u16	buf_tail;
 	__u16	buf_used;		/* # valid bytes in buffer */
 	__u16	buf_size;		/* total buffer size */
-	__u8	buf_base[];
+	__u8	*buf_base;		/* input buffer, resizable by SO_RCVBUF */
+
+	timeq_t	state_time;		/* time state was entered */
+	__u32	bytes_in;		/* data bytes received in sequence */
+	__u32	bytes_out;		/* data bytes sent, not counting resends */
+	__u16	retrans;		/* segments resent */
 };
 
 /* TCP options*/
@@ -158,20 +183,32 @@ struct tcpcb_s {
 
 #define TCP_OPT_MSS_LEN		4	/* total MSS option length*/
 
+/*
+ * Control blocks are indexed for packet demultiplexing: connected CBs by
+ * (remote addr, local port, remote port), and CBs without a remote port
+ * (bound or listening) by local port in a separate listener index.
+ */
+#define CB_HASH_SIZE		16	/* buckets in each index, power of two */
+#define CB_HASH_NONE		0xFF	/* CB not hashed */
+
 struct	tcpcb_list_s {
 	struct tcpcb_list_s	*prev;
 	struct tcpcb_list_s	*next;
+	struct tcpcb_list_s	*hnext;	/* hash chain */
+	unsigned char		hash;	/* hash bucket or CB_HASH_NONE */
 	struct tcpcb_s		tcpcb;	/* must be last */
 };
 
 struct	tcp_retrans_list_s {
 	struct tcp_retrans_list_s	*prev;
 	struct tcp_retrans_list_s	*next;
+	struct tcp_retrans_list_s	*cbnext;	/* next in cb retrans_head queue*/
 
 	int				retrans_num;
 	timeq_t 			rto;
 	timeq_t 			next_retrans;
 	timeq_t 			first_trans;
+	struct timer_s			timer;		/* expires at next_retrans*/
 
 	struct tcpcb_s			*cb;
 	struct addr_pair		apair;
@@ -180,10 +217,11 @@ struct	tcp_retrans_list_s {
 
 };
 
-extern int tcp_timeruse;	/* retrans timer active, call tcp_retrans */
+extern int tcp_timeruse;	/* retrans or time_wait active, call tcp_retrans_expire */
 extern int cbs_in_time_wait;	/* time_wait timer active, call tcp_expire_timeouts */
 extern int cbs_in_user_timeout;	/* fin_wait/closing/last_ack active, call " */
 extern int tcpcb_need_push;	/* push required, tcpcb_push_data/call notify_data_avail */
+extern int cbs_delayed_ack;	/* delayed ACKs pending, delack_timer running */
 extern int tcp_retrans_memory;	/* total retransmit memory in use */
 
 struct tcpcb_list_s *tcpcb_new(int bufsize);
@@ -198,6 +236,8 @@ int tcp_init(void);
 void tcp_process(struct iphdr_s *iph);
 void tcp_connect(struct tcpcb_s *cb);
 void tcp_send_ack(struct tcpcb_s *cb);
+void tcp_send_data(struct tcpcb_s *cb, __u8 *data, int len);
+void tcp_send_pending(struct tcpcb_s *cb);
 void tcp_send_fin(struct tcpcb_s *cb);
 void tcp_send_reset(struct tcpcb_s *cb);
 void tcp_reset_connection(struct tcpcb_s *cb);
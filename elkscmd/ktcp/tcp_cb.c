@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #include "config.h"
 #include "tcp.h"
@@ -20,15 +21,31 @@
 #include "tcp_output.h"
 
 static struct tcpcb_list_s	*tcpcbs;
+static struct timer_s		expire_timer;	/* earliest TIME_WAIT or close timeout*/
+static struct timer_s		delack_timer;	/* earliest delayed ACK*/
+
+static void tcpcb_expire_timeouts(void *arg);
+static void tcpcb_send_delayed_acks(void *arg);
+
+/* connection index followed by listener index*/
+static struct tcpcb_list_s	*tcpcb_hashtab[CB_HASH_SIZE * 2];
+
+#define CONN_HASH(addr,lport,rport) \
+	(((unsigned)(addr) ^ (unsigned)((addr) >> 16) ^ (lport) ^ (rport)) & (CB_HASH_SIZE - 1))
+#define LISTEN_HASH(lport)	(CB_HASH_SIZE + ((lport) & (CB_HASH_SIZE - 1)))
 
 int tcpcb_num;		/* for netstat*/
 
 void tcpcb_init(void)
 {
     tcpcbs = NULL;
+    memset(tcpcb_hashtab, 0, sizeof(tcpcb_hashtab));
     tcpcb_need_push = 0;
+    cbs_delayed_ack = 0;
     cbs_in_time_wait = 0;
     cbs_in_user_timeout = 0;
+    timer_init(&expire_timer, tcpcb_expire_timeouts, NULL);
+    timer_init(&delack_timer, tcpcb_send_delayed_acks, NULL);
 
     tcpcb_num = 0;	/* for netstat*/
 }
@@ -43,7 +60,7 @@ void tcpcb_printall(void)
 	printf("CB:%p sock:%04x %04xx State:%d LP:%u RP:%u RTT:%d unacc: %d\n",
 	    &n->tcpcb, n->tcpcb.sock, n->tcpcb.newsock,
 	    n->tcpcb.state, n->tcpcb.localport, n->tcpcb.remport,
-	    n->tcpcb.rtt * 1000 / 16, n->tcpcb.unaccepted);
+	    (n->tcpcb.srtt >> 3) * 1000 / 16, n->tcpcb.unaccepted);
 	n = n->next;
     }
 #endif
@@ -63,31 +80,65 @@ struct tcpcb_s *tcpcb_getbynum(int num)
 	    return &n->tcpcb;
 }
 
+static void tcpcb_unhash(struct tcpcb_list_s *n)
+{
+    struct tcpcb_list_s **pp;
+
+    if (n->hash == CB_HASH_NONE)
+	return;
+    for (pp = &tcpcb_hashtab[n->hash]; *pp; pp = &(*pp)->hnext)
+	if (*pp == n) {
+	    *pp = n->hnext;
+	    break;
+	}
+    n->hash = CB_HASH_NONE;
+}
+
+/* (re)index CB, must be called whenever its address or ports change*/
+void tcpcb_rehash(struct tcpcb_list_s *n)
+{
+    struct tcpcb_s *cb = &n->tcpcb;
+
+    tcpcb_unhash(n);
+    if (cb->remport)
+	n->hash = CONN_HASH(cb->remaddr, cb->localport, cb->remport);
+    else
+	n->hash = LISTEN_HASH(cb->localport);
+    n->hnext = tcpcb_hashtab[n->hash];
+    tcpcb_hashtab[n->hash] = n;
+}
+
 struct tcpcb_list_s *tcpcb_new(int bufsize)
 {
     struct tcpcb_list_s *n;
 
-    n = (struct tcpcb_list_s *) malloc(sizeof(struct tcpcb_list_s) + bufsize);
+    n = (struct tcpcb_list_s *) malloc(sizeof(struct tcpcb_list_s));
     if (n == NULL) {
+out:
 	debug_tcp("ktcp: Out of memory for CB\n");
 	return NULL;
     }
+    memset(&n->tcpcb, 0, sizeof(struct tcpcb_s));
+    if ((n->tcpcb.buf_base = malloc(bufsize)) == NULL) {
+	free(n);
+	goto out;
+    }
     debug_mem("Alloc CB %d bytes\n", sizeof(struct tcpcb_list_s) + bufsize);
 
-    memset(&n->tcpcb, 0, sizeof(struct tcpcb_s));
     n->tcpcb.buf_size = bufsize;
-    n->tcpcb.rtt = TIMEOUT_INITIAL_RTT;
+    n->tcpcb.rto = TIMEOUT_INITIAL_RTT << 1;
 
     /* Link it to the list */
-    if (tcpcbs) {
-	n->next = tcpcbs;
-	n->prev = NULL;
+    n->next = tcpcbs;
+    n->prev = NULL;
+    if (tcpcbs)
 	tcpcbs->prev = n;
-	tcpcbs = n;
-    } else
-	tcpcbs = n;
+    tcpcbs = n;
     tcpcb_num++;	/* for netstat*/
 
+    n->hash = CB_HASH_NONE;
+    tcpcb_rehash(n);
+
     return n;
 }
 
@@ -96,9 +147,17 @@ struct tcpcb_list_s *tcpcb_clone(struct tcpcb_s *cb, int bufsize)
     struct tcpcb_list_s *n = tcpcb_new(bufsize);
 
     if (n) {
+	__u8 *buf = n->tcpcb.buf_base;
+
 	memcpy(&n->tcpcb, cb, sizeof(struct tcpcb_s));
+	n->tcpcb.buf_base = buf;
 	n->tcpcb.buf_size = bufsize;
+	n->tcpcb.delack = 0;
 	n->tcpcb.buf_head = n->tcpcb.buf_tail = n->tcpcb.buf_used = 0;
+	n->tcpcb.retrans_head = n->tcpcb.retrans_tail = NULL;
+	n->tcpcb.snd_buf = NULL;
+	n->tcpcb.snd_len = 0;
+	tcpcb_rehash(n);
     }
     return n;
 }
@@ -121,13 +180,20 @@ void tcpcb_remove(struct tcpcb_list_s *n)
     debug_tcp("tcp: REMOVING control block %x\n", n);
     debug_mem("Free CB\n");
     tcpcb_num--;	/* for netstat*/
+    tcpcb_unhash(n);
+    if (n->tcpcb.delack)
+	cbs_delayed_ack--;
+    free(n->tcpcb.buf_base);
+    if (n->tcpcb.snd_buf)
+	free(n->tcpcb.snd_buf);
 
     if (n->prev)
 	n->prev->next = next;
     else {
 	/* Head update */
 	n = next;
-	n->prev = NULL;
+	if (n)
+	    n->prev = NULL;
 
 	rmv_all_retrans(tcpcbs);
 	free(tcpcbs);
@@ -142,33 +208,46 @@ void tcpcb_remove(struct tcpcb_list_s *n)
     free(n);
 }
 
-struct tcpcb_list_s *tcpcb_check_port(__u16 lport)
+static struct tcpcb_list_s *tcpcb_find_listener(__u16 lport)
 {
     struct tcpcb_list_s *n;
 
-    for (n=tcpcbs; n; n=n->next)
+    for (n=tcpcb_hashtab[LISTEN_HASH(lport)]; n; n=n->hnext)
 	if (n->tcpcb.localport == lport)
 	    return n;
 
     return NULL;
 }
 
-struct tcpcb_list_s *tcpcb_find(__u32 addr, __u16 lport, __u16 rport)
+/* called on bind only, connected CBs are not indexed by local port alone*/
+struct tcpcb_list_s *tcpcb_check_port(__u16 lport)
 {
     struct tcpcb_list_s *n;
 
-    for (n=tcpcbs; n; n=n->next)
-	if (n->tcpcb.remaddr == addr && n->tcpcb.remport == rport
-				     && n->tcpcb.localport == lport)
-	    return n;
+    if ((n = tcpcb_find_listener(lport)) != NULL)
+	return n;
 
     for (n=tcpcbs; n; n=n->next)
-	if (n->tcpcb.remport == 0 && n->tcpcb.localport == lport)
+	if (n->tcpcb.localport == lport)
 	    return n;
 
     return NULL;
 }
 
+struct tcpcb_list_s *tcpcb_find(__u32 addr, __u16 lport, __u16 rport)
+{
+    struct tcpcb_list_s *n;
+
+    if (rport) {
+	for (n=tcpcb_hashtab[CONN_HASH(addr, lport, rport)]; n; n=n->hnext)
+	    if (n->tcpcb.remaddr == addr && n->tcpcb.remport == rport
+					 && n->tcpcb.localport == lport)
+		return n;
+    }
+
+    return tcpcb_find_listener(lport);
+}
+
 struct tcpcb_list_s *tcpcb_find_by_sock(void *sock)
 {
     struct tcpcb_list_s *n;
@@ -220,9 +299,26 @@ char *tcp_states[11] = {
 
 #endif
 
-void tcpcb_expire_timeouts(void)
+/*
+ * Run the expire timer at expires unless due earlier. Later changes to
+ * time_wait_exp need not reschedule, the timer is rearmed for the earliest
+ * remaining timeout each time it runs.
+ */
+void tcpcb_schedule_expire(timeq_t expires)
+{
+    timer_reduce(&expire_timer, expires);
+}
+
+void tcpcb_schedule_delack(timeq_t expires)
+{
+    timer_reduce(&delack_timer, expires);
+}
+
+/* expire timer function, remove CBs whose TIME_WAIT or close timeout has passed*/
+static void tcpcb_expire_timeouts(void *arg)
 {
     struct tcpcb_list_s *n = tcpcbs, *next;
+    timeq_t expires;
 
     while (n) {
 	next = n->next;
@@ -237,28 +333,43 @@ void tcpcb_expire_timeouts(void)
 #endif
 	switch (n->tcpcb.state) {
 	    case TS_TIME_WAIT:
-		if (TIME_GT(Now, n->tcpcb.time_wait_exp)) {
+		expires = n->tcpcb.time_wait_exp + 1;
+		if (TIME_GEQ(Now, expires)) {
 		    LEAVE_TIME_WAIT(&n->tcpcb);
 		    debug_close("tcp[%p] exit TIME_WAIT state on port %u remote %s:%u\n",
 				n->tcpcb.sock, n->tcpcb.localport,
 				in_ntoa(n->tcpcb.remaddr), n->tcpcb.remport);
 		    tcpcb_remove(n);
-		}
+		} else tcpcb_schedule_expire(expires);
 		break;
 	    case TS_FIN_WAIT_1:
 	    case TS_FIN_WAIT_2:
 	    case TS_LAST_ACK:
 	    case TS_CLOSING:
-		if (TIME_GT(Now - TIMEOUT_CLOSE_WAIT, n->tcpcb.time_wait_exp)) {
+		expires = n->tcpcb.time_wait_exp + TIMEOUT_CLOSE_WAIT + 1;
+		if (TIME_GEQ(Now, expires)) {
 		    cbs_in_user_timeout--;
 		    tcpcb_remove(n);
-		}
+		} else tcpcb_schedule_expire(expires);
 		break;
 	}
 	n = next;
     }
 }
 
+/* delayed ACK timer function, send ACKs delayed too long without outgoing data*/
+static void tcpcb_send_delayed_acks(void *arg)
+{
+    struct tcpcb_list_s *n;
+
+    for (n=tcpcbs; n; n=n->next)
+	if (n->tcpcb.delack) {
+	    if (TIME_GEQ(Now, n->tcpcb.delack_exp))
+		tcp_send_ack(&n->tcpcb);		/* clears delack*/
+	    else tcpcb_schedule_delack(n->tcpcb.delack_exp);
+	}
+}
+
 void tcpcb_push_data(void)
 {
     struct tcpcb_list_s *n;
@@ -295,3 +406,25 @@ void tcpcb_buf_read(struct tcpcb_s *cb, unsigned char *data, int len)
     }
     cb->buf_head = head;
 }
+
+/* resize input buffer for SO_RCVBUF, keeping any data not yet read*/
+int tcpcb_buf_resize(struct tcpcb_s *cb, int size)
+{
+    __u8 *buf;
+    int used = cb->buf_used;
+
+    if (size < used || size <= 0 || size > CB_MAX_BUFSIZ)
+	return -EINVAL;
+    if ((buf = malloc(size)) == NULL)
+	return -ENOMEM;
+    debug_mem("Resize CB buffer %u to %d bytes\n", cb->buf_size, size);
+
+    tcpcb_buf_read(cb, buf, used);
+    free(cb->buf_base);
+    cb->buf_base = buf;
+    cb->buf_size = size;
+    cb->buf_used = used;
+    cb->buf_head = 0;
+    cb->buf_tail = (used == size)? 0: used;
+    return 0;
+}
@@ -7,9 +7,12 @@ void tcpcb_init(void);
 struct tcpcb_list_s *tcpcb_clone(struct tcpcb_s *cb, int bufsize);
 void tcpcb_remove(struct tcpcb_list_s *n);
 void tcpcb_remove_cb(struct tcpcb_s *cb);
+void tcpcb_rehash(struct tcpcb_list_s *n);
 void tcpcb_buf_read(struct tcpcb_s *cb, unsigned char *data, int len);
 void tcpcb_buf_write(struct tcpcb_s *cb, unsigned char *data, int len);
-void tcpcb_expire_timeouts(void);
+int tcpcb_buf_resize(struct tcpcb_s *cb, int size);
+void tcpcb_schedule_expire(timeq_t expires);
+void tcpcb_schedule_delack(timeq_t expires);
 void tcpcb_push_data(void);
 struct tcpcb_list_s *tcpcb_check_port(__u16 lport);
 struct tcpcb_list_s *tcpcb_find_unaccepted(void *sock);
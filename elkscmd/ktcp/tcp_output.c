@@ -26,90 +26,13 @@
 static struct tcp_retrans_list_s *retrans_list;
 static unsigned char tcpbuf[TCP_BUFSIZ];
 
-__u16 tcp_chksum(struct iptcp_s *h)
-{
-    __u32 sum = htons(h->tcplen);
-    __u16 len = h->tcplen;
-    register __u16 *data = (__u16 *)h->tcph;
-
-    for (; len > 1 ; len -= 2)
-	sum += *data++;
-
-    if (len == 1)
-	sum += (__u16)(*(__u8 *)data);
-
-    sum += h->iph->saddr & 0xffff;
-    sum += (h->iph->saddr >> 16) & 0xffff;
-    sum += h->iph->daddr & 0xffff;
-    sum += (h->iph->daddr >> 16) & 0xffff;
-    sum += htons((__u16)6);
-
-    while (sum >> 16)
-	sum = (sum & 0xffff) + (sum >> 16);
-    return ~(__u16)sum;
-}
+static int tcp_calc_rcv_window(struct tcpcb_s *cb);
+static void tcp_retrans_timeout(void *arg);
 
-/*** __u16 tcp_chksum(struct iptcp_s *h)
-	.text
-	.globl _tcp_chksum
-_tcp_chksum:
-	push	bp
-	mov	bp, sp
-	push	di
-	push	si
-
-	mov	bx, 4[bp]	! h
-	mov	ax, 4[bx]	! h->tcplen
-	mov	cx, ax
-	xchg	al, ah
-
-	mov	di, [bx]	! h->iph
-
-	mov	si, 2[bx]	! h->tcph
-	mov	bx, cx
-	sar	cx, #$1
-
-	mov	dx, bx
-	and	bx, #$1
-	jz	loop1
-
-	mov	bx, dx
-	dec	bx
-	mov	dl, [si + bx]
-	xor	dh, dh
-	add	ax, dx
-
-loop1:
-	adc	ax, [si]
-        inc si
-        inc si
-        loop	loop1
-
-	adc	ax, $E[di]	! h->iph->saddr
-	adc	ax, $C[di]
-	adc	ax, $12[di]	! h->iph->daddr
-	adc	ax, $10[di]
-	adc	ax, #$600
-	adc	ax, 0
-
-        not	ax
-
-	pop	si
-	pop	di
-	pop	bp
-	ret
-***/
-
-__u16 tcp_chksumraw(struct tcphdr_s *h, __u32 saddr, __u32 daddr, __u16 len)
+/* ones' complement sum of the TCP pseudo header*/
+static __u16 tcp_pseudo_sum(__u32 saddr, __u32 daddr, __u16 len)
 {
     __u32 sum = htons(len);
-    __u16 *data = (__u16 *) h;
-
-    for (; len > 1 ; len -= 2)
-	sum += *data++;
-
-    if (len == 1)
-	sum += (__u16)(*(__u8 *) data);
 
     sum += saddr & 0xffff;
     sum += (saddr >> 16) & 0xffff;
@@ -117,78 +40,50 @@ __u16 tcp_chksumraw(struct tcphdr_s *h, __u32 saddr, __u32 daddr, __u16 len)
     sum += (daddr >> 16) & 0xffff;
     sum += htons((__u16)6);
 
-    while (sum >> 16)
-	sum = (sum & 0xffff) + (sum >> 16);
-    return ~(__u16)sum;
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (__u16)sum;
+}
+
+__u16 tcp_chksum(struct iptcp_s *h)
+{
+    return ~in_chksum(h->tcph, h->tcplen,
+	tcp_pseudo_sum(h->iph->saddr, h->iph->daddr, h->tcplen));
 }
 
-/*** __u16 tcp_chksumraw(struct tcphdr_s *h, __u32 saddr, __u32 daddr, __u16 len)
-	.text
-	.globl _tcp_chksumraw
-_tcp_chksumraw:
-	push	bp
-	mov	bp, sp
-	push	di
-	push	si
-
-	mov	si, 4[bp]	! h
-	mov	ax, $E[bp]	! len
-	mov	cx, ax
-	xchg	al, ah
-	mov	bx, cx
-	sar	cx, #$1
-
-	mov	dx, bx
-	and	bx, #$1
-	jz	loop2
-
-	mov	bx, dx
-	dec	bx
-	mov	dl, [si + bx]
-	xor	dh, dh
-	add	ax, dx
-
-loop2:
-	adc	ax, [si]
-        inc si
-        inc si
-        loop	loop2
-
-	adc	ax, 6[bp]
-	adc	ax, 8[bp]
-	adc	ax, $A[bp]
-	adc	ax, $C[bp]
-	adc	ax, #$600
-        adc     ax, 0
-
-        not	ax
-
-	pop	si
-	pop	di
-	pop	bp
-	ret
-***/
+__u16 tcp_chksumraw(struct tcphdr_s *h, __u32 saddr, __u32 daddr, __u16 len)
+{
+    return ~in_chksum(h, len, tcp_pseudo_sum(saddr, daddr, len));
+}
 
 struct tcp_retrans_list_s *
 rmv_from_retrans(struct tcp_retrans_list_s *n)
 {
     struct tcp_retrans_list_s *next = n->next;
+    struct tcp_retrans_list_s *p, *prev;
+    struct tcpcb_s *cb = n->cb;
 
     tcp_timeruse--;
+    timer_del(&n->timer);
     tcp_retrans_memory -= n->len;
     debug_mem("retrans free: (cnt %d mem %u)\n", tcp_timeruse, tcp_retrans_memory);
 
+    /* unlink from control block queue, normally at its head*/
+    for (prev = NULL, p = cb->retrans_head; p; prev = p, p = p->cbnext)
+	if (p == n) {
+	    if (prev)
+		prev->cbnext = n->cbnext;
+	    else
+		cb->retrans_head = n->cbnext;
+	    if (cb->retrans_tail == n)
+		cb->retrans_tail = prev;
+	    break;
+	}
+
     if (n->prev)
 	n->prev->next = next;
-    else {
-	/* Head update */
-	n = next;
-	n->prev = NULL;
-	free(retrans_list);
-	retrans_list = n;
-
-	return n;
-    }
+    else
+	retrans_list = next;		/* Head update */
 
     if (next)
 	next->prev = n->prev;
@@ -199,28 +94,13 @@ rmv_from_retrans(struct tcp_retrans_list_s *n)
 
 void rmv_all_retrans(struct tcpcb_list_s *lcb)
 {
-    struct tcp_retrans_list_s *n;
-
-    n = retrans_list;
-
-    while (n != NULL)
-	if (n->cb == &lcb->tcpcb)
-	    n = rmv_from_retrans(n);
-	else
-	    n = n->next;
+    rmv_all_retrans_cb(&lcb->tcpcb);
 }
 
 void rmv_all_retrans_cb(struct tcpcb_s *cb)
 {
-    struct tcp_retrans_list_s *n;
-
-    n = retrans_list;
-
-    while (n != NULL)
-	if (n->cb == cb)
-	    n = rmv_from_retrans(n);
-	else
-	    n = n->next;
+    while (cb->retrans_head)
+	rmv_from_retrans(cb->retrans_head);
 }
 
 void add_for_retrans(struct tcpcb_s *cb, struct tcphdr_s *th, __u16 len,
@@ -256,6 +136,14 @@ void add_for_retrans(struct tcpcb_s *cb, struct tcphdr_s *th, __u16 len,
 	n->prev = n->next = NULL;
     }
 
+    /* and to the tail of the control block queue, which is kept in seq order*/
+    n->cbnext = NULL;
+    if (cb->retrans_tail)
+	cb->retrans_tail->cbnext = n;
+    else
+	cb->retrans_head = n;
+    cb->retrans_tail = n;
+
     /* start timeout blocking in main loop*/
     tcp_timeruse++;
 
@@ -267,15 +155,95 @@ void add_for_retrans(struct tcpcb_s *cb, struct tcphdr_s *th, __u16 len,
     n->retrans_num = 0;
     n->first_trans = Now;
 
-    n->rto = cb->rtt << 1;			/* set retrans timeout to twice RTT*/
-    if (linkprotocol == LINK_ETHER) {
-	if (n->rto < TCP_RETRANS_MINWAIT_ETH)
-	    n->rto = TCP_RETRANS_MINWAIT_ETH;	/* 1/4 sec min retrans timeout on ethernet*/
+    n->rto = cb->rto;
+    n->next_retrans = Now + n->rto;
+    timer_init(&n->timer, tcp_retrans_timeout, n);
+    timer_add(&n->timer, n->next_retrans);
+}
+
+/*
+ * Update smoothed RTT and deviation from a new sample (RFC 6298),
+ * using scaled integers as in BSD: srtt << 3 and rttvar << 2.
+ */
+static void tcp_rtt_update(struct tcpcb_s *cb, long rtt)
+{
+    long delta;
+    timeq_t rto, minrto;
+
+    if (cb->srtt == 0) {		/* first measurement*/
+	cb->srtt = rtt << 3;
+	cb->rttvar = rtt << 1;
     } else {
-	if (n->rto < TCP_RETRANS_MINWAIT_SLIP)
-	    n->rto = TCP_RETRANS_MINWAIT_SLIP;	/* 1/2 sec min retrans timeout on slip/cslip*/
+	delta = rtt - (long)(cb->srtt >> 3);
+	cb->srtt += delta;		/* srtt = 7/8 srtt + 1/8 rtt*/
+	if (delta < 0)
+	    delta = -delta;
+	delta -= cb->rttvar >> 2;
+	cb->rttvar += delta;		/* rttvar = 3/4 rttvar + 1/4 |delta|*/
+    }
+
+    rto = (cb->srtt >> 3) + cb->rttvar;	/* srtt + 4 * rttvar*/
+    minrto = (linkprotocol == LINK_ETHER)?
+	TCP_RETRANS_MINWAIT_ETH:	/* 1/4 sec min retrans timeout on ethernet*/
+	TCP_RETRANS_MINWAIT_SLIP;	/* 1/2 sec min retrans timeout on slip/cslip*/
+    if (rto < minrto)
+	rto = minrto;
+    if (rto > TCP_RETRANS_MAXWAIT)
+	rto = TCP_RETRANS_MAXWAIT;
+    cb->rto = rto;
+    debug_tcp("tcp: rtt %ld SRTT %ld RTTVAR %ld RTO %ld\n",
+	rtt, cb->srtt >> 3, cb->rttvar >> 2, cb->rto);
+}
+
+/* called when send_una advances - free every segment the cumulative ACK covers*/
+void tcp_retrans_ack(struct tcpcb_s *cb)
+{
+    struct tcp_retrans_list_s *n;
+    unsigned int datalen;
+
+    while ((n = cb->retrans_head) != NULL) {
+	datalen = n->len - TCP_DATAOFF(&n->tcphdr[0]);
+	if (n->tcphdr[0].flags & (TF_SYN|TF_FIN)) datalen++;
+
+	if (!SEQ_LEQ(ntohl(n->tcphdr[0].seqnum) + datalen, cb->send_una))
+	    break;
+
+	/* Karn's algorithm: no RTT samples from retransmitted segments*/
+	if (n->retrans_num == 0)
+	    tcp_rtt_update(cb, Now - n->first_trans);
+	debug_retrans("tcp retrans: remove seq %lu+%u unack %lu\n",
+	    ntohl(n->tcphdr[0].seqnum) - cb->iss, datalen, cb->send_una - cb->iss);
+	rmv_from_retrans(n);
+    }
+}
+
+/*
+ * Bring the ACK and window of a segment about to be resent up to date,
+ * adjusting its checksum for the changed words rather than recomputing it.
+ */
+static void tcp_retrans_update(struct tcp_retrans_list_s *n)
+{
+    struct tcphdr_s *th = &n->tcphdr[0];
+    struct tcpcb_s *cb = n->cb;
+    __u32 acknum;
+    __u16 window, sum;
+
+    if (!(th->flags & TF_ACK))
+	return;
+    acknum = htonl(cb->rcv_nxt);
+    window = htons(tcp_calc_rcv_window(cb));
+
+    sum = in_chksum_adjust(th->chksum, (__u16)th->acknum, (__u16)acknum);
+    sum = in_chksum_adjust(sum, (__u16)(th->acknum >> 16), (__u16)(acknum >> 16));
+    th->chksum = in_chksum_adjust(sum, th->window, window);
+    th->acknum = acknum;
+    th->window = window;
+
+    /* the resent segment carries any delayed ACK*/
+    if (cb->delack) {
+	cb->delack = 0;
+	cbs_delayed_ack--;
     }
-    n->next_retrans = Now + n->rto;
 }
 
 void tcp_reoutput(struct tcp_retrans_list_s *n)
@@ -288,79 +256,63 @@ void tcp_reoutput(struct tcp_retrans_list_s *n)
     if (n->rto > TCP_RETRANS_MAXWAIT)		/* limit retransmit timeouts to 4 seconds*/
 	n->rto = TCP_RETRANS_MAXWAIT;
     n->next_retrans = Now + n->rto;
+    timer_add(&n->timer, n->next_retrans);
 
-    printf("tcp retrans: seq %lu+%u size %d rcvwnd %u unack %lu rto %ld rtt %ld (RETRY %d cnt %d mem %u)\n",
+    printf("tcp retrans: seq %lu+%u size %d rcvwnd %u unack %lu rto %ld srtt %ld (RETRY %d cnt %d mem %u)\n",
 	ntohl(n->tcphdr[0].seqnum) - n->cb->iss, datalen,
 	n->len - TCP_DATAOFF(&n->tcphdr[0]), n->cb->rcv_wnd, n->cb->send_una - n->cb->iss,
-	n->rto, n->cb->rtt, n->retrans_num, tcp_timeruse, tcp_retrans_memory);
+	n->rto, n->cb->srtt >> 3, n->retrans_num, tcp_timeruse, tcp_retrans_memory);
 
+    tcp_retrans_update(n);
     ip_sendpacket((unsigned char *)n->tcphdr, n->len, &n->apair, n->cb);
+    n->cb->retrans++;
+    netstats.tcpretranscnt++;
+}
+
+/* resend the oldest unacked segment at once after duplicate ACKs*/
+void tcp_retrans_fast(struct tcpcb_s *cb)
+{
+    struct tcp_retrans_list_s *n = cb->retrans_head;
+
+    if (!n)
+	return;
+    debug_retrans("tcp retrans: fast retransmit seq %lu unack %lu\n",
+	ntohl(n->tcphdr[0].seqnum) - cb->iss, cb->send_una - cb->iss);
+    n->retrans_num++;			/* excluded from RTT samples*/
+    n->next_retrans = Now + n->rto;
+    timer_add(&n->timer, n->next_retrans);
+    tcp_retrans_update(n);
+    ip_sendpacket((unsigned char *)n->tcphdr, n->len, &n->apair, cb);
+    cb->retrans++;
     netstats.tcpretranscnt++;
 }
 
-/* called every ktcp cycle when tcp_timeruse nonzero - check for expired retrans*/
+/* called every ktcp cycle when tcp_timeruse nonzero - check retrans memory use*/
 void tcp_retrans_expire(void)
 {
     struct tcp_retrans_list_s *n;
-    int rtt;
-    unsigned int datalen;
 
-    /* avoid running out of memory with excessive retransmits*/
+    /* acked segments are freed by tcp_retrans_ack, avoid running out of memory*/
     if (tcp_retrans_memory > TCP_RETRANS_MAXMEM) {
 	printf("ktcp: retransmit memory over limit (cnt %d, mem %u)\n", tcp_timeruse, tcp_retrans_memory);
 	n = retrans_list;
 	while (n != NULL)
 		n = rmv_from_retrans(n);
-	return;
-    }
-
-    n = retrans_list;
-    while (n != NULL) {
-	datalen = n->len - TCP_DATAOFF(&n->tcphdr[0]);
-	if (n->tcphdr[0].flags & TF_FIN) datalen++;
-
-	/* calc RTT and remove if seqno was acked*/
-	if (SEQ_LEQ(ntohl(n->tcphdr[0].seqnum) + datalen, n->cb->send_una)) {
-	    if (n->retrans_num == 0) {
-		rtt = Now - n->first_trans;
-		if (rtt > 0)
-		    n->cb->rtt = (TCP_RTT_ALPHA * n->cb->rtt + (100 - TCP_RTT_ALPHA) * rtt) / 100;
-		debug_tcp("tcp: rtt %d RTT %ld RTO %ld\n", rtt, n->cb->rtt, n->rto);
-	    }
-	    debug_retrans("tcp retrans: remove seq %lu+%u unack %lu\n",
-		ntohl(n->tcphdr[0].seqnum) - n->cb->iss, datalen,
-		n->cb->send_una - n->cb->iss);
-	    n = rmv_from_retrans(n);
-	    continue;
-	} else
-	    debug_retrans("tcp retrans: check seq %lu+%u unack %lu time %ld\n",
-		ntohl(n->tcphdr[0].seqnum) - n->cb->iss, datalen,
-		n->cb->send_una - n->cb->iss, n->next_retrans - Now);
-
-	n = n->next;
     }
 }
 
-/* called every ktcp cycle when tcp_timeruse nonzero - check for retransmit* required*/
-void tcp_retrans_retransmit(void)
+/* retransmit timer expired, resend segment or reset connection after too many tries*/
+static void tcp_retrans_timeout(void *arg)
 {
-    struct tcp_retrans_list_s *n;
-
-    n = retrans_list;
-    while (n != NULL) {
-	/* check for retrans time up*/
-	if (TIME_GEQ(Now, n->next_retrans)) {
-	    tcp_reoutput(n);
-	    if (n->retrans_num >= TCP_RETRANS_MAXTRIES) {
-		printf("tcp retrans: max retries exceeded seq %lu unack %lu time %ld\n",
-		    ntohl(n->tcphdr[0].seqnum) - n->cb->iss, n->cb->send_una - n->cb->iss,
-		    n->next_retrans - Now);
-		tcp_send_reset(n->cb);		/* CB deallocated on received RST*/
-		n = rmv_from_retrans(n);
-		continue;
-	    }
-	}
-	n = n->next;
+    struct tcp_retrans_list_s *n = arg;
+
+    tcp_reoutput(n);
+    if (n->retrans_num >= TCP_RETRANS_MAXTRIES) {
+	printf("tcp retrans: max retries exceeded seq %lu unack %lu time %ld\n",
+	    ntohl(n->tcphdr[0].seqnum) - n->cb->iss, n->cb->send_una - n->cb->iss,
+	    n->next_retrans - Now);
+	tcp_send_reset(n->cb);		/* CB deallocated on received RST*/
+	rmv_from_retrans(n);
     }
 }
 
@@ -410,7 +362,14 @@ void tcp_output(struct tcpcb_s *cb)
     th->seqnum = htonl(cb->send_nxt);
     th->acknum = htonl(cb->rcv_nxt);
 
+    /* any ACK sent covers a delayed one*/
+    if (cb->delack && (cb->flags & TF_ACK)) {
+	cb->delack = 0;
+	cbs_delayed_ack--;
+    }
+
     cb->send_nxt += cb->datalen;
+    cb->bytes_out += cb->datalen;
 
     len = tcp_calc_rcv_window(cb);
     th->window = htons(len);
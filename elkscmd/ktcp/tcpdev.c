@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 #include <arpa/inet.h>
 #define __KERNEL__
 #include <errno.h>
@@ -23,6 +24,7 @@
 #include "tcp.h"
 #include "tcpdev.h"
 #include "tcp_cb.h"
+#include "udp.h"
 #include "netconf.h"
 
 static __u16	next_port;
@@ -77,8 +79,19 @@ static void tcpdev_bind(void)
 	return;
     }
 
-    /* SO_RCVBUF currently only sets listen or connect buffer size, NOT accept size!*/
+    if (db->type == SOCK_DGRAM) {
+	port = ntohs(db->addr.sin_port);
+	if ((size = udp_bind(db->sock, &port)) < 0) {
+	    retval_to_sock(db->sock, size);
+	    return;
+	}
+	goto bound;
+    }
+
+    /* SO_RCVBUF sets listen or connect buffer size, accepted sockets use TDC_SETOPT*/
     size = db->rcv_bufsiz? db->rcv_bufsiz: CB_NORMAL_BUFSIZ;
+    if (size > CB_MAX_BUFSIZ)
+	size = CB_MAX_BUFSIZ;
     n = tcpcb_new(size);
     if (n == NULL) {
 	retval_to_sock(db->sock,-ENOMEM);
@@ -119,8 +132,11 @@ reject:
     n->tcpcb.sock = db->sock;
     n->tcpcb.localaddr = local_ip;
     n->tcpcb.localport = port;
-    n->tcpcb.state = TS_CLOSED;
+    n->tcpcb.nodelay = db->nodelay != 0;
+    TCP_SETSTATE(&n->tcpcb, TS_CLOSED);
+    tcpcb_rehash(n);
 
+bound:
     bind_ret.type = TDT_BIND;
     bind_ret.ret_value = 0;
     bind_ret.sock = db->sock;
@@ -228,9 +244,10 @@ static void tcpdev_connect(void)
 	addr = local_ip;
     n->tcpcb.remaddr = addr;
     n->tcpcb.remport = ntohs(db->addr.sin_port);
+    tcpcb_rehash(n);
 
     if (n->tcpcb.remport == NETCONF_PORT && n->tcpcb.remaddr == 0) {
-	n->tcpcb.state = TS_ESTABLISHED;
+	TCP_SETSTATE(&n->tcpcb, TS_ESTABLISHED);
 	notify_sock(n->tcpcb.sock, TDT_CONNECT, 0);	/* success*/
     } else
 	tcp_connect(&n->tcpcb);
@@ -248,7 +265,7 @@ static void tcpdev_listen(void)
     }
 
     debug_accept("tcp listen: port %u sock[%p]\n", n->tcpcb.localport, db->sock);
-    n->tcpcb.state = TS_LISTEN;
+    TCP_SETSTATE(&n->tcpcb, TS_LISTEN);
     n->tcpcb.newsock = 0;
     retval_to_sock(db->sock, 0);
 }
@@ -260,7 +277,7 @@ static void tcpdev_read(void)
     struct tdb_return_data *ret_data;
     struct tcpcb_list_s *n;
     struct tcpcb_s *cb;
-    unsigned int data_avail;
+    unsigned int data_avail, off, len, space;
     void * sock = db->sock;
 
     n = tcpcb_find_by_sock(sock);
@@ -293,18 +310,28 @@ static void tcpdev_read(void)
     }
 
     data_avail = db->size < data_avail ? db->size : data_avail;
+    space = CB_BUF_SPACE(cb);		/* receive window before read*/
     cb->bytes_to_push -= data_avail;
     if (cb->bytes_to_push <= 0)
 	tcpcb_need_push--;
 
+    /*
+     * Return everything asked for in one transaction, as consecutive chunks
+     * that each fit a kernel reply slot. ret_value is the total of all chunks.
+     */
     //printf("ktcpdev read: %d bytes\n", data_avail);
     ret_data = (struct tdb_return_data *)sbuf;
     ret_data->type = TDT_RETURN;
     ret_data->ret_value = data_avail;
-    ret_data->size = data_avail;
     ret_data->sock = sock;
-    tcpcb_buf_read(cb, ret_data->data, data_avail);
-    write(tcpdevfd, sbuf, sizeof(struct tdb_return_data) + data_avail);
+    for (off = 0; off < data_avail; off += len) {
+	len = data_avail - off;
+	if (len > TCPDEV_MAXCHUNK)
+	    len = TCPDEV_MAXCHUNK;
+	ret_data->size = len;
+	tcpcb_buf_read(cb, ret_data->data, len);
+	write(tcpdevfd, sbuf, sizeof(struct tdb_return_data) + len);
+    }
 
     /* if remote closed and more data, update data avail then indicate disconnecting*/
     if (cb->state == TS_CLOSE_WAIT) {
@@ -319,13 +346,18 @@ static void tcpdev_read(void)
 	return;
     }
 
-    /* send ACK to restart server should window have been full (unless it's netstat)*/
-    if (cb->remport != NETCONF_PORT || cb->remaddr != 0)
-	if (cb->remport != local_ip) {	/* no ack to localhost either*/
-	    debug_window("tcp: extra ACK seq %ld, app read %d bytes\n",
-		cb->rcv_nxt - cb->irs, data_avail);
-	    tcp_send_ack(cb);
-	}
+    /*
+     * Send window update to restart server should window have been more
+     * than half closed (unless it's netstat), smaller openings are
+     * advertised on the next ACK or data segment.
+     */
+    if (space < (cb->buf_size >> 1) &&
+	(cb->remport != NETCONF_PORT || cb->remaddr != 0) &&
+	cb->remport != local_ip) {	/* no ack to localhost either*/
+	debug_window("tcp: extra ACK seq %ld, app read %d bytes\n",
+	    cb->rcv_nxt - cb->irs, data_avail);
+	tcp_send_ack(cb);
+    }
 }
 
 /* kernel write data to ktcp (network)*/
@@ -335,7 +367,7 @@ static void tcpdev_write(void)
     struct tcpcb_list_s *n;
     struct tcpcb_s *cb;
     void *  sock = db->sock;
-    unsigned int size, maxwindow;
+    unsigned int size, maxwindow, mss;
 
     sock = db->sock;
     /*
@@ -344,13 +376,6 @@ static void tcpdev_write(void)
      */
     size = db->size;
 
-    /* This is a bit ugly but I'm to lazy right now */
-    if (tcp_retrans_memory > TCP_RETRANS_MAXMEM) {
-	printf("ktcp: RETRANS memory limit exceeded\n");
-	retval_to_sock(sock, -ENOMEM);
-	return;
-    }
-
     n = tcpcb_find_by_sock(sock);
     if (!n || n->tcpcb.state == TS_CLOSED) {
 	printf("tcpdev_write: write to unknown socket\n");
@@ -376,14 +401,20 @@ static void tcpdev_write(void)
 	return;
     }
 
-    /* Delay sending if outstanding send window too large. FIXME could hang if no ACKs rcvd*/
+    /*
+     * Keep sending until the peer's advertised window is full.
+     * Delay sending if outstanding send window or retransmit memory too large,
+     * the kernel retries when an ACK opens the window, or 100ms later.
+     */
     maxwindow = cb->rcv_wnd;
     if (maxwindow > TCP_SEND_WINDOW_MAX)	/* limit retrans memory usage*/
 	maxwindow = TCP_SEND_WINDOW_MAX;
-    if (cb->send_nxt - cb->send_una + size > maxwindow) {
+    if (cb->send_nxt - cb->send_una + cb->snd_len + size > maxwindow ||
+	tcp_retrans_memory + size > TCP_RETRANS_MAXMEM) {
 	debug_tcp("tcp limit: seq %lu size %d maxwnd %u unack %lu rcvwnd %u\n",
 	    cb->send_nxt - cb->iss, size, maxwindow, cb->send_nxt - cb->send_una, cb->rcv_wnd);
-	retval_to_sock(sock, -ERESTARTSYS);	/* kernel will retry 100ms later*/
+	cb->send_blocked = 1;
+	retval_to_sock(sock, -ERESTARTSYS);
 	return;
     }
 
@@ -391,14 +422,79 @@ static void tcpdev_write(void)
 	cb->send_nxt - cb->iss, size, cb->rcv_wnd, cb->send_nxt - cb->send_una,
 	tcp_timeruse, tcp_retrans_memory);
 
-    cb->flags = TF_PSH|TF_ACK;
-    cb->datalen = size;
-    cb->data = db->data;
-    tcp_output(cb);
+    /*
+     * Nagle: while earlier data is unacked, coalesce small writes into one
+     * MSS sized segment, sent when all outstanding data is acked or it fills.
+     * Consecutive TDC_WRITEs are merged the same way before segmenting.
+     */
+    mss = MTU - 40;
+    if (cb->snd_len + size > mss)
+	tcp_send_pending(cb);
+    if (!cb->snd_buf && !(cb->snd_buf = malloc(mss)))
+	debug_tcp("tcp write: no memory for coalescing\n");
+    if (cb->snd_buf && size < mss &&
+	(cb->snd_len || (!cb->nodelay && cb->send_nxt != cb->send_una))) {
+	memcpy(cb->snd_buf + cb->snd_len, db->data, size);
+	cb->snd_len += size;
+	if (cb->nodelay || cb->send_nxt == cb->send_una || cb->snd_len >= mss)
+	    tcp_send_pending(cb);
+    } else
+	tcp_send_data(cb, db->data, size);
 
     retval_to_sock(sock, size);
 }
 
+/* kernel sendto, datagram sent without reply*/
+static void tcpdev_sendto(void)
+{
+    struct tdb_sendto *db = (struct tdb_sendto *)sbuf; /* read from sbuf*/
+
+    udp_sendto(db->sock, db->addr_ip, db->addr_port, db->data, db->size);
+}
+
+/* kernel recvfrom, answered now or when a datagram arrives*/
+static void tcpdev_recvfrom(void)
+{
+    struct tdb_read *db = (struct tdb_read *)sbuf; /* read from sbuf*/
+
+    udp_recvfrom(db->sock, db->nonblock);
+}
+
+/* socket option changed on a bound or connected socket*/
+static void tcpdev_setopt(void)
+{
+    struct tdb_setopt *db = (struct tdb_setopt *)sbuf; /* read from sbuf*/
+    struct tcpcb_list_s *n;
+    struct tcpcb_s *cb;
+    int ret, oldsize;
+
+    n = tcpcb_find_by_sock(db->sock);
+    if (!n) {
+	retval_to_sock(db->sock, -EINVAL);
+	return;
+    }
+    cb = &n->tcpcb;
+
+    if (db->level == IPPROTO_TCP) {
+	if (db->option == TCP_NODELAY) {
+	    cb->nodelay = db->value != 0;
+	    if (cb->nodelay)
+		tcp_send_pending(cb);	/* send anything held back*/
+	    ret = 0;
+	} else
+	    ret = -EINVAL;
+    } else if (db->option == SO_RCVBUF) {
+	oldsize = cb->buf_size;
+	ret = tcpcb_buf_resize(cb, db->value);
+	debug_tune("tcp: sock[%p] SO_RCVBUF %d ret %d\n", db->sock, db->value, ret);
+	/* advertise a larger window at once*/
+	if (ret == 0 && cb->buf_size > oldsize && cb->state == TS_ESTABLISHED)
+	    tcp_send_ack(cb);
+    } else
+	ret = -EINVAL;
+    retval_to_sock(db->sock, ret);
+}
+
 static void tcpdev_release(void)
 {
     struct tdb_release *db = (struct tdb_release *)sbuf; /* read from sbuf*/
@@ -406,6 +502,9 @@ static void tcpdev_release(void)
     struct tcpcb_s *cb;
     void * sock = db->sock;
 
+    if (udp_release(sock))
+	return;
+
     n = tcpcb_find_by_sock(sock);
     if (n) {
 	cb = &n->tcpcb;
@@ -428,17 +527,18 @@ static void tcpdev_release(void)
 			return;
 		}
 		debug_close("tcp[%p] setting state to FIN_WAIT_1\n", cb->sock);
-		cb->state = TS_FIN_WAIT_1;
+		TCP_SETSTATE(cb, TS_FIN_WAIT_1);
 		goto common_close;
 	    case TS_CLOSE_WAIT:
 		debug_close("tcp[%p] setting state to LAST_ACK\n", cb->sock);
-		cb->state = TS_LAST_ACK;
+		TCP_SETSTATE(cb, TS_LAST_ACK);
 common_close:
 		if (db->reset) {		/* SO_LINGER w/zero timer */
 		   tcp_reset_connection(cb);	/* send RST and deallocate */
 		} else {
 		    cbs_in_user_timeout++;
 		    cb->time_wait_exp = Now;
+		    tcpcb_schedule_expire(Now + TIMEOUT_CLOSE_WAIT + 1);
 		    tcp_send_fin(cb);
 		}
 		break;
@@ -450,11 +550,12 @@ common_close:
     }
 }
 
-void tcpdev_process(void)
+/* process one queued kernel command, returns 0 when none left*/
+static int tcpdev_command(void)
 {
 	int len = read(tcpdevfd, sbuf, TCPDEV_BUFSIZ);
 	if (len <= 0)
-		return;
+		return 0;
 
 	debug_tcpdev("tcpdev_process read %d bytes\n",len);
 
@@ -487,5 +588,27 @@ void tcpdev_process(void)
 	    debug_tcpdev("tcpdev_write\n");
 	    tcpdev_write();
 	    break;
+	case TDC_SETOPT:
+	    debug_tcpdev("tcpdev_setopt\n");
+	    tcpdev_setopt();
+	    break;
+	case TDC_SENDTO:
+	    debug_tcpdev("tcpdev_sendto\n");
+	    tcpdev_sendto();
+	    break;
+	case TDC_RECVFROM:
+	    debug_tcpdev("tcpdev_recvfrom\n");
+	    tcpdev_recvfrom();
+	    break;
 	}
+	return 1;
+}
+
+/* drain the kernel command ring, several sockets may have commands queued*/
+void tcpdev_process(void)
+{
+	int n = TDB_SLOTS;
+
+	while (n-- && tcpdev_command())
+		continue;
 }
@@ -22,3 +22,71 @@ timeq_t timer_get_time(void)
 	/* return 1/16 second ticks, 1,000,000/16 = 62500*/
     return (tv.tv_sec << 4) | ((unsigned long)tv.tv_usec / 62500U);
 }
+
+static struct timer_s *timer_list;	/* pending timers, earliest first*/
+
+void timer_init(struct timer_s *t, void (*func)(void *), void *arg)
+{
+    t->pprev = NULL;
+    t->func = func;
+    t->arg = arg;
+}
+
+void timer_del(struct timer_s *t)
+{
+    if (t->pprev) {
+	if (t->next)
+	    t->next->pprev = t->pprev;
+	*t->pprev = t->next;
+	t->pprev = NULL;
+    }
+}
+
+/* (re)queue timer to expire at expires, after any timers due at the same time*/
+void timer_add(struct timer_s *t, timeq_t expires)
+{
+    struct timer_s **pp;
+
+    timer_del(t);
+    t->expires = expires;
+    for (pp = &timer_list; *pp && TIME_LEQ((*pp)->expires, expires); pp = &(*pp)->next)
+	continue;
+    t->next = *pp;
+    if (t->next)
+	t->next->pprev = &t->next;
+    t->pprev = pp;
+    *pp = t;
+}
+
+/* queue timer unless already pending with an earlier or equal expiry*/
+void timer_reduce(struct timer_s *t, timeq_t expires)
+{
+    if (!t->pprev || TIME_LT(expires, t->expires))
+	timer_add(t, expires);
+}
+
+/* set select timeout until the first timer is due, return 0 if none pending*/
+int timer_next(struct timeval *tv)
+{
+    long ticks;
+
+    if (!timer_list)
+	return 0;
+    ticks = (long)(timer_list->expires - Now);
+    if (ticks < 0)
+	ticks = 0;
+    tv->tv_sec = ticks >> 4;
+    tv->tv_usec = (ticks & 15) * 62500L;
+    return 1;
+}
+
+/* call the functions of all timers due, which may requeue or delete any timer*/
+void timer_run(void)
+{
+    struct timer_s *t;
+
+    while ((t = timer_list) != NULL && TIME_GEQ(Now, t->expires)) {
+	timer_del(t);
+	t->func(t->arg);
+    }
+}
@@ -2,6 +2,7 @@
 #define TIMER_H
 
 #include <sys/types.h>
+#include <sys/time.h>
 
 /* timeq_t is the time type counted in 62.5ms (1/16 sec) quantums */
 typedef	__u32 timeq_t;
@@ -13,6 +14,23 @@ typedef	__u32 timeq_t;
 
 extern timeq_t Now;
 
+/* timer queued in expiry order, func(arg) called once when Now reaches expires*/
+struct timer_s {
+	struct timer_s	*next;
+	struct timer_s	**pprev;	/* NULL when not queued*/
+	timeq_t		expires;
+	void		(*func)(void *);
+	void		*arg;
+};
+
+#define timer_pending(t)	((t)->pprev != NULL)
+
 timeq_t timer_get_time(void);
+void timer_init(struct timer_s *t, void (*func)(void *), void *arg);
+void timer_add(struct timer_s *t, timeq_t expires);
+void timer_reduce(struct timer_s *t, timeq_t expires);
+void timer_del(struct timer_s *t);
+int timer_next(struct timeval *tv);
+void timer_run(void);
 
 #endif
@@ -0,0 +1,264 @@
+/*
+ * This file is part of the ELKS TCP/IP stack
+ *
+ * UDP datagram sockets. Datagrams are not buffered in a control block
+ * stream: a received datagram is written straight to a waiting recvfrom,
+ * or queued whole, already formatted as the reply to the kernel.
+ *
+ *	This program is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License
+ *	as published by the Free Software Foundation; either version
+ *	2 of the License, or (at your option) any later version.
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#define __KERNEL__
+#include <errno.h>
+#include "config.h"
+#include "ip.h"
+#include "tcp.h"
+#include "tcpdev.h"
+#include "udp.h"
+#include "netconf.h"
+
+static struct udpcb_s *udpcbs;
+static __u16 next_port;
+
+struct udp_pseudo_s {
+	ipaddr_t saddr;
+	ipaddr_t daddr;
+	__u8	zero;
+	__u8	protocol;
+	__u16	len;
+};
+
+int udp_init(void)
+{
+    udpcbs = NULL;
+    next_port = 1024;
+    return 0;
+}
+
+/* returns 0 for a good checksum on receive, or the checksum to send*/
+static __u16 udp_chksum(struct udphdr_s *uh, __u16 len, ipaddr_t saddr, ipaddr_t daddr)
+{
+    struct udp_pseudo_s ph;
+
+    ph.saddr = saddr;
+    ph.daddr = daddr;
+    ph.zero = 0;
+    ph.protocol = PROTO_UDP;
+    ph.len = htons(len);
+    return ~in_chksum(uh, len, in_chksum(&ph, sizeof(ph), 0));
+}
+
+static struct udpcb_s *udpcb_find_by_sock(void *sock)
+{
+    struct udpcb_s *cb;
+
+    for (cb = udpcbs; cb; cb = cb->next)
+	if (cb->sock == sock)
+	    return cb;
+    return NULL;
+}
+
+static struct udpcb_s *udpcb_find_by_port(__u16 port)
+{
+    struct udpcb_s *cb;
+
+    for (cb = udpcbs; cb; cb = cb->next)
+	if (cb->localport == port)
+	    return cb;
+    return NULL;
+}
+
+/* bind socket to *port, or an ephemeral port if zero, which is returned in *port*/
+int udp_bind(void *sock, __u16 *port)
+{
+    struct udpcb_s *cb;
+
+    if (*port == 0) {
+	while (udpcb_find_by_port(next_port)) {
+	    if (++next_port < 1024)
+		next_port = 1024;
+	}
+	*port = next_port++;
+	if (next_port < 1024)
+	    next_port = 1024;
+    } else if (udpcb_find_by_port(*port))
+	return -EADDRINUSE;
+
+    if (!(cb = calloc(1, sizeof(struct udpcb_s))))
+	return -ENOMEM;
+    cb->sock = sock;
+    cb->localport = *port;
+    cb->next = udpcbs;
+    udpcbs = cb;
+    debug_udp("udp: bind sock %p port %u\n", sock, *port);
+    return 0;
+}
+
+/* free control block and queued datagrams, returns 0 if not a UDP socket*/
+int udp_release(void *sock)
+{
+    struct udpcb_s *cb, **pcb;
+    struct udp_dgram_s *d;
+
+    for (pcb = &udpcbs; (cb = *pcb) != NULL; pcb = &cb->next) {
+	if (cb->sock == sock) {
+	    *pcb = cb->next;
+	    while ((d = cb->qhead) != NULL) {
+		cb->qhead = d->next;
+		free(d);
+	    }
+	    debug_udp("udp: release sock %p port %u\n", sock, cb->localport);
+	    free(cb);
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+/*
+ * Send datagram. The data is in the tcpdev command buffer behind the
+ * tdb_sendto header, so the UDP header is built in place in front of it.
+ */
+void udp_sendto(void *sock, ipaddr_t addr, __u16 port, unsigned char *data, int len)
+{
+    struct udpcb_s *cb;
+    struct udphdr_s *uh;
+    struct addr_pair apair;
+
+    if (!(cb = udpcb_find_by_sock(sock))) {
+	debug_udp("udp: sendto on unknown socket %p\n", sock);
+	return;
+    }
+
+    /* convert localhost to local_ip*/
+    if (addr == ntohl(INADDR_LOOPBACK) || addr == 0)
+	addr = local_ip;
+
+    uh = (struct udphdr_s *)(data - sizeof(struct udphdr_s));
+    len += sizeof(struct udphdr_s);
+    uh->sport = htons(cb->localport);
+    uh->dport = port;
+    uh->len = htons(len);
+    uh->chksum = 0;
+    uh->chksum = udp_chksum(uh, len, local_ip, addr);
+    if (uh->chksum == 0)
+	uh->chksum = 0xffff;
+
+    debug_udp("udp: send %d bytes to %s:%u\n", len, in_ntoa(addr), ntohs(port));
+    apair.saddr = local_ip;
+    apair.daddr = addr;
+    apair.protocol = PROTO_UDP;
+    ip_sendpacket((unsigned char *)uh, len, &apair, NULL);
+    netstats.udpsndcnt++;
+}
+
+/* kernel recvfrom: answer from the queue, or hold until a datagram arrives*/
+void udp_recvfrom(void *sock, int nonblock)
+{
+    struct udpcb_s *cb;
+    struct udp_dgram_s *d;
+
+    if (!(cb = udpcb_find_by_sock(sock))) {
+	retval_to_sock(sock, -EINVAL);
+	return;
+    }
+
+    if ((d = cb->qhead) != NULL) {
+	if (!(cb->qhead = d->next))
+	    cb->qtail = NULL;
+	write(tcpdevfd, d->reply, d->len);
+	free(d);
+	notify_sock(sock, TDT_AVAIL_DATA, --cb->qcount);
+	return;
+    }
+
+    if (nonblock)
+	retval_to_sock(sock, -EAGAIN);
+    else
+	cb->wait = 1;
+}
+
+static void udp_fill_reply(struct tdb_recvfrom_ret *ret, void *sock, ipaddr_t saddr,
+	__u16 sport, int len)
+{
+    ret->type = TDT_RECVFROM;
+    ret->ret_value = len;
+    ret->sock = sock;
+    ret->size = len;
+    ret->addr_ip = saddr;
+    ret->addr_port = sport;
+}
+
+void udp_process(struct iphdr_s *iph)
+{
+    struct udphdr_s *uh;
+    struct udpcb_s *cb;
+    struct udp_dgram_s *d;
+    struct tdb_recvfrom_ret *ret;
+    unsigned char *data;
+    ipaddr_t saddr;
+    __u16 sport;
+    int len, hlen;
+
+    hlen = 4 * IP_HLEN(iph);
+    uh = (struct udphdr_s *)((char *)iph + hlen);
+    len = ntohs(uh->len);
+    if (len < (int)sizeof(struct udphdr_s) || len > ntohs(iph->tot_len) - hlen) {
+	debug_udp("udp: bad length %d\n", len);
+	goto drop;
+    }
+    if (uh->chksum && udp_chksum(uh, len, iph->saddr, iph->daddr)) {
+	printf("udp: BAD CHECKSUM from %s\n", in_ntoa(iph->saddr));
+	goto drop;
+    }
+
+    if (!(cb = udpcb_find_by_port(ntohs(uh->dport)))) {
+	debug_udp("udp: no socket for port %u\n", ntohs(uh->dport));
+	goto drop;
+    }
+
+    saddr = iph->saddr;
+    sport = uh->sport;
+    data = (unsigned char *)(uh + 1);
+    len -= sizeof(struct udphdr_s);
+    debug_udp("udp: recv %d bytes from %s:%u\n", len, in_ntoa(saddr), ntohs(sport));
+
+    if (cb->wait) {
+	/* reply header fits in place of the IP and UDP headers*/
+	ret = (struct tdb_recvfrom_ret *)(data - sizeof(struct tdb_recvfrom_ret));
+	udp_fill_reply(ret, cb->sock, saddr, sport, len);
+	write(tcpdevfd, ret, sizeof(struct tdb_recvfrom_ret) + len);
+	cb->wait = 0;
+    } else {
+	if (cb->qcount >= UDP_QUEUE_MAX ||
+	    !(d = malloc(sizeof(struct udp_dgram_s) + sizeof(struct tdb_recvfrom_ret) + len))) {
+	    debug_udp("udp: queue full on port %u\n", cb->localport);
+	    goto drop;
+	}
+	d->next = NULL;
+	d->len = sizeof(struct tdb_recvfrom_ret) + len;
+	ret = (struct tdb_recvfrom_ret *)d->reply;
+	udp_fill_reply(ret, cb->sock, saddr, sport, len);
+	memcpy(ret->data, data, len);
+	if (cb->qtail)
+	    cb->qtail->next = d;
+	else
+	    cb->qhead = d;
+	cb->qtail = d;
+	notify_sock(cb->sock, TDT_AVAIL_DATA, ++cb->qcount);
+    }
+    netstats.udprcvcnt++;
+    return;
+
+drop:
+    netstats.udpdropcnt++;
+}
@@ -0,0 +1,39 @@
+#ifndef UDP_H
+#define UDP_H
+
+#define PROTO_UDP	17
+
+#define UDP_QUEUE_MAX	4	/* max datagrams queued per socket*/
+
+struct udphdr_s {
+	__u16	sport;
+	__u16	dport;
+	__u16	len;		/* header and data length*/
+	__u16	chksum;
+};
+
+/* datagram queued for a socket, stored as the reply sent to the kernel*/
+struct udp_dgram_s {
+	struct udp_dgram_s *next;
+	unsigned int len;		/* reply header and data length*/
+	unsigned char reply[];		/* struct tdb_recvfrom_ret and data*/
+};
+
+struct udpcb_s {
+	struct udpcb_s *next;
+	void *	sock;
+	__u16	localport;
+	unsigned char wait;		/* blocking recvfrom outstanding*/
+	unsigned char qcount;		/* datagrams queued*/
+	struct udp_dgram_s *qhead;
+	struct udp_dgram_s *qtail;
+};
+
+int udp_init(void);
+int udp_bind(void *sock, __u16 *port);
+int udp_release(void *sock);
+void udp_sendto(void *sock, ipaddr_t addr, __u16 port, unsigned char *data, int len);
+void udp_recvfrom(void *sock, int nonblock);
+void udp_process(struct iphdr_s *iph);
+
+#endif
@@ -39,14 +39,19 @@ Created:	Nov 11, 1993 by Philip Homburg <philip@cs.vu.nl>
 #define IH_DONT_FRAG    0x4000
 #define IH_FRAGOFF_MASK 0x1fff
 
+#define VJHC_HASH	16		/* send state hash buckets, power of 2 */
+
 typedef struct snd_state
 {
 	int s_indx;
+	int s_used;
 	ipaddr_t s_src_ip;
 	ipaddr_t s_dst_ip;
 	__u32 s_srcdst_port;
+	struct snd_state *s_next;	/* LRU list, most recent first */
+	struct snd_state *s_prev;
+	struct snd_state *s_hnext;	/* hash chain */
 	char s_data[IP_MAX_HDR_SIZE + TCP_MAX_HDR_SIZE];
-	struct snd_state *s_next;
 } snd_state_ut;
 
 typedef struct rcv_state
@@ -57,15 +62,17 @@ typedef struct rcv_state
 } rcv_state_ut;
 
 int ip_snd_vjhc= 0;
-int ip_snd_vjhc_compress_cid= 0;
+int ip_snd_vjhc_compress_cid= 1;
 int ip_snd_vjhc_state_nr= 16;
 int ip_rcv_vjhc= 0;
-int ip_rcv_vjhc_compress_cid= 0;
+int ip_rcv_vjhc_compress_cid= 1;
 int ip_rcv_vjhc_state_nr= 16;
 
 static int xmit_last;
 static snd_state_ut *xmit_state= NULL;
 static snd_state_ut *xmit_head;
+static snd_state_ut *xmit_tail;
+static snd_state_ut *xmit_hash[VJHC_HASH];
 
 static int rcv_toss;
 static rcv_state_ut *rcv_state;
@@ -95,92 +102,143 @@ static unsigned long ntohl(unsigned long x)
 }
 #endif
 
-void vjhc_encode(__u8 *cp, const __u32 n)
+/* The encoders and decoders return the advanced header pointer */
+
+static __u8 *vjhc_encode(__u8 *cp, __u16 n)
 {
-	if ((__u16)n >= 256) {
-		*cp++ = 0;
-		*cp++ = (n >> 8);
-		*cp++ = n;
-	} else *cp++ = n;
+	if (n >= 256) {
+		cp[0] = 0;
+		cp[1] = n >> 8;
+		cp[2] = n;
+		return cp + 3;
+	}
+	*cp = n;
+	return cp + 1;
 }
 
-void vjhc_encodez(__u8 *cp, const __u32 n)
+/* as vjhc_encode but zero can't be sent as a single byte */
+static __u8 *vjhc_encodez(__u8 *cp, __u16 n)
 {
-	if ((__u16)n == 0 || (__u16)n >= 256) {
-		*cp++ = 0;
-		*cp++ = (n >> 8);
-		*cp++ = n;
-	} else *cp++ = n;
+	if (n == 0 || n >= 256) {
+		cp[0] = 0;
+		cp[1] = n >> 8;
+		cp[2] = n;
+		return cp + 3;
+	}
+	*cp = n;
+	return cp + 1;
 }
 
-void vjhc_decodel(__u8 *cp, __u32 *l)
+/* get an encoded delta */
+static __u8 *vjhc_decode(__u8 *cp, __u16 *n)
 {
 	if (*cp == 0) {
-		*l = htonl(ntohl(*l) + ((cp[1] << 8) | cp[2]));
-		cp += 3;
-	} else *l = htonl(ntohl(*l) + (__u32)*cp++);
+		*n = (cp[1] << 8) | cp[2];
+		return cp + 3;
+	}
+	*n = *cp;
+	return cp + 1;
 }
 
-void vjhc_decodes(__u8 *cp, __u16 *s)
+static __u8 *vjhc_decodel(__u8 *cp, __u32 *l)
 {
-	if (*cp == 0) {
-		*s = htons(ntohs(*s) + ((cp[1] << 8) | cp[2]));
-		cp += 3;
-	} else *s = htons(ntohs(*s) + (__u16)*cp++);
+	__u16 n;
+
+	cp = vjhc_decode(cp, &n);
+	*l = htonl(ntohl(*l) + n);
+	return cp;
 }
 
-void vjhc_decodeu(__u8 *cp, __u16 *s)
+static __u8 *vjhc_decodes(__u8 *cp, __u16 *s)
 {
-	if (*cp == 0) {
-		*s = htons((cp[1] << 8) | cp[2]);
-		cp += 3;
-	} else *s = htons((__u16)*cp++);
+	__u16 n;
+
+	cp = vjhc_decode(cp, &n);
+	*s = htons(ntohs(*s) + n);
+	return cp;
 }
 
 
 /*************************************************************/
 
-
-int ip_vjhc_init(void)
+static int vjhc_hash(ipaddr_t src, ipaddr_t dst, __u32 ports)
 {
-	int i;
+	__u32 h = src ^ dst ^ ports;
+	__u16 x = (__u16)h ^ (__u16)(h >> 16);
 
-	ip_snd_vjhc++;  /* enable send compression */
-	ip_rcv_vjhc++;  /* enable recv compression */
-	ip_snd_vjhc_compress_cid++;
-	ip_rcv_vjhc_compress_cid++;
+	return (x ^ (x >> 8) ^ (x >> 4)) & (VJHC_HASH - 1);
+}
 
-	if (ip_snd_vjhc)
-	{
-		xmit_last= -1;
-		if (xmit_state != NULL)
-			free(xmit_state);
-		xmit_state= calloc(ip_snd_vjhc_state_nr, sizeof(snd_state_ut));
-		if (!xmit_state) {
-			printf("ktcp: Out of memory 3\n");
-			return -1;
-		}
+static void vjhc_hash_remove(snd_state_ut *state)
+{
+	snd_state_ut **pp;
 
-		xmit_head= 0;
-		for (i= 0; i<ip_snd_vjhc_state_nr; i++)
-		{
-			xmit_state[i].s_indx= i;
-			xmit_state[i].s_next= xmit_head;
-			xmit_head= &xmit_state[i];
+	pp= &xmit_hash[vjhc_hash(state->s_src_ip, state->s_dst_ip, state->s_srcdst_port)];
+	for (; *pp; pp= &(*pp)->s_hnext) {
+		if (*pp == state) {
+			*pp= state->s_hnext;
+			break;
 		}
 	}
+}
+
+/* move state to the front of the LRU list */
+static void vjhc_touch(snd_state_ut *state)
+{
+	if (state == xmit_head)
+		return;
+	state->s_prev->s_next= state->s_next;
+	if (state->s_next)
+		state->s_next->s_prev= state->s_prev;
+	else xmit_tail= state->s_prev;
+	state->s_prev= NULL;
+	state->s_next= xmit_head;
+	xmit_head->s_prev= state;
+	xmit_head= state;
+}
+
+/* allocate the send state tables, on startup or when the peer is seen to compress */
+int ip_vjhc_snd_init(void)
+{
+	int i;
 
-	if (ip_rcv_vjhc)
+	if (ip_snd_vjhc)
+		return 0;
+	xmit_state= calloc(ip_snd_vjhc_state_nr, sizeof(snd_state_ut));
+	if (!xmit_state) {
+		printf("ktcp: Out of memory 3\n");
+		return -1;
+	}
+	xmit_last= -1;
+	xmit_head= xmit_tail= NULL;
+	for (i= 0; i<ip_snd_vjhc_state_nr; i++)
 	{
-		if (rcv_state != NULL)
-			free(rcv_state);
-		rcv_state= calloc(ip_rcv_vjhc_state_nr, sizeof(snd_state_ut));
+		xmit_state[i].s_indx= i;
+		xmit_state[i].s_next= xmit_head;
+		if (xmit_head)
+			xmit_head->s_prev= &xmit_state[i];
+		else xmit_tail= &xmit_state[i];
+		xmit_head= &xmit_state[i];
+	}
+	ip_snd_vjhc= 1;
+	return 0;
+}
+
+/* allocate receive state tables, and send tables too if compressing from the start */
+int ip_vjhc_init(int compress)
+{
+	if (!ip_rcv_vjhc) {
+		rcv_state= calloc(ip_rcv_vjhc_state_nr, sizeof(rcv_state_ut));
 		if (!rcv_state) {
 			printf("ktcp: Out of memory 4\n");
 			return -1;
 		}
+		rcv_toss= 1;		/* until an uncompressed packet sets up a slot */
+		ip_rcv_vjhc= 1;
 	}
-    return 0;
+	if (compress)
+		return ip_vjhc_snd_init();
+	return 0;
 }
 
 int ip_vjhc_compress(pkt_ut *pkt)
@@ -188,8 +246,8 @@ int ip_vjhc_compress(pkt_ut *pkt)
 	iphdr_t *ip_hdr, *oip_hdr;
 	tcphdr_t *tcp_hdr, *otcp_hdr;
 	int ip_hdr_len, tcp_hdr_len, tot_len;
-	snd_state_ut *prev, *state, *next;
-	int changes;
+	snd_state_ut *state;
+	int changes, hash;
 	__u8 new_hdr[16], *cp;
 	__u32 delta, deltaA, deltaS;
 	__u16 cksum;
@@ -229,42 +287,34 @@ int ip_vjhc_compress(pkt_ut *pkt)
 		DPRINTF("%x ", *cp);
 	DPRINTF("\n");
 #endif
-	for (prev = NULL, state = xmit_head;;) {
+	hash= vjhc_hash(ip_hdr->saddr, ip_hdr->daddr, *(__u32 *)&tcp_hdr->sport);
+	for (state= xmit_hash[hash]; state; state= state->s_hnext) {
 		if (ip_hdr->saddr == state->s_src_ip &&
 			ip_hdr->daddr == state->s_dst_ip &&
 			*(__u32 *)&tcp_hdr->sport == state->s_srcdst_port)
-		{
-			debug_cslip("cslip compress: found entry\n");
-			if (prev != NULL) {
-				debug_cslip("cslip compress: moving entry to front\n");
-				prev->s_next= state->s_next;
-				state->s_next= xmit_head;
-				xmit_head= state;
-			}
 			break;
-		}
-		next= state->s_next;
-		if (next != NULL) {
-			prev= state;
-			state= next;
-			continue;
-		}
-
-		/* Not found */
-		if (prev != NULL) {
-			prev->s_next= state->s_next;
-			state->s_next= xmit_head;
-			xmit_head= state;
-		}
+	}
+	if (!state) {
+		/* Not found, reuse the least recently used slot */
+		state= xmit_tail;
+		if (state->s_used)
+			vjhc_hash_remove(state);
+		state->s_used= 1;
 		state->s_src_ip= ip_hdr->saddr;
 		state->s_dst_ip= ip_hdr->daddr;
 		state->s_srcdst_port= *(__u32 *)&tcp_hdr->sport;
+		state->s_hnext= xmit_hash[hash];
+		xmit_hash[hash]= state;
+		vjhc_touch(state);
 		debug_cslip("cslip compress: new entry: %lx, %lx, %lx\n",
 			state->s_src_ip, state->s_dst_ip, state->s_srcdst_port);
 		memcpy(state->s_data, ip_hdr, tot_len);
 		xmit_last= ip_hdr->protocol= state->s_indx;
 		return PPP_TYPE_VJHC_UNCOMPR;
 	}
+	debug_cslip("cslip compress: found entry\n");
+	vjhc_touch(state);
+
 	oip_hdr= (iphdr_t *)(state->s_data);
 	otcp_hdr= (tcphdr_t *)(state->s_data + ip_hdr_len);
 
@@ -286,7 +336,7 @@ int ip_vjhc_compress(pkt_ut *pkt)
 
 	if (tcp_hdr->flags & TF_URG) {
 		delta= ntohs(tcp_hdr->urgpnt);
-		vjhc_encodez(cp, delta);
+		cp= vjhc_encodez(cp, delta);
 		changes |= VJHC_FLAG_U;
 	} else if (tcp_hdr->urgpnt != otcp_hdr->urgpnt) {
 		debug_cslip("cslip compress: unexpected urgent pointer change\n");
@@ -296,7 +346,7 @@ int ip_vjhc_compress(pkt_ut *pkt)
 	}
 
 	if ((delta= (__u16)(ntohs(tcp_hdr->window) - ntohs(otcp_hdr->window))) != 0) {
-		vjhc_encode(cp, delta);
+		cp= vjhc_encode(cp, delta);
 		changes |= VJHC_FLAG_W;
 	}
 	if ((deltaA= (__u32)(ntohl(tcp_hdr->acknum) - ntohl(otcp_hdr->acknum))) != 0) {
@@ -308,7 +358,7 @@ int ip_vjhc_compress(pkt_ut *pkt)
 		}
 		debug_cslip("cslip compress: ack= 0x%08lx, oack= 0x%08lx, deltaA= 0x%lx\n",
 			tcp_hdr->acknum, otcp_hdr->acknum, deltaA);
-		vjhc_encode(cp, deltaA);
+		cp= vjhc_encode(cp, deltaA);
 		changes |= VJHC_FLAG_A;
 	}
 	if ((deltaS= (__u32)(ntohl(tcp_hdr->seqnum) - ntohl(otcp_hdr->seqnum))) != 0) {
@@ -318,7 +368,7 @@ int ip_vjhc_compress(pkt_ut *pkt)
 			xmit_last= ip_hdr->protocol= state->s_indx;
 			return PPP_TYPE_VJHC_UNCOMPR;
 		}
-		vjhc_encode(cp, deltaS);
+		cp= vjhc_encode(cp, deltaS);
 		changes |= VJHC_FLAG_S;
 	}
 
@@ -356,7 +406,7 @@ int ip_vjhc_compress(pkt_ut *pkt)
 	}
 
 	if ((delta= ntohs(ip_hdr->id) - ntohs(oip_hdr->id)) != 1) {
-		vjhc_encodez(cp, delta);
+		cp= vjhc_encodez(cp, delta);
 		changes |= VJHC_FLAG_I;
 	}
 	if (tcp_hdr->flags & TF_PSH) changes |= VJHC_FLAG_P;
@@ -408,7 +458,9 @@ void ip_vjhc_arr_uncompr(pkt_ut *pkt)
 	tot_len= ip_hdr_len + tcp_hdr_len;
 	memcpy(state->s_data, ip_hdr, tot_len);
 	ip_hdr= (iphdr_t *)state->s_data;
+	/* saved header checksum is kept valid, compressed packets update it */
 	ip_hdr->check= 0;
+	ip_hdr->check= ip_calc_chksum((char *)ip_hdr, ip_hdr_len);
 	state->s_ip_hdr_len= ip_hdr_len;
 	state->s_tot_len= tot_len;
 	rcv_toss= 0;
@@ -425,6 +477,7 @@ void ip_vjhc_arr_compr(pkt_ut *pkt)
 	int changes;
 	__u8 *cp;
 	__u32 delta;
+	__u16 old_id, old_len;
 	int tot_len;
 
 	cp= (__u8 *)pkt->p_data + pkt->p_offset;
@@ -476,19 +529,21 @@ void ip_vjhc_arr_compr(pkt_ut *pkt)
 	default:
 		if (changes & VJHC_FLAG_U) {
 			tcp_hdr->flags |= TF_URG;
-			vjhc_decodeu(cp, &tcp_hdr->urgpnt);
+			cp= vjhc_decode(cp, &tcp_hdr->urgpnt);
+			tcp_hdr->urgpnt= htons(tcp_hdr->urgpnt);
 		} else tcp_hdr->flags &= ~TF_URG;
-		if (changes & VJHC_FLAG_W) vjhc_decodes(cp, &tcp_hdr->window);
+		if (changes & VJHC_FLAG_W) cp= vjhc_decodes(cp, &tcp_hdr->window);
 		if (changes & VJHC_FLAG_A) {
 			debug_cslip("cslip arr_compr: oack= 0x%08lx\n", tcp_hdr->acknum);
-			vjhc_decodel(cp, &tcp_hdr->acknum);
+			cp= vjhc_decodel(cp, &tcp_hdr->acknum);
 			debug_cslip("cslip arr_compr: ack= 0x%08lx\n", tcp_hdr->acknum);
 		}
-		if (changes & VJHC_FLAG_S) vjhc_decodel(cp, &tcp_hdr->seqnum);
+		if (changes & VJHC_FLAG_S) cp= vjhc_decodel(cp, &tcp_hdr->seqnum);
 		break;
 	}
 
-	if (changes & VJHC_FLAG_I) vjhc_decodes(cp, &ip_hdr->id);
+	old_id= ip_hdr->id;
+	if (changes & VJHC_FLAG_I) cp= vjhc_decodes(cp, &ip_hdr->id);
 	else ip_hdr->id= htons(ntohs(ip_hdr->id) + 1);
 
 	delta= cp - (__u8 *)(pkt->p_data+pkt->p_offset);
@@ -509,11 +564,13 @@ void ip_vjhc_arr_compr(pkt_ut *pkt)
 	pkt->p_offset -= tot_len;
 	pkt->p_size += tot_len;
 	cp= (__u8 *)pkt->p_data+pkt->p_offset;
+	old_len= ip_hdr->tot_len;
 	ip_hdr->tot_len= htons(pkt->p_size);
+	/* only id and length differ from the saved header, RFC 1624 update */
+	ip_hdr->check= in_chksum_adjust(ip_hdr->check, old_id, ip_hdr->id);
+	ip_hdr->check= in_chksum_adjust(ip_hdr->check, old_len, ip_hdr->tot_len);
 	memcpy(cp, ip_hdr, tot_len);
 	ip_hdr= (iphdr_t *)cp;
-	ip_hdr->check= 0;
-	ip_hdr->check= ip_calc_chksum((char *)ip_hdr, state->s_ip_hdr_len);
 #if DEBUG_CSLIP
 	DPRINTF("cslip arr_compr: packet with size %d\n\t", pkt->p_size);
 	for (cp= (__u8 *)pkt->p_data+pkt->p_offset;
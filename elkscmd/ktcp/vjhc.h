@@ -68,7 +68,8 @@ extern int ip_rcv_vjhc;
 extern int ip_rcv_vjhc_state_nr;
 extern int ip_rcv_vjhc_compress_cid;
 
-int ip_vjhc_init(void);
+int ip_vjhc_init(int compress);
+int ip_vjhc_snd_init(void);
 int ip_vjhc_compress(pkt_ut *pkt);
 void ip_vjhc_arr_uncompr(pkt_ut *pkt);
 void ip_vjhc_arr_compr(pkt_ut *pkt);
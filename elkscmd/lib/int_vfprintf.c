@@ -0,0 +1,305 @@
+/*
+ * Integer only vfprintf - based on ELKS stdio
+ *
+ * Faster replacement for programs that print no floating point, linked
+ * ahead of libc with $(INTPRINTF). Unlike tiny_vfprintf it works with any
+ * stream, including sprintf and files.
+ *   Numbers that fit in 16 bits are converted with 16-bit division only,
+ *   and long ones a digit at a time with 16-bit division of byte limbs,
+ *   so the 32-bit divide helpers aren't used.
+ *   Literal text and fields are copied straight into the stream buffer
+ *   when there's room, rather than a character at a time.
+ *
+ * Limitations:
+ *	%e, %f, %g are not supported and print the format character
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char ldigits[] = "0123456789abcdef";
+static const char udigits[] = "0123456789ABCDEF";
+
+/*
+ * Convert val to a string ending at p, returning its start.
+ */
+static char *
+numtostr(char *p, unsigned long val, unsigned int radix, const char *digits)
+{
+   unsigned int v, hi, t, q1, q2;
+
+   *p = '\0';
+   while (val > 0xFFFFU)
+   {
+      hi = (unsigned int)(val >> 16);
+      v = (unsigned int)val;
+      q1 = hi / radix;
+      t = ((hi % radix) << 8) | (v >> 8);
+      q2 = t / radix;
+      t = ((t % radix) << 8) | (v & 0xFF);
+      val = ((unsigned long)q1 << 16) | (q2 << 8) | (t / radix);
+      *--p = digits[t % radix];
+   }
+   v = (unsigned int)val;
+   do {
+      *--p = digits[v % radix];
+   } while ((v /= radix) != 0);
+   return p;
+}
+
+static void
+putbuf(FILE *op, const char *s, int len, int buffer_mode)
+{
+   /* copy directly if the putc macro could write it all */
+   if (op->bufwrite - op->bufpos >= len)
+   {
+      memcpy(op->bufpos, s, len);
+      op->bufpos += len;
+      if (buffer_mode == _IOLBF && memchr(s, '\n', len))
+	 fflush(op);
+      return;
+   }
+   while (len-- > 0)
+   {
+      putc(*s, op);
+      if (*s++ == '\n' && buffer_mode == _IOLBF)
+	 fflush(op);
+   }
+}
+
+static void
+putpad(FILE *op, char pad, int n)
+{
+   while (n-- > 0)
+      putc(pad, op);
+}
+
+/*
+ * Output the given field in the manner specified by the arguments. Return
+ * the number of characters output.
+ */
+static int
+printfield(FILE *op, char *buf,
+	int ljustf, char sign, char pad, int width, int preci, int buffer_mode)
+{
+   int len, total;
+
+   len = strlen(buf);
+
+   if (*buf == '-')
+   {
+      sign = *buf++;
+      --len;
+   }
+   total = len + (sign != '\0');
+
+   if ((preci != -1) && (total > preci))	/* limit max data width */
+   {
+      total = preci;
+      len = total - (sign != '\0');
+      if (len < 0)
+	 len = total = sign = 0;
+   }
+
+   if (width < total)		/* flexible field width or width overflow */
+      width = total;
+   width -= total;
+
+   if (!ljustf && pad == ' ')
+      putpad(op, ' ', width);
+   if (sign)
+      putc(sign, op);
+   if (!ljustf && pad == '0')
+      putpad(op, '0', width);
+   putbuf(op, buf, len, buffer_mode);
+   if (ljustf)
+      putpad(op, ' ', width);
+
+   return total + width;
+}
+
+int
+vfprintf(FILE *op, const char *fmt, va_list ap)
+{
+   int i, cnt = 0, ljustf, lval, neg;
+   int   preci, dpoint, width;
+   char  pad, sign, hash;
+   unsigned int radix;
+   unsigned long uval;
+   const char *digits;
+   const char *start;
+   char *ptmp;
+   char  tmp[36];
+   int buffer_mode;
+
+   /* This speeds things up a bit for unbuffered */
+   buffer_mode = (op->mode&__MODE_BUF);
+   op->mode &= (~__MODE_BUF);
+
+   while (*fmt)
+   {
+      if (*fmt != '%')
+      {
+	 /* copy literal text up to the next directive */
+	 start = fmt;
+	 while (*fmt && *fmt != '%')
+	    ++fmt;
+	 putbuf(op, start, fmt - start, buffer_mode);
+	 cnt += fmt - start;
+	 continue;
+      }
+
+      if( buffer_mode == _IONBF ) fflush(op);
+      ljustf = 0;		/* left justify flag */
+      sign = '\0';		/* sign char & status */
+      pad = ' ';		/* justification padding char */
+      width = -1;		/* min field width */
+      dpoint = 0;		/* found decimal point */
+      preci = -1;		/* max data width */
+      radix = 10;		/* number base */
+      digits = ldigits;
+      ptmp = tmp;		/* pointer to area to print */
+      hash = 0;
+      lval = 0;			/* long value flaged */
+    fmtnxt:
+      i = 0;
+      for(;;)
+      {
+	 ++fmt;
+	 if(*fmt < '0' || *fmt > '9' ) break;
+	 i = (i * 10) + (*fmt - '0');
+	 if (dpoint)
+	    preci = i;
+	 else if (!i && (pad == ' '))
+	 {
+	    pad = '0';
+	    goto fmtnxt;
+	 }
+	 else
+	    width = i;
+      }
+
+      switch (*fmt)
+      {
+      case '\0':		/* early EOS */
+	 --fmt;
+	 goto charout;
+
+      case '-':			/* left justification */
+	 ljustf = 1;
+	 goto fmtnxt;
+
+      case ' ':
+      case '+':			/* leading sign flag */
+	 sign = *fmt;
+	 goto fmtnxt;
+
+      case '*':			/* parameter width value */
+	 i = va_arg(ap, int);
+	 if (dpoint)
+	    preci = i;
+	 else {
+	    if (i < 0) {
+	       width = -i;
+	       ljustf = 1;
+	    } else width = i;
+	 }
+	 goto fmtnxt;
+
+      case '.':			/* secondary width field */
+	 dpoint = 1;
+	 goto fmtnxt;
+
+      case 'l':			/* long data */
+	 lval = 1;
+	 goto fmtnxt;
+
+      case 'h':			/* short data */
+	 lval = 0;
+	 goto fmtnxt;
+
+      case '#':
+	 hash = 1;
+	 goto fmtnxt;
+
+      case 'd':			/* Signed decimal */
+      case 'i':
+	 if (lval)
+	 {
+	    long l = va_arg(ap, long);
+	    neg = (l < 0);
+	    uval = neg? 0UL - l: (unsigned long)l;
+	 }
+	 else
+	 {
+	    int n = va_arg(ap, int);
+	    neg = (n < 0);
+	    uval = neg? 0U - n: (unsigned int)n;
+	 }
+	 ptmp = numtostr(tmp + sizeof(tmp) - 1, uval, 10, digits);
+	 if (neg)
+	    *--ptmp = '-';
+	 goto printit;
+
+      case 'b':			/* Unsigned binary */
+	 radix = 2;
+	 goto usproc;
+
+      case 'o':			/* Unsigned octal */
+	 radix = 8;
+	 goto usproc;
+
+      case 'p':			/* Pointer */
+	 lval = (sizeof(char*) == sizeof(long));
+	 pad = '0';
+	 width = 6;
+	 preci = 8;
+	 /* fall thru */
+
+      case 'X':			/* Unsigned hexadecimal */
+	 if (*fmt == 'X')
+	    digits = udigits;
+	 /* fall thru */
+
+      case 'x':
+	 radix = 16;
+	 /* fall thru */
+
+      case 'u':			/* Unsigned decimal */
+       usproc:
+	 uval = lval? va_arg(ap, unsigned long): va_arg(ap, unsigned int);
+	 ptmp = numtostr(tmp + sizeof(tmp) - 1, uval, radix, digits);
+	 if( hash && radix == 8 ) { width = strlen(ptmp)+1; pad='0'; }
+	 goto printit;
+
+      case 'c':			/* Character */
+	 ptmp[0] = va_arg(ap, int);
+	 ptmp[1] = '\0';
+	 goto nopad;
+
+      case 's':			/* String */
+	 ptmp = va_arg(ap, char*);
+	 if (!ptmp) ptmp = "(null)";
+       nopad:
+	 sign = '\0';
+	 pad = ' ';
+       printit:
+	 cnt += printfield(op, ptmp, ljustf, sign, pad, width, preci,
+			   buffer_mode);
+	 break;
+
+      default:			/* unknown character */
+       charout:
+	 putc(*fmt, op);
+	 ++cnt;
+	 if( *fmt == '\n' && buffer_mode == _IOLBF ) fflush(op);
+	 break;
+      }
+      ++fmt;
+   }
+   op->mode |= buffer_mode;
+   if( buffer_mode == _IONBF ) fflush(op);
+   if( buffer_mode == _IOLBF ) op->bufwrite = op->bufstart;
+   return (cnt);
+}
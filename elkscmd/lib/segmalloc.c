@@ -0,0 +1,274 @@
+/*
+ * Segregated fit malloc/free/realloc
+ *
+ * Replaces the libc allocator when linked ahead of libc with $(SEGMALLOC).
+ * Freed blocks up to SMALL_MAX bytes go on an exact size class list, so
+ * small malloc and free are O(1) and don't walk the heap. Larger blocks
+ * are kept on one first fit free list in address order and are coalesced
+ * with their neighbours when freed. Before the heap is grown with sbrk,
+ * the size class lists are coalesced into the large list if they hold
+ * enough bytes to possibly satisfy the request.
+ *
+ * Set STATS=1 for heap statistics, returned by segmalloc_stats().
+ */
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "segmalloc.h"
+
+#define STATS		1		/* =1 to keep heap statistics*/
+
+typedef union header {
+	unsigned int size;		/* block bytes including header, | INUSE*/
+	void *align;
+} header;
+
+struct block {
+	header h;
+	struct block *next;		/* free list link, only while free*/
+};
+
+#define HDR		sizeof(header)
+#define ALIGN		sizeof(header)
+#define MINBLK		sizeof(struct block)
+#define INUSE		1
+#define SMALL_MAX	128		/* largest block kept by size class*/
+#define NCLASS		(SMALL_MAX / ALIGN + 1)
+#define GROW		1024		/* minimum heap increase*/
+#define TRIM		(2 * GROW)	/* free top of heap larger than this*/
+
+#define bsize(b)	((b)->h.size & ~INUSE)
+#define bnext(b)	((struct block *)((char *)(b) + bsize(b)))
+
+static struct block *bins[NCLASS];	/* exact size free lists*/
+static struct block *large;		/* first fit list, address order*/
+static unsigned int binned;		/* bytes on size class lists*/
+
+#if STATS
+static struct segmalloc_stats st;
+#define STAT(x)		(x)
+#else
+#define STAT(x)
+#endif
+
+/* add block to large list, coalescing with neighbours, return merged block*/
+static struct block *insert_large(struct block *b)
+{
+	struct block **pp = &large;
+	struct block *p, *prev = NULL;
+
+	while ((p = *pp) != NULL && p < b) {
+		prev = p;
+		pp = &p->next;
+	}
+	if (p && bnext(b) == p) {
+		b->h.size += p->h.size;
+		b->next = p->next;
+	} else
+		b->next = p;
+	if (prev && bnext(prev) == b) {
+		prev->h.size += b->h.size;
+		prev->next = b->next;
+		return prev;
+	}
+	*pp = b;
+	return b;
+}
+
+/* first fit from large list, allocating from the top of a split block*/
+static struct block *fit(unsigned int sz)
+{
+	struct block **pp, *b;
+
+	for (pp = &large; (b = *pp) != NULL; pp = &b->next) {
+		if (b->h.size < sz)
+			continue;
+		if (b->h.size - sz >= MINBLK) {
+			b->h.size -= sz;
+			b = bnext(b);
+			b->h.size = sz;
+		} else
+			*pp = b->next;
+		return b;
+	}
+	return NULL;
+}
+
+/* move all size class blocks to the large list so they can coalesce*/
+static void consolidate(void)
+{
+	struct block *b;
+	int i;
+
+	STAT(st.consolidations++);
+	for (i = 0; i < NCLASS; i++) {
+		while ((b = bins[i]) != NULL) {
+			bins[i] = b->next;
+			insert_large(b);
+		}
+	}
+	binned = 0;
+}
+
+/* extend the heap by at least sz bytes*/
+static int grow(unsigned int sz)
+{
+	struct block *b;
+	unsigned int n;
+	size_t top;
+
+	top = (size_t)sbrk(0);
+	if (top & (ALIGN - 1))
+		sbrk(ALIGN - (top & (ALIGN - 1)));
+
+	n = (sz < GROW)? GROW: sz;
+	b = (struct block *)sbrk(n);
+	if (b == (struct block *)-1 && n != sz) {
+		n = sz;
+		b = (struct block *)sbrk(n);
+	}
+	if (b == (struct block *)-1)
+		return 0;
+	STAT(st.arena += n);
+	b->h.size = n;
+	insert_large(b);
+	return 1;
+}
+
+void *malloc(size_t size)
+{
+	struct block *b;
+	unsigned int sz;
+
+	if (size == 0)
+		return NULL;
+	if (size > ((unsigned int)-1 >> 1) - GROW) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	sz = (size + HDR + ALIGN - 1) & ~(ALIGN - 1);
+	if (sz < MINBLK)
+		sz = MINBLK;
+
+	STAT(st.mallocs++);
+	if (sz <= SMALL_MAX && (b = bins[sz / ALIGN]) != NULL) {
+		bins[sz / ALIGN] = b->next;
+		binned -= sz;
+		STAT(st.small_hits++);
+	} else if ((b = fit(sz)) == NULL) {
+		if (binned >= sz) {
+			consolidate();
+			b = fit(sz);
+		}
+		if (!b && (!grow(sz) || (b = fit(sz)) == NULL)) {
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+	STAT(st.inuse += b->h.size);
+	STAT(st.blocks++);
+	b->h.size |= INUSE;
+	return (char *)b + HDR;
+}
+
+void free(void *ptr)
+{
+	struct block *b;
+	unsigned int sz, n;
+
+	if (ptr == NULL)
+		return;
+	b = (struct block *)((char *)ptr - HDR);
+	sz = bsize(b);
+	b->h.size = sz;
+	STAT(st.frees++);
+	STAT(st.inuse -= sz);
+	STAT(st.blocks--);
+
+	if (sz <= SMALL_MAX) {
+		b->next = bins[sz / ALIGN];
+		bins[sz / ALIGN] = b;
+		binned += sz;
+		return;
+	}
+
+	b = insert_large(b);
+	if (b->h.size > TRIM && bnext(b) == (struct block *)sbrk(0)) {
+		n = (b->h.size - GROW) & ~(ALIGN - 1);
+		b->h.size -= n;
+		if (brk(bnext(b)) == 0) {
+			STAT(st.arena -= n);
+		} else
+			b->h.size += n;
+	}
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	struct block *b, *p, **pp;
+	unsigned int sz, osz;
+	void *nptr;
+
+	if (ptr == NULL)
+		return malloc(size);
+	if (size > ((unsigned int)-1 >> 1) - GROW) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	b = (struct block *)((char *)ptr - HDR);
+	osz = bsize(b);
+	sz = (size + HDR + ALIGN - 1) & ~(ALIGN - 1);
+	if (sz < MINBLK)
+		sz = MINBLK;
+
+	if (sz > osz) {
+		/* grow in place into a following free block or the top of the heap*/
+		p = bnext(b);
+		for (pp = &large; *pp && *pp < p; pp = &(*pp)->next)
+			continue;
+		if (*pp == p && osz + p->h.size >= sz) {
+			*pp = p->next;
+			b->h.size += p->h.size;
+			STAT(st.inuse += p->h.size);
+		} else if (p == (struct block *)sbrk(0) &&
+				sbrk(sz - osz) != (void *)-1) {
+			b->h.size += sz - osz;
+			STAT(st.arena += sz - osz);
+			STAT(st.inuse += sz - osz);
+		} else {
+			if ((nptr = malloc(size)) == NULL)
+				return NULL;
+			memcpy(nptr, ptr, osz - HDR);
+			free(ptr);
+			return nptr;
+		}
+		osz = bsize(b);
+	}
+
+	/* return any usable tail*/
+	if (osz - sz >= MINBLK) {
+		b->h.size = sz | INUSE;
+		p = bnext(b);
+		p->h.size = (osz - sz) | INUSE;
+		STAT(st.blocks++);
+		free((char *)p + HDR);
+	}
+	return ptr;
+}
+
+#if STATS
+void segmalloc_stats(struct segmalloc_stats *sp)
+{
+	struct block *b;
+
+	st.small_free = binned;
+	st.large_free = st.large_max = 0;
+	for (b = large; b; b = b->next) {
+		st.large_free += b->h.size;
+		if (b->h.size > st.large_max)
+			st.large_max = b->h.size;
+	}
+	*sp = st;
+}
+#endif
@@ -0,0 +1,20 @@
+#ifndef __SEGMALLOC_H
+#define __SEGMALLOC_H
+
+/* heap statistics from the segregated fit allocator, $(SEGMALLOC)*/
+struct segmalloc_stats {
+	unsigned long	mallocs;	/* malloc calls*/
+	unsigned long	frees;		/* free calls*/
+	unsigned long	small_hits;	/* mallocs satisfied from a size class*/
+	unsigned int	consolidations;	/* size classes merged into large list*/
+	unsigned int	arena;		/* bytes obtained from sbrk*/
+	unsigned int	inuse;		/* bytes in allocated blocks*/
+	unsigned int	blocks;		/* allocated blocks*/
+	unsigned int	small_free;	/* bytes on size class lists*/
+	unsigned int	large_free;	/* bytes on first fit list*/
+	unsigned int	large_max;	/* largest free block*/
+};
+
+void segmalloc_stats(struct segmalloc_stats *sp);
+
+#endif
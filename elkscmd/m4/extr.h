@@ -1,4 +1,7 @@
-extern ndptr hashtab[];		/* hash table for macros etc.  */
+extern ndptr *hashtab;		/* hash table for macros etc.  */
+extern int hashsize;		/* number of hashtab buckets   */
+extern int nhashed;		/* number of entries in it     */
+extern ndptr hashinit[];	/* initial hash table          */
 extern char buf[];		/* push-back buffer	       */
 extern char *bp;		/* first available character   */
 extern char *endpbb;		/* end of push-back buffer     */
@@ -12,6 +15,11 @@ extern FILE *outfile[];		/* diversion array(0=bitbucket)*/
 extern FILE *active;		/* active output file pointer  */
 extern char *m4temp;		/* filename for diversions     */
 extern int ilevel;		/* input file stack pointer    */
+extern unsigned char *inp;	/* next char in input block    */
+extern unsigned char *inend;	/* end of input block          */
+extern unsigned char *inblk[];	/* input file blocks           */
+extern unsigned char *inpsave[];	/* inp of outer input files    */
+extern unsigned char *inendsave[];/* inend of outer input files  */
 extern int oindex;		/* diversion index..	       */
 extern char *null;		/* as it says.. just a null..  */
 extern char *m4wraps;		/* m4wrap string default..     */
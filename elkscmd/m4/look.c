@@ -11,15 +11,46 @@ extern char *strsave();
 
 /*
  *  hash - compute hash value using the proverbial
- *	   hashing function. Taken from K&R.
+ *	   hashing function. Taken from K&R. inspect()
+ *	   computes the same value while reading a token.
  */
 hash (name)
 register char *name;
 {
-	register int h = 0;
+	register unsigned int h = 0;
 	while (*name)
-		h += *name++;
-	return (h % HASHSIZE);
+		h = h * 31 + *name++;
+	return (h % hashsize);
+}
+
+/*
+ * rehash - grow the hash table once the chains average
+ *	    more than two entries, relinking every entry.
+ *	    The old table is kept if there is no memory.
+ */
+rehash()
+{
+	register int i, h;
+	register ndptr p, np;
+	ndptr *oldtab = hashtab;
+	int oldsize = hashsize;
+	ndptr *newtab;
+
+	if ((newtab = (ndptr *) malloc((oldsize * 2 + 1) * sizeof(ndptr))) == NULL)
+		return;
+	hashtab = newtab;
+	hashsize = oldsize * 2 + 1;
+	for (i = 0; i < hashsize; i++)
+		hashtab[i] = nil;
+	for (i = 0; i < oldsize; i++)
+		for (p = oldtab[i]; p != nil; p = np) {
+			np = p->nxtptr;
+			h = hash(p->name);
+			p->nxtptr = hashtab[h];
+			hashtab[h] = p;
+		}
+	if (oldtab != hashinit)
+		free(oldtab);
 }
 
 /*
@@ -48,11 +79,14 @@ char *name;
 	register int h;
 	ndptr p;
 
+	if (nhashed >= hashsize * 2)
+		rehash();
 	h = hash(name);
 	if ((p = (ndptr) malloc(sizeof(struct ndblock))) != NULL) {
 		p->nxtptr = hashtab[h];
 		hashtab[h] = p;
 		p->name = strsave(name);
+		nhashed++;
 	}
 	else
 		error("m4: no more memory.");
@@ -85,6 +119,7 @@ int all;
 				tp->nxtptr = mp;
 				freent(xp);
 			}
+			nhashed--;
 			if (!all)
 				break;
 		}
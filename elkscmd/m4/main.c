@@ -95,7 +95,10 @@
  *
  */
 
-ndptr hashtab[HASHSIZE];	/* hash table for macros etc.  */
+ndptr hashinit[HASHSIZE];	/* initial hash table          */
+ndptr *hashtab = hashinit;	/* hash table for macros etc.  */
+int hashsize = HASHSIZE;	/* number of hashtab buckets   */
+int nhashed;			/* number of entries in it     */
 char buf[BUFSIZE];		/* push-back buffer	       */
 char *bp = buf; 		/* first available character   */
 char *endpbb = buf+BUFSIZE;	/* end of push-back buffer     */
@@ -110,6 +113,11 @@ FILE *outfile[MAXOUT];		/* diversion array(0=bitbucket)*/
 FILE *active;			/* active output file pointer  */
 char *m4temp;			/* filename for diversions     */
 int ilevel = 0; 		/* input file stack pointer    */
+unsigned char *inblk[MAXINP];	/* input file blocks           */
+unsigned char *inp;		/* next char in input block    */
+unsigned char *inend;		/* end of input block          */
+unsigned char *inpsave[MAXINP];	/* inp of outer input files    */
+unsigned char *inendsave[MAXINP];/* inend of outer input files  */
 int oindex = 0; 		/* diversion index..	       */
 char *null = "";                /* as it says.. just a null..  */
 char *m4wraps = "";             /* m4wrap string default..     */
@@ -298,6 +306,8 @@ macro() {
 			if (--ilevel < 0)
 				break;			/* all done thanks.. */
 			(void) fclose(infile[ilevel+1]);
+			inp = inpsave[ilevel];
+			inend = inendsave[ilevel];
 			continue;
 		}
 	/*
@@ -387,19 +397,19 @@ ndptr
 inspect(tp)
 register char *tp;
 {
-	register int h = 0;
-	register char c;
+	register unsigned int h = 0;
+	register int c;
 	register char *name = tp;
 	register char *etp = tp+MAXTOK;
 	register ndptr p;
 
 	while (tp < etp && (isalnum((c = gpbc())) || c == '_'))
-		h += (*tp++ = c);
+		h = h * 31 + (*tp++ = c);
 	putback(c);
 	if (tp == etp)
 		error("m4: token too long");
 	*tp = EOS;
-	for (p = hashtab[h%HASHSIZE]; p != nil; p = p->nxtptr)
+	for (p = hashtab[h % hashsize]; p != nil; p = p->nxtptr)
 		if (strcmp(name, p->name) == 0)
 			break;
 	return(p);
@@ -416,7 +426,7 @@ initm4()
 	register int i;
 
 	for (i = 0; i < HASHSIZE; i++)
-		hashtab[i] = nil;
+		hashinit[i] = nil;
 	for (i = 0; i < MAXOUT; i++)
 		outfile[i] = NULL;
 }
@@ -444,5 +454,6 @@ initkwds() {
 		p->name = keywrds[i].knam;
 		p->defn = null;
 		p->type = keywrds[i].ktyp | STATIC;
+		nhashed++;
 	}
 }
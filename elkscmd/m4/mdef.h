@@ -113,7 +113,8 @@
 #define STACKMAX        1024            /* size of call stack      */
 #define STRSPMAX        4096            /* size of string space    */
 #define MAXTOK          MAXSTR          /* maximum chars in a tokn */
-#define HASHSIZE        199             /* maximum size of hashtab */
+#define HASHSIZE        199             /* initial size of hashtab */
+#define INBLK           512             /* input file read size    */
  
 #define ALL             1
 #define TOP             0
@@ -154,12 +155,13 @@ typedef union {			/* stack structure */
 /*
  * macros for readibility and/or speed
  *
- *      gpbc()  - get a possibly pushed-back character
+ *      gpbc()  - get a possibly pushed-back character, or the
+ *                next one from the current input block
  *      min()   - select the minimum of two elements
  *      pushf() - push a call frame entry onto stack
  *      pushs() - push a string pointer onto stack
  */
-#define gpbc() 	 (bp > buf) ? *--bp : getc(infile[ilevel])
+#define gpbc() 	 (bp > buf) ? *--bp : (inp < inend) ? *inp++ : fillin()
 #define min(x,y) ((x > y) ? y : x)
 #define pushf(x) if (sp < STACKMAX) mstack[++sp].sfra = (x)
 #define pushs(x) if (sp < STACKMAX) mstack[++sp].sstr = (x)
@@ -43,6 +43,25 @@ char c;
                 error("m4: too many characters pushed back");
 }
  
+/*
+ *  fillin - read the next block of the current input
+ *           file once gpbc has used up the last one.
+ *
+ */
+fillin()
+{
+        register int n;
+
+        if (inblk[ilevel] == NULL &&
+            (inblk[ilevel] = (unsigned char *) malloc(INBLK)) == NULL)
+                error("m4: no more memory.");
+        inp = inend = inblk[ilevel];
+        if ((n = read(fileno(infile[ilevel]), inp, INBLK)) <= 0)
+                return EOF;
+        inend += n;
+        return *inp++;
+}
+ 
 /*
  *  pbstr - push string back onto input
  *          putback is replicated to improve
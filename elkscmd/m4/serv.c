@@ -159,7 +159,7 @@ register int argc;
                                 p->defn);
         }
         else {
-                for (n = 0; n < HASHSIZE; n++)
+                for (n = 0; n < hashsize; n++)
                         for (p = hashtab[n]; p != nil; p = p->nxtptr)
                                 fprintf(stderr, dumpfmt, p->name,
                                 p->defn);
@@ -198,6 +198,9 @@ char *ifile;
         if (ilevel+1 == MAXINP)
                 error("m4: too many include files.");
         if ((infile[ilevel+1] = fopen(ifile, "r")) != NULL) {
+                inpsave[ilevel] = inp;
+                inendsave[ilevel] = inend;
+                inp = inend = NULL;
                 ilevel++;
                 return (1);
         }
@@ -12,7 +12,10 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#define BUFLEN 4096
+
 int error;
+static unsigned char buffer[BUFLEN];
 
 /* Table from P1003.2 (4.9/Fig 4.1). In fact, this table was taken from zmodem
  * and rewritten to look like the Draft 11 example.
@@ -72,8 +75,12 @@ unsigned long crctab[] = {
 	  0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-static int aux;
+int aux;			/* also used by crc.S */
 
+#ifdef __ia16__
+/* hand coded in crc.S */
+unsigned long strncrc(unsigned char *b, int n, unsigned long s);
+#else
 /* Routine straight out of 4.9.10 */
 unsigned long strncrc(register unsigned char *b,
 		register int n, register unsigned long s)
@@ -96,6 +103,7 @@ unsigned long strncrc(register unsigned char *b,
   }
   return(s);
 }
+#endif
 
 /* Compute crc and size of input file descriptor. */
 static void crc(int fd, char *name)
@@ -103,7 +111,6 @@ static void crc(int fd, char *name)
   off_t f_size;
   unsigned long crc;
   int nb;
-  unsigned char buffer[1024];
 
   if (fd < 0) {
 	perror(name);
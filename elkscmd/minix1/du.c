@@ -27,6 +27,7 @@
  *		Count blocks for all non-special files.
  *		Don't clutter link buffer with directories.
  *  1.8:	Remember all links.
+ *  1.9:	Stat entries relative to their directory, -x.
  */
 
 
@@ -63,13 +64,16 @@ typedef struct already {
 } ALREADY;
 
 char *prog;			/* program name */
-char *optstr = "asl:";		/* -a and -s arguments */
+char *optstr = "asxl:";		/* -a, -s and -x arguments */
 int silent = 0;			/* silent mode */
 int all = 0;			/* all directory entries mode */
+int xdev = 0;			/* stay on the starting file system */
+dev_t startdev;			/* device of startdir */
 char *startdir = ".";		/* starting from here */
 int levels = 20000;		/* # of directory levels to print */
 ALREADY *already[NR_ALREADY];
 int alc;
+char home[PATH_MAX];		/* directory du was started in */
 
 
 /*
@@ -99,7 +103,7 @@ int done(int dev, ino_t inum, nlink_t nlink)
 {
   register ALREADY **pap, *ap;
 
-  pap = &already[(unsigned) inum % NR_ALREADY];
+  pap = &already[((unsigned) inum ^ ((unsigned) dev << 5)) % NR_ALREADY];
   while ((ap = *pap) != NULL) {
 	if (ap->al_inum == inum && ap->al_dev == dev) {
 		if (--ap->al_nlink == 0) {
@@ -124,10 +128,13 @@ int done(int dev, ino_t inum, nlink_t nlink)
 
 /*
  *	dodir - process the directory d. Return the long size (in blocks)
- *	of d and its descendants.
+ *	of d and its descendants. Name is d relative to the current
+ *	directory, which is that of each directory while its entries are
+ *	done, so that they are looked up by name rather than by the whole
+ *	path from startdir.
  */
-long dodir(d, thislev)
-char *d;
+long dodir(d, name, thislev)
+char *d, *name;
 int thislev;
 {
   int maybe_print;
@@ -137,11 +144,12 @@ int thislev;
   DIR *dp;
   struct dirent *entry;
 
-  if (LSTAT(d, &s) < 0) {
+  if (LSTAT(name, &s) < 0) {
 	fprintf(stderr,
 		"%s: %s: %s\n", prog, d, strerror(errno));
     	return 0L;
   }
+  if (xdev && s.st_dev != startdev) return 0L;
   total = (s.st_size + (BLOCK_SIZE - 1)) / BLOCK_SIZE;
   switch (s.st_mode & S_IFMT) {
     case S_IFDIR:
@@ -149,15 +157,22 @@ int thislev;
 	 * directory should not already have been done.
 	 */
 	maybe_print = !silent;
-	if ((dp = opendir(d)) == NULL) break;
-	while ((entry = readdir(dp)) != NULL) {
-		if (strcmp(entry->d_name, ".") == 0 ||
-		    strcmp(entry->d_name, "..") == 0)
-			continue;
-		if (!makedname(d, entry->d_name, dent, sizeof(dent))) continue;
-		total += dodir(dent, thislev - 1);
+	if (chdir(name) < 0) break;
+	if ((dp = opendir(".")) != NULL) {
+		while ((entry = readdir(dp)) != NULL) {
+			if (strcmp(entry->d_name, ".") == 0 ||
+			    strcmp(entry->d_name, "..") == 0)
+				continue;
+			if (!makedname(d, entry->d_name, dent, sizeof(dent)))
+				continue;
+			total += dodir(dent, entry->d_name, thislev - 1);
+		}
+		closedir(dp);
+	}
+	if (chdir(name == d ? home : "..") < 0) {
+		fprintf(stderr, "%s: can't return from %s\n", prog, d);
+		exit(1);
 	}
-	closedir(dp);
 	break;
     case S_IFBLK:
     case S_IFCHR:
@@ -184,16 +199,24 @@ char **argv;
   while ((c = getopt(argc, argv, optstr)) != EOF) switch (c) {
 	    case 'a':	all = 1;	break;
 	    case 's':	silent = 1;	break;
+	    case 'x':	xdev = 1;	break;
 	    case 'l':	levels = atoi(optarg);	break;
 	    default:
 		fprintf(stderr,
-			"Usage: %s [-a] [-s] [-l levels] [startdir]\n", prog);
+			"Usage: %s [-a] [-s] [-x] [-l levels] [startdir]\n", prog);
 		exit(1);
 	}
+  if (getcwd(home, sizeof(home)) == NULL) {
+	fprintf(stderr, "%s: can't get current directory\n", prog);
+	exit(1);
+  }
   do {
+	struct stat s;
+
 	if (optind < argc) startdir = argv[optind++];
 	alc = 0;
-	(void) dodir(startdir, levels);
+	if (xdev && LSTAT(startdir, &s) == 0) startdev = s.st_dev;
+	(void) dodir(startdir, startdir, levels);
   } while (optind < argc);
   exit(0);
 }
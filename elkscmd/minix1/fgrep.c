@@ -33,7 +33,7 @@
 
 #define MAX_STR_LEN	 256	/* maximum length of strings to search for */
 #define BYTE		0xFF	/* convert from char to int */
-#define READ_SIZE	BUFSIZ	/* read() request size */
+#define READ_SIZE (4*BUFSIZ)	/* read() request size */
 #define BUF_SIZE (2*READ_SIZE)	/* size of buffer */
 
 typedef struct test_str {
@@ -135,10 +135,7 @@ char **argv;
 		if (cflag) continue;
 		if (hflag == 0) printf("%s:", optarg);
 		if (nflag) printf("%u:", line_num);
-		do {
-			putchar(*line);
-		} while (++line < input);
-		fflush(stdout);
+		fwrite(line, 1, input - line, stdout);
 	}
 	found_one |= count;
 	if (cflag) {
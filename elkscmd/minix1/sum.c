@@ -20,7 +20,7 @@
 
 int rc = 0;
 char *defargv[] = {"-", 0};
-static char buf[2048];
+static unsigned char buf[2048];
 
 void error(char *s, char *f)
 {
@@ -34,18 +34,15 @@ void error(char *s, char *f)
 
 void sum(int fd, char *fname)
 {
-  register int i, n;
+  register unsigned char *p;
+  register int n;
   long size = 0;
-  unsigned crc = 0;
-  unsigned tmp;
+  unsigned short crc = 0;
 
   while ((n = read(fd, buf, sizeof(buf))) > 0) {
-	for (i = 0; i < n; i++) {
-		crc = (crc >> 1) + ((crc & 1) ? 0x8000 : 0);
-		tmp = buf[i] & 0377;
-		crc += tmp;
-		crc &= 0xffff;
-	}
+	/* rotate right one bit and add, compiled to a ror */
+	for (p = buf; n > 0; n--)
+		crc = ((crc >> 1) | ((unsigned)crc << 15)) + *p++;
 	size++;
   }
 
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
 
 static char buffer[BUFSIZ];
 static int uflag = 1;			/* default is union of -d and -u outputs */
@@ -26,6 +27,10 @@ static int chars = 0;
 
 /* The meat of the whole affair */
 static char *nowline, *prevline, buf1[1024], buf2[1024];
+static unsigned int nowhash, prevhash;	/* hashes of the compared parts */
+
+/* Input is read a buffer at a time and split in place */
+static char inbuf[BUFSIZ], *inp = inbuf, *inend = inbuf;
 
 static int ourgetline(char *buf, int count);
 
@@ -62,9 +67,20 @@ static char *skip(char *s)
   return s;
 }
 
+static unsigned int hash(char *s)
+{
+  unsigned int h = 0;
+
+  while (*s) h = (h << 5) - h + (unsigned char)*s++;
+  return h;
+}
+
+/* Lines differing in hash can't be equal, so most are told apart without
+ * skipping fields and comparing them again.
+ */
 static int equal(char *s1, char *s2)
 {
-  return !strcmp(skip(s1), skip(s2));
+  return prevhash == nowhash && !strcmp(skip(s1), skip(s2));
 }
 
 static void show(char *line, int count)
@@ -85,18 +101,21 @@ static int uniq(void)
   /* Setup */
   prevline = buf1;
   if (ourgetline(prevline, 1024) < 0) return(0);
+  prevhash = hash(skip(prevline));
   seen = 1;
   nowline = buf2;
 
   /* Get nowline and compare if not equal, dump prevline and swap
    * pointers else continue, bumping seen count */
   while (ourgetline(nowline, 1024) > 0) {
+	nowhash = hash(skip(nowline));
 	if (!equal(prevline, nowline)) {
 		show(prevline, seen);
 		seen = 1;
 		p = nowline;
 		nowline = prevline;
 		prevline = p;
+		prevhash = nowhash;
 	} else
 		seen += 1;
   }
@@ -105,20 +124,34 @@ static int uniq(void)
 }
 
 
+/* Read the next line of at most count - 2 characters into buf, adding the
+ * newline if missing at EOF and a NUL.  Returns its length or -1 at EOF.
+ */
 static int ourgetline(char *buf, int count)
 {
-  int c;
+  char *nl;
+  int n;
   int ct = 0;
 
-  while (ct++ < count) {
-	c = getc(stdin);
-	if (c < 0) return(-1);
-	*buf++ = c;
-	if (c == '\n') {
-		*buf++ = 0;
-		return(ct);
+  while (ct < count - 2) {
+	if (inp == inend) {
+		if ((n = read(0, inbuf, sizeof(inbuf))) <= 0) {
+			if (ct == 0) return(-1);
+			buf[ct++] = '\n';
+			break;
+		}
+		inp = inbuf;
+		inend = inbuf + n;
 	}
+	n = inend - inp;
+	if (n > count - 2 - ct) n = count - 2 - ct;
+	if ((nl = memchr(inp, '\n', n)) != NULL) n = nl - inp + 1;
+	memcpy(buf + ct, inp, n);
+	inp += n;
+	ct += n;
+	if (nl) break;
   }
+  buf[ct] = 0;
   return(ct);
 }
 
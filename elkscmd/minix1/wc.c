@@ -3,6 +3,8 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /*
  *
@@ -39,27 +41,48 @@ long ltotal;			/* Total count of lines */
 long wtotal;			/* Total count of words */
 long ctotal;			/* Total count of characters */
 
+#define C_SPACE	1		/* ends a word */
+#define C_LINE	2		/* ends a line */
 
-void count(FILE *f)
+unsigned char cclass[256];	/* class of each character */
+char iobuf[2048];
+
+
+void init_class(void)
 {
-  register int c;
+  int c;
+
+  for (c = 0; c < 256; c++)
+	if (isspace(c)) cclass[c] = C_SPACE;
+  cclass['\n'] |= C_LINE;
+  cclass['\f'] |= C_LINE;
+}
+
+
+void count(int fd)
+{
+  register char *p;
+  register int cl;
   register int word = 0;
+  char *end;
+  int n;
 
   lcount = 0L;
   wcount = 0L;
   ccount = 0L;
 
-  while ((c = getc(f)) != EOF) {
-	ccount++;
-
-	if (isspace(c)) {
-		if (word) wcount++;
-		word = 0;
-	} else {
-		word = 1;
+  while ((n = read(fd, iobuf, sizeof(iobuf))) > 0) {
+	ccount += n;
+	end = iobuf + n;
+	for (p = iobuf; p < end; p++) {
+		if ((cl = cclass[(unsigned char)*p]) != 0) {
+			if (word) wcount++;
+			word = 0;
+			if (cl & C_LINE) lcount++;
+		} else {
+			word = 1;
+		}
 	}
-
-	if (c == '\n' || c == '\f') lcount++;
   }
   ltotal += lcount;
   wtotal += wcount;
@@ -99,11 +122,12 @@ int main(int argc, char **argv)
   }
 
   /* Process files. */
+  init_class();
   tflag = files >= 2;		/* set if # files > 1 */
 
   /* Check to see if input comes from std input. */
   if (k >= argc) {
-	count(stdin);
+	count(0);
 	if (lflag) printf(" %6ld", lcount);
 	if (wflag) printf(" %6ld", wcount);
 	if (cflag) printf(" %6ld", ccount);
@@ -114,17 +138,17 @@ int main(int argc, char **argv)
 
   /* There is an explicit list of files.  Loop on files. */
   while (k < argc) {
-	FILE *f;
+	int fd;
 
-	if ((f = fopen(argv[k], "r")) == NULL) {
+	if ((fd = open(argv[k], O_RDONLY)) < 0) {
 		fprintf(stderr, "wc: cannot open %s\n", argv[k]);
 	} else {
-		count(f);
+		count(fd);
 		if (lflag) printf(" %6ld", lcount);
 		if (wflag) printf(" %6ld", wcount);
 		if (cflag) printf(" %6ld", ccount);
 		printf(" %s\n", argv[k]);
-		fclose(f);
+		close(fd);
 	}
 	k++;
   }
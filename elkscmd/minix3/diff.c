@@ -1,11 +1,12 @@
 /* diff  - print differences between 2 files	  Author: Erik Baalbergen */
 
 /* Poor man's implementation of diff(1) 	- no options available
-* 	- may give more output than other diffs,
-*	  due to the straight-forward algorithm
-* 	- runs out of memory if the differing chunks become too large
-* 	- input line length should not exceed LINELEN; longer lines are
-*	  truncated, while only the first LINELEN characters are compared
+* 	- lines are compared by a 32 bit hash, so two different
+*	  lines with the same hash are taken as equal
+* 	- the two files together should not exceed MAXLINES lines
+*
+* 	- Uses the O(ND) algorithm of E. Myers with the linear space
+*	  refinement, keeping hashes in far memory
 *
 * 	- Bug fixes by Rick Thomas Sept. 1989
 *
@@ -44,12 +45,20 @@
 #include <stdio.h>
 #include "defs.h"
 
+#ifdef __ia16__
+#define FAR		__far
+#include <malloc.h>
+#else
+#define FAR
+#define fmemalloc(n)	malloc(n)
+#endif
+
 /* These definitions are needed only to suppress warning messages. */
 #define Nullfp 		((FILE*)0)
 #define Nullch 		((char*)0)
-#define NullStructLine	((struct line *)0)
 
-#define LINELEN 128		/* max line length included in diff	 */
+#define LINELEN 128		/* line length printed at one time	 */
+#define MAXLINES 16380		/* max lines in both files together	 */
 
 
 #define NOT_SET 0		/* Defines to characterise if a flag 	 */
@@ -97,21 +106,19 @@ _PROTOTYPE(FILE *check_file, (char *name ));
 _PROTOTYPE(void build_option_string, (void ));
 _PROTOTYPE(void fatal_error, (char *fmt, char *s ));
 _PROTOTYPE(void warn, (int number, char *string ));
-_PROTOTYPE(void trimming_blanks, (char *l_text ));
 _PROTOTYPE(char *filename, (char *path_string));
-_PROTOTYPE(struct line *new_line, (int size ));
-_PROTOTYPE(void free_line, (struct line *l ));
-_PROTOTYPE(int equal_line, (struct line *l1, struct line *l2 ));
-_PROTOTYPE(int equal_3, (struct line *l1, struct line *l2 ));
-_PROTOTYPE(struct line *read_line, (FILE *fp ));
-_PROTOTYPE(void advance, (struct f *f ));
-_PROTOTYPE(void aside, (struct f *f, struct line *l ));
-_PROTOTYPE(struct line *next, (struct f *f ));
-_PROTOTYPE(void init_f, (struct f *f, FILE *fp ));
-_PROTOTYPE(void update, (struct f *f, char *s ));
+_PROTOTYPE(void init_mem, (void ));
+_PROTOTYPE(FILE *temp_file, (void ));
+_PROTOTYPE(void read_file, (struct f *f, FILE *fp, unsigned long FAR *hash,
+							int max ));
+_PROTOTYPE(void diag, (int xoff, int xlim, int yoff, int ylim, int *xmid,
+							int *ymid ));
+_PROTOTYPE(void compareseq, (int xoff, int xlim, int yoff, int ylim ));
+_PROTOTYPE(void skip_lines, (struct f *f, int n ));
+_PROTOTYPE(void update, (struct f *f, int n, char *s ));
 _PROTOTYPE(void __diff, (FILE *fp1, FILE *fp2 ));
-_PROTOTYPE(void differ, (struct f *f1, struct f *f2 ));
-_PROTOTYPE(int wlen, (struct f *f ));
+_PROTOTYPE(void differ, (struct f *f1, struct f *f2, int cnt1, int len1,
+						int cnt2, int len2 ));
 _PROTOTYPE(void range, (int a, int b ));
 _PROTOTYPE(void cdiff, (char *old, char *new, FILE *file1, FILE *file2 ));
 _PROTOTYPE(void dumphunk, (void ));
@@ -360,29 +367,6 @@ char *string;			/* string to be inserted to the warning	 */
   fprintf(stderr, warning[number], progname, string);
 }
 
-/* Function used with the optione -b, trims the blanks in a input line:
- * - blanks between words are reduced to one
- * - trailing blanks are eliminated.
- */
-void trimming_blanks(l_text)
-char *l_text;			/* begin of the char array		 */
-{
-  char *line = l_text;
-  char *copy_to, *copy_from;
-
-  do {
-	if (*line == ' ') {
-		copy_from = line;
-		copy_to = line;
-		while (*(++copy_from) == ' ');
-		if (*copy_from != '\n') copy_to++;
-		while (*copy_from != '\0') *(copy_to++) = *(copy_from++);
-		*copy_to = '\0';
-	}
-  } while (*(++line) != '\0');
-}
-
-
 /* Filename separates the filename and the relative path in path_string.
  * Returns the filename with a leading /
  */
@@ -404,224 +388,242 @@ char *path_string;
   return(name);
 }
 
-/* The line module: one member in a linked list of lines. */
-struct line {
-  struct line *l_next;		/* pointer to the next line	 */
-  char l_eof;			/* == 0 if last line in file	 */
-  char *l_text;			/* array with the text		 */
-};
-
-struct line *freelist = 0;
-#define stepup(ll) ( ((ll) && ((ll)->l_eof==0)) ? (ll)->l_next : (ll) )
+/* The line module: every line of the two files is reduced to a 32 bit
+ * hash and lines are compared by their hashes only, so the text of the
+ * files is never held in memory. The hashes, the change flags and the
+ * diagonal vectors of the O(ND) algorithm are kept in far memory, which
+ * leaves only the number of lines limited by the size of a segment.
+ * The differing lines are read again from the files for the output.
+ */
+#define HASH(h, c)	(((h) << 5) + (h) + (c))
 
-/* Function to allocate space for a new line containing SIZE chars	*/
-struct line *new_line(size)
-int size;
-{
-  register struct line *l;
-
-  if ((l = freelist) != NullStructLine)
-	freelist = freelist->l_next;
-  else {
-	l = (struct line *) xmalloc(3 * sizeof(void *));
-	l->l_text = (char *) xmalloc((size + 2) * sizeof(char));
-	if ((l == 0) || (l->l_text == 0)) fatal_error("Out of memory", "");
-  }
-  return l;
-}
+/* File handler */
+struct f {
+  FILE *f_fp;			/* the file, or a copy of a pipe	 */
+  long f_start;			/* offset of the first line in f_fp	 */
+  unsigned long FAR *f_hash;	/* hash values of the lines		 */
+  char FAR *f_changed;		/* nonzero if the line is not common	 */
+  int f_lines;			/* number of lines in the file		 */
+  int f_linecnt;		/* line number in file of last read line */
+};
 
+unsigned long FAR *hashes;	/* line hashes of both files		 */
+char FAR *changes;		/* change flags of both files		 */
+int FAR *vectors;		/* forward and backward diagonals	 */
 
-/* Free_line() releases storage allocated for <l>. */
-void free_line(l)
-register struct line *l;
-{
-  l->l_next = freelist;
-  freelist = l;
-}
+/* The sequences compared by compareseq() and diag(). */
+static unsigned long FAR *xv, FAR *yv;
+static char FAR *xchanged, FAR *ychanged;
+static int FAR *fdiag, FAR *bdiag;
 
-/* Equal_line() compares two lines, <l1> and <l2>.
- * the returned value is the result of the strcmp() function.
+/* Init_mem() allocates the far arrays on the first call, they are
+ * reused for all the files of a recursive diff.
  */
-int equal_line(l1, l2)
-struct line *l1, *l2;
+void init_mem()
 {
-  if (l1 == 0 || l2 == 0)
-	return(0);
-  else if (l1->l_eof || l2->l_eof)
-	return(l1->l_eof == l2->l_eof);
-  else
-	return(strcmp(l1->l_text, l2->l_text) == 0);
+  if (hashes != 0) return;
+  hashes = (unsigned long FAR *) fmemalloc(MAXLINES * sizeof(unsigned long));
+  changes = (char FAR *) fmemalloc(MAXLINES * sizeof(char));
+  vectors = (int FAR *) fmemalloc((MAXLINES + 3) * 2 * sizeof(int));
+  if (hashes == 0 || changes == 0 || vectors == 0)
+	fatal_error("Out of memory", "");
 }
 
-int equal_3(l1, l2)
-struct line *l1, *l2;
+/* Temp_file() returns an unlinked scratch file, holding the copy of an
+ * input that cannot be read twice.
+ */
+FILE *temp_file()
 {
-  register int i, ansr;
-
-  ansr = 1;
-#ifdef DEBUG
-  if (l1 == 0)
-	fprintf(stderr, "\t(null)\n");
-  else if (l1->l_eof)
-	fprintf(stderr, "\t(eof)\n");
-  else
-	fprintf(stderr, "\t%s", l1->l_text);
-  if (l2 == 0)
-	fprintf(stderr, "\t(null)\n");
-  else if (l2->l_eof)
-	fprintf(stderr, "\t(eof)\n");
-  else
-	fprintf(stderr, "\t%s", l2->l_text);
-#endif
-  for (i = 0; i < 3; ++i) {
-	if (!equal_line(l1, l2)) {
-		ansr = 0;
-		break;
-	}
-	l1 = stepup(l1);
-	l2 = stepup(l2);
-  }
-#ifdef DEBUG
-  fprintf(stderr, "\t%d\n", ansr);
-#endif
-  return(ansr);
+  char name[20];
+  FILE *fp;
+
+  strcpy(name, "/tmp/diffXXXXXX");
+  if (mktemp(name) == Nullch || (fp = fopen(name, "w+")) == Nullfp)
+	fatal_error("cannot create temporary file %s", name);
+  unlink(name);
+  return(fp);
 }
 
-struct line *
- read_line(fp)
+/* Read_file() computes the hashes of the lines in <fp> into <hash>, at
+ * most <max> of them. with -b, trailing blanks are ignored and blanks
+ * between words count as one, as in the comparison of lines.
+ */
+void read_file(f, fp, hash, max)
+register struct f *f;
 FILE *fp;
+unsigned long FAR *hash;
+int max;
 {
-  register struct line *l = new_line(LINELEN);
-  register char *p;
+  struct stat statbuf;
+  FILE *copy = Nullfp;
+  register unsigned long h = 0;
   register int c;
-
-  (p = &(l->l_text[LINELEN]))[1] = '\377';
-  l->l_eof = 0;
-  if (fgets(l->l_text, LINELEN + 2, fp) == 0) {
-	l->l_eof = 1;
-	l->l_text[0] = 0;
-  } else if ((p[1] & 0377) != 0377 && *p != '\n') {
-	while ((c = fgetc(fp)) != '\n' && c != EOF) {
+  int blanks = 0, partial = 0;
+
+  fstat(fileno(fp), &statbuf);
+  if (!S_ISREG(statbuf.st_mode)) copy = temp_file();
+  f->f_fp = copy ? copy : fp;
+  f->f_start = copy ? 0L : ftell(fp);
+  f->f_hash = hash;
+  f->f_lines = f->f_linecnt = 0;
+  while ((c = getc(fp)) != EOF) {
+	if (copy) putc(c, copy);
+	partial = 1;
+	if (c == ' ' && trim_blanks == SET) {
+		blanks = 1;
+		continue;
+	}
+	if (blanks && c != '\n') h = HASH(h, ' ');
+	blanks = 0;
+	h = HASH(h, c);
+	if (c == '\n') {
+		if (f->f_lines >= max) fatal_error("%s", "Too many lines");
+		hash[f->f_lines++] = h;
+		h = 0;
+		partial = 0;
 	}
-	*p++ = '\n';
-	*p = '\0';
   }
-  l->l_next = 0;
-  if (trim_blanks == SET) {
-#ifdef DEBUG
-	printf("xxx %s xxx\n", l->l_text);
-#endif
-	trimming_blanks(l->l_text);
-#ifdef DEBUG
-	printf("xxx %s xxx\n", l->l_text);
-#endif
+  if (partial) {		/* last line without a newline		 */
+	if (f->f_lines >= max) fatal_error("%s", "Too many lines");
+	hash[f->f_lines++] = h;
   }
-  return l;
+  if (copy && fflush(copy) == EOF)
+	fatal_error("cannot write temporary file%s", "");
+  fseek(f->f_fp, f->f_start, SEEK_SET);
 }
 
-/* File window handler */
-struct f {
-  struct line *f_bwin, *f_ewin;
-  struct line *f_aside;
-  int f_linecnt;		/* line number in file of last advanced line */
-  FILE *f_fp;
-};
-
-void advance(f)
-register struct f *f;
+/* Diag() finds the middle snake of a shortest edit script for lines
+ * <xoff> to <xlim> of the first and <yoff> to <ylim> of the second
+ * sequence, using the linear space refinement of E. Myers, "An O(ND)
+ * Difference Algorithm and Its Variations": furthest reaching paths are
+ * searched from both ends at once, one vector of x values per direction
+ * indexed by diagonal, until they overlap. the point of the overlap is
+ * returned in <*xmid> and <*ymid>. the first and the last lines of the
+ * two sequences must differ.
+ */
+void diag(xoff, xlim, yoff, ylim, xmid, ymid)
+int xoff, xlim, yoff, ylim;
+int *xmid, *ymid;
 {
-  register struct line *l;
+  int dmin = xoff - ylim;	/* minimum valid diagonal		 */
+  int dmax = xlim - yoff;	/* maximum valid diagonal		 */
+  int fmid = xoff - yoff;	/* center diagonal of forward search	 */
+  int bmid = xlim - ylim;	/* center diagonal of backward search	 */
+  int fmin = fmid, fmax = fmid;	/* limits of the forward search	 */
+  int bmin = bmid, bmax = bmid;	/* limits of the backward search	 */
+  int odd = (fmid - bmid) & 1;	/* forward finds the overlap if odd	 */
+  register int x, y, d;
+  int tlo, thi;
+
+  fdiag[fmid] = xoff;
+  bdiag[bmid] = xlim;
+  for (;;) {
+	/* Extend the forward search by one edit */
+	if (fmin > dmin)
+		fdiag[--fmin - 1] = -1;
+	else
+		++fmin;
+	if (fmax < dmax)
+		fdiag[++fmax + 1] = -1;
+	else
+		--fmax;
+	for (d = fmax; d >= fmin; d -= 2) {
+		tlo = fdiag[d - 1];
+		thi = fdiag[d + 1];
+		x = tlo >= thi ? tlo + 1 : thi;
+		y = x - d;
+		while (x < xlim && y < ylim && xv[x] == yv[y]) x++, y++;
+		fdiag[d] = x;
+		if (odd && bmin <= d && d <= bmax && bdiag[d] <= x) {
+			*xmid = x;
+			*ymid = y;
+			return;
+		}
+	}
 
-  if ((l = f->f_bwin) != NullStructLine) {
-	if (f->f_ewin == l)
-		f->f_bwin = f->f_ewin = 0;
+	/* Extend the backward search by one edit */
+	if (bmin > dmin)
+		bdiag[--bmin - 1] = INT_MAX;
 	else
-		f->f_bwin = l->l_next;
-	free_line(l);
-	(f->f_linecnt)++;
+		++bmin;
+	if (bmax < dmax)
+		bdiag[++bmax + 1] = INT_MAX;
+	else
+		--bmax;
+	for (d = bmax; d >= bmin; d -= 2) {
+		tlo = bdiag[d - 1];
+		thi = bdiag[d + 1];
+		x = tlo < thi ? tlo : thi - 1;
+		y = x - d;
+		while (x > xoff && y > yoff && xv[x - 1] == yv[y - 1]) x--, y--;
+		bdiag[d] = x;
+		if (!odd && fmin <= d && d <= fmax && x <= fdiag[d]) {
+			*xmid = x;
+			*ymid = y;
+			return;
+		}
+	}
   }
 }
 
-void aside(f, l)
-struct f *f;
-struct line *l;
+/* Compareseq() marks the lines of <xoff> to <xlim> and <yoff> to <ylim>
+ * that are not part of a longest common subsequence. common lines at
+ * both ends are stripped, then the remainder is split at the middle
+ * snake and both halves are compared recursively.
+ */
+void compareseq(xoff, xlim, yoff, ylim)
+int xoff, xlim, yoff, ylim;
 {
-  register struct line *ll;
-
-  if (l == 0) return;
-  if ((ll = l->l_next) != NullStructLine) {
-	while (ll->l_next) ll = ll->l_next;
-	ll->l_next = f->f_aside;
-	f->f_aside = l->l_next;
-	l->l_next = 0;
-	f->f_ewin = l;
+  int xmid, ymid;
+
+  while (xoff < xlim && yoff < ylim && xv[xoff] == yv[yoff])
+	xoff++, yoff++;
+  while (xlim > xoff && ylim > yoff && xv[xlim - 1] == yv[ylim - 1])
+	xlim--, ylim--;
+
+  if (xoff == xlim) {
+	while (yoff < ylim) ychanged[yoff++] = 1;
+  } else if (yoff == ylim) {
+	while (xoff < xlim) xchanged[xoff++] = 1;
+  } else {
+	diag(xoff, xlim, yoff, ylim, &xmid, &ymid);
+	compareseq(xoff, xmid, yoff, ymid);
+	compareseq(xmid, xlim, ymid, ylim);
   }
 }
 
-
-struct line *next(f)
+/* Skip_lines() reads the lines of <f> up to line number <n>. */
+void skip_lines(f, n)
 register struct f *f;
+int n;
 {
-  register struct line *l;
+  register int c;
 
-  if ((l = f->f_aside) != NullStructLine) {
-	f->f_aside = l->l_next;
-	l->l_next = 0;
-  } else
-	l = read_line(f->f_fp);
-  if (l) {
-	if (f->f_bwin == 0)
-		f->f_bwin = f->f_ewin = l;
-	else {
-		if (f->f_ewin->l_eof && l->l_eof) {
-			free_line(l);
-			return(f->f_ewin);
-		}
-		f->f_ewin->l_next = l;
-		f->f_ewin = l;
+  while (f->f_linecnt < n) {
+	while ((c = getc(f->f_fp)) != '\n' && c != EOF) {
 	}
+	f->f_linecnt++;
   }
-  return l;
-}
-
-
-/* Init_f() initialises a window structure (struct f). <fp> is the
- * file associated with <f>.
- */
-void init_f(f, fp)
-register struct f *f;
-FILE *fp;
-{
-  f->f_bwin = f->f_ewin = f->f_aside = 0;
-  f->f_linecnt = 0;
-  f->f_fp = fp;
 }
 
-
-/* Update() prints a window. <f> is a pointer to the window, <s> is the
- * string containing the "prefix" to the printout( either "<" or ">").
- * after completion of update(), the window is empty.
+/* Update() prints the next <n> lines of <f>, <s> is the string
+ * containing the "prefix" to the printout( either "<" or ">").
  */
-void update(f, s)
+void update(f, n, s)
 register struct f *f;
+int n;
 char *s;
 {
+  char text[LINELEN + 2];
   char *help;
-  int only_dot = 0;
-
-  if (firstoutput && (recursive_dir == SET)) {
-	printf("diff %s %s %s\n", options_string, oldfile, newfile);
-	firstoutput = 0;
-  }
-  while (f->f_bwin && f->f_bwin != f->f_ewin) {
-	if (mode != ed_mode) {
-		printf("%s%s", s, f->f_bwin->l_text);
-	} else {
-#ifdef DEBUG
-		printf("ed_mode: test for only dot");
-		printf("%s", f->f_bwin->l_text);
-#endif
-		help = f->f_bwin->l_text;
+  int only_dot, len;
+
+  while (n-- > 0) {
+	f->f_linecnt++;
+	if (fgets(text, sizeof(text), f->f_fp) == Nullch) break;
+	if (mode == ed_mode) {
+		help = text;
+		only_dot = 0;
 		while ((*help == ' ') ||
 		       (*help == '.') ||
 		       (*help == '\t')) {
@@ -636,7 +638,7 @@ char *s;
 		 * substitute "." for "..". Afterwards we restart
 		 * with the append command.			 */
 		if (*help == '\n' && only_dot == 1) {
-			help = f->f_bwin->l_text;
+			help = text;
 			while (*help != '\0') {
 				if (*help == '.') printf(".");
 				putchar((int) *(help++));
@@ -644,11 +646,19 @@ char *s;
 			printf(".\n");
 			printf(".s/\\.\\././\n");
 			printf("a\n");
-		} else {
-			printf("%s%s", s, f->f_bwin->l_text);
+			continue;
+		}
+	}
+	fputs(s, stdout);
+	for (;;) {		/* lines longer than LINELEN in pieces	 */
+		fputs(text, stdout);
+		len = strlen(text);
+		if (len > 0 && text[len - 1] == '\n') break;
+		if (fgets(text, sizeof(text), f->f_fp) == Nullch) {
+			putchar('\n');
+			break;
 		}
 	}
-	advance(f);
   }
 }
 
@@ -656,88 +666,69 @@ char *s;
  * Expects two file-pointers as arguments. This functions does
  * *not* check if the file-pointers are valid.
  */
-
 void __diff(fp1, fp2)
 FILE *fp1, *fp2;
 {
   struct f f1, f2;
-  struct line *l1, *s1, *b1, *l2, *s2, *b2;
-  register struct line *ll;
-
-  init_f(&f1, fp1);
-  init_f(&f2, fp2);
-  l1 = next(&f1);
-  l2 = next(&f2);
-  while ((l1->l_eof == 0) || (l2->l_eof == 0)) {
-	if (equal_line(l1, l2)) {
-  equal:
-		advance(&f1);
-		advance(&f2);
-		l1 = next(&f1);
-		l2 = next(&f2);
+  register int i, j;
+  int n1, n2, s1, s2;
+
+  init_mem();
+  read_file(&f1, fp1, hashes, MAXLINES);
+  read_file(&f2, fp2, hashes + f1.f_lines, MAXLINES - f1.f_lines);
+  n1 = f1.f_lines;
+  n2 = f2.f_lines;
+  f1.f_changed = changes;
+  f2.f_changed = changes + n1;
+  for (i = 0; i < n1 + n2; i++) changes[i] = 0;
+
+  xv = f1.f_hash;
+  yv = f2.f_hash;
+  xchanged = f1.f_changed;
+  ychanged = f2.f_changed;
+  fdiag = vectors + n2 + 1;	/* diagonals -n2-1 to n1+1		 */
+  bdiag = fdiag + n1 + n2 + 3;
+  compareseq(0, n1, 0, n2);
+
+  /* Print the runs of changed lines in order */
+  i = j = 0;
+  while (i < n1 || j < n2) {
+	if (i < n1 && j < n2 && !xchanged[i] && !ychanged[j]) {
+		i++;
+		j++;
 		continue;
 	}
-	s1 = b1 = l1;
-	s2 = b2 = l2;
-	/* Read several more lines */
-	next(&f1);
-	next(&f1);
-	next(&f2);
-	next(&f2);
-	/* Start searching */
-search:
-	next(&f2);
-	ll = s1;
-	do {
-		if (equal_3(ll, b2)) {
-			l1 = ll;
-			l2 = b2;
-			aside(&f1, ll);
-			aside(&f2, b2);
-			differ(&f1, &f2);
-			goto equal;
-		}
-		if (ll->l_eof) break;
-		ll = stepup(ll);
-	} while (ll);
-	b2 = stepup(b2);
-
-	next(&f1);
-	ll = s2;
-	do {
-		if (equal_3(b1, ll)) {
-			l1 = b1;
-			l2 = ll;
-			aside(&f2, ll);
-			aside(&f1, b1);
-			differ(&f1, &f2);
-			goto equal;
-		}
-		if (ll->l_eof != 0) break;
-		ll = stepup(ll);
-	} while (ll);
-	b1 = stepup(b1);
-
-	goto search;
+	s1 = i;
+	s2 = j;
+	while (i < n1 && xchanged[i]) i++;
+	while (j < n2 && ychanged[j]) j++;
+	differ(&f1, &f2, s1, i - s1, s2, j - s2);
   }
 
-  /* Both of the files reached EOF */
+  if (f1.f_fp != fp1) fclose(f1.f_fp);
+  if (f2.f_fp != fp2) fclose(f2.f_fp);
 }
 
-/* Differ() prints the differences between files. the arguments <f1> and
- * <f2> are pointers to the two windows, where the differences are.
+/* Differ() prints a difference between the files. <len1> lines after
+ * line <cnt1> of <f1> are replaced by <len2> lines after line <cnt2>
+ * of <f2>.
  */
-void differ(f1, f2)
+void differ(f1, f2, cnt1, len1, cnt2, len2)
 register struct f *f1, *f2;
+int cnt1, len1, cnt2, len2;
 {
-  int cnt1 = f1->f_linecnt, len1 = wlen(f1);
-  int cnt2 = f2->f_linecnt, len2 = wlen(f2);
   if ((len1 != 0) || (len2 != 0)) {
+	if (firstoutput && (recursive_dir == SET)) {
+		printf("diff %s %s %s\n", options_string, oldfile, newfile);
+		firstoutput = 0;
+	}
+	skip_lines(f1, cnt1);
+	skip_lines(f2, cnt2);
 	if (len1 == 0) {
 		if (mode == ed_mode) {
 			cnt1 += offset;
 			printf("%d a\n", cnt1);
-			update(f2, "");
+			update(f2, len2, "");
 			printf(".\n");
 			offset += len2;
 		} else {
@@ -750,8 +741,6 @@ register struct f *f1, *f2;
 			range(cnt1 + 1, cnt1 + len1);
 			printf("d\n");
 			offset -= len1;
-			while (f1->f_bwin && f1->f_bwin != f1->f_ewin)
-				advance(f1);
 		} else {
 			range(cnt1 + 1, cnt1 + len1);
 			printf("d%d", cnt2);
@@ -766,46 +755,29 @@ register struct f *f1, *f2;
 			if (len1 == len2) {
 				range(cnt1 + 1, cnt1 + len1);
 				printf("c\n");
-				update(f2, "");
+				update(f2, len2, "");
 				printf(".\n");
 			} else {
 				range(cnt1 + 1, cnt1 + len1);
 				printf("d\n");
 				printf("%d a\n", cnt1);
-				update(f2, "");
+				update(f2, len2, "");
 				printf(".\n");
 				offset -= len1 - len2;
 			}
-			while (f1->f_bwin && f1->f_bwin != f1->f_ewin)
-				advance(f1);
 		}
 	}
 	if (mode != ed_mode) {
 		putchar('\n');
-		if (len1 != 0) update(f1, "< ");
+		if (len1 != 0) update(f1, len1, "< ");
 		if ((len1 != 0) && (len2 != 0)) printf("---\n");
-		if (len2 != 0) update(f2, "> ");
+		if (len2 != 0) update(f2, len2, "> ");
 	}
 	diffs++;
   }
 }
 
 
-/* Function wlen() calculates the number of lines in a window. */
-int wlen(f)
-struct f *f;
-{
-  register cnt = 0;
-  register struct line *l = f->f_bwin, *e = f->f_ewin;
-
-  while (l && l != e) {
-	cnt++;
-	l = l->l_next;
-  }
-  return cnt;
-}
-
-
 /* Range() prints the line numbers of a range. the arguments <a> and <b>
  * are the beginning and the ending line number of the range. if
  * <a> == <b>, only one line number is printed. otherwise <a> and <b> are
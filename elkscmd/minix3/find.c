@@ -183,13 +183,16 @@ int depth_flag = 0;		/* descend before check?                         */
 int prune_here;			/* This is Baaaad! Don't ever do this again!     */
 int um;				/* current umask()                               */
 int needprint = 1;		/* implicit -print needed?                       */
+int needstat;			/* predicate looks at more than name and inode?  */
 
 
 /* The prototypes: */
 _PROTOTYPE(int main, (int argc, char **argv));
 _PROTOTYPE(char *Malloc, (int n));
 _PROTOTYPE(char *Salloc, (char *s));
-_PROTOTYPE(void find, (char *path, struct node * pred, char *last));
+_PROTOTYPE(int find, (char *path, struct node * pred, char *last,
+						struct stat * leaf));
+_PROTOTYPE(int usestat, (struct node * n));
 _PROTOTYPE(int check, (char *path, struct stat * st, struct node * n, char *last));
 _PROTOTYPE(int ichk, (long val, struct node * n));
 _PROTOTYPE(int lex, (char *str));
@@ -258,25 +261,65 @@ char *argv[];
 		fatal("syntax error: garbage at end of predicate", "");
   } else			/* No predicate list                     */
 	pred = (struct node *) NULL;
+  needstat = usestat(pred);
 
   for (i = 0; i < pathcnt; i++) {
 	if (xdev_flag) xdev_flag = 2;
 	path = pathlist[i];
 	if ((last = strrchr(path, '/')) == NULL) last = path; else last++;
-	find(path, pred, last);
+	find(path, pred, last, (struct stat *) NULL);
   }
   return 0;
 }
 
-void find(path, pred, last)
+/* Usestat: does the predicate need more of an entry's status than its inode
+ * number?  If not, entries known not to be directories need not be stat'ed.
+ */
+int usestat(n)
+struct node *n;
+{
+  if (n == (struct node *) NULL) return 0;
+  switch (n->n_type) {
+    case OP_AND:
+    case OP_OR:
+	return usestat(n->n_info.n_opnd.n_left) ||
+		usestat(n->n_info.n_opnd.n_right);
+    case NOT:
+	return usestat(n->n_info.n_opnd.n_left);
+    case OP_NAME:
+    case OP_INUM:
+    case OP_EXEC:
+    case OP_OK:
+    case OP_PRINT:
+    case OP_PRINT0:
+    case OP_XDEV:
+    case OP_DEPTH:
+    case OP_PRUNE:
+	return 0;
+  }
+  return 1;
+}
+
+/* Find: check path and descend into it if a directory, returning 1 if it
+ * was one.  If leaf is given, path is known not to be a directory and leaf
+ * holds its device and inode number, which is all the predicate needs.
+ *
+ * A directory has a link for each subdirectory besides "." and its entry
+ * in its parent, so once st_nlink - 2 subdirectories have been seen the
+ * remaining entries are not directories.  File systems that don't count
+ * subdirectory links report fewer than 2 for directories.
+ */
+int find(path, pred, last, leaf)
 char *path, *last;
 struct node *pred;
+struct stat *leaf;
 {
   char spath[PATH_MAX];
   register char *send = spath;
-  struct stat st;
+  struct stat st, lst;
   DIR *dp;
   struct dirent *de;
+  int subdirs;
 
   if (path[1] == '\0' && *path == '/') {
 	*send++ = '/';
@@ -285,6 +328,11 @@ struct node *pred;
 	while (*send++ = *path++) {
 	}
 
+  if (leaf) {
+	if (check(spath, leaf, pred, last) && needprint)
+		printf("%s\n", spath);
+	return 0;
+  }
   if (LSTAT(spath, &st) == -1)
 	nonfatal("can't get status of ", spath);
   else {
@@ -292,7 +340,7 @@ struct node *pred;
 	  case 0:
 		break;
 	  case 1:
-		if (st.st_dev != devnr) return;
+		if (st.st_dev != devnr) return 0;
 		break;
 	  case 2:		/* set current device number */
 		xdev_flag = 1;
@@ -306,15 +354,22 @@ struct node *pred;
 	if (!prune_here && (st.st_mode & S_IFMT) == S_IFDIR) {
 		if ((dp = opendir(spath)) == NULL) {
 			nonfatal("can't read directory ", spath);
-			return;
+			return 1;
 		}
+		subdirs = needstat || st.st_nlink < 2 ? -1 : st.st_nlink - 2;
+		memset(&lst, 0, sizeof(lst));
+		lst.st_dev = st.st_dev;
 		send[-1] = '/';
 		while ((de = readdir(dp)) != NULL) {
 			if ((de->d_name[0] != '.') || ((de->d_name[1])
 					  && ((de->d_name[1] != '.')
 					      || (de->d_name[2])))) {
 				strcpy(send, de->d_name);
-				find(spath, pred, send);
+				lst.st_ino = de->d_ino;
+				if (find(spath, pred, send,
+					 subdirs == 0 ? &lst : (struct stat *) NULL) &&
+				    subdirs > 0)
+					subdirs--;
 			}
 		}
 		closedir(dp);
@@ -324,7 +379,9 @@ struct node *pred;
 		if (check(spath, &st, pred, last) && needprint)
 			printf("%s\n", spath);
 	}
+	return (st.st_mode & S_IFMT) == S_IFDIR;
   }
+  return 0;
 }
 
 int check(path, st, n, last)
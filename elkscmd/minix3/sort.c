@@ -42,6 +42,15 @@
 #include <limits.h>
 #include "defs.h"
 
+#ifdef __ia16__
+#define FAR		__far
+#include <malloc.h>
+#else
+#define FAR
+#define fmemalloc(n)	((void *) 0)	/* Runs in near memory only */
+#define fmemcpy(d,s,n)	memcpy(d,s,n)
+#endif
+
 #define OPEN_FILES	(OPEN_MAX-4)	/* Nr of open files per process */
 #if __minix_vmd
 #define MEMORY_SIZE	(1024 * 1024)
@@ -51,12 +60,16 @@
 					/* Total mem_size */
 #define LINE_SIZE	(1024 >> 1)	/* Max length of a line */
 #define IO_SIZE		(2 * 1024)	/* Size of buffered output */
+#define RUN_SIZE	0xFFF0		/* Largest (far) run buffer */
+#define LINES_MAX	6144		/* Max nr of lines in a run */
+#define MERGE_SIZE	(MEMORY_SIZE + LINES_MAX * sizeof(unsigned int))
 #define STD_OUT		 1	/* Fd of terminal */
 
 /* Return status of functions */
 #define OK		 0
 #define ERROR		-1
 #define NIL_PTR		((char *) 0)
+#define NIL_FAR		((char FAR *) 0)
 
 /* Compare return values */
 #define LOWER		-1
@@ -71,6 +84,7 @@
 #define UPPER		0x010	/* A-Z */
 
 typedef int BOOL;
+typedef char FAR *LINE;		/* Line in the run buffer or elsewhere */
 
 #define	FALSE	0
 #define	TRUE	1
@@ -83,7 +97,6 @@ typedef struct {
   char *line;			/* Contains line currently used */
 } MERGE;
 
-#define NIL_MERGE	((MERGE *) 0)
 MERGE merge_f[OPEN_FILES];	/* Merge structs */
 int buf_size;			/* Size of core available for each struct */
 
@@ -112,9 +125,22 @@ BOOL uniq = FALSE;
 
 char *mem_top;			/* Mem_top points to lowest pos of memory. */
 char *cur_pos;			/* First free position in mem */
-char **line_table;		/* Pointer to the internal line table */
 BOOL in_core = TRUE;		/* Set if input cannot all be sorted in core */
 
+/* Input is collected in runs in the run buffer, far memory if available.
+ * Each run is sorted through a table of line offsets, and stashed in a temp
+ * file when the buffer or the table is full.
+ */
+char FAR *run_buf;		/* Run buffer */
+unsigned int run_size;		/* Size of run buffer */
+unsigned int run_len;		/* Nr of chars in run buffer */
+unsigned int line_start;	/* Offset of the line being read */
+unsigned int *line_table;	/* Offsets of the complete lines */
+int line_cnt;			/* Nr of complete lines */
+char in_buffer[IO_SIZE];	/* For buffered input */
+
+#define LINE(i)		(run_buf + line_table[i])
+
  /* Place where temp_files should be made */
 char temp_files[] = "/tmp/sort.XXXXX.XX";
 char *output_file;		/* Name of output file */
@@ -127,7 +153,6 @@ int args_limit;			/* Nr of args given */
 
 char separator;			/* Char that separates fields */
 int nr_of_files = 0;		/* Nr_of_files to be merged */
-int disabled;			/* Nr of files done */
 
 char USAGE[] = "Usage: sort [-funbirdcmt'x'] [+beg_pos [-end_pos]] [-o outfile] [file] ..";
 
@@ -138,31 +163,30 @@ _PROTOTYPE(void new_field, (FIELD * field, int *offset, BOOL beg_fl));
 _PROTOTYPE(void adjust_options, (FIELD * field));
 _PROTOTYPE(void error, (BOOL quit, char *message, char *arg));
 _PROTOTYPE(void open_outfile, (void));
-_PROTOTYPE(void get_file, (int fd, off_t size));
-_PROTOTYPE(int last_line, (void));
+_PROTOTYPE(void alloc_run, (void));
+_PROTOTYPE(void get_file, (int fd));
+_PROTOTYPE(void next_run, (void));
 _PROTOTYPE(void print_table, (int fd));
 _PROTOTYPE(char *file_name, (int nr));
-_PROTOTYPE(void mread, (int fd, char *address, int bytes));
 _PROTOTYPE(void mwrite, (int fd, char *address, int bytes));
 _PROTOTYPE(void sort, (void));
 _PROTOTYPE(void sort_table, (int nel));
 _PROTOTYPE(void incr, (int si, int ei));
-_PROTOTYPE(int cmp_fields, (char *el1, char *el2));
-_PROTOTYPE(void build_field, (char *dest, FIELD * field, char *src));
-_PROTOTYPE(char *skip_fields, (unsigned char *str, int nf));
-_PROTOTYPE(int compare, (char *el1, char *el2));
-_PROTOTYPE(int cmp, (unsigned char *el1, unsigned char *el2, FIELD * field));
-_PROTOTYPE(int digits, (unsigned char *str1, unsigned char *str2, BOOL check_sign));
+_PROTOTYPE(int cmp_fields, (LINE el1, LINE el2));
+_PROTOTYPE(void build_field, (char *dest, FIELD * field, LINE src));
+_PROTOTYPE(LINE skip_fields, (unsigned char FAR *str, int nf));
+_PROTOTYPE(int compare, (LINE el1, LINE el2));
+_PROTOTYPE(int cmp, (unsigned char FAR *el1, unsigned char FAR *el2, FIELD * field));
+_PROTOTYPE(int digits, (unsigned char FAR *str1, unsigned char FAR *str2, BOOL check_sign));
 _PROTOTYPE(void files_merge, (int file_cnt));
 _PROTOTYPE(void merge, (int start_file, int limit_file));
 _PROTOTYPE(void put_line, (char *line));
-_PROTOTYPE(MERGE * print, (MERGE * merg, int file_cnt));
+_PROTOTYPE(int before, (MERGE * merg1, MERGE * merg2));
+_PROTOTYPE(void sift, (MERGE ** heap, int i, int n));
 _PROTOTYPE(int read_line, (MERGE * merg));
-_PROTOTYPE(MERGE * skip_lines, (MERGE * smallest, int file_cnt));
-_PROTOTYPE(void uniq_lines, (MERGE * merg));
 _PROTOTYPE(void check_file, (int fd, char *file));
 _PROTOTYPE(int length, (char *line));
-_PROTOTYPE(void copy, (char *dest, char *src));
+_PROTOTYPE(void copy, (char *dest, LINE src));
 _PROTOTYPE(char *msbrk, (int size));
 _PROTOTYPE(void mbrk, (char *address));
 _PROTOTYPE(void catch, (int dummy));
@@ -321,6 +345,7 @@ char *argv[];
 
   argptr = argv;
   cur_pos = mem_top = msbrk(MEMORY_SIZE);	/* Find lowest mem. location */
+  alloc_run();
 
   while (arg_count < argc && ((ptr = argv[arg_count])[0] == '-' || *ptr == '+')) {
 	if (*ptr == '-' && *(ptr + 1) == '\0')	/* "-" means stdin */
@@ -382,7 +407,7 @@ char *argv[];
 	if (check)
 		check_file(0, NIL_PTR);
 	else
-		get_file(0, (off_t) 0);
+		get_file(0);
   } else
 	while (arg_count < argc) {	/* Sort or check args */
 		if (strcmp(argv[arg_count], "-") == 0)
@@ -400,7 +425,7 @@ char *argv[];
 		if (check)
 			check_file(fd, argv[arg_count]);
 		else		/* Get_file reads whole file */
-			get_file(fd, st.st_size);
+			get_file(fd);
 		arg_count++;
 	}
 
@@ -453,72 +478,74 @@ void open_outfile()
 	error(TRUE, "Cannot creat ", output_file);
 }
 
-/* Get_file reads the whole file of filedescriptor fd. If the file is too big
- * to keep in core, a partial sort is done, and the output is stashed somewhere.
+/* Alloc_run () sets up the run buffer and its line table. The buffer is
+ * allocated from far memory, falling back to the near memory at mem_top.
+ */
+void alloc_run()
+{
+  for (run_size = RUN_SIZE; run_size >= MEMORY_SIZE; run_size >>= 1)
+	if ((run_buf = fmemalloc((unsigned long) run_size)) != NIL_FAR) break;
+  if (run_size < MEMORY_SIZE) {
+	run_buf = mem_top;
+	run_size = MEMORY_SIZE;
+  }
+  line_table = (unsigned int *) msbrk(LINES_MAX * sizeof(unsigned int));
+}
+
+/* Get_file reads the whole file of filedescriptor fd into the run buffer.
+ * Whenever the buffer or the line table is full, the complete lines are
+ * sorted and stashed in a temp file, and reading continues with a new run.
  */
-void get_file(fd, size)
+void get_file(fd)
 int fd;				/* Fd of file to read */
-register off_t size;		/* Size of file */
 {
-  register int i;
-  int rest;			/* Rest in memory */
-  char save_ch;			/* Used in stdin readings */
-
-  rest = MEMORY_SIZE - (cur_pos - mem_top);
-  if (fd == 0) {		/* We're reding stdin */
-	while ((i = read(0, cur_pos, rest)) > 0) {
-		if ((cur_pos - mem_top) + i == MEMORY_SIZE) {
-			in_core = FALSE;
-			i = last_line();	/* End of last line */
-			save_ch = mem_top[i];
-			mem_top[i] = '\0';
-			sort();	/* Sort core */
-			mem_top[i] = save_ch;	/* Restore erased char */
-			/* Restore last (half read) line */
-			for (rest = 0; i + rest != MEMORY_SIZE; rest++)
-				mem_top[rest] = mem_top[i + rest];
-			/* Assign current pos. in memory */
-			cur_pos = &mem_top[rest];
-		} else {	/* Fits, just assign position in mem. */
-			cur_pos = cur_pos + i;
-			*cur_pos = '\0';
-		}
+  register char *ptr, *end;
+  char *nl;
+  unsigned int len;
+  int i;
 
-		/* Calculate rest of mem */
-		rest = MEMORY_SIZE - (cur_pos - mem_top);
+  while ((i = read(fd, in_buffer, IO_SIZE)) > 0) {
+	for (ptr = in_buffer, end = in_buffer + i; ptr < end; ptr += len) {
+		nl = memchr(ptr, '\n', end - ptr);
+		len = (nl ? nl + 1 : end) - ptr;
+		/* Always keep room to add a '\n' to the last line */
+		if (run_len + len >= run_size || (nl && line_cnt == LINES_MAX)) {
+			next_run();
+			if (run_len + len >= run_size)
+				error(TRUE, "Line too long", NIL_PTR);
+		}
+		fmemcpy(run_buf + run_len, ptr, len);
+		run_len += len;
+		if (nl) {
+			line_table[line_cnt++] = line_start;
+			line_start = run_len;
+		}
 	}
   }
+  if (i < 0) error(TRUE, "Read error", NIL_PTR);
 
-  /* Reading file. Check size */
-  else if (size > rest) {	/* Won't fit */
-	mread(fd, cur_pos, rest);
-	in_core = FALSE;
-	i = last_line();	/* Get pos. of last line */
-	mem_top[i] = '\0';	/* Truncate */
-	(void) lseek(fd, (off_t) (i - MEMORY_SIZE), SEEK_CUR);	/* Do this next time */
-	size = size - rest - i + MEMORY_SIZE;	/* Calculate rest */
-	cur_pos = mem_top;	/* Reset mem */
-	sort();			/* Sort core */
-	get_file(fd, size);	/* Get rest of file */
-  } else {			/* Fits. Just read in */
-	rest = size;
-	mread(fd, cur_pos, rest);
-	cur_pos = cur_pos + rest;	/* Reassign cur_pos */
-	*cur_pos = '\0';
-	(void) close(fd);	/* File completed */
+  if (line_start != run_len) {	/* Add '\n' to last line */
+	if (line_cnt == LINES_MAX) next_run();
+	run_buf[run_len++] = '\n';
+	line_table[line_cnt++] = line_start;
+	line_start = run_len;
   }
+  if (fd != 0) (void) close(fd);	/* File completed */
 }
 
-/* Last_line () find the last line in core and retuns the offset from the top
- * of the memory.
+/* Next_run () sorts the complete lines in the run buffer and stashes them in
+ * a temp file. The partial line read last is moved to the start of the buffer.
  */
-int last_line()
+void next_run()
 {
-  register int i;
-
-  for (i = MEMORY_SIZE - 2; i > 0; i--)
-	if (mem_top[i] == '\n') break;
-  return i + 1;
+  register unsigned int i, len;
+
+  in_core = FALSE;
+  sort();
+  len = run_len - line_start;
+  for (i = 0; i < len; i++) run_buf[i] = run_buf[line_start + i];
+  run_len = len;
+  line_start = 0;
 }
 
 /* Print_table prints the line table in the given file_descriptor. If the fd
@@ -527,19 +554,19 @@ int last_line()
 void print_table(fd)
 int fd;
 {
-  register char **line_ptr;	/* Ptr in line_table */
-  register char *ptr;		/* Ptr to line */
+  register int i;		/* Index in line_table */
+  register LINE ptr;		/* Ptr to line */
   int index = 0;		/* Index in output buffer */
 
   if (fd == ERROR) {
 	if ((fd = creat(file_name(nr_of_files), 0644)) < 0)
 		error(TRUE, "Cannot creat ", file_name(nr_of_files));
   }
-  for (line_ptr = line_table; *line_ptr != NIL_PTR; line_ptr++) {
-	ptr = *line_ptr;
+  for (i = 0; i < line_cnt; i++) {
+	ptr = LINE(i);
 	/* Skip all same lines if uniq is set */
-	if (uniq && *(line_ptr + 1) != NIL_PTR) {
-		if (compare(ptr, *(line_ptr + 1)) == SAME) continue;
+	if (uniq && i + 1 < line_cnt) {
+		if (compare(ptr, LINE(i + 1)) == SAME) continue;
 	}
 	do {			/* Print line in a buffered way */
 		out_buffer[index++] = *ptr;
@@ -569,16 +596,6 @@ register int nr;
   return temp_files;
 }
 
-/* Mread () performs a normal read (), but checks the return value. */
-void mread(fd, address, bytes)
-int fd;
-char *address;
-register int bytes;
-{
-  if (read(fd, address, bytes) < 0 && bytes != 0)
-	error(TRUE, "Read error", NIL_PTR);
-}
-
 /* Mwrite () performs a normal write (), but checks the return value. */
 void mwrite(fd, address, bytes)
 int fd;
@@ -589,30 +606,11 @@ register int bytes;
 	error(TRUE, "Write error", NIL_PTR);
 }
 
-/* Sort () sorts the input in memory starting at mem_top. */
+/* Sort () sorts the complete lines in the run buffer. */
 void sort()
 {
-  register char *ptr = mem_top;
-  register int count = 0;
-
-/* Count number of lines in memory */
-  while (*ptr) {
-	if (*ptr++ == '\n') count++;
-  }
-
-/* Set up the line table */
-  line_table = (char **) msbrk(count * sizeof(char *) + sizeof(char *));
-
-  count = 1;
-  ptr = line_table[0] = mem_top;
-  while (*ptr) {
-	if (*ptr++ == '\n') line_table[count++] = ptr;
-  }
-
-  line_table[count - 1] = NIL_PTR;
-
 /* Sort the line table */
-  sort_table(count - 1);
+  sort_table(line_cnt);
 
 /* Stash output somewhere */
   if (in_core) {
@@ -621,15 +619,14 @@ void sort()
   } else
 	print_table(ERROR);
 
-/* Free line table */
-  mbrk((char *) line_table);
+  line_cnt = 0;
 }
 
 /* Sort_table () sorts the line table consisting of nel elements. */
 void sort_table(nel)
 register int nel;
 {
-  char *tmp;
+  unsigned int tmp;
   register int i;
 
   /* Make heap */
@@ -648,13 +645,13 @@ register int nel;
 void incr(si, ei)
 register int si, ei;
 {
-  char *tmp;
+  unsigned int tmp;
 
   while (si <= (ei >> 1)) {
 	si <<= 1;
-	if (si + 1 <= ei && compare(line_table[si - 1], line_table[si]) <= 0)
+	if (si + 1 <= ei && compare(LINE(si - 1), LINE(si)) <= 0)
 		si++;
-	if (compare(line_table[(si >> 1) - 1], line_table[si - 1]) >= 0)
+	if (compare(LINE((si >> 1) - 1), LINE(si - 1)) >= 0)
 		return;
 	tmp = line_table[(si >> 1) - 1];
 	line_table[(si >> 1) - 1] = line_table[si - 1];
@@ -667,7 +664,7 @@ register int si, ei;
  * with the field describing the arguments.
  */
 int cmp_fields(el1, el2)
-register char *el1, *el2;
+register LINE el1, el2;
 {
   int i, ret;
   char line1[LINE_SIZE], line2[LINE_SIZE];
@@ -693,14 +690,14 @@ register char *el1, *el2;
 void build_field(dest, field, src)
 char *dest;			/* Holds result */
 register FIELD *field;		/* Field description */
-register char *src;		/* Source line */
+register LINE src;		/* Source line */
 {
-  char *begin = src;		/* Remember start location */
-  char *last;			/* Pointer to end location */
+  LINE begin = src;		/* Remember start location */
+  LINE last;			/* Pointer to end location */
   int i;
 
 /* Skip begin fields */
-  src = skip_fields((unsigned char *)src, field->beg_field);
+  src = skip_fields((unsigned char FAR *)src, field->beg_field);
 
 /* Skip begin positions */
   for (i = 0; i < field->beg_pos && *src != '\n'; i++) src++;
@@ -710,7 +707,7 @@ register char *src;		/* Source line */
 
 /* If end field is assigned truncate (perhaps) the part copied */
   if (field->end_field != ERROR) {	/* Find last field */
-	last = skip_fields((unsigned char *)begin, field->end_field);
+	last = skip_fields((unsigned char FAR *)begin, field->end_field);
 /* Skip positions as given by end fields description */
 	for (i = 0; i < field->end_pos && *last != '\n'; i++) last++;
 	dest[last - src] = '\n';/* Truncate line */
@@ -718,8 +715,8 @@ register char *src;		/* Source line */
 }
 
 /* Skip_fields () skips nf fields of the line pointed to by str. */
-char *skip_fields(str, nf)
-register unsigned char *str;
+LINE skip_fields(str, nf)
+register unsigned char FAR *str;
 int nf;
 {
   while (nf-- > 0) {
@@ -731,7 +728,7 @@ int nf;
 		if (*str == separator) str++;
 	}
   }
-  return (char *)str;			/* Return pointer to indicated field */
+  return (LINE)str;			/* Return pointer to indicated field */
 }
 
 /* Compare is called by all sorting routines. It checks if fields assignments
@@ -739,13 +736,13 @@ int nf;
  * reversed the return value if the (global) reverse flag is set.
  */
 int compare(el1, el2)
-register char *el1, *el2;
+register LINE el1, el2;
 {
   int ret;
 
   if (field_cnt > GLOBAL) return cmp_fields(el1, el2);
 
-  ret = cmp((unsigned char *) el1, (unsigned char *) el2, &fields[GLOBAL]);
+  ret = cmp((unsigned char FAR *) el1, (unsigned char FAR *) el2, &fields[GLOBAL]);
   return(fields[GLOBAL].reverse) ? -ret : ret;
 }
 
@@ -753,7 +750,7 @@ register char *el1, *el2;
  * description given in the field pointer.
  */
 int cmp(el1, el2, field)
-register unsigned char *el1, *el2;
+register unsigned char FAR *el1, FAR *el2;
 FIELD *field;
 {
   int c1, c2;
@@ -819,7 +816,7 @@ FIELD *field;
  * by an optional decimal point.
  */
 int digits(str1, str2, check_sign)
-register unsigned char *str1, *str2;
+register unsigned char FAR *str1, FAR *str2;
 BOOL check_sign;		/* True if sign must be checked */
 {
   BOOL negative = FALSE;	/* True if negative numbers */
@@ -911,71 +908,90 @@ register int file_cnt;		/* Nr_of_files to merge */
   while (i < file_cnt) (void) unlink(file_name(i++));
 }
 
-/* Merge () merges the files between start_file and limit_file. */
+/* Merge () merges the files between start_file and limit_file. The merge
+ * structs are kept in a heap ordered on their current line.
+ */
 void merge(start_file, limit_file)
 int start_file, limit_file;
 {
-  register MERGE *smallest;	/* Keeps track of smallest line */
+  register MERGE *merg;
   register int i;
   int file_cnt = limit_file - start_file;	/* Nr of files to merge */
+  MERGE *heap[OPEN_FILES];	/* Heap of merge structs, smallest first */
+  int heap_cnt = 0;		/* Nr of files not done yet */
+  char lastline[LINE_SIZE];	/* Last line printed, if uniq is set */
+  BOOL printed = FALSE;		/* Set if lastline holds a line */
 
 /* Calculate size in core available for file_cnt merge structs */
-  buf_size = MEMORY_SIZE / file_cnt - LINE_SIZE;
+  buf_size = MERGE_SIZE / file_cnt - LINE_SIZE;
 
   mbrk(mem_top);		/* First reset mem to lowest loc. */
-  disabled = 0;			/* All files not done yet */
 
 /* Set up merge structures. */
   for (i = start_file; i < limit_file; i++) {
-	smallest = &merge_f[i - start_file];
+	merg = &merge_f[i - start_file];
 	if (!strcmp(file_name(i), "-"))	/* File is stdin */
-		smallest->fd = 0;
-	else if ((smallest->fd = open(file_name(i), O_RDONLY)) < 0) {
-		smallest->fd = ERROR;
+		merg->fd = 0;
+	else if ((merg->fd = open(file_name(i), O_RDONLY)) < 0) {
+		merg->fd = ERROR;
 		error(FALSE, "Cannot open ", file_name(i));
-		disabled++;	/* Done this file */
 		continue;
 	}
-	smallest->buffer = msbrk(buf_size);
-	smallest->line = msbrk(LINE_SIZE);
-	smallest->cnt = smallest->read_chars = 0;
-	(void) read_line(smallest);	/* Read first line */
+	merg->buffer = msbrk(buf_size);
+	merg->line = msbrk(LINE_SIZE);
+	merg->cnt = merg->read_chars = 0;
+	if (read_line(merg) == OK)	/* Read first line */
+		heap[heap_cnt++] = merg;
   }
 
-  if (disabled == file_cnt) {	/* Couldn't open files */
-	(void) close(out_fd);
-	return;
-  }
+  for (i = heap_cnt / 2 - 1; i >= 0; i--) sift(heap, i, heap_cnt);
 
-/* Find a merg struct to assign smallest. */
-  for (i = 0; i < file_cnt; i++) {
-	if (merge_f[i].fd != ERROR) {
-		smallest = &merge_f[i];
-		break;
+/* Print the smallest line and read the next one from its file */
+  while (heap_cnt > 0) {
+	merg = heap[0];
+	if (!uniq)
+		put_line(merg->line);
+	else if (!printed || compare(lastline, merg->line) != SAME) {
+		put_line(merg->line);	/* Skip all same lines */
+		copy(lastline, merg->line);
+		printed = TRUE;
 	}
+	if (read_line(merg) == ERROR)	/* File done */
+		heap[0] = heap[--heap_cnt];
+	sift(heap, 0, heap_cnt);
   }
 
-/* Loop until all files minus one are done */
-  while (disabled < file_cnt - 1) {
-	if (uniq)		/* Skip all same lines */
-		smallest = skip_lines(smallest, file_cnt);
-	else {			/* Find smallest line */
-		for (i = 0; i < file_cnt; i++) {
-			if (merge_f[i].fd == ERROR)
-				continue;	/* We've had this one */
-			if (compare(merge_f[i].line, smallest->line) < 0)
-				smallest = &merge_f[i];
-		}
-	}			/* Print line and read next */
-	smallest = print(smallest, file_cnt);
-  }
+  put_line(NIL_PTR);		/* Flush output buffer */
+}
 
-  if (only_merge && uniq)
-	uniq_lines(smallest);	/* Print only uniq lines */
-  else				/* Print rest of file */
-	while (print(smallest, file_cnt) != NIL_MERGE);
+/* Before () returns TRUE if the line of merg1 goes before that of merg2.
+ * Same lines are taken from the first file first.
+ */
+int before(merg1, merg2)
+register MERGE *merg1, *merg2;
+{
+  int ret = compare(merg1->line, merg2->line);
 
-  put_line(NIL_PTR);		/* Flush output buffer */
+  return ret < 0 || (ret == SAME && merg1 < merg2);
+}
+
+/* Sift () moves heap element i down to its place in the heap of n elements. */
+void sift(heap, i, n)
+register MERGE **heap;
+register int i;
+int n;
+{
+  MERGE *tmp;
+  int child;
+
+  while ((child = 2 * i + 1) < n) {
+	if (child + 1 < n && before(heap[child + 1], heap[child])) child++;
+	if (!before(heap[child], heap[i])) break;
+	tmp = heap[i];
+	heap[i] = heap[child];
+	heap[child] = tmp;
+	i = child;
+  }
 }
 
 /* Put_line () prints the line into the out_fd filedescriptor. If line equals
@@ -1001,34 +1017,8 @@ register char *line;
   } while (*line++ != '\n');
 }
 
-/*
- * Print () prints the line of the merg structure and tries to read another one.
- * If this fails, it returns the next merg structure which file_descriptor is
- * still open. If none could be found, a NIL structure is returned.
- */
-MERGE *print(merg, file_cnt)
-register MERGE *merg;
-int file_cnt;			/* Nr of files that are being merged */
-{
-  register int i;
-
-  put_line(merg->line);		/* Print the line */
-
-  if (read_line(merg) == ERROR) {	/* Read next line */
-	for (i = 0; i < file_cnt; i++) {
-		if (merge_f[i].fd != ERROR) {
-			merg = &merge_f[i];
-			break;
-		}
-	}
-	if (i == file_cnt)	/* No more files left */
-		return NIL_MERGE;
-  }
-  return merg;
-}
-
 /* Read_line () reads a line from the fd from the merg struct. If the read
- * failed, disabled is incremented and the file is closed. Readings are
+ * failed, the file is closed and ERROR returned. Readings are
  * done in buf_size bytes.
  * Lines longer than LINE_SIZE are silently truncated.
  */
@@ -1044,7 +1034,6 @@ register MERGE *merg;
 		     read(merg->fd, merg->buffer, buf_size)) <= 0) {
 			(void) close(merg->fd);	/* OOPS */
 			merg->fd = ERROR;
-			disabled++;
 			return ERROR;
 		}
 		merg->cnt = 0;
@@ -1060,50 +1049,6 @@ register MERGE *merg;
   return OK;
 }
 
-/* Skip_lines () skips all same lines in all the files currently being merged.
- * It returns a pointer to the merge struct containing the smallest line.
- */
-MERGE *skip_lines(smallest, file_cnt)
-register MERGE *smallest;
-int file_cnt;
-{
-  register int i;
-  int ret;
-
-  if (disabled == file_cnt - 1)	/* We've had all */
-	return smallest;
-
-  for (i = 0; i < file_cnt; i++) {
-	if (merge_f[i].fd == ERROR || smallest == &merge_f[i])
-		continue;	/* Don't check same file */
-	while ((ret = compare(merge_f[i].line, smallest->line)) == 0) {
-		if (read_line(&merge_f[i]) == ERROR) break;	/* EOF */
-	}
-	if (ret < 0)		/* Line wasn't smallest. Try again */
-		return skip_lines(&merge_f[i], file_cnt);
-  }
-  return smallest;
-}
-
-/* Uniq_lines () prints only the uniq lines out of the fd of the merg struct. */
-void uniq_lines(merg)
-register MERGE *merg;
-{
-  char lastline[LINE_SIZE];	/* Buffer to hold last line */
-
-  for (;;) {
-	put_line(merg->line);	/* Print this line */
-	copy(lastline, merg->line);	/* and save it */
-	if (read_line(merg) == ERROR)	/* Read the next */
-		return;
-	/* Keep reading until lines duffer */
-	while (compare(lastline, merg->line) == SAME)
-		if (read_line(merg) == ERROR) return;
-  }
-
-  /* NOTREACHED */
-}
-
 /*
  * Check_file () checks if a file is sorted in order according to the arguments
  * given in main ().
@@ -1159,7 +1104,8 @@ register char *line;
 
 /* Copy () copies the src line into the dest line including linefeed. */
 void copy(dest, src)
-register char *dest, *src;
+register char *dest;
+register LINE src;
 {
   while ((*dest++ = *src++) != '\n');
 }
@@ -292,7 +292,14 @@ static char ident[] = "(N)compress 4.2.4";
 
 #ifdef ELKS
 #  pragma GCC diagnostic ignored "-Wstrict-aliasing"
-#  define BITS 12		/* 16-bits processor max 12 bits	*/
+#  if defined(__ia16__) && !defined(NEARTABLES)
+#    define FARTABLES		/* tables in far memory, see below	*/
+#  endif
+#  ifdef FARTABLES
+#    define BITS 16
+#  else
+#    define BITS 12		/* 16-bits processor max 12 bits	*/
+#  endif
 #  undef BYTEORDER
 #  define BYTEORDER 4321	/* CM: FIXME: Assumes little-endian ELKS */
 #  undef NOALLIGN
@@ -572,7 +579,88 @@ long 		bytes_out;	/* Total number of byte to output	*/
  * of htab, and contains characters.  There is plenty of room for any
  * possible stack (stack used to be 8000 characters).
  */
-#ifdef MAXSEG_64K
+#ifdef FARTABLES
+/*
+ * ELKS: the tables are allocated with fmemalloc when first needed,
+ * sized for the number of bits in use, in 64K segments of 16384 htab
+ * or 32768 codetab entries. An index of up to 17 bits is split into
+ * segment and offset using only the high word and a 16-bit shift of
+ * the low word, so no long shifts are done per lookup. The output
+ * stack is kept at the end of the htab segment not used by tab_suffix.
+ */
+#	include <malloc.h>
+#	define	FAR			__far
+#	undef	HSIZE
+#	define	HSIZE			hsize
+#	define	HSHIFT			hshift
+	count_int FAR	*htab[5];
+	unsigned short FAR *codetab[3];
+	long		hsize;
+	int		hshift;
+	int		tabbits;		/* bits the tables are sized for */
+	char_type FAR	*de_stack;
+
+#	define	hseg(i)			((((unsigned)((i) >> 16)) << 2) | ((unsigned)(i) >> 14))
+#	define	cseg(i)			((((unsigned)((i) >> 16)) << 1) | ((unsigned)(i) >> 15))
+#	define	htabof(i)		(htab[hseg(i)][(unsigned)(i) & 0x3fff])
+#	define	codetabof(i)		(codetab[cseg(i)][(unsigned)(i) & 0x7fff])
+#	define	tab_prefixof(i)		codetabof(i)
+#	define	tab_suffixof(i)		((char_type FAR *)htab[0])[(unsigned)(i)]
+#	define	stackcpy(d,s,n)		fmemcpy(d,s,n)
+#	define	clear_tab_prefixof()	fmemset(codetab[0], 0, 256);
+
+	static long hsizes[] = { 5003, 9001, 18013, 35023, 69001 };
+
+	/* size of table segment n, in entries of which there are perseg */
+	static unsigned int tabseg(int n, unsigned int perseg)
+	{
+		long left = hsize - (long)n * perseg;
+
+		if (left <= 0)
+			return 0;
+		return (left > perseg)? perseg: (unsigned int)left;
+	}
+
+	/* allocate tables for bits, returns 0 if there isn't the memory */
+	int	alloc_tables(int bits) {
+		count_int FAR *h[5];
+		unsigned short FAR *c[3];
+		int i;
+
+		if (bits < 12)
+			bits = 12;
+		hsize = hsizes[bits - 12];
+		hshift = bits - 8;
+		if (bits <= tabbits)
+			return 1;		/* tables are only grown */
+		for (i = 0; i < 5; i++) {
+			h[i] = NULL;
+			if (tabseg(i, 16384) > 0 &&
+			    !(h[i] = fmemalloc((long)tabseg(i, 16384) * sizeof(count_int))))
+				return 0;
+		}
+		for (i = 0; i < 3; i++) {
+			c[i] = NULL;
+			if (tabseg(i, 32768) > 0 &&
+			    !(c[i] = fmemalloc((long)tabseg(i, 32768) * sizeof(unsigned short))))
+				return 0;
+		}
+		memcpy(htab, h, sizeof(htab));
+		memcpy(codetab, c, sizeof(codetab));
+		tabbits = bits;
+		/* 16 bits need all of htab[0] for tab_suffix */
+		i = (bits == 16);
+		de_stack = (char_type FAR *)&htab[i][tabseg(i, 16384) - 1];
+		return 1;
+	}
+
+	void	clear_htab() {
+		int i;
+
+		for (i = 0; i < 5 && tabseg(i, 16384) > 0; i++)
+			fmemset(htab[i], -1, tabseg(i, 16384) * sizeof(count_int));
+	}
+#elif defined(MAXSEG_64K)
 	count_int htab0[8192];
 	count_int htab1[8192];
 	count_int htab2[8192];
@@ -621,6 +709,13 @@ long 		bytes_out;	/* Total number of byte to output	*/
 #	define	clear_tab_prefixof()	memset(codetab, 0, 256);
 #endif	/* MAXSEG_64K */
 
+#ifndef FARTABLES
+#	define	FAR
+#	define	HSHIFT			(BITS-8)
+#	define	stackcpy(d,s,n)		memcpy(d,s,n)
+#	define	alloc_tables(bits)	1
+#endif
+
 #ifdef FAST
 	int primetab[256] =		/* Special secudary hash table.	*/
 	{
@@ -1311,6 +1406,15 @@ compress(fdin, fdout)
 	stcode = 1;
 	free_ent = FIRST;
 
+	/* use fewer bits if the tables for maxbits don't fit */
+	while (!alloc_tables(maxbits)) {
+		if (maxbits <= 12) {
+			fprintf(stderr, "%s: not enough memory\n", progname);
+			abort_compress();
+		}
+		--maxbits;
+	}
+
 	memset(outbuf, 0, sizeof(outbuf));
 	bytes_out = 0; bytes_in = 0;
 	outbuf[0] = MAGIC_1;
@@ -1414,7 +1518,7 @@ next2: 			fcode.e.c = inbuf[rpos++];
 #else
 #  define fc fcode.code
 #endif
-				hp = (((long)(fcode.e.c)) << (BITS-8)) ^
+				hp = (((long)(fcode.e.c)) << HSHIFT) ^
 					(long)(fcode.e.ent);
 
 				if ((i = htabof(hp)) == fc)
@@ -1531,7 +1635,7 @@ decompress(fdin, fdout)
 	int		fdin;
 	int		fdout;
 {
-	REG2 	char_type 	*stackp;
+	REG2 	char_type FAR	*stackp;
 	REG3	code_int	 code;
     	REG4	int		 finchar;
 	REG5	code_int	 oldcode;
@@ -1580,6 +1684,13 @@ decompress(fdin, fdout)
 		return;
 	}
 
+	if (!alloc_tables(maxbits)) {
+		fprintf(stderr, "%s: not enough memory for %d bits\n",
+		    (*ifname != '\0' ? ifname : "stdin"), maxbits);
+		exit_code = 4;
+		return;
+	}
+
 	bytes_in = insize;
 	maxcode = MAXCODE(n_bits = INIT_BITS)-1;
 	bitmask = (1<<n_bits)-1;
@@ -1693,7 +1804,7 @@ resetbuf:	;
 							i = OBUFSIZ-outpos;
 
 						if (i > 0) {
-							memcpy(outbuf+outpos, stackp, i);
+							stackcpy(outbuf+outpos, stackp, i);
 							outpos += i;
 						}
 
@@ -1707,7 +1818,7 @@ resetbuf:	;
 					}
 					while ((i = (de_stack-stackp)) > 0);
 				} else {
-					memcpy(outbuf+outpos, stackp, i);
+					stackcpy(outbuf+outpos, stackp, i);
 					outpos += i;
 				}
 			}
@@ -41,6 +41,7 @@
 #include <ctype.h> 
 #include <errno.h>
 #include <fcntl.h>
+#include <malloc.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -79,16 +80,20 @@ struct editorSyntax {
     int flags;
 };
 
-/* This structure represents a single line of the file we are editing. */
+/* This structure represents a single line of the file we are editing.
+ * The text is kept in the far heap, so the file size is not limited by the
+ * near heap. The rendered row and its highlight are only built for rows on
+ * the screen, see editorRowRender(). */
 typedef struct erow {
     int idx;            /* Row index in the file, zero-based. */
     int size;           /* Size of the row, excluding the null term. */
     int rsize;          /* Size of the rendered row. */
-    char *chars;        /* Row content. */
-    char *render;       /* Row content "rendered" for screen (for TABs). */
+    char __far *chars;  /* Row content. */
+    char *render;       /* Row content "rendered" for screen (for TABs), or
+                           NULL if not rendered. */
     unsigned char *hl;  /* Syntax highlight type for each character in render.*/
     int hl_oc;          /* Row had open comment at end in last syntax highlight
-                           check. */
+                           check, valid for rows before E.hlvalid. */
 } erow;
 
 /*
@@ -109,6 +114,10 @@ struct editorConfig {
     int screenrows; /* Number of rows that we can show */
     int screencols; /* Number of cols that we can show */
     int numrows;    /* Number of rows */
+    int rowcap;     /* Number of rows allocated */
+    int hlvalid;    /* Rows before this have up to date highlighting */
+    int drawoff;    /* Rows rendered by the last screen refresh */
+    int drawrows;
     int rawmode;    /* Is terminal raw mode enabled? */
     erow *row;      /* Rows */
     int dirty;      /* File modified but not saved. */
@@ -740,7 +749,8 @@ void editorBookmarks(int fd, int bm_number)
         
     if (bookmark[bm_number].linenum ==0) { /* set */
        bookmark[bm_number].linenum = E.rowoff+E.cy +1; 
-       snprintf(bookmark[bm_number].reminders,20,"%s",E.row[E.rowoff+E.cy].render);
+       if (E.rowoff+E.cy < E.numrows && editorRowRender(&E.row[E.rowoff+E.cy]) == 0)
+           snprintf(bookmark[bm_number].reminders,20,"%s",E.row[E.rowoff+E.cy].render);
        editorSetStatusMessage("Bookmark %d set. Line: %d, %s",bm_number,bookmark[bm_number].linenum,bookmark[bm_number].reminders);     
        editorRefreshScreen();
        return;
@@ -811,7 +821,7 @@ int editorUpdateSyntax(erow *row) {
 
     /* If the previous line has an open comment, this line starts
      * with an open comment state. */
-    if (row->idx > 0 && editorRowHasOpenComment(&E.row[row->idx-1]))
+    if (row->idx > 0 && E.row[row->idx-1].hl_oc)
         in_comment = 1;
 
     while(*p) {
@@ -918,15 +928,6 @@ int editorUpdateSyntax(erow *row) {
         prev_sep = is_separator(*p);
         p++; i++;
     }
-
-    /* Propagate syntax change to the next row if the open comment
-     * state changed. This may recursively affect all the following rows
-     * in the file. */
-    int oc = editorRowHasOpenComment(row);
-    if (row->hl_oc != oc && row->idx+1 < E.numrows)
-        if (editorUpdateSyntax(&E.row[row->idx+1]) == -1) return -1;
-    row->hl_oc = oc;
-    
     return 0;
 }
 
@@ -969,13 +970,31 @@ void editorSelectSyntaxHighlight(char *filename) {
 
 /* ======================= Editor rows implementation ======================= */
 
-/* Update the rendered version and the syntax highlight of a row. */
-int editorUpdateRow(erow *row) {
-    int tabs = 0, j, idx;
+/* Free the rendered version and the syntax highlight of a row. */
+void editorRowForget(erow *row) {
+    free(row->render);
+    free(row->hl);
+    row->render = NULL;
+    row->hl = NULL;
+    row->rsize = 0;
+}
+
+/* Mark the highlighting of the rows from 'at' on as out of date, forgetting
+ * any that are rendered. Only rows before E.hlvalid can be rendered. */
+void editorInvalidateRows(int at) {
+    for (; at < E.hlvalid; E.hlvalid--)
+        editorRowForget(&E.row[E.hlvalid-1]);
+}
+
+/* Build the rendered version and the syntax highlight of a row whose
+ * predecessors are up to date. If the open comment state at its end changed
+ * the rows below have to be highlighted again. */
+int editorBuildRow(erow *row) {
+    int tabs = 0, j, idx, oc;
 
    /* Create a version of the row we can directly print on the screen,
      * respecting tabs, substituting non printable characters with '?'. */
-    free(row->render);
+    editorRowForget(row);
     for (j = 0; j < row->size; j++)
         if (row->chars[j] == TAB) tabs++;
 
@@ -997,34 +1016,88 @@ int editorUpdateRow(erow *row) {
     row->render[idx] = '\0';
 
     /* Update the syntax highlighting attributes of the row. */
-    if (editorUpdateSyntax(row) == -1) return -1;
+    if (editorUpdateSyntax(row) == -1) {
+        editorRowForget(row);
+        return -1;
+    }
+    oc = editorRowHasOpenComment(row);
+    if (row->idx < E.hlvalid) {
+        if (oc != row->hl_oc)
+            editorInvalidateRows(row->idx+1);
+    } else {
+        E.hlvalid = row->idx+1;
+    }
+    row->hl_oc = oc;
     return 0;
 }
 
+/* Make sure a row is rendered. The rows above it whose open comment state
+ * is out of date are highlighted first, then released again. */
+int editorRowRender(erow *row) {
+    if (row->render) return 0;
+    while (E.hlvalid < row->idx) {
+        if (editorBuildRow(&E.row[E.hlvalid]) == -1) return -1;
+        editorRowForget(&E.row[E.hlvalid-1]);
+    }
+    return editorBuildRow(row);
+}
+
+/* Update the rendered version and the syntax highlight of a row after its
+ * text changed. Rows that were never highlighted are left for later. */
+int editorUpdateRow(erow *row) {
+    editorRowForget(row);
+    if (row->idx >= E.hlvalid) return 0;
+    return editorBuildRow(row);
+}
+
+/* Copy at most n-1 chars of a row starting at offset 'at' to buf, null
+ * terminated. Returns the number of chars copied. */
+int editorRowCopy(erow *row, int at, char *buf, int n) {
+    int len = row->size - at;
+
+    if (len >= n) len = n-1;
+    if (len < 0) len = 0;
+    fmemcpy(buf,row->chars+at,len);
+    buf[len] = '\0';
+    return len;
+}
+
 /* Insert a row at the specified position, shifting the other rows on the bottom
  * if required. */
-int editorInsertRow(int at, char *s, size_t len) {
+int editorInsertRow(int at, const char __far *s, size_t len) {
+    char __far *chars;
+
     if (at > E.numrows) return -1;
-    if ((E.row = realloc(E.row,sizeof(erow)*(E.numrows+1))) == NULL) { 
+    if (E.numrows == E.rowcap) {
+        /* Grow the row table in steps so loading a file does not copy it
+         * for every line, falling back to one row when memory is short. */
+        erow *new = realloc(E.row,sizeof(erow)*(E.rowcap+E.rowcap/4+32));
+        if (new) {
+            E.rowcap += E.rowcap/4+32;
+        } else {
+            if ((new = realloc(E.row,sizeof(erow)*(E.rowcap+1))) == NULL)
+                return -1; 
+            E.rowcap++;
+        }
+        E.row = new;
+    }
+    if ((chars = fmalloc(len+1)) == NULL) {
         return -1; 
     }
+    fmemcpy(chars,s,len);
+    chars[len] = '\0';
+    editorInvalidateRows(at);
     if (at != E.numrows) {
         memmove(E.row+at+1,E.row+at,sizeof(E.row[0])*(E.numrows-at));
         for (int j = at+1; j <= E.numrows; j++) E.row[j].idx++;
     }
     E.row[at].size = len;
-    if ((E.row[at].chars = malloc(len+1))==0) {
-        return -1; 
-    }
-    memcpy(E.row[at].chars,s,len+1);
+    E.row[at].chars = chars;
     E.row[at].hl = NULL;
     E.row[at].hl_oc = 0;
     E.row[at].render = NULL;
     E.row[at].rsize = 0;
     E.row[at].idx = at;
-    if (editorUpdateRow(E.row+at) == -1) { 
-        return -1;
-    }
     E.numrows++;
     E.dirty++;
     return 0;
@@ -1032,9 +1105,8 @@ int editorInsertRow(int at, char *s, size_t len) {
 
 /* Free row's heap allocated stuff. */
 void editorFreeRow(erow *row) {
-    free(row->render);
-    free(row->chars);
-    free(row->hl);
+    editorRowForget(row);
+    ffree(row->chars);
 }
 
 /* Remove the row at the specified position, shifting the remainign on the
@@ -1043,6 +1115,7 @@ void editorDelRow(int at) {
     erow *row;
 
     if (at >= E.numrows) return;
+    editorInvalidateRows(at);
     row = E.row+at;
     editorFreeRow(row);
     memmove(E.row+at,E.row+at+1,sizeof(E.row[0])*(E.numrows-at-1));
@@ -1082,20 +1155,25 @@ char *editorRowsToString(int *buflen) {
 /* Insert a character at the specified position in a row, moving the remaining
  * chars on the right if needed. */
 void editorRowInsertChar(erow *row, int at, int c) {
+    char __far *chars;
+
     if (at > row->size) {
         /* Pad the string with spaces if the insert location is outside the
          * current length by more than a single character. */
         int padlen = at-row->size;
         /* In the next line +2 means: new char and null term. */
-        row->chars = realloc(row->chars,row->size+padlen+2);
-        memset(row->chars+row->size,' ',padlen);
+        if ((chars = frealloc(row->chars,row->size+padlen+2)) == NULL) return;
+        row->chars = chars;
+        fmemset(row->chars+row->size,' ',padlen);
         row->chars[row->size+padlen+1] = '\0';
         row->size += padlen+1;
     } else {
         /* If we are in the middle of the string just make space for 1 new
          * char plus the (already existing) null term. */
-        row->chars = realloc(row->chars,row->size+2);
-        memmove(row->chars+at+1,row->chars+at,row->size-at+1);
+        if ((chars = frealloc(row->chars,row->size+2)) == NULL) return;
+        row->chars = chars;
+        for (int j = row->size; j >= at; j--)
+            chars[j+1] = chars[j];
         row->size++;
     }
     row->chars[at] = c;
@@ -1104,9 +1182,12 @@ void editorRowInsertChar(erow *row, int at, int c) {
 }
 
 /* Append the string 's' at the end of a row */
-void editorRowAppendString(erow *row, char *s, size_t len) {
-    row->chars = realloc(row->chars,row->size+len+1);
-    memcpy(row->chars+row->size,s,len);
+void editorRowAppendString(erow *row, const char __far *s, size_t len) {
+    char __far *chars;
+
+    if ((chars = frealloc(row->chars,row->size+len+1)) == NULL) return;
+    row->chars = chars;
+    fmemcpy(row->chars+row->size,s,len);
     row->size += len;
     row->chars[row->size] = '\0';
     editorUpdateRow(row);
@@ -1116,9 +1197,10 @@ void editorRowAppendString(erow *row, char *s, size_t len) {
 /* Delete the character at offset 'at' from the specified row. */
 void editorRowDelChar(erow *row, int at) {
     if (row->size <= at) return;
-    memmove(row->chars+at,row->chars+at+1,row->size-at);
-    editorUpdateRow(row);
+    for (int j = at; j < row->size; j++)
+        row->chars[j] = row->chars[j+1];
     row->size--;
+    editorUpdateRow(row);
     E.dirty++;
 }
 
@@ -1325,8 +1407,8 @@ int editorInsertFile(int at) {
 
 /* Save the current file on disk. Return 0 on success, 1 on error. */
 int editorSave(void) {
-    int len, fd, j;
-    char nl[2] = "\n";
+    int len, fd, j, n, off, pos;
+    char buf[512];
     /* Compute count of bytes */
     len=0;
     for (j = 0; j < E.numrows; j++)
@@ -1342,9 +1424,25 @@ int editorSave(void) {
     fd = open(E.filename,O_RDWR|O_CREAT,0644);
     if (fd == -1) goto writeerr;
 
+    /* Rows are in the far heap, so collect them in buf for writing. */
+    pos = 0;
     for (j = 0; j < E.numrows; j++) {
-        if (write(fd,strncat(E.row[j].chars,nl,1),E.row[j].size+1) != E.row[j].size+1) goto writeerr;
+        for (off = 0; off <= E.row[j].size; off += n) {
+            n = E.row[j].size - off;
+            if (n > (int)sizeof(buf) - pos) n = sizeof(buf) - pos;
+            fmemcpy(buf+pos,E.row[j].chars+off,n);
+            pos += n;
+            if (off + n == E.row[j].size && pos < (int)sizeof(buf)) {
+                buf[pos++] = '\n';
+                n++;
+            }
+            if (pos == sizeof(buf)) {
+                if (write(fd,buf,pos) != pos) goto writeerr;
+                pos = 0;
+            }
+        }
     }
+    if (pos && write(fd,buf,pos) != pos) goto writeerr;
 
     close(fd);
     E.dirty = 0;
@@ -1443,6 +1541,13 @@ void editorRefreshScreen(void) {
 	//char background_color[32];
     struct abuf ab = ABUF_INIT;
 
+    /* Release the rows scrolled off the screen since the last refresh. */
+    for (y = E.drawoff; y < E.drawoff+E.drawrows && y < E.numrows; y++)
+        if (y < E.rowoff || y >= E.rowoff+E.screenrows)
+            editorRowForget(&E.row[y]);
+    E.drawoff = E.rowoff;
+    E.drawrows = E.screenrows;
+
     abAppend(&ab,"\x1b[?25l",6); /* Hide cursor. */
     abAppend(&ab,"\x1b[H",3); /* Go home. */
 	//abAppend(&ab, background_color, strlen(background_color));
@@ -1539,6 +1644,7 @@ void editorRefreshScreen(void) {
         }
 
         r = &E.row[filerow];
+        editorRowRender(r);
 
         int len = r->rsize - E.coloff;
         int current_color = -1;
@@ -1656,7 +1762,8 @@ void editorFind(int fd, int mode) {
 
 #define FIND_RESTORE_HL do { \
     if (saved_hl) { \
-        memcpy(E.row[saved_hl_line].hl,saved_hl, E.row[saved_hl_line].rsize); \
+        if (E.row[saved_hl_line].hl) \
+            memcpy(E.row[saved_hl_line].hl,saved_hl, E.row[saved_hl_line].rsize); \
         free(saved_hl); \
         saved_hl = NULL; \
     } \
@@ -1745,12 +1852,16 @@ void editorFind(int fd, int mode) {
                 else if (current == E.numrows) current = 0;
                 
                 if (!(eof==1 && mode==2)){
+                /* Render rows to search them, releasing those not shown. */
+                int shown = E.row[current].render != NULL;
+                if (editorRowRender(&E.row[current]) == -1) break;
                 match = strstr(E.row[current].render,query);
                 additional = strstr(match+1,query);
                 if (match) {
                     match_offset = match-E.row[current].render;
                     break;
                 }
+                if (!shown) editorRowForget(&E.row[current]);
                 }
             }
             } /*additional*/
@@ -2133,12 +2244,12 @@ void copylines(int numlines) {
       erow *row = (filerow >= E.numrows) ? NULL : &E.row[filerow+i];
       if (i==0) {
         str = (char*)malloc((sizeof(char)*row->size)+2); /*+2 for NL + zero byte */
-        sprintf(buf,"%s\n",row->chars);
+        strcat(buf+editorRowCopy(row,0,buf,sizeof(buf)-1),"\n");
         strcpy(str,buf);
       } else {
         len = strlen(str);
         str = (char*)realloc(str,len+2+(sizeof(char)*row->size));
-        sprintf(buf,"%s\n",row->chars);
+        strcat(buf+editorRowCopy(row,0,buf,sizeof(buf)-1),"\n");
         strcat(str,buf);
       }
     }   
@@ -2159,10 +2270,11 @@ void copybuffer(void) {
     copyTopRow=E.rowoff+E.cy;
     copyBottomRow=copyTopRow; //init
     str = (char*)malloc((sizeof(char)*row->size)-E.cx+2); /*+2 for NL + zero byte */
-    sprintf(buf,"%s\n",row->chars+E.cx);
+    strcat(buf+editorRowCopy(row,E.cx,buf,sizeof(buf)-1),"\n");
     strcpy(str,buf);
     lineoffset = E.cx;
-    memset(row->hl+E.cx,HL_MATCH,(sizeof(char)*row->size)-E.cx);
+    if (editorRowRender(row) == 0)
+        memset(row->hl+E.cx,HL_MATCH,(sizeof(char)*row->size)-E.cx);
     
     while (1) {
       c = editorReadKey(0); 
@@ -2173,17 +2285,18 @@ void copybuffer(void) {
             erow *row = (filerow >= E.numrows) ? NULL : &E.row[E.rowoff+E.cy];
             len = strlen(str);
             str = (char*)realloc(str,len+2+(sizeof(char)*row->size));
-            sprintf(buf,"%s\n",row->chars);
+            strcat(buf+editorRowCopy(row,0,buf,sizeof(buf)-1),"\n");
             strcat(str,buf);
-            memset(row->hl,HL_MATCH,(sizeof(char)*row->size));            
+            if (editorRowRender(row) == 0)
+                memset(row->hl,HL_MATCH,(sizeof(char)*row->size));
             lineoffset=0; /* indicates more than one line */
             copyBottomRow++; //to be able to clear
         }
       }
       if (c == ENTER) {
         if ((E.rowoff+E.cy < copyTopRow) || (lineoffset !=0 && E.cx < lineoffset)) { /* left or up from start point */
-            for (i=copyTopRow; i < copyBottomRow+2; i++) {
-                editorUpdateSyntax(&E.row[i]); 
+            for (i=copyTopRow; i < copyBottomRow+2 && i < E.numrows; i++) {
+                editorRowForget(&E.row[i]); 
             }
             free(str);
             copyTopRow = copyBottomRow = 0;
@@ -2196,14 +2309,16 @@ void copybuffer(void) {
             snprintf(str,strlen(str)-strlen(buf)+1,"%s",str);
             len = strlen(str);
             str = (char*)realloc(str,len+2+E.cx);
-            snprintf(buf,E.cx+1,"%s",row->chars);
+            editorRowCopy(row,0,buf,E.cx+1);
             strcat(str,buf);
         } else {
             /* cut out chars behind cursor if just one line */
             snprintf(str,E.cx-1,"%s",str);
         }
-        memset(row->hl+lineoffset,HL_MATCH,E.cx);  
-        memset(row->hl+E.cx,0,(sizeof(char)*row->size)-E.cx); /*will remove any attribute */
+        if (editorRowRender(row) == 0) {
+            memset(row->hl+lineoffset,HL_MATCH,E.cx);  
+            memset(row->hl+E.cx,0,(sizeof(char)*row->size)-E.cx); /*will remove any attribute */
+        }
         break;
       }
     }
@@ -2229,8 +2344,8 @@ void pastebuffer() {
         }
 	}
 	if ((copyTopRow+copyBottomRow) != 0) {
-        for (i=copyTopRow; i<copyBottomRow; i++) {
-            editorUpdateSyntax(&E.row[i]);
+        for (i=copyTopRow; i<copyBottomRow && i<E.numrows; i++) {
+            editorRowForget(&E.row[i]);
         }
         copyTopRow = copyBottomRow = 0;
     }
@@ -2254,8 +2369,8 @@ int bufferToFile(void)
     close(fd);
     /*erase highlight */
     if ((copyTopRow+copyBottomRow) != 0) {
-        for (i=copyTopRow; i<copyBottomRow; i++) {
-            editorUpdateSyntax(&E.row[i]);
+        for (i=copyTopRow; i<copyBottomRow && i<E.numrows; i++) {
+            editorRowForget(&E.row[i]);
         }
         copyTopRow = copyBottomRow = 0;
     }
@@ -2287,6 +2402,10 @@ void initEditor(void) {
     E.rowoff = 0;
     E.coloff = 0;
     E.numrows = 0;
+    E.rowcap = 0;
+    E.hlvalid = 0;
+    E.drawoff = E.drawrows = 0;
+    free(E.row);
     E.row = NULL;
     E.dirty = 0;
     E.filename = NULL;
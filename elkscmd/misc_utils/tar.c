@@ -50,6 +50,7 @@
 #include <sys/stat.h>
 #include <sys/dir.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 
 #define ELKS            1
 #define DO_REPLACE      0   /* =1 for tar 'r' option, requires awk */
@@ -58,7 +59,8 @@ typedef unsigned long daddr_t;
 daddr_t	bsrch();
 daddr_t	lookup();
 #define TBLOCK	512
-#define NBLOCK	20
+#define NBLOCK	20		/* default blocking factor */
+#define MAXBLOCK	40		/* largest blocking factor, 20K */
 #define NAMSIZ	100
 union hblock {
 	char dummy[TBLOCK];
@@ -73,7 +75,7 @@ union hblock {
 		char linkflag;
 		char linkname[NAMSIZ];
 	} dbuf;
-} dblock, tbuf[NBLOCK];
+} dblock, *tbuf;
 
 struct linkbuf {
 	ino_t	inum;
@@ -87,8 +89,11 @@ struct stat stbuf;
 
 int	rflag, xflag, vflag, tflag, mt, cflag, mflag;
 int	term, chksum, wflag, recno, first, linkerrok;
-int	hflag, oflag, pflag;
+int	hflag, oflag, pflag, zflag;
 int	nblock = 1;
+int	nrec;			/* records read into tbuf */
+int	streamflag;		/* fill tbuf on every read */
+int	zpid;
 
 daddr_t	low;
 daddr_t	high;
@@ -101,6 +106,7 @@ char	magtape[]	= "/dev/mt1";
 
 void putfile();
 int readtape();
+void tape2file();
 int writetape();
 
 void
@@ -153,14 +159,21 @@ register struct stat *st;
 
 done(n)
 {
+	int status;
+
 	unlink(tname);
+	if (zpid > 0) {
+		close(mt);
+		if (waitpid(zpid, &status, 0) == zpid && status != 0 && n == 0)
+			n = 1;
+	}
 	exit(n);
 }
 
 void
 usage()
 {
-	fprintf(stderr, "tar: usage  tar -{txu}[cvfblmhop] [tarfile] [blocksize] file1 file2...\n");
+	fprintf(stderr, "tar: usage  tar -{txu}[cvfblmhopz] [tarfile] [blocksize] file1 file2...\n");
 	done(1);
 }
 
@@ -235,10 +248,23 @@ putempty()
 	writetape(buf);
 }
 
+void
+flushblock()
+{
+	if (write(mt, tbuf, TBLOCK*nblock) != TBLOCK*nblock) {
+		fprintf(stderr, "Tar: write error %d\n", errno);
+		done(2);
+	}
+	recno = 0;
+}
+
 void
 flushtape()
 {
-	write(mt, tbuf, TBLOCK*nblock);
+	if (recno > 0) {
+		memset(&tbuf[recno], 0, (nblock - recno) * TBLOCK);
+		flushblock();
+	}
 }
 
 void
@@ -332,6 +358,7 @@ backtape()
 			fprintf(stderr, "Tar: read error after seek\n");
 			done(4);
 		}
+		nrec = nblock;
 		lseek(mt, (long) -TBLOCK, 1);
 	}
 }
@@ -389,17 +416,9 @@ getdir()
 void
 passtape()
 {
-	long blocks;
-	char buf[TBLOCK];
-
 	if (dblock.dbuf.linkflag == '1')
 		return;
-	blocks = stbuf.st_size;
-	blocks += TBLOCK-1;
-	blocks /= TBLOCK;
-
-	while (blocks-- > 0)
-		readtape(buf);
+	tape2file(-1, stbuf.st_size, (char *)0);
 }
 
 void
@@ -418,26 +437,40 @@ writetape(buffer)
 char *buffer;
 {
 	first = 1;
-	if (nblock == 0)
-		nblock = 1;
-	if (recno >= nblock) {
-		if (write(mt, tbuf, TBLOCK*nblock) < 0) {
-			fprintf(stderr, "Tar: write error %d\n", errno);
-			done(2);
-		}
-		recno = 0;
-	}
 	copy(&tbuf[recno++], buffer);
-	if (recno >= nblock) {
-		if (write(mt, tbuf, TBLOCK*nblock) < 0) {
-			fprintf(stderr, "Tar: write error %d\n", errno);
-			done(2);
-		}
-		recno = 0;
-	}
+	if (recno >= nblock)
+		flushblock();
 	return(TBLOCK);
 }
 
+/*
+ * Read up to *blocksp records of file data straight into the tape buffer,
+ * zero filling the last record. Returns the last read result, with
+ * *blocksp left at the number of records not read.
+ */
+file2tape(fd, blocksp)
+int fd;
+long *blocksp;
+{
+	int i, n;
+
+	first = 1;
+	while (*blocksp > 0) {
+		n = nblock - recno;
+		if (n > *blocksp)
+			n = *blocksp;
+		if ((i = read(fd, (char *)&tbuf[recno], n * TBLOCK)) <= 0)
+			return(i);
+		n = (i + TBLOCK-1) / TBLOCK;
+		memset((char *)&tbuf[recno] + i, 0, n * TBLOCK - i);
+		recno += n;
+		*blocksp -= n;
+		if (recno >= nblock)
+			flushblock();
+	}
+	return(0);
+}
+
 void
 tomodes(sp)
 register struct stat *sp;
@@ -618,10 +651,9 @@ putfile(longname, shortname, parent)
         sprintf(dblock.dbuf.chksum, "%6o", checksum());
         writetape( (char *) &dblock);
 
-        while ((i = read(infile, buf, TBLOCK)) > 0 && blocks > 0) {
-            writetape(buf);
-            blocks--;
-        }
+        i = file2tape(infile, &blocks);
+        if (i == 0 && blocks == 0)
+            i = read(infile, buf, 1);   /* check the file didn't grow */
         close(infile);
 		if (i < 0) {
 			fprintf(stderr, "tar: Read error on ");
@@ -702,7 +734,6 @@ char	*argv[];
 	long blocks, bytes;
 	char **cp;
 	int ofile;
-	char buf[TBLOCK];
 
 	for (;;) {
 		getdir();
@@ -782,20 +813,7 @@ gotit:
 		blocks = ((bytes = stbuf.st_size) + TBLOCK-1)/TBLOCK;
 		if (vflag)
 			fprintf(stderr, "x %s, %ld bytes, %ld blocks\n", dblock.dbuf.name, bytes, blocks);
-		while (blocks-- > 0) {
-			readtape(buf);
-			if (bytes > TBLOCK) {
-				if (write(ofile, buf, TBLOCK) < 0) {
-					fprintf(stderr, "tar: %s: HELP - extract write error\n", dblock.dbuf.name);
-					done(2);
-				}
-			} else
-				if (write(ofile, buf, (int) bytes) < 0) {
-					fprintf(stderr, "tar: %s: HELP - extract write error\n", dblock.dbuf.name);
-					done(2);
-				}
-			bytes -= TBLOCK;
-		}
+		tape2file(ofile, bytes, dblock.dbuf.name);
 		close(ofile);
 		if (mflag == 0) {
 			struct utimbuf ut;
@@ -928,55 +946,130 @@ loop:
 	return(m);
 }
 
-readtape(buffer)
-char *buffer;
+/*
+ * Read the next tape block into tbuf. Tapes return one block per read,
+ * and the first read takes the blocking factor from the tape. Pipes may
+ * return any amount, so partial records are always finished and streams
+ * are read until the whole block is full.
+ */
+void
+filltape()
 {
-	int i, j;
-	int n, off = 0, total = 0;
+	int i, n, total = 0;
 
-	if (recno >= nblock || first == 0) {
-		if (first == 0 && nblock == 0)
-			j = NBLOCK;
-		else
-			j = nblock;
-		n = TBLOCK * j;
-again:
-		if ((i = read(mt, (char *)tbuf+off, n)) < 0) {
+	n = TBLOCK * (nblock? nblock: NBLOCK);
+	do {
+		if ((i = read(mt, (char *)tbuf+total, n-total)) < 0) {
 			fprintf(stderr, "Tar: read error, %d\n", errno);
 			done(3);
 		}
-#if ELKS
-		/* keep reading as pipe reads may only return 80 characters */
 		total += i;
-		if (i != 0 && (i % TBLOCK) != 0) {
-			off += i;
-			n -= i;
-			if (n != 0) goto again;
-		}
-		i = total;
-#endif
-		if (first == 0) {
-			if ((i % TBLOCK) != 0) {
-				fprintf(stderr, "Tar: blocksize error\n");
-				done(3);
-			}
-			i /= TBLOCK;
-			if (rflag && i != 1) {
-				fprintf(stderr, "Tar: Cannot update blocked tapes (yet)\n");
-				done(4);
-			}
-			if (i != nblock && i != 1) {
-				fprintf(stderr, "Tar: blocksize = %d\n", i);
-				nblock = i;
-			}
+	} while (i != 0 && total < n && (streamflag || (total % TBLOCK) != 0));
+	if ((total % TBLOCK) != 0) {
+		fprintf(stderr, "Tar: blocksize error\n");
+		done(3);
+	}
+	if (total == 0) {
+		fprintf(stderr, "Tar: unexpected end of archive\n");
+		done(3);
+	}
+	nrec = total / TBLOCK;
+	if (first == 0 && !streamflag) {
+		if (rflag && nrec != 1) {
+			fprintf(stderr, "Tar: Cannot update blocked tapes (yet)\n");
+			done(4);
 		}
-		recno = 0;
+		if (nblock && nrec != nblock && nrec != 1)
+			fprintf(stderr, "Tar: blocksize = %d\n", nrec);
+		nblock = nrec;
 	}
 	first = 1;
+	recno = 0;
+}
+
+readtape(buffer)
+char *buffer;
+{
+	if (recno >= nrec)
+		filltape();
 	copy(buffer, &tbuf[recno++]);
 	return(TBLOCK);
 }
 
+/*
+ * Write bytes of file data from the tape to fd straight out of the
+ * tape buffer, or skip over them if fd is -1.
+ */
+void
+tape2file(fd, bytes, name)
+int fd;
+long bytes;
+char *name;
+{
+	int n, len;
+
+	while (bytes > 0) {
+		if (recno >= nrec)
+			filltape();
+		n = nrec - recno;
+		len = n * TBLOCK;
+		if (len > bytes) {
+			len = bytes;
+			n = (len + TBLOCK-1) / TBLOCK;
+		}
+		if (fd >= 0 && write(fd, (char *)&tbuf[recno], len) != len) {
+			fprintf(stderr, "tar: %s: HELP - extract write error\n", name);
+			done(2);
+		}
+		recno += n;
+		bytes -= len;
+	}
+}
+
+/*
+ * Allocate the tape buffer, large enough for the default blocking
+ * factor so that reads can find the blocking of the tape.
+ */
+void
+gettbuf()
+{
+	int n = nblock > NBLOCK? nblock: NBLOCK;
+
+	if ((tbuf = (union hblock *)malloc(n * TBLOCK)) == NULL) {
+		fprintf(stderr, "tar: not enough memory for %d blocks\n", n);
+		done(1);
+	}
+}
+
+/*
+ * Run compress on the other side of a pipe to the archive fd,
+ * returning the pipe for use as the tape.
+ */
+zpipe(fd, writing)
+int fd, writing;
+{
+	int pfd[2];
+
+	if (pipe(pfd) < 0 || (zpid = fork()) < 0) {
+		fprintf(stderr, "tar: cannot run compress\n");
+		done(1);
+	}
+	if (zpid == 0) {
+		dup2(writing? pfd[0]: fd, 0);
+		dup2(writing? fd: pfd[1], 1);
+		close(pfd[0]);
+		close(pfd[1]);
+		close(fd);
+		execlp("compress", "compress", writing? "-c": "-dc", (char *)0);
+		perror("compress");
+		_exit(1);
+	}
+	close(fd);
+	close(writing? pfd[0]: pfd[1]);
+	streamflag++;
+	return(writing? pfd[1]: pfd[0]);
+}
+
 main(argc, argv)
 int	argc;
 char	*argv[];
@@ -1050,8 +1143,8 @@ noupdate:
 			break;
 		case 'b':
 			nblock = atoi(*argv++);
-			if (nblock > NBLOCK || nblock <= 0) {
-				fprintf(stderr, "Invalid blocksize. (Max %d)\n", NBLOCK);
+			if (nblock > MAXBLOCK || nblock <= 0) {
+				fprintf(stderr, "Invalid blocksize. (Max %d)\n", MAXBLOCK);
 				done(1);
 			}
 			if (rflag && !cflag)
@@ -1060,11 +1153,19 @@ noupdate:
 		case 'l':
 			linkerrok++;
 			break;
+		case 'z':
+			zflag++;
+			break;
 		default:
 			fprintf(stderr, "tar: %c: unknown option\n", *cp);
 			usage();
 		}
 
+	if (zflag && rflag && !cflag) {
+		fprintf(stderr, "Tar: Compressed archives cannot be updated\n");
+		done(1);
+	}
+	gettbuf();
 	if (rflag) {
 		if (cflag && tfile != NULL)
 			usage();
@@ -1084,7 +1185,6 @@ noupdate:
 				done(1);
 			}
 			mt = dup(1);
-			nblock = 1;
 		}
 		else if ((mt = open(usefile, 2)) < 0) {
 			if (cflag == 0 || (mt =  creat(usefile, 0666)) < 0) {
@@ -1092,29 +1192,35 @@ noupdate:
 				done(1);
 			}
 		}
-		if (cflag == 0 && nblock == 0)
-			nblock = 1;
+		if (nblock == 0)
+			nblock = cflag? NBLOCK: 1;
+		if (zflag)
+			mt = zpipe(mt, 1);
 		dorep(argv);
 	} else if (xflag)  {
 		if (strcmp(usefile, "-") == 0) {
 			mt = dup(0);
-			nblock = 1;
+			streamflag++;
 		}
 		else if ((mt = open(usefile, 0)) < 0) {
 			fprintf(stderr, "tar: cannot open %s\n", usefile);
 			done(1);
 		}
+		if (zflag)
+			mt = zpipe(mt, 0);
 		doxtract(argv);
 	}
 	else if (tflag) {
 		if (strcmp(usefile, "-") == 0) {
 			mt = dup(0);
-			nblock = 1;
+			streamflag++;
 		}
 		else if ((mt = open(usefile, 0)) < 0) {
 			fprintf(stderr, "tar: cannot open %s\n", usefile);
 			done(1);
 		}
+		if (zflag)
+			mt = zpipe(mt, 0);
 		dotable();
 	}
 	else
@@ -154,6 +154,8 @@ typedef struct _screendevice {
 			COORD *retht,FONTID fontid);
 	void	(*Blit)(PSD destpsd,COORD destx,COORD desty,COORD w,COORD h,
 			PSD srcpsd,COORD srcx,COORD srcy,int op);
+	void	(*DrawBitmap)(PSD psd,COORD x,COORD y,COORD width,COORD height,
+			IMAGEBITS *imagebits,PIXELVAL fg);	/* optional*/
 } SCREENDEVICE;
 
 /* PSD flags*/
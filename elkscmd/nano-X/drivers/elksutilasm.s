@@ -105,6 +105,114 @@ ANDBYTE_FP:
 	pop		%bp
 	ret
 
+//
+// Fill rows of a span of bytes in EGA/VGA memory
+//
+//void ega_fillspan(FARADDR dst,int n,int rows,int lmask,int rmask,int rmw)
+//
+// The caller programs the graphics controller for the color and drawing
+// mode. Each row is n bytes, the first and last byte are written with the
+// bit masks lmask and rmask (both for a single byte) and the bytes between
+// with all bits set. When rmw is zero the inner bytes are just stored,
+// otherwise each is read first to load the latches for the logical op.
+//
+	.global	ega_fillspan
+ega_fillspan:
+	push	%bp
+	mov		%sp,%bp
+	push	%si
+	push	%di
+	push	%ds
+	push	%es
+
+	mov		6(%bp),%ax	// ds = es = hi addr
+	mov		%ax,%ds
+	mov		%ax,%es
+	mov		$0x3ce,%dx	// select bit mask register
+	mov		$8,%al
+	out		%al,%dx
+	inc		%dx			// dx = bit mask port
+	mov		4(%bp),%bx	// bx = lo addr of row
+	cld
+
+1:	mov		%bx,%si
+	mov		%bx,%di
+	mov		8(%bp),%cx	// cx = n
+	mov		12(%bp),%al	// al = lmask
+	dec		%cx
+	jnz		2f
+	and		14(%bp),%al	// single byte, al = lmask & rmask
+	out		%al,%dx
+	movsb				// rmw byte at ds:si
+	jmp		5f
+
+2:	out		%al,%dx
+	movsb				// rmw first byte
+	dec		%cx			// cx = inner bytes
+	mov		$0xff,%al
+	out		%al,%dx
+	cmpw	$0,16(%bp)
+	jne		3f
+	rep stosb			// store inner bytes, value is from set/reset
+	jmp		4f
+3:	rep movsb			// rmw inner bytes
+4:	mov		%di,%si
+	mov		14(%bp),%al	// al = rmask
+	out		%al,%dx
+	movsb				// rmw last byte
+
+5:	add		$80,%bx		// next row
+	decw	10(%bp)
+	jnz		1b
+
+	pop		%es
+	pop		%ds
+	pop		%di
+	pop		%si
+	pop		%bp
+	ret
+
+//
+// Copy rows of a span of bytes within EGA/VGA memory
+//
+//void ega_copyspan(FARADDR dst,FARADDR src,int n,int rows)
+//
+// The caller sets write mode 1, so each byte read loads the latches of
+// all four planes and each write stores them.
+//
+	.global	ega_copyspan
+ega_copyspan:
+	push	%bp
+	mov		%sp,%bp
+	push	%si
+	push	%di
+	push	%ds
+	push	%es
+
+	mov		6(%bp),%ax	// es = hi dst addr
+	mov		%ax,%es
+	mov		10(%bp),%ax	// ds = hi src addr
+	mov		%ax,%ds
+	mov		4(%bp),%bx	// bx = lo dst addr of row
+	mov		8(%bp),%dx	// dx = lo src addr of row
+	cld
+
+1:	mov		%bx,%di
+	mov		%dx,%si
+	mov		12(%bp),%cx	// cx = n
+	rep movsb			// copy bytes from ds:si to es:di
+	add		$80,%bx		// next row
+	add		$80,%dx
+	decw	14(%bp)
+	jnz		1b
+
+	pop		%es
+	pop		%ds
+	pop		%di
+	pop		%si
+	pop		%bp
+	ret
+
 //
 // Input byte from i/o port
 //
@@ -169,6 +169,8 @@ vga_to_vga_blit(PSD dstpsd, COORD dstx, COORD dsty, COORD w, COORD h,
 	volatile FARADDR	src;
 	int	i, plane;
 	int	x1, x2;
+	int	lmask, rmask;
+	unsigned char b;
 
 	assert (dstx >= 0 && dstx < dstpsd->xres);
 	assert (dsty >= 0 && dsty < dstpsd->yres);
@@ -181,40 +183,52 @@ vga_to_vga_blit(PSD dstpsd, COORD dstx, COORD dsty, COORD w, COORD h,
 	assert (srcx+w <= srcpsd->xres);
 	assert (srcy+h <= srcpsd->yres);
 
+	set_op(0);		/* modetable[MODE_SET]*/
 	set_enable_sr(0);
 	dst = SCREENBASE + dstx/8 + dsty * BYTESPERLINE;
 	src = SCREENBASE + srcx/8 + srcy * BYTESPERLINE;
 	x1 = dstx/8;
 	x2 = (dstx + w - 1) / 8;
-	while(--h >= 0) {
-		for(plane=0; plane<4; ++plane) {
-			volatile FARADDR d = dst;
-			volatile FARADDR s = src;
+	lmask = 0xff >> (dstx & 7);
+	rmask = 0xff << (7 - ((dstx + w - 1) & 7));
+	if(x1 == x2)
+		lmask &= rmask;
 
+	/* the partial bytes at the ends of each row are done a plane at a time*/
+	for(i=0; i<h; ++i) {
+		for(plane=0; plane<4; ++plane) {
 	    		set_read_plane(plane);
 			set_write_planes(1 << plane);
+			select_mask();
 
 			/* FIXME: only works if srcx and dstx are same modulo*/
-			select_mask();
-			if(x1 == x2) {
-		  		set_mask((0xff >> (x1 & 7)) & (0xff << (7 - (x2 & 7))));
-				PUTBYTE_FP(d, GETBYTE_FP(s));
-			} else {
-				set_mask(0xff >> (x1 & 7));
-				PUTBYTE_FP(d++, GETBYTE_FP(s++));
-
-				set_mask(0xff);
-		  		for(i=x1+1; i<x2; ++i)
-					PUTBYTE_FP(d++, GETBYTE_FP(s++));
-
-		  		set_mask(0xff << (7 - (x2 & 7)));
-				PUTBYTE_FP(d, GETBYTE_FP(s));
+			/* the dst read loads the latches for the masked bits*/
+			set_mask(lmask);
+			b = GETBYTE_FP(src);
+			GETBYTE_FP(dst);
+			PUTBYTE_FP(dst, b);
+			if(x1 != x2) {
+		  		set_mask(rmask);
+				b = GETBYTE_FP(src + x2 - x1);
+				GETBYTE_FP(dst + x2 - x1);
+				PUTBYTE_FP(dst + x2 - x1, b);
 			}
 		}
 		dst += BYTESPERLINE;
 		src += BYTESPERLINE;
 	}
+
+	/* the full bytes between are copied in all planes through the latches*/
 	set_write_planes(0x0f);
+	if(x2 - x1 > 1) {
+		dst = SCREENBASE + dstx/8 + dsty * BYTESPERLINE;
+		src = SCREENBASE + srcx/8 + srcy * BYTESPERLINE;
+		set_mode(1);
+		ega_copyspan(dst + 1, src + 1, x2 - x1 - 1, h);
+		set_mode(0);
+	}
+	select_mask();
+	set_mask(0xff);
 	set_enable_sr(0x0f);
 }
 
@@ -15,7 +15,8 @@
  * 	doesn't know about any planar or packed arrangement, relying soley
  * 	on the following external routines for all graphics drawing:
  * 		ega_init, ega_drawpixel, ega_readpixel,
- * 		ega_drawhorzline, ega_drawvertline
+ * 		ega_drawhorzline, ega_drawvertline,
+ * 		ega_fillrect, ega_drawbitmap
  * 	In addition, romfont.c is linked in for the PC rom font routines.
  *
  * 	All text/font drawing code is based on the above routines and
@@ -56,6 +57,8 @@ static PIXELVAL VGA_readpixel(PSD psd,COORD x, COORD y);
 static void VGA_drawhline(PSD psd,COORD x1, COORD x2, COORD y, PIXELVAL c);
 static void VGA_drawvline(PSD psd,COORD x,COORD y1,COORD y2,PIXELVAL c);
 static void VGA_fillrect(PSD psd,COORD x1,COORD y1,COORD x2,COORD y2,PIXELVAL c);
+static void VGA_drawbitmap(PSD psd,COORD x,COORD y,COORD width,COORD height,
+		IMAGEBITS *imagebits,PIXELVAL c);
 
 SCREENDEVICE	scrdev = {
 	0, 0, 0, 0, 0, 0, 0, 0, 0, NULL,
@@ -71,7 +74,8 @@ SCREENDEVICE	scrdev = {
 	pcrom_getfontinfo,
 	pcrom_gettextsize,
 	pcrom_gettextbits,
-	ega_blit
+	ega_blit,
+	VGA_drawbitmap
 };
 
 /* operating mode*/
@@ -227,13 +231,45 @@ VGA_drawvline(PSD psd,COORD x, COORD y1, COORD y2, PIXELVAL c)
 static void
 VGA_fillrect(PSD psd,COORD x1, COORD y1, COORD x2, COORD y2, PIXELVAL c)
 {
-	++x2;		/* draw last point*/
 #if HAVEBLIT
 	if(psd->flags & PSF_MEMORY) {
+		++x2;		/* draw last point*/
 		while(y1 <= y2)
 			mempl4_drawhorzline(psd, x1, x2, y1++, c);
 	} else 
 #endif
-		while(y1 <= y2)
-			ega_drawhorzline(psd, x1, x2, y1++, c);
+		ega_fillrect(psd, x1, y1, x2, y2, c);
+}
+
+/* Draw the set bits of a bitmap in color c*/
+static void
+VGA_drawbitmap(PSD psd,COORD x, COORD y, COORD width, COORD height,
+	IMAGEBITS *imagebits, PIXELVAL c)
+{
+#if HAVEBLIT
+	COORD		minx = x;
+	COORD		maxx = x + width - 1;
+	IMAGEBITS	bitvalue = 0;
+	int		bitcount = 0;
+
+	if(psd->flags & PSF_MEMORY) {
+		while(height > 0) {
+			if(bitcount <= 0) {
+				bitcount = IMAGE_BITSPERIMAGE;
+				bitvalue = *imagebits++;
+			}
+			if(IMAGE_TESTBIT(bitvalue))
+				mempl4_drawpixel(psd, x, y, c);
+			bitvalue = IMAGE_SHIFTBIT(bitvalue);
+			bitcount--;
+			if(x++ == maxx) {
+				x = minx;
+				y++;
+				height--;
+				bitcount = 0;
+			}
+		}
+	} else 
+#endif
+		ega_drawbitmap(psd, x, y, width, height, imagebits, c);
 }
@@ -113,58 +113,99 @@ ega_readpixel(PSD psd,unsigned int x,unsigned int y)
 	return c;
 }
 
-/* Draw horizontal line from x1,y to x2,y not including final point*/
+#if !ELKS
+/*
+ * Fill rows of a span of n bytes starting at dst, the first and last
+ * bytes with bit masks lmask and rmask and the inner ones fully.  The
+ * graphics controller must be set up for the color and drawing mode.
+ * If rmw is set the inner bytes are read first, to load the latches
+ * for the logical op.  Rows are 80 bytes apart, as in the asm version
+ * ELKS uses from elksutilasm.s.
+ */
 void
-ega_drawhorzline(PSD psd, unsigned int x1, unsigned int x2, unsigned int y,
-	PIXELVAL c)
+ega_fillspan(FARADDR dst, int n, int rows, int lmask, int rmask, int rmw)
 {
-	FARADDR dst, last;
+	FARADDR d;
+	int	i;
 
-	--x2;
+	select_mask ();
+	while (--rows >= 0) {
+		d = dst;
+		if (n == 1) {
+			set_mask (lmask & rmask);
+			RMW_FP (d);
+		} else {
+			set_mask (lmask);
+			RMW_FP (d++);
+			set_mask (0xff);
+			for (i = n - 2; i > 0; --i) {
+				if (rmw)
+					RMW_FP (d++);
+				else PUTBYTE_FP (d++, 0xff);
+			}
+			set_mask (rmask);
+			RMW_FP (d);
+		}
+		dst += 80;
+	}
+}
+
+/*
+ * Copy rows of a span of n bytes from src to dst, write mode 1 must be set.
+ */
+void
+ega_copyspan(FARADDR dst, FARADDR src, int n, int rows)
+{
+	FARADDR d, s;
+	int	i;
+
+	while (--rows >= 0) {
+		d = dst;
+		s = src;
+		for (i = n; i > 0; --i)
+			PUTBYTE_FP (d++, GETBYTE_FP (s++));
+		dst += 80;
+		src += 80;
+	}
+}
+#endif
+
+/* Fill the rectangle x1,y1 to x2,y2 including the final points*/
+void
+ega_fillrect(PSD psd, unsigned int x1, unsigned int y1, unsigned int x2,
+	unsigned int y2, PIXELVAL c)
+{
 	assert (x1 >= 0 && x1 < psd->xres);
 	assert (x2 >= 0 && x2 < psd->xres);
 	assert (x2 >= x1);
-	assert (y >= 0 && y < psd->yres);
+	assert (y1 >= 0 && y1 < psd->yres);
+	assert (y2 >= 0 && y2 < psd->yres);
+	assert (y2 >= y1);
 	assert (c >= 0 && c < psd->ncolors);
 
+	/*
+	 * The graphics controller is set once for the whole rectangle
+	 * and each row is written a byte at a time.  For MODE_SET the
+	 * full bytes in the middle of the row don't need the latches,
+	 * so they're just stored.
+	 */
 	DRAWON;
 	set_color (c);
 	set_op(mode_table[gr_mode]);
-	/*
-	* The following fast drawhline code is buggy for XOR drawing,
-	* for some reason.  So, we use the equivalent slower drawpixel
-	* method when not drawing MODE_SET.
-	*/
-	if(gr_mode == MODE_SET) {
-		dst = SCREENBASE + x1 / 8 + y * BYTESPERLINE;
-		select_mask ();
-		if (x1 / 8 == x2 / 8) {
-			set_mask ((0xff >> (x1 % 8)) & (0xff << (7 - x2 % 8)));
-			RMW_FP (dst);
-		} else {
-
-			set_mask (0xff >> (x1 % 8));
-			RMW_FP (dst++);
-
-			set_mask (0xff);
-			last = SCREENBASE + x2 / 8 + y * BYTESPERLINE;
-			while (dst < last)
-				PUTBYTE_FP(dst++, 1);
-
-			set_mask (0xff << (7 - x2 % 8));
-			RMW_FP (dst);
-		}
-	} else {
-		/* slower method, draw pixel by pixel*/
-		select_mask ();
-		while(x1 < x2) {
-			set_mask (mask[x1&7]);
-			RMW_FP (SCREENBASE + x1++ / 8 + y * BYTESPERLINE);
-		}
-	}
+	ega_fillspan (SCREENBASE + x1 / 8 + y1 * BYTESPERLINE,
+		x2 / 8 - x1 / 8 + 1, y2 - y1 + 1,
+		0xff >> (x1 % 8), 0xff << (7 - x2 % 8), gr_mode != MODE_SET);
 	DRAWOFF;
 }
 
+/* Draw horizontal line from x1,y to x2,y not including final point*/
+void
+ega_drawhorzline(PSD psd, unsigned int x1, unsigned int x2, unsigned int y,
+	PIXELVAL c)
+{
+	ega_fillrect(psd, x1, y, x2 - 1, y, c);
+}
+
 /* Draw a vertical line from x,y1 to x,y2 not including final point*/
 void
 ega_drawvertline(PSD psd,unsigned int x, unsigned int y1, unsigned int y2,
@@ -192,6 +233,72 @@ ega_drawvertline(PSD psd,unsigned int x, unsigned int y1, unsigned int y2,
 	DRAWOFF;
 }
 
+/*
+ * Draw the set bits of a bitmap in color c with its top left corner at x,y.
+ * Each row of bits is aligned to the next IMAGEBITS word.  The bits for a
+ * screen byte are used as the bit mask, so eight pixels are written at a
+ * time and bytes with no bits set are skipped.
+ */
+void
+ega_drawbitmap(PSD psd, unsigned int x, unsigned int y, unsigned int width,
+	unsigned int height, IMAGEBITS *imagebits, PIXELVAL c)
+{
+	FARADDR		dst, d;
+	unsigned int	shift = x & 7;
+	unsigned int	words = IMAGE_WORDS(width);
+	unsigned int	nbytes = (x + width - 1) / 8 - x / 8 + 1;
+	IMAGEBITS	lastmask, bits, out, carry;
+	unsigned int	i, n;
+
+	assert (x >= 0 && x + width <= psd->xres);
+	assert (y >= 0 && y + height <= psd->yres);
+	assert (c >= 0 && c < psd->ncolors);
+
+	if (width == 0)
+		return;
+
+	/* mask off the padding at the end of each row*/
+	lastmask = (width & 15)? (IMAGEBITS) (0xffff << (16 - (width & 15))): 0xffff;
+
+	DRAWON;
+	set_op(mode_table[gr_mode]);
+	set_color (c);
+	select_mask ();
+	dst = SCREENBASE + x / 8 + y * BYTESPERLINE;
+	while (height-- > 0) {
+		d = dst;
+		n = nbytes;
+		carry = 0;
+		for (i = 0; i < words; ++i) {
+			bits = *imagebits++;
+			if (i == words - 1)
+				bits &= lastmask;
+			out = carry | (bits >> shift);
+			carry = shift? (IMAGEBITS) (bits << (16 - shift)): 0;
+			if (out & 0xff00) {
+				set_mask (out >> 8);
+				RMW_FP (d);
+			}
+			++d;
+			if (--n == 0)
+				break;
+			if (out & 0x00ff) {
+				set_mask (out & 0xff);
+				RMW_FP (d);
+			}
+			++d;
+			if (--n == 0)
+				break;
+		}
+		if (n && (carry & 0xff00)) {
+			set_mask (carry >> 8);
+			RMW_FP (d);
+		}
+		dst += BYTESPERLINE;
+	}
+	DRAWOFF;
+}
+
 void
 ega_blit(PSD dstpsd, COORD dstx, COORD dsty, COORD w, COORD h,
 	PSD srcpsd, COORD srcx, COORD srcy, int op)
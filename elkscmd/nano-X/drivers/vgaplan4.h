@@ -89,9 +89,19 @@ void		ega_drawhorzline(PSD psd,unsigned int x1,unsigned int x2,
 			unsigned int y,PIXELVAL c);
 void		ega_drawvertline(PSD psd,unsigned int x,unsigned int y1,
 			unsigned int y2, PIXELVAL c);
+void		ega_fillrect(PSD psd,unsigned int x1,unsigned int y1,
+			unsigned int x2,unsigned int y2,PIXELVAL c);
+void		ega_drawbitmap(PSD psd,unsigned int x,unsigned int y,
+			unsigned int width,unsigned int height,
+			IMAGEBITS *imagebits,PIXELVAL c);
 void	 	ega_blit(PSD dstpsd, COORD dstx, COORD dsty, COORD w, COORD h,
 			PSD srcpsd, COORD srcx, COORD srcy, int op);
 
+/* span routines, asm in elksutilasm.s for ELKS, else C in vgaplan4.c*/
+void		ega_fillspan(FARADDR dst,int n,int rows,int lmask,int rmask,
+			int rmw);
+void		ega_copyspan(FARADDR dst,FARADDR src,int n,int rows);
+
 /* vgainit.c - direct hw init*/
 void		ega_hwinit(void);
 void		ega_hwterm(void);
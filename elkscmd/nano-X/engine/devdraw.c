@@ -14,8 +14,13 @@
  */
 /*#define NDEBUG*/
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 /*#include <assert.h>*/
 #include "device.h"
+#if ELKS
+#include <malloc.h>
+#endif
 
 /*
  * The following define can change depending on the window manager
@@ -35,6 +40,33 @@ static RGBENTRY	gr_palette[256];    /* current palette*/
 static int	gr_firstuserpalentry;/* first user-changable palette entry*/
 static int 	gr_nextpalentry;    /* next available palette entry*/
 
+/*
+ * Glyph cache for the current font.  Characters are assumed to be at
+ * most 16 pixels wide, as in the text bitmap buffers, so each cached row
+ * is one word.  On ELKS the cache is kept in far memory.
+ */
+#if ELKS
+#define GLYPHFAR	__far
+#define glyphalloc(n)	fmemalloc(n)
+#else
+#define GLYPHFAR
+#define glyphalloc(n)	malloc(n)
+#endif
+
+typedef struct {
+	COORD		width;			/* width, 0 if not cached */
+	COORD		height;			/* height */
+	IMAGEBITS	bits[MAX_CHAR_HEIGHT];	/* bitmap rows */
+} GLYPH;
+
+static GLYPH GLYPHFAR *glyphcache;	/* glyphs of each character */
+static BOOL	glyphnomem;		/* TRUE if cache couldn't be allocated*/
+static FONTID	glyphfont;		/* font of cached glyphs */
+static void	(*glyphbits)(PSD psd,UCHAR ch,IMAGEBITS *retmap,COORD *retwd,
+			COORD *retht,FONTID fontid);	/* font driver */
+
+#define TEXT_WORDS	8		/* words per row of a text run bitmap*/
+
 static void drawpoint(PSD psd,COORD x, COORD y);
 static void drawrow(PSD psd,COORD x1,COORD x2,COORD y);
 static void drawcol(PSD psd,COORD x,COORD y1,COORD y2);
@@ -591,6 +623,99 @@ GdGetTextSize(PSD psd, char *str, int cc, COORD *pwidth, COORD *pheight)
 	psd->GetTextSize(psd, (unsigned char *)str, cc, pwidth, pheight, gr_font);
 }
 
+/* Get the bitmap of a character in the current font, from the glyph
+ * cache if possible.
+ */
+static void
+gettextbits(PSD psd, UCHAR ch, IMAGEBITS *bitmap, COORD *pwidth,
+	COORD *pheight)
+{
+	GLYPH GLYPHFAR *gp;
+	int		i;
+
+	if (!glyphcache && !glyphnomem) {
+		glyphcache = glyphalloc(256 * sizeof(GLYPH));
+		glyphnomem = (glyphcache == NULL);
+		glyphbits = NULL;
+	}
+	if (!glyphcache) {
+		psd->GetTextBits(psd, ch, bitmap, pwidth, pheight, gr_font);
+		return;
+	}
+
+	/* the cache holds only one font at a time*/
+	if (glyphbits != psd->GetTextBits || glyphfont != gr_font) {
+		for (i = 0; i < 256; ++i)
+			glyphcache[i].width = 0;
+		glyphbits = psd->GetTextBits;
+		glyphfont = gr_font;
+	}
+
+	gp = &glyphcache[ch];
+	if (gp->width == 0) {
+		psd->GetTextBits(psd, ch, bitmap, pwidth, pheight, gr_font);
+		if (*pwidth > 16 || *pheight > MAX_CHAR_HEIGHT)
+			return;
+		gp->width = *pwidth;
+		gp->height = *pheight;
+		for (i = 0; i < *pheight; ++i)
+			gp->bits[i] = bitmap[i];
+		return;
+	}
+	*pwidth = gp->width;
+	*pheight = gp->height;
+	for (i = 0; i < gp->height; ++i)
+		bitmap[i] = gp->bits[i];
+}
+
+/* Build a single bitmap for as many characters of the string as fit in
+ * TEXT_WORDS words per row, with the rows packed as for GdBitmap.
+ * Returns the number of characters used, at least one.
+ */
+static int
+gettextrun(PSD psd, const UCHAR *str, int cc, IMAGEBITS *bits,
+	COORD *pwidth, COORD *pheight)
+{
+	IMAGEBITS	glyph[MAX_CHAR_HEIGHT];	/* bitmap of one character */
+	IMAGEBITS	*bp;
+	IMAGEBITS	mask;
+	COORD		width, height, w, h;
+	int		n, i, shift, words;
+
+	memset(bits, 0, TEXT_WORDS * MAX_CHAR_HEIGHT * sizeof(IMAGEBITS));
+	width = 0;
+	height = 0;
+	for (n = 0; n < cc; ++n) {
+		gettextbits(psd, str[n], glyph, &w, &h);
+		if (n > 0 && width + w > TEXT_WORDS * 16)
+			break;
+		mask = (w < 16)? (IMAGEBITS) ~(0xffff >> w): 0xffff;
+		shift = width & 15;
+		bp = bits + width / 16;
+		for (i = 0; i < h; ++i) {
+			glyph[i] &= mask;
+			bp[0] |= glyph[i] >> shift;
+			if (shift + w > 16)
+				bp[1] |= (IMAGEBITS) (glyph[i] << (16 - shift));
+			bp += TEXT_WORDS;
+		}
+		width += w;
+		if (h > height)
+			height = h;
+	}
+
+	/* pack the rows to the words actually used*/
+	words = IMAGE_WORDS(width);
+	if (words < TEXT_WORDS) {
+		for (i = 1; i < height; ++i)
+			memcpy(bits + i * words, bits + i * TEXT_WORDS,
+				words * sizeof(IMAGEBITS));
+	}
+	*pwidth = width;
+	*pheight = height;
+	return n;
+}
+
 /* Draw a text string at a specifed coordinates in the foreground color
  * (and possibly the background color), applying clipping if necessary.
  * The background color is only drawn if the gr_usebg flag is set.
@@ -600,7 +725,8 @@ GdText(PSD psd, COORD x, COORD y, const UCHAR *str, int cc, BOOL fBottomAlign)
 {
 	COORD		width;			/* width of text area */
 	COORD 		height;			/* height of text area */
-	IMAGEBITS 	bitmap[MAX_CHAR_HEIGHT];/* bitmaps for characters */
+	IMAGEBITS 	bitmap[TEXT_WORDS * MAX_CHAR_HEIGHT];/* text bitmaps */
+	int		n;
 
 	if (cc <= 0)
 		return;
@@ -614,15 +740,26 @@ GdText(PSD psd, COORD x, COORD y, const UCHAR *str, int cc, BOOL fBottomAlign)
 	case CLIP_VISIBLE:
 		/*
 		 * For size considerations, there's no low-level text
-		 * draw, so we've got to draw all text
-		 * with per-point clipping for the time being
-		if (gr_usebg)
-			psd->FillRect(psd, x, y, x + width - 1, y + height - 1,
-				gr_background);
-		psd->DrawText(psd, x, y, str, cc, gr_foreground, gr_font);
-		GdFixCursor();
-		return;
-		*/
+		 * draw.  If the driver draws bitmaps, the string is
+		 * drawn as a few wide bitmaps over a single background
+		 * fill, otherwise per character below.
+		 */
+		if (psd->DrawBitmap) {
+			if (gr_usebg)
+				psd->FillRect(psd, x, y, x + width - 1,
+					y + height - 1, gr_background);
+			while (cc > 0) {
+				n = gettextrun(psd, str, cc, bitmap, &width,
+					&height);
+				psd->DrawBitmap(psd, x, y, width, height, bitmap,
+					gr_foreground);
+				str += n;
+				cc -= n;
+				x += width;
+			}
+			GdFixCursor();
+			return;
+		}
 		break;
 
 	case CLIP_INVISIBLE:
@@ -633,7 +770,7 @@ GdText(PSD psd, COORD x, COORD y, const UCHAR *str, int cc, BOOL fBottomAlign)
 	 * them using clipping for each one.
 	 */
 	while (cc-- > 0 && x < psd->xres) {
-		psd->GetTextBits(psd, *str++, bitmap, &width, &height, gr_font);
+		gettextbits(psd, *str++, bitmap, &width, &height);
 		/* note: change to bitmap*/
 		GdBitmap(psd, x, y, width, height, bitmap);
 		x += width;
@@ -656,6 +793,7 @@ GdBitmap(PSD psd, COORD x, COORD y, COORD width, COORD height,
 {
   COORD minx;
   COORD maxx;
+  COORD runx;			/* start of run of set bits */
   PIXELVAL savecolor;		/* saved foreground color */
   IMAGEBITS bitvalue = 0;	/* bitmap word value */
   int bitcount;			/* number of bits left in bitmap word */
@@ -663,15 +801,18 @@ GdBitmap(PSD psd, COORD x, COORD y, COORD width, COORD height,
   switch (GdClipArea(x, y, x + width - 1, y + height - 1)) {
       case CLIP_VISIBLE:
 	/*
-	 * For size considerations, there's no low-level bitmap
-	 * draw so we've got to draw everything with per-point
-	 * clipping for the time being.
-	if (gr_usebg)
-		psd->FillRect(psd, x, y, x + width - 1, y + height - 1,
-			gr_background);
-	psd->DrawBitmap(psd, x, y, width, height, imagebits, gr_foreground);
-	return;
-	*/
+	 * The low-level bitmap draw is optional, without it
+	 * everything is drawn with per-point clipping.
+	 */
+	if (psd->DrawBitmap) {
+		if (gr_usebg)
+			psd->FillRect(psd, x, y, x + width - 1, y + height - 1,
+				gr_background);
+		psd->DrawBitmap(psd, x, y, width, height, imagebits,
+			gr_foreground);
+		GdFixCursor();
+		return;
+	}
 	break;
 
       case CLIP_INVISIBLE:
@@ -688,24 +829,37 @@ GdBitmap(PSD psd, COORD x, COORD y, COORD width, COORD height,
 	GdFillRect(psd, x, y, width, height);
 	gr_foreground = savecolor;
   }
+  /* Then draw each run of set bits in a row as a line, so that
+   * it is clipped a rectangle at a time rather than per point.
+   */
   minx = x;
   maxx = x + width - 1;
-  bitcount = 0;
   while (height > 0) {
-	if (bitcount <= 0) {
-		bitcount = IMAGE_BITSPERIMAGE;
-		bitvalue = *imagebits++;
-	}
-	if (IMAGE_TESTBIT(bitvalue) && GdClipPoint(x, y))
-		psd->DrawPixel(psd, x, y, gr_foreground);
-	bitvalue = IMAGE_SHIFTBIT(bitvalue);
-	bitcount--;
-	if (x++ == maxx) {
-		x = minx;
-		y++;
-		height--;
-		bitcount = 0;
+	bitcount = 0;
+	for (x = minx; x <= maxx; ) {
+		if (bitcount <= 0) {
+			bitcount = IMAGE_BITSPERIMAGE;
+			bitvalue = *imagebits++;
+		}
+		if (!IMAGE_TESTBIT(bitvalue)) {
+			bitvalue = IMAGE_SHIFTBIT(bitvalue);
+			bitcount--;
+			x++;
+			continue;
+		}
+		runx = x;
+		do {
+			bitvalue = IMAGE_SHIFTBIT(bitvalue);
+			x++;
+			if (--bitcount <= 0 && x <= maxx) {
+				bitcount = IMAGE_BITSPERIMAGE;
+				bitvalue = *imagebits++;
+			}
+		} while (x <= maxx && IMAGE_TESTBIT(bitvalue));
+		drawrow(psd, runx, x - 1, y);
 	}
+	y++;
+	height--;
   }
   GdFixCursor();
 }
@@ -121,7 +121,9 @@ typedef struct {
 
 /* Event types.
  * Mouse motion is generated for every motion of the mouse, and is used to
- * track the entire history of the mouse (many events and lots of overhead).
+ * track the history of the mouse. Consecutive motion events still queued
+ * for the same window are merged into the latest one, unless the client
+ * also selects GR_EVENT_MASK_MOUSE_RAW to get every one (lots of overhead).
  * Mouse position ignores the history of the motion, and only reports the
  * latest position of the mouse by only queuing the latest such event for
  * any single client (good for rubber-banding).
@@ -157,6 +159,7 @@ typedef struct {
 #define	GR_EVENT_MASK_KEY_UP		GR_EVENTMASK(GR_EVENT_TYPE_KEY_UP)
 #define	GR_EVENT_MASK_FOCUS_IN		GR_EVENTMASK(GR_EVENT_TYPE_FOCUS_IN)
 #define	GR_EVENT_MASK_FOCUS_OUT		GR_EVENTMASK(GR_EVENT_TYPE_FOCUS_OUT)
+#define	GR_EVENT_MASK_MOUSE_RAW		GR_EVENTMASK(30) /* don't merge motion */
 #define	GR_EVENT_MASK_ALL		((GR_EVENT_MASK) -1L)
 
 /* Timeout parameters for GrGetNextEventTimeout()*/
@@ -84,28 +84,116 @@ static int GrDeliverErrorEvent(void)
 }
 
 /*
- * Send a block of data to the server and read it's reply.
+ * Write n bytes of data to the server.
+ * Returns 0 on success or -1 on failure.
  */
-static int GrSendBlock(void *b, long n)
+static int GrWriteBlock(void *b, int n)
 {
-	int i = 0, z;
+	int i;
 	unsigned char *c;
 
 	c = (unsigned char *) b;
 
-	/* FIXME: n > 64k will fail here if sizeof(int) == 2*/
 	while(c < ((unsigned char *) b + n)) {
 		i = write(sock, c, ((unsigned char *) b + n - c));
 		if(i <= 0) return -1;
 		c += i;
 	}
 
+	return 0;
+}
+
+/*
+ * Requests which aren't answered by the server are collected here, and
+ * sent when the buffer is full or the client waits for a reply.
+ */
+static unsigned char reqbuf[GR_REQ_BUFSIZE];
+static int reqlen;
+
+/*
+ * Send the requests waiting in the buffer to the server.
+ * Returns 0 on success or -1 on failure.
+ */
+static int GrFlushRequests(void)
+{
+	int n = reqlen;
+
+	reqlen = 0;
+	if(n == 0) return 0;
+	return GrWriteBlock(reqbuf, n);
+}
+
+/*
+ * Queue a request of the given function number for the server.  The
+ * request structure is size bytes at req, and is followed by datalen
+ * bytes of data at data.  The header of the request is filled in here.
+ * A request too large for the buffer is written out on its own.
+ * Returns 0 on success or -1 on failure.
+ */
+static int GrSendRequest(int type, void *req, int size, void *data, long datalen)
+{
+	GR_REQ_HEADER *hp = (GR_REQ_HEADER *) req;
+	long len = (size + datalen + 1) & ~1L;
+
+	if(len > GR_REQ_MAXLEN) return -1;
+	hp->type = type;
+	hp->pad = 0;
+	hp->length = len;
+
+	if(reqlen + len > GR_REQ_BUFSIZE)
+		if(GrFlushRequests() == -1) return -1;
+
+	if(len > GR_REQ_BUFSIZE) {
+		if(GrWriteBlock(req, size) == -1) return -1;
+		if(datalen && GrWriteBlock(data, datalen) == -1) return -1;
+		if((size + datalen) & 1)
+			return GrWriteBlock(reqbuf, 1);
+		return 0;
+	}
+
+	memcpy(reqbuf + reqlen, req, size);
+	if(datalen) memcpy(reqbuf + reqlen + size, data, datalen);
+	reqlen += len;
+	return 0;
+}
+
+/*
+ * Send a request which has no arguments.
+ */
+static int GrSendByte(int type)
+{
+	GR_REQ req;
+
+	return GrSendRequest(type, &req, sizeof(req), NULL, 0);
+}
+
+/*
+ * Send a request on a window or graphics context.
+ */
+static int GrSendId(int type, GR_ID id)
+{
+	GR_REQ_ID req;
+
+	req.id = id;
+	return GrSendRequest(type, &req, sizeof(req), NULL, 0);
+}
+
+/*
+ * Send the queued requests to the server and read the reply to the
+ * last one.  Returns the reply code, or -1 on failure.
+ */
+static int GrReadReply(void)
+{
+	int i, z;
+
+	if(GrFlushRequests() == -1) return -1;
+
 	do {
 		if((i = GrReadByte()) < 0) return -1;
 		else if(i == GrRetESig) {
 			z = GrReadByte();
 			if(z == -1) return -1;
-printf("client bad GrSendBlock\r\n");
+printf("client bad GrReadReply\r\n");
 			raise(z);
 		}
 		else if(i == GrRetErrorPending)
@@ -117,11 +205,14 @@ printf("client bad GrSendBlock\r\n");
 }
 
 /*
- * Send a single byte to the server and read the reply.
+ * Send a request and read its reply code.
  */
-static int GrSendByte(unsigned char c)
+static int GrRequestReply(int type, void *req, int size, void *data, long datalen)
 {
-	return GrSendBlock(&c, 1);
+	if(GrSendRequest(type, req, size, data, datalen) == -1)
+		return -1;
+
+	return GrReadReply();
 }
 
 /*
@@ -132,6 +223,7 @@ int GrOpen(void)
 {
 	struct sockaddr_un name;
 	size_t size;
+	GR_REQ req;
 
 	
 	if(!sock)
@@ -146,7 +238,8 @@ int GrOpen(void)
 	if(connect(sock, (struct sockaddr *) &name, size) == -1)
 		return -1;
 
-	if(GrSendByte(GrNumOpen) != GrRetOK)
+	reqlen = 0;
+	if(GrRequestReply(GrNumOpen, &req, sizeof(req), NULL, 0) != GrRetOK)
 		return -1;
 
 	return sock;
@@ -157,7 +250,9 @@ int GrOpen(void)
  */
 int GrClose(void)
 {
-	GrSendByte(GrNumClose);
+	GR_REQ req;
+
+	GrRequestReply(GrNumClose, &req, sizeof(req), NULL, 0);
 	close(sock);
 
 	return 0;
@@ -243,7 +338,10 @@ GR_ERROR_FUNC GrSetErrorHandler(GR_ERROR_FUNC func)
  */
 int GrGetScreenInfo(GR_SCREEN_INFO *sip)
 {
-	if(GrSendByte(GrNumGetScreenInfo) != GrRetDataFollows)
+	GR_REQ req;
+
+	if(GrRequestReply(GrNumGetScreenInfo, &req, sizeof(req), NULL, 0)
+	    != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(sip, sizeof(GR_SCREEN_INFO)) == -1)
@@ -257,10 +355,12 @@ int GrGetScreenInfo(GR_SCREEN_INFO *sip)
  */
 int GrGetFontInfo(GR_FONT fontno, GR_FONT_INFO *fip)
 {
-	if(GrSendByte(GrNumGetFontInfo) != GrRetSendData)
-		return -1;
+	GR_REQ_ID_VALUE req;
 
-	if(GrSendBlock(&fontno, sizeof(fontno)) != GrRetDataFollows)
+	req.id = 0;
+	req.value = fontno;
+	if(GrRequestReply(GrNumGetFontInfo, &req, sizeof(req), NULL, 0)
+	    != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(fip, sizeof(GR_FONT_INFO)) == -1)
@@ -274,10 +374,11 @@ int GrGetFontInfo(GR_FONT fontno, GR_FONT_INFO *fip)
  */
 int GrGetGCInfo(GR_GC_ID gc, GR_GC_INFO *gcip)
 {
-	if(GrSendByte(GrNumGetGCInfo) != GrRetSendData)
-		return -1;
+	GR_REQ_ID req;
 
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetDataFollows)
+	req.id = gc;
+	if(GrRequestReply(GrNumGetGCInfo, &req, sizeof(req), NULL, 0)
+	    != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(gcip, sizeof(GR_GC_INFO)) == -1)
@@ -294,16 +395,12 @@ int GrGetGCInfo(GR_GC_ID gc, GR_GC_INFO *gcip)
 int GrGetGCTextSize(GR_GC_ID gc, GR_CHAR *cp, GR_SIZE len, GR_SIZE *retwidth,
 	GR_SIZE *retheight, GR_SIZE *retbase)
 {
-	if(GrSendByte(GrNumGetGCTextSize) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&len, sizeof(len)) != GrRetSendData)
-		return -1;
+	GR_REQ_ID_VALUE req;
 
-	if(GrSendBlock(cp, len) != GrRetDataFollows)
+	req.id = gc;
+	req.value = len;
+	if(GrRequestReply(GrNumGetGCTextSize, &req, sizeof(req), cp, len)
+	    != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(retwidth, sizeof(*retwidth)) == -1)
@@ -343,8 +440,9 @@ int GrGetNextEvent(GR_EVENT *ep)
 	int	setsize = 0;
 
 	if(regfd != -1) {
-		c = GrNumGetNextEvent;
-		write(sock, &c, 1); /* fixme: check return code*/
+		/* fixme: check return code*/
+		GrSendByte(GrNumGetNextEvent);
+		GrFlushRequests();
 		FD_ZERO(&rfds);
 		FD_SET(sock, &rfds);
 		FD_SET(regfd, &rfds);
@@ -367,7 +465,8 @@ int GrGetNextEvent(GR_EVENT *ep)
 		/* send a byte requesting an event check,
 		 * wait till event exists
 		 */
-		if(GrSendByte(GrNumGetNextEvent) != GrRetDataFollows)
+		if(GrSendByte(GrNumGetNextEvent) == -1
+		    || GrReadReply() != GrRetDataFollows)
 			return -1;
 
 readevent:
@@ -388,7 +487,8 @@ readevent:
  */
 int GrCheckNextEvent(GR_EVENT *ep)
 {
-	if(GrSendByte(GrNumCheckNextEvent) != GrRetDataFollows)
+	if(GrSendByte(GrNumCheckNextEvent) == -1
+	    || GrReadReply() != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(ep, sizeof(*ep)) == -1)
@@ -403,7 +503,8 @@ int GrCheckNextEvent(GR_EVENT *ep)
  */
 int GrPeekEvent(GR_EVENT *ep)
 {
-	if(GrSendByte(GrNumPeekEvent) != GrRetDataFollows)
+	if(GrSendByte(GrNumPeekEvent) == -1
+	    || GrReadReply() != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(ep, sizeof(*ep)) == -1)
@@ -418,16 +519,11 @@ int GrPeekEvent(GR_EVENT *ep)
  */
 int GrSelectEvents(GR_WINDOW_ID wid, GR_EVENT_MASK eventmask)
 {
-	if(GrSendByte(GrNumSelectEvents) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetSendData)
-		return -1;
+	GR_REQ_SELECTEVENTS req;
 
-	if(GrSendBlock(&eventmask, sizeof(eventmask)) != GrRetOK)
-		return -1;
-
-	return 0;
+	req.wid = wid;
+	req.eventmask = eventmask;
+	return GrSendRequest(GrNumSelectEvents, &req, sizeof(req), NULL, 0);
 }
 
 /*
@@ -438,33 +534,19 @@ GR_WINDOW_ID GrNewWindow(GR_WINDOW_ID parent, GR_COORD x, GR_COORD y, GR_SIZE wi
 			GR_SIZE height, GR_SIZE bordersize, GR_COLOR background,
 			GR_COLOR bordercolor)
 {
+	GR_REQ_NEWWINDOW req;
 	GR_WINDOW_ID wid;
 
-	if(GrSendByte(GrNumNewWindow) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&parent, sizeof(parent)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&width, sizeof(width)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&height, sizeof(height)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&bordersize, sizeof(bordersize)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&background, sizeof(background)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&bordercolor, sizeof(bordercolor)) != GrRetDataFollows)
+	req.parent = parent;
+	req.x = x;
+	req.y = y;
+	req.width = width;
+	req.height = height;
+	req.bordersize = bordersize;
+	req.background = background;
+	req.bordercolor = bordercolor;
+	if(GrRequestReply(GrNumNewWindow, &req, sizeof(req), NULL, 0)
+	    != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(&wid, sizeof(wid)) == -1)
@@ -480,24 +562,19 @@ GR_WINDOW_ID GrNewWindow(GR_WINDOW_ID parent, GR_COORD x, GR_COORD y, GR_SIZE wi
 GR_WINDOW_ID GrNewInputWindow(GR_WINDOW_ID parent, GR_COORD x, GR_COORD y, GR_SIZE width,
 			GR_SIZE height)
 {
+	GR_REQ_NEWWINDOW req;
 	GR_WINDOW_ID wid;
 
-	if(GrSendByte(GrNumNewInputWindow) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&parent, sizeof(parent)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&width, sizeof(width)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&height, sizeof(height)) != GrRetSendData)
+	req.parent = parent;
+	req.x = x;
+	req.y = y;
+	req.width = width;
+	req.height = height;
+	req.bordersize = 0;
+	req.background = 0;
+	req.bordercolor = 0;
+	if(GrRequestReply(GrNumNewInputWindow, &req, sizeof(req), NULL, 0)
+	    != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(&wid, sizeof(wid)) == -1)
@@ -511,13 +588,7 @@ GR_WINDOW_ID GrNewInputWindow(GR_WINDOW_ID parent, GR_COORD x, GR_COORD y, GR_SI
  */
 int GrDestroyWindow(GR_WINDOW_ID wid)
 {
-	if(GrSendByte(GrNumDestroyWindow) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendId(GrNumDestroyWindow, wid);
 }
 
 /*
@@ -525,10 +596,8 @@ int GrDestroyWindow(GR_WINDOW_ID wid)
  */
 int GrGetWindowInfo(GR_WINDOW_ID wid, GR_WINDOW_INFO *infoptr)
 {
-	if(GrSendByte(GrNumGetWindowInfo) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetDataFollows)
+	if(GrSendId(GrNumGetWindowInfo, wid) == -1
+	    || GrReadReply() != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(infoptr, sizeof(GR_WINDOW_INFO)) == -1)
@@ -544,7 +613,7 @@ GR_GC_ID GrNewGC(void)
 {
 	GR_GC_ID gc;
 
-	if(GrSendByte(GrNumNewGC) != GrRetDataFollows)
+	if(GrSendByte(GrNumNewGC) == -1 || GrReadReply() != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(&gc, sizeof(gc)) == -1)
@@ -560,10 +629,7 @@ GR_GC_ID GrCopyGC(GR_GC_ID gc)
 {
 	GR_GC_ID newgc;
 
-	if(GrSendByte(GrNumCopyGC) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetDataFollows)
+	if(GrSendId(GrNumCopyGC, gc) == -1 || GrReadReply() != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(&newgc, sizeof(newgc)) == -1)
@@ -577,13 +643,7 @@ GR_GC_ID GrCopyGC(GR_GC_ID gc)
  */
 int GrDestroyGC(GR_GC_ID gc)
 {
-	if(GrSendByte(GrNumDestroyGC) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendId(GrNumDestroyGC, gc);
 }
 
 /*
@@ -593,13 +653,7 @@ int GrDestroyGC(GR_GC_ID gc)
  */
 int GrMapWindow(GR_WINDOW_ID wid)
 {
-	if(GrSendByte(GrNumMapWindow) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendId(GrNumMapWindow, wid);
 }
 
 /*
@@ -607,13 +661,7 @@ int GrMapWindow(GR_WINDOW_ID wid)
  */
 int GrUnmapWindow(GR_WINDOW_ID wid)
 {
-	if(GrSendByte(GrNumUnmapWindow) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendId(GrNumUnmapWindow, wid);
 }
 
 /*
@@ -621,13 +669,7 @@ int GrUnmapWindow(GR_WINDOW_ID wid)
  */
 int GrRaiseWindow(GR_WINDOW_ID wid)
 {
-	if(GrSendByte(GrNumRaiseWindow) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendId(GrNumRaiseWindow, wid);
 }
 
 /*
@@ -635,33 +677,52 @@ int GrRaiseWindow(GR_WINDOW_ID wid)
  */
 int GrLowerWindow(GR_WINDOW_ID wid)
 {
-	if(GrSendByte(GrNumLowerWindow) != GrRetSendData)
-		return -1;
+	return GrSendId(GrNumLowerWindow, wid);
+}
 
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetOK)
-		return -1;
+/*
+ * Send a request with an id and two coordinates.
+ */
+static int GrSendIdXY(int type, GR_ID id, GR_COORD x, GR_COORD y)
+{
+	GR_REQ_ID_XY req;
 
-	return 0;
+	req.id = id;
+	req.x = x;
+	req.y = y;
+	return GrSendRequest(type, &req, sizeof(req), NULL, 0);
 }
 
 /*
- * Move the window to the specified position relative to its parent.
+ * Send a request with an id and a value.
  */
-int GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
+static int GrSendIdValue(int type, GR_ID id, unsigned short value)
 {
-	if(GrSendByte(GrNumMoveWindow) != GrRetSendData)
-		return -1;
+	GR_REQ_ID_VALUE req;
 
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetSendData)
-		return -1;
+	req.id = id;
+	req.value = value;
+	return GrSendRequest(type, &req, sizeof(req), NULL, 0);
+}
 
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
+/*
+ * Send a request with an id and a color.
+ */
+static int GrSendIdColor(int type, GR_ID id, GR_COLOR color)
+{
+	GR_REQ_ID_COLOR req;
 
-	if(GrSendBlock(&y, sizeof(y)) != GrRetOK)
-		return -1;
+	req.id = id;
+	req.color = color;
+	return GrSendRequest(type, &req, sizeof(req), NULL, 0);
+}
 
-	return 0;
+/*
+ * Move the window to the specified position relative to its parent.
+ */
+int GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
+{
+	return GrSendIdXY(GrNumMoveWindow, wid, x, y);
 }
 
 /*
@@ -669,19 +730,7 @@ int GrMoveWindow(GR_WINDOW_ID wid, GR_COORD x, GR_COORD y)
  */
 int GrResizeWindow(GR_WINDOW_ID wid, GR_SIZE width, GR_SIZE height)
 {
-	if(GrSendByte(GrNumResizeWindow) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&width, sizeof(width)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&height, sizeof(height)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendIdXY(GrNumResizeWindow, wid, width, height);
 }
 
 /*
@@ -691,16 +740,7 @@ int GrResizeWindow(GR_WINDOW_ID wid, GR_SIZE width, GR_SIZE height)
  */
 int GrClearWindow(GR_WINDOW_ID wid, GR_BOOL exposeflag)
 {
-	if(GrSendByte(GrNumClearWindow) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&exposeflag, sizeof(exposeflag)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendIdValue(GrNumClearWindow, wid, exposeflag);
 }
 
 /*
@@ -710,13 +750,7 @@ int GrClearWindow(GR_WINDOW_ID wid, GR_BOOL exposeflag)
  */
 int GrSetFocus(GR_WINDOW_ID wid)
 {
-	if(GrSendByte(GrNumSetFocus) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendId(GrNumSetFocus, wid);
 }
 
 /*
@@ -724,16 +758,7 @@ int GrSetFocus(GR_WINDOW_ID wid)
  */
 int GrSetBorderColor(GR_WINDOW_ID wid, GR_COLOR colour)
 {
-	if(GrSendByte(GrNumSetBorderColor) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&colour, sizeof(colour)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendIdColor(GrNumSetBorderColor, wid, colour);
 }
 
 /*
@@ -746,39 +771,23 @@ int GrSetCursor(GR_WINDOW_ID wid, GR_SIZE width, GR_SIZE height, GR_COORD hotx,
 		GR_COORD hoty, GR_COLOR foreground, GR_COLOR background,
 		GR_BITMAP *fgbitmap, GR_BITMAP *bgbitmap)
 {
+	GR_REQ_SETCURSOR req;
+	GR_BITMAP bitmaps[2 * GR_BITMAP_SIZE(MAX_CURSOR_SIZE, MAX_CURSOR_SIZE)];
 	int bitmapsize = GR_BITMAP_SIZE(width, height) * sizeof(GR_BITMAP);
- 
-	if(GrSendByte(GrNumSetCursor) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&wid, sizeof(wid)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&width, sizeof(width)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&height, sizeof(height)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&hotx, sizeof(hotx)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&hoty, sizeof(hoty)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&foreground, sizeof(foreground)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&background, sizeof(background)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(fgbitmap, bitmapsize) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(bgbitmap, bitmapsize) != GrRetOK)
-		return -1;
 
-	return 0;
+	if(bitmapsize * 2 > sizeof(bitmaps))
+		bitmapsize = 0;	/* the server reports the bad size */
+	req.wid = wid;
+	req.width = width;
+	req.height = height;
+	req.hotx = hotx;
+	req.hoty = hoty;
+	req.foreground = foreground;
+	req.background = background;
+	memcpy(bitmaps, fgbitmap, bitmapsize);
+	memcpy((char *) bitmaps + bitmapsize, bgbitmap, bitmapsize);
+	return GrSendRequest(GrNumSetCursor, &req, sizeof(req), bitmaps,
+		2 * bitmapsize);
 }
 
 /*
@@ -789,24 +798,16 @@ int GrSetCursor(GR_WINDOW_ID wid, GR_SIZE width, GR_SIZE height, GR_COORD hotx,
  */
 int GrMoveCursor(GR_COORD x, GR_COORD y)
 {
-	if(GrSendByte(GrNumMoveCursor) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendIdXY(GrNumMoveCursor, 0, x, y);
 }
 
 /*
  * Flush the message buffer of any messages it may contain.
+ * This waits until the server has done all the queued requests.
  */
 int GrFlush(void)
 {
-	if(GrSendByte(GrNumFlush) != GrRetOK)
+	if(GrSendByte(GrNumFlush) == -1 || GrReadReply() != GrRetOK)
 		return -1;
 
 	return 0;
@@ -817,16 +818,7 @@ int GrFlush(void)
  */
 int GrSetGCForeground(GR_GC_ID gc, GR_COLOR foreground)
 {
-	if(GrSendByte(GrNumSetGCForeground) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&foreground, sizeof(foreground)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendIdColor(GrNumSetGCForeground, gc, foreground);
 }
 
 /*
@@ -834,16 +826,7 @@ int GrSetGCForeground(GR_GC_ID gc, GR_COLOR foreground)
  */
 int GrSetGCBackground(GR_GC_ID gc, GR_COLOR background)
 {
-	if(GrSendByte(GrNumSetGCBackground) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&background, sizeof(background)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendIdColor(GrNumSetGCBackground, gc, background);
 }
 
 /*
@@ -851,16 +834,7 @@ int GrSetGCBackground(GR_GC_ID gc, GR_COLOR background)
  */
 int GrSetGCMode(GR_GC_ID gc, GR_MODE mode)
 {
-	if(GrSendByte(GrNumSetGCMode) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&mode, sizeof(mode)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendIdValue(GrNumSetGCMode, gc, mode);
 }
 
 /*
@@ -868,16 +842,7 @@ int GrSetGCMode(GR_GC_ID gc, GR_MODE mode)
  */
 int GrSetGCUseBackground(GR_GC_ID gc, GR_BOOL flag)
 {
-	if(GrSendByte(GrNumSetGCUseBackground) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&flag, sizeof(flag)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendIdValue(GrNumSetGCUseBackground, gc, flag);
 }
 
 /*
@@ -887,16 +852,7 @@ int GrSetGCUseBackground(GR_GC_ID gc, GR_BOOL flag)
  */
 int GrSetGCFont(GR_GC_ID gc, GR_FONT font)
 {
-	if(GrSendByte(GrNumSetGCFont) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&font, sizeof(font)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendIdValue(GrNumSetGCFont, gc, font);
 }
 
 /*
@@ -904,28 +860,32 @@ int GrSetGCFont(GR_GC_ID gc, GR_FONT font)
  */
 int GrLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x1, GR_COORD y1, GR_COORD x2, GR_COORD y2)
 {
-	if(GrSendByte(GrNumLine) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x1, sizeof(x1)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y1, sizeof(y1)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x2, sizeof(x2)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y2, sizeof(y2)) != GrRetOK)
-		return -1;
+	GR_REQ_LINE req;
+
+	req.id = id;
+	req.gc = gc;
+	req.x1 = x1;
+	req.y1 = y1;
+	req.x2 = x2;
+	req.y2 = y2;
+	return GrSendRequest(GrNumLine, &req, sizeof(req), NULL, 0);
+}
 
-	return 0;
+/*
+ * Send a rectangle request, followed by datalen bytes of data.
+ */
+static int GrSendRect(int type, GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
+	GR_SIZE width, GR_SIZE height, void *data, long datalen)
+{
+	GR_REQ_RECT req;
+
+	req.id = id;
+	req.gc = gc;
+	req.x = x;
+	req.y = y;
+	req.width = width;
+	req.height = height;
+	return GrSendRequest(type, &req, sizeof(req), data, datalen);
 }
 
 /*
@@ -934,28 +894,7 @@ int GrLine(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x1, GR_COORD y1, GR_COORD x2, GR
  */
 int GrRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height)
 {
-	if(GrSendByte(GrNumRect) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&width, sizeof(width)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&height, sizeof(height)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendRect(GrNumRect, id, gc, x, y, width, height, NULL, 0);
 }
 
 /*
@@ -964,28 +903,7 @@ int GrRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width, GR
  */
 int GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width, GR_SIZE height)
 {
-	if(GrSendByte(GrNumFillRect) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&width, sizeof(width)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&height, sizeof(height)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendRect(GrNumFillRect, id, gc, x, y, width, height, NULL, 0);
 }
 
 /*
@@ -994,28 +912,7 @@ int GrFillRect(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width
  */
 int GrEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR_SIZE ry)
 {
-	if(GrSendByte(GrNumEllipse) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&rx, sizeof(rx)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&ry, sizeof(ry)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendRect(GrNumEllipse, id, gc, x, y, rx, ry, NULL, 0);
 }
 
 /*
@@ -1024,28 +921,7 @@ int GrEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR
  */
 int GrFillEllipse(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE rx, GR_SIZE ry)
 {
-	if(GrSendByte(GrNumFillEllipse) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&rx, sizeof(rx)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&ry, sizeof(ry)) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendRect(GrNumFillEllipse, id, gc, x, y, rx, ry, NULL, 0);
 }
 
 /*
@@ -1062,31 +938,8 @@ int GrBitmap(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
 {
 	long bitmapsize = (long)GR_BITMAP_SIZE(width, height) * sizeof(GR_BITMAP);
 
-	if(GrSendByte(GrNumBitmap) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&width, sizeof(width)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&height, sizeof(height)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(bitmaptable, bitmapsize) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendRect(GrNumBitmap, id, gc, x, y, width, height, bitmaptable,
+		bitmapsize);
 }
 
 /*
@@ -1103,30 +956,7 @@ int GrArea(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_SIZE width,
 	/* FIXME: optimize for smaller pixelvals*/
 	long size = (long)width * height * sizeof(PIXELVAL);
 
-	if(GrSendByte(GrNumArea) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&width, sizeof(width)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&height, sizeof(height)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(pixels, size) != GrRetOK)
-		return -1;
-	return 0;
+	return GrSendRect(GrNumArea, id, gc, x, y, width, height, pixels, size);
 }
 
 /*
@@ -1142,22 +972,8 @@ int GrReadArea(GR_DRAW_ID id,GR_COORD x,GR_COORD y,GR_SIZE width,GR_SIZE height,
 	/* FIXME: optimize for smaller pixelvals*/
 	long size = (long)width * height * sizeof(PIXELVAL);
 
-	if(GrSendByte(GrNumReadArea) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&width, sizeof(width)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&height, sizeof(height)) != GrRetDataFollows)
+	if(GrSendRect(GrNumReadArea, id, 0, x, y, width, height, NULL, 0) == -1
+	    || GrReadReply() != GrRetDataFollows)
 		return -1;
 
 	if(GrReadBlock(pixels, size) == -1)
@@ -1165,29 +981,29 @@ int GrReadArea(GR_DRAW_ID id,GR_COORD x,GR_COORD y,GR_SIZE width,GR_SIZE height,
 	return 0;
 }
 
+/*
+ * Send a request to draw count items, followed by datalen bytes of data.
+ */
+static int GrSendDraw(int type, GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y,
+	GR_COUNT count, void *data, long datalen)
+{
+	GR_REQ_DRAW req;
+
+	req.id = id;
+	req.gc = gc;
+	req.x = x;
+	req.y = y;
+	req.count = count;
+	return GrSendRequest(type, &req, sizeof(req), data, datalen);
+}
+
 /*
  * Draw a point in the specified drawable using the specified
  * graphics context.
  */
 int GrPoint(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y)
 {
-	if(GrSendByte(GrNumPoint) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetOK)
-		return -1;
-
-	return 0;
-
+	return GrSendDraw(GrNumPoint, id, gc, x, y, 0, NULL, 0);
 }
 
 /*
@@ -1197,22 +1013,8 @@ int GrPoint(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y)
  */
 int GrPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
 {
-	if(GrSendByte(GrNumPoly) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&count, sizeof(count)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(pointtable, (count * sizeof(GR_POINT))) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendDraw(GrNumPoly, id, gc, 0, 0, count, pointtable,
+		(long)count * sizeof(GR_POINT));
 }
 
 /*
@@ -1222,22 +1024,8 @@ int GrPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
  */
 int GrFillPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
 {
-	if(GrSendByte(GrNumFillPoly) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&count, sizeof(count)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(pointtable, (count * sizeof(GR_POINT))) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendDraw(GrNumFillPoly, id, gc, 0, 0, count, pointtable,
+		(long)count * sizeof(GR_POINT));
 }
 
 /*
@@ -1247,26 +1035,5 @@ int GrFillPoly(GR_DRAW_ID id, GR_GC_ID gc, GR_COUNT count, GR_POINT *pointtable)
  */
 int GrText(GR_DRAW_ID id, GR_GC_ID gc, GR_COORD x, GR_COORD y, GR_CHAR *str, GR_COUNT count)
 {
-	if(GrSendByte(GrNumText) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&id, sizeof(id)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&gc, sizeof(gc)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&x, sizeof(x)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&y, sizeof(y)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(&count, sizeof(count)) != GrRetSendData)
-		return -1;
-
-	if(GrSendBlock(str, count) != GrRetOK)
-		return -1;
-
-	return 0;
+	return GrSendDraw(GrNumText, id, gc, x, y, count, str, count);
 }
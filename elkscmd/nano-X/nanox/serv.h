@@ -29,6 +29,8 @@ struct gr_event_list {
 	GR_EVENT	event;		/* event */
 };
 
+#define GR_REQ_BUFSIZE	512	/* size of the client request buffers */
+
 /*
  * Data structure to keep track of state of clients.
  */
@@ -41,6 +43,10 @@ struct gr_client {
 	GR_CLIENT	*next;		/* the next client in the list */
 	GR_CLIENT	*prev;		/* the previous client in the list */
 	int		waiting_for_event; /* used to implement GrGetNextEvent*/
+#if !NONETWORK
+	int		reqlen;		/* bytes of requests in reqbuf */
+	char		reqbuf[GR_REQ_BUFSIZE]; /* requests read from client */
+#endif
 };
 
 /*
@@ -101,6 +107,9 @@ struct gr_window {
 	GR_BOOL		mapped;		/* TRUE if explicitly mapped */
 	GR_COUNT	unmapcount;	/* count of reasons not really mapped */
 	GR_BOOL		output;		/* TRUE if window can do output */
+	CLIPRECT	*cliprects;	/* cached clip rectangles */
+	GR_COUNT	clipcount;	/* number of cached clip rectangles */
+	unsigned int	clipstamp;	/* clipstamp the cache is valid for */
 };
 
 
@@ -219,6 +228,7 @@ void		GsWpUnmapWindow(GR_WINDOW *wp);
 void		GsWpMapWindow(GR_WINDOW *wp);
 void		GsWpDestroyWindow(GR_WINDOW *wp);
 void		GsSetClipWindow(GR_WINDOW *wp);
+void		GsForgetClip(void);
 GR_COUNT	GsSplitClipRect(CLIPRECT *srcrect, CLIPRECT *destrect,
 			GR_COORD minx, GR_COORD miny, GR_COORD maxx,
 			GR_COORD maxy);
@@ -226,6 +236,8 @@ void		GsHandleMouseStatus(GR_COORD newx, GR_COORD newy,
 			BUTTON newbuttons);
 void		GsFreePositionEvent(GR_CLIENT *client, GR_WINDOW_ID wid,
 			GR_WINDOW_ID subwid);
+GR_EVENT_MOUSE	*GsMergeMotionEvent(GR_CLIENT *client, GR_WINDOW_ID wid,
+			GR_WINDOW_ID subwid);
 void		GsDeliverButtonEvent(GR_EVENT_TYPE type, BUTTON buttons,
 			BUTTON changebuttons, MODIFIER modifiers);
 void		GsDeliverMotionEvent(GR_EVENT_TYPE type, BUTTON buttons,
@@ -258,53 +270,53 @@ void		GsDropClient(int fd);
 int		GsRead(int fd, void *buf, int c);
 int		GsWrite(int fd, void *buf, int c);
 void		GsHandleClient(int fd);
-void		GsOpenWrapper(void);
-void		GsCloseWrapper(void);
-void		GsGetScreenInfoWrapper(void);
-void		GsSetErrorHandlerWrapper(void);
-void		GsNewWindowWrapper(void);
-void		GsNewInputWindowWrapper(void);
-void		GsDestroyWindowWrapper(void);
-void		GsNewGCWrapper(void);
-void		GsGetGCInfoWrapper(void);
-void		GsDestroyGCWrapper(void);
-void		GsMapWindowWrapper(void);
-void		GsUnmapWindowWrapper(void);
-void		GsRaiseWindowWrapper(void);
-void		GsLowerWindowWrapper(void);
-void		GsMoveWindowWrapper(void);
-void		GsResizeWindowWrapper(void);
-void		GsGetWindowInfoWrapper(void);
-void		GsGetFontInfoWrapper(void);
-void		GsSetFocusWrapper(void);
-void		GsSetBorderColorWrapper(void);
-void		GsClearWindowWrapper(void);
-void		GsSelectEventsWrapper(void);
-void		GsGetNextEventWrapper(void);
+void		GsOpenWrapper(void *r);
+void		GsCloseWrapper(void *r);
+void		GsGetScreenInfoWrapper(void *r);
+void		GsNewWindowWrapper(void *r);
+void		GsNewInputWindowWrapper(void *r);
+void		GsDestroyWindowWrapper(void *r);
+void		GsNewGCWrapper(void *r);
+void		GsCopyGCWrapper(void *r);
+void		GsGetGCInfoWrapper(void *r);
+void		GsDestroyGCWrapper(void *r);
+void		GsMapWindowWrapper(void *r);
+void		GsUnmapWindowWrapper(void *r);
+void		GsRaiseWindowWrapper(void *r);
+void		GsLowerWindowWrapper(void *r);
+void		GsMoveWindowWrapper(void *r);
+void		GsResizeWindowWrapper(void *r);
+void		GsGetWindowInfoWrapper(void *r);
+void		GsGetFontInfoWrapper(void *r);
+void		GsSetFocusWrapper(void *r);
+void		GsSetBorderColorWrapper(void *r);
+void		GsClearWindowWrapper(void *r);
+void		GsSelectEventsWrapper(void *r);
+void		GsGetNextEventWrapper(void *r);
 void		GsGetNextEventWrapperFinish(void);
-void		GsCheckNextEventWrapper(void);
-void		GsPeekEventWrapper(void);
-void		GsFlushWrapper(void);
-void		GsLineWrapper(void);
-void		GsPointWrapper(void);
-void		GsRectWrapper(void);
-void		GsFillRectWrapper(void);
-void		GsPolyWrapper(void);
-void		GsFillPolyWrapper(void);
-void		GsEllipseWrapper(void);
-void		GsFillEllipseWrapper(void);
-void		GsSetGCForegroundWrapper(void);
-void		GsSetGCBackgroundWrapper(void);
-void		GsSetGCUseBackgroundWrapper(void);
-void		GsSetGCModeWrapper(void);
-void		GsSetGCFontWrapper(void);
-void		GsGetGCTextSizeWrapper(void);
-void		GsReadArea8Wrapper(void);
-void		GsArea8Wrapper(void);
-void		GsBitmapWrapper(void);
-void		GsTextWrapper(void);
-void		GsSetCursorWrapper(void);
-void		GsMoveCursorWrapper(void);
+void		GsCheckNextEventWrapper(void *r);
+void		GsPeekEventWrapper(void *r);
+void		GsFlushWrapper(void *r);
+void		GsLineWrapper(void *r);
+void		GsPointWrapper(void *r);
+void		GsRectWrapper(void *r);
+void		GsFillRectWrapper(void *r);
+void		GsPolyWrapper(void *r);
+void		GsFillPolyWrapper(void *r);
+void		GsEllipseWrapper(void *r);
+void		GsFillEllipseWrapper(void *r);
+void		GsSetGCForegroundWrapper(void *r);
+void		GsSetGCBackgroundWrapper(void *r);
+void		GsSetGCUseBackgroundWrapper(void *r);
+void		GsSetGCModeWrapper(void *r);
+void		GsSetGCFontWrapper(void *r);
+void		GsGetGCTextSizeWrapper(void *r);
+void		GsReadAreaWrapper(void *r);
+void		GsAreaWrapper(void *r);
+void		GsBitmapWrapper(void *r);
+void		GsTextWrapper(void *r);
+void		GsSetCursorWrapper(void *r);
+void		GsMoveCursorWrapper(void *r);
  
 /*
  * External data definitions.
@@ -319,6 +331,7 @@ extern	GR_WINDOW	*cachewp;		/* cached window pointer */
 extern	GR_WINDOW	*listwp;		/* list of all windows */
 extern	GR_WINDOW	*rootwp;		/* root window pointer */
 extern	GR_WINDOW	*clipwp;		/* window clipping is set for */
+extern	unsigned int	clipstamp;		/* window configuration changes */
 extern	GR_WINDOW	*focuswp;		/* focus window for keyboard */
 extern	GR_WINDOW	*mousewp;		/* window mouse is currently in */
 extern	GR_WINDOW	*grabbuttonwp;		/* window grabbed by button */
@@ -337,12 +350,13 @@ extern	GR_FONT_INFO	curfont;		/* current font information */
  * servers on one machine, the last digit will be that of the FB used for it.
  */
 #define GR_NAMED_SOCKET "/var/uds"
+#define GR_SOCKET_RCVBUF 1024	/* server receive buffer per client */
 
 /*
  * The network interface version number. Increment this if you make a change
  * to the interface  which will break old clients. It can only be up to 256.
  */
-#define GR_INTERFACE_NUMBER 0
+#define GR_INTERFACE_NUMBER 1
 
 /*
  * The server magic word, which clients expect to read just prior to the interface
@@ -413,6 +427,122 @@ extern	GR_FONT_INFO	curfont;		/* current font information */
 #define GrNumMoveCursor         45
 #define GrTotalNumCalls         46
 
+/*
+ * The requests sent to the server. Each request starts with a header
+ * giving the function number and the length of the whole request, which
+ * is followed by the arguments of the function and then by any variable
+ * length data, such as the points of a polygon. Only the functions that
+ * return something are answered by the server, so the client collects
+ * the other requests in a buffer of GR_REQ_BUFSIZE bytes and sends them
+ * together, the server reads them into a buffer of the same size. Larger
+ * requests are sent on their own. Requests are padded to an even length.
+ */
+typedef struct {
+	unsigned char	type;		/* function number, GrNum* */
+	unsigned char	pad;
+	unsigned short	length;		/* total length of the request */
+} GR_REQ_HEADER;
+
+/* Request with no arguments */
+typedef struct {
+	GR_REQ_HEADER	hdr;
+} GR_REQ;
+
+/* Request on a window or graphics context */
+typedef struct {
+	GR_REQ_HEADER	hdr;
+	GR_ID		id;
+} GR_REQ_ID;
+
+/* Move or resize a window, or move the cursor */
+typedef struct {
+	GR_REQ_HEADER	hdr;
+	GR_ID		id;
+	GR_COORD	x;
+	GR_COORD	y;
+} GR_REQ_ID_XY;
+
+/* Set a color of a window or graphics context */
+typedef struct {
+	GR_REQ_HEADER	hdr;
+	GR_ID		id;
+	GR_COLOR	color;
+} GR_REQ_ID_COLOR;
+
+/* Set a flag, a font or the mode of a window or graphics context */
+typedef struct {
+	GR_REQ_HEADER	hdr;
+	GR_ID		id;
+	unsigned short	value;
+} GR_REQ_ID_VALUE;
+
+typedef struct {
+	GR_REQ_HEADER	hdr;
+	GR_WINDOW_ID	parent;
+	GR_COORD	x;
+	GR_COORD	y;
+	GR_SIZE		width;
+	GR_SIZE		height;
+	GR_SIZE		bordersize;
+	GR_COLOR	background;
+	GR_COLOR	bordercolor;
+} GR_REQ_NEWWINDOW;
+
+typedef struct {
+	GR_REQ_HEADER	hdr;
+	GR_WINDOW_ID	wid;
+	GR_EVENT_MASK	eventmask;
+} GR_REQ_SELECTEVENTS;
+
+typedef struct {
+	GR_REQ_HEADER	hdr;
+	GR_DRAW_ID	id;
+	GR_GC_ID	gc;
+	GR_COORD	x1;
+	GR_COORD	y1;
+	GR_COORD	x2;
+	GR_COORD	y2;
+} GR_REQ_LINE;
+
+/*
+ * Rectangles, ellipses, areas and bitmaps. An ellipse gives its radii
+ * as width and height, areas and bitmaps are followed by their data.
+ * Without the gc, the request reads back an area.
+ */
+typedef struct {
+	GR_REQ_HEADER	hdr;
+	GR_DRAW_ID	id;
+	GR_GC_ID	gc;
+	GR_COORD	x;
+	GR_COORD	y;
+	GR_SIZE		width;
+	GR_SIZE		height;
+} GR_REQ_RECT;
+
+/* Points, polygons and text, followed by count points or characters */
+typedef struct {
+	GR_REQ_HEADER	hdr;
+	GR_DRAW_ID	id;
+	GR_GC_ID	gc;
+	GR_COORD	x;
+	GR_COORD	y;
+	GR_COUNT	count;
+} GR_REQ_DRAW;
+
+typedef struct {
+	GR_REQ_HEADER	hdr;
+	GR_WINDOW_ID	wid;
+	GR_SIZE		width;
+	GR_SIZE		height;
+	GR_COORD	hotx;
+	GR_COORD	hoty;
+	GR_COLOR	foreground;
+	GR_COLOR	background;
+} GR_REQ_SETCURSOR;		/* followed by both bitmaps */
+
+#define GR_REQ_MAXLEN	0xFFFE	/* max length of a single request */
+#define GR_REQ_DATA(req) ((void *) ((req) + 1))	/* data after a request */
+
 /*
  * The values the server can return in response to a command.
  * Items marked with a * are transitory- ie. if the client gets one of these it should try
@@ -341,7 +341,17 @@ void GsDeliverMotionEvent(GR_EVENT_TYPE type, BUTTON buttons, MODIFIER modifiers
 			if (type == GR_EVENT_TYPE_MOUSE_POSITION) 
 				GsFreePositionEvent(client, wp->id, subwid);
 
-			ep = (GR_EVENT_MOUSE *) GsAllocEvent(client);
+			/*
+			 * Motion events are merged into the last queued
+			 * one if it is a motion event for this window,
+			 * so a slow client only sees the latest motion.
+			 */
+			ep = NULL;
+			if (type == GR_EVENT_TYPE_MOUSE_MOTION &&
+			    !(ecp->eventmask & GR_EVENT_MASK_MOUSE_RAW))
+				ep = GsMergeMotionEvent(client, wp->id, subwid);
+			if (ep == NULL)
+				ep = (GR_EVENT_MOUSE *) GsAllocEvent(client);
 			if (ep == NULL)
 				continue;
 
@@ -499,6 +509,25 @@ void GsDeliverGeneralEvent(GR_WINDOW *wp, GR_EVENT_TYPE type)
 	}
 }
 
+/*
+ * Return the last event in the specified client's event queue if it is a
+ * mouse motion event for the same window and subwindow, so that it can be
+ * overwritten with the latest position instead of queuing another one.
+ * Only the tail is checked, so motion is never moved past other events.
+ */
+GR_EVENT_MOUSE *GsMergeMotionEvent(GR_CLIENT *client, GR_WINDOW_ID wid,
+	GR_WINDOW_ID subwid)
+{
+	GR_EVENT_LIST	*elp;		/* last element list */
+
+	elp = client->eventtail;
+	if (elp == NULL || elp->event.type != GR_EVENT_TYPE_MOUSE_MOTION)
+		return NULL;
+	if (elp->event.mouse.wid != wid || elp->event.mouse.subwid != subwid)
+		return NULL;
+	return &elp->event.mouse;
+}
+
 /*
  * Search for a matching mouse position event in the specified client's
  * event queue, and remove it.  This is used to prevent multiple position
@@ -242,6 +242,7 @@ void GsRaiseWindow(GR_WINDOW_ID wid)
 	prevwp->siblings = wp->siblings;
 	wp->siblings = wp->parent->children;
 	wp->parent->children = wp;
+	GsForgetClip();
 
 	/*
 	 * Finally redraw the window if necessary.
@@ -296,6 +297,7 @@ void GsLowerWindow(GR_WINDOW_ID wid)
 	sibwp->siblings = wp;
 
 	wp->siblings = NULL;
+	GsForgetClip();
 
 	/*
 	 * Finally redraw the sibling windows which this window covered
@@ -614,6 +616,9 @@ GsNewWindow(GR_WINDOW_ID parent, GR_COORD x, GR_COORD y, GR_SIZE width,
 	wp->mapped = GR_FALSE;
 	wp->unmapcount = pwp->unmapcount + 1;
 	wp->output = GR_TRUE;
+	wp->cliprects = NULL;
+	wp->clipcount = 0;
+	wp->clipstamp = 0;
 
 	pwp->children = wp;
 	listwp = wp;
@@ -665,6 +670,9 @@ GR_WINDOW_ID GsNewInputWindow(GR_WINDOW_ID parent, GR_COORD x, GR_COORD y,
 	wp->mapped = GR_FALSE;
 	wp->unmapcount = pwp->unmapcount + 1;
 	wp->output = GR_FALSE;
+	wp->cliprects = NULL;
+	wp->clipcount = 0;
+	wp->clipstamp = 0;
 
 	wp->cursor->usecount++;
 	pwp->children = wp;
@@ -33,6 +33,7 @@ GR_WINDOW	*rootwp;		/* root window pointer */
 GR_GC		*listgcp;		/* list of all gc */
 GR_GC		*curgcp;		/* currently enabled gc */
 GR_WINDOW	*clipwp;		/* window clipping is set for */
+unsigned int	clipstamp = 1;		/* window configuration changes */
 GR_WINDOW	*focuswp;		/* focus window for keyboard */
 GR_WINDOW	*mousewp;		/* window mouse is currently in */
 GR_WINDOW	*grabbuttonwp;		/* window grabbed by button */
@@ -89,6 +90,9 @@ GsAcceptClientFd(int i)
 	client->errorevent.type = GR_EVENT_TYPE_NONE;
 	client->next = NULL;
 	client->waiting_for_event = FALSE;
+#if !NONETWORK
+	client->reqlen = 0;
+#endif
 
 	if(connectcount++ == 0)
 		root_client = client;
@@ -201,6 +205,7 @@ GsSelect(GR_TIMEOUT timeout)
 	while(curclient) {
 		if(curclient->waiting_for_event && curclient->eventhead) {
 			curclient->waiting_for_event = FALSE;
+			current_fd = curclient->id;
 			GsGetNextEventWrapperFinish();
 			return;
 		}
@@ -253,9 +258,12 @@ GsSelect(GR_TIMEOUT timeout)
 		/* If a client is sending us a command, handle it: */
 		curclient = root_client;
 		while(curclient) {
+			/* the client is freed if its connection is closed */
+			GR_CLIENT *next = curclient->next;
+
 			if(FD_ISSET(curclient->id, &rfds))
 				GsHandleClient(curclient->id);
-			curclient = curclient->next;
+			curclient = next;
 		}
 #endif
 
@@ -363,6 +371,9 @@ GsInitialize(void)
 	wp->mapped = GR_TRUE;
 	wp->unmapcount = 0;
 	wp->output = GR_TRUE;
+	wp->cliprects = NULL;
+	wp->clipcount = 0;
+	wp->clipstamp = 0;
 
 	listwp = wp;
 	rootwp = wp;
@@ -30,25 +30,35 @@ extern	GR_CLIENT	*root_client;
 extern	int		current_fd;
 
 /*
- * These are all wrapper functions which are used to read the arguments for and call the
- * relevant function.
+ * These are all wrapper functions which are used to take the arguments for and call the
+ * relevant function. Each is passed the request read from the client, which is followed
+ * by any variable length data. Only the functions which return something reply to the
+ * client, errors in the others are reported by error events.
  */
 
-void GsOpenWrapper(void)
+/*
+ * Check that a request of size bytes has room for datalen bytes of data.
+ */
+static int GsCheckLength(void *r, int size, long datalen)
+{
+	return ((GR_REQ_HEADER *) r)->length >= size + datalen;
+}
+
+void GsOpenWrapper(void *r)
 {
 	GsOpen();
 
 	GsPutCh(current_fd, GrRetOK);
 }
 
-void GsCloseWrapper(void)
+void GsCloseWrapper(void *r)
 {
 	GsPutCh(current_fd, GrRetOK);
 
 	GsClose();
 }
 
-void GsGetScreenInfoWrapper(void)
+void GsGetScreenInfoWrapper(void *r)
 {
 	GR_SCREEN_INFO si;
 
@@ -59,1236 +69,436 @@ void GsGetScreenInfoWrapper(void)
 	GsWrite(current_fd, &si, sizeof(si));
 }
 
-void GsNewWindowWrapper(void)
-{
-	GR_WINDOW_ID wid, parent;
-	GR_COORD x, y;
-	GR_SIZE width, height, bordersize;
-	GR_COLOR background, bordercolor;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &parent, sizeof(parent)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &x, sizeof(x)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &y, sizeof(y)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &width, sizeof(width)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &height, sizeof(height)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &bordersize, sizeof(bordersize)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &background, sizeof(background)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &bordercolor, sizeof(bordercolor)))
-		return;
-
-	wid = GsNewWindow(parent, x, y, width, height, bordersize, background, bordercolor);
-
-	GsPutCh(current_fd, GrRetDataFollows);
-
-	GsWrite(current_fd, &wid, sizeof(wid));
-}
-
-void GsNewInputWindowWrapper(void)
-{
-	GR_WINDOW_ID wid, parent;
-	GR_COORD x, y;
-	GR_SIZE width, height;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &parent, sizeof(parent)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &x, sizeof(x)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &y, sizeof(y)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &width, sizeof(width)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &height, sizeof(height)))
-		return;
-
-	wid = GsNewInputWindow(parent, x, y, width, height);
-
-	GsPutCh(current_fd, GrRetDataFollows);
-
-	GsWrite(current_fd, &wid, sizeof(wid));
-}
-
-void GsDestroyWindowWrapper(void)
-{
-	GR_WINDOW_ID wid;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &wid, sizeof(wid)))
-		return;
-
-	GsDestroyWindow(wid);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsNewGCWrapper(void)
-{
-	GR_GC_ID gc = GsNewGC();
-
-	GsPutCh(current_fd, GrRetDataFollows);
-
-	GsWrite(current_fd, (void *) &gc, sizeof(gc));
-}
-
-void GsCopyGCWrapper(void)
-{
-	GR_GC_ID gci, gco;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &gci, sizeof(gci)))
-		return;
-
-	gco = GsCopyGC(gci);
-
-	GsPutCh(current_fd, GrRetDataFollows);
-
-	GsWrite(current_fd, (void *) &gco, sizeof(gco));
-}
-
-void GsGetGCInfoWrapper(void)
-{
-	GR_GC_INFO gc;
-	GR_GC_ID g;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &g, sizeof(g)))
-		return;
-
-	GsGetGCInfo(g, &gc);
-
-	GsPutCh(current_fd, GrRetDataFollows);
-
-	GsWrite(current_fd, (void *) &gc, sizeof(gc));
-}
-
-void GsDestroyGCWrapper(void)
-{
-	GR_GC_ID gc;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &gc, sizeof(gc)))
-		return;
-
-	GsDestroyGC(gc);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsMapWindowWrapper(void)
-{
-	GR_WINDOW_ID wid;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &wid, sizeof(wid)))
-		return;
-
-	GsMapWindow(wid);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsUnmapWindowWrapper(void)
-{
-	GR_WINDOW_ID wid;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &wid, sizeof(wid)))
-		return;
-
-	GsUnmapWindow(wid);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsRaiseWindowWrapper(void)
-{
-	GR_WINDOW_ID wid;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &wid, sizeof(wid)))
-		return;
-
-	GsRaiseWindow(wid);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsLowerWindowWrapper(void)
-{
-	GR_WINDOW_ID wid;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &wid, sizeof(wid)))
-		return;
-
-	GsLowerWindow(wid);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsMoveWindowWrapper(void)
-{
-	GR_WINDOW_ID wid;
-	GR_COORD x;
-	GR_COORD y;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &wid, sizeof(wid)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &x, sizeof(x)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &y, sizeof(y)))
-		return;
-
-	GsMoveWindow(wid, x, y);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsResizeWindowWrapper(void)
-{
-	GR_WINDOW_ID wid;
-	GR_SIZE width;
-	GR_SIZE height;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &wid, sizeof(wid)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &width, sizeof(width)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &height, sizeof(height)))
-		return;
-
-	GsResizeWindow(wid, width, height);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsGetWindowInfoWrapper(void)
+void GsNewWindowWrapper(void *r)
 {
+	GR_REQ_NEWWINDOW *req = r;
 	GR_WINDOW_ID wid;
-	GR_WINDOW_INFO wi;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &wid, sizeof(wid)))
-		return;
-
-	GsGetWindowInfo(wid, &wi);
-
-	GsPutCh(current_fd, GrRetDataFollows);
-
-	GsWrite(current_fd, (void *) &wi, sizeof(wi));
-}
 
-void GsGetFontInfoWrapper(void)
-{
-	GR_FONT_INFO fi;
-	GR_FONT font;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &font, sizeof(GR_FONT)))
-		return;
-
-	GsGetFontInfo(font, &fi);
+	wid = GsNewWindow(req->parent, req->x, req->y, req->width, req->height,
+		req->bordersize, req->background, req->bordercolor);
 
 	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsWrite(current_fd, &fi, sizeof(fi));
-}
-
-void GsSetFocusWrapper(void)
-{
-	GR_WINDOW_ID wid;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &wid, sizeof(wid)))
-		return;
-
-	GsSetFocus(wid);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsSetBorderColorWrapper(void)
-{
-	GR_WINDOW_ID wid;
-	GR_COLOR colour;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &wid, sizeof(wid)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &colour, sizeof(colour)))
-		return;
-
-	GsSetBorderColor(wid, colour);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsClearWindowWrapper(void)
-{
-	GR_WINDOW_ID wid;
-	GR_BOOL exposeflag;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &wid, sizeof(wid)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &exposeflag, sizeof(exposeflag)))
-		return;
-
-	GsClearWindow(wid, exposeflag);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsSelectEventsWrapper(void)
-{
-	GR_WINDOW_ID wid;
-	GR_EVENT_MASK eventmask;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &wid, sizeof(wid)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &eventmask, sizeof(eventmask)))
-		return;
-
-	GsSelectEvents(wid, eventmask);
-
-	GsPutCh(current_fd, GrRetOK);	
+	GsWrite(current_fd, &wid, sizeof(wid));
 }
 
-void GsGetNextEventWrapper(void)
-{
-	GR_EVENT evt;
-
-	/* first check if any event ready*/
-	GsCheckNextEvent(&evt);
-	if(evt.type == GR_EVENT_TYPE_NONE) {
-		/* tell main loop to call Finish routine on event*/
-		curclient->waiting_for_event = TRUE;
-		return;
-	}
-
-	GsPutCh(current_fd, GrRetDataFollows);
-
-	GsWrite(current_fd, (void *) &evt, sizeof(evt));
-}
-
-/* Complete the GrGetNextEvent call from client.
- * The client is still waiting on a read at this point.
- */
-void GsGetNextEventWrapperFinish(void)
-{
-	GR_EVENT evt;
-
-	/* get the event and pass it to client*/
-	/* this will never be GR_EVENT_TYPE_NONE*/
-	GsCheckNextEvent(&evt);
-
-	GsPutCh(current_fd, GrRetDataFollows);
-
-	GsWrite(current_fd, (void *) &evt, sizeof(evt));
-}
-
-void GsCheckNextEventWrapper(void)
-{
-	GR_EVENT evt;
-
-	GsCheckNextEvent(&evt);
-
-	GsPutCh(current_fd, GrRetDataFollows);
-
-	GsWrite(current_fd, (void *) &evt, sizeof(evt));
-}
-
-void GsPeekEventWrapper(void)
-{
-	GR_EVENT evt;
-	GR_CHAR	ret;
-
-	ret = GsPeekEvent(&evt);
-
-	GsPutCh(current_fd, GrRetDataFollows);
-
-	GsWrite(current_fd, (void *) &evt, sizeof(evt));
-
-	GsWrite(current_fd, &ret, 1);
-}
-
-void GsFlushWrapper(void)
-{
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsLineWrapper(void)
-{
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_COORD x1, y1, x2, y2;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &x1, sizeof(x1)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &y1, sizeof(y1)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &x2, sizeof(x2)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &y2, sizeof(y2)))
-		return;
-
-	GsLine(id, gc, x1, y1, x2, y2);
-
-	GsPutCh(current_fd, GrRetOK);	
-}
-
-void GsPointWrapper(void)
-{
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_COORD x, y;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &x, sizeof(x)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &y, sizeof(y)))
-		return;
-
-	GsPoint(id, gc, x, y);
-
-	GsPutCh(current_fd, GrRetOK);	
-
-}
-
-void GsRectWrapper(void)
-{
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_COORD x, y;
-	GR_SIZE width, height;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &x, sizeof(x)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &y, sizeof(y)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &width, sizeof(width)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &height, sizeof(height)))
-		return;
-
-	GsRect(id, gc, x, y, width, height);
-
-	GsPutCh(current_fd, GrRetOK);	
-}
-
-void GsFillRectWrapper(void)
-{
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_COORD x, y;
-	GR_SIZE width, height;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &x, sizeof(x)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &y, sizeof(y)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &width, sizeof(width)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &height, sizeof(height)))
-		return;
-
-	GsFillRect(id, gc, x, y, width, height);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-/* FIXME: fails with pointtable size > 64k if sizeof(int) == 2*/
-void GsPolyWrapper(void)
-{
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_COUNT count;
-	GR_POINT *pointtable;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &count, sizeof(count)))
-		return;
-
-	if(!(pointtable = malloc(count * sizeof(GR_POINT)))) {
-		GsPutCh(current_fd, GrRetENoMem);
-		return;
-	}
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) pointtable, (count * sizeof(GR_POINT)))) {
-		free(pointtable);
-		return;
-	}
-
-	GsPoly(id, gc, count, pointtable);
-
-	free(pointtable);
-
-	GsPutCh(current_fd, GrRetOK);	
-}
-
-/* FIXME: fails with pointtable size > 64k if sizeof(int) == 2*/
-void GsFillPolyWrapper(void)
-{
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_COUNT count;
-	GR_POINT *pointtable;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &count, sizeof(count)))
-		return;
-
-	if(!(pointtable = malloc(count * sizeof(GR_POINT)))) {
-		GsPutCh(current_fd, GrRetENoMem);
-		return;
-	}
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) pointtable, (count * sizeof(GR_POINT)))) {
-		free(pointtable);
-		return;
-	}
-
-	GsFillPoly(id, gc, count, pointtable);
-
-	free(pointtable);
-
-	GsPutCh(current_fd, GrRetOK);	
-}
-
-void GsEllipseWrapper(void)
-{
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_COORD x, y;
-	GR_SIZE rx, ry;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &x, sizeof(x)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &y, sizeof(y)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &rx, sizeof(rx)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &ry, sizeof(ry)))
-		return;
-
-	GsEllipse(id, gc, x, y, rx, ry);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsFillEllipseWrapper(void)
-{
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_COORD x, y;
-	GR_SIZE rx, ry;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &x, sizeof(x)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &y, sizeof(y)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &rx, sizeof(rx)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &ry, sizeof(ry)))
-		return;
-
-	GsFillEllipse(id, gc, x, y, rx, ry);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsSetGCForegroundWrapper(void)
-{
-	GR_GC_ID gc;
-	GR_COLOR foreground;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &foreground, sizeof(foreground)))
-		return;
-
-	GsSetGCForeground(gc, foreground);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsSetGCBackgroundWrapper(void)
-{
-	GR_GC_ID gc;
-	GR_COLOR background;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &background, sizeof(background)))
-		return;
-
-	GsSetGCBackground(gc, background);
-
-	GsPutCh(current_fd, GrRetOK);
-}
-
-void GsSetGCUseBackgroundWrapper(void)
-{
-	GR_GC_ID gc;
-	GR_BOOL use;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, &gc, sizeof(gc)))
-		return;
+void GsNewInputWindowWrapper(void *r)
+{
+	GR_REQ_NEWWINDOW *req = r;
+	GR_WINDOW_ID wid;
 
-	GsPutCh(current_fd, GrRetSendData);
+	wid = GsNewInputWindow(req->parent, req->x, req->y, req->width, req->height);
 
-	if(GsRead(current_fd, &use, sizeof(use)))
-		return;
+	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsSetGCUseBackground(gc, use);
+	GsWrite(current_fd, &wid, sizeof(wid));
+}
 
-	GsPutCh(current_fd, GrRetOK);
+void GsDestroyWindowWrapper(void *r)
+{
+	GsDestroyWindow(((GR_REQ_ID *) r)->id);
 }
 
-void GsSetGCModeWrapper(void)
+void GsNewGCWrapper(void *r)
 {
-	GR_GC_ID gc;
-	GR_MODE mode;
+	GR_GC_ID gc = GsNewGC();
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsPutCh(current_fd, GrRetDataFollows);
 
-	if(GsRead(current_fd, &gc, sizeof(gc)))
-		return;
+	GsWrite(current_fd, (void *) &gc, sizeof(gc));
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsCopyGCWrapper(void *r)
+{
+	GR_GC_ID gco;
 
-	if(GsRead(current_fd, &mode, sizeof(mode)))
-		return;
+	gco = GsCopyGC(((GR_REQ_ID *) r)->id);
 
-	GsSetGCMode(gc, mode);
+	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsPutCh(current_fd, GrRetOK);
+	GsWrite(current_fd, (void *) &gco, sizeof(gco));
 }
 
-void GsSetGCFontWrapper(void)
+void GsGetGCInfoWrapper(void *r)
 {
-	GR_GC_ID gc;
-	GR_FONT font;
-
-	GsPutCh(current_fd, GrRetSendData);
+	GR_GC_INFO gc;
 
-	if(GsRead(current_fd, &gc, sizeof(gc)))
-		return;
+	GsGetGCInfo(((GR_REQ_ID *) r)->id, &gc);
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsPutCh(current_fd, GrRetDataFollows);
 
-	if(GsRead(current_fd, &font, sizeof(font)))
-		return;
+	GsWrite(current_fd, (void *) &gc, sizeof(gc));
+}
 
-	GsSetGCFont(gc, font);
+void GsDestroyGCWrapper(void *r)
+{
+	GsDestroyGC(((GR_REQ_ID *) r)->id);
+}
 
-	GsPutCh(current_fd, GrRetOK);
+void GsMapWindowWrapper(void *r)
+{
+	GsMapWindow(((GR_REQ_ID *) r)->id);
 }
 
-void GsGetGCTextSizeWrapper(void)
+void GsUnmapWindowWrapper(void *r)
 {
-	GR_SIZE len, retwidth, retheight, retbase;
-	GR_GC_ID gc;
-	GR_CHAR *string;
-	char strbuf[128];
+	GsUnmapWindow(((GR_REQ_ID *) r)->id);
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsRaiseWindowWrapper(void *r)
+{
+	GsRaiseWindow(((GR_REQ_ID *) r)->id);
+}
 
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
+void GsLowerWindowWrapper(void *r)
+{
+	GsLowerWindow(((GR_REQ_ID *) r)->id);
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsMoveWindowWrapper(void *r)
+{
+	GR_REQ_ID_XY *req = r;
 
-	if(GsRead(current_fd, (void *) &len, sizeof(len)))
-		return;
+	GsMoveWindow(req->id, req->x, req->y);
+}
 
-	if(len <= sizeof(strbuf))
-		string = strbuf;
-	else if(!(string = malloc(len))) {
-		GsPutCh(current_fd, GrRetENoMem);
-		return;
-	}
+void GsResizeWindowWrapper(void *r)
+{
+	GR_REQ_ID_XY *req = r;
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsResizeWindow(req->id, req->x, req->y);
+}
 
-	if(GsRead(current_fd, (void *)string, len)) {
-		if(len > sizeof(strbuf))
-			free(string);
-		return;
-	}
+void GsGetWindowInfoWrapper(void *r)
+{
+	GR_WINDOW_INFO wi;
 
-	GsGetGCTextSize(gc, string, len, &retwidth, &retheight, &retbase);
+	GsGetWindowInfo(((GR_REQ_ID *) r)->id, &wi);
 
 	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsWrite(current_fd, &retwidth, sizeof(retwidth));
-
-	GsWrite(current_fd, &retheight, sizeof(retheight));
-
-	GsWrite(current_fd, &retbase, sizeof(retbase));
-
-	if(len > sizeof(strbuf))
-		free(string);
+	GsWrite(current_fd, (void *) &wi, sizeof(wi));
 }
 
-/* FIXME: fails with size > 64k if sizeof(int) == 2*/
-void GsReadAreaWrapper(void)
+void GsGetFontInfoWrapper(void *r)
 {
-	GR_DRAW_ID id;
-	GR_SIZE width, height;
-	GR_COORD x, y;
-	PIXELVAL *area;
-	int size;
+	GR_FONT_INFO fi;
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsGetFontInfo(((GR_REQ_ID_VALUE *) r)->value, &fi);
 
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
+	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsWrite(current_fd, &fi, sizeof(fi));
+}
 
-	if(GsRead(current_fd, (void *) &x, sizeof(x)))
-		return;
+void GsSetFocusWrapper(void *r)
+{
+	GsSetFocus(((GR_REQ_ID *) r)->id);
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsSetBorderColorWrapper(void *r)
+{
+	GR_REQ_ID_COLOR *req = r;
 
-	if(GsRead(current_fd, (void *) &y, sizeof(y)))
-		return;
+	GsSetBorderColor(req->id, req->color);
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsClearWindowWrapper(void *r)
+{
+	GR_REQ_ID_VALUE *req = r;
 
-	if(GsRead(current_fd, (void *) &width, sizeof(width)))
-		return;
+	GsClearWindow(req->id, req->value);
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsSelectEventsWrapper(void *r)
+{
+	GR_REQ_SELECTEVENTS *req = r;
 
-	if(GsRead(current_fd, (void *) &height, sizeof(height)))
-		return;
+	GsSelectEvents(req->wid, req->eventmask);
+}
 
-	/* FIXME: optimize for smaller pixelvals*/
-	size = width * height * sizeof(PIXELVAL);
+void GsGetNextEventWrapper(void *r)
+{
+	GR_EVENT evt;
 
-	if(!(area = malloc(size))) {
-		GsPutCh(current_fd, GrRetENoMem);
+	/* first check if any event ready*/
+	GsCheckNextEvent(&evt, GR_TIMEOUT_POLL);
+	if(evt.type == GR_EVENT_TYPE_NONE) {
+		/* tell main loop to call Finish routine on event*/
+		curclient->waiting_for_event = TRUE;
 		return;
 	}
 
-	GsReadArea(id, x, y, width, height, area);
-
 	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsWrite(current_fd, area, size);
-
-	free(area);
+	GsWrite(current_fd, (void *) &evt, sizeof(evt));
 }
 
-/* FIXME: fails with size > 64k if sizeof(int) == 2*/
-void GsAreaWrapper(void)
+/* Complete the GrGetNextEvent call from client.
+ * The client is still waiting on a read at this point.
+ */
+void GsGetNextEventWrapperFinish(void)
 {
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_SIZE width, height;
-	GR_COORD x, y;
-	PIXELVAL *area;
-	int size;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &x, sizeof(x)))
-		return;
+	GR_EVENT evt;
 
-	GsPutCh(current_fd, GrRetSendData);
+	/* get the event and pass it to client*/
+	/* this will never be GR_EVENT_TYPE_NONE*/
+	GsCheckNextEvent(&evt, GR_TIMEOUT_POLL);
 
-	if(GsRead(current_fd, (void *) &y, sizeof(y)))
-		return;
+	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsWrite(current_fd, (void *) &evt, sizeof(evt));
+}
 
-	if(GsRead(current_fd, (void *) &width, sizeof(width)))
-		return;
+void GsCheckNextEventWrapper(void *r)
+{
+	GR_EVENT evt;
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsCheckNextEvent(&evt, GR_TIMEOUT_POLL);
 
-	if(GsRead(current_fd, (void *) &height, sizeof(height)))
-		return;
+	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsWrite(current_fd, (void *) &evt, sizeof(evt));
+}
 
-	/* FIXME: optimize for smaller pixelvals*/
-	size = width * height * sizeof(PIXELVAL);
+void GsPeekEventWrapper(void *r)
+{
+	GR_EVENT evt;
+	GR_CHAR	ret;
 
-	if(!(area = malloc(size))) {
-		GsPutCh(current_fd, GrRetENoMem);
-		return;
-	}
+	ret = GsPeekEvent(&evt);
 
-	if(GsRead(current_fd, (void *) area, size))
-		return;
+	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsArea(id, gc, x, y, width, height, area);
+	GsWrite(current_fd, (void *) &evt, sizeof(evt));
 
-	free(area);
+	GsWrite(current_fd, &ret, 1);
+}
 
+/*
+ * The requests before this one have all been done by now,
+ * so the reply tells the client the server has caught up.
+ */
+void GsFlushWrapper(void *r)
+{
 	GsPutCh(current_fd, GrRetOK);
 }
 
-/* FIXME: fails with bitmapsize > 64k if sizeof(int) == 2*/
-void GsBitmapWrapper(void)
+void GsLineWrapper(void *r)
 {
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_SIZE width, height;
-	GR_COORD x, y;
-	GR_BITMAP *bitmap;
-	int bitmapsize;
-
-	GsPutCh(current_fd, GrRetSendData);
+	GR_REQ_LINE *req = r;
 
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
+	GsLine(req->id, req->gc, req->x1, req->y1, req->x2, req->y2);
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsPointWrapper(void *r)
+{
+	GR_REQ_DRAW *req = r;
 
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
+	GsPoint(req->id, req->gc, req->x, req->y);
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsRectWrapper(void *r)
+{
+	GR_REQ_RECT *req = r;
 
-	if(GsRead(current_fd, (void *) &x, sizeof(x)))
-		return;
+	GsRect(req->id, req->gc, req->x, req->y, req->width, req->height);
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsFillRectWrapper(void *r)
+{
+	GR_REQ_RECT *req = r;
 
-	if(GsRead(current_fd, (void *) &y, sizeof(y)))
-		return;
+	GsFillRect(req->id, req->gc, req->x, req->y, req->width, req->height);
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsPolyWrapper(void *r)
+{
+	GR_REQ_DRAW *req = r;
 
-	if(GsRead(current_fd, (void *) &width, sizeof(width)))
+	if(!GsCheckLength(req, sizeof(*req), (long)req->count * sizeof(GR_POINT)))
 		return;
 
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &height, sizeof(height)))
-		return;
+	GsPoly(req->id, req->gc, req->count, GR_REQ_DATA(req));
+}
 
-	bitmapsize = GR_BITMAP_SIZE(width, height) * sizeof(GR_BITMAP);
+void GsFillPolyWrapper(void *r)
+{
+	GR_REQ_DRAW *req = r;
 
-	if(!(bitmap = malloc(bitmapsize))) {
-		GsPutCh(current_fd, GrRetENoMem);
+	if(!GsCheckLength(req, sizeof(*req), (long)req->count * sizeof(GR_POINT)))
 		return;
-	}
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsFillPoly(req->id, req->gc, req->count, GR_REQ_DATA(req));
+}
 
-	if(GsRead(current_fd, (void *) bitmap, bitmapsize))
-		return;
+void GsEllipseWrapper(void *r)
+{
+	GR_REQ_RECT *req = r;
 
-	GsBitmap(id, gc, x, y, width, height, bitmap);
+	GsEllipse(req->id, req->gc, req->x, req->y, req->width, req->height);
+}
 
-	free(bitmap);
+void GsFillEllipseWrapper(void *r)
+{
+	GR_REQ_RECT *req = r;
 
-	GsPutCh(current_fd, GrRetOK);
+	GsFillEllipse(req->id, req->gc, req->x, req->y, req->width, req->height);
 }
 
-void GsTextWrapper(void)
+void GsSetGCForegroundWrapper(void *r)
 {
-	GR_DRAW_ID id;
-	GR_GC_ID gc;
-	GR_COORD x, y;
-	GR_COUNT count;
-	GR_CHAR *str;
-	char strbuf[128];
+	GR_REQ_ID_COLOR *req = r;
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsSetGCForeground(req->id, req->color);
+}
 
-	if(GsRead(current_fd, (void *) &id, sizeof(id)))
-		return;
+void GsSetGCBackgroundWrapper(void *r)
+{
+	GR_REQ_ID_COLOR *req = r;
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsSetGCBackground(req->id, req->color);
+}
 
-	if(GsRead(current_fd, (void *) &gc, sizeof(gc)))
-		return;
+void GsSetGCUseBackgroundWrapper(void *r)
+{
+	GR_REQ_ID_VALUE *req = r;
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsSetGCUseBackground(req->id, req->value);
+}
 
-	if(GsRead(current_fd, (void *) &x, sizeof(x)))
-		return;
+void GsSetGCModeWrapper(void *r)
+{
+	GR_REQ_ID_VALUE *req = r;
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsSetGCMode(req->id, req->value);
+}
 
-	if(GsRead(current_fd, (void *) &y, sizeof(y)))
-		return;
+void GsSetGCFontWrapper(void *r)
+{
+	GR_REQ_ID_VALUE *req = r;
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsSetGCFont(req->id, req->value);
+}
 
-	if(GsRead(current_fd, (void *) &count, sizeof(count)))
-		return;
+void GsGetGCTextSizeWrapper(void *r)
+{
+	GR_REQ_ID_VALUE *req = r;
+	GR_SIZE retwidth, retheight, retbase;
 
-	if(count <= sizeof(strbuf))
-		str = strbuf;
-	else if(!(str = malloc(count))) {
-		GsPutCh(current_fd, GrRetENoMem);
+	if(!GsCheckLength(req, sizeof(*req), req->value)) {
+		GsPutCh(current_fd, GrRetENoFunction);
 		return;
 	}
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsGetGCTextSize(req->id, GR_REQ_DATA(req), req->value, &retwidth,
+		&retheight, &retbase);
 
-	if(GsRead(current_fd, (void *) str, count)) {
-		if(count > sizeof(strbuf))
-			free(str);
-		return;
-	}
+	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsText(id, gc, x, y, str, count);
+	GsWrite(current_fd, &retwidth, sizeof(retwidth));
 
-	if(count > sizeof(strbuf))
-		free(str);
+	GsWrite(current_fd, &retheight, sizeof(retheight));
 
-	GsPutCh(current_fd, GrRetOK);
+	GsWrite(current_fd, &retbase, sizeof(retbase));
 }
 
-void GsSetCursorWrapper(void)
+/* FIXME: fails with size > 64k if sizeof(int) == 2*/
+void GsReadAreaWrapper(void *r)
 {
-	GR_WINDOW_ID wid;
-	GR_CURSOR cr;
-	int bitmapsize;
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &wid, sizeof(wid)))
-		return;
+	GR_REQ_RECT *req = r;
+	PIXELVAL *area;
+	int size;
 
-	GsPutCh(current_fd, GrRetSendData);
+	/* FIXME: optimize for smaller pixelvals*/
+	size = req->width * req->height * sizeof(PIXELVAL);
 
-	if(GsRead(current_fd, (void *) &cr.cursor.width, sizeof(cr.cursor.width)))
+	if(!(area = malloc(size))) {
+		GsPutCh(current_fd, GrRetENoMem);
 		return;
+	}
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsReadArea(req->id, req->x, req->y, req->width, req->height, area);
 
-	if(GsRead(current_fd, (void *) &cr.cursor.height, sizeof(cr.cursor.height)))
-		return;
+	GsPutCh(current_fd, GrRetDataFollows);
 
-	GsPutCh(current_fd, GrRetSendData);
+	GsWrite(current_fd, area, size);
 
-	if(GsRead(current_fd, (void *) &cr.cursor.hotx, sizeof(cr.cursor.hotx)))
-		return;
+	free(area);
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsAreaWrapper(void *r)
+{
+	GR_REQ_RECT *req = r;
 
-	if(GsRead(current_fd, (void *) &cr.cursor.hoty, sizeof(cr.cursor.hoty)))
+	/* FIXME: optimize for smaller pixelvals*/
+	if(!GsCheckLength(req, sizeof(*req),
+	    (long)req->width * req->height * sizeof(PIXELVAL)))
 		return;
 
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) &cr.cursor.fgcolor, sizeof(cr.cursor.fgcolor)))
-		return;
+	GsArea(req->id, req->gc, req->x, req->y, req->width, req->height,
+		GR_REQ_DATA(req));
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsBitmapWrapper(void *r)
+{
+	GR_REQ_RECT *req = r;
 
-	if(GsRead(current_fd, (void *) &cr.cursor.bgcolor, sizeof(cr.cursor.bgcolor)))
+	if(!GsCheckLength(req, sizeof(*req),
+	    (long)GR_BITMAP_SIZE(req->width, req->height) * sizeof(GR_BITMAP)))
 		return;
 
-	bitmapsize = GR_BITMAP_SIZE(cr.cursor.width, cr.cursor.height)
-		* sizeof(GR_BITMAP);
-
-	GsPutCh(current_fd, GrRetSendData);
-
-	if(GsRead(current_fd, (void *) cr.cursor.image, bitmapsize))
-		return;
+	GsBitmap(req->id, req->gc, req->x, req->y, req->width, req->height,
+		GR_REQ_DATA(req));
+}
 
-	GsPutCh(current_fd, GrRetSendData);
+void GsTextWrapper(void *r)
+{
+	GR_REQ_DRAW *req = r;
 
-	if(GsRead(current_fd, (void *) cr.cursor.mask, bitmapsize))
+	if(!GsCheckLength(req, sizeof(*req), req->count))
 		return;
 
-	GsSetCursor(wid, cr.cursor.width, cr.cursor.height,
-		cr.cursor.hotx, cr.cursor.hoty, cr.cursor.fgcolor,
-		cr.cursor.bgcolor, cr.cursor.image, cr.cursor.mask);
-
-	GsPutCh(current_fd, GrRetOK);
+	GsText(req->id, req->gc, req->x, req->y, GR_REQ_DATA(req), req->count);
 }
 
-void GsMoveCursorWrapper(void)
+void GsSetCursorWrapper(void *r)
 {
-	GR_COORD x;
-	GR_COORD y;
-
-	GsPutCh(current_fd, GrRetSendData);
+	GR_REQ_SETCURSOR *req = r;
+	GR_BITMAP *bitmaps = GR_REQ_DATA(req);
+	int bitmapsize;
 
-	if(GsRead(current_fd, &x, sizeof(x)))
+	if(req->width > MAX_CURSOR_SIZE || req->height > MAX_CURSOR_SIZE) {
+		GsError(GR_ERROR_BAD_CURSOR_SIZE, req->wid);
 		return;
+	}
 
-	GsPutCh(current_fd, GrRetSendData);
+	bitmapsize = GR_BITMAP_SIZE(req->width, req->height);
 
-	if(GsRead(current_fd, &y, sizeof(y)))
+	if(!GsCheckLength(req, sizeof(*req), 2L * bitmapsize * sizeof(GR_BITMAP)))
 		return;
 
-	GsMoveCursor(x, y);
+	GsSetCursor(req->wid, req->width, req->height, req->hotx, req->hoty,
+		req->foreground, req->background, bitmaps, bitmaps + bitmapsize);
+}
+
+void GsMoveCursorWrapper(void *r)
+{
+	GR_REQ_ID_XY *req = r;
 
-	GsPutCh(current_fd, GrRetOK);
+	GsMoveCursor(req->x, req->y);
 }
 
 /*
  * This is an array containing pointers to all of the above wrappers, in the same order as
  * the GrNum* #defines in nano-X.h. All the parser has to do is range check the function
- * number it gets from the client, and then call the relevant array member. The wrappers
- * do the work of reading the arguments and parsing them into the correct types and structures,
- * call the server functions themselves, then return any relevant data to the client.
+ * number of each request it gets from the client, and then call the relevant array member.
+ * The wrappers take the arguments from the request, call the server functions themselves,
+ * then return any relevant data to the client.
  */
 
 struct GrFunction {
-	void (*func)(void);
+	void (*func)(void *);
 	GR_FUNC_NAME name;
 } GrFunctions[] = {
 	{GsOpenWrapper, "GsOpen"},
@@ -1347,6 +557,7 @@ int GsOpenSocket(void)
 {
 	struct stat s;
 	struct sockaddr_un sckt;
+	int i;
 #ifndef SUN_LEN
 #define SUN_LEN(ptr)	((size_t) (((struct sockaddr_un *) 0)->sun_path) \
 		      		+ strlen ((ptr)->sun_path))
@@ -1372,6 +583,10 @@ int GsOpenSocket(void)
 	/* Start listening on the socket: */
 	if(listen(un_sock, 5) == -1)
 		return -1;
+
+	/* Larger receive buffer for client requests, inherited on accept: */
+	i = GR_SOCKET_RCVBUF;
+	setsockopt(un_sock, SOL_SOCKET, SO_RCVBUF, &i, sizeof(i));
 	return 1;
 }
 
@@ -1485,23 +700,105 @@ int GsWrite(int fd, void *buf, int c)
 	return 0;
 }
 
+/*
+ * Call the wrapper for a request from the current client.
+ */
+static void GsDispatch(GR_REQ_HEADER *hp)
+{
+	if(hp->type >= GrTotalNumCalls) {
+		GsPutCh(current_fd, GrRetENoFunction);
+		return;
+	}
+	curfunc = GrFunctions[hp->type].name;
+/*printf("HandleClient %s\r\n", curfunc);*/
+	GrFunctions[hp->type].func(hp);
+}
+
+/*
+ * Finish a request too large for the request buffer, of which n bytes
+ * have been read into the buffer at hp. The rest is read straight from
+ * the client into a block of its own. Returns -1 if the client is gone.
+ */
+static int GsHandleLargeRequest(GR_CLIENT *client, GR_REQ_HEADER *hp, int n)
+{
+	char *req;
+	int len = hp->length;
+
+	if(!(req = malloc(len))) {
+		GsError(GR_ERROR_MALLOC_FAILED, 0);
+		/* throw the request away */
+		while(n < len) {
+			int c = len - n;
+			if(c > GR_REQ_BUFSIZE) c = GR_REQ_BUFSIZE;
+			if(GsRead(client->id, client->reqbuf, c))
+				return -1;
+			n += c;
+		}
+		return 0;
+	}
+
+	memcpy(req, hp, n);
+	if(GsRead(client->id, req + n, len - n)) {
+		free(req);
+		return -1;
+	}
+
+	GsDispatch((GR_REQ_HEADER *) req);
+	free(req);
+
+	return 0;
+}
+
 /*
  * This function is used to parse and dispatch requests from the clients.
+ * As many requests as are waiting are read into the client's request buffer
+ * and all the complete ones are done, a partial request at the end is kept
+ * for the next time.
  */
 void GsHandleClient(int fd)
 {
-	unsigned char c;
+	GR_CLIENT *client;
+	GR_REQ_HEADER *hp;
+	char *req;
+	int n;
+
+	if(!(client = GsFindClient(fd)))
+		return;
 
 	current_fd = fd;
 
-	if(GsRead(fd, &c, 1))
+	n = read(fd, client->reqbuf + client->reqlen, GR_REQ_BUFSIZE - client->reqlen);
+	if(n <= 0) {
+		GsClose();
 		return;
+	}
+	client->reqlen += n;
 
-	if(c >= GrTotalNumCalls) {
-		GsPutCh(fd, GrRetENoFunction);
-	} else {
-		curfunc = GrFunctions[c].name;
-/*printf("HandleClient %s\r\n", curfunc);*/
-		GrFunctions[c].func();
+	req = client->reqbuf;
+	while((n = client->reqbuf + client->reqlen - req) >= sizeof(GR_REQ_HEADER)) {
+		hp = (GR_REQ_HEADER *) req;
+		if(hp->length < sizeof(GR_REQ_HEADER)) {
+			printf("GsHandleClient: bad request length %d\r\n", hp->length);
+			GsClose();
+			return;
+		}
+		if(hp->length > n) {
+			if(hp->length <= GR_REQ_BUFSIZE)
+				break;
+			client->reqlen = 0;
+			GsHandleLargeRequest(client, hp, n);
+			return;
+		}
+
+		GsDispatch(hp);
+
+		/* the request may have closed the connection */
+		if(GsFindClient(fd) != client)
+			return;
+		req += hp->length;
 	}
+
+	client->reqlen = n;
+	if(n && req != client->reqbuf)
+		memmove(client->reqbuf, req, n);
 }
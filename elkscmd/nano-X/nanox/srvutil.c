@@ -7,6 +7,7 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include "serv.h"
 
@@ -25,6 +26,8 @@ extern PSD psd;	/* temporary*/
 #define	GAPVAL(leftgap, rightgap, topgap, bottomgap) \
 	(((leftgap) << 3) + ((rightgap) << 2) + ((topgap) << 1) + (bottomgap))
 
+static void GsSaveClip(GR_WINDOW *wp, CLIPRECT *cliprects, GR_COUNT count);
+
 
 /*
  * Unmap the window to make it and its children invisible on the screen.
@@ -44,8 +47,7 @@ void GsWpUnmapWindow(GR_WINDOW *wp)
 		return;
 	}
 
-	if (wp == clipwp)
-		clipwp = NULL;
+	GsForgetClip();
 
 	wp->unmapcount++;
 
@@ -107,6 +109,7 @@ void GsWpMapWindow(GR_WINDOW *wp)
 		wp->unmapcount--;
 
 	if (wp->unmapcount == 0) {
+		GsForgetClip();
 		GsCheckMouseWindow();
 		GsCheckFocusWindow();
 		GsCheckCursor();
@@ -202,8 +205,8 @@ void GsWpDestroyWindow(GR_WINDOW *wp)
 	 * Forget various information if they related to this window.
 	 * Then finally free the structure.
 	 */
-	if (wp == clipwp)
-		clipwp = NULL;
+	GsForgetClip();
+	free(wp->cliprects);
 	if (wp == grabbuttonwp)
 		grabbuttonwp = NULL;
 	if (wp == cachewp) {
@@ -351,6 +354,7 @@ void GsDrawBorder(GR_WINDOW *wp)
 	wp->height += (bs * 2);
 	wp->bordersize = 0;
 
+	wp->clipstamp = 0;
 	clipwp = NULL;
 	GsSetClipWindow(wp);
 	curgcp = NULL;
@@ -378,6 +382,7 @@ void GsDrawBorder(GR_WINDOW *wp)
 	wp->width -= (bs * 2);
 	wp->height -= (bs * 2);
 	wp->bordersize = bs;
+	wp->clipstamp = 0;
 	clipwp = NULL;
 }
 
@@ -584,10 +589,13 @@ GR_WINDOW *GsPrepareWindow(GR_WINDOW_ID wid)
  * this one are the siblings of each direct ancestor which are higher
  * in priority than those ancestors.  Also, each parent limits the visible
  * area of the window.  The clipping is not done if it is already up to
- * date of if the window is not outputtable.
+ * date of if the window is not outputtable.  The rectangles are kept with
+ * the window, and only recomputed when the clipstamp shows that a window
+ * has been mapped, unmapped, moved or restacked since.
  */
 void GsSetClipWindow(GR_WINDOW *wp)
 {
+	GR_WINDOW	*clipwin;	/* window being clipped */
 	GR_WINDOW	*pwp;		/* parent window */
 	GR_WINDOW	*sibwp;		/* sibling windows */
 	CLIPRECT	*clip;		/* first clip rectangle */
@@ -608,6 +616,12 @@ void GsSetClipWindow(GR_WINDOW *wp)
 
 	clipwp = wp;
 
+	if (wp->clipstamp == clipstamp) {
+		GdSetClipRects(wp->clipcount, wp->cliprects);
+		return;
+	}
+	clipwin = wp;
+
 	/*
 	 * Start with the rectangle for the complete window.
 	 * We will then cut pieces out of it as needed.
@@ -654,6 +668,7 @@ void GsSetClipWindow(GR_WINDOW *wp)
 	 * set the clipping region to indicate that.
 	 */
 	if ((clip->width <= 0) || (clip->height <= 0)) {
+		GsSaveClip(clipwin, cliprects, 1);
 		GdSetClipRects(1, cliprects);
 		return;
 	}
@@ -702,7 +717,8 @@ void GsSetClipWindow(GR_WINDOW *wp)
 		clip->width = -1;
 		clip->height = -1;
 		count = 1;
-	}
+	} else
+		GsSaveClip(clipwin, cliprects, count);
 
 	/*
 	 * Set the clip rectangles.
@@ -710,6 +726,45 @@ void GsSetClipWindow(GR_WINDOW *wp)
 	GdSetClipRects(count, (CLIPRECT *)cliprects);
 }
 
+/*
+ * Remember the clip rectangles computed for a window.  If there is no
+ * memory for them the window is simply left uncached.
+ */
+static void GsSaveClip(GR_WINDOW *wp, CLIPRECT *cliprects, GR_COUNT count)
+{
+	CLIPRECT	*rp;		/* saved rectangles */
+
+	if (count > wp->clipcount || wp->cliprects == NULL) {
+		rp = (CLIPRECT *) realloc(wp->cliprects,
+			count * sizeof(CLIPRECT));
+		if (rp == NULL) {
+			wp->clipstamp = 0;
+			return;
+		}
+		wp->cliprects = rp;
+	}
+	memcpy(wp->cliprects, cliprects, count * sizeof(CLIPRECT));
+	wp->clipcount = count;
+	wp->clipstamp = clipstamp;
+}
+
+/*
+ * Invalidate the clip rectangles of all windows, after a change to the
+ * window configuration.  The clipstamp is only zero for windows with no
+ * cache, so on wraparound all the caches are marked stale.
+ */
+void GsForgetClip(void)
+{
+	GR_WINDOW	*wp;		/* window being reset */
+
+	clipwp = NULL;
+	if (++clipstamp == 0) {
+		for (wp = listwp; wp; wp = wp->next)
+			wp->clipstamp = 0;
+		clipstamp = 1;
+	}
+}
+
 /*
  * Check the specified clip rectangle against the specified rectangular
  * region, and reduce it or split it up into multiple clip rectangles
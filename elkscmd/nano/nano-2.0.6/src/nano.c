@@ -659,6 +659,12 @@ void window_init(void)
     bottomwin = newwin(3 - no_help(), COLS, editwinrows + (2 -
 	no_more_space()), 0);
 
+#ifdef ELKS
+    /* Let ncurses scroll the edit window with insert and delete line
+     * instead of redrawing it, which is slow over a serial line. */
+    idlok(edit, TRUE);
+#endif
+
     /* Turn the keypad on for the windows, if necessary. */
     if (!ISSET(REBIND_KEYPAD)) {
 	keypad(topwin, TRUE);
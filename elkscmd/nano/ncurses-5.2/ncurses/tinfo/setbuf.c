@@ -111,7 +111,12 @@ void _nc_set_buffer(FILE *ofp, bool buffered)
 
 	fflush(ofp);
 	if ((SP->_buffered = buffered) != 0) {
+#ifdef ELKS
+		/* room for a full redraw with attributes in one write */
+		buf_len = min(LINES * (COLS + 16), 4096);
+#else
 		buf_len = min(LINES * (COLS + 6), 2800);
+#endif
 	 	if ((buf_ptr = SP->_setbuf) == 0) {
 			if ((buf_ptr = typeMalloc(char, buf_len)) == NULL)
 				return;
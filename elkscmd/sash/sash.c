@@ -11,6 +11,7 @@
 
 #include <signal.h>
 #include <errno.h>
+#include <spawn.h>
 #include <pwd.h>
 #include <grp.h>
 
@@ -581,41 +582,58 @@ runcmd(char *cmd, int argc, char **argv)
 	}
 
 	/*
-	 * No magic characters in the command, so do the exec ourself.
-	 * Fork not required if sh -c.
+	 * No magic characters in the command, so spawn the program ourself,
+	 * without copying our data segment. Exec directly if sh -c.
 	 * If the exec fails with ENOEXEC, then run the
 	 * shell anyway since it might be a shell script.
 	 */
 	if (cflag == 0) {
-		pid = vfork();
+		posix_spawn_file_actions_t fa;
+		char *shargv[4];
 
-		if (pid < 0) {
-			perror("fork failed");
+		/* close any extra file descriptors we have opened */
+		posix_spawn_file_actions_init(&fa);
+#ifdef CMD_SOURCE
+		for (ret = sourcecount; --ret >= 0; ) {
+			if (sourcefiles[ret] != stdin)
+				posix_spawn_file_actions_addclose(&fa, fileno(sourcefiles[ret]));
+		}
+#endif
+		ret = posix_spawnp(&pid, argv[0], &fa, NULL, argv, environ);
+		if (ret == ENOEXEC) {
+			shargv[0] = "sh";
+			shargv[1] = "-c";
+			shargv[2] = cmd;
+			shargv[3] = NULL;
+			ret = posix_spawn(&pid, "/bin/sh", &fa, NULL, shargv, environ);
+		}
+		posix_spawn_file_actions_destroy(&fa);
+		if (ret) {
+			errno = ret;
+			perror(argv[0]);	/* Usually 'No such file or directory'*/
 			return;
 		}
 
-		if (pid) {
-			status = 0;
-			intcrlf = FALSE;
+		status = 0;
+		intcrlf = FALSE;
 
-			while ((ret = waitpid(pid, &status, 0)) != pid)
-				continue;
+		while ((ret = waitpid(pid, &status, 0)) != pid)
+			continue;
 
-			intcrlf = TRUE;
-			if ((status & 0xff) == 0)
-				return;
+		intcrlf = TRUE;
+		if ((status & 0xff) == 0)
+			return;
 
-			fprintf(stderr, "pid %d: %s (signal %d)\n", pid,
-				(status & 0x80) ? "core dumped" :
-				(((status & 0x7f) == SIGTSTP)? "stopped" : "killed"),
-				status & 0x7f);
+		fprintf(stderr, "pid %d: %s (signal %d)\n", pid,
+			(status & 0x80) ? "core dumped" :
+			(((status & 0x7f) == SIGTSTP)? "stopped" : "killed"),
+			status & 0x7f);
 
-			return;
-		}
+		return;
 	}
 
 	/*
-	 * We are the child or run as sh -c, so run the program.
+	 * We are run as sh -c, so run the program.
 	 * First close any extra file descriptors we have opened.
 	 */
 #ifdef CMD_SOURCE
@@ -627,13 +645,6 @@ runcmd(char *cmd, int argc, char **argv)
 
 	execvp(argv[0], argv);
 
-	/*
-	 * If file has access but didn't execute, guess it's a shell script
-	 * and run 'sh -c cmd'.
-	 */
-	if (errno == ENOEXEC && !cflag)
-		execl("/bin/sh", "sh", "-c", cmd, (char*)0);
-
 	perror(argv[0]);	/* Usually 'No such file or directory'*/
 	exit(1);
 }
@@ -73,9 +73,11 @@ static char GlobalAttr, TmpAttr, GlobalCharset, TmpCharset;
 static char *OldImage, *OldAttr, *OldFont;
 static int last_x, last_y;
 static struct win *curr;
+static struct win *shown;       /* window the terminal shows, if known */
 static int display = 1;
+static int redisplay;           /* terminal is in TmpAttr, not GlobalAttr */
 static int StrCost;
-static int UPcost, DOcost, LEcost, NDcost, CRcost, IMcost, EIcost;
+static int UPcost, DOcost, LEcost, NDcost, CRcost, IMcost, EIcost, CEcost;
 static int tcLineLen = 100;
 static char *null;
 static int StatLen;
@@ -211,6 +213,7 @@ InitTerm(void)
     CRcost = CalcCost(CR);
     IMcost = CalcCost(IM);
     EIcost = CalcCost(EI);
+    CEcost = CalcCost(CE);
     PutStr(IS);
     PutStr(TI);
     PutStr(CL);
@@ -220,6 +223,7 @@ InitTerm(void)
 int
 FinitTerm(void)
 {
+    shown = 0;
     PutStr(TE);
     PutStr(IS);
     return 0;
@@ -359,11 +363,30 @@ Activate(struct win *wp)
     GlobalCharset = curr->charsets[curr->LocalCharset];
     if (CS)
         PutStr(tgoto(CS, curr->bot, curr->top));
-    Redisplay();
+    /*
+     * When switching from a window that is still on the terminal,
+     * only the differences need to be written.
+     */
+    if (shown && shown != wp)
+        RedisplayDiff(shown);
+    else
+        Redisplay();
+    shown = wp;
     KeypadMode(curr->keypad);
     return 0;
 }
 
+/*
+ * Called when a window is freed, so it is no longer used as the
+ * terminal contents.
+ */
+void
+ForgetWindow(struct win *wp)
+{
+    if (wp == shown)
+        shown = 0;
+}
+
 int
 ResetScreen(struct win *p)
 {
@@ -1201,7 +1224,7 @@ DoCM:
 static int
 RewriteCost(int y, int x1, int x2)
 {
-    int cost, dx;
+    int cost, dx, a, c;
     char *p = curr->attr[y] + x1, *f = curr->font[y] + x1;
 
     if (AM && y == rows - 1 && x2 == cols - 1)
@@ -1211,8 +1234,10 @@ RewriteCost(int y, int x1, int x2)
         return 0;
     if (curr->insert)
         cost += EIcost + IMcost;
+    a = redisplay ? TmpAttr : GlobalAttr;
+    c = redisplay ? TmpCharset : GlobalCharset;
     do {
-        if (*p++ != GlobalAttr || *f++ != GlobalCharset)
+        if (*p++ != a || *f++ != c)
             return EXPENSIVE;
     } while (--dx);
     return cost;
@@ -1822,10 +1847,12 @@ Redisplay(void)
     TmpAttr = GlobalAttr;
     TmpCharset = GlobalCharset;
     InsertMode(0);
+    redisplay = 1;
     last_x = last_y = 0;
     for (i = 0; i < rows; ++i)
         DisplayLine(blank, null, null, curr->image[i], curr->attr[i],
                     curr->font[i], i, 0, cols - 1);
+    redisplay = 0;
     if (curr->insert)
         InsertMode(1);
     NewRendition(TmpAttr, GlobalAttr);
@@ -1834,6 +1861,61 @@ Redisplay(void)
     return 0;
 }
 
+/*
+ * Redisplay the current window over the window ow, which the terminal
+ * shows now.  Only the changed runs of each line are written, and the
+ * end of a line is cleared with CE when that is cheaper.
+ */
+static void
+RedisplayDiff(struct win *ow)
+{
+    int i;
+
+    TmpAttr = GlobalAttr;
+    TmpCharset = GlobalCharset;
+    InsertMode(0);
+    redisplay = 1;
+    last_x = last_y = -1;
+    for (i = 0; i < rows; ++i)
+        DiffLine(ow->image[i], ow->attr[i], ow->font[i], i);
+    redisplay = 0;
+    if (curr->insert)
+        InsertMode(1);
+    NewRendition(TmpAttr, GlobalAttr);
+    NewCharset(TmpCharset, GlobalCharset);
+    Goto(last_y, last_x, curr->y, curr->x);
+}
+
+static void
+DiffLine(char *os, char *oa, char *of, int y)
+{
+    char *s = curr->image[y], *as = curr->attr[y], *fs = curr->font[y];
+    int to, x, n;
+
+    for (to = cols - 1; to >= 0; --to)
+        if (s[to] != ' ' || as[to] || fs[to] != ASCII)
+            break;
+    n = 0;
+    if (CE) {
+        for (x = to + 1; x < cols; ++x)
+            if (os[x] != ' ' || oa[x] || of[x] != ASCII)
+                ++n;
+    }
+    if (n <= CEcost) {
+        DisplayLine(os, oa, of, s, as, fs, y, 0, cols - 1);
+        return;
+    }
+    DisplayLine(os, oa, of, s, as, fs, y, 0, to);
+    Goto(last_y, last_x, y, to + 1);
+    last_y = y;
+    last_x = to + 1;
+    if (TmpAttr) {
+        NewRendition(TmpAttr, 0);
+        TmpAttr = 0;
+    }
+    PutStr(CE);
+}
+
 static void
 DisplayLine(char *os, char *oa, char *of, char *s, char *as, char *fs, int y, int from, int to)
 {
@@ -1846,8 +1928,7 @@ DisplayLine(char *os, char *oa, char *of, char *s, char *as, char *fs, int y, in
     a = TmpAttr;
     f = TmpCharset;
     for (x = i = from; i <= to; ++i, ++x) {
-        if (s[i] == os[i] && as[i] == oa[i] && as[i] == a
-            && of[i] == fs[i] && fs[i] == f)
+        if (s[i] == os[i] && as[i] == oa[i] && of[i] == fs[i])
             continue;
         Goto(last_y, last_x, y, x);
         last_y = y;
@@ -1876,8 +1957,10 @@ RedisplayLine(char *os, char *oa, char *of, int y, int from, int to)
     TmpCharset = ASCII;
     last_y = y;
     last_x = from;
+    redisplay = 1;
     DisplayLine(os, oa, of, curr->image[y], curr->attr[y],
                 curr->font[y], y, from, to);
+    redisplay = 0;
     NewRendition(TmpAttr, GlobalAttr);
     NewCharset(TmpCharset, GlobalCharset);
     if (curr->insert)
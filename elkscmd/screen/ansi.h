@@ -64,10 +64,13 @@ static int SaveAttr(int newattr);
 static int RestoreAttr(int oldattr);
 static int FillWithEs(void);
 static int Redisplay(void);
+static void RedisplayDiff(struct win *ow);
+static void DiffLine(char *os, char *oa, char *of, int y);
 static void RedisplayLine(char *os, char *oa, char *of, int y, int from, int to);
 static int MakeBlankLine(char *p, int n);
 
 int Activate(struct win *wp);
+void ForgetWindow(struct win *wp);
 int ResetScreen(struct win *p);
 void WriteString(struct win *wp, char *buf, int len);
 void DoESC(int c, int intermediate);
@@ -815,6 +815,7 @@ FreeWindow(struct win *wp)
 {
     int i;
 
+    ForgetWindow(wp);
     RemoveUtmp(wp->slot);
     chmod(wp->tty, 0666);
     chown(wp->tty, 0, 0);
@@ -65,7 +65,7 @@ int do_args(int argc, char ** argv)
 		for (j = 1; j < strlen(argv[i]); j++) {
 			switch (argv[i][j]) {
 				case 'c':
-					complement1 = 1; /* TODO implement */
+					complement1 = 1;
 					break;
 				case 's':
 					squeeze = 1;
@@ -214,12 +214,75 @@ again:
 	return buf;
 }
 
+/*
+ *
+ * build_tables()
+ *
+ * Turn the sets into per character tables, so each input character
+ * costs a lookup rather than a search of the sets.
+ *
+ * unsigned char * set1;	First set, already padded or truncated.
+ * unsigned char * set2;	Second set or NULL.
+ *
+ */
+
+#define T_DELETE	1	/* delete character */
+#define T_SQUEEZE	2	/* squeeze repeats of character */
+
+unsigned char xlate[256];	/* translation of each character */
+unsigned char flags[256];	/* T_ flags of each character */
+
+void build_tables(unsigned char * set1, unsigned char * set2)
+{
+	unsigned char in1[256];
+	unsigned char * sq;
+	int c, i, len2;
+
+	memset(in1, 0, sizeof(in1));
+	for (i = 0; set1[i]; i++)
+		in1[set1[i]] = 1;
+	if (complement1) {
+		for (c = 0; c < 256; c++)
+			in1[c] = !in1[c];
+	}
+	for (c = 0; c < 256; c++) {
+		xlate[c] = c;
+		flags[c] = (delete && in1[c])? T_DELETE: 0;
+	}
+
+	if (set2 && !delete) {
+		if (complement1) {
+			/* characters not in set1 map in order onto set2 */
+			len2 = strlen((char *)set2);
+			for (c = 0, i = 0; c < 256; c++) {
+				if (in1[c] && len2)
+					xlate[c] = set2[i < len2? i++: len2 - 1];
+			}
+		} else {
+			/* first occurrence in set1 wins, as strchr found */
+			for (i = strlen((char *)set1); --i >= 0; )
+				xlate[set1[i]] = set2[i];
+		}
+	}
+
+	if (squeeze) {
+		if (set2) {
+			for (sq = set2; *sq; sq++)
+				flags[*sq] |= T_SQUEEZE;
+		} else {
+			for (c = 0; c < 256; c++)
+				if (in1[c]) flags[c] |= T_SQUEEZE;
+		}
+	}
+}
+
 int main(int argc, char ** argv)
 {
-	int num_args, i, lchar = 0;
+	int num_args, i, n, lchar = -1;
 	char * set1, * set2;
-	char * ip;
 	int len1, len2;
+	static unsigned char ibuf[1024], obuf[1024];
+	unsigned char * ip, * iend, * op;
 
 	progname = argv[0];
 	num_args = do_args(argc, argv);
@@ -234,7 +297,7 @@ int main(int argc, char ** argv)
 		len2 = 0;
 	}
 	/* printf("{%d,%d}",len1,len2); */
-	if (set2 && len1 > len2) {
+	if (set2 && len1 > len2 && !complement1) {
 		if (truncate1) {
 			set1[len2] = '\0';
 		} else {
@@ -248,27 +311,22 @@ int main(int argc, char ** argv)
 	}
 	/* printf("String 1 = %s\n", set1);
 	printf("String 2 = %s\n", set2); */
-	while ((i = getchar()) != EOF) {
-		if (delete) {
-			if ((ip = strchr(set1, i)) != NULL) {
-				i = 0;
-			}
-		} else if (set2) {
-			if ((ip = strchr(set1, i)) != NULL) {
-				i = ip - set1;
-				ip = set2 + i;
-				i = *ip;
-			}
-		}
-		if (squeeze) {
-			if ((set2 && ((ip = strchr(set2, i)) != NULL)) ||
-			   (!set2 && ((ip = strchr(set1, i)) != NULL))) {
-				if (i == lchar) i = 0;
-			}
-		}
-		if (i) {
+	build_tables((unsigned char *)set1, (unsigned char *)set2);
+
+	while ((n = read(0, ibuf, sizeof(ibuf))) > 0) {
+		op = obuf;
+		for (ip = ibuf, iend = ibuf + n; ip < iend; ip++) {
+			if (flags[*ip] & T_DELETE)
+				continue;
+			i = xlate[*ip];
+			if ((flags[i] & T_SQUEEZE) && i == lchar)
+				continue;
 			lchar = i;
-			putchar(i);
+			*op++ = i;
+		}
+		if (op > obuf && write(1, obuf, op - obuf) != op - obuf) {
+			perror("write");
+			exit(1);
 		}
 	}
 	exit(0);
@@ -21,25 +21,34 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <string.h>
+#include <fcntl.h>
+#include <linuxmt/minix.h>
 
-#define MAX_ARGS 20
 #define MAX_IARGS 10
-#define MAX_CHARS 255
+#define MAX_CHARS 4096		/* default argument space used per command */
+#define MIN_CHARS 1024		/* used if the command's header can't be read */
+#define MAX_PROCS 8
 
 #define DEFAULT_CMD "/bin/echo"
 
 #define errmsg(str) write(STDERR_FILENO, str, sizeof(str) - 1)
 #define errstr(str) write(STDERR_FILENO, str, strlen(str))
 
-int max_args = MAX_ARGS;
-int max_chars = MAX_CHARS;	/* Not yet implemented */
+int max_args = 0;		/* 0 is no limit but max_chars */
+unsigned int max_chars = 0;	/* 0 is MAX_CHARS */
+int max_procs = 1;
 
 /* Command to run if none specified */
 char * default_cmd = DEFAULT_CMD;
 
 /* New arguments for programs */
 int nargc;
-char * nargv[MAX_ARGS + MAX_IARGS + 2];
+char ** nargv;
+char * argbuf;			/* strings of nargv after the initial arguments */
+char * tokbuf;			/* argument being read */
+
+int running;			/* children not yet waited for */
+int status;			/* exit status of xargs */
 
 /*
  *
@@ -51,7 +60,7 @@ char * nargv[MAX_ARGS + MAX_IARGS + 2];
 
 void usage(char ** argv)
 {
-	errmsg("xargs [-n max-args] [-s max-chars] [command [initial-arguments]]\n");
+	errmsg("xargs [-n max-args] [-s max-chars] [-P max-procs] [command [initial-arguments]]\n");
 	exit(1);
 }
 
@@ -89,6 +98,12 @@ int do_args(int argc, char ** argv)
 						max_chars = atoi(argv[i+k]);
 					}
 					break;
+				case 'P':
+					k++;
+					if ((i + k) < argc) {
+						max_procs = atoi(argv[i+k]);
+					}
+					break;
 				default:
 					usage(argv);
 			}
@@ -96,96 +111,237 @@ int do_args(int argc, char ** argv)
 		i += k;
 		i++;
 	}
-	if (max_args > MAX_ARGS) {
-		max_args = MAX_ARGS;
+	if (max_args < 0) {
+		max_args = 0;
+	}
+	if (max_procs < 1) {
+		max_procs = 1;
 	}
-	if (max_chars > MAX_CHARS) {
-		max_chars = MAX_CHARS;
+	if (max_procs > MAX_PROCS) {
+		max_procs = MAX_PROCS;
 	}
 	return i;
 }
 
+/*
+ *
+ * exec_limit()
+ *
+ * Find the argument and environment space, the slen of sys_execve,
+ * that the command's data segment leaves room for. This follows the
+ * sizing in sys_execve: the data segment holds data, bss, stack,
+ * heap and the arguments, and may not exceed 0xFFF0 bytes.
+ *
+ * char * cmd;		Command name, searched for on PATH as execvp would.
+ *
+ * RETURN		Space in bytes, or 0 if the header can't be read.
+ *
+ */
+
+unsigned int exec_limit(char * cmd)
+{
+	struct minix_exec_hdr mh;
+	struct elks_supl_hdr esuph;
+	char path[128];
+	char * dirs, * end;
+	unsigned long len, stack, heap, limit;
+	int fd = -1, n;
+
+	if (strchr(cmd, '/')) {
+		fd = open(cmd, O_RDONLY);
+	} else {
+		if ((dirs = getenv("PATH")) == NULL) {
+			dirs = "/bin:/usr/bin";
+		}
+		for (; fd < 0 && *dirs; dirs = *end? end + 1: end) {
+			if ((end = strchr(dirs, ':')) == NULL) {
+				end = dirs + strlen(dirs);
+			}
+			n = end - dirs;
+			if (n + strlen(cmd) + 2 > sizeof(path)) {
+				continue;
+			}
+			if (n == 0) {
+				strcpy(path, cmd);
+			} else {
+				memcpy(path, dirs, n);
+				path[n] = '/';
+				strcpy(path + n + 1, cmd);
+			}
+			if (access(path, X_OK) == 0) {
+				fd = open(path, O_RDONLY);
+			}
+		}
+	}
+	if (fd < 0) {
+		return 0;
+	}
+	memset(&esuph, 0, sizeof(esuph));
+	n = read(fd, &mh, sizeof(mh));
+	if (n == sizeof(mh) && mh.hlen > sizeof(mh) &&
+	    mh.hlen - sizeof(mh) <= sizeof(esuph)) {
+		n += read(fd, &esuph, mh.hlen - sizeof(mh));
+	}
+	close(fd);
+	if (n != sizeof(mh) && n != mh.hlen) {
+		return 0;
+	}
+	if (mh.type != MINIX_SPLITID && mh.type != MINIX_SPLITID_AHISTORICAL) {
+		return 0;
+	}
+
+	len = mh.dseg + mh.bseg + esuph.msh_dbase;
+	if (mh.version == 1) {
+		stack = esuph.msh_dbase? 0: (mh.minstack? mh.minstack: INIT_STACK);
+		heap = mh.chmem? mh.chmem: INIT_HEAP;
+		len += stack;
+		if (heap < 0xFFF0) {
+			len += heap;
+		}
+		limit = 0xFFF0;
+	} else if (mh.chmem) {
+		limit = mh.chmem;	/* all of data, bss, heap and stack */
+	} else {
+		len += INIT_HEAP + INIT_STACK;
+		limit = 0xFFF0;
+	}
+	return (len < limit)? limit - len: 0;
+}
+
 /*
  *
  * build_cmd()
  *
  * Build the initial portion of the argv array to be used to run
- * commands from the command line arguments given for xargs.
+ * commands from the command line arguments given for xargs, and
+ * size the space left for arguments read from standard input.
  *
  * int argc;		Number of arguments left.
  * char ** argv;	Pointer to the first item in main()'s argv for us.
  *
+ * RETURN		Argument bytes left, counting a pointer for each.
+ *
  */
 
-void build_cmd(int argc, char ** argv)
+static void out_of_mem()
 {
+	errmsg("xargs: out of memory\n");
+	exit(1);
+}
+
+unsigned int build_cmd(int argc, char ** argv)
+{
+	char ** p;
+	unsigned int limit, used, bytes;
 	int i;
 
-	if (argc > (MAX_IARGS + MAX_ARGS - max_args)) {
+	if (argc > MAX_IARGS) {
 		errmsg("xargs: Too many initial arguments.\n");
 		exit(1);
 	}
+
+	/* Space as execve lays it out: argc, argv and envp with their NULLs */
+	used = 3 * sizeof(char *);
+	for (p = environ; p && *p; p++) {
+		used += strlen(*p) + 1 + sizeof(char *);
+	}
+	for (i = 0; i < argc; i++) {
+		used += strlen(argv[i]) + 1 + sizeof(char *);
+	}
+
+	limit = exec_limit(argv[0]);
+	if (limit == 0) {
+		limit = MIN_CHARS;
+	}
+	if (limit > (max_chars? max_chars: MAX_CHARS)) {
+		limit = max_chars? max_chars: MAX_CHARS;
+	}
+	if (limit <= used + 2 * (sizeof(char *) + 2)) {
+		errmsg("xargs: argument list too long\n");
+		exit(1);
+	}
+	bytes = limit - used;
+
+	i = bytes / (sizeof(char *) + 2);	/* most args that could fit */
+	if (max_args && max_args < i) {
+		i = max_args;
+	}
+	nargv = malloc((argc + i + 1) * sizeof(char *));
+	argbuf = malloc(bytes);
+	tokbuf = malloc(bytes);
+	if (nargv == NULL || argbuf == NULL || tokbuf == NULL) {
+		out_of_mem();
+	}
+	max_args = i;
 	for (i = 0; i < argc; i++)
 		nargv[i] = argv[i];
 	nargc += argc;
-}
-
-#define BSIZE 64
-static void out_of_mem()
-{
-	errmsg("xargs: out of memory\n");
-	exit(1);
+	return bytes;
 }
 
 /*
  * next_token()
  *
- * Read standard in and get the next argument.
- * Returns NULL on end of file.
+ * Read standard in and get the next argument into buf.
+ *
+ * char * buf;		Where to put the argument.
+ * int size;		Size of buf.
+ *
+ * RETURN		Length of the argument, or -1 on end of file.
  *
  */
 
-char * next_token()
+int next_token(char * buf, int size)
 {
-	int size = BSIZE;
 	int tail = 0;
-	char * buf = malloc(BSIZE);
 
-	if (buf == NULL) {
-		out_of_mem();
-	}
 	for (;;) {
-		int inp = fgetc(stdin);
+		int inp = getc(stdin);
 		switch (inp) {
 			case EOF:
 				if (tail != 0) {
 					buf[tail] = '\0';
-				} else {
-					free(buf);
-					buf = NULL;
+					return tail;
 				}
-				return buf;
-				break;
+				return -1;
 			case ' ':
 			case '\t':
 			case '\n':
 				if (tail != 0) {
 					buf[tail] = '\0';
-					return buf;
+					return tail;
 				}
 				break;
 			default:
+				if (tail >= size - 1) {
+					errmsg("xargs: argument too long\n");
+					exit(1);
+				}
 				buf[tail++] = inp;
 				break;
 		}
-		if (tail >= size) {
-			size += BSIZE;
-			buf = realloc(buf, size);
-			if (buf == NULL) {
-				out_of_mem();
-			}
-		}
+	}
+}
 
+/*
+ *
+ * reap()
+ *
+ * Wait for a child to complete, noting if it failed.
+ *
+ */
+
+void reap(void)
+{
+	int st;
+
+	if (wait(&st) > 0) {
+		running--;
+		if (st) {
+			status = 123;
+		}
+	} else {
+		running = 0;
 	}
 }
 
@@ -193,11 +349,13 @@ char * next_token()
  *
  * run()
  *
- * Fork, exec and wait for the commant to complete.
+ * Fork and exec the command, waiting first if max_procs are running.
  *
  * Parameters are as for execvp.
  *
- * We use vfork as this is a good saving under elks.
+ * We use vfork as this is a good saving under elks. The parent
+ * resumes once the child has exec'd, so max_procs children can
+ * run at once.
  *
  */
 
@@ -205,6 +363,9 @@ void run(char * argv0, char ** argv)
 {
 	int pid;
 
+	while (running >= max_procs) {
+		reap();
+	}
 	pid = vfork();
 	switch (pid) {
 		case -1:
@@ -214,45 +375,51 @@ void run(char * argv0, char ** argv)
 		case 0:
 			break;
 		default:
-			wait(NULL);
+			running++;
 			return;
 	}
 	execvp(argv0, argv);
 	errstr(argv0);
 	errmsg(": cannot exec\n");
-	exit(1);
+	_exit(127);
 }
 
 int main(int argc, char ** argv)
 {
-	int num_args;
-	int new_argc;
-	char * tok = NULL;
+	unsigned int bytes, left;
+	int num_args, new_argc, len;
+	char * tok;
 
 	num_args = do_args(argc, argv);
 
 	if (num_args >= argc) {
-		build_cmd(1, &default_cmd);
+		bytes = build_cmd(1, &default_cmd);
 	} else {
-		build_cmd(argc - num_args, &argv[num_args]);
+		bytes = build_cmd(argc - num_args, &argv[num_args]);
 	}
 
-	do {
-		int i;
-
+	/* Pack each command with as many arguments as fit */
+	len = next_token(tokbuf, bytes - sizeof(char *));
+	while (len >= 0) {
 		new_argc = nargc;
-		while (new_argc < (nargc + max_args) &&
-		     (tok = next_token()) != NULL) {
+		tok = argbuf;
+		left = bytes;
+		do {
+			if (len + 1 + sizeof(char *) > left ||
+			    new_argc - nargc >= max_args) {
+				break;
+			}
+			memcpy(tok, tokbuf, len + 1);
 			nargv[new_argc++] = tok;
-		}
+			tok += len + 1;
+			left -= len + 1 + sizeof(char *);
+		} while ((len = next_token(tokbuf, bytes - sizeof(char *))) >= 0);
 		nargv[new_argc] = NULL;
-		if (nargc != new_argc) {
-			run(nargv[0], nargv);
-		}
-		for (i = nargc; i < new_argc; i++) {
-			free(nargv[i]);
-		}
-	} while (tok != NULL);
+		run(nargv[0], nargv);
+	}
+	while (running) {
+		reap();
+	}
 
-	return 0;
+	return status;
 }
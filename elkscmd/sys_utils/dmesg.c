@@ -0,0 +1,89 @@
+/*
+ * dmesg - print or control the kernel message buffer
+ *
+ *	dmesg [-r] [-n level]
+ *
+ * Reads the messages still held in the kernel log ring buffer from /dev/kmsg.
+ * Each line there starts with a level marker byte, which is removed, or
+ * shown as "<n>" with -r. -n sets the console log level: only messages of
+ * lower level than it are then printed on the console.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linuxmt/mem.h>
+
+#define KMSG_DEV	"/dev/kmsg"
+
+static char buf[1024];
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: dmesg [-r] [-n level]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int fd, n, i, c;
+	int raw = 0;
+	int level = -1;
+	char *p;
+
+	while ((c = getopt(argc, argv, "rn:")) != -1) {
+		switch (c) {
+		case 'r':
+			raw = 1;
+			break;
+		case 'n':
+			level = atoi(optarg);
+			if (level < 1 || level > 8)
+				usage();
+			break;
+		default:
+			usage();
+		}
+	}
+
+	fd = open(KMSG_DEV, O_RDONLY);
+	if (fd < 0) {
+		perror(KMSG_DEV);
+		return 1;
+	}
+
+	if (level > 0) {
+		if (ioctl(fd, MEM_SETLOGLEVEL, level) < 0) {
+			perror("dmesg");
+			return 1;
+		}
+		return 0;
+	}
+
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		p = buf;
+		for (i = 0; i < n; i++) {
+			if (!KLOG_ISMARK(buf[i]))
+				continue;
+			if (&buf[i] > p)
+				write(STDOUT_FILENO, p, &buf[i] - p);
+			if (raw) {
+				char lvl[3];
+				lvl[0] = '<';
+				lvl[1] = '0' + buf[i] - KLOG_MARK;
+				lvl[2] = '>';
+				write(STDOUT_FILENO, lvl, 3);
+			}
+			p = &buf[i + 1];
+		}
+		if (&buf[n] > p)
+			write(STDOUT_FILENO, p, &buf[n] - p);
+	}
+	if (n < 0) {
+		perror(KMSG_DEV);
+		return 1;
+	}
+	return 0;
+}
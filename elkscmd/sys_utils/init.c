@@ -36,6 +36,7 @@
 #include <time.h>
 #include <paths.h>
 #include <limits.h>
+#include <spawn.h>
 
 #define USE_UTMP	0	/* =1 to use /var/run/utmp*/
 #define DEBUG		0	/* =1 for debug messages*/
@@ -267,69 +268,56 @@ void removeChild(struct tabentry *pos)
 
 pid_t respawn(const char **a)
 {
-    int pid;
+    int ret;
+    pid_t pid;
     char *argv[5], buf[PATH_MAX];
-    int fd;
     char *devtty;
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
 
     if (a[3] == NULL || a[3][1] == '\0') return -1;
 
-    pid = fork();
-    if (pid == -1) fatalmsg("No fork (%d)\r\n", errno);
-    if (pid) debug("spawning %d '%s'\r\n", pid, a[3]);
-
-    if (0 == pid) {
-#if DEBUG
-	usleep(100000L);	/* allow init messages prior to ours*/
-#endif
-	setsid();
-	strcpy(buf, a[3]);
-	if (!strncmp(buf, GETTY, sizeof(GETTY)-1)) {
-	    char *baudrate;
-	    devtty = strchr(buf, ' ');
-
-	    if (!devtty) fatalmsg("Bad getty line: '%s'\r\n", buf);
-	    *devtty++ = 0;
-	    baudrate = strchr(devtty, ' ');
-	    if (baudrate)
-		*baudrate++ = 0;
-	    if ((fd = open(devtty, O_RDWR)) < 0)
-			fatalmsg("Can't open %s (errno %d)\r\n", devtty, errno);
-
-	    argv[0] = GETTY;
-	    argv[1] = devtty;
-	    argv[2] = baudrate;
-	    argv[3] = NULL;
-	    debug("execv '%s' '%s' '%s'\r\n", argv[0], argv[1], argv[2]);
-
-	    dup2(fd ,STDIN_FILENO);
-	    dup2(fd ,STDOUT_FILENO);
-	    dup2(fd ,STDERR_FILENO);
-	    if (fd > STDERR_FILENO)
-		close(fd);
-	    execv(argv[0], argv);
-	}
-	else
-	{
-	    if ((fd = open(CONSOLE, O_RDWR)) < 0)
-		fatalmsg("Can't open %s (errno %d)\r\n", CONSOLE, errno);
-
-	    argv[0] = SHELL;
-	    argv[1] = "-c";
-	    argv[2] = buf;
-	    argv[3] = NULL;
-	    debug("execv '%s' '%s' '%s'\r\n", argv[0], argv[1], argv[2]);
-
-	    dup2(fd ,STDIN_FILENO);
-	    dup2(fd ,STDOUT_FILENO);
-	    dup2(fd ,STDERR_FILENO);
-	    if (fd > STDERR_FILENO)
-		close(fd);
-	    execv(argv[0], argv);
-	}
-
-	fatalmsg("Exec failed: %s (errno %d)\r\n", argv[0], errno);
+    /* child runs in a new session, opening its tty as controlling terminal */
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+    posix_spawn_file_actions_init(&fa);
+
+    strcpy(buf, a[3]);
+    if (!strncmp(buf, GETTY, sizeof(GETTY)-1)) {
+	char *baudrate;
+	devtty = strchr(buf, ' ');
+
+	if (!devtty) fatalmsg("Bad getty line: '%s'\r\n", buf);
+	*devtty++ = 0;
+	baudrate = strchr(devtty, ' ');
+	if (baudrate)
+	    *baudrate++ = 0;
+
+	argv[0] = GETTY;
+	argv[1] = devtty;
+	argv[2] = baudrate;
+	argv[3] = NULL;
+    } else {
+	devtty = CONSOLE;
+	argv[0] = SHELL;
+	argv[1] = "-c";
+	argv[2] = buf;
+	argv[3] = NULL;
+    }
+    posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, devtty, O_RDWR, 0);
+    posix_spawn_file_actions_adddup2(&fa, STDIN_FILENO, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fa, STDIN_FILENO, STDERR_FILENO);
+    debug("spawn '%s' '%s' '%s'\r\n", argv[0], argv[1], argv[2]);
+
+    ret = posix_spawn(&pid, argv[0], &fa, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    if (ret) {
+	fprintf(stderr, "%s: Can't spawn %s on %s (errno %d)\r\n", initname,
+	    argv[0], devtty, ret);
+	return -1;
     }
+    debug("spawning %d '%s'\r\n", pid, a[3]);
 
 /* here I must do something about utmp */
     return pid;
@@ -26,11 +26,16 @@ int fflag;		/* show free memory*/
 int tflag;		/* show tty memory*/
 int bflag;		/* show buffer memory*/
 int allflag;	/* show all memory*/
+int cflag;		/* compact main memory first*/
+int sflag;		/* show heap usage summary by type*/
+int kflag;		/* show kernel event counters*/
+
+static char *heaptype[] = { "free", "SEG ", "STR ", "TTY ", "INT ", "BUFH", "PIPE", "EXEC", "SOCK" };
 
 unsigned int ds;
 unsigned int heap_all;
-unsigned int taskoff;
-struct task_struct task_table[MAX_TASKS];
+struct proc_snap procs[MAX_TASKS];
+int nprocs;
 
 int memread(int fd, word_t off, word_t seg, void *buf, int size)
 {
@@ -52,32 +57,25 @@ word_t getword(int fd, word_t off, word_t seg)
 	return word;
 }
 
-void process_name(int fd, unsigned int off, unsigned int seg)
+/* display only executable name for now */
+void process_name(struct proc_snap *p)
 {
-    word_t argc, argv;
-    char buf[80];
-
-    argc = getword(fd, off, seg);
-
-    while (argc-- > 0) {
-        off += 2;
-        argv = getword(fd, off, seg);
-        if (!memread(fd, argv, seg, buf, sizeof(buf)))
-            return;
-        printf("%s ",buf);
-        break;      /* display only executable name for now */
-    }
+    char *s = p->cmd;
+
+    while (*s && *s != ' ')
+        putchar(*s++);
+    putchar(' ');
 }
 
-int find_process(unsigned int seg)
+struct proc_snap *find_process(seg_t base)
 {
-    struct task_struct *t;
-    for (t = task_table; t < &task_table[MAX_TASKS]; t++) {
-        if ((unsigned)t->mm.seg_code == seg || (unsigned)t->mm.seg_data == seg) {
-            return t - task_table;
-        }
+    struct proc_snap *p;
+
+    for (p = procs; p < &procs[nprocs]; p++) {
+        if (p->cseg == base || p->dseg == base)
+            return p;
     }
-    return -1;
+    return NULL;
 }
 
 void dump_heap(int fd)
@@ -85,8 +83,8 @@ void dump_heap(int fd)
 	word_t total_size = 0;
 	word_t total_free = 0;
 	long total_segsize = 0;
-	static char *heaptype[] = { "free", "SEG ", "STR ", "TTY ", "INT ", "BUFH", "PIPE" };
-	static char *segtype[] = { "free", "CSEG", "DSEG", "BUF ", "RDSK", "PROG" };
+	static char *segtype[] = { "free", "CSEG", "DSEG", "BUF ", "RDSK", "PROG", "PIPE", "SOCK", "PROF",
+		"ROM ", "SHM " };
 
 	printf("  HEAP   TYPE  SIZE    SEG   TYPE    SIZE  CNT  NAME\n");
 
@@ -99,7 +97,8 @@ void dump_heap(int fd)
 		seg_t segbase;
 		segext_t segsize;
 		word_t segflags, ref_count;
-		int free, used, tty, buffer, t;
+		int free, used, tty, buffer;
+		struct proc_snap *p;
 
 		if (tag == HEAP_TAG_SEG)
 			segflags = getword(fd, mem + offsetof(segment_s, flags), ds) & SEG_FLAG_TYPE;
@@ -124,9 +123,8 @@ void dump_heap(int fd)
 				printf("   %4x   %s %7ld %4d  ",
                     segbase, segtype[segflags], (long)segsize << 4, ref_count);
                 if (segflags == SEG_FLAG_CSEG || segflags == SEG_FLAG_DSEG) {
-                    if ((t = find_process(mem)) >= 0) {
-			            process_name(fd, task_table[t].t_begstack, task_table[t].t_regs.ss);
-                    }
+                    if ((p = find_process(segbase)) != NULL)
+                        process_name(p);
                 }
 
 				total_segsize += (long)segsize << 4;
@@ -142,19 +140,82 @@ void dump_heap(int fd)
 	printf("  Heap/free   %5d/%5d Total mem %7ld\n", total_size, total_free, total_segsize);
 }
 
+void dump_heapstat(int fd)
+{
+	struct heap_stats hs;
+	int i;
+
+	if (ioctl(fd, MEM_GETHEAPSTAT, &hs)) {
+		perror("meminfo: heap stats");
+		return;
+	}
+	printf("  TYPE  COUNT   SIZE\n");
+	for (i = 0; i < HEAP_STAT_TYPES; i++) {
+		if (!hs.count[i])
+			continue;
+		if (i < sizeof(heaptype)/sizeof(heaptype[0]))
+			printf("  %s  %5u  %5u\n", heaptype[i], hs.count[i], hs.size[i]);
+		else printf("  %4d  %5u  %5u\n", i, hs.count[i], hs.size[i]);
+	}
+	printf("  Largest free heap block %u\n", hs.largest_free);
+}
+
+void dump_kstat(int fd)
+{
+	struct kernel_stats ks;
+	static unsigned long syscnt[SYSCNT_MAX];
+	unsigned long total;
+	int i, n;
+
+	if (ioctl(fd, MEM_GETKSTAT, &ks)) {
+		perror("meminfo: kernel stats");
+		return;
+	}
+	printf("  Context switches %lu\n", ks.context_switches);
+	printf("  IRQ  COUNT\n");
+	for (i = 0; i < KSTAT_IRQS; i++) {
+		if (ks.irqs[i])
+			printf("  %3d  %lu\n", i, ks.irqs[i]);
+	}
+	total = ks.buffer_hits + ks.buffer_misses;
+	printf("  Buffer reads %lu hits, %lu misses (%lu%%)\n",
+		ks.buffer_hits, ks.buffer_misses, total? ks.buffer_hits * 100 / total: 0L);
+	printf("  L1 buffers %lu maps, %lu remaps, %lu unmaps\n",
+		ks.buffer_maps, ks.buffer_remaps, ks.buffer_unmaps);
+	printf("  MAJOR  READS  WRITES\n");
+	for (i = 0; i < KSTAT_BLKDEV; i++) {
+		if (ks.blk_reads[i] || ks.blk_writes[i])
+			printf("  %5d  %5lu  %6lu\n", i, ks.blk_reads[i], ks.blk_writes[i]);
+	}
+	if (ks.track_tries) {
+		printf("  Track cache %lu hits, %lu lookups (%lu%%)\n",
+			ks.track_hits, ks.track_tries, ks.track_hits * 100 / ks.track_tries);
+	}
+	/* only if kernel configured with CONFIG_SYSCALL_COUNTS */
+	if ((n = ioctl(fd, MEM_GETSYSCNT, syscnt)) > 0) {
+		printf("  SYSCALL  COUNT\n");
+		for (i = 0; i < n; i++) {
+			if (syscnt[i])
+				printf("  %7d  %lu\n", i, syscnt[i]);
+		}
+	}
+}
+
 void usage(void)
 {
-	printf("usage: meminfo [-a][-f][-t][-b]\n");
+	printf("usage: meminfo [-a][-f][-t][-b][-c][-s][-k]\n");
 }
 
 int main(int argc, char **argv)
 {
 	int fd, c;
 	struct mem_usage mu;
+	struct proc_list pl;
+	struct dcache_stats dc;
 
 	if (argc < 2)
 		allflag = 1;
-	else while ((c = getopt(argc, argv, "aftbh")) != -1) {
+	else while ((c = getopt(argc, argv, "aftbcskh")) != -1) {
 		switch (c) {
 			case 'a':
 				aflag = 1;
@@ -168,6 +229,15 @@ int main(int argc, char **argv)
 			case 'b':
 				bflag = 1;
 				break;
+			case 'c':
+				cflag = 1;
+				break;
+			case 's':
+				sflag = 1;
+				break;
+			case 'k':
+				kflag = 1;
+				break;
 			case 'h':
 				usage();
 				return 0;
@@ -182,20 +252,43 @@ int main(int argc, char **argv)
 		return 1;
 	}
     if (ioctl(fd, MEM_GETDS, &ds) ||
-        ioctl(fd, MEM_GETHEAP, &heap_all) ||
-        ioctl(fd, MEM_GETTASK, &taskoff)) {
+        ioctl(fd, MEM_GETHEAP, &heap_all)) {
           perror("meminfo");
         return 1;
     }
-    if (!memread(fd, taskoff, ds, &task_table, sizeof(task_table))) {
+	if (!aflag && !fflag && !tflag && !bflag)
+		allflag = 1;
+	if (cflag) {
+		unsigned int largest;
+
+		if (ioctl(fd, MEM_COMPACT, &largest))
+			perror("meminfo: compact");
+		else printf("  Compacted, largest free segment %uKB\n", largest);
+	}
+    pl.procs = procs;
+    pl.max = MAX_TASKS;
+    if ((nprocs = ioctl(fd, MEM_GETPROCS, &pl)) < 0) {
         perror("taskinfo");
+        nprocs = 0;
     }
-	dump_heap(fd);
+	if (sflag || kflag)
+		dump_heapstat(fd);
+	if (kflag)
+		dump_kstat(fd);
+	if ((!sflag && !kflag) || aflag || fflag || tflag || bflag)
+		dump_heap(fd);
 
 	if (!ioctl(fd, MEM_GETUSAGE, &mu)) {
 		/* note MEM_GETUSAGE amounts are floors, so total may display less by 1k than actual*/
 		printf("  Memory usage %4dKB total, %4dKB used, %4dKB free\n",
 			mu.used_memory + mu.free_memory, mu.used_memory, mu.free_memory);
+		printf("  Free memory  %4dKB largest, %d free segments\n",
+			mu.largest_free, mu.free_blocks);
+	}
+
+	if (!ioctl(fd, MEM_GETDCACHE, &dc) && dc.hits + dc.misses) {
+		printf("  Name cache %lu hits, %lu misses (%lu%%), %u entries\n",
+			dc.hits, dc.misses, dc.hits * 100 / (dc.hits + dc.misses), dc.entries);
 	}
 
 	return 0;
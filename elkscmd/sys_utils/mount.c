@@ -5,6 +5,7 @@
  *
  * Sep 2020 - added ro and remount,rw options - ghaerr
  * Feb 2022 - add -a auto mount w/o type specifier, -q query fs type
+ * Oct 2026 - comma separated -o options, noatime and relatime
  */
 
 #include <stdio.h>
@@ -20,7 +21,7 @@
 #define errmsg(str) write(STDERR_FILENO, str, sizeof(str) - 1)
 
 static char *fs_typename[] = {
-	0, "minix", "msdos", "romfs"
+	0, "minix", "msdos", "romfs", "tmpfs"
 };
 
 static int show_mount(dev_t dev)
@@ -30,7 +31,11 @@ static int show_mount(dev_t dev)
 	if (ustatfs(dev, &statfs, UF_NOFREESPACE) < 0)
 		return -1;
 
-	if (statfs.f_type < FST_MSDOS) 
+	if (statfs.f_type == FST_TMPFS)
+		printf("%-9s (%5s) blocks %6lu free %6lu mount %s\n",
+		"tmpfs", fs_typename[statfs.f_type], statfs.f_blocks,
+		statfs.f_bfree, statfs.f_mntonname);
+	else if (statfs.f_type < FST_MSDOS) 
 		printf("%-9s (%5s) blocks %6lu free %6lu mount %s\n",
 		devname(statfs.f_dev, S_IFBLK), fs_typename[statfs.f_type], statfs.f_blocks,
 		statfs.f_bfree, statfs.f_mntonname);
@@ -48,9 +53,31 @@ static void show(void)
 		show_mount(i);
 }
 
+/* parse comma separated -o options, returns -1 on unknown option */
+static int parse_options(char *option, int *flags)
+{
+	char *p;
+
+	for (p = strtok(option, ","); p; p = strtok(NULL, ",")) {
+		if (!strcmp(p, "ro"))
+			*flags |= MS_RDONLY;
+		else if (!strcmp(p, "rw"))
+			*flags &= ~MS_RDONLY;
+		else if (!strcmp(p, "remount"))
+			*flags |= MS_REMOUNT;
+		else if (!strcmp(p, "noatime"))
+			*flags |= MS_NOATIME;
+		else if (!strcmp(p, "relatime"))
+			*flags |= MS_RELATIME;
+		else return -1;
+	}
+	return 0;
+}
+
 static int usage(void)
 {
-	errmsg("usage: mount [-a][-q][-t minix|fat][-o ro|remount,{rw|ro}] <device> <directory>\n");
+	errmsg("usage: mount [-a][-q][-t minix|fat][-o [remount,]{rw|ro}[,noatime|relatime]] <device> <directory>\n"
+		"       mount -t tmpfs <sizeKB> <directory>\n");
     return 1;
 }
 
@@ -89,6 +116,8 @@ int main(int argc, char **argv)
 					type = FST_MSDOS;
 				else if (!strcmp(option, "romfs"))
 					type = FST_ROMFS;
+				else if (!strcmp(option, "tmpfs"))
+					type = FST_TMPFS;
 				else return usage();
 				argc--;
 				break;
@@ -99,15 +128,8 @@ int main(int argc, char **argv)
 				}
 
 				option = *argv++;
-				if (!strcmp(option, "ro"))
-					flags |= MS_RDONLY;
-				else if (!strcmp(option, "remount,rw"))
-					flags |= MS_REMOUNT;
-				else if (!strcmp(option, "remount,ro"))
-					flags |= MS_REMOUNT|MS_RDONLY;
-				else {
+				if (parse_options(option, &flags) < 0)
 					return usage();
-				}
 				argc--;
 				break;
 
@@ -125,8 +147,8 @@ int main(int argc, char **argv)
 		return usage();
 	}
 
-	if (flags == 0 && type == 0)
-		flags = MS_AUTOMOUNT;
+	if ((flags & ~(MS_NOATIME|MS_RELATIME)) == 0 && type == 0)
+		flags |= MS_AUTOMOUNT;
 	if (mount(argv[0], argv[1], type, flags) < 0) {
 		if (flags & MS_AUTOMOUNT) {
 			type = (!type || type == FST_MINIX)? FST_MSDOS: FST_MINIX;
@@ -9,10 +9,6 @@
  * This is a small version of ps for use in the ELKS project.
  * Enhanced by Greg Haerr 17 Apr 2020
  */
-#define __KERNEL__
-#include <linuxmt/ntty.h>
-#undef __KERNEL__
-
 #include <autoconf.h>           /* for CONFIG_ options */
 #include <linuxmt/mm.h>
 #include <linuxmt/mem.h>
@@ -45,30 +41,7 @@ int memread(int fd, word_t off, word_t seg, void *buf, int size)
 	return 1;
 }
 
-word_t getword(int fd, word_t off, word_t seg)
-{
-	word_t word;
-
-	if (!memread(fd, off, seg, &word, sizeof(word)))
-		return 0;
-	return word;
-}
-
-void process_name(int fd, unsigned int off, unsigned int seg)
-{
-	word_t argc, argv;
-	char buf[80];
-
-	argc = getword(fd, off, seg);
-
-	while (argc-- > 0) {
-		off += 2;
-		argv = getword(fd, off, seg);
-		if (!memread(fd, argv, seg, buf, sizeof(buf)))
-			return;
-		printf("%s ",buf);
-	}
-}
+struct proc_snap procs[MAX_TASKS];
 
 /* fast cached version of devname() */
 char *dev_name(unsigned int minor)
@@ -101,26 +74,13 @@ char *dev_name(unsigned int minor)
 	return "?";
 }
 
-char *tty_name(int fd, unsigned int off, unsigned int seg)
-{
-	off_t addr = ((off_t)seg << 4) + off;
-	struct tty tty;
-
-	if (off == 0)
-		return "";
-	if (lseek(fd, addr, SEEK_SET) == -1) return "?";
-
-	if (read(fd, &tty, sizeof(tty)) != sizeof(tty)) return "?";
-
-	return dev_name(tty.minor);
-}
-
 int main(int argc, char **argv)
 {
-	int c, fd;
-	unsigned int j, ds, off;
-	word_t cseg, dseg;
-	struct task_struct task_table;
+	int c, fd, n;
+	unsigned int ds;
+	int swapped;
+	struct proc_list pl;
+	struct proc_snap *p;
 	struct passwd * pwent;
     int f_listall = 0;
     char *progname = argv[0];
@@ -144,17 +104,13 @@ int main(int argc, char **argv)
 		printf("ps: no /dev/kmem\n");
 		return 1;
 	}
-	if (ioctl(fd, MEM_GETDS, &ds) < 0) {
-		printf("ps: ioctl mem_getds\n");
-		return 1;
-	}
-
 #ifdef CONFIG_CPU_USAGE
     if (f_uptime) {
         jiff_t uptime;
         unsigned int upoff;
 
-	    if (ioctl(fd, MEM_GETUPTIME, &upoff) < 0 ||
+	    if (ioctl(fd, MEM_GETDS, &ds) < 0 ||
+                ioctl(fd, MEM_GETUPTIME, &upoff) < 0 ||
                 !memread(fd, upoff, ds, &uptime, sizeof(uptime))) {
 		    printf("ps: ioctl mem_getuptime\n");
 		    return 1;
@@ -167,14 +123,28 @@ int main(int argc, char **argv)
         n %= 3600;
         int minutes = n / 60 ;
 
-        printf("up for %d days, %d hour%s, and %d minute%s\n",
-            days, hours, hours == 1? "": "s", minutes, minutes == 1? "": "s");
+        /* every tick is charged to a task or to the idle task */
+        unsigned long busy = 0;
+        pl.procs = procs;
+        pl.max = MAX_TASKS;
+        if ((n = ioctl(fd, MEM_GETPROCS, &pl)) > 0) {
+            for (p = procs; p < &procs[n]; p++)
+                busy += p->cpu;
+        }
+        /* Round up, then divide by 2 for %. Change if SAMP_FREQ not 2 */
+        int idle = 100 - FIXED_INT((busy + FIXED_HALF) >> 1);
+
+        printf("up for %d days, %d hour%s, and %d minute%s, %d%% idle\n",
+            days, hours, hours == 1? "": "s", minutes, minutes == 1? "": "s",
+            idle < 0? 0: idle);
         return 0;
     }
 #endif
 
-	if (ioctl(fd, MEM_GETTASK, &off) < 0) {
-		printf("ps: ioctl mem_gettask\n");
+	pl.procs = procs;
+	pl.max = MAX_TASKS;
+	if ((n = ioctl(fd, MEM_GETPROCS, &pl)) < 0) {
+		printf("ps: ioctl mem_getprocs\n");
 		return 1;
 	}
 
@@ -183,16 +153,10 @@ int main(int argc, char **argv)
     printf("CPU");
 #endif
     printf(" ");
-	if (f_listall) printf("CSEG DSEG ");
+	if (f_listall) printf("PRI  NI CSEG DSEG ");
 	printf(" HEAP  FREE   SIZE COMMAND\n");
-	for (j = 1; j < MAX_TASKS; j++) {
-		if (!memread(fd, off + j*sizeof(struct task_struct), ds, &task_table, sizeof(task_table))) {
-			printf("ps: memread\n");
-			return 1;
-		}
-
-		switch (task_table.state) {
-		case TASK_UNUSED:			continue;
+	for (p = procs; p < &procs[n]; p++) {
+		switch (p->state) {
 		case TASK_RUNNING:			c = 'R'; break;
 		case TASK_INTERRUPTIBLE:	c = 'S'; break;
 		case TASK_UNINTERRUPTIBLE:	c = 's'; break;
@@ -202,54 +166,35 @@ int main(int argc, char **argv)
 		default:					c = '?'; break;
 		}
 
-		if (task_table.kstack_magic != KSTACK_MAGIC) {
-			printf("Recompile ps, mismatched task structure\n");
-			return 1;
-		}
-
-		pwent = getpwuid(task_table.uid);
+		pwent = getpwuid(p->uid);
+		swapped = p->flags & PROC_SWAPPED;
 
 		/* pid grp tty user stat*/
-		printf("%5d %5d %4s %-8s%c ",
-				task_table.pid,
-				task_table.pgrp,
-				tty_name(fd, (unsigned int)task_table.tty, ds),
+		printf("%5d %5d %4s %-8s%c%c",
+				p->pid,
+				p->pgrp,
+				p->tty < 0? "": dev_name(p->tty),
 				(pwent ? pwent->pw_name : "unknown"),
-				c);
+				c, swapped? 'W': ' ');
 
 #ifdef CONFIG_CPU_USAGE
         {
             /* Round up, then divide by 2 for %. Change if SAMP_FREQ not 2 */
-            unsigned long cpu_percent = (task_table.average + FIXED_HALF) >> 1;
+            unsigned long cpu_percent = (p->cpu + FIXED_HALF) >> 1;
             printf("%3d", FIXED_INT(cpu_percent));
         }
 #endif
-		/* CSEG*/
-		cseg = (word_t)task_table.mm.seg_code;
-		if (f_listall) printf(" %4x ",
-            cseg? getword(fd, (word_t)cseg+offsetof(struct segment, base), ds): 0);
-
-		/* DSEG*/
-		dseg = (word_t)task_table.mm.seg_data;
-		if (f_listall) printf("%4x",
-            dseg? getword(fd, (word_t)dseg+offsetof(struct segment, base), ds): 0);
-
-		if (dseg) {
-			/* heap*/
-			printf(" %5u ", (word_t)(task_table.t_endbrk - task_table.t_enddata));
-
-			/* free*/
-			printf("%5u ", (word_t)(task_table.t_regs.sp - task_table.t_endbrk));
-
-			/* stack*/
-			//printf("%5u ", (word_t)(task_table.t_begstack - task_table.t_regs.sp));
-
-			/* size*/
-			segext_t size = getword(fd, (word_t)cseg+offsetof(struct segment, size), ds)
-							+ getword(fd, (word_t)dseg+offsetof(struct segment, size), ds);
-			printf("%6ld ", (long)size << 4);
-
-			process_name(fd, task_table.t_begstack, task_table.t_regs.ss);
+		/* run queue level, nice, CSEG, DSEG*/
+		if (f_listall)
+			printf(" %3d %3d %4x %4x", p->prio, p->nice, p->cseg, p->dseg);
+
+		if (p->dseg) {
+			/* heap, free, size*/
+			printf(" %5u %5u ", p->heap, p->stack_free);
+			printf("%6ld ", (long)(segext_t)(p->csize + p->dsize) << 4);
+			if (swapped)
+				printf("[swapped]");
+			else printf("%s", p->cmd);
 		}
 		printf("\n");
 	}
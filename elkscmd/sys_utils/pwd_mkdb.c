@@ -0,0 +1,154 @@
+/*
+ * pwd_mkdb - build the hashed passwd index used by getpwnam/getpwuid
+ *
+ * Usage: pwd_mkdb [passwd [database]]
+ *
+ * Records the offset of each passwd line in a uid and a name hash table,
+ * stamped with the size and time of the passwd file. The C library
+ * ignores the index once the passwd file changes, so rerun pwd_mkdb
+ * after editing /etc/passwd.
+ */
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <paths.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAXENTS     512
+#define MAXSLOTS    4096
+#define LINELEN     64          /* longest line the library will read */
+
+struct ent {
+    unsigned short uid;
+    unsigned short hash;
+    unsigned short off;
+};
+
+static struct ent ents[MAXENTS];
+static int nents;
+static char *prog;
+
+static int
+insert(struct pwdb_slot *table, unsigned int nslots, unsigned short key,
+    unsigned short off)
+{
+    struct pwdb_slot *s = &table[key & (nslots - 1)];
+    int i;
+
+    for (i = 0; i < PWDB_PROBE; i++, s++) {
+        if (!s->off) {
+            s->key = key;
+            s->off = off;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+readpasswd(FILE *fp)
+{
+    char line[256];
+    char *p;
+    long off = 0;
+    int len;
+
+    while (fgets(line, sizeof(line), fp)) {
+        len = strlen(line);
+        if (line[len-1] != '\n') {
+            fprintf(stderr, "%s: line too long\n", prog);
+            return 0;
+        }
+        /* skip the same lines as the library */
+        if (len <= LINELEN && *line != '#' && *line != ' ' && *line != '\t'
+            && *line != '\n' && (p = strchr(line, ':')) != NULL) {
+            if (nents >= MAXENTS || off >= 0xFFFFL) {
+                fprintf(stderr, "%s: passwd file too large\n", prog);
+                return 0;
+            }
+            *p++ = '\0';
+            if ((p = strchr(p, ':')) != NULL) {
+                ents[nents].hash = __pwdb_hash(line);
+                ents[nents].uid = atoi(p + 1);
+                ents[nents].off = off + 1;
+                nents++;
+            }
+        }
+        off += len;
+    }
+    return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+    struct pwdb_hdr hdr;
+    struct pwdb_slot *table;
+    struct stat st;
+    unsigned int nslots, tsize;
+    char *pwname = _PATH_PASSWD;
+    char *dbname = _PATH_PWDB;
+    FILE *fp;
+    int fd, i;
+
+    prog = argv[0];
+    if (argc > 1)
+        pwname = argv[1];
+    if (argc > 2)
+        dbname = argv[2];
+
+    if ((fp = fopen(pwname, "r")) == NULL) {
+        perror(pwname);
+        return 1;
+    }
+    if (!readpasswd(fp) || fstat(fileno(fp), &st) < 0)
+        return 1;
+    fclose(fp);
+
+    /* double the table until no probe sequence overflows */
+    for (nslots = 16; nslots < nents * 2; nslots <<= 1)
+        continue;
+    for (;; nslots <<= 1) {
+        if (nslots > MAXSLOTS) {
+            fprintf(stderr, "%s: too many collisions\n", prog);
+            return 1;
+        }
+        tsize = nslots + PWDB_PROBE - 1;
+        if ((table = calloc(tsize * 2, sizeof(struct pwdb_slot))) == NULL) {
+            fprintf(stderr, "%s: out of memory\n", prog);
+            return 1;
+        }
+        for (i = 0; i < nents; i++) {
+            if (!insert(table, nslots, ents[i].uid, ents[i].off) ||
+                !insert(table + tsize, nslots, ents[i].hash, ents[i].off))
+                break;
+        }
+        if (i == nents)
+            break;
+        free(table);
+    }
+
+    hdr.magic = PWDB_MAGIC;
+    hdr.nslots = nslots;
+    hdr.size = st.st_size;
+    hdr.mtime = st.st_mtime;
+    if ((fd = open(dbname, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        perror(dbname);
+        return 1;
+    }
+    if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+        write(fd, table, tsize * 2 * sizeof(struct pwdb_slot)) !=
+            tsize * 2 * sizeof(struct pwdb_slot)) {
+        perror(dbname);
+        close(fd);
+        unlink(dbname);
+        return 1;
+    }
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,361 @@
+/*
+ * elksbench - system microbenchmarks
+ *
+ * Usage: elksbench [-d dir] [-t addr:port] [-r msecs] [-e cmd]
+ *
+ * Runs a fixed set of process, utility, pipe, disk, kernel copy and optionally TCP benchmarks
+ * and prints one result per line between BENCH START and BENCH END markers,
+ * in the form "BENCH name value unit", for collection by qemubench.sh.
+ *
+ *	-d dir		directory for the disk file, default /tmp or /
+ *	-t addr:port	send to a TCP sink at addr:port, e.g. 10.0.2.2:8099
+ *	-r msecs	time to run each rate benchmark, default 2000
+ *	-e cmd		utility to exec and measure, default /bin/cat
+ *
+ * Running the same -e utility on images with its group built separately and
+ * into busyelks compares exec latency and the memory used per instance.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <arpa/inet.h>
+#include <linuxmt/mem.h>
+
+#define SELF		"/bin/elksbench"
+#define BENCHFILE	"elksbench.tmp"
+#define BUFSIZE		1024
+#define PIPE_KB		256
+#define DISK_KB		128
+#define TCP_KB		256
+#define SMALL_COPY	6
+#define NR_CMD		4	/* instances of the utility run at once */
+
+static char buf[BUFSIZE];
+static char *self = SELF;
+static char *cmd = "/bin/cat";
+static long runtime = 2000;
+
+static unsigned long msecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000UL + tv.tv_usec / 1000;
+}
+
+static void result(char *name, unsigned long value, char *unit)
+{
+	printf("BENCH %s %lu %s\n", name, value, unit);
+	fflush(stdout);
+}
+
+static void failed(char *name)
+{
+	printf("BENCH %s failed -\n", name);
+	fflush(stdout);
+}
+
+static unsigned long rate(long count, long ms)
+{
+	return ms > 0? count * 1000L / ms: 0;
+}
+
+static unsigned long kbps(long kb, long ms)
+{
+	return ms > 0? kb * 1000L / ms: 0;
+}
+
+/* fork and wait for a child that exits at once, or execs self -x */
+static void bench_spawn(char *name, int doexec)
+{
+	unsigned long start, ms;
+	long count = 0;
+	int pid, status;
+
+	start = msecs();
+	do {
+		if ((pid = fork()) == 0) {
+			if (doexec)
+				execl(self, self, "-x", (char *)0);
+			_exit(doexec? 127: 0);
+		}
+		if (pid < 0 || waitpid(pid, &status, 0) < 0 || status) {
+			failed(name);
+			return;
+		}
+		count++;
+	} while ((ms = msecs() - start) < runtime);
+	result(name, rate(count, ms), "/s");
+}
+
+/* exec the utility with stdin and stdout on /dev/null until it exits */
+static void bench_cmd_exec(void)
+{
+	unsigned long start, ms;
+	long count = 0;
+	int pid, status, fd;
+
+	start = msecs();
+	do {
+		if ((pid = fork()) == 0) {
+			if ((fd = open("/dev/null", O_RDWR)) >= 0) {
+				dup2(fd, 0);
+				dup2(fd, 1);
+				close(fd);
+			}
+			execl(cmd, cmd, (char *)0);
+			_exit(127);
+		}
+		if (pid < 0 || waitpid(pid, &status, 0) < 0 || status) {
+			failed("exec_cmd");
+			return;
+		}
+		count++;
+	} while ((ms = msecs() - start) < runtime);
+	result("exec_cmd", rate(count, ms), "/s");
+}
+
+static unsigned int used_kb(int fd)
+{
+	struct mem_usage mu;
+
+	if (ioctl(fd, MEM_GETUSAGE, &mu) < 0)
+		return 0;
+	return mu.used_memory;
+}
+
+/* memory used by each of NR_CMD instances of the utility blocked reading a pipe */
+static void bench_cmd_mem(void)
+{
+	int pid[NR_CMD], fd[2], kmem, status, i, n;
+	unsigned int before, after;
+
+	if ((kmem = open("/dev/kmem", O_RDONLY)) < 0 || pipe(fd) < 0) {
+		if (kmem >= 0)
+			close(kmem);
+		failed("mem_cmd");
+		return;
+	}
+	before = used_kb(kmem);
+	for (n = 0; n < NR_CMD; n++) {
+		if ((pid[n] = fork()) == 0) {
+			dup2(fd[0], 0);
+			close(fd[0]);
+			close(fd[1]);
+			if ((i = open("/dev/null", O_WRONLY)) >= 0) {
+				dup2(i, 1);
+				close(i);
+			}
+			execl(cmd, cmd, (char *)0);
+			_exit(127);
+		}
+		if (pid[n] < 0)
+			break;
+	}
+	sleep(1);			/* let each child finish its exec */
+	after = used_kb(kmem);
+	close(fd[0]);
+	close(fd[1]);
+	for (i = 0; i < n; i++)
+		waitpid(pid[i], &status, 0);
+	close(kmem);
+	if (n < NR_CMD || !before || after < before)
+		failed("mem_cmd");
+	else
+		result("mem_cmd", (after - before) / NR_CMD, "KB");
+}
+
+/* read PIPE_KB through a pipe from a child */
+static void bench_pipe(void)
+{
+	unsigned long start, ms;
+	long total = 0;
+	int fd[2], pid, status, n, i;
+
+	if (pipe(fd) < 0) {
+		failed("pipe");
+		return;
+	}
+	start = msecs();
+	if ((pid = fork()) == 0) {
+		close(fd[0]);
+		for (i = 0; i < PIPE_KB; i++)
+			if (write(fd[1], buf, BUFSIZE) != BUFSIZE)
+				_exit(1);
+		_exit(0);
+	}
+	close(fd[1]);
+	while ((n = read(fd[0], buf, BUFSIZE)) > 0)
+		total += n;
+	close(fd[0]);
+	ms = msecs() - start;
+	if (pid < 0 || waitpid(pid, &status, 0) < 0 || status || total != PIPE_KB * 1024L) {
+		failed("pipe");
+		return;
+	}
+	result("pipe", kbps(PIPE_KB, ms), "KB/s");
+}
+
+/* write DISK_KB to a file including the sync, then read it back */
+static void bench_disk(char *dir)
+{
+	char path[128];
+	unsigned long start, ms;
+	int fd, i;
+
+	sprintf(path, "%s/%s", dir, BENCHFILE);
+	start = msecs();
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+		failed("disk_write");
+		failed("disk_read");
+		return;
+	}
+	for (i = 0; i < DISK_KB; i++)
+		if (write(fd, buf, BUFSIZE) != BUFSIZE)
+			break;
+	close(fd);
+	sync();
+	ms = msecs() - start;
+	if (i < DISK_KB)
+		failed("disk_write");
+	else
+		result("disk_write", kbps(DISK_KB, ms), "KB/s");
+
+	start = msecs();
+	if ((fd = open(path, O_RDONLY)) >= 0) {
+		for (i = 0; i < DISK_KB; i++)
+			if (read(fd, buf, BUFSIZE) != BUFSIZE)
+				break;
+		close(fd);
+	}
+	ms = msecs() - start;
+	if (fd < 0 || i < DISK_KB)
+		failed("disk_read");
+	else
+		result("disk_read", kbps(DISK_KB, ms), "KB/s");
+	unlink(path);
+}
+
+/* kernel copy routine bandwidth for BUFSIZE and small copies, needs root */
+static void bench_copy(void)
+{
+	struct copy_bench cb;
+	int fd;
+
+	if ((fd = open("/dev/kmem", O_RDONLY)) < 0) {
+		failed("copy_far");
+		return;
+	}
+	cb.buf = buf;
+	cb.size = BUFSIZE;
+	if (ioctl(fd, MEM_COPYBENCH, &cb) < 0) {
+		failed("copy_far");
+		close(fd);
+		return;
+	}
+	result("copy_far", cb.fmemcpy, "KB/s");
+	result("copy_far_odd", cb.fmemcpy_odd, "KB/s");
+	result("copy_tofs", cb.tofs, "KB/s");
+	result("copy_fromfs", cb.fromfs, "KB/s");
+	cb.size = SMALL_COPY;
+	if (ioctl(fd, MEM_COPYBENCH, &cb) < 0)
+		failed("copy_small");
+	else
+		result("copy_small", cb.tofs, "KB/s");
+	close(fd);
+}
+
+/* send TCP_KB to a sink that reads until close */
+static void bench_tcp(char *target)
+{
+	struct sockaddr_in addr;
+	char host[32], *p;
+	unsigned long start, ms;
+	int fd, i;
+
+	strncpy(host, target, sizeof(host) - 1);
+	host[sizeof(host) - 1] = '\0';
+	if ((p = strchr(host, ':')) == NULL) {
+		failed("tcp_send");
+		return;
+	}
+	*p++ = '\0';
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = in_aton(host);
+	addr.sin_port = htons(atoi(p));
+
+	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+		failed("tcp_send");
+		return;
+	}
+	start = msecs();
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		failed("tcp_send");
+		return;
+	}
+	for (i = 0; i < TCP_KB; i++)
+		if (write(fd, buf, BUFSIZE) != BUFSIZE)
+			break;
+	close(fd);
+	ms = msecs() - start;
+	if (i < TCP_KB)
+		failed("tcp_send");
+	else
+		result("tcp_send", kbps(TCP_KB, ms), "KB/s");
+}
+
+int main(int argc, char **argv)
+{
+	struct stat st;
+	char *dir = NULL, *target = NULL;
+	int c;
+
+	while ((c = getopt(argc, argv, "d:t:r:e:x")) != -1) {
+		switch (c) {
+		case 'd':
+			dir = optarg;
+			break;
+		case 't':
+			target = optarg;
+			break;
+		case 'r':
+			runtime = atol(optarg);
+			break;
+		case 'e':
+			cmd = optarg;
+			break;
+		case 'x':		/* exec benchmark child */
+			return 0;
+		default:
+			fprintf(stderr, "Usage: elksbench [-d dir] [-t addr:port] [-r msecs] [-e cmd]\n");
+			return 1;
+		}
+	}
+	if (strchr(argv[0], '/'))
+		self = argv[0];
+	if (!dir)
+		dir = (stat("/tmp", &st) == 0 && S_ISDIR(st.st_mode))? "/tmp": "";
+	memset(buf, 'x', BUFSIZE);
+
+	printf("BENCH START\n");
+	bench_spawn("fork", 0);
+	bench_spawn("exec", 1);
+	bench_cmd_exec();
+	bench_cmd_mem();
+	bench_pipe();
+	bench_disk(dir);
+	bench_copy();
+	if (target)
+		bench_tcp(target);
+	printf("BENCH END\n");
+	return 0;
+}
@@ -0,0 +1,521 @@
+/*
+ * microbench - filesystem, pipe and process microbenchmarks
+ *
+ * Usage: microbench [-d dir] [-r msecs] [-s kbytes] [test...]
+ *
+ * Runs each test given, or all of them, and prints the rate of each
+ * operation between BENCH START and BENCH END markers, in the form
+ * "BENCH name value unit" used by elksbench:
+ *
+ *	seq	sequential write and read of the file in 512, 1024 and 4096 byte calls
+ *	rand	random write and read of the file at the same sizes
+ *	create	create and unlink of empty files
+ *	stat	stat of one file, then of files just pushed out of the buffer cache
+ *	pipe	pipe writes and reads of 64, 512 and 1024 bytes
+ *	exec	fork, exec and wait
+ *	ctxsw	context switches between two processes passing a byte by pipes
+ *	select	select wakeup of a process by another writing a pty
+ *
+ *	-d dir		directory for the test files, default /tmp or /
+ *	-r msecs	time to run each rate benchmark, default 1000
+ *	-s kbytes	size of the test file, default 128, larger than the
+ *			buffer cache for the stat cold cache test
+ *
+ * Times are taken with gettimeofday, which has microsecond resolution
+ * on kernels built with CONFIG_TIME_USEC and tick resolution otherwise.
+ * Short loops are only timed accurately with the former.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+
+#define SELF		"/bin/microbench"
+#define BENCHFILE	"mbench.tmp"
+#define BUFSIZE		4096
+#define BATCH		16	/* operations between clock reads */
+#define NR_FILES	32	/* files per create and stat cold round */
+#define PIPE_KB		64
+
+static char buf[BUFSIZE];
+static char *self = SELF;
+static char *dir;
+static char path[128];
+static long runtime = 1000;
+static long file_kb = 128;
+static unsigned long t0;
+static unsigned long seed = 1;
+
+static int sizes[] = { 512, 1024, 4096 };
+static int pipe_sizes[] = { 64, 512, 1024 };
+#define NR_SIZES	(sizeof(sizes) / sizeof(sizes[0]))
+
+static unsigned long usecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000000UL + tv.tv_usec;
+}
+
+static void timer_start(void)
+{
+	t0 = usecs();
+}
+
+static unsigned long elapsed(void)
+{
+	return usecs() - t0;
+}
+
+/* true until runtime has passed, checking the clock every BATCH operations */
+static int running(long n)
+{
+	return (n % BATCH) || elapsed() < runtime * 1000UL;
+}
+
+static unsigned long rate(long count, unsigned long us)
+{
+	if (count < 4096)
+		return us? count * 1000000UL / us: 0;
+	us /= 100;			/* count * 10000 fits 32 bits */
+	return us? count * 10000UL / us: 0;
+}
+
+static void result(char *name, int size, unsigned long value, char *unit)
+{
+	if (size)
+		printf("BENCH %s_%d %lu %s\n", name, size, value, unit);
+	else
+		printf("BENCH %s %lu %s\n", name, value, unit);
+	fflush(stdout);
+}
+
+static void failed(char *name, int size)
+{
+	if (size)
+		printf("BENCH %s_%d failed -\n", name, size);
+	else
+		printf("BENCH %s failed -\n", name);
+	fflush(stdout);
+}
+
+static char *filename(char *name, int n)
+{
+	if (n < 0)
+		sprintf(path, "%s/%s", dir, name);
+	else
+		sprintf(path, "%s/%s%d", dir, name, n);
+	return path;
+}
+
+static long nextblock(long nblocks)
+{
+	seed = seed * 1103515245UL + 12345;
+	return ((seed >> 16) & 0x7fff) % nblocks;
+}
+
+/* create the test file at full size */
+static int make_file(void)
+{
+	long n;
+	int fd;
+
+	if ((fd = open(filename(BENCHFILE, -1), O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+		return -1;
+	for (n = 0; n < file_kb * 1024L; n += BUFSIZE)
+		if (write(fd, buf, BUFSIZE) != BUFSIZE) {
+			close(fd);
+			return -1;
+		}
+	close(fd);
+	sync();
+	return 0;
+}
+
+/* sequential or random calls of size over the file until runtime */
+static void bench_rw(char *name, int size, int rd, int random)
+{
+	long nblocks = file_kb * 1024L / size;
+	long n, blk = 0;
+	int fd, err = 0;
+
+	if ((fd = open(filename(BENCHFILE, -1), rd? O_RDONLY: O_WRONLY)) < 0) {
+		failed(name, size);
+		return;
+	}
+	timer_start();
+	for (n = 0; running(n); n++) {
+		if (random)
+			blk = nextblock(nblocks);
+		else if (blk == nblocks)
+			blk = 0;
+		if (((random || blk == 0) && lseek(fd, blk * size, SEEK_SET) < 0) ||
+		    (rd? read(fd, buf, size): write(fd, buf, size)) != size) {
+			err = 1;
+			break;
+		}
+		blk++;
+	}
+	close(fd);
+	if (err)
+		failed(name, size);
+	else
+		result(name, size, rate(n, elapsed()), "/s");
+}
+
+static void bench_file(int random)
+{
+	int i;
+
+	if (make_file() < 0) {
+		failed(random? "rand_write": "seq_write", 0);
+		return;
+	}
+	for (i = 0; i < NR_SIZES; i++) {
+		bench_rw(random? "rand_write": "seq_write", sizes[i], 0, random);
+		bench_rw(random? "rand_read": "seq_read", sizes[i], 1, random);
+	}
+	unlink(filename(BENCHFILE, -1));
+}
+
+/* create NR_FILES files, then unlink them, until runtime */
+static void bench_create(void)
+{
+	unsigned long create_us = 0, unlink_us = 0, t;
+	long count = 0;
+	int i, fd;
+
+	do {
+		t = usecs();
+		for (i = 0; i < NR_FILES; i++) {
+			if ((fd = creat(filename("mb", i), 0644)) < 0)
+				break;
+			close(fd);
+		}
+		create_us += usecs() - t;
+		t = usecs();
+		while (--i >= 0)
+			unlink(filename("mb", i));
+		unlink_us += usecs() - t;
+		if (fd < 0) {
+			failed("create", 0);
+			failed("unlink", 0);
+			return;
+		}
+		count += NR_FILES;
+	} while (create_us + unlink_us < runtime * 1000UL);
+	result("create", 0, rate(count, create_us), "/s");
+	result("unlink", 0, rate(count, unlink_us), "/s");
+}
+
+/*
+ * stat of one file with its inode and directory blocks cached, then of
+ * NR_FILES files after reading the test file to push those blocks out of
+ * the buffer cache. Inodes still held in the inode cache are not flushed.
+ */
+static void bench_stat(void)
+{
+	struct stat st;
+	long n;
+	int fd, i, err = 0;
+
+	if (make_file() < 0) {
+		failed("stat_warm", 0);
+		failed("stat_cold", 0);
+		return;
+	}
+	filename(BENCHFILE, -1);
+	timer_start();
+	for (n = 0; running(n); n++)
+		if (stat(path, &st) < 0) {
+			err = 1;
+			break;
+		}
+	if (err)
+		failed("stat_warm", 0);
+	else
+		result("stat_warm", 0, rate(n, elapsed()), "/s");
+
+	for (i = 0; i < NR_FILES; i++) {
+		if ((fd = creat(filename("mb", i), 0644)) < 0)
+			break;
+		close(fd);
+	}
+	sync();
+	if ((fd = open(filename(BENCHFILE, -1), O_RDONLY)) >= 0) {
+		while (read(fd, buf, BUFSIZE) > 0)
+			continue;
+		close(fd);
+	}
+	timer_start();
+	for (n = 0; n < i; n++)
+		if (stat(filename("mb", (int)n), &st) < 0)
+			break;
+	if (n < NR_FILES)
+		failed("stat_cold", 0);
+	else
+		result("stat_cold", 0, rate(n, elapsed()), "/s");
+	while (--i >= 0)
+		unlink(filename("mb", i));
+	unlink(filename(BENCHFILE, -1));
+}
+
+/* PIPE_KB through a pipe from a child in writes of size, read at the same size */
+static void bench_pipe_size(int size)
+{
+	long total = 0, writes = PIPE_KB * 1024L / size;
+	int fd[2], pid, status, n;
+	unsigned long us;
+
+	if (pipe(fd) < 0) {
+		failed("pipe", size);
+		return;
+	}
+	timer_start();
+	if ((pid = fork()) == 0) {
+		close(fd[0]);
+		while (writes-- > 0)
+			if (write(fd[1], buf, size) != size)
+				_exit(1);
+		_exit(0);
+	}
+	close(fd[1]);
+	while ((n = read(fd[0], buf, size)) > 0)
+		total += n;
+	us = elapsed();
+	close(fd[0]);
+	if (pid < 0 || waitpid(pid, &status, 0) < 0 || status || total != PIPE_KB * 1024L)
+		failed("pipe", size);
+	else
+		result("pipe", size, rate(writes, us), "/s");
+}
+
+static void bench_pipe(void)
+{
+	int i;
+
+	for (i = 0; i < NR_SIZES; i++)
+		bench_pipe_size(pipe_sizes[i]);
+}
+
+static void bench_exec(void)
+{
+	long n;
+	int pid, status;
+
+	timer_start();
+	for (n = 0; running(n); n++) {
+		if ((pid = fork()) == 0) {
+			execl(self, self, "-x", (char *)0);
+			_exit(127);
+		}
+		if (pid < 0 || waitpid(pid, &status, 0) < 0 || status) {
+			failed("fork_exec", 0);
+			return;
+		}
+	}
+	result("fork_exec", 0, rate(n, elapsed()), "/s");
+}
+
+/* a byte passed back and forth by two pipes, two switches per round trip */
+static void bench_ctxsw(void)
+{
+	int to[2], from[2], pid, status, err = 0;
+	long n;
+	char c = 0;
+
+	if (pipe(to) < 0 || pipe(from) < 0) {
+		failed("ctxsw", 0);
+		return;
+	}
+	if ((pid = fork()) == 0) {
+		close(to[1]);
+		close(from[0]);
+		while (read(to[0], &c, 1) == 1)
+			if (write(from[1], &c, 1) != 1)
+				break;
+		_exit(0);
+	}
+	close(to[0]);
+	close(from[1]);
+	timer_start();
+	for (n = 0; running(n); n++)
+		if (pid < 0 || write(to[1], &c, 1) != 1 || read(from[0], &c, 1) != 1) {
+			err = 1;
+			break;
+		}
+	close(to[1]);
+	close(from[0]);
+	if (pid > 0)
+		waitpid(pid, &status, 0);
+	if (err)
+		failed("ctxsw", 0);
+	else
+		result("ctxsw", 0, rate(n * 2, elapsed()), "/s");
+}
+
+/* open a free pty master, leaving its slave name in path */
+static int open_pty(void)
+{
+	int n, fd;
+
+	for (n = 0; n < 4; n++) {
+		sprintf(path, "/dev/ptyp%d", n);
+		if ((fd = open(path, O_RDWR)) >= 0) {
+			path[5] = 't';		/* /dev/ttyp%d */
+			return fd;
+		}
+		if (errno != EBUSY)
+			break;
+	}
+	return -1;
+}
+
+static int wait_read(int fd)
+{
+	fd_set fds;
+	char c;
+
+	FD_ZERO(&fds);
+	FD_SET(fd, &fds);
+	if (select(fd + 1, &fds, NULL, NULL, NULL) != 1)
+		return 0;
+	return read(fd, &c, 1) == 1;
+}
+
+/*
+ * A child echoes each byte written to a pty master back from the raw
+ * slave, the parent waits for it in select().
+ */
+static void bench_select(void)
+{
+	struct termios t;
+	unsigned long us;
+	int fd, sfd, pid, status, err = 0;
+	long n;
+	char c = 0;
+
+	if ((fd = open_pty()) < 0) {
+		failed("select_wake", 0);
+		return;
+	}
+	if ((pid = fork()) == 0) {
+		close(fd);
+		if ((sfd = open(path, O_RDWR)) < 0)
+			_exit(1);
+		tcgetattr(sfd, &t);
+		cfmakeraw(&t);
+		tcsetattr(sfd, TCSANOW, &t);
+		write(sfd, &c, 1);		/* ready */
+		while (read(sfd, &c, 1) == 1)
+			if (write(sfd, &c, 1) != 1)
+				break;
+		_exit(0);
+	}
+	if (pid < 0 || !wait_read(fd)) {
+		if (pid > 0) {
+			kill(pid, SIGKILL);
+			waitpid(pid, &status, 0);
+		}
+		close(fd);
+		failed("select_wake", 0);
+		return;
+	}
+	timer_start();
+	for (n = 0; running(n); n++)
+		if (write(fd, &c, 1) != 1 || !wait_read(fd)) {
+			err = 1;
+			break;
+		}
+	us = elapsed();
+	kill(pid, SIGKILL);
+	if (err)
+		failed("select_wake", 0);
+	else {
+		result("select_wake", 0, rate(n, us), "/s");
+		result("select_wake_us", 0, us / n, "us");
+	}
+	close(fd);
+	waitpid(pid, &status, 0);
+}
+
+static void bench_seq(void)
+{
+	bench_file(0);
+}
+
+static void bench_rand(void)
+{
+	bench_file(1);
+}
+
+static struct test {
+	char *name;
+	void (*fn)(void);
+} tests[] = {
+	{ "seq",	bench_seq },
+	{ "rand",	bench_rand },
+	{ "create",	bench_create },
+	{ "stat",	bench_stat },
+	{ "pipe",	bench_pipe },
+	{ "exec",	bench_exec },
+	{ "ctxsw",	bench_ctxsw },
+	{ "select",	bench_select },
+	{ NULL,		NULL }
+};
+
+int main(int argc, char **argv)
+{
+	struct stat st;
+	struct test *t;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "d:r:s:x")) != -1) {
+		switch (c) {
+		case 'd':
+			dir = optarg;
+			break;
+		case 'r':
+			runtime = atol(optarg);
+			break;
+		case 's':
+			file_kb = atol(optarg);
+			break;
+		case 'x':		/* exec benchmark child */
+			return 0;
+		default:
+			fprintf(stderr, "Usage: microbench [-d dir] [-r msecs] [-s kbytes] [test...]\n");
+			return 1;
+		}
+	}
+	if (strchr(argv[0], '/'))
+		self = argv[0];
+	if (!dir)
+		dir = (stat("/tmp", &st) == 0 && S_ISDIR(st.st_mode))? "/tmp": "";
+	if (file_kb < 4)
+		file_kb = 4;
+	memset(buf, 'x', BUFSIZE);
+
+	printf("BENCH START\n");
+	for (t = tests; t->name; t++) {
+		if (optind < argc) {
+			for (i = optind; i < argc; i++)
+				if (!strcmp(argv[i], t->name))
+					break;
+			if (i == argc)
+				continue;
+		}
+		t->fn();
+	}
+	printf("BENCH END\n");
+	return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * libc string and memory routine microbenchmark
+ *
+ * Runs each routine over a BUFSIZE buffer for about a second
+ * and reports the throughput in MB/s.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <sys/time.h>
+
+#define BUFSIZE		4096
+#define BATCH		16
+#define RUNTIME		1000	/* msecs per routine*/
+
+static char src[BUFSIZE + 2];
+static char dst[BUFSIZE + 2];
+static char __far *fsrc, __far *fdst;
+static volatile unsigned long sink;
+
+static unsigned long msecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000UL + tv.tv_usec / 1000;
+}
+
+static void run(int n)
+{
+	switch (n) {
+	case 0: memcpy(dst, src, BUFSIZE); break;
+	case 1: memcpy(dst + 1, src, BUFSIZE); break;
+	case 2: memmove(dst, src, BUFSIZE); break;
+	case 3: memmove(src + 1, src, BUFSIZE); break;
+	case 4: memset(dst, n, BUFSIZE); break;
+	case 5: memset(dst + 1, n, BUFSIZE); break;
+	case 6: sink += (unsigned)memchr(src, 1, BUFSIZE); break;
+	case 7: sink += strlen(src); break;
+	case 8: strcpy(dst, src); break;
+	case 9: sink += (unsigned)strchr(src, 1); break;
+	case 10: sink += (unsigned)strrchr(src, 1); break;
+	case 11: fmemcpy(fdst, fsrc, BUFSIZE); break;
+	case 12: fmemset(fdst, n, BUFSIZE); break;
+	}
+}
+
+static char *names[] = {
+	"memcpy", "memcpy odd", "memmove", "memmove back", "memset", "memset odd",
+	"memchr", "strlen", "strcpy", "strchr", "strrchr", "fmemcpy", "fmemset"
+};
+
+int main(int ac, char **av)
+{
+	unsigned long start, ms, bytes, kbps;
+	int n, i;
+
+	fsrc = fmemalloc(BUFSIZE);
+	fdst = fmemalloc(BUFSIZE);
+	if (!fsrc || !fdst) {
+		printf("Can't allocate far buffers\n");
+		return 1;
+	}
+	memset(src, 'x', BUFSIZE);
+	src[BUFSIZE] = '\0';
+	fmemset(fsrc, 'x', BUFSIZE);
+
+	printf("%-14s %8s\n", "ROUTINE", "MB/s");
+	for (n = 0; n < sizeof(names) / sizeof(names[0]); n++) {
+		bytes = 0;
+		start = msecs();
+		do {
+			for (i = 0; i < BATCH; i++)
+				run(n);
+			bytes += (unsigned long)BATCH * BUFSIZE;
+		} while ((ms = msecs() - start) < RUNTIME);
+		kbps = bytes / ms * 1000 / 1024;
+		printf("%-14s %5lu.%02lu\n", names[n], kbps / 1024, kbps % 1024 * 100 / 1024);
+		if (n == 3)
+			src[BUFSIZE] = '\0';	/* memmove back shifted the string*/
+	}
+	return 0;
+}
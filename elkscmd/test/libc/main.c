@@ -10,7 +10,10 @@ void test_inet_aton_ntoa();
 void test_inet_gethostbyname();
 void test_malloc_alloca();
 void test_malloc_calloc();
+void test_malloc_fmalloc();
+void test_malloc_fshmat();
 void test_malloc_malloc_free();
+void test_malloc_mixed();
 void test_malloc_realloc();
 void test_math_abs();
 void test_math_floor();
@@ -22,8 +25,10 @@ void test_misc_dirname();
 void test_misc_getcwd();
 void test_misc_strtol();
 void test_regex_regcomp();
+void test_regex_dfa();
 void test_regex_expandwildcards();
 void test_stdio_fgets_boundary();
+void test_stdio_fread_fwrite_sizes();
 void test_stdio_init();
 void test_stdio_seek();
 void test_string_memchr();
@@ -34,9 +39,12 @@ void test_string_strlen();
 void test_string_strncat();
 void test_string_strncmp();
 void test_string_strncpy();
+void test_string_strstr();
 void test_system_dirent();
+void test_system_fsync();
 void test_system_ioctl();
 void test_system_reboot();
+void test_system_sched();
 void test_system_sleep();
 void test_system_umount();
 void test_system_ustatfs();
@@ -72,14 +80,17 @@ int main(int argc, char **argv)
 			usage(argv);
 	}
 
-	testfn_t tests[38];
+	testfn_t tests[46];
 	i = 0;
 	tests[i++] = test_error_strerror;
 	tests[i++] = test_inet_aton_ntoa;
 	tests[i++] = test_inet_gethostbyname;
 	tests[i++] = test_malloc_alloca;
 	tests[i++] = test_malloc_calloc;
+	tests[i++] = test_malloc_fmalloc;
+	tests[i++] = test_malloc_fshmat;
 	tests[i++] = test_malloc_malloc_free;
+	tests[i++] = test_malloc_mixed;
 	tests[i++] = test_malloc_realloc;
 	tests[i++] = test_math_abs;
 	tests[i++] = test_math_floor;
@@ -91,8 +102,10 @@ int main(int argc, char **argv)
 	tests[i++] = test_misc_getcwd;
 	tests[i++] = test_misc_strtol;
 	tests[i++] = test_regex_regcomp;
+	tests[i++] = test_regex_dfa;
 	tests[i++] = test_regex_expandwildcards;
 	tests[i++] = test_stdio_fgets_boundary;
+	tests[i++] = test_stdio_fread_fwrite_sizes;
 	tests[i++] = test_stdio_init;
 	tests[i++] = test_stdio_seek;
 	tests[i++] = test_string_memchr;
@@ -103,9 +116,12 @@ int main(int argc, char **argv)
 	tests[i++] = test_string_strncat;
 	tests[i++] = test_string_strncmp;
 	tests[i++] = test_string_strncpy;
+	tests[i++] = test_string_strstr;
 	tests[i++] = test_system_dirent;
+	tests[i++] = test_system_fsync;
 	tests[i++] = test_system_ioctl;
 	tests[i++] = test_system_reboot;
+	tests[i++] = test_system_sched;
 	tests[i++] = test_system_sleep;
 	tests[i++] = test_system_umount;
 	tests[i++] = test_system_ustatfs;
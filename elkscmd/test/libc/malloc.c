@@ -3,6 +3,9 @@
 #include <errno.h>
 #include <malloc.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
 
 TEST_CASE(malloc_malloc_free) {
     void *p;
@@ -79,6 +82,94 @@ TEST_CASE(malloc_realloc) {
     free(p);
 }
 
+/* interleaved small and large blocks keep their contents */
+TEST_CASE(malloc_mixed) {
+    char *p[32];
+    int i, j, n, sz;
+
+    for (i = 0; i < 32; i++)
+        p[i] = NULL;
+    for (n = 0; n < 400; n++) {
+        i = (n * 7) % 32;
+        sz = (n & 3)? (n % 90) + 1: (n % 7) * 200 + 130;
+        if (p[i]) {
+            for (j = 1; j < p[i][0]; j++)
+                if (p[i][j] != (char)i) break;
+            EXPECT_EQ(j, p[i][0]);
+            free(p[i]);
+        }
+        p[i] = malloc(sz);
+        ASSERT_NE_P(p[i], NULL);
+        p[i][0] = sz < 127? sz: 127;
+        memset(p[i] + 1, i, p[i][0] - 1);
+    }
+    for (i = 0; i < 32; i++)
+        free(p[i]);
+}
+
+/* far heap blocks keep their contents across frealloc */
+TEST_CASE(malloc_fmalloc) {
+    char __far *p, __far *q;
+    int i;
+
+    p = fmalloc(1000);
+    ASSERT_NE((long)p, 0L);
+    q = fmalloc(2000);
+    ASSERT_NE((long)q, 0L);
+    fmemset(p, 'A', 1000);
+    fmemset(q, 'B', 2000);
+    ffree(q);
+
+    p = frealloc(p, 3000);
+    ASSERT_NE((long)p, 0L);
+    for (i = 0; i < 1000; i++)
+        if (p[i] != 'A') break;
+    EXPECT_EQ(i, 1000);
+
+    /* shrinking stays in place */
+    q = frealloc(p, 10);
+    EXPECT_EQ((long)q, (long)p);
+    EXPECT_EQ(q[9], 'A');
+    ffree(q);
+}
+
+/* shared segments are found by key and freed after the last detach */
+TEST_CASE(malloc_fshmat) {
+    char __far *p, __far *q;
+    int key = 0x5e1f, status;
+    pid_t pid;
+
+    errno = 0;
+    p = fshmat(key, 100, 0);
+    EXPECT_EQ((long)p, 0L);
+    EXPECT_EQ(errno, ENOENT);
+
+    p = fshmat(key, 100, IPC_CREAT);
+    ASSERT_NE((long)p, 0L);
+    EXPECT_EQ(p[99], 0);
+    p[0] = 'A';
+
+    errno = 0;
+    EXPECT_EQ((long)fshmat(key, 100, IPC_CREAT|IPC_EXCL), 0L);
+    EXPECT_EQ(errno, EEXIST);
+
+    pid = fork();
+    ASSERT_NE(pid, -1);
+    if (pid == 0) {
+        q = fshmat(key, 0, 0);
+        _exit(q == p && q[0] == 'A' ? (q[1] = 'B', 0) : 1);
+    }
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_EQ(status, 0);
+    EXPECT_EQ(p[1], 'B');
+
+    EXPECT_EQ(fshmdt(p), 0);
+    errno = 0;
+    EXPECT_EQ(fshmdt(p), -1);
+    EXPECT_EQ(errno, EINVAL);
+    EXPECT_EQ((long)fshmat(key, 100, 0), 0L);
+}
+
 TEST_CASE(malloc_alloca) {
     void *p;
 
@@ -172,6 +172,9 @@ TEST_CASE(misc_crypt)
     validateCrypt(p);
     EXPECT_STRNE(p, p1);
 
+    /* known answer, hashes already in /etc/passwd must keep matching */
+    EXPECT_STREQ(crypt("secret", "ab"), "abkjC8WCVvS88");
+
     /* long password */
     char *secret = testlib_malloc(128);
     memset(secret, 'X', 127);
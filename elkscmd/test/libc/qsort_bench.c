@@ -0,0 +1,100 @@
+/*
+ * qsort benchmark
+ *
+ * Sorts arrays of ints and of 6 byte records in several
+ * initial orders with the libc qsort and the heapsort, BSD
+ * and GNU versions kept in libc/misc, reporting the time and
+ * number of comparisons each takes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define NELEM		2000
+#define RECSIZE		6
+
+void qsort_heap(void *base, size_t n, size_t width, int (*cmp)());
+void qsort_bsd(void *base, size_t n, size_t width, int (*cmp)());
+void qsort_gnu(void *base, size_t n, size_t width, int (*cmp)());
+
+typedef void (*sort_t)(void *base, size_t n, size_t width, int (*cmp)());
+
+static sort_t sorts[] = { qsort, qsort_heap, qsort_bsd, qsort_gnu };
+static char *sortnames[] = { "libc", "heap", "bsd", "gnu" };
+static char *ordernames[] = { "random", "sorted", "reversed", "equal", "pipe" };
+
+static int master[NELEM];
+static char data[NELEM * RECSIZE];
+static unsigned long ncmp;
+
+static unsigned long msecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000UL + tv.tv_usec / 1000;
+}
+
+static int intcmp(const void *a, const void *b)
+{
+	int x = *(const int *)a, y = *(const int *)b;
+
+	ncmp++;
+	return (x > y) - (x < y);
+}
+
+static void fill(int order)
+{
+	int i;
+
+	for (i = 0; i < NELEM; i++) {
+		switch (order) {
+		case 0: master[i] = rand(); break;
+		case 1: master[i] = i; break;
+		case 2: master[i] = NELEM - i; break;
+		case 3: master[i] = 42; break;
+		case 4: master[i] = (i < NELEM / 2)? i: NELEM - i; break;
+		}
+	}
+}
+
+/* width is sizeof(int) or RECSIZE, the key is the first int */
+static int sorted(int width)
+{
+	int i;
+
+	for (i = 1; i < NELEM; i++)
+		if (intcmp(data + (i - 1) * width, data + i * width) > 0)
+			return 0;
+	return 1;
+}
+
+int main(int ac, char **av)
+{
+	unsigned long start, ms;
+	int order, s, i, width;
+
+	for (width = sizeof(int); width <= RECSIZE; width += RECSIZE - sizeof(int)) {
+		printf("%d elements of %d bytes\n", NELEM, width);
+		printf("%-10s", "");
+		for (s = 0; s < sizeof(sorts) / sizeof(sorts[0]); s++)
+			printf("%16s", sortnames[s]);
+		printf("\n");
+		for (order = 0; order < sizeof(ordernames) / sizeof(ordernames[0]); order++) {
+			fill(order);
+			printf("%-10s", ordernames[order]);
+			for (s = 0; s < sizeof(sorts) / sizeof(sorts[0]); s++) {
+				for (i = 0; i < NELEM; i++)
+					memcpy(data + i * width, &master[i], sizeof(int));
+				ncmp = 0;
+				start = msecs();
+				sorts[s](data, NELEM, width, intcmp);
+				ms = msecs() - start;
+				printf("%7lums %6luc%c", ms, ncmp, sorted(width)? ' ': '!');
+			}
+			printf("\n");
+		}
+	}
+	return 0;
+}
@@ -83,6 +83,31 @@ TEST_CASE(regex_regcomp)
     free(r);
 }
 
+/* DFA prefilter and backtracking matcher agree, and submatches are set */
+TEST_CASE(regex_dfa)
+{
+    struct regexp *r;
+    int i;
+
+    r = regcomp(".*foo.*bar");
+    ASSERT_NE_P(r, NULL);
+    for (i = 0; i < 3; i++) {
+        ASSERT_EQ(regexec(r, "xx foo yy bar zz"), 1);
+        ASSERT_EQ(regexec(r, "xx bar yy foo zz"), 0);
+        ASSERT_EQ(regexec(r, "foobar"), 1);
+        ASSERT_EQ(regexec(r, "fobar"), 0);
+    }
+    free(r);
+
+    r = regcomp("^(ab|cd)+e$");
+    ASSERT_NE_P(r, NULL);
+    ASSERT_EQ(regexec(r, "abcdabe"), 1);
+    EXPECT_EQ(r->endp[0] - r->startp[0], 7);
+    ASSERT_EQ(regexec(r, "abcdab"), 0);
+    ASSERT_EQ(regexec(r, "xabe"), 0);
+    free(r);
+}
+
 TEST_CASE(regex_expandwildcards)
 {
     const char *root = "/tmp/libcwild";
@@ -160,3 +160,40 @@ TEST_CASE(stdio_fgets_boundary)
 
     fclose(fp);
 }
+
+TEST_CASE(stdio_fread_fwrite_sizes)
+{
+    static char wbuf[3000];
+    static char rbuf[3000];
+    size_t n;
+    FILE *fp;
+
+    for (size_t i = 0; i < sizeof(wbuf); i++)
+        wbuf[i] = i % 251;
+
+    fp = fopen("/tmp/libcbulk.txt", "w+");
+    ASSERT_EQ(!fp, 0);
+
+    /* small buffered writes around one larger than the buffer */
+    n = fwrite(wbuf, 1, 10, fp);
+    ASSERT_EQ(n, 10);
+    n = fwrite(wbuf + 10, 1, 2500, fp);
+    ASSERT_EQ(n, 2500);
+    n = fwrite(wbuf + 2510, 1, sizeof(wbuf) - 2510, fp);
+    ASSERT_EQ(n, sizeof(wbuf) - 2510);
+    rewind(fp);
+
+    /* small buffered reads around one read directly */
+    n = fread(rbuf, 1, 7, fp);
+    ASSERT_EQ(n, 7);
+    n = fread(rbuf + 7, 1, 2000, fp);
+    ASSERT_EQ(n, 2000);
+    n = ftell(fp);
+    ASSERT_EQ(n, 2007);
+    n = fread(rbuf + 2007, 1, sizeof(rbuf), fp);
+    ASSERT_EQ(n, sizeof(rbuf) - 2007);
+    ASSERT_TRUE(feof(fp));
+    ASSERT_EQ(memcmp(rbuf, wbuf, sizeof(rbuf)), 0);
+
+    fclose(fp);
+}
@@ -128,6 +128,25 @@ TEST_CASE(string_strncmp)
 
 TEST_CASE(string_strstr)
 {
+	char buf[200];
+	int i;
+
+	EXPECT_TRUE(strstr("abc", "") != NULL);
+	EXPECT_TRUE(strstr("", "a") == NULL);
+	EXPECT_TRUE(strstr("abc", "c") != NULL);
+	EXPECT_TRUE(strstr("abc", "abcd") == NULL);
+	EXPECT_TRUE(strstr("aab", "ab") != NULL);
+
+	/* long haystacks use the skip table */
+	for (i = 0; i < 199; i++)
+		buf[i] = 'a' + i % 7;
+	buf[199] = '\0';
+	EXPECT_TRUE(strstr(buf, "gabcdefg") == buf + 6);
+	EXPECT_TRUE(strstr(buf, "abcdefga") == buf);
+	EXPECT_TRUE(strstr(buf, "gfedcba") == NULL);
+	memcpy(buf + 190, "xyzzy", 5);
+	EXPECT_TRUE(strstr(buf, "xyzzy") == buf + 190);
+	EXPECT_TRUE(strstr(buf, "yzzyb") == NULL);
 }
 
 TEST_CASE(string_strchr)
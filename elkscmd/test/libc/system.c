@@ -2,9 +2,12 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <linuxmt/fs.h>
+#include <sched.h>
 #include <sys/ioctl.h>
 #include <sys/mount.h>
+#include <string.h>
 #include <unistd.h>
 
 TEST_CASE(system_ioctl)
@@ -51,6 +54,9 @@ TEST_CASE(system_dirent)
 {
     DIR *d;
     struct dirent *de;
+    off_t pos = 0;
+    int i, n;
+    char name[MAXNAMLEN+1];
 
     d = opendir("doesnotexist");
     EXPECT_EQ(errno, ENOENT);
@@ -70,10 +76,65 @@ TEST_CASE(system_dirent)
             break;
         }
     }
-    /* TODO rewinddir, seekdir, telldir */
+
+    /* more entries than one getdents call returns */
+    for (n = 0; readdir(d); n++)
+        continue;
+    rewinddir(d);
+    for (i = 0; readdir(d); i++) {
+        if (i == DIRBUF_ENTRIES + 1) {
+            pos = telldir(d);
+            de = readdir(d);
+            ASSERT_NE_P(de, NULL);
+            strcpy(name, de->d_name);
+            i++;
+        }
+    }
+    EXPECT_EQ(i, n);
+    if (n > DIRBUF_ENTRIES + 2) {
+        seekdir(d, pos);
+        de = readdir(d);
+        ASSERT_NE_P(de, NULL);
+        EXPECT_STREQ(de->d_name, name);
+    }
     ASSERT_SYS(closedir(d), 0, 0);
 }
 
+TEST_CASE(system_fsync)
+{
+	int fd, pfd[2];
+	char *name = "/tmp/fsync.tst";
+
+	ASSERT_SYS(fsync(999), -1, EBADF);
+
+	fd = open(name, O_CREAT|O_TRUNC|O_WRONLY|O_SYNC, 0666);
+	if (fd < 0)
+		return;                 /* read-only root */
+	EXPECT_EQ(write(fd, "data", 4), 4);
+	ASSERT_SYS(fsync(fd), 0, 0);
+	ASSERT_SYS(fdatasync(fd), 0, 0);
+	close(fd);
+	unlink(name);
+
+	ASSERT_SYS(pipe(pfd), 0, 0);
+	ASSERT_SYS(fsync(pfd[0]), -1, EINVAL);
+	close(pfd[0]);
+	close(pfd[1]);
+}
+
+TEST_CASE(system_sched)
+{
+	ASSERT_SYS(sched_getscheduler(0), SCHED_OTHER, 0);
+	ASSERT_SYS(sched_setscheduler(0, 2, NULL), -1, EINVAL);
+	ASSERT_SYS(sched_getscheduler(-1), -1, ESRCH);
+	if (geteuid() == 0) {
+		ASSERT_SYS(sched_setscheduler(0, SCHED_FIFO, NULL), 0, 0);
+		ASSERT_SYS(sched_getscheduler(0), SCHED_FIFO, 0);
+		ASSERT_SYS(sched_setscheduler(0, SCHED_OTHER, NULL), 0, 0);
+	}
+	ASSERT_SYS(sched_getscheduler(0), SCHED_OTHER, 0);
+}
+
 TEST_CASE(system_scandir)
 {
 	/* TODO */
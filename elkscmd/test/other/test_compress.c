@@ -0,0 +1,163 @@
+/*
+ * compress throughput benchmark
+ *
+ * Usage: test_compress [file]
+ *
+ * Compresses and decompresses file, or a generated text sample, with
+ * compress using its default 16 bit far tables, with -b12, and with
+ * compress_near built with the old 12 bit near tables. Reports the
+ * throughput of each direction and the compressed size, and checks
+ * that the data comes back unchanged.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#define SAMPLE		"/tmp/cbench"
+#define SAMPLE_KB	128
+#define PACKED		"/tmp/cbench.Z"
+#define UNPACKED	"/tmp/cbench.out"
+
+static char *runs[][3] = {
+	{ "compress",		NULL,	NULL },
+	{ "compress",		"-b12",	NULL },
+	{ "compress_near",	NULL,	NULL },
+};
+
+static char *words[] = {
+	"the ", "data ", "block ", "of ", "file ", "inode ", "buffer ", "and ",
+	"to ", "is ", "read ", "write ", "kernel ", "process ", "table ", "a ",
+	"segment ", "memory ", "with ", "in ", "for ", "driver ", "that ", "disk "
+};
+
+static unsigned long msecs(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000UL + tv.tv_usec / 1000;
+}
+
+/* write a text sample of somewhat repetitive words and line numbers */
+static int make_sample(char *name)
+{
+	FILE *fp;
+	char *w;
+	long n;
+	int i;
+
+	if ((fp = fopen(name, "w")) == NULL)
+		return -1;
+	srand(1);
+	for (n = 0, i = 0; n < SAMPLE_KB * 1024L; i++) {
+		if (i % 12 == 11)
+			n += fprintf(fp, "%d\n", rand() & 0x3ff);
+		else {
+			w = words[rand() % (sizeof(words) / sizeof(words[0]))];
+			fputs(w, fp);
+			n += strlen(w);
+		}
+	}
+	fclose(fp);
+	return 0;
+}
+
+/* run prog with options, stdin from in, stdout to out, returns msecs */
+static long run(char *prog, char *opt1, char *opt2, char *in, char *out)
+{
+	char *argv[5];
+	unsigned long start;
+	int pid, status, i = 0;
+
+	argv[i++] = prog;
+	if (opt1)
+		argv[i++] = opt1;
+	if (opt2)
+		argv[i++] = opt2;
+	argv[i] = NULL;
+
+	start = msecs();
+	if ((pid = fork()) == 0) {
+		close(0);
+		close(1);
+		if (open(in, O_RDONLY) != 0 || open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644) != 1)
+			_exit(126);
+		execvp(prog, argv);
+		_exit(127);
+	}
+	if (pid < 0 || waitpid(pid, &status, 0) < 0 || status)
+		return -1;
+	return msecs() - start;
+}
+
+static int same(char *a, char *b)
+{
+	char bufa[512], bufb[512];
+	int fa, fb, n, ret = 0;
+
+	fa = open(a, O_RDONLY);
+	fb = open(b, O_RDONLY);
+	if (fa >= 0 && fb >= 0) {
+		do {
+			n = read(fa, bufa, sizeof(bufa));
+			if (n < 0 || read(fb, bufb, sizeof(bufb)) != n || memcmp(bufa, bufb, n))
+				break;
+		} while (n > 0);
+		ret = (n == 0);
+	}
+	close(fa);
+	close(fb);
+	return ret;
+}
+
+static unsigned long kbps(long bytes, long ms)
+{
+	return ms > 0? (bytes / ms) * 1000 / 1024: 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct stat in, out;
+	char *file = SAMPLE;
+	long ctime, dtime;
+	int i, err = 0;
+
+	if (argc > 1)
+		file = argv[1];
+	else if (make_sample(file) < 0) {
+		perror(file);
+		return 1;
+	}
+	if (stat(file, &in) < 0) {
+		perror(file);
+		return 1;
+	}
+	printf("%s: %ld bytes\n", file, in.st_size);
+
+	for (i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+		ctime = run(runs[i][0], "-c", runs[i][1], file, PACKED);
+		dtime = run(runs[i][0], "-dc", NULL, PACKED, UNPACKED);
+		printf("%-14s %-5s ", runs[i][0], runs[i][1]? runs[i][1]: "");
+		if (ctime < 0 || dtime < 0 || stat(PACKED, &out) < 0) {
+			printf("failed\n");
+			err = 1;
+			continue;
+		}
+		printf("compress %4lu KB/s  decompress %4lu KB/s  size %3ld%%%s\n",
+			kbps(in.st_size, ctime), kbps(in.st_size, dtime),
+			out.st_size * 100 / in.st_size,
+			same(file, UNPACKED)? "": "  MISMATCH");
+		if (!same(file, UNPACKED))
+			err = 1;
+	}
+	unlink(PACKED);
+	unlink(UNPACKED);
+	if (argc < 2)
+		unlink(SAMPLE);
+	return err;
+}
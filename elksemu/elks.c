@@ -187,14 +187,30 @@ static int relocate(unsigned char *place_base, size_t rsize, unsigned cs,
 	fprintf(stderr, "Applying %#zx bytes of relocations to segment with "
 			"linear base %p\n", rsize, place_base);
 #endif
+	uint16_t val = 0, place = 0, run = 0;
+
 	while (rsize >= sizeof(struct minix_reloc)) {
 		struct minix_reloc reloc;
-		uint16_t val;
+		unsigned char *delta;
+		int k;
 		ssize_t r = read(fd, &reloc, sizeof reloc);
 		if (r != sizeof(reloc))
 			return r >= 0 ? -EINVAL : -errno;
+		if (run) {
+			/* byte deltas to the further places of a run */
+			delta = (unsigned char *)&reloc;
+			for (k = sizeof reloc; k && run; k--, run--) {
+				place += *delta++;
+				place_base[place] = (unsigned char)val;
+				place_base[(uint16_t)(place + 1)] =
+				    (unsigned char)(val >> 8);
+			}
+			rsize -= sizeof(struct minix_reloc);
+			continue;
+		}
 		switch (reloc.r_type) {
 		case R_SEGWORD:
+		case R_SEGRUN:
 			switch (reloc.r_symndx) {
 			case S_TEXT:
 				val = cs;	break;
@@ -205,17 +221,19 @@ static int relocate(unsigned char *place_base, size_t rsize, unsigned cs,
 			default:
 				return -EINVAL;
 			}
-			place_base[(uint16_t)reloc.r_vaddr] =
-			    (unsigned char)val;
-			place_base[(uint16_t)(reloc.r_vaddr + 1)] =
+			place = (uint16_t)reloc.r_vaddr;
+			place_base[place] = (unsigned char)val;
+			place_base[(uint16_t)(place + 1)] =
 			    (unsigned char)(val >> 8);
+			if (reloc.r_type == R_SEGRUN)
+				run = (uint16_t)(reloc.r_vaddr >> 16);
 			break;
 		default:
 			return -EINVAL;
 		}
 		rsize -= sizeof(struct minix_reloc);
 	}
-	return 0;
+	return run ? -EINVAL : 0;
 }
 
 static int load_elks(int fd, uint16_t argv_envp_bytes)
@@ -419,6 +437,7 @@ void run_elks()
 	/*
 	 *	Execute 8086 code for a while.
 	 */
+	static int setregs_ok;
 	pid_t child = elks_cpu.child;
 	int status;
 	if (!child)
@@ -441,6 +460,13 @@ void run_elks()
 			exit(255);
 		}
 		wait_for_child();
+		/*
+		 * Have syscall-stops reported as SIGTRAP | 0x80 in the wait
+		 * status, so the common case needs no PTRACE_GETSIGINFO.
+		 */
+		ptrace(PTRACE_SETOPTIONS, child, NULL,
+		       (void *)PTRACE_O_TRACESYSGOOD);
+		setregs_ok = 0;
 	}
 	if (ptrace(PTRACE_SETREGS, child, NULL, &elks_cpu.regs) != 0)
 	{
@@ -456,8 +482,10 @@ void run_elks()
 	 * To overcome this, after PTRACE_SETREGS, first do a sanity check
 	 * for the correct .cs and .ss values here.  If they are wrong,
 	 * arrange for the child to start at a trampoline which will jump to
-	 * the true ELKS program entry point.
+	 * the true ELKS program entry point.  A kernel that gets them
+	 * right once always does, so only the first resume is checked.
 	 */
+	if (!setregs_ok)
 	{
 		struct user_regs_struct tr_r;
 		if (ptrace(PTRACE_GETREGS, child, NULL, &tr_r) != 0)
@@ -476,6 +504,8 @@ void run_elks()
 				exit(255);
 			}
 		}
+		else
+			setregs_ok = 1;
 	}
 #endif
 	if (ptrace(PTRACE_SYSEMU, child, NULL, NULL) != 0)
@@ -495,7 +525,12 @@ void run_elks()
 	else if (WIFSTOPPED(status))
 	{
 		siginfo_t si;
-		if (WSTOPSIG(status) != SIGTRAP
+		if (WSTOPSIG(status) == (SIGTRAP | 0x80))
+		{	/* syscall-stop, reported directly */
+			elks_cpu.regs.xax = elks_cpu.regs.orig_xax;
+			elks_take_interrupt(0x80);
+		}
+		else if (WSTOPSIG(status) != SIGTRAP
 		  || ptrace(PTRACE_GETSIGINFO, child, NULL, &si) != 0
 		  || (si.si_code != SIGTRAP
 		      && si.si_code != (SIGTRAP | 0x80)))
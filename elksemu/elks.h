@@ -113,6 +113,8 @@ struct __attribute__((packed)) minix_reloc
 
 /* r_type values */
 #define R_SEGWORD	80
+#define R_SEGRUN	81	/* r_vaddr bits 16-31 = n further places, then (n+7)/8
+				   records of byte deltas from each place to the next */
 
 /* special r_symndx values */
 #define S_ABS		((uint16_t)-1U)
@@ -55,6 +55,19 @@ static int elks_closedir(int bx);
  * few programs which use inode numbers (eg gnu tar).
  */
 
+/*
+ * Buffers are passed to the host straight from the ELKS data segment, so
+ * a transfer only needs clipping to the end of the segment rather than
+ * splitting into small chunks.
+ */
+static int
+elks_buflen(int addr, int len)
+{
+    unsigned int room = 0x10000U - (addr & 0xFFFFU);
+
+    return (unsigned int)len > room ? (int)room : len;
+}
+
 static void
 squash_stat(struct stat *s, int bx)
 {
@@ -104,9 +117,7 @@ elks_read(int bx, int cx, int dx, int di, int si)
               bx, cx, dx));
     if (bx >= DIRBASE && bx < DIRBASE + DIRCOUNT)
         return elks_readdir(bx, cx, dx, di, si);
-    if (dx < 0 || dx > 1024)
-        dx = 1024;
-    return read(bx, ELKS_PTR(void, cx), dx);
+    return read(bx, ELKS_PTR(void, cx), elks_buflen(cx, dx));
 }
 
 #define sys_write elks_write
@@ -122,7 +133,7 @@ elks_write(int bx, int cx, int dx, int di, int si)
     {
         dbprintf(("write(%d, %d, %d)\n", bx, cx, dx));
     }
-    return write(bx, ELKS_PTR(void, cx), dx);
+    return write(bx, ELKS_PTR(void, cx), elks_buflen(cx, dx));
 }
 
 #define sys_open elks_open
@@ -25,8 +25,6 @@
 #include <fcntl.h>
 #include <pwd.h>
 
-#define PWD_BUFFER_SIZE 64
-
 /*
  * This isn't as flash as my previous version -- it doesn't dynamically scale
  * down the gecos on too-long lines, but it also makes fewer syscalls, so
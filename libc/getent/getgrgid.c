@@ -27,14 +27,5 @@
 struct group *
 getgrgid(const gid_t gid)
 {
-    struct group *group;
-
-    setgrent();
-    while ((group = getgrent()) != NULL) {
-        if (group->gr_gid == gid) {
-            break;
-        }
-    }
-
-    return group;
+    return __grlookup(NULL, gid);
 }
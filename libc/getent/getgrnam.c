@@ -28,19 +28,10 @@
 struct group *
 getgrnam(const char *name)
 {
-    struct group *group;
-
     if (name == NULL) {
         errno = EINVAL;
         return NULL;
     }
 
-    setgrent();
-    while ((group = getgrent()) != NULL) {
-        if (!strcmp(group->gr_name, name)) {
-            break;
-        }
-    }
-
-    return group;
+    return __grlookup(name, 0);
 }
@@ -28,19 +28,10 @@
 struct passwd *
 getpwnam(const char *name)
 {
-    struct passwd *passwd;
-
     if (!name) {
         errno = EINVAL;
         return NULL;
     }
 
-    setpwent();
-    while ((passwd = getpwent()) != NULL) {
-        if (!strcmp(passwd->pw_name, name)) {
-            break;
-        }
-    }
-
-    return passwd;
+    return __pwlookup(name, 0);
 }
@@ -27,14 +27,5 @@
 struct passwd *
 getpwuid(uid_t uid)
 {
-    struct passwd *passwd;
-
-    setpwent();
-    while ((passwd = getpwent()) != NULL) {
-        if (passwd->pw_uid == uid) {
-            break;
-        }
-    }
-
-    return passwd;
+    return __pwlookup(NULL, uid);
 }
@@ -8,6 +8,7 @@
 #include <paths.h>
 
 static int __grfd = -1;     /* file descriptor for group file */
+int __grgen;                /* bumped to discard cached lookups */
 
 void
 setgrent(void)
@@ -24,6 +25,7 @@ endgrent(void)
         close(__grfd);
         __grfd = -1;
     }
+    __grgen++;
 }
 
 struct group *
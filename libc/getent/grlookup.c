@@ -0,0 +1,93 @@
+/*
+ * grlookup.c - cached group lookups for getgrnam/getgrgid
+ *
+ * The last couple of groups found are kept, along with gids known not
+ * to be in the group file, so ls -l doesn't reread the group file for
+ * every entry. endgrent discards the cache.
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <grp.h>
+#include "config-grp.h"
+
+#define GRCACHE     2           /* number of cached lookups */
+
+#define FOUND       1
+#define MISSING     2           /* gid known not to be present */
+
+struct grent {
+    struct group gr;
+    char *mem[GR_MAX_MEMBERS + 1];
+    char buf[GR_MAX_LINE_LEN];
+};
+
+static struct grcache {
+    struct grent ent;
+    char state;
+} cache[GRCACHE];
+
+static int nextent;
+static int cachegen;
+
+static struct grent result;
+
+/* copy an entry whose strings all lie in the buffer starting at gr_name */
+static struct group *
+copygr(struct grent *to, struct group *from)
+{
+    char *base = from->gr_name;
+    char **mp;
+    int i;
+
+    memcpy(to->buf, base, GR_MAX_LINE_LEN);
+    to->gr.gr_name = to->buf;
+    to->gr.gr_passwd = to->buf + (from->gr_passwd - base);
+    to->gr.gr_gid = from->gr_gid;
+    for (i = 0, mp = from->gr_mem; *mp && i < GR_MAX_MEMBERS; i++, mp++)
+        to->mem[i] = to->buf + (*mp - base);
+    to->mem[i] = NULL;
+    to->gr.gr_mem = to->mem;
+    return &to->gr;
+}
+
+struct group *
+__grlookup(const char *name, gid_t gid)
+{
+    struct grcache *c;
+    struct group *group;
+
+    if (cachegen != __grgen) {
+        for (c = cache; c < &cache[GRCACHE]; c++)
+            c->state = 0;
+        cachegen = __grgen;
+    }
+
+    for (c = cache; c < &cache[GRCACHE]; c++) {
+        if (name) {
+            if (c->state == FOUND && !strcmp(c->ent.gr.gr_name, name))
+                return copygr(&result, &c->ent.gr);
+        } else if (c->state && c->ent.gr.gr_gid == gid)
+            return (c->state == FOUND)? copygr(&result, &c->ent.gr): NULL;
+    }
+
+    setgrent();
+    while ((group = getgrent()) != NULL) {
+        if (name? !strcmp(group->gr_name, name): group->gr_gid == gid)
+            break;
+    }
+
+    if (!group && name)
+        return NULL;
+    c = &cache[nextent];
+    if (++nextent >= GRCACHE)
+        nextent = 0;
+    if (!group) {
+        c->state = MISSING;
+        c->ent.gr.gr_gid = gid;
+        return NULL;
+    }
+    c->state = FOUND;
+    copygr(&c->ent, group);
+    return group;
+}
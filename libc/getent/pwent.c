@@ -25,7 +25,8 @@
 #include <fcntl.h>
 #include <paths.h>
 
-static int __pwfd = -1;     /* file descriptor for passwd file */
+int __pwfd = -1;            /* file descriptor for passwd file */
+int __pwgen;                /* bumped to discard cached lookups */
 
 void
 setpwent(void)
@@ -42,6 +43,7 @@ endpwent(void)
         close(__pwfd);
         __pwfd = -1;
     }
+    __pwgen++;
 }
 
 struct passwd *
@@ -0,0 +1,160 @@
+/*
+ * pwlookup.c - cached and indexed passwd lookups for getpwnam/getpwuid
+ *
+ * The last few entries found are kept, along with uids known not to be
+ * in the passwd file, since programs like ls -l look up the same few
+ * users over and over. Otherwise the hashed index built by pwd_mkdb is
+ * used when present and newer than the passwd file, falling back to
+ * reading the passwd file from the start. endpwent discards the cache.
+ *
+ * Entries are copied out to a static result, so callers may modify it
+ * as before without changing the cache.
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <paths.h>
+#include <sys/stat.h>
+
+#define PWCACHE     4           /* number of cached lookups */
+
+#define FOUND       1
+#define MISSING     2           /* uid known not to be present */
+
+static struct pwcache {
+    struct passwd pw;
+    char state;
+    char buf[PWD_BUFFER_SIZE];
+} cache[PWCACHE];
+
+static int nextent;
+static int cachegen;
+static int dbfd = -2;           /* -2 not yet opened, -1 no index */
+
+static struct passwd result;
+static char resbuf[PWD_BUFFER_SIZE];
+
+unsigned int
+__pwdb_hash(const char *name)
+{
+    unsigned int h = 0;
+
+    while (*name)
+        h = (h << 5) + h + (unsigned char)*name++;
+    return h;
+}
+
+/* copy an entry whose strings all lie in the buffer starting at pw_name */
+static struct passwd *
+copypw(struct passwd *to, char *buf, struct passwd *from)
+{
+    char *base = from->pw_name;
+
+    memcpy(buf, base, PWD_BUFFER_SIZE);
+    *to = *from;
+    to->pw_name = buf;
+    to->pw_passwd = buf + (from->pw_passwd - base);
+    to->pw_gecos = buf + (from->pw_gecos - base);
+    to->pw_dir = buf + (from->pw_dir - base);
+    to->pw_shell = buf + (from->pw_shell - base);
+    return to;
+}
+
+/*
+ * Look up in the hashed index, returning 0 if it is missing or out of
+ * date. Otherwise *pp is set to the entry found or NULL.
+ */
+static int
+dblookup(const char *name, uid_t uid, struct passwd **pp)
+{
+    struct passwd *passwd;
+    struct pwdb_hdr hdr;
+    struct pwdb_slot slot[PWDB_PROBE];
+    struct stat st;
+    unsigned short key;
+    long pos;
+    int i;
+
+    if (dbfd == -2)
+        dbfd = open(_PATH_PWDB, O_RDONLY);
+    if (dbfd < 0)
+        return 0;
+    if (lseek(dbfd, 0L, SEEK_SET) != 0 ||
+        read(dbfd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+        hdr.magic != PWDB_MAGIC || fstat(__pwfd, &st) < 0 ||
+        st.st_size != hdr.size || st.st_mtime != hdr.mtime)
+        return 0;
+
+    key = name? __pwdb_hash(name): uid;
+    pos = sizeof(hdr) + (long)(key & (hdr.nslots - 1)) * sizeof(struct pwdb_slot);
+    if (name)
+        pos += (long)(hdr.nslots + PWDB_PROBE - 1) * sizeof(struct pwdb_slot);
+    if (lseek(dbfd, pos, SEEK_SET) != pos ||
+        read(dbfd, slot, sizeof(slot)) != sizeof(slot))
+        return 0;
+
+    /* slots are filled in passwd file order, so the first match wins */
+    *pp = NULL;
+    for (i = 0; i < PWDB_PROBE && slot[i].off; i++) {
+        if (slot[i].key != key)
+            continue;
+        lseek(__pwfd, (long)(slot[i].off - 1), SEEK_SET);
+        passwd = __getpwent(__pwfd);
+        if (passwd && (name? !strcmp(passwd->pw_name, name): passwd->pw_uid == uid)) {
+            *pp = passwd;
+            break;
+        }
+    }
+    return 1;
+}
+
+struct passwd *
+__pwlookup(const char *name, uid_t uid)
+{
+    struct pwcache *c;
+    struct passwd *passwd;
+
+    if (cachegen != __pwgen) {
+        for (c = cache; c < &cache[PWCACHE]; c++)
+            c->state = 0;
+        if (dbfd >= 0)
+            close(dbfd);
+        dbfd = -2;
+        cachegen = __pwgen;
+    }
+
+    for (c = cache; c < &cache[PWCACHE]; c++) {
+        if (name) {
+            if (c->state == FOUND && !strcmp(c->pw.pw_name, name))
+                return copypw(&result, resbuf, &c->pw);
+        } else if (c->state && c->pw.pw_uid == uid)
+            return (c->state == FOUND)? copypw(&result, resbuf, &c->pw): NULL;
+    }
+
+    setpwent();
+    if (__pwfd < 0)
+        return NULL;
+    if (!dblookup(name, uid, &passwd)) {
+        setpwent();
+        while ((passwd = __getpwent(__pwfd)) != NULL) {
+            if (name? !strcmp(passwd->pw_name, name): passwd->pw_uid == uid)
+                break;
+        }
+    }
+
+    if (!passwd && name)
+        return NULL;
+    c = &cache[nextent];
+    if (++nextent >= PWCACHE)
+        nextent = 0;
+    if (!passwd) {
+        c->state = MISSING;
+        c->pw.pw_uid = uid;
+        return NULL;
+    }
+    c->state = FOUND;
+    copypw(&c->pw, c->buf, passwd);
+    return passwd;
+}
@@ -5,5 +5,22 @@
 
 #define LIBC_ASM_MEMCPY
 #define LIBC_ASM_MEMSET
+#define LIBC_ASM_MEMMOVE
+#define LIBC_ASM_MEMCHR
 #define LIBC_ASM_STRCPY
 #define LIBC_ASM_STRLEN
+#define LIBC_ASM_STRCHR
+#define LIBC_ASM_STRRCHR
+
+// Far pointer routines take their arguments on the stack only
+#ifndef __IA16_CALLCVT_REGPARMCALL
+#define LIBC_ASM_FMEMCPY
+#define LIBC_ASM_FMEMSET
+#endif
+
+// Word align the destination of block moves and fills in 186 and later
+// builds, where an odd word access costs an extra bus cycle; the 8088
+// has a byte bus and gains nothing from it
+#ifdef __IA16_ARCH_ANY_186
+#define LIBC_ASM_ALIGN_DEST
+#endif
@@ -9,15 +9,18 @@
 /* Directory stream type from opendir().  */
 typedef struct {
     int dd_fd;                  /* file descriptor */
-    int dd_loc;                 /* offset in buffer UNUSED */
-    int dd_size;                /* # of valid entries in buffer UNUSED */
+    int dd_loc;                 /* index of next entry in buffer */
+    int dd_size;                /* # of valid entries in buffer */
     struct dirent *dd_buf;      /* -> directory buffer */
 } DIR;
 
+#define DIRBUF_ENTRIES  12      /* entries read by each getdents call */
+
 DIR *opendir (const char *dname);
 int closedir(DIR * dirp);
 struct dirent *readdir(DIR * dirp);
 int _readdir(int fd, struct dirent *buf, int count);
+int _getdents(int fd, struct dirent *buf, size_t nbytes);
 void rewinddir(DIR * dirp);
 void seekdir(DIR * dirp, off_t pos);
 off_t telldir(DIR * dirp);
@@ -21,7 +21,9 @@ struct group * getgrgid(const gid_t gid);
 struct group * getgrnam(const char * name);
 
 #ifdef __LIBC__
+extern int __grgen;
 struct group * __getgrent(int grp_fd);
+struct group * __grlookup(const char *name, gid_t gid);
 #endif
 
 #endif /* __GRP_H */
@@ -32,4 +32,9 @@ extern void *(*__alloca_alloc)(size_t);
 /* alloc from main memory */
 void __far *fmemalloc(unsigned long size);
 
+/* far heap in main memory */
+void __far *fmalloc(size_t size);
+void ffree(void __far *ptr);
+void __far *frealloc(void __far *ptr, size_t size);
+
 #endif
@@ -2,3 +2,4 @@
 /* Absolute file name for network data base files*/
 #define _PATH_HOSTS		"/etc/hosts"
 #define _PATH_RESOLV	"/etc/resolv.cfg"
+#define _PATH_DNSCACHE	"/tmp/dns.cache"
@@ -0,0 +1,6 @@
+#ifndef _NETINET_TCP_H_
+#define _NETINET_TCP_H_
+
+#include <netinet/in.h>		/* IPPROTO_TCP, TCP_NODELAY */
+
+#endif /* _NETINET_TCP_H_ */
@@ -18,6 +18,7 @@
 #define _PATH_ISSUE     "/etc/issue"
 #define _PATH_MOTD      "/etc/motd"
 #define _PATH_PASSWD    "/etc/passwd"
+#define _PATH_PWDB      "/etc/pwd.db"
 #define _PATH_ERRSTRING "/etc/perror"
 #define _PATH_TERMCAP   "/etc/termcap"
 #define _PATH_LOCALE    "/lib/locale"
@@ -0,0 +1,10 @@
+#ifndef __POLL_H
+#define __POLL_H
+#include <features.h>
+#include __SYSINC__(poll.h)
+
+typedef unsigned int nfds_t;
+
+int poll (struct pollfd *__fds, nfds_t __nfds, int __timeout);
+
+#endif
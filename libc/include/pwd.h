@@ -24,8 +24,35 @@ struct passwd * getpwuid(uid_t);
 struct passwd * getpwnam(const char *);
 int putpwent (const struct passwd * p, FILE * stream);
 
+/* Hashed index of the passwd file, built by pwd_mkdb */
+#define PWDB_MAGIC	0x4450	/* "PD" */
+#define PWDB_PROBE	8	/* slots searched from the hashed position */
+
+struct pwdb_hdr
+{
+  unsigned short magic;
+  unsigned short nslots;	/* hash table size, a power of two */
+  long size;			/* passwd file size and time when built */
+  long mtime;
+};
+
+/* The uid table and then the name table follow the header, each with
+   nslots + PWDB_PROBE - 1 entries so probes never wrap.  */
+struct pwdb_slot
+{
+  unsigned short key;		/* uid or __pwdb_hash of name */
+  unsigned short off;		/* offset of line in passwd + 1, 0 if empty */
+};
+
+unsigned int __pwdb_hash(const char *name);
+
 #ifdef __LIBC__
+#define PWD_BUFFER_SIZE 64
+
+extern int __pwfd;
+extern int __pwgen;
 struct passwd * __getpwent(int passwd_fd);
+struct passwd * __pwlookup(const char *name, uid_t uid);
 #endif
 
 char *getpass(char *prompt);
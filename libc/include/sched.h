@@ -0,0 +1,19 @@
+#ifndef _SCHED_H
+#define _SCHED_H
+
+#include <features.h>
+#include <sys/types.h>
+
+/* scheduling policies, as in the kernel */
+#define SCHED_OTHER	0
+#define SCHED_FIFO	1
+
+/* SCHED_FIFO has a single priority level */
+struct sched_param {
+	int sched_priority;
+};
+
+int sched_setscheduler(pid_t pid, int policy, const struct sched_param *param);
+int sched_getscheduler(pid_t pid);
+
+#endif
@@ -12,7 +12,14 @@ extern const char * const sys_siglist[];
 #define sig_t sighandler_t
 #endif
 
+struct sigaction {
+	sighandler_t sa_handler;
+	sigset_t sa_mask;		/* not supported */
+	unsigned long sa_flags;		/* only SA_RESETHAND used */
+};
+
 sighandler_t signal(int number, sighandler_t pointer);
+int sigaction(int number, const struct sigaction *act, struct sigaction *oact);
 int kill (pid_t pid, int sig);
 int killpg (int pid, int sig);
 
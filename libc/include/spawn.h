@@ -0,0 +1,54 @@
+#ifndef __SPAWN_H
+#define __SPAWN_H
+
+#include <sys/types.h>
+
+/*
+ * Process spawning without copying the parent's data segment.
+ * The child runs on the parent's memory until it execs,
+ * so file actions are kept in fixed size tables, and path strings
+ * passed to addopen must remain valid until posix_spawn returns.
+ * Signal handlers are always reset to SIG_DFL by exec on ELKS.
+ */
+
+#define POSIX_SPAWN_SETSID	0x01	/* setsid() in child, before file actions */
+
+#define POSIX_SPAWN_MAX_ACTIONS	8
+
+struct __spawn_action {
+	unsigned char	cmd;		/* open, close or dup2 */
+	unsigned char	fd;
+	int		arg;		/* oflag or dup2 source fd */
+	mode_t		mode;
+	const char *	path;
+};
+
+typedef struct {
+	int		count;
+	struct __spawn_action actions[POSIX_SPAWN_MAX_ACTIONS];
+} posix_spawn_file_actions_t;
+
+typedef struct {
+	short		flags;
+} posix_spawnattr_t;
+
+int posix_spawn(pid_t *pid, const char *path,
+	const posix_spawn_file_actions_t *file_actions,
+	const posix_spawnattr_t *attrp, char *const argv[], char *const envp[]);
+int posix_spawnp(pid_t *pid, const char *file,
+	const posix_spawn_file_actions_t *file_actions,
+	const posix_spawnattr_t *attrp, char *const argv[], char *const envp[]);
+
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t *fa);
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t *fa);
+int posix_spawn_file_actions_addopen(posix_spawn_file_actions_t *fa, int fd,
+	const char *path, int oflag, mode_t mode);
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t *fa, int fd);
+int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t *fa, int fd, int newfd);
+
+int posix_spawnattr_init(posix_spawnattr_t *attr);
+int posix_spawnattr_destroy(posix_spawnattr_t *attr);
+int posix_spawnattr_getflags(const posix_spawnattr_t *attr, short *flags);
+int posix_spawnattr_setflags(posix_spawnattr_t *attr, short flags);
+
+#endif /* __SPAWN_H */
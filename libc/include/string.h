@@ -29,6 +29,7 @@ int memcmp(const void*, const void*, size_t);
 void * memmove(void*, const void*, size_t);
 
 void __far *fmemset(void __far *buf, int c, size_t l);
+void __far *fmemcpy(void __far *dest, const void __far *src, size_t l);
 
 /* Error messages */
 char * strerror(int);
@@ -0,0 +1,18 @@
+#ifndef _SYS_RESOURCE_H
+#define _SYS_RESOURCE_H
+
+#include <features.h>
+#include <sys/types.h>
+
+/* which values for getpriority/setpriority */
+#define PRIO_PROCESS	0
+#define PRIO_PGRP	1
+#define PRIO_USER	2
+
+#define PRIO_MIN	(-20)
+#define PRIO_MAX	20
+
+int getpriority(int which, int who);
+int setpriority(int which, int who, int prio);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef __SYS_SENDFILE_H
+#define __SYS_SENDFILE_H
+
+#include <sys/types.h>
+
+ssize_t sendfile (int __out_fd, int __in_fd, off_t * __offset, size_t __count);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef __SYS_SHM_H
+#define __SYS_SHM_H
+
+#include <features.h>
+#include <sys/types.h>
+#include __SYSINC__(shm.h)
+
+/* attach shared segment of key, creating it with size bytes if IPC_CREAT */
+void __far *fshmat(int key, unsigned long size, int flags);
+
+/* detach shared segment */
+int fshmdt(void __far *addr);
+
+#endif
@@ -2,6 +2,7 @@
 #ifndef __SYS_SOCKET_H
 #define __SYS_SOCKET_H
 #include <features.h>
+#include <sys/types.h>
 #include __SYSINC__(socket.h)
 
 typedef unsigned int socklen_t;
@@ -13,6 +14,10 @@ int listen (int socket, int backlog);
 int socket (int domain, int type, int protocol);
 int setsockopt(int socket, int level, int option_name, const void *option_value,
 	socklen_t option_len);
+ssize_t sendto (int socket, const void *message, size_t length, int flags,
+	const struct sockaddr *dest_addr, socklen_t dest_len);
+ssize_t recvfrom (int socket, void * restrict buffer, size_t length, int flags,
+	struct sockaddr * restrict address, socklen_t * restrict address_len);
 int getsockname (int socket, struct sockaddr * restrict address,
 	socklen_t * restrict address_len);
 int getpeername (int socket, struct sockaddr * restrict address,
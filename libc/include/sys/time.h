@@ -1,4 +1,21 @@
+#ifndef _SYS_TIME_H
+#define _SYS_TIME_H
+
 #include <time.h>
 
+struct itimerval {
+	struct timeval it_interval;	/* timer reload value */
+	struct timeval it_value;	/* time until next expiry */
+};
+
+#define ITIMER_REAL	0		/* only ITIMER_REAL is supported */
+#define ITIMER_VIRTUAL	1
+#define ITIMER_PROF	2
+
 int gettimeofday (struct timeval * restrict tp, void * restrict tzp);
 int settimeofday (const struct timeval *tp, const struct timezone *tzp);
+int getitimer (int which, struct itimerval *value);
+int setitimer (int which, const struct itimerval * restrict value,
+	struct itimerval * restrict ovalue);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef __SYS_UIO_H
+#define __SYS_UIO_H
+
+#include <features.h>
+#include <sys/types.h>
+#include __SYSINC__(uio.h)
+
+ssize_t readv (int __fd, const struct iovec * __iov, int __iovcnt);
+ssize_t writev (int __fd, const struct iovec * __iov, int __iovcnt);
+
+#endif
@@ -12,10 +12,13 @@
 
 ssize_t read(int __fd, void * __buf, size_t __nbytes);
 ssize_t write(int __fd, const void * __buf, size_t __n);
+ssize_t pread(int __fd, void * __buf, size_t __nbytes, off_t __offset);
+ssize_t pwrite(int __fd, const void * __buf, size_t __n, off_t __offset);
 int     pipe(int __pipedes[2]);
 unsigned int alarm(unsigned int __seconds);
 unsigned int sleep(unsigned int __seconds);
 int     pause(void);
+int     nice(int __incr);
 char*   crypt(const char *__key, const char *__salt);
 
 #ifndef SEEK_SET
@@ -85,6 +88,8 @@ uid_t geteuid(void);
 
 char * getcwd (char * buf, size_t size);
 void sync(void);
+int fsync(int __fd);
+int fdatasync(int __fd);
 int usleep(unsigned long useconds);
 unsigned alarm(unsigned seconds);
 
@@ -0,0 +1,220 @@
+/*
+ * Far heap: fmalloc/ffree/frealloc
+ *
+ * Main memory is obtained from the kernel with fmemalloc in arenas of up
+ * to ARENA bytes, each divided by a first fit allocator. Every block
+ * starts with a one word header holding its size, with INUSE set while
+ * allocated. The free blocks of an arena are linked in address order
+ * through the word following the header and are coalesced with their
+ * neighbours when freed. There is no system call to release main memory,
+ * so arenas are kept until the process exits.
+ */
+#include <malloc.h>
+#include <string.h>
+#include <errno.h>
+
+#define ARENA		0xFFF0U		/* largest arena, whole paragraphs*/
+#define MAXARENAS	16
+#define HDR		2
+#define MINBLK		4		/* header and free link*/
+#define INUSE		1
+#define NIL		1		/* end of free list, never a block offset*/
+
+#define _MK_FP(seg,off)	((void __far *)((((unsigned long)(seg)) << 16) | (off)))
+#define _FP_SEG(fp)	((unsigned int)((unsigned long)(void __far *)(fp) >> 16))
+#define _FP_OFF(fp)	((unsigned int)(unsigned long)(void __far *)(fp))
+
+/* header and free link words at seg:off*/
+#define W(seg,off)	(*(unsigned int __far *)_MK_FP(seg, off))
+#define SIZE(seg,off)	W(seg, off)
+#define LINK(seg,off)	W(seg, (off) + 2)
+
+struct arena {
+	unsigned int seg;
+	unsigned int free;		/* first free block offset or NIL*/
+	unsigned int maxfree;		/* no free block is larger than this*/
+};
+
+static struct arena arenas[MAXARENAS];
+static int narenas;
+
+static struct arena *find_arena(unsigned int seg)
+{
+	struct arena *a;
+
+	for (a = arenas; a < &arenas[narenas]; a++)
+		if (a->seg == seg)
+			return a;
+	return NULL;
+}
+
+static struct arena *new_arena(unsigned int sz)
+{
+	struct arena *a;
+	void __far *p;
+	unsigned int n = ARENA;
+
+	if (narenas >= MAXARENAS)
+		return NULL;
+	p = fmemalloc(n);
+	if (!p) {
+		/* try for just enough when main memory is tight*/
+		n = (sz + 15) & ~15;
+		if (!(p = fmemalloc(n)))
+			return NULL;
+	}
+	a = &arenas[narenas++];
+	a->seg = _FP_SEG(p);
+	a->free = 0;
+	a->maxfree = n;
+	SIZE(a->seg, 0) = n;
+	LINK(a->seg, 0) = NIL;
+	return a;
+}
+
+/* first fit in arena, allocating from the top of a split block*/
+static unsigned int fit(struct arena *a, unsigned int sz)
+{
+	unsigned int seg = a->seg;
+	unsigned int off, prev = NIL, bs, max = 0;
+
+	for (off = a->free; off != NIL; prev = off, off = LINK(seg, off)) {
+		bs = SIZE(seg, off);
+		if (bs < sz) {
+			if (bs > max)
+				max = bs;
+			continue;
+		}
+		if (bs - sz >= MINBLK) {
+			SIZE(seg, off) = bs - sz;
+			off += bs - sz;
+		} else {
+			sz = bs;
+			if (prev == NIL)
+				a->free = LINK(seg, off);
+			else
+				LINK(seg, prev) = LINK(seg, off);
+		}
+		SIZE(seg, off) = sz | INUSE;
+		return off;
+	}
+	a->maxfree = max;
+	return NIL;
+}
+
+/* return block to arena free list, coalescing with neighbours*/
+static void release(struct arena *a, unsigned int off)
+{
+	unsigned int seg = a->seg;
+	unsigned int prev = NIL, next, sz;
+
+	sz = SIZE(seg, off) & ~INUSE;
+	for (next = a->free; next != NIL && next < off; next = LINK(seg, next))
+		prev = next;
+
+	if (next != NIL && off + sz == next) {
+		sz += SIZE(seg, next);
+		LINK(seg, off) = LINK(seg, next);
+	} else
+		LINK(seg, off) = next;
+	SIZE(seg, off) = sz;
+
+	if (prev == NIL)
+		a->free = off;
+	else if (prev + SIZE(seg, prev) == off) {
+		sz += SIZE(seg, prev);
+		SIZE(seg, prev) = sz;
+		LINK(seg, prev) = LINK(seg, off);
+	} else
+		LINK(seg, prev) = off;
+
+	if (sz > a->maxfree)
+		a->maxfree = sz;
+}
+
+void __far *fmalloc(size_t size)
+{
+	struct arena *a;
+	unsigned int sz, off;
+
+	if (size == 0)
+		return NULL;
+	if (size > ARENA - HDR) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	sz = (size + HDR + 1) & ~1;
+	if (sz < MINBLK)
+		sz = MINBLK;
+
+	for (a = arenas; a < &arenas[narenas]; a++) {
+		if (a->maxfree >= sz && (off = fit(a, sz)) != NIL)
+			return _MK_FP(a->seg, off + HDR);
+	}
+	if ((a = new_arena(sz)) == NULL || (off = fit(a, sz)) == NIL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	return _MK_FP(a->seg, off + HDR);
+}
+
+void ffree(void __far *ptr)
+{
+	struct arena *a;
+
+	if (ptr == NULL)
+		return;
+	if ((a = find_arena(_FP_SEG(ptr))) != NULL)
+		release(a, _FP_OFF(ptr) - HDR);
+}
+
+void __far *frealloc(void __far *ptr, size_t size)
+{
+	struct arena *a;
+	void __far *nptr;
+	unsigned int seg, off, sz, osz, next, prev;
+
+	if (ptr == NULL)
+		return fmalloc(size);
+	if (size > ARENA - HDR) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	seg = _FP_SEG(ptr);
+	if ((a = find_arena(seg)) == NULL)
+		return NULL;
+	off = _FP_OFF(ptr) - HDR;
+	osz = SIZE(seg, off) & ~INUSE;
+	sz = (size + HDR + 1) & ~1;
+	if (sz < MINBLK)
+		sz = MINBLK;
+
+	if (sz > osz) {
+		/* grow in place into a following free block*/
+		prev = NIL;
+		for (next = a->free; next != NIL && next < off + osz; next = LINK(seg, next))
+			prev = next;
+		if (next == off + osz && osz + SIZE(seg, next) >= sz) {
+			if (prev == NIL)
+				a->free = LINK(seg, next);
+			else
+				LINK(seg, prev) = LINK(seg, next);
+			osz += SIZE(seg, next);
+			SIZE(seg, off) = osz | INUSE;
+		} else {
+			if ((nptr = fmalloc(size)) == NULL)
+				return NULL;
+			fmemcpy(nptr, ptr, osz - HDR);
+			release(a, off);
+			return nptr;
+		}
+	}
+
+	/* return any usable tail*/
+	if (osz - sz >= MINBLK) {
+		SIZE(seg, off) = sz | INUSE;
+		SIZE(seg, off + sz) = (osz - sz) | INUSE;
+		release(a, off + sz);
+	}
+	return ptr;
+}
@@ -0,0 +1,24 @@
+#include <sys/shm.h>
+
+#define _FP_SEG(fp)     ((unsigned)((unsigned long)(void __far *)(fp) >> 16))
+#define _MK_FP(seg,off) ((void __far *)((((unsigned long)(seg)) << 16) | (off)))
+
+int _shmat(int key, unsigned int paras, int flags, unsigned short *pseg);
+int _shmdt(unsigned short seg);
+
+/* attach shared segment of key, creating it with size bytes if IPC_CREAT */
+void __far *fshmat(int key, unsigned long size, int flags)
+{
+    unsigned short seg;
+    unsigned int paras = (unsigned int)((size + 15) >> 4);
+
+    if (_shmat(key, paras, flags, &seg))
+        return 0;
+    return _MK_FP(seg, 0);
+}
+
+/* detach shared segment */
+int fshmdt(void __far *addr)
+{
+    return _shmdt(_FP_SEG(addr));
+}
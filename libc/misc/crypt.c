@@ -16,22 +16,49 @@
  *  RDB.
  */
 
+/*
+ * The round sums are taken from a table and the 32-bit shifts
+ * are done on the 16-bit halves, so that each is a single shift by CL per
+ * word on the 8086 instead of a bit at a time loop over both words.
+ * The result is unchanged, passwords already in /etc/passwd still match.
+ */
+
 #include <stdlib.h>
 #include <string.h>
 
+#define CYCLES  32
+
+/* sum for each cycle, the multiples of the golden ratio delta 0x9e3779b9 */
+static const unsigned long sums[CYCLES] = {
+    0x9e3779b9, 0x3c6ef372, 0xdaa66d2b, 0x78dde6e4,
+    0x1715609d, 0xb54cda56, 0x5384540f, 0xf1bbcdc8,
+    0x8ff34781, 0x2e2ac13a, 0xcc623af3, 0x6a99b4ac,
+    0x08d12e65, 0xa708a81e, 0x454021d7, 0xe3779b90,
+    0x81af1549, 0x1fe68f02, 0xbe1e08bb, 0x5c558274,
+    0xfa8cfc2d, 0x98c475e6, 0x36fbef9f, 0xd5336958,
+    0x736ae311, 0x11a25cca, 0xafd9d683, 0x4e11503c,
+    0xec48c9f5, 0x8a8043ae, 0x28b7bd67, 0xc6ef3720
+};
+
+#define HI(x)   ((unsigned short)((x) >> 16))
+#define LO(x)   ((unsigned short)(x))
+#define MK(h,l) (((unsigned long)(h) << 16) | (unsigned short)(l))
+
+/* (x << 4) and (x >> 5) using 16-bit shifts only */
+#define SHL4(x) MK((HI(x) << 4) | (LO(x) >> 12), LO(x) << 4)
+#define SHR5(x) MK(HI(x) >> 5, (LO(x) >> 5) | (HI(x) << 11))
+
 char *
 crypt(const char * key, const char * salt)
 {
-  /* n is the number of cycles (2 rounds/cycle),
-     delta is a golden # derivative,
-     k is the key, v is the data to be encrypted. */
+  /* k is the key, v is the data to be encrypted. */
 
-  unsigned long v[2], sum=0, delta=0x9e3779b9, k[4];
-  int n=32, i, j;
+  unsigned long v0, v1, sum, k[4];
+  int n, i, j;
   static char rkey[16];
 
   /* Our constant string will be a string of zeros .. */
-  v[0]=v[1]=k[0]=k[1]=k[2]=k[3]=0;
+  v0=v1=0;
   for(i=0;i<16;i++) rkey[i]=0;
 
   rkey[0]=*salt;
@@ -41,26 +68,28 @@ crypt(const char * key, const char * salt)
 
   memcpy(k, rkey, 4*sizeof(long));
 
-  while (n-->0) {
-    sum += delta;
-    v[0] += ((v[1]<<4)+k[0]) ^ (v[1]+sum) ^ ((v[1]>>5)+k[1]);
-    v[1] += ((v[0]<<4)+k[2]) ^ (v[0]+sum) ^ ((v[0]>>5)+k[3]);
+  /* 2 rounds per cycle */
+  for (n=0; n<CYCLES; n++) {
+    sum = sums[n];
+    v0 += (SHL4(v1)+k[0]) ^ (v1+sum) ^ (SHR5(v1)+k[1]);
+    v1 += (SHL4(v0)+k[2]) ^ (v0+sum) ^ (SHR5(v0)+k[3]);
   }
 
   /* Remove any trace of key */
   for(i=0;i<16;i++) rkey[i]=0;
+  memset(k, 0, sizeof(k));
   *rkey=*salt; rkey[1]=salt[1];
 
   /* Now we need to unpack the bits and map it to "A-Za-z0-9./" for printing
      in /etc/passwd */
-  sum=v[0];
+  sum=v0;
   for (i=2;i<13;i++)
     {
       /* This unpacks the 6 bit data, each cluster into its own byte */
       rkey[i]=(sum&0x3F);
       sum>>=6;
-      if(i==0+2) sum |= (v[1]<<26);
-      if(i==5+2) sum |= (v[1]>>4);
+      if(i==0+2) sum |= (v1<<26);
+      if(i==5+2) sum |= (v1>>4);
 
       /* Now we map to the proper chars */
       if (rkey[i]>=0 && rkey[i]<12) rkey[i]+=46;
@@ -1,67 +1,160 @@
 /*
- * NEATLIBC C STANDARD LIBRARY
+ * Introsort qsort
  *
- * Copyright (C) 2010-2020 Ali Gholami Rudi <ali at rudi dot ir>
+ * Quicksort with a median of three pivot, or median of nine on larger
+ * partitions, sorting partitions of up to THRESH elements by insertion
+ * and switching to heapsort if partitioning goes more than 2*log2(n)
+ * deep, so sorted, reversed and adversarial input all take O(n log n).
+ * The larger partition is looped on rather than recursed into, bounding
+ * the stack used. Elements are swapped a word at a time when their size
+ * and alignment allow.
  *
- * Permission to use, copy, modify, and/or distribute this software for any
- * purpose with or without fee is hereby granted, provided that the above
- * copyright notice and this permission notice appear in all copies.
- *
- * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
- * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
- * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
- * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
- * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
- * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
- * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * The old heapsort (qsort-heap.c), BSD and GNU versions are kept for
+ * comparison by elkscmd/test/libc/qsort_bench.c.
  */
-
-/* based on musl libc's qsort.c */
 #include <stdlib.h>
 #include <string.h>
 
-#define MIN(a, b)	((a) < (b) ? (a) : (b))
+#define THRESH		8	/* insertion sort partitions this small */
+#define NINTHER		40	/* median of nine pivot above this size */
+
+typedef int (*cmp_t)(const void *, const void *);
 
-static void swap(char *a, char *b, int sz)
+static void swap(char *a, char *b, size_t width, int words)
 {
-	char tmp[64];
-
-	while (sz) {
-		int l = MIN(sizeof(tmp), sz);
-		memcpy(tmp, a, l);
-		memcpy(a, b, l);
-		memcpy(b, tmp, l);
-		a += l;
-		b += l;
-		sz -= l;
+	char t;
+
+	if (words) {
+		int *p = (int *)a, *q = (int *)b, w;
+
+		width /= sizeof(int);
+		do {
+			w = *p;
+			*p++ = *q;
+			*q++ = w;
+		} while (--width);
+		return;
 	}
+	do {
+		t = *a;
+		*a++ = *b;
+		*b++ = t;
+	} while (--width);
 }
 
-static void fix(char *a, int root, int n, int sz, int (*cmp)(void *, void *))
+static void siftdown(char *a, size_t root, size_t n, size_t width, cmp_t cmp,
+	int words)
 {
-	while (2 * root <= n) {
-		int max = 2 * root;
-		if (max < n && cmp(a + max * sz, a + (max + 1) * sz) < 0)
-			max++;
-		if (max && cmp(a + root * sz, a + max * sz) < 0) {
-			swap(a + root * sz, a + max * sz, sz);
-			root = max;
-		} else {
+	size_t child;
+
+	while ((child = 2 * root + 1) < n) {
+		if (child + 1 < n &&
+		    cmp(a + child * width, a + (child + 1) * width) < 0)
+			child++;
+		if (cmp(a + root * width, a + child * width) >= 0)
 			break;
+		swap(a + root * width, a + child * width, width, words);
+		root = child;
+	}
+}
+
+static void heapsort(char *a, size_t n, size_t width, cmp_t cmp, int words)
+{
+	size_t i;
+
+	for (i = n / 2; i > 0; i--)
+		siftdown(a, i - 1, n, width, cmp, words);
+	for (i = n - 1; i > 0; i--) {
+		swap(a, a + i * width, width, words);
+		siftdown(a, 0, i, width, cmp, words);
+	}
+}
+
+static void insertion(char *a, size_t n, size_t width, cmp_t cmp, int words)
+{
+	char *i, *j, *end = a + n * width;
+
+	for (i = a + width; i < end; i += width)
+		for (j = i; j > a && cmp(j - width, j) > 0; j -= width)
+			swap(j - width, j, width, words);
+}
+
+static char *med3(char *a, char *b, char *c, cmp_t cmp)
+{
+	return cmp(a, b) < 0 ?
+		(cmp(b, c) < 0 ? b : (cmp(a, c) < 0 ? c : a)) :
+		(cmp(b, c) > 0 ? b : (cmp(a, c) < 0 ? a : c));
+}
+
+static void introsort(char *a, size_t n, size_t width, cmp_t cmp, int words,
+	int depth)
+{
+	char *i, *j, *mid, *hi;
+	size_t nl, nr, d;
+
+	while (n > THRESH) {
+		if (depth-- == 0) {
+			heapsort(a, n, width, cmp, words);
+			return;
+		}
+
+		/* order first, middle and last, then use the middle as pivot */
+		mid = a + (n >> 1) * width;
+		hi = a + (n - 1) * width;
+		if (n > NINTHER) {
+			/* take the middle from the median of three medians */
+			d = (n >> 3) * width;
+			i = med3(med3(a, a + d, a + 2 * d, cmp),
+				med3(mid - d, mid, mid + d, cmp),
+				med3(hi - 2 * d, hi - d, hi, cmp), cmp);
+			if (i != mid)
+				swap(i, mid, width, words);
+		}
+		if (cmp(mid, a) < 0)
+			swap(mid, a, width, words);
+		if (cmp(hi, mid) < 0) {
+			swap(hi, mid, width, words);
+			if (cmp(mid, a) < 0)
+				swap(mid, a, width, words);
+		}
+		swap(mid, a + width, width, words);
+
+		/* the first and last elements stop the scans */
+		i = a + width;
+		j = hi;
+		for (;;) {
+			do i += width; while (cmp(i, a + width) < 0);
+			do j -= width; while (cmp(a + width, j) < 0);
+			if (i >= j)
+				break;
+			swap(i, j, width, words);
+		}
+		swap(a + width, j, width, words);
+
+		nl = (j - a) / width;
+		nr = n - nl - 1;
+		if (nl < nr) {
+			introsort(a, nl, width, cmp, words, depth);
+			a = j + width;
+			n = nr;
+		} else {
+			introsort(j + width, nr, width, cmp, words, depth);
+			n = nl;
 		}
 	}
+	if (n > 1)
+		insertion(a, n, width, cmp, words);
 }
 
-void qsort(void *a, size_t n, size_t width, int (*cmp)(void *, void *))
+void qsort(void *base, size_t n, size_t width, cmp_t cmp)
 {
-	int i;
+	size_t m;
+	int depth = 0;
 
-	if (!n)
+	if (n < 2 || !width)
 		return;
-	for (i = (n + 1) >> 1; i; i--)
-		fix(a, i - 1, n - 1, width, cmp);
-	for (i = n - 1; i; i--) {
-		swap(a, a + i * width, width);
-		fix(a, 0, i - 1, width, cmp);
-	}
+	for (m = n; m > 1; m >>= 1)
+		depth += 2;
+	introsort(base, n, width, cmp,
+		!((width | (unsigned int)base) & (sizeof(int) - 1)), depth);
 }
@@ -6,14 +6,28 @@ char *ultostr(unsigned long val, int radix)
 {
   static char buf[MAX_LONG_CHARS];
   char *p = buf + sizeof(buf) - 1;
+  unsigned int v, hi, t, q1, q2, c;
 
   *p = '\0';
+  /* divide long values in byte limbs to avoid the 32-bit divide helper */
+  while (val > 0xFFFFU) {
+      hi = (unsigned int)(val >> 16);
+      v = (unsigned int)val;
+      q1 = hi / radix;
+      t = ((hi % radix) << 8) | (v >> 8);
+      q2 = t / radix;
+      t = ((t % radix) << 8) | (v & 0xFF);
+      val = ((unsigned long)q1 << 16) | (q2 << 8) | (t / radix);
+      c = t % radix;
+      *--p = (c > 9)? 'a' - 10 + c: '0' + c;
+  }
+  v = (unsigned int)val;
   do {
-      int c = val % radix;
+      c = v % radix;
       if (c > 9)
         *--p = 'a' - 10 + c;
       else
         *--p = '0' + c;
-  } while ((val /= radix) != 0);
+  } while ((v /= radix) != 0);
   return p;
 }
@@ -9,6 +9,8 @@
 #include <string.h>
 #include <signal.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netdb.h>
@@ -18,6 +20,10 @@
 #define DEFAULT_DNS	"208.67.222.222"	/* DNS server IP */
 #define DNS_ENV		"DNSIP"				/* DNS server IP environment var */
 
+#define CACHE_ENTRIES	16		/* answers kept in _PATH_DNSCACHE */
+#define CACHE_NAMELEN	40		/* longer names aren't cached */
+#define CACHE_MAXTTL	86400L	/* limit on time an answer is kept */
+
 /* flag codes */
 #define QUERY		0x0000	/* DNS query (opcode 0) */
 #define RESPONSE	0x8000	/* DNS response */
@@ -31,7 +37,7 @@
 #define REFUSED			5	/* query refused */
 
 struct DNS_HEADER {
-	__u16	len;		/* length for TCP only */
+	__u16	len;		/* length for TCP only, not sent by UDP */
 	__u16	id;
 	__u16	flags;
 	__u16	qdcount;	/* question count */
@@ -58,6 +64,72 @@ struct RR {				/* resource record */
 	__u32	rdata;		/* IP address for TYPE_A */
 };
 
+/*
+ * Answers from the default server are kept in a small file of fixed size
+ * records shared by all processes, until their TTL runs out.
+ */
+struct cache_entry {
+	time_t		expires;	/* 0 if unused */
+	ipaddr_t	addr;
+	char		name[CACHE_NAMELEN];
+};
+
+/* return cached address of hostname or 0 if not cached or expired */
+static ipaddr_t cache_lookup(const char *hostname)
+{
+	int fd;
+	time_t now;
+	struct cache_entry ent;
+
+	if ((fd = open(_PATH_DNSCACHE, O_RDONLY)) < 0)
+		return 0;
+	now = time(NULL);
+	while (read(fd, &ent, sizeof(ent)) == sizeof(ent)) {
+		if (ent.expires > now && !strcmp(ent.name, hostname)) {
+			close(fd);
+			return ent.addr;
+		}
+	}
+	close(fd);
+	return 0;
+}
+
+/* add answer to cache, replacing the same name, an expired or the oldest entry */
+static void cache_add(const char *hostname, ipaddr_t addr, unsigned long ttl)
+{
+	int fd, i, slot = -1;
+	time_t now, oldest = 0;
+	struct cache_entry ent;
+
+	if (ttl == 0 || strlen(hostname) >= CACHE_NAMELEN)
+		return;
+	if ((fd = open(_PATH_DNSCACHE, O_RDWR | O_CREAT, 0666)) < 0)
+		return;
+	now = time(NULL);
+	for (i = 0; i < CACHE_ENTRIES; i++) {
+		if (read(fd, &ent, sizeof(ent)) != sizeof(ent)) {
+			if (slot < 0 || oldest > now)
+				slot = i;	/* append */
+			break;
+		}
+		if (!strcmp(ent.name, hostname)) {
+			slot = i;
+			break;
+		}
+		if (slot < 0 || ent.expires < oldest) {
+			slot = i;
+			oldest = ent.expires;
+		}
+	}
+	memset(&ent, 0, sizeof(ent));
+	ent.expires = now + (ttl > CACHE_MAXTTL? CACHE_MAXTTL: ttl);
+	ent.addr = addr;
+	strcpy(ent.name, hostname);
+	if (lseek(fd, (off_t)slot * sizeof(ent), SEEK_SET) >= 0)
+		write(fd, &ent, sizeof(ent));
+	close(fd);
+}
+
 static void alarm_cb(int sig)
 {
 	/* no action */
@@ -92,38 +164,24 @@ ipaddr_t in_resolv(const char *hostname, char *server)
 	struct sockaddr_in addr;
 	unsigned short flags;
 	sighandler_t old;
+	ipaddr_t ip;
+	int cache = (server == NULL);
 	char buf[256];
 
+	if (cache && (ip = cache_lookup(hostname)) != 0)
+		return ip;
 	if (server == NULL)
 		server = getenv(DNS_ENV);
 	if (server == NULL)
 		server = DEFAULT_DNS;
 
-	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+	/* query by UDP datagram, bound to an ephemeral port on first send */
+	if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
 		return 0;
 
-	addr.sin_family = AF_INET;
-	addr.sin_port = PORT_ANY;
-	addr.sin_addr.s_addr = INADDR_ANY;
-	if (bind(fd, (struct sockaddr *)&addr, sizeof(struct sockaddr_in)) < 0) {
-		int e = errno;
-		close(fd);
-		errno = e;
-		return 0;
-	}
-
 	addr.sin_family = AF_INET;
 	addr.sin_addr.s_addr = in_aton(server);
 	addr.sin_port = htons(53);
-	old = signal(SIGALRM, alarm_cb);
-	alarm(2);
-	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-		alarm(0);
-		signal(SIGALRM, old);
-		close(fd);
-		errno = ENONAMESERVER;
-		return 0;
-	}
 
 	dns = (struct DNS_HEADER *)buf;
 	dns->id = htons(0xABCD);
@@ -142,14 +200,23 @@ ipaddr_t in_resolv(const char *hostname, char *server)
 	qd->qclass = htons(CLASS_IN);
 
 	len += sizeof(struct DNS_HEADER) + sizeof(struct QUESTION) - 2;
-	dns->len = htons(len);
+	dns->len = htons(len);			/* unused for UDP */
 
-	write(fd, buf, len + 2);
-	rc = read(fd,buf,200);
+	old = signal(SIGALRM, alarm_cb);
+	alarm(2);
+	rc = -1;
+	if (sendto(fd, buf + 2, len, 0, (struct sockaddr *)&addr, sizeof(addr)) == len)
+		rc = recvfrom(fd, buf + 2, sizeof(buf) - 2, 0, NULL, NULL);
 	alarm(0);
 	signal(SIGALRM, old);
 	close(fd);
 
+	if (rc < 0) {
+		errno = ENONAMESERVER;
+		return 0;
+	}
+	rc += 2;						/* buf includes TCP length word */
+
 #if DEBUG
 	printf("DNS: %d message bytes\n", rc);
 	for (int i=0;i<rc;i++) printf("%2x,",buf[i] & 0xff);
@@ -200,5 +267,7 @@ ipaddr_t in_resolv(const char *hostname, char *server)
 		return 0;
 	}
 
+	if (cache)
+		cache_add(hostname, rr->rdata, htonl(rr->ttl));
 	return rr->rdata;
 }
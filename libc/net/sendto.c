@@ -0,0 +1,28 @@
+#include <sys/socket.h>
+#include <errno.h>
+
+/* actual system calls, without flags */
+extern int sndto(int socket, const void *message, size_t length,
+	const struct sockaddr *dest_addr, socklen_t dest_len);
+extern int rcvfrom(int socket, void * restrict buffer, size_t length,
+	struct sockaddr * restrict address, socklen_t * restrict address_len);
+
+ssize_t sendto(int socket, const void *message, size_t length, int flags,
+	const struct sockaddr *dest_addr, socklen_t dest_len)
+{
+	if (flags) {
+		errno = EINVAL;
+		return -1;
+	}
+	return sndto(socket, message, length, dest_addr, dest_len);
+}
+
+ssize_t recvfrom(int socket, void * restrict buffer, size_t length, int flags,
+	struct sockaddr * restrict address, socklen_t * restrict address_len)
+{
+	if (flags) {
+		errno = EINVAL;
+		return -1;
+	}
+	return rcvfrom(socket, buffer, length, address, address_len);
+}
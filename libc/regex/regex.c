@@ -143,6 +143,47 @@
 #define	SPSTART		04	/* Starts with * or +. */
 #define	WORST		0	/* Worst case. */
 
+/*
+ * DFA prefilter.
+ *
+ * The backtracking matcher can take time quadratic in the line length on
+ * patterns like ".*foo.*bar", yet most lines given to grep don't match at
+ * all.  So for patterns with at most MAXNFA-1 character positions, regcomp
+ * also builds a table of the positions and, for each, the set of positions
+ * that can follow it.  regexec first runs the pattern as a DFA whose states
+ * (sets of positions) and transitions are built lazily and cached, and only
+ * runs the backtracking matcher, to find where the match and its
+ * subexpressions are, when the DFA says the string matches.  The cache
+ * keeps NDSTATES states with their transitions in far memory, and is
+ * flushed when full or when another regexp is executed.
+ */
+#define	MAXNFA		64	/* Positions, including END. */
+#define	NDSTATES	64	/* Cached DFA states. */
+#define	DW		(MAXNFA/16)	/* Words in a position set. */
+#define	ENDPOS		0	/* Position of the END node. */
+#define	MAXSTEPS	2000	/* Limit on work building follow sets. */
+
+struct nfapos {
+	char *key;		/* Node or operand char of this position. */
+	char *opnd;		/* Char or class matched. */
+	char *fnode;		/* Node whose closure follows a match. */
+	unsigned char op;	/* ANY, ANYOF, ANYBUT, EXACTLY or EOL. */
+	unsigned char fpos;	/* Position also following, or 0. */
+	unsigned char eolok;	/* EOL: END reached at end of string. */
+	unsigned int follow[DW];
+};
+
+struct regdfa {
+	unsigned int serial;	/* Identifies this regexp to the cache. */
+	int npos;
+	unsigned int start[DW];	/* Positions at beginning of string. */
+	unsigned int restart[DW];	/* Positions added at each later char. */
+	struct nfapos pos[1];
+};
+
+#define	SETBIT(set, n)	((set)[(n) >> 4] |= 1 << ((n) & 15))
+#define	ISBIT(set, n)	((set)[(n) >> 4] & (1 << ((n) & 15)))
+
 /*
  * Global work variables for regcomp().
  */
@@ -151,6 +192,7 @@ static int regnpar;		/* () count. */
 static char regdummy;
 static char *regcode;		/* Code-emit pointer; &regdummy = don't. */
 static long regsize;		/* Code size. */
+static int regnpos;		/* DFA positions, including END. */
 
 /*
  * Forward declarations for regcomp()'s friends.
@@ -168,6 +210,7 @@ STATIC void regc();
 STATIC void reginsert();
 STATIC void regtail();
 STATIC void regoptail();
+STATIC void *regdfabuild();
 #ifdef STRCSPN
 STATIC int strcspn();
 #endif
@@ -196,6 +239,7 @@ char *exp;
 	register char *longest;
 	register int len;
 	int flags;
+	unsigned int dfasize;
 
 	if (exp == NULL)
 		FAIL("NULL argument");
@@ -203,6 +247,7 @@ char *exp;
 	/* First pass: determine size, legality. */
 	regparse = exp;
 	regnpar = 1;
+	regnpos = 1;
 	regsize = 0L;
 	regcode = &regdummy;
 	regc(MAGIC);
@@ -213,14 +258,21 @@ char *exp;
 	if (regsize >= 32767L)		/* Probably could be 65535L. */
 		FAIL("regexp too big");
 
+	/* Room for the DFA position table after the program, if small enough. */
+	regsize = (regsize + 1) & ~1L;
+	dfasize = 0;
+	if (regnpos <= MAXNFA)
+		dfasize = sizeof(struct regdfa) + (regnpos - 1) * sizeof(struct nfapos);
+
 	/* Allocate space. */
-	r = (regexp *)malloc(sizeof(regexp) + (unsigned)regsize);
+	r = (regexp *)malloc(sizeof(regexp) + (unsigned)regsize + dfasize);
 	if (r == NULL)
 		FAIL("out of space");
 
 	/* Second pass: emit code. */
 	regparse = exp;
 	regnpar = 1;
+	regnpos = 1;
 	regcode = r->program;
 	regc(MAGIC);
 	if (reg(0, &flags) == NULL)
@@ -262,6 +314,10 @@ char *exp;
 		}
 	}
 
+	r->regdfa = NULL;
+	if (dfasize)
+		r->regdfa = regdfabuild(r, (struct regdfa *)(r->program + regsize));
+
 	return(r);
 }
 
@@ -417,8 +473,10 @@ int *flagp;
 		regoptail(ret, ret);			/* back */
 		regtail(ret, regnode(BRANCH));		/* or */
 		regtail(ret, regnode(NOTHING));		/* null. */
-	} else if (op == '+' && (flags&SIMPLE))
+	} else if (op == '+' && (flags&SIMPLE)) {
 		reginsert(PLUS, ret);
+		regnpos++;			/* For the loop. */
+	}
 	else if (op == '+') {
 		/* Emit x+ as x(&|), where & means "self". */
 		next = regnode(BRANCH);			/* Either */
@@ -464,9 +522,11 @@ int *flagp;
 		break;
 	case '$':
 		ret = regnode(EOL);
+		regnpos++;
 		break;
 	case '.':
 		ret = regnode(ANY);
+		regnpos++;
 		*flagp |= HASWIDTH|SIMPLE;
 		break;
 	case '[': {
@@ -501,6 +561,7 @@ int *flagp;
 			if (*regparse != ']')
 				FAIL("unmatched []");
 			regparse++;
+			regnpos++;
 			*flagp |= HASWIDTH|SIMPLE;
 		}
 		break;
@@ -526,6 +587,7 @@ int *flagp;
 		ret = regnode(EXACTLY);
 		regc(*regparse++);
 		regc('\0');
+		regnpos++;
 		*flagp |= HASWIDTH|SIMPLE;
 		break;
 	default: {
@@ -543,6 +605,7 @@ int *flagp;
 			if (len == 1)
 				*flagp |= SIMPLE;
 			ret = regnode(EXACTLY);
+			regnpos += len;
 			while (len > 0) {
 				regc(*regparse++);
 				len--;
@@ -670,6 +733,226 @@ char *val;
 	regtail(OPERAND(p), val);
 }
 
+/*
+ - regdfapos - add a DFA position
+ */
+static int
+regdfapos(d, key, op, opnd, fnode)
+struct regdfa *d;
+char *key;
+int op;
+char *opnd;
+char *fnode;
+{
+	register struct nfapos *p;
+
+	if (d->npos >= regnpos)		/* Room allocated by regcomp. */
+		return(0);
+	p = &d->pos[d->npos];
+	memset(p, 0, sizeof(struct nfapos));
+	p->key = key;
+	p->op = op;
+	p->opnd = opnd;
+	p->fnode = fnode;
+	return(d->npos++);
+}
+
+/*
+ - regdfafind - find the position for a node or operand char
+ */
+static int
+regdfafind(d, key)
+struct regdfa *d;
+char *key;
+{
+	register int i;
+
+	for (i = 1; i < d->npos; i++)
+		if (d->pos[i].key == key)
+			return(i);
+	return(-1);
+}
+
+static int regsteps;
+
+/*
+ - regclosure - add the positions reachable from a node without input
+ */
+static int			/* 0 too complex or internal error */
+regclosure(d, scan, set, atbol)
+struct regdfa *d;
+char *scan;
+unsigned int *set;
+int atbol;
+{
+	register int n;
+
+	while (scan != NULL) {
+		if (++regsteps > MAXSTEPS)
+			return(0);
+		switch (OP(scan)) {
+		case END:
+			SETBIT(set, ENDPOS);
+			return(1);
+		case BOL:
+			if (!atbol)
+				return(1);
+			break;
+		case EXACTLY:
+		case PLUS:
+			if ((n = regdfafind(d, OPERAND(scan))) < 0)
+				return(0);
+			SETBIT(set, n);
+			return(1);
+		case EOL:
+		case ANY:
+		case ANYOF:
+		case ANYBUT:
+		case STAR:
+			if ((n = regdfafind(d, scan)) < 0)
+				return(0);
+			SETBIT(set, n);
+			if (OP(scan) != STAR)
+				return(1);
+			break;			/* Or none at all. */
+		case BRANCH:
+			if (OP(regnext(scan)) != BRANCH) {
+				scan = OPERAND(scan);
+				continue;
+			}
+			do {
+				if (!regclosure(d, OPERAND(scan), set, atbol))
+					return(0);
+				scan = regnext(scan);
+			} while (scan != NULL && OP(scan) == BRANCH);
+			return(1);
+		default:			/* NOTHING, BACK, OPEN, CLOSE */
+			break;
+		}
+		scan = regnext(scan);
+	}
+	return(1);
+}
+
+/*
+ - regeolok - can END be reached from a node at the end of the string?
+ */
+static int
+regeolok(scan)
+char *scan;
+{
+	while (scan != NULL) {
+		if (++regsteps > MAXSTEPS)
+			return(1);		/* Let regmatch decide. */
+		switch (OP(scan)) {
+		case END:
+			return(1);
+		case ANY:
+		case ANYOF:
+		case ANYBUT:
+		case EXACTLY:
+		case PLUS:
+			return(0);
+		case BRANCH:
+			if (OP(regnext(scan)) != BRANCH) {
+				scan = OPERAND(scan);
+				continue;
+			}
+			do {
+				if (regeolok(OPERAND(scan)))
+					return(1);
+				scan = regnext(scan);
+			} while (scan != NULL && OP(scan) == BRANCH);
+			return(0);
+		default:			/* BOL, EOL, STAR, NOTHING, ... */
+			break;
+		}
+		scan = regnext(scan);
+	}
+	return(0);
+}
+
+static unsigned int regserial;
+
+/*
+ - regdfabuild - build the DFA position table for a compiled program
+ */
+static void *
+regdfabuild(r, d)
+regexp *r;
+struct regdfa *d;
+{
+	register char *scan;
+	register struct nfapos *p;
+	register int i, n;
+	char *opnd;
+
+	memset(d, 0, sizeof(struct regdfa));
+	d->serial = ++regserial;
+	d->npos = 1;			/* Position 0 is END. */
+
+	/* Number positions in program order, noting what follows each. */
+	for (scan = r->program + 1; OP(scan) != END; ) {
+		n = 1;
+		switch (OP(scan)) {
+		case ANY:
+		case ANYOF:
+		case ANYBUT:
+			n = regdfapos(d, scan, OP(scan), OPERAND(scan), regnext(scan));
+			break;
+		case EOL:
+			n = regdfapos(d, scan, EOL, NULL, regnext(scan));
+			break;
+		case EXACTLY:
+			for (opnd = OPERAND(scan); n && *opnd; opnd++) {
+				n = regdfapos(d, opnd, EXACTLY, opnd,
+					opnd[1]? NULL: regnext(scan));
+				if (n && opnd[1])
+					d->pos[n].fpos = n + 1;
+			}
+			break;
+		case STAR:
+		case PLUS:
+			opnd = OPERAND(scan);	/* Simple operand node. */
+			if (OP(scan) == PLUS) {
+				n = regdfapos(d, opnd, OP(opnd), OPERAND(opnd), regnext(scan));
+				if (n)
+					d->pos[n].fpos = n + 1;
+			}
+			if (n) {
+				n = regdfapos(d, scan, OP(opnd), OPERAND(opnd), regnext(scan));
+				if (n)
+					d->pos[n].fpos = n;
+			}
+			scan = opnd;		/* Skip it. */
+			break;
+		}
+		if (n == 0)
+			return(NULL);
+		scan += 3;
+		if (OP(scan-3) == ANYOF || OP(scan-3) == ANYBUT || OP(scan-3) == EXACTLY)
+			scan += strlen(scan) + 1;
+	}
+
+	/* Follow sets, and the start sets. */
+	regsteps = 0;
+	for (i = 1; i < d->npos; i++) {
+		p = &d->pos[i];
+		if (p->op == EOL) {
+			p->eolok = regeolok(p->fnode);
+			continue;
+		}
+		if (p->fpos)
+			SETBIT(p->follow, p->fpos);
+		if (p->fnode != NULL && !regclosure(d, p->fnode, p->follow, 0))
+			return(NULL);
+	}
+	if (!regclosure(d, r->program + 1, d->start, 1) ||
+	    !regclosure(d, r->program + 1, d->restart, 0))
+		return(NULL);
+	return(d);
+}
+
 /*
  * regexec and friends
  */
@@ -685,6 +968,7 @@ static char **regendp;		/* Ditto for endp. */
 /*
  * Forwards.
  */
+STATIC int regdfaexec();
 STATIC int regtry();
 STATIC int regmatch();
 STATIC int regrepeat();
@@ -729,6 +1013,10 @@ register char *string;
 			return(0);
 	}
 
+	/* Linear time check that there is a match at all. */
+	if (prog->regdfa != NULL && !regdfaexec(prog->regdfa, string))
+		return(0);
+
 	/* Mark beginning of line for ^ . */
 	regbol = string;
 
@@ -756,6 +1044,134 @@ register char *string;
 	return(0);
 }
 
+/*
+ * DFA state cache for regdfaexec().
+ */
+#define	DACCEPT		1	/* State includes END. */
+#define	DEOLACC		2	/* State includes an EOL followed by END. */
+
+static unsigned char __far *dfatrans;	/* Next state + 1 by char, 0 unknown. */
+static unsigned int dfaset[NDSTATES][DW];
+static unsigned char dfaflag[NDSTATES];
+static int dfanstates;
+static int dfanomem;
+static unsigned int dfagen;		/* Changes when the cache is flushed. */
+static struct regdfa *dfaowner;
+static unsigned int dfaserial;
+static unsigned int dfastartgen;
+static int dfastart;
+
+/*
+ - regdfastate - find or add the cached state for a position set
+ */
+static int
+regdfastate(d, set)
+struct regdfa *d;
+unsigned int *set;
+{
+	register int i;
+	register struct nfapos *p;
+
+	for (i = 0; i < dfanstates; i++)
+		if (memcmp(dfaset[i], set, sizeof(dfaset[0])) == 0)
+			return(i);
+	if (dfanstates >= NDSTATES) {
+		dfanstates = 0;
+		dfagen++;
+	}
+	i = dfanstates++;
+	memcpy(dfaset[i], set, sizeof(dfaset[0]));
+	dfaflag[i] = ISBIT(set, ENDPOS)? DACCEPT: 0;
+	for (p = &d->pos[1]; p < &d->pos[d->npos]; p++)
+		if (p->op == EOL && p->eolok && ISBIT(set, p - d->pos))
+			dfaflag[i] |= DEOLACC;
+	fmemset(dfatrans + ((unsigned)i << 8), 0, 256);
+	return(i);
+}
+
+/*
+ - regdfaexec - could the regexp match the string?
+ */
+static int			/* 0 no match, 1 possible match */
+regdfaexec(d, string)
+struct regdfa *d;
+char *string;
+{
+	register unsigned char *s;
+	register struct nfapos *p;
+	register int i, c;
+	int cur, next, ok;
+	unsigned int gen;
+	unsigned int set[DW];
+
+	if (dfatrans == NULL) {
+		if (dfanomem)
+			return(1);
+		dfatrans = fmemalloc((unsigned long)NDSTATES << 8);
+		if (dfatrans == NULL) {
+			dfanomem = 1;
+			return(1);
+		}
+	}
+	if (dfaowner != d || dfaserial != d->serial) {
+		dfaowner = d;
+		dfaserial = d->serial;
+		dfanstates = 0;
+		dfagen++;
+	}
+	if (dfastartgen != dfagen) {
+		dfastart = regdfastate(d, d->start);
+		dfastartgen = dfagen;
+	}
+
+	cur = dfastart;
+	for (s = (unsigned char *)string; ; s++) {
+		if (dfaflag[cur] & DACCEPT)
+			return(1);
+		if ((c = *s) == '\0')
+			return((dfaflag[cur] & DEOLACC) != 0);
+		if ((next = dfatrans[((unsigned)cur << 8) | c]) != 0) {
+			cur = next - 1;
+			continue;
+		}
+
+		/* New transition: step each position that matches c. */
+		memcpy(set, d->restart, sizeof(set));
+		for (i = 1, p = &d->pos[1]; i < d->npos; i++, p++) {
+			if (!ISBIT(dfaset[cur], i))
+				continue;
+			switch (p->op) {
+			case ANY:
+				ok = 1;
+				break;
+			case ANYOF:
+				ok = (strchr(p->opnd, c) != NULL);
+				break;
+			case ANYBUT:
+				ok = (strchr(p->opnd, c) == NULL);
+				break;
+			case EXACTLY:
+				ok = (UCHARAT(p->opnd) == c);
+				break;
+			default:
+				ok = 0;
+				break;
+			}
+			if (ok) {
+				set[0] |= p->follow[0];
+				set[1] |= p->follow[1];
+				set[2] |= p->follow[2];
+				set[3] |= p->follow[3];
+			}
+		}
+		gen = dfagen;
+		next = regdfastate(d, set);
+		if (gen == dfagen)
+			dfatrans[((unsigned)cur << 8) | c] = next + 1;
+		cur = next;
+	}
+}
+
 /*
  - regtry - try match at specific point
  */
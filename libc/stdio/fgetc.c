@@ -1,8 +1,12 @@
-#include <stdio.h>
+#include <unistd.h>
+
+#include "_stdio.h"
 
 int fgetc(FILE *fp)
 {
    size_t ch;
+   ssize_t len;
+   __LINK_SYMBOL(__stdio_init);
 
    if (fp->mode & __MODE_WRITING)
       fflush(fp);
@@ -22,10 +26,13 @@ int fgetc(FILE *fp)
          fflush(stdout);
 
       fp->bufpos = fp->bufread = fp->bufstart;
-      ch = fread(fp->bufpos, 1, fp->bufend - fp->bufstart, fp);
-      if (ch == 0)
+      len = read(fp->fd, fp->bufpos, fp->bufend - fp->bufstart);
+      if (len <= 0)
+      {
+	 fp->mode |= (len < 0)? __MODE_ERR: __MODE_EOF;
 	 return EOF;
-      fp->bufread += ch;
+      }
+      fp->bufread += len;
       fp->mode |= __MODE_READING;
       fp->mode &= ~__MODE_UNGOT;
    }
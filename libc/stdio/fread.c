@@ -5,17 +5,17 @@
 
 /*
  * fread will often be used to read in large chunks of data calling read()
- * directly can be a big win in this case. Beware also fgetc calls this
- * function to fill the buffer.
+ * directly can be a big win in this case. Whatever is buffered is copied
+ * out first; then requests of at least the buffer size are read straight
+ * into the caller's buffer, and smaller ones refill the buffer.
  * 
- * This ignores __MODE__IOTRAN; probably exactly what you want. (It _is_ what
- * fgetc wants)
+ * This ignores __MODE__IOTRAN; probably exactly what you want.
  */
 size_t fread(void *buf, size_t size, size_t nelm, FILE *fp)
 {
     int v;
     ssize_t len;
-    size_t bytes, got = 0;
+    size_t bytes, want, got = 0;
     __LINK_SYMBOL(__stdio_init);
 
     v = fp->mode;
@@ -30,28 +30,48 @@ size_t fread(void *buf, size_t size, size_t nelm, FILE *fp)
 
     /* This could be long, doesn't seem much point tho */
     bytes = size * nelm;
+    if (bytes == 0)
+        return 0;
 
     len = fp->bufread - fp->bufpos;
-    if ((size_t)len >= bytes) {
-        /* Enough buffered */
-        memcpy(buf, fp->bufpos, bytes);
-        fp->bufpos += bytes;
-        return nelm;
-    } else if (len > 0) {
-        /* Some buffered */
+    if (len > 0) {
+        if ((size_t)len > bytes)
+            len = bytes;
         memcpy(buf, fp->bufpos, len);
         fp->bufpos += len;
         got = len;
     }
 
-    /* Need more; do it with a direct read */
-    len = read(fp->fd, (char *)buf + got, bytes - got);
+    while (got < bytes) {
+        want = bytes - got;
+        if (want >= (size_t)(fp->bufend - fp->bufstart)) {
+            /* Buffer is empty, do it with a direct read */
+            len = read(fp->fd, (char *)buf + got, want);
+            if (len <= 0)
+                break;
+        } else {
+            fp->bufpos = fp->bufread = fp->bufstart;
+            len = read(fp->fd, fp->bufstart, fp->bufend - fp->bufstart);
+            if (len <= 0)
+                break;
+            fp->bufread += len;
+            fp->mode |= __MODE_READING;
+            fp->mode &= ~__MODE_UNGOT;
+            if ((size_t)len > want)
+                len = want;
+            memcpy((char *)buf + got, fp->bufpos, len);
+            fp->bufpos += len;
+        }
+        got += len;
+    }
+
     /* Possibly for now _or_ later */
-    if (len < 0) {
-        fp->mode |= __MODE_ERR;
-        len = 0;
-    } else if (len == 0)
-        fp->mode |= __MODE_EOF;
+    if (got < bytes) {
+        if (len < 0)
+            fp->mode |= __MODE_ERR;
+        else
+            fp->mode |= __MODE_EOF;
+    }
 
-    return (got + len) / size;
+    return got / size;
 }
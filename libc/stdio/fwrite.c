@@ -7,7 +7,9 @@
  * Like fread, fwrite will often be used to write out large chunks of
  * data; calling write() directly can be a big win in this case.
  * 
- * But first we check to see if there's space in the buffer.
+ * Requests smaller than the buffer are copied into it, flushing it first
+ * if there isn't room. Anything larger is written straight from the
+ * caller's buffer once pending data has been flushed.
  * 
  * Again this ignores __MODE__IOTRAN.
  */
@@ -38,8 +40,8 @@ fwrite(const char *buf, int size, int nelm, FILE *fp)
             return 0;
 
     len = fp->bufend - fp->bufpos;
-    /* It'll fit in the buffer ? */
-    if (bytes <= (size_t)len) {
+    /* It'll fit in the buffer and is less than a buffer full ? */
+    if (bytes <= (size_t)len && bytes < (size_t)(fp->bufend - fp->bufstart)) {
         register int do_flush=0;
         fp->mode |= __MODE_WRITING;
         memcpy(fp->bufpos, buf, bytes);
@@ -55,17 +57,17 @@ fwrite(const char *buf, int size, int nelm, FILE *fp)
 
         return nelm;
     } else {
-        /* Too big for the buffer */
+        /* Too big for the buffer, which is now empty, write it directly */
         put = bytes;
-        do {
+        while (bytes > 0) {
             len = write(fp->fd, buf, bytes);
-            if ( len > 0 ) {
+            if (len > 0) {
                 buf+=len; bytes-=len;
-            }
+            } else if (len == 0 || errno != EINTR)
+                break;
         }
-        while (len > 0 || (len == -1 && errno == EINTR));
 
-        if (len < 0)
+        if (bytes)
             fp->mode |= __MODE_ERR;
 
         put -= bytes;
@@ -0,0 +1,16 @@
+#include <string.h>
+#include <asm/config.h>
+
+#ifndef LIBC_ASM_FMEMCPY
+
+void __far *fmemcpy(void __far *dest, const void __far *src, size_t l)
+{
+    char __far *s1 = dest;
+    const char __far *s2 = src;
+
+    while (l-- > 0)
+        *s1++ = *s2++;
+    return dest;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#include <string.h>
+#include <asm/config.h>
+
+#ifndef LIBC_ASM_MEMCHR
+
+void *
+memchr(const void * str, int c, size_t l)
+{
+   register unsigned char *p=(unsigned char *)str;
+   while(l-- > 0)
+   {
+      if(*p == (unsigned char)c) return p;
+      p++;
+   }
+   return 0;
+}
+
+#endif
@@ -1,4 +1,7 @@
 #include <string.h>
+#include <asm/config.h>
+
+#ifndef LIBC_ASM_MEMMOVE
 
 void *
 memmove(void *d, const void *s, size_t l)
@@ -14,3 +17,5 @@ memmove(void *d, const void *s, size_t l)
       *(--s1) = *(--s2);
    return d;
 }
+
+#endif
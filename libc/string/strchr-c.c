@@ -0,0 +1,20 @@
+#include <string.h>
+#include <asm/config.h>
+
+#ifndef LIBC_ASM_STRCHR
+
+char *
+strchr (const char * s, int c)
+{
+    for(; *s != (char)c; ++s) {
+        if (*s == '\0')
+            return NULL;
+    }
+    return (char *)s;
+}
+
+#ifdef __GNUC__
+char *index(const char *s, int c) __attribute__ ((weak, alias ("strchr")));
+#endif
+
+#endif
@@ -1,4 +1,7 @@
 #include <string.h>
+#include <asm/config.h>
+
+#ifndef LIBC_ASM_STRRCHR
 
 char *
 strrchr (const char * s, int c)
@@ -16,3 +19,5 @@ strrchr (const char * s, int c)
 #ifdef __GNUC__
 char *rindex(const char *s, int c) __attribute__ ((weak, alias ("strrchr")));
 #endif
+
+#endif
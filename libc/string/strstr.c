@@ -1,57 +1,52 @@
 /*
- * Jody Bruchon's two-way strstr() function
+ * Boyer-Moore-Horspool strstr() function
  *
- * This implementation attempts to exclude substrings faster by scanning
- * them from both directions at once. It is faster than naive one-by-one
- * comparison implementations but slower than larger, more complex ones
- * seen in C libraries such as glibc and musl. The big advantage over the
- * faster versions is that resource usage is very low, making it more
- * suitable for embedded, low-memory, or small-cache systems.
- *
- * Copyright (C) 2014-2015 by Jody Bruchon <jody@jodybruchon.com>
- * Released under the terms of the GNU GPL version 2
- *
- * K&R-ified for bcc compiler in Dev86
+ * The last character of each window is looked up in a table of shifts,
+ * so most haystack characters are never examined on longer strings.
+ * The table is only built when the haystack is long enough to repay it;
+ * short searches compare at each position of the first character.
  */
 
-#include <stdio.h>
 #include <string.h>
 
+#define MIN_HAY		64	/* shortest haystack worth building the table for */
+
 char *
 strstr(s1, s2)
 const char *s1; const char *s2;
 {
-	register const char *haystack = s1;
-	register const char *needle = s2;
-	int pos = 0;
-	register int cnt;
-	size_t hay_len;
-	size_t n_len;
+	register const unsigned char *hay = (const unsigned char *) s1;
+	const unsigned char *needle = (const unsigned char *) s2;
+	const unsigned char *end;
+	unsigned char skip[256];
+	size_t n_len, hay_len, last, i;
+	unsigned int c;
 
 	if (!*needle) return (char *) s1;
-	n_len = strlen(needle);
-	hay_len = strlen(haystack);
+	if (!needle[1]) return strchr(s1, *needle);
+	n_len = strlen(s2);
+	hay_len = strlen(s1);
+	if (n_len > hay_len) return NULL;
+	last = n_len - 1;
+	end = hay + hay_len - last;		/* first position too far to match */
 
-	cnt = n_len;
-	do {
-		/* Give up if needle is longer than remaining haystack */
-		if ((pos + n_len - 1) > hay_len) return NULL;
+	if (hay_len < MIN_HAY) {
+		for (; hay < end; hay++)
+			if (*hay == *needle && !memcmp(hay, needle, n_len))
+				return (char *) hay;
+		return NULL;
+	}
 
-		/* Scan for match in both directions */
-		while (*needle == *haystack) {
-			cnt--;
-			if (!cnt) return (char *) (s1 + pos);
-			if (*(needle + cnt) == *(haystack + cnt)) {
-				cnt--;
-				if (!cnt) return (char *) (s1 + pos);
-			} else break;
-			needle++;
-			haystack++;
-		}
-		pos++;
-		haystack = s1 + pos;
-		needle = s2;
-		cnt = n_len;
-	} while (1);
+	/* shift by distance from the last occurrence before the final char */
+	memset(skip, n_len > 255? 255: n_len, sizeof(skip));
+	for (i = 0; i < last; i++)
+		skip[needle[i]] = (last - i > 255)? 255: last - i;
 
+	while (hay < end) {
+		c = hay[last];
+		if (c == needle[last] && !memcmp(hay, needle, last))
+			return (char *) hay;
+		hay += skip[c];
+	}
+	return NULL;
 }
@@ -0,0 +1,8 @@
+#include <unistd.h>
+
+/* file data isn't written without the metadata needed to find it */
+int
+fdatasync(int fd)
+{
+   return fsync(fd);
+}
@@ -0,0 +1,12 @@
+#include <sys/resource.h>
+
+extern int _getpriority(int which, int who);
+
+int
+getpriority(int which, int who)
+{
+	int prio = _getpriority(which, who);
+
+	if (prio < 0) return -1;
+	return 20 - prio;
+}
@@ -0,0 +1,12 @@
+#include <unistd.h>
+
+extern int _nice(int incr);
+
+int
+nice(int incr)
+{
+	int prio = _nice(incr);
+
+	if (prio < 0) return -1;
+	return 20 - prio;
+}
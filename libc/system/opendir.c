@@ -21,7 +21,7 @@ opendir(const char *dname)
         return NULL;
     }
 
-    p = malloc(sizeof(DIR) + sizeof(struct dirent));
+    p = malloc(sizeof(DIR) + DIRBUF_ENTRIES * sizeof(struct dirent));
     if (p == NULL) {
         close(fd);
         errno = ENOMEM;
@@ -15,6 +15,7 @@ OBJS = \
 	closedir.o \
 	dup.o \
 	dup2.o \
+	fdatasync.o \
 	environ.o \
 	errno.o \
 	execl.o \
@@ -29,21 +30,27 @@ OBJS = \
 	geteuid.o \
 	getgid.o \
 	getpgid.o \
+	getpriority.o \
 	getpid.o \
 	getppid.o \
 	getuid.o \
 	killpg.o \
 	lseek.o \
 	mkfifo.o \
+	nice.o \
 	opendir.o \
+	pread.o \
 	program_filename.o \
+	pwrite.o \
 	readdir.o \
 	rewinddir.o \
+	sched_setscheduler.o \
 	seekdir.o \
 	setjmp.o \
 	setpgrp.o \
 	signal.o \
 	sleep.o \
+	spawn.o \
 	syscall01.o \
 	syscall23.o \
 	syscall4.o \
@@ -0,0 +1,9 @@
+#include <unistd.h>
+
+extern int _pread (int fd, void * buf, size_t count, off_t * posn);
+
+ssize_t
+pread(int fd, void * buf, size_t count, off_t posn)
+{
+	return _pread (fd, buf, count, &posn);
+}
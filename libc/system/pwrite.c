@@ -0,0 +1,9 @@
+#include <unistd.h>
+
+extern int _pwrite (int fd, const void * buf, size_t count, off_t * posn);
+
+ssize_t
+pwrite(int fd, const void * buf, size_t count, off_t posn)
+{
+	return _pwrite (fd, buf, count, &posn);
+}
@@ -5,8 +5,12 @@ readdir(DIR *dirp)
 {
    int cc;
 
-   cc = _readdir(dirp->dd_fd, dirp->dd_buf, 1);
-   if (cc <= 0)
-      return 0;
-   return dirp->dd_buf;
+   if (dirp->dd_loc >= dirp->dd_size) {
+      cc = _getdents(dirp->dd_fd, dirp->dd_buf, DIRBUF_ENTRIES * sizeof(struct dirent));
+      if (cc <= 0)
+         return 0;
+      dirp->dd_size = cc / sizeof(struct dirent);
+      dirp->dd_loc = 0;
+   }
+   return &dirp->dd_buf[dirp->dd_loc++];
 }
@@ -5,5 +5,6 @@
 void
 rewinddir(DIR *dirp)
 {
+   dirp->dd_loc = dirp->dd_size = 0;
    lseek(dirp->dd_fd, 0L, SEEK_SET);
 }
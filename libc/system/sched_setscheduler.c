@@ -0,0 +1,10 @@
+#include <sched.h>
+
+extern int _sched_setscheduler(pid_t pid, int policy);
+
+/* there is only one SCHED_FIFO level, so the priority isn't passed on */
+int
+sched_setscheduler(pid_t pid, int policy, const struct sched_param *param)
+{
+	return _sched_setscheduler(pid, policy);
+}
@@ -5,5 +5,6 @@
 void
 seekdir(DIR *dirp, off_t pos)
 {
+   dirp->dd_loc = dirp->dd_size = 0;
    lseek(dirp->dd_fd, pos, SEEK_SET);
 }
@@ -17,6 +17,7 @@ extern __attribute__((stdcall))
     __far void _syscall_signal (int);
 
 Sig _sigtable[_NSIG];
+static sigset_t _sigkeep;		/* handlers not reset on delivery */
 
 /*
  * Signal handler.
@@ -54,6 +55,44 @@ Sig signal(int number, Sig pointer)
 
    old_sig = _sigtable[number-1];
    _sigtable[number-1] = pointer;
+   _sigkeep &= ~(1 << (number-1));
 
    return old_sig;
 }
+
+/*
+ * Handlers installed without SA_RESETHAND stay installed after delivery
+ * and need not call signal again. There is no signal masking, and
+ * interrupted system calls are not restarted, so sa_mask and SA_RESTART
+ * are ignored.
+ */
+int sigaction(int number, const struct sigaction *act, struct sigaction *oact)
+{
+   Sig pointer;
+   int rv, keep;
+   if( number < 1 || number > _NSIG ) { errno=EINVAL; return -1; }
+
+   if( oact )
+   {
+      oact->sa_handler = _sigtable[number-1];
+      oact->sa_mask = 0;
+      oact->sa_flags = (_sigkeep & (1 << (number-1)))? 0: SA_RESETHAND;
+   }
+   if( !act ) return 0;
+
+   pointer = act->sa_handler;
+   keep = !(act->sa_flags & SA_RESETHAND);
+   if( pointer == SIG_DFL || pointer == SIG_IGN )
+      rv = _signal(number, (__kern_sighandler_t) (long) (int) pointer);
+   else
+      rv = _signal(number | (keep? SIGF_KEEP: 0), (__kern_sighandler_t) _syscall_signal);
+
+   if( rv < 0 ) return -1;
+
+   _sigtable[number-1] = pointer;
+   if( keep )
+      _sigkeep |= 1 << (number-1);
+   else
+      _sigkeep &= ~(1 << (number-1));
+   return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * posix_spawn - start a program without copying the parent's data segment
+ *
+ * Built on the kernel's virtual fork: unlike vfork, which copies the data
+ * segment on ELKS, the child runs on the parent's memory and stack, with
+ * the parent suspended, until it execs or exits. The child therefore
+ * only makes system calls, and reports a failure by storing errno in the
+ * parent's stack frame before calling _exit.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+extern pid_t _spawnfork(void) __attribute__((returns_twice));
+
+#define SPAWN_OPEN	1
+#define SPAWN_CLOSE	2
+#define SPAWN_DUP2	3
+
+static int spawn(pid_t *pid, const char *path,
+	const posix_spawn_file_actions_t *fa, const posix_spawnattr_t *attrp,
+	char *const argv[], char *const envp[], int usepath)
+{
+	volatile int err = 0;
+	const struct __spawn_action *a;
+	pid_t child;
+	int i, fd;
+
+	child = _spawnfork();
+	if (child < 0)
+		return errno;
+	if (child == 0) {
+		if (attrp && (attrp->flags & POSIX_SPAWN_SETSID) && setsid() < 0)
+			goto fail;
+		if (fa) {
+			for (i = 0, a = fa->actions; i < fa->count; i++, a++) {
+				switch (a->cmd) {
+				case SPAWN_OPEN:
+					if ((fd = open(a->path, a->arg, a->mode)) < 0)
+						goto fail;
+					if (fd != a->fd) {
+						if (dup2(fd, a->fd) < 0)
+							goto fail;
+						close(fd);
+					}
+					break;
+				case SPAWN_CLOSE:
+					close(a->fd);
+					break;
+				case SPAWN_DUP2:
+					if (dup2(a->arg, a->fd) < 0)
+						goto fail;
+					break;
+				}
+			}
+		}
+		if (usepath)
+			execvpe((char *)path, (char **)argv, (char **)envp);
+		else
+			execve((char *)path, (char **)argv, (char **)envp);
+fail:
+		err = errno? errno: ENOEXEC;
+		_exit(127);
+	}
+
+	/* the child has now exec'd or exited */
+	if (err) {
+		waitpid(child, &i, 0);
+		return err;
+	}
+	if (pid)
+		*pid = child;
+	return 0;
+}
+
+int posix_spawn(pid_t *pid, const char *path,
+	const posix_spawn_file_actions_t *file_actions,
+	const posix_spawnattr_t *attrp, char *const argv[], char *const envp[])
+{
+	return spawn(pid, path, file_actions, attrp, argv, envp, 0);
+}
+
+int posix_spawnp(pid_t *pid, const char *file,
+	const posix_spawn_file_actions_t *file_actions,
+	const posix_spawnattr_t *attrp, char *const argv[], char *const envp[])
+{
+	return spawn(pid, file, file_actions, attrp, argv, envp, 1);
+}
+
+int posix_spawn_file_actions_init(posix_spawn_file_actions_t *fa)
+{
+	fa->count = 0;
+	return 0;
+}
+
+int posix_spawn_file_actions_destroy(posix_spawn_file_actions_t *fa)
+{
+	return 0;
+}
+
+static int addaction(posix_spawn_file_actions_t *fa, int cmd, int fd,
+	int arg, mode_t mode, const char *path)
+{
+	struct __spawn_action *a;
+
+	if (fd < 0 || arg < 0)
+		return EBADF;
+	if (fa->count >= POSIX_SPAWN_MAX_ACTIONS)
+		return ENOMEM;
+	a = &fa->actions[fa->count++];
+	a->cmd = cmd;
+	a->fd = fd;
+	a->arg = arg;
+	a->mode = mode;
+	a->path = path;
+	return 0;
+}
+
+int posix_spawn_file_actions_addopen(posix_spawn_file_actions_t *fa, int fd,
+	const char *path, int oflag, mode_t mode)
+{
+	return addaction(fa, SPAWN_OPEN, fd, oflag, mode, path);
+}
+
+int posix_spawn_file_actions_addclose(posix_spawn_file_actions_t *fa, int fd)
+{
+	return addaction(fa, SPAWN_CLOSE, fd, 0, 0, NULL);
+}
+
+int posix_spawn_file_actions_adddup2(posix_spawn_file_actions_t *fa, int fd, int newfd)
+{
+	return addaction(fa, SPAWN_DUP2, newfd, fd, 0, NULL);
+}
+
+int posix_spawnattr_init(posix_spawnattr_t *attr)
+{
+	attr->flags = 0;
+	return 0;
+}
+
+int posix_spawnattr_destroy(posix_spawnattr_t *attr)
+{
+	return 0;
+}
+
+int posix_spawnattr_getflags(const posix_spawnattr_t *attr, short *flags)
+{
+	*flags = attr->flags;
+	return 0;
+}
+
+int posix_spawnattr_setflags(posix_spawnattr_t *attr, short flags)
+{
+	if (flags & ~POSIX_SPAWN_SETSID)
+		return EINVAL;
+	attr->flags = flags;
+	return 0;
+}
@@ -5,5 +5,8 @@
 off_t
 telldir(DIR *dirp)
 {
+   /* the kernel position is past any entries still buffered */
+   if (dirp->dd_loc < dirp->dd_size)
+      return dirp->dd_buf[dirp->dd_loc].d_offset;
    return lseek(dirp->dd_fd, 0L, SEEK_CUR);
 }
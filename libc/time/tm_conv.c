@@ -15,54 +15,74 @@ static const char __mon_lengths[2][12] =
   };
 
 
+/* Days from January 1, 1970 to January 1 of year y */
+static int
+__days_to_year(int y)
+{
+  int n = y - 1;
+
+  return 365 * (y - 1970) + (n / 4 - n / 100 + n / 400) - 477;
+}
+
+/*
+ * The date of the last day converted is kept, so converting another time
+ * on the same day, as ls -l and cron do all the time, needs no 32-bit
+ * division. Times of day use 16-bit division only.
+ */
 void
 __tm_conv(struct tm *tmbuf, const time_t *t, time_t offset)
 {
-  long days, rem;
-  int yday;
+  static struct tm day;		/* date fields of the cached day */
+  static time_t daystart;	/* local time at its start */
+  static char dayvalid;
+  time_t local = *t + offset;
+  long rem;
+  unsigned int secs;
+  int days, yday;
   register int y;
   register const char *ip;
 
-  days = *t / SECS_PER_DAY;
-  rem = *t - days * SECS_PER_DAY;
-  rem += offset;
-  while (rem < 0)
-    {
-      rem += SECS_PER_DAY;
-      --days;
-    }
-  while (rem >= SECS_PER_DAY)
+  rem = local - daystart;
+  if (!dayvalid || rem < 0 || rem >= SECS_PER_DAY)
     {
-      rem -= SECS_PER_DAY;
-      ++days;
+      days = local / SECS_PER_DAY;
+      rem = local - days * SECS_PER_DAY;
+      if (rem < 0)
+        {
+          rem += SECS_PER_DAY;
+          --days;
+        }
+      daystart = local - rem;
+      dayvalid = 1;
+
+      /* January 1, 1970 was a Thursday.  */
+      day.tm_wday = (4 + days) % 7;
+      if (day.tm_wday < 0)
+        day.tm_wday += 7;
+      y = 1970 + days / 365;
+      while (days < (yday = __days_to_year(y)))
+        --y;
+      yday = days - yday;
+      day.tm_year = y - 1900;
+      day.tm_yday = yday;
+      ip = __mon_lengths[__isleap(y)];
+      for (y = 0; yday >= ip[y]; ++y)
+        yday -= ip[y];
+      day.tm_mon = y;
+      day.tm_mday = yday + 1;
     }
-  tmbuf->tm_hour = rem / SECS_PER_HOUR;
-  rem -= tmbuf->tm_hour * SECS_PER_HOUR;
-  tmbuf->tm_min = rem / 60;
-  tmbuf->tm_sec = rem - tmbuf->tm_min * 60;
-  /* January 1, 1970 was a Thursday.  */
-  tmbuf->tm_wday = (4 + days) % 7;
-  if (tmbuf->tm_wday < 0)
-    tmbuf->tm_wday += 7;
-  y = 1970;
-  while (days >= (rem = __isleap(y) ? 366 : 365))
-    {
-      ++y;
-      days -= rem;
-    }
-  while (days < 0)
-    {
-      --y;
-      days += __isleap(y) ? 366 : 365;
-    }
-  yday = days;
-  tmbuf->tm_year = y - 1900;
-  tmbuf->tm_yday = yday;
-  ip = __mon_lengths[__isleap(y)];
-  for (y = 0; yday >= ip[y]; ++y)
-    yday -= ip[y];
-  tmbuf->tm_mon = y;
-  tmbuf->tm_mday = yday + 1;
+
+  tmbuf->tm_year = day.tm_year;
+  tmbuf->tm_yday = day.tm_yday;
+  tmbuf->tm_mon = day.tm_mon;
+  tmbuf->tm_mday = day.tm_mday;
+  tmbuf->tm_wday = day.tm_wday;
+
+  /* 3600 = 16 * 225, and a day is less than 16 * 65536 seconds */
+  tmbuf->tm_hour = (unsigned int)(rem >> 4) / 225;
+  secs = (unsigned int)rem - tmbuf->tm_hour * 3600U;
+  tmbuf->tm_min = secs / 60;
+  tmbuf->tm_sec = secs - tmbuf->tm_min * 60;
   tmbuf->tm_isdst = -1;
 }
 
@@ -61,6 +61,9 @@ IMAGE="-fda image/fd1440.img"
 #DISK2="-hdb image/hd32-minix.img"
 #DISK2="-hdb image/hd32-fat.img"
 
+# Image override from environment, as used by qemubench.sh
+[ -n "$QEMU_IMAGE" ] && IMAGE="$QEMU_IMAGE"
+
 [ -z "$IMAGE" ] && { echo 'Disk image not found!'; exit 1; }
 echo "Using disk image: $IMAGE"
 
@@ -113,6 +116,9 @@ NET="-netdev user,id=mynet,$FWD -device ne2k_isa,irq=12,netdev=mynet"
 # Determine display type ("Darwin" = OSX)
 [ `uname` != 'Darwin' ] && QDISPLAY="-display sdl"
 
+# Headless: serial console on stdio and no window, set by qemubench.sh
+[ -n "$QEMU_HEADLESS" ] && { CONSOLE="-serial stdio"; QDISPLAY="-display none"; }
+
 # Configure QEMU as pure ISA system
 
 exec $QEMU $CONSOLE -nodefaults -name ELKS -machine isapc -cpu 486,tsc -m 4M \
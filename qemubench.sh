@@ -0,0 +1,94 @@
+#!/usr/bin/env bash
+
+# Boot a MINIX image headless in QEMU, run elksbench and collect the results
+#
+# Usage: ./qemubench.sh [image] [results_file]
+#
+# The image must contain /bin/elksbench (built with the :test tag) and is
+# not modified: a copy gets a /bootopts that runs /etc/rc.bench in place of
+# init, with the serial port as console. Boot time is measured from starting
+# QEMU to the BENCH START line. Results are printed one per line as
+# "name value unit" and also written to results_file if given.
+#
+# A TCP sink is run on the host for the tcp_send benchmark when python3 is
+# available; ELKS reaches it through the QEMU gateway 10.0.2.2.
+
+IMAGE=${1:-image/fd1440.img}
+RESULTS=$2
+TIMEOUT=${BENCH_TIMEOUT:-300}
+PORT=${BENCH_PORT:-8099}
+
+# mfs from the host tools, see env.sh
+MFS=mfs
+[ -f "$IMAGE" ] || { echo "$IMAGE not found"; exit 1; }
+
+TMP=`mktemp -d` || exit 1
+SINK=
+QPID=
+trap 'kill $QPID $SINK 2>/dev/null; rm -rf $TMP' EXIT
+
+case "$IMAGE" in
+*hd*)	DRIVE="-hda $TMP/bench.img" ;;
+*)	DRIVE="-fda $TMP/bench.img" ;;
+esac
+
+if command -v python3 >/dev/null; then
+	python3 -c '
+import socket, sys
+s = socket.socket()
+s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+s.bind(("127.0.0.1", int(sys.argv[1])))
+s.listen(1)
+while True:
+    c, a = s.accept()
+    while c.recv(4096):
+        pass
+    c.close()
+' $PORT &
+	SINK=$!
+	NET="net start ne0"
+	TCP="-t 10.0.2.2:$PORT"
+fi
+
+cat > $TMP/bootopts <<EOF
+## bootopts for qemubench.sh
+console=ttyS0,57600
+init=/bin/sh /etc/rc.bench
+EOF
+cat > $TMP/rc.bench <<EOF
+export PATH=/bin
+$NET
+elksbench $TCP
+sync
+EOF
+
+cp "$IMAGE" $TMP/bench.img || exit 1
+$MFS $TMP/bench.img cp $TMP/bootopts /bootopts || exit 1
+$MFS $TMP/bench.img cp $TMP/rc.bench /etc/rc.bench || exit 1
+
+start=`date +%s%N`
+QEMU_HEADLESS=1 QEMU_IMAGE="$DRIVE" ./qemu.sh > $TMP/log 2>&1 &
+QPID=$!
+
+boot=
+while :; do
+	now=`date +%s%N`
+	if [ -z "$boot" ] && grep -q '^BENCH START' $TMP/log; then
+		boot=$(( (now - start) / 1000000 ))
+	fi
+	grep -q '^BENCH END' $TMP/log && break
+	if ! kill -0 $QPID 2>/dev/null || [ $(( (now - start) / 1000000000 )) -ge $TIMEOUT ]; then
+		echo "elksbench did not complete, console log:"
+		cat $TMP/log
+		exit 1
+	fi
+	sleep 0.2
+done
+
+{
+	echo "boot $boot ms"
+	tr -d '\r' < $TMP/log | sed -n 's/^BENCH \([^ ]* [^ ]* .*\)$/\1/p'
+} > $TMP/results
+cat $TMP/results
+[ -n "$RESULTS" ] && cp $TMP/results "$RESULTS"
+exit 0